@@ -7,6 +7,7 @@
 #include <unistd.h>
 #include <math.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include "crc32_fast.h"
 #include "dumper.h"
@@ -14,7 +15,11 @@
 #include "ui.h"
 #include "nca.h"
 #include "keys.h"
+#include "rsa.h"
 #include "save.h"
+#include "writer.h"
+#include "nso.h"
+#include "ncm_local.h"
 
 /* Extern variables */
 
@@ -23,14 +28,17 @@ extern nca_keyset_t nca_keyset;
 extern u64 freeSpace;
 
 extern bool highlight;
-extern int breaks;
+extern __thread int breaks;
 extern int font_height;
 
+extern bool headlessMode;
+
 extern gamecard_ctx_t gameCardInfo;
 
 extern u32 titleAppCount, titlePatchCount, titleAddOnCount;
 extern u32 sdCardTitleAppCount, sdCardTitlePatchCount, sdCardTitleAddOnCount;
 extern u32 emmcTitleAppCount, emmcTitlePatchCount, emmcTitleAddOnCount;
+extern u32 localTitleAppCount, localTitlePatchCount, localTitleAddOnCount;
 
 extern base_app_ctx_t *baseAppEntries;
 extern patch_addon_ctx_t *patchEntries, *addOnEntries;
@@ -62,6 +70,111 @@ static void dumpStartMsg()
     breaks++;
 }
 
+static void transferChunkSizeMsg(transferSource src)
+{
+    char readChunkSizeStr[32] = {'\0'}, writeChunkSizeStr[32] = {'\0'};
+    
+    convertSize(getTransferChunkSize(src), readChunkSizeStr, MAX_CHARACTERS(readChunkSizeStr));
+    convertSize(getTransferWriteChunkSize(), writeChunkSizeStr, MAX_CHARACTERS(writeChunkSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Transfer chunk size: %s (read) / %s (write).", readChunkSizeStr, writeChunkSizeStr);
+    breaks++;
+}
+
+// Asks the user if an interrupted dump should be resumed. Batch dumps are always resumed
+// The journal and the partial dump progress are discarded if the user chooses to start over
+static bool dumpJournalResumePrompt(dumpJournal *journal, bool batch)
+{
+    if (!journal || !journal->resume) return false;
+    
+    char dumpOffsetStr[32] = {'\0'}, totalSizeStr[32] = {'\0'};
+    convertSize(journal->header.dumpOffset, dumpOffsetStr, MAX_CHARACTERS(dumpOffsetStr));
+    convertSize(journal->header.totalSize, totalSizeStr, MAX_CHARACTERS(totalSizeStr));
+    
+    if (!batch)
+    {
+        int cur_breaks = breaks;
+        breaks++;
+        
+        snprintf(strbuf, MAX_CHARACTERS(strbuf), "An interrupted dump of this content was found (%s / %s). Do you want to resume it?\nIf you choose not to, the partial dump will be overwritten.", dumpOffsetStr, totalSizeStr);
+        bool resume = yesNoPrompt(strbuf);
+        
+        // Remove the prompt from the screen
+        breaks = cur_breaks;
+        uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+        uiRefreshDisplay();
+        
+        if (!resume)
+        {
+            dumpJournalRemove(journal);
+            return false;
+        }
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming interrupted dump operation (%s / %s already dumped).", dumpOffsetStr, totalSizeStr);
+    breaks += 2;
+    
+    return true;
+}
+
+static void dumpJournalKeptMsg()
+{
+    breaks += 2;
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "The partial dump has been kept. Start the same dump procedure again to resume it.");
+}
+
+// Used by extracted filesystem dumps (HFS0, ExeFS and RomFS). Their journal state only holds the file splitting option from the interrupted dump
+static bool dumpJournalLoadFileDump(dumpJournal *journal, const char *outputPath, dumpJournalType type, u64 totalSize, bool *doSplitting)
+{
+    if (!dumpJournalLoad(journal, outputPath, type, totalSize)) return false;
+    
+    if (journal->header.stateSize != sizeof(bool))
+    {
+        dumpJournalRemove(journal);
+        return false;
+    }
+    
+    if (!dumpJournalResumePrompt(journal, false)) return false;
+    
+    *doSplitting = *((bool*)journal->state);
+    
+    return true;
+}
+
+// Skips output files that were completely dumped before the process got interrupted. Must be called for every output file, in order
+static bool dumpJournalSkipOutputFile(dumpJournal *journal, u64 fileSize, progress_ctx_t *progressCtx)
+{
+    if (!journal) return false;
+    
+    journal->curFileIndex = journal->fileCount++;
+    
+    if (!journal->resume || journal->curFileIndex >= journal->header.fileIndex) return false;
+    
+    progressCtx->curOffset += fileSize;
+    
+    return true;
+}
+
+// Opens an output file, resuming it instead if it's the one referenced by the dump journal
+static bool dumpJournalOpenOutputFile(dumpJournal *journal, outputWriter *writer, const char *path, outputSplitMode splitMode, u64 fileSize, u64 partSize, progress_ctx_t *progressCtx)
+{
+    if (!journal || !journal->resume || journal->curFileIndex != journal->header.fileIndex) return outputWriterOpen(writer, path, splitMode, fileSize, partSize, 0, 0, journal);
+    
+    if (!outputWriterResume(writer, path, splitMode, fileSize, partSize, journal))
+    {
+        outputWriterClose(writer);
+        dumpJournalRemove(journal);
+        return false;
+    }
+    
+    // Everything else is dumped from scratch
+    journal->resume = false;
+    
+    progressCtx->curOffset += writer->curOffset;
+    
+    return true;
+}
+
 bool dumpNXCardImage(xciOptions *xciDumpCfg)
 {
     if (!xciDumpCfg)
@@ -85,8 +198,14 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     u32 partition;
     Result result;
     bool proceed = true, success = false, fat32_error = false;
-    FILE *outFile = NULL;
     u8 splitIndex = 0;
+    
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
+    
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
     u32 certCrc = 0, certlessCrc = 0;
     
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
@@ -102,8 +221,6 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     sequentialXciCtx seqXciCtx;
     memset(&seqXciCtx, 0, sizeof(sequentialXciCtx));
     
-    char tmp_idx[5];
-    
     size_t read_res, write_res;
     
     char *dumpName = generateGameCardDumpName(useBrackets);
@@ -175,6 +292,32 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         certCrc = seqXciCtx.certCrc;
         certlessCrc = seqXciCtx.certlessCrc;
         progressCtx.curOffset = ((u64)seqXciCtx.partNumber * SPLIT_FILE_SEQUENTIAL_SIZE);
+    } else {
+        // Check if a previous dump was interrupted. The dump size depends on the restored options, so it's checked afterwards
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
+        
+        if (dumpJournalLoad(&journal, dumpPath, DUMP_JOURNAL_TYPE_XCI, 0))
+        {
+            if (journal.header.stateSize != sizeof(sequentialXciCtx))
+            {
+                dumpJournalRemove(&journal);
+            } else
+            if (dumpJournalResumePrompt(&journal, false))
+            {
+                // The sequential dump context doubles as the journal state
+                memcpy(&seqXciCtx, journal.state, sizeof(sequentialXciCtx));
+                
+                // Restore parameters from the journal
+                isFat32 = (journal.header.splitMode != OUTPUT_SPLIT_NONE);
+                setXciArchiveBit = (journal.header.splitMode == OUTPUT_SPLIT_DIRECTORY);
+                keepCert = seqXciCtx.keepCert;
+                trimDump = seqXciCtx.trimDump;
+                calcCrc = seqXciCtx.calcCrc;
+                certCrc = seqXciCtx.certCrc;
+                certlessCrc = seqXciCtx.certlessCrc;
+                progressCtx.curOffset = journal.header.dumpOffset;
+            }
+        }
     }
     
     u64 partSize = (seqDumpMode ? SPLIT_FILE_SEQUENTIAL_SIZE : (!setXciArchiveBit ? SPLIT_FILE_XCI_PART_SIZE : SPLIT_FILE_NSP_PART_SIZE));
@@ -250,6 +393,29 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Keep certificate: %s | Trim output dump: %s | CRC32 checksum calculation + dump verification: %s.", (keepCert ? "Yes" : "No"), (trimDump ? "Yes" : "No"), (calcCrc ? "Yes" : "No"));
         breaks += 2;
         
+        uiRefreshDisplay();
+    } else
+    if (journal.resume)
+    {
+        u64 curXciOffset = 0;
+        
+        if (seqXciCtx.partitionIndex < ISTORAGE_PARTITION_CNT && seqXciCtx.partitionOffset <= partitionSizes[seqXciCtx.partitionIndex])
+        {
+            for(u32 i = 0; i < seqXciCtx.partitionIndex; i++) curXciOffset += partitionSizes[i];
+            curXciOffset += seqXciCtx.partitionOffset;
+        }
+        
+        // Make sure the journal matches the current gamecard
+        if (journal.header.totalSize != progressCtx.totalSize || curXciOffset != progressCtx.curOffset || progressCtx.curOffset > progressCtx.totalSize)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid dump journal! Please restart the dump procedure.", __func__);
+            dumpJournalRemove(&journal);
+            goto out;
+        }
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Configuration parameters overrided. Keep certificate: %s | Trim output dump: %s | CRC32 checksum calculation + dump verification: %s.", (keepCert ? "Yes" : "No"), (trimDump ? "Yes" : "No"), (calcCrc ? "Yes" : "No"));
+        breaks += 2;
+        
         uiRefreshDisplay();
     } else {
         if (progressCtx.totalSize > freeSpace)
@@ -330,7 +496,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         }
         
         // Check if the dump already exists
-        if (checkIfFileExists(dumpPath))
+        if (!journal.resume && checkIfFileExists(dumpPath))
         {
             // Ask the user if they want to proceed anyway
             int cur_breaks = breaks;
@@ -348,29 +514,47 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             }
         }
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && setXciArchiveBit)
+        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && setXciArchiveBit && !journal.resume)
         {
             // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
             // Better safe than sorry
             remove(dumpPath);
             fsdevDeleteDirectoryRecursively(dumpPath);
-            
-            mkdir(dumpPath, 0744);
-            
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(dumpPath, tmp_idx);
         }
     }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(TRANSFER_SOURCE_GAMECARD);
+    
+    // The output writer takes care of the part file naming
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
+    
+    outputSplitMode splitMode = (seqDumpMode ? OUTPUT_SPLIT_SUFFIX : ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32) ? (setXciArchiveBit ? OUTPUT_SPLIT_DIRECTORY : OUTPUT_SPLIT_XCI) : OUTPUT_SPLIT_NONE));
+    
+    if (journal.resume)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
+        if (!outputWriterResume(&writer, dumpPath, splitMode, progressCtx.totalSize, partSize, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to resume interrupted dump: %s", __func__, writer.errorStr);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks + 1), FONT_COLOR_ERROR_RGB, "Please restart the dump procedure.");
+            breaks++;
+            dumpJournalRemove(&journal);
+            goto out;
+        }
+    } else {
+        // The journal was loaded before the dump size was known
+        journal.header.totalSize = progressCtx.totalSize;
+        
+        if (!outputWriterOpen(&writer, dumpPath, splitMode, progressCtx.totalSize, partSize, splitIndex, progressCtx.curOffset, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            goto out;
+        }
     }
     
     // Start dump process
     dumpStartMsg();
+    transferChunkSizeMsg(TRANSFER_SOURCE_GAMECARD);
     appletModeOperationWarning();
     uiRefreshDisplay();
     breaks++;
@@ -380,24 +564,24 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     progressCtx.line_offset = (breaks + 4);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    u32 startPartitionIndex = (seqDumpMode ? seqXciCtx.partitionIndex : 0);
-    u64 startPartitionOffset;
+    u32 startPartitionIndex = ((seqDumpMode || journal.resume) ? seqXciCtx.partitionIndex : 0);
+    u64 startPartitionOffset, partitionImageOffset = 0;
+    
+    for(partition = 0; partition < startPartitionIndex; partition++) partitionImageOffset += gameCardInfo.IStoragePartitionSizes[partition];
     
-    for(partition = startPartitionIndex; partition < ISTORAGE_PARTITION_CNT; partition++)
+    // Open both IStorage partitions at once and read them as a single linear address space, with read-ahead
+    result = openGameCardImage();
+    if (R_FAILED(result))
     {
-        n = DUMP_BUFFER_SIZE;
-        
-        startPartitionOffset = ((seqDumpMode && partition == startPartitionIndex) ? seqXciCtx.partitionOffset : 0);
-        
-        openIStoragePartition idx = (openIStoragePartition)(partition + 1);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open gamecard IStorage partitions! (0x%08X)", __func__, result);
+        proceed = false;
+    }
+    
+    for(partition = startPartitionIndex; proceed && partition < ISTORAGE_PARTITION_CNT; partitionImageOffset += gameCardInfo.IStoragePartitionSizes[partition], partition++)
+    {
+        n = getTransferChunkSize(TRANSFER_SOURCE_GAMECARD);
         
-        result = openGameCardStoragePartition(idx);
-        if (R_FAILED(result))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, partition, result);
-            proceed = false;
-            break;
-        }
+        startPartitionOffset = (((seqDumpMode || journal.resume) && partition == startPartitionIndex) ? seqXciCtx.partitionOffset : 0);
         
         for(partitionOffset = startPartitionOffset; partitionOffset < partitionSizes[partition]; partitionOffset += n, progressCtx.curOffset += n, seqDumpSessionOffset += n)
         {
@@ -405,16 +589,16 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             
             uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/' ) + 1);
             
             uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping IStorage partition #%u...", partition);
             
             if (n > (partitionSizes[partition] - partitionOffset)) n = (partitionSizes[partition] - partitionOffset);
             
             // Check if the next read chunk will exceed the size of the current part file
-            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((splitIndex - seqXciCtx.partNumber) + 1) * partSize))
+            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((writer.partIndex - seqXciCtx.partNumber) + 1) * partSize))
             {
-                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((splitIndex - seqXciCtx.partNumber) + 1) * partSize));
+                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((writer.partIndex - seqXciCtx.partNumber) + 1) * partSize));
                 u64 old_file_chunk_size = (n - new_file_chunk_size);
                 
                 u64 remainderDumpSize = (progressCtx.totalSize - (progressCtx.curOffset + old_file_chunk_size));
@@ -429,7 +613,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                 }
             }
             
-            result = readGameCardStoragePartition(partitionOffset, dumpBuf, n);
+            result = readGameCardImage(partitionImageOffset + partitionOffset, &dumpBuf, n);
             if (R_FAILED(result))
             {
                 uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, partitionOffset, partition, result);
@@ -480,72 +664,34 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                 }
             }
             
-            if ((seqDumpMode || (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)) && (progressCtx.curOffset + n) >= ((splitIndex + 1) * partSize))
+            if (!outputWriterWrite(&writer, dumpBuf, n))
             {
-                u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * partSize));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
                 
-                if (old_file_chunk_size > 0)
+                if (splitMode == OUTPUT_SPLIT_NONE && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
                 {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
+                    fat32_error = true;
                 }
                 
-                fclose(outFile);
-                outFile = NULL;
+                proceed = false;
+                break;
+            }
+            
+            if (!seqDumpMode)
+            {
+                // Periodically record the dump progress, so it can be resumed if the process gets interrupted
+                seqXciCtx.keepCert = keepCert;
+                seqXciCtx.trimDump = trimDump;
+                seqXciCtx.calcCrc = calcCrc;
+                seqXciCtx.partitionIndex = partition;
+                seqXciCtx.partitionOffset = (partitionOffset + n);
+                seqXciCtx.certCrc = certCrc;
+                seqXciCtx.certlessCrc = certlessCrc;
                 
-                if (((seqDumpMode && !seqDumpFinish) || !seqDumpMode) && (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize))
-                {
-                    splitIndex++;
-                    
-                    if (seqDumpMode)
-                    {
-                        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci.%02u", XCI_DUMP_PATH, dumpName, splitIndex);
-                    } else {
-                        if (setXciArchiveBit)
-                        {
-                            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci/%02u", XCI_DUMP_PATH, dumpName, splitIndex);
-                        } else {
-                            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xc%u", XCI_DUMP_PATH, dumpName, splitIndex);
-                        }
-                    }
-                    
-                    outFile = fopen(dumpPath, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
+                if (!dumpJournalCheckpoint(&journal, &writer, progressCtx.curOffset + n, &seqXciCtx, sizeof(sequentialXciCtx), false))
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                    
-                    if (!seqDumpMode && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
-                        fat32_error = true;
-                    }
-                    
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
                     proceed = false;
                     break;
                 }
@@ -562,8 +708,6 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             }
         }
         
-        closeGameCardStoragePartition();
-        
         if (!proceed)
         {
             if (seqDumpMode) seqDumpFileRemove = true;
@@ -575,7 +719,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         {
             uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/' ) + 1);
             
             uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping IStorage partition #%u...", partition);
             
@@ -587,12 +731,14 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         if (seqDumpMode && seqDumpFinish) break;
     }
     
+    closeGameCardImage();
+    
     if (!proceed) setProgressBarError(&progressCtx);
     
     breaks = (progressCtx.line_offset + 2);
     if (fat32_error) breaks += 2;
     
-    if (outFile) fclose(outFile);
+    outputWriterClose(&writer);
     
     if (success)
     {
@@ -601,7 +747,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             if (seqDumpFinish)
             {
                 // Update the sequence reference file in the SD card
-                seqXciCtx.partNumber = (splitIndex + 1);
+                seqXciCtx.partNumber = writer.partIndex;
                 seqXciCtx.partitionIndex = partition;
                 seqXciCtx.partitionOffset = partitionOffset;
                 
@@ -673,21 +819,27 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             }
         }
         
+        dumpJournalRemove(&journal);
+        
         // Set archive bit (only for FAT32 and if the required option is enabled)
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && setXciArchiveBit)
+        if (splitMode == OUTPUT_SPLIT_DIRECTORY)
         {
-            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
-            result = fsdevSetConcatenationFileAttribute(dumpPath);
+            result = outputWriterSetArchiveBit(&writer);
             if (R_FAILED(result))
             {
                 breaks += 2;
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Warning: failed to set archive bit on output directory! (0x%08X)", result);
             }
         }
+    } else
+    if (journal.saved)
+    {
+        // Keep the partial dump, so it can be resumed later
+        dumpJournalKeptMsg();
     } else {
         if (seqDumpMode)
         {
-            for(u8 i = 0; i <= splitIndex; i++)
+            for(u8 i = 0; i <= writer.partIndex; i++)
             {
                 snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci.%02u", XCI_DUMP_PATH, dumpName, i);
                 remove(dumpPath);
@@ -697,10 +849,9 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             {
                 if (setXciArchiveBit)
                 {
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
                     fsdevDeleteDirectoryRecursively(dumpPath);
                 } else {
-                    for(u8 i = 0; i <= splitIndex; i++)
+                    for(u8 i = 0; i <= writer.partIndex; i++)
                     {
                         snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xc%u", XCI_DUMP_PATH, dumpName, i);
                         remove(dumpPath);
@@ -713,6 +864,8 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     }
     
 out:
+    dumpJournalFree(&journal);
+    
     if (dumpName) free(dumpName);
     
     if (seqDumpFile) fclose(seqDumpFile);
@@ -726,25 +879,152 @@ out:
     return success;
 }
 
-int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleIndex, nspOptions *nspDumpCfg, bool batch)
+typedef struct {
+    nspTitleCtx *ctx;
+    nspMetadataJob *jobs;
+    u32 jobCnt;
+    u8 contentType;                                 // Only requests for NCAs with this content type are handled by this worker
+    pthread_t thread;
+    bool threadCreated;
+    bool success;
+    uiMessageLog log;                               // Error messages from the worker thread. Drawn by runNspMetadataJobs() once the thread is joined
+} nspMetadataWorker;
+
+static void processNspMetadataJobs(nspMetadataWorker *worker)
 {
-    int ret = -1;
+    u32 i;
+    nspTitleCtx *ctx = worker->ctx;
     
-    if (!nspDumpCfg)
+    worker->success = true;
+    
+    for(i = 0; i < worker->jobCnt && worker->success; i++)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP configuration struct!", __func__);
-        breaks += 2;
-        return ret;
+        nspMetadataJob *job = &(worker->jobs[i]);
+        if (ctx->xml_content_info[job->ncaIndex].type != worker->contentType) continue;
+        
+        xml_record_info *record = &(ctx->xml_records[job->recordIndex]);
+        u8 *decrypted_nca_keys = ctx->xml_content_info[job->ncaIndex].decrypted_nca_keys;
+        
+        switch(worker->contentType)
+        {
+            case NcmContentType_Program:
+                worker->success = generateProgramInfoXml(&(ctx->ncmStorage), &(job->ncaId), &(job->dec_header), decrypted_nca_keys, job->useAcidPubKey, &(record->xml_data), &(record->xml_size));
+                break;
+            case NcmContentType_Control:
+                worker->success = retrieveNacpDataFromNca(&(ctx->ncmStorage), &(job->ncaId), &(job->dec_header), decrypted_nca_keys, &(record->xml_data), &(record->xml_size), &(record->nacp_icons), &(record->nacp_icon_cnt));
+                break;
+            case NcmContentType_LegalInformation:
+                worker->success = retrieveLegalInfoXmlFromNca(&(ctx->ncmStorage), &(job->ncaId), &(job->dec_header), decrypted_nca_keys, &(record->xml_data), &(record->xml_size));
+                break;
+            default:
+                break;
+        }
     }
+}
+
+static void *nspMetadataWorkerThreadFunc(void *arg)
+{
+    nspMetadataWorker *worker = (nspMetadataWorker*)arg;
     
-    bool isFat32 = nspDumpCfg->isFat32;
-    bool useNoIntroLookup = nspDumpCfg->useNoIntroLookup;
-    bool removeConsoleData = nspDumpCfg->removeConsoleData;
-    bool tiklessDump = nspDumpCfg->tiklessDump;
-    bool npdmAcidRsaPatch = nspDumpCfg->npdmAcidRsaPatch;
-    bool dumpDeltaFragments = nspDumpCfg->dumpDeltaFragments;
-    bool useBrackets = nspDumpCfg->useBrackets;
-    bool preInstall = false;
+    // Keep the error messages until the thread is joined, so concurrent failures don't overwrite each other
+    uiCaptureMessages(&(worker->log));
+    
+    // Each worker thread decrypts NCA sections through its own CTR buffer
+    if (initNcaCtrThreadBuffer())
+    {
+        processNspMetadataJobs(worker);
+        freeNcaCtrThreadBuffer();
+    } else {
+        worker->success = false;
+    }
+    
+    uiCaptureMessages(NULL);
+    
+    return NULL;
+}
+
+// Runs the metadata extraction requests for a title, using a worker thread for each content type
+// Requests for the same content type are handled in order by the same worker, since the NSO parser used by generateProgramInfoXml() relies on global state
+static bool runNspMetadataJobs(nspTitleCtx *ctx, nspMetadataJob *jobs, u32 jobCnt)
+{
+    u32 i, j;
+    bool success = true;
+    
+    const u8 contentTypes[NSP_METADATA_WORKER_CNT] = { NcmContentType_Program, NcmContentType_Control, NcmContentType_LegalInformation };
+    nspMetadataWorker workers[NSP_METADATA_WORKER_CNT];
+    
+    for(i = 0; i < NSP_METADATA_WORKER_CNT; i++)
+    {
+        memset(&(workers[i]), 0, sizeof(nspMetadataWorker));
+        workers[i].ctx = ctx;
+        workers[i].jobs = jobs;
+        workers[i].jobCnt = jobCnt;
+        workers[i].contentType = contentTypes[i];
+        workers[i].success = true;
+        
+        // Don't bother starting a thread if there's nothing to do
+        for(j = 0; j < jobCnt; j++)
+        {
+            if (ctx->xml_content_info[jobs[j].ncaIndex].type == contentTypes[i]) break;
+        }
+        
+        if (j == jobCnt) continue;
+        
+        workers[i].threadCreated = (pthread_create(&(workers[i].thread), NULL, &nspMetadataWorkerThreadFunc, &(workers[i])) == 0);
+        
+        // Process the requests on the current thread if the worker couldn't be created
+        if (!workers[i].threadCreated) processNspMetadataJobs(&(workers[i]));
+    }
+    
+    for(i = 0; i < NSP_METADATA_WORKER_CNT; i++)
+    {
+        if (workers[i].threadCreated) pthread_join(workers[i].thread, NULL);
+        if (!workers[i].success) success = false;
+        
+        // Messages are drawn in worker order, right below each other
+        uiFlushMessageLog(&(workers[i].log));
+    }
+    
+    return success;
+}
+
+// Retrieves the values needed to look up a title in the content meta database from its storage
+static void getNspTitleNcmInfo(nspDumpType selectedNspDumpType, u32 titleIndex, NcmStorageId *outStorageId, NcmContentMetaType *outMetaType, u32 *outTitleCount, u32 *outNcmTitleIndex)
+{
+    NcmStorageId curStorageId = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].storageId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
+    u32 titleCount = 0;
+    
+    switch(curStorageId)
+    {
+        case NcmStorageId_GameCard:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? titleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? titlePatchCount : titleAddOnCount));
+            break;
+        case NcmStorageId_SdCard:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? sdCardTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
+            break;
+        case NcmStorageId_BuiltInUser:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? emmcTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? emmcTitlePatchCount : emmcTitleAddOnCount));
+            break;
+        case LOCAL_CONTENT_STORAGE_ID:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? localTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? localTitlePatchCount : localTitleAddOnCount));
+            break;
+        default:
+            break;
+    }
+    
+    *outStorageId = curStorageId;
+    *outMetaType = (selectedNspDumpType == DUMP_APP_NSP ? NcmContentMetaType_Application : (selectedNspDumpType == DUMP_PATCH_NSP ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
+    *outTitleCount = titleCount;
+    *outNcmTitleIndex = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].ncmIndex : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
+}
+
+static bool prepareNspTitleCtx(nspTitleCtx *ctx, nspDumpType selectedNspDumpType, u32 titleIndex, bool removeConsoleData, bool tiklessDump, bool npdmAcidRsaPatch, bool dumpDeltaFragments, bool *preInstall, bool allowPrompt)
+{
+    if (!ctx || !preInstall)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters!", __func__);
+        return false;
+    }
     
     Result result;
     u32 i = 0, j = 0;
@@ -753,215 +1033,32 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     NcmContentMetaType metaType;
     u32 titleCount = 0, ncmTitleIndex = 0;
     
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
-    
-    NcmContentInfo *titleContentInfos = NULL;
-    u32 titleContentInfoCnt = 0;
-    
-    NcmContentStorage ncmStorage;
-    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
-    
-    cnmt_xml_program_info xml_program_info;
-    cnmt_xml_content_info *xml_content_info = NULL;
-    
     NcmContentId ncaId;
     u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
     nca_header_t dec_nca_header;
     
-    nca_cnmt_mod_data ncaCnmtMod;
-    memset(&ncaCnmtMod, 0, sizeof(nca_cnmt_mod_data));
+    xml_record_info *tmp_xml_rec = NULL;
     
-    u32 ncaProgramModCnt = 0;
-    nca_program_mod_data *ncaProgramMod = NULL;
+    // Program NCA headers with a recreated NPDM signature. The signatures are calculated in the background while the rest of the NCAs are processed
+    nca_header_t *signHeaders = NULL;
+    rsa_sign_job *signJobs = NULL;
     
-    title_rights_ctx rights_info;
-    memset(&rights_info, 0, sizeof(title_rights_ctx));
-    
-    u32 cnmtNcaIndex = 0;
-    u8 *cnmtNcaBuf = NULL;
-    bool cnmtFound = false;
-    char *cnmtXml = NULL;
-    
-    u32 xml_rec_cnt = 0;
-    xml_record_info *xml_records = NULL, *tmp_xml_rec = NULL;
-    
-    pfs0_header nspPfs0Header;
-    memset(&nspPfs0Header, 0, sizeof(pfs0_header));
-    nspPfs0Header.magic = __builtin_bswap32(PFS0_MAGIC);
-    
-    pfs0_file_entry *nspPfs0EntryTable = NULL;
-    
-    char *nspPfs0StrTable = NULL;
-    u64 nspPfs0StrTableSize = 0;
-    
-    u64 fullPfs0HeaderSize = 0;
-    
-    u8 **nspPfs0FilePtrs = NULL;
-    
-    Sha256Context nca_hash_ctx;
-    sha256ContextCreate(&nca_hash_ctx);
-    
-    u64 n, fileOffset;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    u32 crc = 0;
-    bool proceed = true, dumping = false, fat32_error = false, removeFile = true;
-    
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
-    
-    bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false;
-    char seqDumpFilename[NAME_BUF_LEN] = {'\0'};
-    FILE *seqDumpFile = NULL;
-    u64 seqDumpFileSize = 0, seqDumpSessionOffset = 0;
-    u8 *seqDumpNcaHashes = NULL;
-    
-    sequentialNspCtx seqNspCtx;
-    memset(&seqNspCtx, 0, sizeof(sequentialNspCtx));
-    
-    char pfs0HeaderFilename[NAME_BUF_LEN] = {'\0'};
-    FILE *pfs0HeaderFile = NULL;
-    
-    char tmp_idx[5];
-    
-    size_t read_res, write_res;
-    
-    if ((selectedNspDumpType == DUMP_APP_NSP && !baseAppEntries) || (selectedNspDumpType == DUMP_PATCH_NSP && !patchEntries) || (selectedNspDumpType == DUMP_ADDON_NSP && !addOnEntries))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title storage ID unavailable!", __func__);
-        breaks += 2;
-        return ret;
-    }
-    
-    if ((selectedNspDumpType == DUMP_APP_NSP && titleIndex >= titleAppCount) || (selectedNspDumpType == DUMP_PATCH_NSP && titleIndex >= titlePatchCount) || (selectedNspDumpType == DUMP_ADDON_NSP && titleIndex >= titleAddOnCount))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
-        breaks += 2;
-        return ret;
-    }
-    
-    curStorageId = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].storageId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
-    
-    ncmTitleIndex = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].ncmIndex : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
-    
-    metaType = (selectedNspDumpType == DUMP_APP_NSP ? NcmContentMetaType_Application : (selectedNspDumpType == DUMP_PATCH_NSP ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
-    
-    switch(curStorageId)
-    {
-        case NcmStorageId_GameCard:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? titleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? titlePatchCount : titleAddOnCount));
-            break;
-        case NcmStorageId_SdCard:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? sdCardTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
-            break;
-        case NcmStorageId_BuiltInUser:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? emmcTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? emmcTitlePatchCount : emmcTitleAddOnCount));
-            break;
-        default:
-            break;
-    }
+    // Metadata extraction requests. These are processed concurrently once all NCA headers are ready
+    nspMetadataJob *metaJobs = NULL;
+    u32 metaJobCnt = 0;
     
-    char *dumpName = generateNSPDumpName(selectedNspDumpType, titleIndex, useBrackets);
-    if (!dumpName)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        breaks += 2;
-        return ret;
-    }
+    bool proceed = true, cnmtFound = false;
     
-    if (!batch)
-    {
-        snprintf(seqDumpFilename, MAX_CHARACTERS(seqDumpFilename), "%s%s.nsp.seq", NSP_DUMP_PATH, dumpName);
-        snprintf(pfs0HeaderFilename, MAX_CHARACTERS(pfs0HeaderFilename), "%s%s.nsp.hdr", NSP_DUMP_PATH, dumpName);
-        
-        // Check if we're dealing with a sequential dump
-        seqDumpMode = checkIfFileExists(seqDumpFilename);
-        if (seqDumpMode)
-        {
-            // Open sequence file
-            seqDumpFile = fopen(seqDumpFilename, "rb+");
-            if (!seqDumpFile)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to open existing sequential dump reference file for reading! (\"%s\")", __func__, seqDumpFilename);
-                goto out;
-            }
-            
-            // Retrieve sequence file size
-            fseek(seqDumpFile, 0, SEEK_END);
-            seqDumpFileSize = ftell(seqDumpFile);
-            rewind(seqDumpFile);
-            
-            // Read sequentialNspCtx struct info
-            read_res = fread(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
-            if (read_res != sizeof(sequentialNspCtx))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, sizeof(sequentialNspCtx), read_res);
-                goto out;
-            }
-            
-            // Check if the storage ID is right
-            if (seqNspCtx.storageId != curStorageId)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid source storage ID in sequential dump reference file!", __func__);
-                goto out;
-            }
-            
-            // Check if the Program NCA mod count field is valid
-            if (seqNspCtx.programNcaModCount > 0 && !seqNspCtx.npdmAcidRsaPatch)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid Program NCA mod count sequential dump reference file!", __func__);
-                seqDumpFileRemove = true;
-                goto out;
-            }
-            
-            // Check file size
-            if (seqDumpFileSize != (sizeof(sequentialNspCtx) + (seqNspCtx.ncaCount * SHA256_HASH_SIZE) + (seqNspCtx.programNcaModCount * NCA_FULL_HEADER_LENGTH)))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid sequential dump reference file size!", __func__);
-                seqDumpFileRemove = true;
-                goto out;
-            }
-            
-            // Allocate memory for the NCA hashes
-            seqDumpNcaHashes = calloc(1, seqNspCtx.ncaCount * SHA256_HASH_SIZE);
-            if (!seqDumpNcaHashes)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the sequential dump reference file!", __func__);
-                goto out;
-            }
-            
-            // Read NCA hashes
-            read_res = fread(seqDumpNcaHashes, 1, seqNspCtx.ncaCount * SHA256_HASH_SIZE, seqDumpFile);
-            if (read_res != (seqNspCtx.ncaCount * SHA256_HASH_SIZE))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, seqNspCtx.ncaCount * SHA256_HASH_SIZE, read_res);
-                goto out;
-            }
-            
-            // Restore parameters from the sequence file
-            isFat32 = true;
-            removeConsoleData = seqNspCtx.removeConsoleData;
-            tiklessDump = seqNspCtx.tiklessDump;
-            npdmAcidRsaPatch = seqNspCtx.npdmAcidRsaPatch;
-            preInstall = seqNspCtx.preInstall;
-            splitIndex = seqNspCtx.partNumber;
-            progressCtx.curOffset = ((u64)seqNspCtx.partNumber * SPLIT_FILE_SEQUENTIAL_SIZE);
-        }
-    }
+    memset(ctx, 0, sizeof(nspTitleCtx));
     
-    u64 partSize = (seqDumpMode ? SPLIT_FILE_SEQUENTIAL_SIZE : SPLIT_FILE_NSP_PART_SIZE);
+    getNspTitleNcmInfo(selectedNspDumpType, titleIndex, &curStorageId, &metaType, &titleCount, &ncmTitleIndex);
     
-    if (!batch)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving information from encrypted NCA content files...");
-        uiRefreshDisplay();
-        breaks += 2;
-    }
+    ctx->storageId = curStorageId;
     
-    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
+    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &(ctx->titleContentInfos), &(ctx->titleContentInfoCnt)))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        goto out;
+        return false;
     }
     
     // If we're dealing with a gamecard, open the Secure HFS0 partition (IStorage partition #1) to read NCA data
@@ -971,40 +1068,79 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         result = openGameCardStoragePartition(ISTORAGE_PARTITION_SECURE);
         if (R_FAILED(result))
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to open IStorage partition #1! (0x%08X)", __func__, result);
-            goto out;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #1! (0x%08X)", __func__, result);
+            return false;
         }
     }
     
-    result = ncmOpenContentStorage(&ncmStorage, curStorageId);
+    result = ncmLocalOpenContentStorage(&(ctx->ncmStorage), curStorageId);
     if (R_FAILED(result))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
-        goto out;
+        return false;
     }
     
     // Fill information for our CNMT XML
-    memset(&xml_program_info, 0, sizeof(cnmt_xml_program_info));
-    xml_program_info.type = (u8)metaType;
-    xml_program_info.title_id = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].titleId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].titleId : addOnEntries[titleIndex].titleId));
-    xml_program_info.version = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].version : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].version : addOnEntries[titleIndex].version));
-    xml_program_info.nca_cnt = titleContentInfoCnt;
+    memset(&(ctx->xml_program_info), 0, sizeof(cnmt_xml_program_info));
+    ctx->xml_program_info.type = (u8)metaType;
+    ctx->xml_program_info.title_id = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].titleId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].titleId : addOnEntries[titleIndex].titleId));
+    ctx->xml_program_info.version = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].version : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].version : addOnEntries[titleIndex].version));
+    ctx->xml_program_info.nca_cnt = ctx->titleContentInfoCnt;
     
-    xml_content_info = calloc(titleContentInfoCnt, sizeof(cnmt_xml_content_info));
-    if (!xml_content_info)
+    ctx->xml_content_info = calloc(ctx->titleContentInfoCnt, sizeof(cnmt_xml_content_info));
+    if (!ctx->xml_content_info)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT XML content info struct!", __func__);
-        goto out;
+        return false;
+    }
+    
+    if (npdmAcidRsaPatch)
+    {
+        signHeaders = calloc(ctx->titleContentInfoCnt, sizeof(nca_header_t));
+        signJobs = calloc(ctx->titleContentInfoCnt, sizeof(rsa_sign_job));
+        if (!signHeaders || !signJobs)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NPDM signature requests!", __func__);
+            if (signHeaders) free(signHeaders);
+            if (signJobs) free(signJobs);
+            return false;
+        }
+    }
+    
+    metaJobs = calloc(ctx->titleContentInfoCnt, sizeof(nspMetadataJob));
+    if (!metaJobs)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the metadata extraction requests!", __func__);
+        if (signHeaders) free(signHeaders);
+        if (signJobs) free(signJobs);
+        return false;
+    }
+    
+    // Read and decrypt all NCA headers from this title in a single batch
+    NcmContentId *prefetchNcaIds = calloc(ctx->titleContentInfoCnt, sizeof(NcmContentId));
+    if (prefetchNcaIds)
+    {
+        u32 prefetchNcaCnt = 0;
+        
+        for(i = 0; i < ctx->titleContentInfoCnt; i++)
+        {
+            if (ctx->titleContentInfos[i].content_type >= NcmContentType_DeltaFragment && !dumpDeltaFragments) continue;
+            memcpy(&(prefetchNcaIds[prefetchNcaCnt++]), &(ctx->titleContentInfos[i].content_id), sizeof(NcmContentId));
+        }
+        
+        prefetchNcaHeaders(&(ctx->ncmStorage), prefetchNcaIds, prefetchNcaCnt);
+        
+        free(prefetchNcaIds);
     }
     
     // Fill our CNMT XML content records, leaving the CNMT NCA at the end
     u32 titleContentInfoIndex;
-    for(i = 0, titleContentInfoIndex = 0; titleContentInfoIndex < titleContentInfoCnt; i++, titleContentInfoIndex++)
+    for(i = 0, titleContentInfoIndex = 0; titleContentInfoIndex < ctx->titleContentInfoCnt; i++, titleContentInfoIndex++)
     {
-        if (!cnmtFound && titleContentInfos[titleContentInfoIndex].content_type == NcmContentType_Meta)
+        if (!cnmtFound && ctx->titleContentInfos[titleContentInfoIndex].content_type == NcmContentType_Meta)
         {
             cnmtFound = true;
-            cnmtNcaIndex = titleContentInfoIndex;
+            ctx->cnmtNcaIndex = titleContentInfoIndex;
             i--;
             continue;
         }
@@ -1014,34 +1150,34 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         // For any dumping purposes, they're useless, because they just increase the size of the output dump. The more updates come out for a title, the more Delta Fragments there will be available for that title
         // Also, since they're basically an eShop thing, they're not available in gamecards (so in this particular case, we need to skip them anyway)
         // However, their content records must be kept intact in the CNMT NCA
-        if (titleContentInfos[titleContentInfoIndex].content_type >= NcmContentType_DeltaFragment && !dumpDeltaFragments)
+        if (ctx->titleContentInfos[titleContentInfoIndex].content_type >= NcmContentType_DeltaFragment && !dumpDeltaFragments)
         {
-            xml_program_info.nca_cnt--;
+            ctx->xml_program_info.nca_cnt--;
             i--;
             continue;
         }
         
         // Fill information for our CNMT XML
-        xml_content_info[i].type = titleContentInfos[titleContentInfoIndex].content_type;
-        memcpy(xml_content_info[i].nca_id, titleContentInfos[titleContentInfoIndex].content_id.c, SHA256_HASH_SIZE / 2); // Temporary
-        convertDataToHexString(titleContentInfos[titleContentInfoIndex].content_id.c, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1); // Temporary
-        convertNcaSizeToU64(titleContentInfos[titleContentInfoIndex].size, &(xml_content_info[i].size));
-        xml_content_info[i].id_offset = titleContentInfos[titleContentInfoIndex].id_offset;
-        convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1); // Temporary
+        ctx->xml_content_info[i].type = ctx->titleContentInfos[titleContentInfoIndex].content_type;
+        memcpy(ctx->xml_content_info[i].nca_id, ctx->titleContentInfos[titleContentInfoIndex].content_id.c, SHA256_HASH_SIZE / 2); // Temporary
+        convertDataToHexString(ctx->titleContentInfos[titleContentInfoIndex].content_id.c, SHA256_HASH_SIZE / 2, ctx->xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1); // Temporary
+        convertNcaSizeToU64(ctx->titleContentInfos[titleContentInfoIndex].size, &(ctx->xml_content_info[i].size));
+        ctx->xml_content_info[i].id_offset = ctx->titleContentInfos[titleContentInfoIndex].id_offset;
+        convertDataToHexString(ctx->xml_content_info[i].hash, SHA256_HASH_SIZE, ctx->xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1); // Temporary
         
-        memcpy(&ncaId, &(titleContentInfos[titleContentInfoIndex].content_id), sizeof(NcmContentId));
+        memcpy(&ncaId, &(ctx->titleContentInfos[titleContentInfoIndex].content_id), sizeof(NcmContentId));
         
-        if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
+        if (!isNcaHeaderCached(&ncaId) && !readNcaDataByContentId(&(ctx->ncmStorage), &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
         {
             breaks++;
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from NCA \"%s\"!", __func__, xml_content_info[i].nca_id_str);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from NCA \"%s\"!", __func__, ctx->xml_content_info[i].nca_id_str);
             proceed = false;
             break;
         }
         
         // Decrypt the NCA header
         // Don't retrieve the ticket and/or titlekey if we're dealing with a Patch with titlekey crypto bundled with the inserted gamecard
-        if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, xml_content_info[i].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard)))
+        if (!decryptNcaHeader(&ncaId, ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &(ctx->rights_info), ctx->xml_content_info[i].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard), curStorageId))
         {
             proceed = false;
             break;
@@ -1061,10 +1197,10 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         
         // Check if the missing ticket flag is enabled
         // If so, we may be dealing with a preinstalled title
-        if (curStorageId != NcmStorageId_GameCard && has_rights_id && rights_info.missing_tik && !preInstall)
+        if (curStorageId != NcmStorageId_GameCard && has_rights_id && ctx->rights_info.missing_tik && !(*preInstall))
         {
             // Only display the pre-install prompt if we're not running a batch / sequential dump operation (excluding the first run of the latter)
-            if (!batch && !seqDumpMode)
+            if (allowPrompt)
             {
                 int cur_breaks = breaks;
                 breaks += 2;
@@ -1076,7 +1212,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                     break;
                 } else {
                     breaks = cur_breaks;
-                    preInstall = true;
+                    *preInstall = true;
                 }
             }
             
@@ -1085,7 +1221,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         }
         
         // Fill information for our CNMT XML
-        xml_content_info[i].keyblob = (dec_nca_header.crypto_type2 > dec_nca_header.crypto_type ? dec_nca_header.crypto_type2 : dec_nca_header.crypto_type);
+        ctx->xml_content_info[i].keyblob = (dec_nca_header.crypto_type2 > dec_nca_header.crypto_type ? dec_nca_header.crypto_type2 : dec_nca_header.crypto_type);
         
         if (curStorageId == NcmStorageId_GameCard)
         {
@@ -1105,9 +1241,9 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 }
                 
                 // Patch ACID public RSA key and recreate the NCA NPDM signature if we're dealing with the Program NCA
-                if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
+                if (ctx->xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
                 {
-                    if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
+                    if (!processProgramNca(&(ctx->ncmStorage), &ncaId, &dec_nca_header, &(ctx->xml_content_info[i]), &(ctx->ncaProgramMod), &(ctx->ncaProgramModCnt), i))
                     {
                         proceed = false;
                         break;
@@ -1122,7 +1258,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 if (has_rights_id)
                 {
                     // Retrieve the ticket from the HFS0 partition in the gamecard
-                    if (!retrieveTitleKeyFromGameCardTicket(&rights_info, xml_content_info[i].decrypted_nca_keys))
+                    if (!retrieveTitleKeyFromGameCardTicket(&(ctx->rights_info), ctx->xml_content_info[i].decrypted_nca_keys))
                     {
                         proceed = false;
                         break;
@@ -1132,7 +1268,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                     if (tiklessDump)
                     {
                         // Generate new encrypted NCA key area using titlekey
-                        if (!generateEncryptedNcaKeyAreaWithTitlekey(&dec_nca_header, xml_content_info[i].decrypted_nca_keys))
+                        if (!generateEncryptedNcaKeyAreaWithTitlekey(&dec_nca_header, ctx->xml_content_info[i].decrypted_nca_keys))
                         {
                             proceed = false;
                             break;
@@ -1142,9 +1278,9 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                         memset(dec_nca_header.rights_id, 0, 0x10);
                         
                         // Patch ACID pubkey and recreate NCA NPDM signature if we're dealing with the Program NCA
-                        if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
+                        if (ctx->xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
                         {
-                            if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
+                            if (!processProgramNca(&(ctx->ncmStorage), &ncaId, &dec_nca_header, &(ctx->xml_content_info[i]), &(ctx->ncaProgramMod), &(ctx->ncaProgramModCnt), i))
                             {
                                 proceed = false;
                                 break;
@@ -1154,14 +1290,14 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 }
             }
         } else
-        if (curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser)
+        if (curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser || curStorageId == LOCAL_CONTENT_STORAGE_ID)
         {
             // Only mess with the NCA header if we're dealing with a content with a populated Rights ID field, and if both removeConsoleData and tiklessDump are true
             // This will only be done if we were able to retrieve the ticket for this title
-            if (has_rights_id && rights_info.retrieved_tik && removeConsoleData && tiklessDump)
+            if (has_rights_id && ctx->rights_info.retrieved_tik && removeConsoleData && tiklessDump)
             {
                 // Generate new encrypted NCA key area using titlekey
-                if (!generateEncryptedNcaKeyAreaWithTitlekey(&dec_nca_header, xml_content_info[i].decrypted_nca_keys))
+                if (!generateEncryptedNcaKeyAreaWithTitlekey(&dec_nca_header, ctx->xml_content_info[i].decrypted_nca_keys))
                 {
                     proceed = false;
                     break;
@@ -1171,9 +1307,9 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 memset(dec_nca_header.rights_id, 0, 0x10);
                 
                 // Patch ACID pubkey and recreate NCA NPDM signature if we're dealing with the Program NCA
-                if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
+                if (ctx->xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
                 {
-                    if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
+                    if (!processProgramNca(&(ctx->ncmStorage), &ncaId, &dec_nca_header, &(ctx->xml_content_info[i]), &(ctx->ncaProgramMod), &(ctx->ncaProgramModCnt), i))
                     {
                         proceed = false;
                         break;
@@ -1182,10 +1318,10 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             }
         }
         
-        if ((!has_rights_id || (has_rights_id && rights_info.retrieved_tik)) && (xml_content_info[i].type == NcmContentType_Program || xml_content_info[i].type == NcmContentType_Control || xml_content_info[i].type == NcmContentType_LegalInformation))
+        if ((!has_rights_id || (has_rights_id && ctx->rights_info.retrieved_tik)) && (ctx->xml_content_info[i].type == NcmContentType_Program || ctx->xml_content_info[i].type == NcmContentType_Control || ctx->xml_content_info[i].type == NcmContentType_LegalInformation))
         {
             // Reallocate XML records
-            tmp_xml_rec = realloc(xml_records, (xml_rec_cnt + 1) * sizeof(xml_record_info));
+            tmp_xml_rec = realloc(ctx->xml_records, (ctx->xml_rec_cnt + 1) * sizeof(xml_record_info));
             if (!tmp_xml_rec)
             {
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: error reallocating XML records buffer!", __func__);
@@ -1193,1831 +1329,3837 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 break;
             }
             
-            xml_records = tmp_xml_rec;
+            ctx->xml_records = tmp_xml_rec;
             tmp_xml_rec = NULL;
             
-            memset(&(xml_records[xml_rec_cnt]), 0, sizeof(xml_record_info));
-            xml_records[xml_rec_cnt].nca_index = i;
+            memset(&(ctx->xml_records[ctx->xml_rec_cnt]), 0, sizeof(xml_record_info));
+            ctx->xml_records[ctx->xml_rec_cnt].nca_index = i;
+            
+            ctx->xml_rec_cnt++;
             
-            xml_rec_cnt++;
+            // Queue metadata extraction request
+            nspMetadataJob *metaJob = &(metaJobs[metaJobCnt++]);
+            metaJob->ncaIndex = i;
+            metaJob->recordIndex = (ctx->xml_rec_cnt - 1);
+            memcpy(&(metaJob->ncaId), &ncaId, sizeof(NcmContentId));
+            memcpy(&(metaJob->dec_header), &dec_nca_header, sizeof(nca_header_t));
             
-            // Generate programinfo.xml
-            if (xml_content_info[i].type == NcmContentType_Program)
+            // Use the custom ACID public key in programinfo.xml if the NPDM from this Program NCA gets patched
+            if (ctx->xml_content_info[i].type == NcmContentType_Program)
             {
-                bool use_acid_pubkey = false;
-                
-                for(j = 0; j < ncaProgramModCnt; j++)
+                for(j = 0; j < ctx->ncaProgramModCnt; j++)
                 {
-                    if (ncaProgramMod[j].nca_index == i)
+                    if (ctx->ncaProgramMod[j].nca_index == i)
                     {
-                        use_acid_pubkey = true;
+                        metaJob->useAcidPubKey = true;
                         break;
                     }
                 }
-                
-                if (!generateProgramInfoXml(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, use_acid_pubkey, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size)))
-                {
-                    proceed = false;
-                    break;
-                }
             }
+        }
+        
+        // Recreate the NPDM signature if we modified the Program NCA. Its header is reencrypted as soon as the signature is ready
+        if (ctx->ncaProgramModCnt && ctx->ncaProgramMod[ctx->ncaProgramModCnt - 1].nca_index == i && signJobs && !signJobs[i].input)
+        {
+            memcpy(&(signHeaders[i]), &dec_nca_header, sizeof(nca_header_t));
             
-            // Retrieve NACP data (XML and icons)
-            if (xml_content_info[i].type == NcmContentType_Control)
+            if (!rsa_sign_submit(&(signJobs[i]), &(signHeaders[i].magic), NPDM_SIGNATURE_AREA_SIZE, signHeaders[i].npdm_key_sig, NPDM_SIGNATURE_SIZE))
             {
-                if (!retrieveNacpDataFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size), &(xml_records[xml_rec_cnt - 1].nacp_icons), &(xml_records[xml_rec_cnt - 1].nacp_icon_cnt)))
-                {
-                    proceed = false;
-                    break;
-                }
+                proceed = false;
+                break;
             }
             
-            // Retrieve legalinfo.xml
-            if (xml_content_info[i].type == NcmContentType_LegalInformation)
-            {
-                if (!retrieveLegalInfoXmlFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size)))
-                {
-                    proceed = false;
-                    break;
-                }
-            }
+            continue;
         }
         
         // Reencrypt header
-        if (!encryptNcaHeader(&dec_nca_header, xml_content_info[i].encrypted_header_mod, NCA_FULL_HEADER_LENGTH))
+        if (!encryptNcaHeader(&dec_nca_header, ctx->xml_content_info[i].encrypted_header_mod, NCA_FULL_HEADER_LENGTH))
         {
             proceed = false;
             break;
         }
     }
     
-    if (!proceed) goto out;
+    // Generate programinfo.xml, the NACP XML + icons and legalinfo.xml
+    // The NPDM signatures keep being calculated in the background in the meantime
+    if (proceed && metaJobCnt && !runNspMetadataJobs(ctx, metaJobs, metaJobCnt)) proceed = false;
+    
+    free(metaJobs);
+    
+    if (signJobs)
+    {
+        // Every submitted request must be waited on before freeing the headers, even if something else already failed
+        for(j = 0; j < ctx->titleContentInfoCnt; j++)
+        {
+            if (!signJobs[j].input) continue;
+            
+            if (!rsa_sign_wait(&(signJobs[j])))
+            {
+                breaks++;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to recreate Program NCA NPDM signature!", __func__);
+                proceed = false;
+                continue;
+            }
+            
+            if (proceed && !encryptNcaHeader(&(signHeaders[j]), ctx->xml_content_info[j].encrypted_header_mod, NCA_FULL_HEADER_LENGTH)) proceed = false;
+        }
+        
+        free(signJobs);
+        free(signHeaders);
+    }
+    
+    if (!proceed) return false;
     
     if (proceed && !cnmtFound)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find CNMT NCA!", __func__);
-        goto out;
+        return false;
     }
     
     // Update NCA counter just in case we found any delta fragments and excluded them
-    titleContentInfoCnt = xml_program_info.nca_cnt;
+    ctx->titleContentInfoCnt = ctx->xml_program_info.nca_cnt;
     
     // Fill information for our CNMT XML
-    xml_content_info[titleContentInfoCnt - 1].type = titleContentInfos[cnmtNcaIndex].content_type;
-    memcpy(xml_content_info[titleContentInfoCnt - 1].nca_id, titleContentInfos[cnmtNcaIndex].content_id.c, SHA256_HASH_SIZE / 2); // Temporary
-    convertDataToHexString(titleContentInfos[cnmtNcaIndex].content_id.c, SHA256_HASH_SIZE / 2, xml_content_info[titleContentInfoCnt - 1].nca_id_str, SHA256_HASH_SIZE + 1); // Temporary
-    convertNcaSizeToU64(titleContentInfos[cnmtNcaIndex].size, &(xml_content_info[titleContentInfoCnt - 1].size));
-    xml_content_info[titleContentInfoCnt - 1].id_offset = titleContentInfos[cnmtNcaIndex].id_offset;
-    convertDataToHexString(xml_content_info[titleContentInfoCnt - 1].hash, SHA256_HASH_SIZE, xml_content_info[titleContentInfoCnt - 1].hash_str, (SHA256_HASH_SIZE * 2) + 1); // Temporary
-    
-    memcpy(&ncaId, &(titleContentInfos[cnmtNcaIndex].content_id), sizeof(NcmContentId));
+    ctx->xml_content_info[ctx->titleContentInfoCnt - 1].type = ctx->titleContentInfos[ctx->cnmtNcaIndex].content_type;
+    memcpy(ctx->xml_content_info[ctx->titleContentInfoCnt - 1].nca_id, ctx->titleContentInfos[ctx->cnmtNcaIndex].content_id.c, SHA256_HASH_SIZE / 2); // Temporary
+    convertDataToHexString(ctx->titleContentInfos[ctx->cnmtNcaIndex].content_id.c, SHA256_HASH_SIZE / 2, ctx->xml_content_info[ctx->titleContentInfoCnt - 1].nca_id_str, SHA256_HASH_SIZE + 1); // Temporary
+    convertNcaSizeToU64(ctx->titleContentInfos[ctx->cnmtNcaIndex].size, &(ctx->xml_content_info[ctx->titleContentInfoCnt - 1].size));
+    ctx->xml_content_info[ctx->titleContentInfoCnt - 1].id_offset = ctx->titleContentInfos[ctx->cnmtNcaIndex].id_offset;
+    convertDataToHexString(ctx->xml_content_info[ctx->titleContentInfoCnt - 1].hash, SHA256_HASH_SIZE, ctx->xml_content_info[ctx->titleContentInfoCnt - 1].hash_str, (SHA256_HASH_SIZE * 2) + 1); // Temporary
     
     // Update CNMT index
-    cnmtNcaIndex = (titleContentInfoCnt - 1);
-    
-    cnmtNcaBuf = malloc(xml_content_info[cnmtNcaIndex].size);
-    if (!cnmtNcaBuf)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for CNMT NCA data!", __func__);
-        goto out;
-    }
-    
-    if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size))
-    {
-        breaks++;
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read CNMT NCA \"%s\"!", __func__, xml_content_info[cnmtNcaIndex].nca_id_str);
-        goto out;
-    }
+    ctx->cnmtNcaIndex = (ctx->titleContentInfoCnt - 1);
     
     // Retrieve CNMT NCA data
-    if (!retrieveCnmtNcaData(curStorageId, cnmtNcaBuf, &xml_program_info, xml_content_info, cnmtNcaIndex, &ncaCnmtMod, &rights_info)) goto out;
+    // Only the regions we're gonna modify are kept in memory. The rest of the CNMT NCA is streamed from its content storage while dumping
+    if (!retrieveCnmtNcaData(curStorageId, &(ctx->ncmStorage), &(ctx->xml_program_info), ctx->xml_content_info, ctx->cnmtNcaIndex, &(ctx->ncaCnmtMod), &(ctx->rights_info))) return false;
     
     // Generate a placeholder CNMT XML. It's length will be used to calculate the final output dump size
     
     // Make sure that the output buffer for our CNMT XML is big enough
-    cnmtXml = calloc(NSP_XML_BUFFER_SIZE, sizeof(char));
-    if (!cnmtXml)
+    ctx->cnmtXml = calloc(NSP_XML_BUFFER_SIZE, sizeof(char));
+    if (!ctx->cnmtXml)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT XML!", __func__);
-        goto out;
+        return false;
     }
     
-    generateCnmtXml(&xml_program_info, xml_content_info, cnmtXml);
+    generateCnmtXml(&(ctx->xml_program_info), ctx->xml_content_info, ctx->cnmtXml);
     
-    bool includeTikAndCert = (rights_info.retrieved_tik && !tiklessDump);
+    ctx->includeTikAndCert = (ctx->rights_info.retrieved_tik && !tiklessDump);
     
-    if (includeTikAndCert)
+    if (ctx->includeTikAndCert)
     {
         // Only mess with the ticket data if removeConsoleData is true, if tiklessDump is false and if we're dealing with a personalized ticket (checked in removeConsoleDataFromTicket())
         // Ticket files from Patch titles bundled with gamecards always use common titlekey crypto
-        if ((curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser) && removeConsoleData) removeConsoleDataFromTicket(&rights_info);
+        if ((curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser || curStorageId == LOCAL_CONTENT_STORAGE_ID) && removeConsoleData) removeConsoleDataFromTicket(&(ctx->rights_info));
         
         // Retrieve cert file
-        if (!retrieveCertData(rights_info.cert_data, (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED)))
+        if (!retrieveCertData(ctx->rights_info.cert_data, (ctx->rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED)))
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-            goto out;
+            return false;
         }
-        
-        // File count = NCA count + CNMT XML + tik + cert
-        nspPfs0Header.file_cnt = (titleContentInfoCnt + 3);
-        
-        // Calculate PFS0 String Table size
-        nspPfs0StrTableSize = (((nspPfs0Header.file_cnt - 4) * NSP_NCA_FILENAME_LENGTH) + (NSP_CNMT_FILENAME_LENGTH * 2) + NSP_TIK_FILENAME_LENGTH + NSP_CERT_FILENAME_LENGTH);
-    } else {
-        // File count = NCA count + CNMT XML
-        nspPfs0Header.file_cnt = (titleContentInfoCnt + 1);
-        
-        // Calculate PFS0 String Table size
-        nspPfs0StrTableSize = (((nspPfs0Header.file_cnt - 2) * NSP_NCA_FILENAME_LENGTH) + (NSP_CNMT_FILENAME_LENGTH * 2));
     }
     
-    // Add our XML records
-    if (xml_rec_cnt)
+    return true;
+}
+
+static void freeNspTitleCtx(nspTitleCtx *ctx)
+{
+    if (!ctx) return;
+    
+    u32 i;
+    
+    if (ctx->cnmtXml) free(ctx->cnmtXml);
+    
+    if (ctx->ncaCnmtMod.hash_table) free(ctx->ncaCnmtMod.hash_table);
+    
+    if (ctx->ncaCnmtMod.block_data) free(ctx->ncaCnmtMod.block_data);
+    
+    dataOverlayListFree(&(ctx->ncaCnmtMod.overlays));
+    
+    if (ctx->ncaProgramMod)
     {
-        for(i = 0; i < xml_rec_cnt; i++)
+        for(i = 0; i < ctx->ncaProgramModCnt; i++)
         {
-            if (!xml_records[i].xml_data || !xml_records[i].xml_size) continue;
-            
-            nspPfs0Header.file_cnt++;
-            u8 type = xml_content_info[xml_records[i].nca_index].type;
-            nspPfs0StrTableSize += (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
-            progressCtx.totalSize += xml_records[i].xml_size;
-            
-            // Add icons if we retrieved them
-            if (type == NcmContentType_Control && xml_records[i].nacp_icons && xml_records[i].nacp_icon_cnt)
-            {
-                for(j = 0; j < xml_records[i].nacp_icon_cnt; j++)
-                {
-                    nspPfs0Header.file_cnt++;
-                    nspPfs0StrTableSize += (u32)(strlen(xml_records[i].nacp_icons[j].filename) + 1);
-                    progressCtx.totalSize += xml_records[i].nacp_icons[j].icon_size;
-                }
-            }
+            if (ctx->ncaProgramMod[i].hash_table) free(ctx->ncaProgramMod[i].hash_table);
+            if (ctx->ncaProgramMod[i].block_data[0]) free(ctx->ncaProgramMod[i].block_data[0]);
+            if (ctx->ncaProgramMod[i].block_data[1]) free(ctx->ncaProgramMod[i].block_data[1]);
         }
+        
+        free(ctx->ncaProgramMod);
     }
     
-    // Start NSP creation
-    nspPfs0EntryTable = calloc(nspPfs0Header.file_cnt, sizeof(pfs0_file_entry));
-    if (!nspPfs0EntryTable)
+    if (ctx->xml_records)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file entries!", __func__);
-        goto out;
+        for(i = 0; i < ctx->xml_rec_cnt; i++)
+        {
+            if (ctx->xml_records[i].xml_data) free(ctx->xml_records[i].xml_data);
+            if (ctx->xml_records[i].nacp_icons) free(ctx->xml_records[i].nacp_icons);
+        }
+        
+        free(ctx->xml_records);
     }
     
-    // Make sure we have enough space
-    nspPfs0StrTable = calloc(nspPfs0StrTableSize * 2, sizeof(char));
-    if (!nspPfs0StrTable)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 string table!", __func__);
-        goto out;
-    }
+    if (ctx->xml_content_info) free(ctx->xml_content_info);
     
-    // Determine our full NSP header size
-    fullPfs0HeaderSize = (sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry)) + nspPfs0StrTableSize);
+    ncmContentStorageClose(&(ctx->ncmStorage));
     
-    // Round up our full NSP header size to a 0x10-byte boundary
-    if (!(fullPfs0HeaderSize % 0x10)) fullPfs0HeaderSize++; // If it's already rounded, add more padding
-    fullPfs0HeaderSize = round_up(fullPfs0HeaderSize, 0x10);
+    if (ctx->titleContentInfos) free(ctx->titleContentInfos);
     
-    // Determine our String Table size
-    nspPfs0Header.str_table_size = (fullPfs0HeaderSize - (sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry))));
+    memset(ctx, 0, sizeof(nspTitleCtx));
+}
+
+// Builds the overlay list used to patch a NCA while it's being streamed: the modified NCA header, plus the modified Program NCA blocks (if available)
+static bool buildNcaOverlayList(dataOverlayList *overlays, cnmt_xml_content_info *content_info, nca_program_mod_data *programMod)
+{
+    if (!overlays || !content_info) return false;
     
-    // Allocate memory for PFS0 file data pointer array. Exclude all NCAs but the CNMT NCA
-    nspPfs0FilePtrs = calloc(nspPfs0Header.file_cnt - (titleContentInfoCnt - 1), sizeof(u8*));
-    if (!nspPfs0FilePtrs)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file data pointer array!", __func__);
-        goto out;
-    }
+    dataOverlayListClear(overlays);
     
-    // Fill PFS0 entry table
-    // PFS0 string table will be filled at a later time
-    u64 curFileOffset = 0;
-    u32 curFilenameOffset = 0;
+    if (!dataOverlayListAdd(overlays, 0, content_info->encrypted_header_mod, NCA_FULL_HEADER_LENGTH)) return false;
+    
+    if (!programMod) return true;
+    
+    if (!dataOverlayListAdd(overlays, programMod->hash_table_offset, programMod->hash_table, programMod->hash_table_size)) return false;
+    
+    if (!dataOverlayListAdd(overlays, programMod->block_offset[0], programMod->block_data[0], programMod->block_size[0])) return false;
     
-    u64 entrySize = 0;
-    u32 entryFilenameSize = 0;
+    if (programMod->block_mod_cnt == 2 && !dataOverlayListAdd(overlays, programMod->block_offset[1], programMod->block_data[1], programMod->block_size[1])) return false;
     
-    u32 entryIdx = 0, ptrIdx = 0;
+    return true;
+}
+
+typedef struct {
+    bool used;
+    bool ready;                                     // Cleared while the slot is being filled by the worker thread
+    u32 entryIndex;                                 // Batch entry the data belongs to
+    NcmContentId ncaId;
+    u64 offset;                                     // Content offset of the data that hasn't been taken yet
+    u64 size;                                       // Size of the data that hasn't been taken yet
+    u64 consumed;                                   // Amount of data already taken from the start of the slot buffer
+    u8 *data;
+} batchReadAheadSlot;
+
+// Reads NCA data from an upcoming batch entry stored on a different storage device than the title currently being dumped
+// The read data is stored in a fixed amount of slots, which are consumed by writeNspPfs0Entries() once it reaches that title
+typedef struct {
+    pthread_t thread;
+    bool threadCreated;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool exit;
+    bool active;                                    // Set while there's data left to read from the current target
+    bool dumpDeltaFragments;
+    u32 entryIndex;                                 // Current target
+    NcmStorageId storageId;
+    NcmContentInfo *contentInfos;
+    u32 contentInfoCnt;
+    u32 contentIndex;                               // Next content to read from
+    u64 contentOffset;                              // Next offset to read from the current content
+    NcmStorageId openStorageId;                     // Storage opened by the worker thread. Only accessed by the worker thread
+    NcmContentStorage ncmStorage;
+    batchReadAheadSlot slots[BATCH_READ_AHEAD_SLOT_CNT];
+} batchReadAheadCtx;
+
+// Only set while a batch dump is running
+static batchReadAheadCtx *nspReadAhead = NULL;
+
+static batchReadAheadSlot *batchReadAheadGetFreeSlot(batchReadAheadCtx *ctx)
+{
+    u32 i;
     
-    for(i = 0; i <= titleContentInfoCnt; i++, entryIdx++)
+    for(i = 0; i < BATCH_READ_AHEAD_SLOT_CNT; i++)
     {
-        if (i < titleContentInfoCnt)
-        {
-            // Always reserve the first titleContentInfoCnt entries for our NCAs
-            // Only save the CNMT NCA buffer pointer to the PFS0 file data pointer array. We don't have any other pointers to raw NCA data, so we leave the rest untouched
-            entrySize = xml_content_info[i].size;
-            entryFilenameSize = (i == cnmtNcaIndex ? NSP_CNMT_FILENAME_LENGTH : NSP_NCA_FILENAME_LENGTH);
-            if (i == cnmtNcaIndex) nspPfs0FilePtrs[ptrIdx++] = cnmtNcaBuf;
-        } else {
-            // Reserve the entry right after our NCAs for the CNMT XML
-            entrySize = strlen(cnmtXml);
-            entryFilenameSize = NSP_CNMT_FILENAME_LENGTH;
-            nspPfs0FilePtrs[ptrIdx++] = (u8*)cnmtXml;
-        }
-        
-        nspPfs0EntryTable[i].file_size = entrySize;
-        nspPfs0EntryTable[i].file_offset = curFileOffset;
-        nspPfs0EntryTable[i].filename_offset = curFilenameOffset;
-        
-        curFileOffset += entrySize;
-        curFilenameOffset += entryFilenameSize;
+        if (!ctx->slots[i].used) return &(ctx->slots[i]);
     }
     
-    for(i = 0; i < xml_rec_cnt; i++, entryIdx++)
+    return NULL;
+}
+
+static void *batchReadAheadThreadFunc(void *arg)
+{
+    batchReadAheadCtx *ctx = (batchReadAheadCtx*)arg;
+    
+    batchReadAheadSlot *slot = NULL;
+    NcmContentInfo *contentInfo = NULL;
+    u64 contentSize = 0;
+    Result result;
+    
+    pthread_mutex_lock(&(ctx->mutex));
+    
+    while(!ctx->exit)
     {
-        u8 type = xml_content_info[xml_records[i].nca_index].type;
+        slot = NULL;
         
-        if (type == NcmContentType_Control && xml_records[i].nacp_icons && xml_records[i].nacp_icon_cnt)
+        if (ctx->active)
         {
-            // Process all icons at once
-            for(j = 0; j < xml_records[i].nacp_icon_cnt; j++, entryIdx++)
+            // The CNMT NCA is patched while it's being dumped, and Delta Fragments may not be dumped at all
+            while(ctx->contentIndex < ctx->contentInfoCnt)
             {
-                entrySize = xml_records[i].nacp_icons[j].icon_size;
-                entryFilenameSize = (u32)(strlen(xml_records[i].nacp_icons[j].filename) + 1); // This is the only entry type with variable filename length
-                nspPfs0FilePtrs[ptrIdx++] = xml_records[i].nacp_icons[j].icon_data;
+                contentInfo = &(ctx->contentInfos[ctx->contentIndex]);
+                convertNcaSizeToU64(contentInfo->size, &contentSize);
                 
-                nspPfs0EntryTable[entryIdx].file_size = entrySize;
-                nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
-                nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
+                if (contentInfo->content_type != NcmContentType_Meta && (contentInfo->content_type != NcmContentType_DeltaFragment || ctx->dumpDeltaFragments) && ctx->contentOffset < contentSize) break;
                 
-                curFileOffset += entrySize;
-                curFilenameOffset += entryFilenameSize;
+                ctx->contentIndex++;
+                ctx->contentOffset = 0;
+            }
+            
+            if (ctx->contentIndex < ctx->contentInfoCnt)
+            {
+                slot = batchReadAheadGetFreeSlot(ctx);
+            } else {
+                ctx->active = false;
             }
         }
         
-        // XML entry
-        entrySize = xml_records[i].xml_size;
-        entryFilenameSize = (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
-        nspPfs0FilePtrs[ptrIdx++] = (u8*)xml_records[i].xml_data;
-        
-        nspPfs0EntryTable[entryIdx].file_size = entrySize;
-        nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
-        nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
+        if (!slot)
+        {
+            pthread_cond_wait(&(ctx->cond), &(ctx->mutex));
+            continue;
+        }
         
-        curFileOffset += entrySize;
-        curFilenameOffset += entryFilenameSize;
-    }
-    
-    if (includeTikAndCert)
-    {
-        for(i = 0; i < 2; i++, entryIdx++)
+        if (ctx->openStorageId != ctx->storageId)
         {
-            entrySize = (i == 0 ? ETICKET_TIK_FILE_SIZE : ETICKET_CERT_FILE_SIZE);
-            entryFilenameSize = (i == 0 ? NSP_TIK_FILENAME_LENGTH : NSP_CERT_FILENAME_LENGTH);
-            nspPfs0FilePtrs[ptrIdx++] = (i == 0 ? (u8*)(&(rights_info.tik_data)) : rights_info.cert_data);
+            ncmContentStorageClose(&(ctx->ncmStorage));
+            ctx->openStorageId = NcmStorageId_None;
             
-            nspPfs0EntryTable[entryIdx].file_size = entrySize;
-            nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
-            nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
+            result = ncmLocalOpenContentStorage(&(ctx->ncmStorage), ctx->storageId);
+            if (R_FAILED(result))
+            {
+                // The title is read directly by dumpNintendoSubmissionPackage() instead
+                ctx->active = false;
+                continue;
+            }
             
-            curFileOffset += entrySize;
-            curFilenameOffset += entryFilenameSize;
+            ctx->openStorageId = ctx->storageId;
+        }
+        
+        slot->used = true;
+        slot->ready = false;
+        slot->entryIndex = ctx->entryIndex;
+        memcpy(&(slot->ncaId), &(contentInfo->content_id), sizeof(NcmContentId));
+        slot->offset = ctx->contentOffset;
+        slot->consumed = 0;
+        slot->size = ((contentSize - ctx->contentOffset) > DUMP_BUFFER_SIZE ? DUMP_BUFFER_SIZE : (contentSize - ctx->contentOffset));
+        
+        ctx->contentOffset += slot->size;
+        
+        // Read the data without holding the lock
+        pthread_mutex_unlock(&(ctx->mutex));
+        result = ncmLocalContentStorageReadContentIdFile(&(ctx->ncmStorage), slot->data, slot->size, &(slot->ncaId), slot->offset);
+        pthread_mutex_lock(&(ctx->mutex));
+        
+        if (R_SUCCEEDED(result))
+        {
+            slot->ready = true;
+        } else {
+            // Read errors are reported by dumpNintendoSubmissionPackage() when it reads the data by itself
+            slot->used = false;
+            if (slot->entryIndex == ctx->entryIndex) ctx->active = false;
         }
+        
+        pthread_cond_broadcast(&(ctx->cond));
     }
     
-    // Calculate total dump size
-    progressCtx.totalSize += fullPfs0HeaderSize;
-    for(i = 0; i < titleContentInfoCnt; i++) progressCtx.totalSize += xml_content_info[i].size;
-    progressCtx.totalSize += strlen(cnmtXml);
-    if (includeTikAndCert) progressCtx.totalSize += (ETICKET_TIK_FILE_SIZE + ETICKET_CERT_FILE_SIZE);
+    ncmContentStorageClose(&(ctx->ncmStorage));
     
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    pthread_mutex_unlock(&(ctx->mutex));
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total NSP dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    uiRefreshDisplay();
-    breaks += 2;
+    return NULL;
+}
+
+static bool batchReadAheadInit(batchReadAheadCtx *ctx, bool dumpDeltaFragments)
+{
+    u32 i;
     
-    if (!batch)
+    memset(ctx, 0, sizeof(batchReadAheadCtx));
+    
+    ctx->dumpDeltaFragments = dumpDeltaFragments;
+    ctx->openStorageId = NcmStorageId_None;
+    
+    for(i = 0; i < BATCH_READ_AHEAD_SLOT_CNT; i++)
     {
-        if (seqDumpMode)
+        ctx->slots[i].data = malloc(DUMP_BUFFER_SIZE);
+        if (!ctx->slots[i].data) goto error;
+    }
+    
+    pthread_mutex_init(&(ctx->mutex), NULL);
+    pthread_cond_init(&(ctx->cond), NULL);
+    
+    ctx->threadCreated = (pthread_create(&(ctx->thread), NULL, &batchReadAheadThreadFunc, ctx) == 0);
+    if (!ctx->threadCreated)
+    {
+        pthread_cond_destroy(&(ctx->cond));
+        pthread_mutex_destroy(&(ctx->mutex));
+        goto error;
+    }
+    
+    return true;
+    
+error:
+    for(i = 0; i < BATCH_READ_AHEAD_SLOT_CNT; i++)
+    {
+        if (ctx->slots[i].data) free(ctx->slots[i].data);
+    }
+    
+    memset(ctx, 0, sizeof(batchReadAheadCtx));
+    
+    return false;
+}
+
+static void batchReadAheadFree(batchReadAheadCtx *ctx)
+{
+    if (!ctx->threadCreated) return;
+    
+    u32 i;
+    
+    pthread_mutex_lock(&(ctx->mutex));
+    ctx->exit = true;
+    pthread_cond_broadcast(&(ctx->cond));
+    pthread_mutex_unlock(&(ctx->mutex));
+    
+    pthread_join(ctx->thread, NULL);
+    
+    pthread_cond_destroy(&(ctx->cond));
+    pthread_mutex_destroy(&(ctx->mutex));
+    
+    for(i = 0; i < BATCH_READ_AHEAD_SLOT_CNT; i++)
+    {
+        if (ctx->slots[i].data) free(ctx->slots[i].data);
+    }
+    
+    if (ctx->contentInfos) free(ctx->contentInfos);
+    
+    memset(ctx, 0, sizeof(batchReadAheadCtx));
+}
+
+// Switches the worker thread to a new batch entry. Takes ownership of the provided content records
+// Data already read from the previous target stays available until it's consumed or discarded
+static void batchReadAheadSetTarget(batchReadAheadCtx *ctx, u32 entryIndex, NcmStorageId storageId, NcmContentInfo *contentInfos, u32 contentInfoCnt)
+{
+    pthread_mutex_lock(&(ctx->mutex));
+    
+    if (ctx->contentInfos) free(ctx->contentInfos);
+    
+    ctx->entryIndex = entryIndex;
+    ctx->storageId = storageId;
+    ctx->contentInfos = contentInfos;
+    ctx->contentInfoCnt = contentInfoCnt;
+    ctx->contentIndex = 0;
+    ctx->contentOffset = 0;
+    ctx->active = true;
+    
+    pthread_cond_broadcast(&(ctx->cond));
+    pthread_mutex_unlock(&(ctx->mutex));
+}
+
+// Discards all the data read from a batch entry
+static void batchReadAheadDiscard(batchReadAheadCtx *ctx, u32 entryIndex)
+{
+    u32 i;
+    bool pending;
+    
+    pthread_mutex_lock(&(ctx->mutex));
+    
+    if (ctx->active && ctx->entryIndex == entryIndex) ctx->active = false;
+    
+    do {
+        pending = false;
+        
+        for(i = 0; i < BATCH_READ_AHEAD_SLOT_CNT; i++)
         {
-            // Check if the current offset doesn't exceed the total NSP size
-            if (progressCtx.curOffset >= progressCtx.totalSize)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP offset in the sequential dump reference file!", __func__);
-                goto out;
-            }
+            if (!ctx->slots[i].used || ctx->slots[i].entryIndex != entryIndex) continue;
             
-            // Check if the NCA count is valid
-            // The CNMT NCA is excluded from the hash list
-            if (seqNspCtx.ncaCount != (titleContentInfoCnt - 1))
+            if (ctx->slots[i].ready)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.ncaCount, titleContentInfoCnt - 1);
-                goto out;
+                ctx->slots[i].used = false;
+            } else {
+                pending = true;
             }
+        }
+        
+        if (pending) pthread_cond_wait(&(ctx->cond), &(ctx->mutex));
+    } while(pending);
+    
+    pthread_cond_broadcast(&(ctx->cond));
+    pthread_mutex_unlock(&(ctx->mutex));
+}
+
+// Copies NCA data from the read-ahead slots, if available
+// Slots from the same NCA that are placed before the requested offset were skipped by the dump (e.g. resumed dumps), so they're released
+static bool batchReadAheadTake(batchReadAheadCtx *ctx, const NcmContentId *ncaId, u64 offset, void *outBuf, u64 size)
+{
+    u32 i;
+    bool found = false, pending;
+    
+    pthread_mutex_lock(&(ctx->mutex));
+    
+    do {
+        pending = false;
+        
+        for(i = 0; i < BATCH_READ_AHEAD_SLOT_CNT; i++)
+        {
+            batchReadAheadSlot *slot = &(ctx->slots[i]);
+            if (!slot->used || memcmp(slot->ncaId.c, ncaId->c, sizeof(NcmContentId)) != 0) continue;
             
-            // Check if the Program NCA mod count is valid
-            if (seqNspCtx.programNcaModCount != ncaProgramModCnt)
+            if (!slot->ready)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: Program NCA mod count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.programNcaModCount, ncaProgramModCnt);
-                goto out;
+                // Wait for the worker thread if it's currently reading the requested block
+                if (slot->offset == offset) pending = true;
+                continue;
             }
             
-            // Check if the PFS0 file count is valid
-            if (seqNspCtx.pfs0FileCount != nspPfs0Header.file_cnt)
+            if ((slot->offset + slot->size) <= offset)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: PFS0 file count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.pfs0FileCount, nspPfs0Header.file_cnt);
-                goto out;
+                slot->used = false;
+                continue;
             }
             
-            // Check if the current PFS0 file index is valid
-            if (seqNspCtx.fileIndex >= nspPfs0Header.file_cnt)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid PFS0 file index in the sequential dump reference file!", __func__);
-                goto out;
-            }
+            if (slot->offset != offset || slot->size < size) continue;
             
-            // Check if we're really dealing with a title with a missing ticket if preInstall == true
-            if (seqNspCtx.preInstall && !rights_info.missing_tik)
+            memcpy(outBuf, slot->data + slot->consumed, size);
+            
+            if (slot->size > size)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title preinstall status in the sequential dump reference file!", __func__);
-                goto out;
+                // Keep the rest of the block for the next read
+                slot->consumed += size;
+                slot->offset += size;
+                slot->size -= size;
+            } else {
+                slot->used = false;
             }
             
-            // Check if the current overall offset is aligned to SPLIT_FILE_SEQUENTIAL_SIZE
-            u64 curNspOffset = fullPfs0HeaderSize;
-            for(i = 0; i < seqNspCtx.fileIndex; i++) curNspOffset += nspPfs0EntryTable[i].file_size;
-            curNspOffset += seqNspCtx.fileOffset;
+            found = true;
+            break;
+        }
+        
+        if (!found && pending) pthread_cond_wait(&(ctx->cond), &(ctx->mutex));
+    } while(!found && pending);
+    
+    pthread_cond_broadcast(&(ctx->cond));
+    pthread_mutex_unlock(&(ctx->mutex));
+    
+    return found;
+}
+
+// PFS0 layout for regular and bundled NSP dumps
+// Each title keeps the same entry layout: NCAs (CNMT NCA at the end), CNMT XML, XML records + icons, ticket and certificate chain
+typedef struct {
+    nspTitleCtx *titles;
+    u32 titleCnt;
+    pfs0_header header;
+    pfs0_file_entry *entryTable;
+    char *strTable;                                 // Filled by fillNspPfs0StrTable() once the CNMT NCA from each title has been patched
+    u64 fullHeaderSize;                             // PFS0 header + entry table + string table, padded to a 0x10-byte boundary
+    u64 dataSize;                                   // Combined size of all PFS0 entries
+    u8 **filePtrs;                                  // Data pointer for each PFS0 entry. NULL for NCAs, which are read from their content storage
+    u32 *entryTitles;                               // Title index for each PFS0 entry
+    u32 *titleFirstEntries;                         // First PFS0 entry index for each title
+} nspPfs0Layout;
+
+// Dump state used by writeNspPfs0Entries() and writeNspPfs0Header()
+typedef struct {
+    nspPfs0Layout *layout;
+    outputWriter *writer;
+    progress_ctx_t *progressCtx;
+    bool resume;                                    // Set if the dump is being resumed from resumeFileIndex / resumeFileOffset
+    u32 resumeFileIndex;
+    u64 resumeFileOffset;
+    Sha256Context hashCtx;                          // Current NCA SHA-256 checksum context. Must hold the saved context if a NCA is being resumed
+    u8 *ncaHashes;                                  // SHA-256 checksums from the dumped NCAs, indexed by PFS0 entry. Checksums from already dumped NCAs are restored from here if resuming
+    dumpJournal *journal;
+    dumpJournalType journalType;                    // DUMP_JOURNAL_TYPE_NSP (sequentialNspCtx state) or DUMP_JOURNAL_TYPE_NSP_BUNDLE (bundleNspJournalCtx state)
+    u8 *journalState;                               // NULL if the dump progress isn't being journaled
+    u32 journalStateSize;
+    bool seqDumpMode;
+    u8 seqPartNumber;                               // First part number written during this sequential dump session
+    u64 partSize;
+    u64 seqDumpSessionOffset;                       // Amount of data written during this sequential dump session
+    bool seqDumpFinish;                             // Set once the current sequential dump session can't hold any more data
+    u32 fileIndex;                                  // PFS0 entry index / offset reached by writeNspPfs0Entries()
+    u64 fileOffset;
+    bool canceled;
+} nspPfs0Stream;
+
+static void freeNspPfs0Layout(nspPfs0Layout *layout)
+{
+    if (!layout) return;
+    
+    if (layout->titleFirstEntries) free(layout->titleFirstEntries);
+    
+    if (layout->entryTitles) free(layout->entryTitles);
+    
+    if (layout->filePtrs) free(layout->filePtrs);
+    
+    if (layout->strTable) free(layout->strTable);
+    
+    if (layout->entryTable) free(layout->entryTable);
+    
+    memset(layout, 0, sizeof(nspPfs0Layout));
+}
+
+static bool buildNspPfs0Layout(nspPfs0Layout *layout, nspTitleCtx *titles, u32 titleCnt)
+{
+    if (!layout || !titles || !titleCnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to build the PFS0 layout!", __func__);
+        return false;
+    }
+    
+    u32 i, j, k;
+    u64 strTableSize = 0;
+    
+    memset(layout, 0, sizeof(nspPfs0Layout));
+    
+    layout->titles = titles;
+    layout->titleCnt = titleCnt;
+    layout->header.magic = __builtin_bswap32(PFS0_MAGIC);
+    
+    layout->titleFirstEntries = calloc(titleCnt, sizeof(u32));
+    if (!layout->titleFirstEntries)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the title entry indexes!", __func__);
+        return false;
+    }
+    
+    // Calculate the PFS0 file count and string table size
+    for(i = 0; i < titleCnt; i++)
+    {
+        nspTitleCtx *ctx = &(titles[i]);
+        
+        layout->titleFirstEntries[i] = layout->header.file_cnt;
+        
+        // NCA count + CNMT XML
+        layout->header.file_cnt += (ctx->titleContentInfoCnt + 1);
+        strTableSize += (((ctx->titleContentInfoCnt - 1) * NSP_NCA_FILENAME_LENGTH) + (NSP_CNMT_FILENAME_LENGTH * 2));
+        
+        for(j = 0; j < ctx->xml_rec_cnt; j++)
+        {
+            if (!ctx->xml_records[j].xml_data || !ctx->xml_records[j].xml_size) continue;
+            
+            u8 type = ctx->xml_content_info[ctx->xml_records[j].nca_index].type;
             
-            if (curNspOffset != progressCtx.curOffset)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: overall NSP dump offset isn't aligned to 0x%08X in the sequential dump reference file!", __func__, (u32)SPLIT_FILE_SEQUENTIAL_SIZE);
-                goto out;
-            }
+            layout->header.file_cnt++;
+            strTableSize += (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
             
-            // Check if there's enough free space to continue the sequential dump process
-            u64 restSize = (progressCtx.totalSize - curNspOffset);
-            if (progressCtx.totalSize > freeSpace && ((restSize > SPLIT_FILE_SEQUENTIAL_SIZE && freeSpace < SPLIT_FILE_SEQUENTIAL_SIZE) || (restSize <= SPLIT_FILE_SEQUENTIAL_SIZE && freeSpace < restSize)))
+            if (type == NcmContentType_Control && ctx->xml_records[j].nacp_icons && ctx->xml_records[j].nacp_icon_cnt)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-                goto out;
+                for(k = 0; k < ctx->xml_records[j].nacp_icon_cnt; k++)
+                {
+                    layout->header.file_cnt++;
+                    strTableSize += (u32)(strlen(ctx->xml_records[j].nacp_icons[k].filename) + 1);
+                }
             }
+        }
+        
+        if (ctx->includeTikAndCert)
+        {
+            layout->header.file_cnt += 2;
+            strTableSize += (NSP_TIK_FILENAME_LENGTH + NSP_CERT_FILENAME_LENGTH);
+        }
+    }
+    
+    layout->entryTable = calloc(layout->header.file_cnt, sizeof(pfs0_file_entry));
+    layout->filePtrs = calloc(layout->header.file_cnt, sizeof(u8*));
+    layout->entryTitles = calloc(layout->header.file_cnt, sizeof(u32));
+    if (!layout->entryTable || !layout->filePtrs || !layout->entryTitles)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file entries!", __func__);
+        return false;
+    }
+    
+    // Make sure we have enough space
+    layout->strTable = calloc(strTableSize * 2, sizeof(char));
+    if (!layout->strTable)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 string table!", __func__);
+        return false;
+    }
+    
+    // Determine our full NSP header size
+    layout->fullHeaderSize = (sizeof(pfs0_header) + ((u64)layout->header.file_cnt * sizeof(pfs0_file_entry)) + strTableSize);
+    
+    // Round up our full NSP header size to a 0x10-byte boundary
+    if (!(layout->fullHeaderSize % 0x10)) layout->fullHeaderSize++; // If it's already rounded, add more padding
+    layout->fullHeaderSize = round_up(layout->fullHeaderSize, 0x10);
+    
+    // Determine our String Table size
+    layout->header.str_table_size = (layout->fullHeaderSize - (sizeof(pfs0_header) + ((u64)layout->header.file_cnt * sizeof(pfs0_file_entry))));
+    
+    // Fill PFS0 entry table
+    // PFS0 string table will be filled at a later time
+    pfs0_file_entry *entryTable = layout->entryTable;
+    u64 curFileOffset = 0;
+    u32 curFilenameOffset = 0;
+    u32 entryIdx = 0;
+    
+    for(i = 0; i < titleCnt; i++)
+    {
+        nspTitleCtx *ctx = &(titles[i]);
+        
+        for(j = 0; j <= ctx->titleContentInfoCnt; j++, entryIdx++)
+        {
+            layout->entryTitles[entryIdx] = i;
             
-            // Now check if the current PFS0 file entry offset is correct
-            if (seqNspCtx.fileOffset >= nspPfs0EntryTable[seqNspCtx.fileIndex].file_size)
+            if (j < ctx->titleContentInfoCnt)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid offset for current PFS0 file entry in the sequential dump reference file!", __func__);
-                goto out;
+                entryTable[entryIdx].file_size = ctx->xml_content_info[j].size;
+                entryTable[entryIdx].filename_offset = curFilenameOffset;
+                curFilenameOffset += (j == ctx->cnmtNcaIndex ? NSP_CNMT_FILENAME_LENGTH : NSP_NCA_FILENAME_LENGTH);
+            } else {
+                entryTable[entryIdx].file_size = strlen(ctx->cnmtXml);
+                entryTable[entryIdx].filename_offset = curFilenameOffset;
+                curFilenameOffset += NSP_CNMT_FILENAME_LENGTH;
+                layout->filePtrs[entryIdx] = (u8*)ctx->cnmtXml;
             }
             
-            // Copy previously calculated NCA IDs and hashes
-            for(i = 0; i < seqNspCtx.fileIndex; i++)
-            {
-                // Exit loop if we reach the CNMT NCA
-                // Its ID/hash calculation is always handled by patchCnmtNca()
-                if (i >= (titleContentInfoCnt - 1)) break;
-                
-                // Fill information for our CNMT XML
-                memcpy(xml_content_info[i].nca_id, seqDumpNcaHashes + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE / 2);
-                convertDataToHexString(xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1);
-                memcpy(xml_content_info[i].hash, seqDumpNcaHashes + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE);
-                convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1);
-            }
+            entryTable[entryIdx].file_offset = curFileOffset;
+            curFileOffset += entryTable[entryIdx].file_size;
+        }
+        
+        for(j = 0; j < ctx->xml_rec_cnt; j++)
+        {
+            if (!ctx->xml_records[j].xml_data || !ctx->xml_records[j].xml_size) continue;
             
-            // Copy the NCA SHA-256 context data, but only if we're not dealing with the CNMT NCA
-            if (seqNspCtx.fileIndex < (titleContentInfoCnt - 1)) memcpy(&nca_hash_ctx, &(seqNspCtx.hashCtx), sizeof(Sha256Context));
+            u8 type = ctx->xml_content_info[ctx->xml_records[j].nca_index].type;
             
-            // Restore the modified Program NCA headers
-            // The NPDM signature from the NCA headers is generated using cryptographically secure random numbers, so the modified header is stored during the first sequential dump session
-            // If needed, it must be restored in later sessions
-            for(i = 0; i < ncaProgramModCnt; i++)
+            if (type == NcmContentType_Control && ctx->xml_records[j].nacp_icons && ctx->xml_records[j].nacp_icon_cnt)
             {
-                read_res = fread(xml_content_info[ncaProgramMod[i].nca_index].encrypted_header_mod, 1, NCA_FULL_HEADER_LENGTH, seqDumpFile);
-                if (read_res != NCA_FULL_HEADER_LENGTH)
+                for(k = 0; k < ctx->xml_records[j].nacp_icon_cnt; k++, entryIdx++)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, NCA_FULL_HEADER_LENGTH, read_res);
-                    goto out;
-                }
+                    layout->entryTitles[entryIdx] = i;
+                    layout->filePtrs[entryIdx] = ctx->xml_records[j].nacp_icons[k].icon_data;
+                    
+                    entryTable[entryIdx].file_size = ctx->xml_records[j].nacp_icons[k].icon_size;
+                    entryTable[entryIdx].file_offset = curFileOffset;
+                    entryTable[entryIdx].filename_offset = curFilenameOffset;
+                    
+                    curFileOffset += entryTable[entryIdx].file_size;
+                    curFilenameOffset += (u32)(strlen(ctx->xml_records[j].nacp_icons[k].filename) + 1); // This is the only entry type with variable filename length
+                }
             }
             
-            rewind(seqDumpFile);
+            layout->entryTitles[entryIdx] = i;
+            layout->filePtrs[entryIdx] = (u8*)ctx->xml_records[j].xml_data;
             
-            // Inform that we are resuming an already started sequential dump operation
-            if (curStorageId == NcmStorageId_GameCard)
-            {
-                if (selectedNspDumpType == DUMP_APP_NSP)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Change NPDM RSA key/sig in Program NCA: %s.", (npdmAcidRsaPatch ? "Yes" : "No"));
-                } else
-                if (selectedNspDumpType == DUMP_PATCH_NSP)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
-                } else
-                if (selectedNspDumpType == DUMP_ADDON_NSP)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation.");
-                }
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
-                breaks++;
-                
-                if (selectedNspDumpType == DUMP_APP_NSP || selectedNspDumpType == DUMP_PATCH_NSP)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
-                } else
-                if (selectedNspDumpType == DUMP_ADDON_NSP)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"));
-                }
-            }
+            entryTable[entryIdx].file_size = ctx->xml_records[j].xml_size;
+            entryTable[entryIdx].file_offset = curFileOffset;
+            entryTable[entryIdx].filename_offset = curFilenameOffset;
             
-            breaks++;
-        } else {
-            if (progressCtx.totalSize > freeSpace)
+            curFileOffset += entryTable[entryIdx].file_size;
+            curFilenameOffset += (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
+            
+            entryIdx++;
+        }
+        
+        if (ctx->includeTikAndCert)
+        {
+            for(j = 0; j < 2; j++, entryIdx++)
             {
-                // Check if we have enough free space
-                // The CNMT NCA is excluded from the hash list
-                seqDumpFileSize = (sizeof(sequentialNspCtx) + ((titleContentInfoCnt - 1) * SHA256_HASH_SIZE) + (ncaProgramModCnt * NCA_FULL_HEADER_LENGTH));
-                if (freeSpace < (SPLIT_FILE_SEQUENTIAL_SIZE + seqDumpFileSize))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-                    goto out;
-                }
-                
-                // Ask the user if they want to use the sequential dump mode
-                int cur_breaks = breaks;
-                
-                if (!yesNoPrompt("There's not enough space available to generate a whole dump in this session. Do you want to use sequential dumping?\nIn this mode, the selected content will be dumped in more than one session.\nYou'll have to transfer the generated part files to a PC before continuing the process in the next session."))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                    goto out;
-                }
-                
-                // Remove the prompt from the screen
-                breaks = cur_breaks;
-                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
-                uiRefreshDisplay();
+                layout->entryTitles[entryIdx] = i;
+                layout->filePtrs[entryIdx] = (j == 0 ? (u8*)(&(ctx->rights_info.tik_data)) : ctx->rights_info.cert_data);
                 
-                // Modify config parameters
-                isFat32 = true;
-                partSize = SPLIT_FILE_SEQUENTIAL_SIZE;
-                seqDumpMode = true;
-                
-                // Fill information in our sequential context
-                seqNspCtx.storageId = curStorageId;
-                seqNspCtx.removeConsoleData = removeConsoleData;
-                seqNspCtx.tiklessDump = tiklessDump;
-                seqNspCtx.npdmAcidRsaPatch = npdmAcidRsaPatch;
-                seqNspCtx.preInstall = preInstall;
-                seqNspCtx.pfs0FileCount = nspPfs0Header.file_cnt;
-                seqNspCtx.ncaCount = (titleContentInfoCnt - 1); // Exclude the CNMT NCA from the hash list
-                seqNspCtx.programNcaModCount = ncaProgramModCnt;
-                
-                // Allocate memory for the NCA hashes
-                seqDumpNcaHashes = calloc(1, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE);
-                if (!seqDumpNcaHashes)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the sequential dump reference file!", __func__);
-                    goto out;
-                }
-                
-                // Create sequential reference file and keep the handle to it opened
-                seqDumpFile = fopen(seqDumpFilename, "wb+");
-                if (!seqDumpFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to create sequential dump reference file! (\"%s\")", __func__, seqDumpFilename);
-                    goto out;
-                }
-                
-                // Write the sequential dump struct
-                write_res = fwrite(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
-                if (write_res != sizeof(sequentialNspCtx))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, sizeof(sequentialNspCtx), write_res);
-                    seqDumpFileRemove = true;
-                    goto out;
-                }
-                
-                // Write the NCA hashes block
-                write_res = fwrite(seqDumpNcaHashes, 1, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE, seqDumpFile);
-                if (write_res != ((titleContentInfoCnt - 1) * SHA256_HASH_SIZE))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE, write_res);
-                    seqDumpFileRemove = true;
-                    goto out;
-                }
-                
-                // Write the modified Program NCA headers
-                // The NPDM signature from the NCA headers is generated using cryptographically secure random numbers, so we must store the modified header during the first sequential dump session
-                for(i = 0; i < ncaProgramModCnt; i++)
-                {
-                    write_res = fwrite(xml_content_info[ncaProgramMod[i].nca_index].encrypted_header_mod, 1, NCA_FULL_HEADER_LENGTH, seqDumpFile);
-                    if (write_res != NCA_FULL_HEADER_LENGTH)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, NCA_FULL_HEADER_LENGTH, write_res);
-                        seqDumpFileRemove = true;
-                        goto out;
-                    }
-                }
+                entryTable[entryIdx].file_size = (j == 0 ? ETICKET_TIK_FILE_SIZE : ETICKET_CERT_FILE_SIZE);
+                entryTable[entryIdx].file_offset = curFileOffset;
+                entryTable[entryIdx].filename_offset = curFilenameOffset;
                 
-                rewind(seqDumpFile);
-                
-                // Update free space
-                freeSpace -= seqDumpFileSize;
+                curFileOffset += entryTable[entryIdx].file_size;
+                curFilenameOffset += (j == 0 ? NSP_TIK_FILENAME_LENGTH : NSP_CERT_FILENAME_LENGTH);
             }
         }
-    } else {
-        if (progressCtx.totalSize > freeSpace)
+    }
+    
+    layout->dataSize = curFileOffset;
+    
+    return true;
+}
+
+// Fills the PFS0 string table entries from a single title
+// NCA filenames depend on their calculated hashes, so this must be done after patching the CNMT NCA from the title
+static void fillNspPfs0StrTable(nspPfs0Layout *layout, u32 titleIndex)
+{
+    nspTitleCtx *ctx = &(layout->titles[titleIndex]);
+    u32 entryIdx = layout->titleFirstEntries[titleIndex];
+    u32 j, k;
+    
+    for(j = 0; j <= ctx->titleContentInfoCnt; j++, entryIdx++)
+    {
+        char *curFilename = (layout->strTable + layout->entryTable[entryIdx].filename_offset);
+        
+        if (j < ctx->titleContentInfoCnt)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-            goto out;
+            sprintf(curFilename, "%s.%s", ctx->xml_content_info[j].nca_id_str, (j == ctx->cnmtNcaIndex ? "cnmt.nca" : "nca"));
+        } else {
+            sprintf(curFilename, "%s.cnmt.xml", ctx->xml_content_info[ctx->cnmtNcaIndex].nca_id_str);
         }
     }
     
-    if (seqDumpMode)
+    for(j = 0; j < ctx->xml_rec_cnt; j++)
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, splitIndex);
-    } else {
-        // Temporary, we'll use this to check if the dump already exists (it should have the archive bit set if so)
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+        if (!ctx->xml_records[j].xml_data || !ctx->xml_records[j].xml_size) continue;
         
-        // Check if the dump already exists
-        if (!batch && checkIfFileExists(dumpPath))
+        u8 type = ctx->xml_content_info[ctx->xml_records[j].nca_index].type;
+        
+        if (type == NcmContentType_Control && ctx->xml_records[j].nacp_icons && ctx->xml_records[j].nacp_icon_cnt)
         {
-            // Ask the user if they want to proceed anyway
-            int cur_breaks = breaks;
-            
-            proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
-            if (!proceed)
+            for(k = 0; k < ctx->xml_records[j].nacp_icon_cnt; k++, entryIdx++)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                removeFile = false;
-                goto out;
-            } else {
-                // Remove the prompt from the screen
-                breaks = cur_breaks;
-                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+                char *curFilename = (layout->strTable + layout->entryTable[entryIdx].filename_offset);
+                sprintf(curFilename, "%s%s", ctx->xml_content_info[ctx->xml_records[j].nca_index].nca_id_str, strchr(ctx->xml_records[j].nacp_icons[k].filename, '.'));
             }
         }
         
-        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
-        // Better safe than sorry
-        remove(dumpPath);
-        fsdevDeleteDirectoryRecursively(dumpPath);
+        char *curFilename = (layout->strTable + layout->entryTable[entryIdx].filename_offset);
+        sprintf(curFilename, "%s.%s.xml", ctx->xml_content_info[ctx->xml_records[j].nca_index].nca_id_str, (type == NcmContentType_Program ? "programinfo" : (type == NcmContentType_Control ? "nacp" : "legalinfo")));
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            mkdir(dumpPath, 0744);
-            
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(dumpPath, tmp_idx);
-        }
-    }
-    
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
+        entryIdx++;
     }
     
-    // Start dump process
-    if (!batch) dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    
-    if (!batch)
+    if (ctx->includeTikAndCert)
     {
-        breaks++;
-        changeHomeButtonBlockStatus(true);
+        for(j = 0; j < 2; j++, entryIdx++)
+        {
+            char *curFilename = (layout->strTable + layout->entryTable[entryIdx].filename_offset);
+            sprintf(curFilename, "%s", (j == 0 ? ctx->rights_info.tik_filename : ctx->rights_info.cert_filename));
+        }
     }
-    
-    if (seqDumpMode)
+}
+
+// Records the current PFS0 entry index / offset in the journal state
+static void updateNspJournalState(nspPfs0Stream *stream, u32 fileIndex, u64 fileOffset, bool ncaEntry)
+{
+    if (stream->journalType == DUMP_JOURNAL_TYPE_NSP_BUNDLE)
     {
-        // Skip the PFS0 header in the first part file
-        // It will be saved to an additional ".nsp.hdr" file
-        if (!seqNspCtx.partNumber) progressCtx.curOffset = seqDumpSessionOffset = fullPfs0HeaderSize;
+        // The NCA checksums are stored right after the struct, so stream->ncaHashes already points to them
+        bundleNspJournalCtx *journalCtx = (bundleNspJournalCtx*)stream->journalState;
+        
+        journalCtx->fileIndex = fileIndex;
+        journalCtx->fileOffset = fileOffset;
+        
+        if (ncaEntry)
+        {
+            memcpy(&(journalCtx->hashCtx), &(stream->hashCtx), sizeof(Sha256Context));
+        } else {
+            memset(&(journalCtx->hashCtx), 0, sizeof(Sha256Context));
+        }
     } else {
-        // Write placeholder zeroes
-        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, outFile);
-        if (write_res != fullPfs0HeaderSize)
+        // Same layout as the sequential dump reference file
+        sequentialNspCtx *seqNspCtx = (sequentialNspCtx*)stream->journalState;
+        
+        seqNspCtx->fileIndex = fileIndex;
+        seqNspCtx->fileOffset = fileOffset;
+        
+        if (ncaEntry)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes placeholder data to file offset 0x%016lX! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, (u64)0, write_res);
-            goto out;
+            memcpy(&(seqNspCtx->hashCtx), &(stream->hashCtx), sizeof(Sha256Context));
+        } else {
+            memset(&(seqNspCtx->hashCtx), 0, sizeof(Sha256Context));
         }
         
-        // Advance our current offset
-        progressCtx.curOffset = fullPfs0HeaderSize;
+        memcpy(stream->journalState + sizeof(sequentialNspCtx), stream->ncaHashes, seqNspCtx->ncaCount * SHA256_HASH_SIZE);
     }
+}
+
+// Writes all the PFS0 entries from a NSP layout, starting right after the PFS0 header
+// The CNMT NCA entries take care of patching the CNMT NCAs, generating the CNMT XMLs and filling the PFS0 string table, so they're always revisited when resuming a dump past them
+// No data is written for entries that have already been dumped
+// If this fails, 'breaks' is left right below the last displayed error message
+static bool writeNspPfs0Entries(nspPfs0Stream *stream)
+{
+    nspPfs0Layout *layout = stream->layout;
+    outputWriter *writer = stream->writer;
+    progress_ctx_t *progressCtx = stream->progressCtx;
     
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    u32 i, j;
+    u64 n, fileOffset = 0;
+    bool proceed = true;
     
-    dumping = true;
+    NcmContentId ncaId;
     
-    u32 startFileIndex = (seqDumpMode ? seqNspCtx.fileIndex : 0);
-    u64 startFileOffset;
+    dataOverlayList ncaOverlays;
+    dataOverlayListInit(&ncaOverlays);
     
-    // Write all PFS0 entries
-    for(i = startFileIndex; i < nspPfs0Header.file_cnt; i++, startFileIndex++)
+    if (stream->resume)
+    {
+        // Restore previously calculated NCA IDs and hashes
+        for(i = 0; i < stream->resumeFileIndex; i++)
+        {
+            nspTitleCtx *ctx = &(layout->titles[layout->entryTitles[i]]);
+            u32 titleEntryIdx = (i - layout->titleFirstEntries[layout->entryTitles[i]]);
+            if (titleEntryIdx >= (ctx->titleContentInfoCnt - 1)) continue;
+            
+            memcpy(ctx->xml_content_info[titleEntryIdx].nca_id, stream->ncaHashes + ((u64)i * SHA256_HASH_SIZE), SHA256_HASH_SIZE / 2);
+            convertDataToHexString(ctx->xml_content_info[titleEntryIdx].nca_id, SHA256_HASH_SIZE / 2, ctx->xml_content_info[titleEntryIdx].nca_id_str, SHA256_HASH_SIZE + 1);
+            memcpy(ctx->xml_content_info[titleEntryIdx].hash, stream->ncaHashes + ((u64)i * SHA256_HASH_SIZE), SHA256_HASH_SIZE);
+            convertDataToHexString(ctx->xml_content_info[titleEntryIdx].hash, SHA256_HASH_SIZE, ctx->xml_content_info[titleEntryIdx].hash_str, (SHA256_HASH_SIZE * 2) + 1);
+        }
+    }
+    
+    for(i = 0; i < layout->header.file_cnt; i++)
     {
+        u32 titleIdx = layout->entryTitles[i];
+        nspTitleCtx *ctx = &(layout->titles[titleIdx]);
+        u32 titleEntryIdx = (i - layout->titleFirstEntries[titleIdx]);
+        bool ncaEntry = (titleEntryIdx < (ctx->titleContentInfoCnt - 1));
+        bool cnmtNcaEntry = (titleEntryIdx == ctx->cnmtNcaIndex);
+        u64 entrySize = layout->entryTable[i].file_size;
         char *entryFilename = NULL;
         
-        n = DUMP_BUFFER_SIZE;
+        // Skip entries that have already been dumped
+        if (stream->resume && i < stream->resumeFileIndex && !cnmtNcaEntry) continue;
         
-        startFileOffset = ((seqDumpMode && i == seqNspCtx.fileIndex) ? seqNspCtx.fileOffset : 0);
+        n = getTransferChunkSize(getTransferSourceFromStorageId(ctx->storageId));
+        
+        u64 startFileOffset = ((stream->resume && i <= stream->resumeFileIndex) ? (i < stream->resumeFileIndex ? entrySize : stream->resumeFileOffset) : 0);
         
         int programModIdx = -1;
         
-        // Check if we're dealing with a NCA
-        if (i < titleContentInfoCnt)
+        if (ncaEntry)
         {
-            // Check if we're not dealing with the CNMT NCA
-            if (i < (titleContentInfoCnt - 1))
+            // Copy NCA ID
+            memcpy(ncaId.c, ctx->xml_content_info[titleEntryIdx].nca_id, SHA256_HASH_SIZE / 2);
+            
+            // Reset SHA-256 context, unless we're resuming this NCA
+            if (!stream->resume || i != stream->resumeFileIndex) sha256ContextCreate(&(stream->hashCtx));
+            
+            // Retrieve Program NCA mod data index
+            if (ctx->xml_content_info[titleEntryIdx].type == NcmContentType_Program && ctx->ncaProgramModCnt > 0)
             {
-                // Copy NCA ID
-                memcpy(ncaId.c, xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2);
-                
-                // Reset SHA-256 context if necessary
-                if (!seqDumpMode || (seqDumpMode && i != seqNspCtx.fileIndex)) sha256ContextCreate(&nca_hash_ctx);
-                
-                // Retrieve Program NCA mod data index
-                if (xml_content_info[i].type == NcmContentType_Program && ncaProgramModCnt > 0)
+                for(j = 0; j < ctx->ncaProgramModCnt; j++)
                 {
-                    for(j = 0; j < ncaProgramModCnt; j++)
+                    if (ctx->ncaProgramMod[j].nca_index == titleEntryIdx)
                     {
-                        if (ncaProgramMod[j].nca_index == i)
-                        {
-                            programModIdx = (int)j;
-                            break;
-                        }
+                        programModIdx = (int)j;
+                        break;
                     }
                 }
-            } else {
-                // Patch CNMT NCA
-                breaks = (progressCtx.line_offset + 2);
-                
-                proceed = patchCnmtNca(cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size, &xml_program_info, xml_content_info, &ncaCnmtMod);
-                if (!proceed)
+            }
+            
+            // Build the overlay list for this NCA
+            proceed = buildNcaOverlayList(&ncaOverlays, &(ctx->xml_content_info[titleEntryIdx]), (programModIdx != -1 ? &(ctx->ncaProgramMod[programModIdx]) : NULL));
+            if (!proceed)
+            {
+                breaks = (progressCtx->line_offset + 2);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to build overlay list for NCA \"%s\"!", __func__, ctx->xml_content_info[titleEntryIdx].nca_id_str);
+                break;
+            }
+        } else
+        if (cnmtNcaEntry)
+        {
+            // Patch CNMT NCA. All the NCAs from this title have already been written at this point
+            breaks = (progressCtx->line_offset + 2);
+            
+            proceed = patchCnmtNca(&(ctx->ncmStorage), &(ctx->xml_program_info), ctx->xml_content_info, &(ctx->ncaCnmtMod));
+            if (!proceed) break;
+            
+            breaks = (progressCtx->line_offset - 4);
+            
+            // Generate proper CNMT XML
+            generateCnmtXml(&(ctx->xml_program_info), ctx->xml_content_info, ctx->cnmtXml);
+            
+            // Fill PFS0 string table entries for this title
+            // This is done here because we'll need to display filenames for the rest of its PFS0 entries
+            fillNspPfs0StrTable(layout, titleIdx);
+        } else {
+            // Copy current filename
+            entryFilename = (layout->strTable + layout->entryTable[i].filename_offset);
+        }
+        
+        for(fileOffset = startFileOffset; fileOffset < entrySize; fileOffset += n, progressCtx->curOffset += n, stream->seqDumpSessionOffset += n)
+        {
+            if (stream->seqDumpMode && stream->seqDumpFinish) break;
+            
+            uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer->curPath, '/' ) + 1);
+            
+            if (titleEntryIdx < ctx->titleContentInfoCnt)
+            {
+                if (layout->titleCnt > 1)
                 {
-                    dumping = false;
-                    break;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s) from title %016lX (%u/%u)...", ctx->xml_content_info[titleEntryIdx].nca_id_str, getContentType(ctx->xml_content_info[titleEntryIdx].type), ctx->xml_program_info.title_id, titleIdx + 1, layout->titleCnt);
+                } else {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s)...", ctx->xml_content_info[titleEntryIdx].nca_id_str, getContentType(ctx->xml_content_info[titleEntryIdx].type));
                 }
-                
-                breaks = (progressCtx.line_offset - 4);
-                
-                // Generate proper CNMT XML
-                generateCnmtXml(&xml_program_info, xml_content_info, cnmtXml);
-                
-                // Fill PFS0 string table
-                // This is done here because we'll need to display filenames for the rest of the PFS0 entries starting with the next loop iteration
-                entryIdx = 0;
-                
-                for(j = 0; j <= titleContentInfoCnt; j++, entryIdx++)
-                {
-                    char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
-                    
-                    if (j < titleContentInfoCnt)
-                    {
-                        sprintf(curFilename, "%s.%s", xml_content_info[j].nca_id_str, (j == cnmtNcaIndex ? "cnmt.nca" : "nca"));
-                    } else
-                    if (j == titleContentInfoCnt)
-                    {
-                        sprintf(curFilename, "%s.cnmt.xml", xml_content_info[cnmtNcaIndex].nca_id_str);
-                    }
-                }
-                
-                for(j = 0; j < xml_rec_cnt; j++, entryIdx++)
-                {
-                    u8 type = xml_content_info[xml_records[j].nca_index].type;
-                    
-                    if (type == NcmContentType_Control && xml_records[j].nacp_icons && xml_records[j].nacp_icon_cnt)
-                    {
-                        // Process all icons at once
-                        for(u32 k = 0; k < xml_records[j].nacp_icon_cnt; k++, entryIdx++)
-                        {
-                            char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
-                            sprintf(curFilename, "%s%s", xml_content_info[xml_records[j].nca_index].nca_id_str, strchr(xml_records[j].nacp_icons[k].filename, '.'));
-                        }
-                    }
-                    
-                    char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
-                    sprintf(curFilename, "%s.%s.xml", xml_content_info[xml_records[j].nca_index].nca_id_str, (type == NcmContentType_Program ? "programinfo" : (type == NcmContentType_Control ? "nacp" : "legalinfo")));
-                }
-                
-                if (includeTikAndCert)
-                {
-                    for(j = 0; j < 2; j++, entryIdx++)
-                    {
-                        char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
-                        sprintf(curFilename, (j == 0 ? rights_info.tik_filename : rights_info.cert_filename));
-                    }
-                }
-            }
-        } else {
-            // Copy current filename
-            entryFilename = (nspPfs0StrTable + nspPfs0EntryTable[i].filename_offset);
-        }
-        
-        for(fileOffset = startFileOffset; fileOffset < nspPfs0EntryTable[i].file_size; fileOffset += n, progressCtx.curOffset += n, seqDumpSessionOffset += n)
-        {
-            if (seqDumpMode && seqDumpFinish)
-            {
-                ret = 0;
-                break;
-            }
-            
-            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-            
-            if (i < titleContentInfoCnt)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s)...", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
             } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing \"%s\"...", entryFilename);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Writing \"%s\"...", entryFilename);
             }
             
-            if (n > (nspPfs0EntryTable[i].file_size - fileOffset)) n = (nspPfs0EntryTable[i].file_size - fileOffset);
+            if (n > (entrySize - fileOffset)) n = (entrySize - fileOffset);
             
             // Check if the next read chunk will exceed the size of the current part file
-            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((splitIndex - seqNspCtx.partNumber) + 1) * partSize))
+            if (stream->seqDumpMode && (stream->seqDumpSessionOffset + n) >= (((writer->partIndex - stream->seqPartNumber) + 1) * stream->partSize))
             {
-                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((splitIndex - seqNspCtx.partNumber) + 1) * partSize));
+                u64 new_file_chunk_size = ((stream->seqDumpSessionOffset + n) - (((writer->partIndex - stream->seqPartNumber) + 1) * stream->partSize));
                 u64 old_file_chunk_size = (n - new_file_chunk_size);
                 
-                u64 remainderDumpSize = (progressCtx.totalSize - (progressCtx.curOffset + old_file_chunk_size));
-                u64 remainderFreeSize = (freeSpace - (seqDumpSessionOffset + old_file_chunk_size));
+                u64 remainderDumpSize = (progressCtx->totalSize - (progressCtx->curOffset + old_file_chunk_size));
+                u64 remainderFreeSize = (freeSpace - (stream->seqDumpSessionOffset + old_file_chunk_size));
                 
                 // Check if we have enough space for the next part
                 // If so, set the chunk size to old_file_chunk_size
-                if ((remainderDumpSize <= partSize && remainderDumpSize > remainderFreeSize) || (remainderDumpSize > partSize && partSize > remainderFreeSize))
+                if ((remainderDumpSize <= stream->partSize && remainderDumpSize > remainderFreeSize) || (remainderDumpSize > stream->partSize && stream->partSize > remainderFreeSize))
                 {
                     n = old_file_chunk_size;
-                    seqDumpFinish = true;
+                    stream->seqDumpFinish = true;
                 }
             }
             
-            if (i < (titleContentInfoCnt - 1))
+            if (ncaEntry)
             {
-                breaks = (progressCtx.line_offset + 2);
+                breaks = (progressCtx->line_offset + 2);
                 
-                proceed = readNcaDataByContentId(&ncmStorage, &ncaId, fileOffset, dumpBuf, n);
+                // Batch dumps may have already read this block in the background
+                proceed = (nspReadAhead && batchReadAheadTake(nspReadAhead, &ncaId, fileOffset, dumpBuf, n));
+                if (!proceed) proceed = readNcaDataStreamByContentId(&(ctx->ncmStorage), &ncaId, fileOffset, &dumpBuf, n);
                 if (!proceed)
                 {
                     breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from NCA \"%s\"!", __func__, n, fileOffset, xml_content_info[i].nca_id_str);
-                    dumping = false;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from NCA \"%s\"!", __func__, n, fileOffset, ctx->xml_content_info[titleEntryIdx].nca_id_str);
                     break;
                 }
                 
-                breaks = (progressCtx.line_offset - 4);
-                
-                // Replace NCA header with our modified one
-                if (fileOffset < NCA_FULL_HEADER_LENGTH)
-                {
-                    u64 write_size = (NCA_FULL_HEADER_LENGTH - fileOffset);
-                    if (write_size > n) write_size = n;
-                    
-                    memcpy(dumpBuf, xml_content_info[i].encrypted_header_mod + fileOffset, write_size);
-                }
+                breaks = (progressCtx->line_offset - 4);
                 
-                // Replace modified Program NCA data blocks
-                if (programModIdx != -1)
-                {
-                    u64 internal_block_offset;
-                    u64 internal_block_chunk_size;
-                    
-                    u64 buffer_offset;
-                    u64 buffer_chunk_size;
-                    
-                    if ((fileOffset + n) > ncaProgramMod[programModIdx].hash_table_offset && (ncaProgramMod[programModIdx].hash_table_offset + ncaProgramMod[programModIdx].hash_table_size) > fileOffset)
-                    {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].hash_table_offset ? (fileOffset - ncaProgramMod[programModIdx].hash_table_offset) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].hash_table_size - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].hash_table_offset ? 0 : (ncaProgramMod[programModIdx].hash_table_offset - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].hash_table + internal_block_offset, buffer_chunk_size);
-                    }
-                    
-                    if ((fileOffset + n) > ncaProgramMod[programModIdx].block_offset[0] && (ncaProgramMod[programModIdx].block_offset[0] + ncaProgramMod[programModIdx].block_size[0]) > fileOffset)
-                    {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[0] ? (fileOffset - ncaProgramMod[programModIdx].block_offset[0]) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].block_size[0] - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[0] ? 0 : (ncaProgramMod[programModIdx].block_offset[0] - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].block_data[0] + internal_block_offset, buffer_chunk_size);
-                    }
-                    
-                    if (ncaProgramMod[programModIdx].block_mod_cnt == 2 && (fileOffset + n) > ncaProgramMod[programModIdx].block_offset[1] && (ncaProgramMod[programModIdx].block_offset[1] + ncaProgramMod[programModIdx].block_size[1]) > fileOffset)
-                    {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[1] ? (fileOffset - ncaProgramMod[programModIdx].block_offset[1]) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].block_size[1] - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[1] ? 0 : (ncaProgramMod[programModIdx].block_offset[1] - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].block_data[1] + internal_block_offset, buffer_chunk_size);
-                    }
-                }
+                // Replace the NCA header and any modified Program NCA data blocks
+                dataOverlayListApply(&ncaOverlays, fileOffset, dumpBuf, n);
                 
                 // Update SHA-256 calculation
-                sha256ContextUpdate(&nca_hash_ctx, dumpBuf, n);
+                sha256ContextUpdate(&(stream->hashCtx), dumpBuf, n);
+            } else
+            if (cnmtNcaEntry)
+            {
+                // Read CNMT NCA data with our patched regions applied
+                breaks = (progressCtx->line_offset + 2);
+                
+                proceed = readCnmtNcaData(&(ctx->ncmStorage), &(ctx->ncaCnmtMod), fileOffset, dumpBuf, n);
+                if (!proceed) break;
+                
+                breaks = (progressCtx->line_offset - 4);
             } else {
                 // Copy data using pointer array
-                u32 ptrIdx = (i - (titleContentInfoCnt - 1));
-                memcpy(dumpBuf, nspPfs0FilePtrs[ptrIdx] + fileOffset, n);
+                memcpy(dumpBuf, layout->filePtrs[i] + fileOffset, n);
             }
             
-            if ((seqDumpMode || (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)) && (progressCtx.curOffset + n) >= ((splitIndex + 1) * partSize))
+            if (!outputWriterWrite(writer, dumpBuf, n))
             {
-                u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * partSize));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                breaks = (progressCtx->line_offset + 2);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer->errorStr);
                 
-                if (old_file_chunk_size > 0)
+                if (writer->splitMode == OUTPUT_SPLIT_NONE && (progressCtx->curOffset + n) > FAT32_FILESIZE_LIMIT)
                 {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
+                    breaks += 2;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
                 }
                 
-                fclose(outFile);
-                outFile = NULL;
+                proceed = false;
+                break;
+            }
+            
+            if (stream->journalState)
+            {
+                // Periodically record the dump progress, so it can be resumed if the process gets interrupted
+                updateNspJournalState(stream, i, fileOffset + n, ncaEntry);
                 
-                if (((seqDumpMode && !seqDumpFinish) || !seqDumpMode) && (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize))
-                {
-                    splitIndex++;
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp%c%02u", NSP_DUMP_PATH, dumpName, (seqDumpMode ? '.' : '/'), splitIndex);
-                    
-                    outFile = fopen(dumpPath, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
+                if (!dumpJournalCheckpoint(stream->journal, writer, progressCtx->curOffset + n, stream->journalState, stream->journalStateSize, false))
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                    
-                    if (!seqDumpMode && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
-                        fat32_error = true;
-                    }
-                    
+                    breaks = (progressCtx->line_offset + 2);
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer->errorStr);
                     proceed = false;
                     break;
                 }
             }
             
-            if (seqDumpMode) progressCtx.seqDumpCurOffset = seqDumpSessionOffset;
-            printProgressBar(&progressCtx, true, n);
+            if (stream->seqDumpMode) progressCtx->seqDumpCurOffset = stream->seqDumpSessionOffset;
+            printProgressBar(progressCtx, true, n);
             
-            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+            if ((progressCtx->curOffset + n) < progressCtx->totalSize && cancelProcessCheck(progressCtx))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                ret = -2;
+                breaks = (progressCtx->line_offset + 2);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                stream->canceled = true;
                 proceed = false;
                 break;
             }
         }
         
-        if (!proceed || ret >= 0) break;
+        if (!proceed || (stream->seqDumpMode && stream->seqDumpFinish && fileOffset < entrySize)) break;
         
         // Support empty files
-        if (!nspPfs0EntryTable[i].file_size)
+        if (!entrySize)
         {
-            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+            uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer->curPath, '/' ) + 1);
             
-            if (i < titleContentInfoCnt)
+            if (titleEntryIdx < ctx->titleContentInfoCnt)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s)...", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s)...", ctx->xml_content_info[titleEntryIdx].nca_id_str, getContentType(ctx->xml_content_info[titleEntryIdx].type));
             } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing \"%s\"...", entryFilename);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Writing \"%s\"...", entryFilename);
             }
             
-            printProgressBar(&progressCtx, false, 0);
+            printProgressBar(progressCtx, false, 0);
         }
         
-        // Check if we're not dealing with the CNMT NCA
-        if (i < (titleContentInfoCnt - 1))
+        if (ncaEntry)
         {
             // Update content info
-            sha256ContextGetHash(&nca_hash_ctx, xml_content_info[i].hash);
-            convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1);
-            memcpy(xml_content_info[i].nca_id, xml_content_info[i].hash, SHA256_HASH_SIZE / 2);
-            convertDataToHexString(xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1);
+            sha256ContextGetHash(&(stream->hashCtx), ctx->xml_content_info[titleEntryIdx].hash);
+            convertDataToHexString(ctx->xml_content_info[titleEntryIdx].hash, SHA256_HASH_SIZE, ctx->xml_content_info[titleEntryIdx].hash_str, (SHA256_HASH_SIZE * 2) + 1);
+            memcpy(ctx->xml_content_info[titleEntryIdx].nca_id, ctx->xml_content_info[titleEntryIdx].hash, SHA256_HASH_SIZE / 2);
+            convertDataToHexString(ctx->xml_content_info[titleEntryIdx].nca_id, SHA256_HASH_SIZE / 2, ctx->xml_content_info[titleEntryIdx].nca_id_str, SHA256_HASH_SIZE + 1);
             
-            // If we're doing a sequential dump and we just finished dumping a NCA, copy its calculated hash
-            if (seqDumpMode) memcpy(seqDumpNcaHashes + (i * SHA256_HASH_SIZE), xml_content_info[i].hash, SHA256_HASH_SIZE);
+            // Keep track of the calculated hash for the sequential dump reference file / dump journal
+            if (stream->ncaHashes) memcpy(stream->ncaHashes + ((u64)i * SHA256_HASH_SIZE), ctx->xml_content_info[titleEntryIdx].hash, SHA256_HASH_SIZE);
         }
     }
     
-    if (!proceed || ret >= 0)
-    {
-        if (!proceed)
-        {
-            setProgressBarError(&progressCtx);
-            if (seqDumpMode) seqDumpFileRemove = true;
-        }
-        
-        goto out;
-    }
+    stream->fileIndex = i;
+    stream->fileOffset = fileOffset;
+    
+    dataOverlayListFree(&ncaOverlays);
+    
+    return proceed;
+}
+
+// Copies the full PFS0 header from a NSP layout to dumpBuf and writes it at the start of the output dump
+// Sequential dumps store the PFS0 header in a separate file, so it's only copied to dumpBuf in that case
+static bool writeNspPfs0Header(nspPfs0Stream *stream)
+{
+    nspPfs0Layout *layout = stream->layout;
+    progress_ctx_t *progressCtx = stream->progressCtx;
     
-    uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+    uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(stream->writer->curPath, '/' ) + 1);
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing PFS0 header...");
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Writing PFS0 header...");
     
     uiRefreshDisplay();
     
-    // Write our full PFS0 header
-    memcpy(dumpBuf, &nspPfs0Header, sizeof(pfs0_header));
-    memcpy(dumpBuf + sizeof(pfs0_header), nspPfs0EntryTable, (u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry));
-    memcpy(dumpBuf + sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry)), nspPfs0StrTable, nspPfs0Header.str_table_size);
+    memcpy(dumpBuf, &(layout->header), sizeof(pfs0_header));
+    memcpy(dumpBuf + sizeof(pfs0_header), layout->entryTable, (u64)layout->header.file_cnt * sizeof(pfs0_file_entry));
+    memcpy(dumpBuf + sizeof(pfs0_header) + ((u64)layout->header.file_cnt * sizeof(pfs0_file_entry)), layout->strTable, layout->header.str_table_size);
     
-    if (seqDumpMode)
+    if (stream->seqDumpMode) return true;
+    
+    if (!outputWriterPatch(stream->writer, 0, dumpBuf, layout->fullHeaderSize))
     {
-        // Just in case
-        remove(pfs0HeaderFilename);
-        
-        // Check if we have enough space for the header file
-        u64 curFreeSpace = (freeSpace - seqDumpSessionOffset);
-        if (!seqNspCtx.partNumber) curFreeSpace += fullPfs0HeaderSize; // The PFS0 header size is skipped during the first sequential dump session
-        
-        if (curFreeSpace < fullPfs0HeaderSize)
-        {
-            // Finish current sequential dump session
-            seqDumpFinish = true;
-            ret = 0;
-            goto out;
-        }
-        
-        pfs0HeaderFile = fopen(pfs0HeaderFilename, "wb");
-        if (!pfs0HeaderFile)
-        {
-            setProgressBarError(&progressCtx);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to create PFS0 header file!", __func__);
-            seqDumpFileRemove = true;
-            goto out;
-        }
-        
-        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, pfs0HeaderFile);
-        fclose(pfs0HeaderFile);
-        
-        if (write_res != fullPfs0HeaderSize)
-        {
-            setProgressBarError(&progressCtx);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header file! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, write_res);
-            remove(pfs0HeaderFilename);
-            seqDumpFileRemove = true;
-            goto out;
-        }
-        
-        // Update free space
-        freeSpace -= fullPfs0HeaderSize;
-    } else {
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            if (outFile)
-            {
-                fclose(outFile);
-                outFile = NULL;
-            }
-            
-            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp/%02u", NSP_DUMP_PATH, dumpName, 0);
-            
-            outFile = fopen(dumpPath, "rb+");
-            if (!outFile)
-            {
-                setProgressBarError(&progressCtx);
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to re-open output file for part #0!", __func__);
-                goto out;
-            }
-        } else {
-            rewind(outFile);
-        }
-        
-        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, outFile);
-        if (write_res != fullPfs0HeaderSize)
-        {
-            setProgressBarError(&progressCtx);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header to file offset 0x%016lX! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, (u64)0, write_res);
-            goto out;
-        }
+        setProgressBarError(progressCtx);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, stream->writer->errorStr);
+        return false;
     }
     
-    dumping = false;
+    return true;
+}
+
+int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleIndex, nspOptions *nspDumpCfg, bool batch)
+{
+    int ret = -1;
     
-    breaks = (progressCtx.line_offset + 2);
+    if (!nspDumpCfg)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP configuration struct!", __func__);
+        breaks += 2;
+        return ret;
+    }
     
-    if (progressCtx.curOffset >= progressCtx.totalSize || (seqDumpMode && seqDumpFinish)) ret = 0;
+    bool isFat32 = nspDumpCfg->isFat32;
+    bool useNoIntroLookup = nspDumpCfg->useNoIntroLookup;
+    bool removeConsoleData = nspDumpCfg->removeConsoleData;
+    bool tiklessDump = nspDumpCfg->tiklessDump;
+    bool npdmAcidRsaPatch = nspDumpCfg->npdmAcidRsaPatch;
+    bool dumpDeltaFragments = nspDumpCfg->dumpDeltaFragments;
+    bool useBrackets = nspDumpCfg->useBrackets;
+    bool preInstall = false;
     
-    if (ret < 0)
+    Result result;
+    u32 i = 0;
+    
+    NcmStorageId curStorageId;
+    
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    
+    nspTitleCtx nspCtx;
+    memset(&nspCtx, 0, sizeof(nspTitleCtx));
+    
+    nspPfs0Layout nspLayout;
+    memset(&nspLayout, 0, sizeof(nspPfs0Layout));
+    
+    nspPfs0Stream nspStream;
+    memset(&nspStream, 0, sizeof(nspPfs0Stream));
+    sha256ContextCreate(&(nspStream.hashCtx));
+    
+    u8 splitIndex = 0;
+    u32 crc = 0;
+    bool proceed = true, dumping = false, removeFile = true;
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false;
+    char seqDumpFilename[NAME_BUF_LEN] = {'\0'};
+    FILE *seqDumpFile = NULL;
+    u64 seqDumpFileSize = 0, seqDumpSessionOffset = 0;
+    u8 *seqDumpNcaHashes = NULL;
+    
+    sequentialNspCtx seqNspCtx;
+    memset(&seqNspCtx, 0, sizeof(sequentialNspCtx));
+    
+    char pfs0HeaderFilename[NAME_BUF_LEN] = {'\0'};
+    FILE *pfs0HeaderFile = NULL;
+    
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
+    
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
+    u8 *journalState = NULL;
+    u64 journalStateSize = 0;
+    bool journalRemove = false;
+    
+    size_t read_res, write_res;
+    
+    if ((selectedNspDumpType == DUMP_APP_NSP && !baseAppEntries) || (selectedNspDumpType == DUMP_PATCH_NSP && !patchEntries) || (selectedNspDumpType == DUMP_ADDON_NSP && !addOnEntries))
     {
-        setProgressBarError(&progressCtx);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
-        if (seqDumpMode) seqDumpFileRemove = true;
-        goto out;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title storage ID unavailable!", __func__);
+        breaks += 2;
+        return ret;
     }
     
-    // Set archive bit (only for FAT32)
-    if (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    if ((selectedNspDumpType == DUMP_APP_NSP && titleIndex >= titleAppCount) || (selectedNspDumpType == DUMP_PATCH_NSP && titleIndex >= titlePatchCount) || (selectedNspDumpType == DUMP_ADDON_NSP && titleIndex >= titleAddOnCount))
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-        result = fsdevSetConcatenationFileAttribute(dumpPath);
-        if (R_FAILED(result)) 
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Warning: failed to set archive bit on output directory! (0x%08X)", result);
-            breaks += 2;
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        breaks += 2;
+        return ret;
     }
     
-out:
-    if (outFile) fclose(outFile);
+    curStorageId = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].storageId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
     
-    if (ret >= 0)
+    char *dumpName = generateNSPDumpName(selectedNspDumpType, titleIndex, useBrackets);
+    if (!dumpName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    if (!batch)
     {
+        snprintf(seqDumpFilename, MAX_CHARACTERS(seqDumpFilename), "%s%s.nsp.seq", NSP_DUMP_PATH, dumpName);
+        snprintf(pfs0HeaderFilename, MAX_CHARACTERS(pfs0HeaderFilename), "%s%s.nsp.hdr", NSP_DUMP_PATH, dumpName);
+        
+        // Check if we're dealing with a sequential dump
+        seqDumpMode = checkIfFileExists(seqDumpFilename);
         if (seqDumpMode)
         {
-            if (seqDumpFinish)
+            // Open sequence file
+            seqDumpFile = fopen(seqDumpFilename, "rb+");
+            if (!seqDumpFile)
             {
-                // Update line count
-                breaks = (progressCtx.line_offset + 2);
-                
-                // Update the sequence reference file
-                seqNspCtx.partNumber = (splitIndex + 1);
-                seqNspCtx.fileIndex = startFileIndex;
-                seqNspCtx.fileOffset = fileOffset;
-                
-                // Copy the SHA-256 context data, but only if we're not dealing with the CNMT NCA
-                // NCA ID/hash for the CNMT NCA is handled in patchCnmtNca()
-                if (seqNspCtx.fileIndex < titleContentInfoCnt && seqNspCtx.fileIndex != cnmtNcaIndex)
-                {
-                    memcpy(&(seqNspCtx.hashCtx), &nca_hash_ctx, sizeof(Sha256Context));
-                } else {
-                    memset(&(seqNspCtx.hashCtx), 0, sizeof(Sha256Context));
-                }
-                
-                // Write the struct data
-                write_res = fwrite(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
-                if (write_res == sizeof(sequentialNspCtx))
-                {
-                    // Write the NCA hashes
-                    write_res = fwrite(seqDumpNcaHashes, 1, seqNspCtx.ncaCount * SHA256_HASH_SIZE, seqDumpFile);
-                    if (write_res != (seqNspCtx.ncaCount * SHA256_HASH_SIZE))
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, seqNspCtx.ncaCount * SHA256_HASH_SIZE, write_res);
-                        ret = -1;
-                        seqDumpFileRemove = true;
-                    }
-                } else {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, sizeof(sequentialNspCtx), write_res);
-                    ret = -1;
-                    seqDumpFileRemove = true;
-                }
-            } else {
-                // Mark the file for deletion
-                seqDumpFileRemove = true;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to open existing sequential dump reference file for reading! (\"%s\")", __func__, seqDumpFilename);
+                goto out;
             }
-        }
-        
-        if (ret >= 0 && !batch)
-        {
-            timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-            progressCtx.now -= progressCtx.start;
             
-            if (!seqDumpMode || (seqDumpMode && !seqDumpFinish))
+            // Retrieve sequence file size
+            fseek(seqDumpFile, 0, SEEK_END);
+            seqDumpFileSize = ftell(seqDumpFile);
+            rewind(seqDumpFile);
+            
+            // Read sequentialNspCtx struct info
+            read_res = fread(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
+            if (read_res != sizeof(sequentialNspCtx))
             {
-                progressCtx.progress = 100;
-                progressCtx.remainingTime = 0;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, sizeof(sequentialNspCtx), read_res);
+                goto out;
             }
             
-            printProgressBar(&progressCtx, false, 0);
+            // Check if the storage ID is right
+            if (seqNspCtx.storageId != curStorageId)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid source storage ID in sequential dump reference file!", __func__);
+                goto out;
+            }
             
-            formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-            uiRefreshDisplay();
+            // Check if the Program NCA mod count field is valid
+            if (seqNspCtx.programNcaModCount > 0 && !seqNspCtx.npdmAcidRsaPatch)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid Program NCA mod count sequential dump reference file!", __func__);
+                seqDumpFileRemove = true;
+                goto out;
+            }
             
-            // Only perform the checksum lookup if we have finished the dump process
-            if (useNoIntroLookup && (!seqDumpMode || (seqDumpMode && !seqDumpFinish)))
+            // Check file size
+            if (seqDumpFileSize != (sizeof(sequentialNspCtx) + (seqNspCtx.ncaCount * SHA256_HASH_SIZE) + (seqNspCtx.programNcaModCount * NCA_FULL_HEADER_LENGTH)))
             {
-                if (curStorageId != NcmStorageId_GameCard && !tiklessDump)
-                {
-                    // Calculate CRC32 checksum for the CNMT NCA
-                    crc32(cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size, &crc);
-                    
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "CNMT NCA CRC32 checksum: %08X.", crc);
-                    uiRefreshDisplay();
-                    breaks++;
-                    
-                    // Perform checksum lookup
-                    noIntroDumpCheck(true, crc);
-                } else {
-                    if (curStorageId != NcmStorageId_GameCard && tiklessDump)
-                    {
-                        breaks++;
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dump verification disabled (not compatible with NSP dumps with modified NCAs).");
-                    }
-                }
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid sequential dump reference file size!", __func__);
+                seqDumpFileRemove = true;
+                goto out;
             }
             
-            if (seqDumpMode)
+            // Allocate memory for the NCA hashes
+            seqDumpNcaHashes = calloc(1, seqNspCtx.ncaCount * SHA256_HASH_SIZE);
+            if (!seqDumpNcaHashes)
             {
-                breaks += 2;
-                
-                if (seqDumpFinish)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Please remember to exit the application and transfer the generated part file(s) to a PC before continuing in the next session!");
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Do NOT move the \"%s\" file!", strrchr(seqDumpFilename, '/' ) + 1);
-                }
-                
-                if (checkIfFileExists(pfs0HeaderFilename))
-                {
-                    if (seqDumpFinish) breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "The \"%s\" file contains the PFS0 header.\nUse it as the first file when concatenating all parts!", strrchr(pfs0HeaderFilename, '/' ) + 1);
-                }
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the sequential dump reference file!", __func__);
+                goto out;
             }
             
-            breaks += 2;
+            // Read NCA hashes
+            read_res = fread(seqDumpNcaHashes, 1, seqNspCtx.ncaCount * SHA256_HASH_SIZE, seqDumpFile);
+            if (read_res != (seqNspCtx.ncaCount * SHA256_HASH_SIZE))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, seqNspCtx.ncaCount * SHA256_HASH_SIZE, read_res);
+                goto out;
+            }
             
-            uiRefreshDisplay();
-        }
-    } else {
-        if (dumping)
-        {
-            breaks += 6;
-            if (fat32_error) breaks += 2;
+            // Restore parameters from the sequence file
+            isFat32 = true;
+            removeConsoleData = seqNspCtx.removeConsoleData;
+            tiklessDump = seqNspCtx.tiklessDump;
+            npdmAcidRsaPatch = seqNspCtx.npdmAcidRsaPatch;
+            preInstall = seqNspCtx.preInstall;
+            splitIndex = seqNspCtx.partNumber;
+            progressCtx.curOffset = ((u64)seqNspCtx.partNumber * SPLIT_FILE_SEQUENTIAL_SIZE);
         }
+    }
+    
+    if (!seqDumpMode)
+    {
+        // Check if a previous dump was interrupted
+        // The journal state uses the same layout as the sequential dump reference file
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
         
-        breaks += 2;
-        
-        if (removeFile)
+        if (dumpJournalLoad(&journal, dumpPath, DUMP_JOURNAL_TYPE_NSP, 0))
         {
-            if (seqDumpMode)
+            sequentialNspCtx *journalNspCtx = (sequentialNspCtx*)journal.state;
+            
+            if (journal.header.stateSize < sizeof(sequentialNspCtx) || journal.header.stateSize != (sizeof(sequentialNspCtx) + (journalNspCtx->ncaCount * SHA256_HASH_SIZE) + (journalNspCtx->programNcaModCount * NCA_FULL_HEADER_LENGTH)) || journalNspCtx->storageId != curStorageId)
             {
-                for(u8 i = 0; i <= splitIndex; i++)
-                {
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, i);
-                    remove(dumpPath);
-                }
-            } else {
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+                dumpJournalRemove(&journal);
+            } else
+            if (dumpJournalResumePrompt(&journal, batch))
+            {
+                // Discard the journal if anything goes wrong before the output dump is re-opened
+                journalRemove = true;
                 
-                if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+                memcpy(&seqNspCtx, journal.state, sizeof(sequentialNspCtx));
+                
+                // Allocate memory for the NCA hashes
+                seqDumpNcaHashes = calloc(1, seqNspCtx.ncaCount * SHA256_HASH_SIZE);
+                if (!seqDumpNcaHashes)
                 {
-                    fsdevDeleteDirectoryRecursively(dumpPath);
-                } else {
-                    remove(dumpPath);
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the dump journal!", __func__);
+                    goto out;
                 }
+                
+                memcpy(seqDumpNcaHashes, journal.state + sizeof(sequentialNspCtx), seqNspCtx.ncaCount * SHA256_HASH_SIZE);
+                
+                // Restore parameters from the journal
+                isFat32 = (journal.header.splitMode != OUTPUT_SPLIT_NONE);
+                removeConsoleData = seqNspCtx.removeConsoleData;
+                tiklessDump = seqNspCtx.tiklessDump;
+                npdmAcidRsaPatch = seqNspCtx.npdmAcidRsaPatch;
+                preInstall = seqNspCtx.preInstall;
+                progressCtx.curOffset = journal.header.dumpOffset;
             }
         }
     }
     
-    if (nspPfs0FilePtrs) free(nspPfs0FilePtrs);
-    
-    if (nspPfs0StrTable) free(nspPfs0StrTable);
-    
-    if (nspPfs0EntryTable) free(nspPfs0EntryTable);
-    
-    if (cnmtXml) free(cnmtXml);
-    
-    if (cnmtNcaBuf) free(cnmtNcaBuf);
-    
-    if (ncaProgramMod)
-    {
-        for(i = 0; i < ncaProgramModCnt; i++)
-        {
-            if (ncaProgramMod[i].hash_table) free(ncaProgramMod[i].hash_table);
-            if (ncaProgramMod[i].block_data[0]) free(ncaProgramMod[i].block_data[0]);
-            if (ncaProgramMod[i].block_data[1]) free(ncaProgramMod[i].block_data[1]);
-        }
-        
-        free(ncaProgramMod);
-    }
+    u64 partSize = (seqDumpMode ? SPLIT_FILE_SEQUENTIAL_SIZE : SPLIT_FILE_NSP_PART_SIZE);
     
-    if (xml_records)
+    if (!batch)
     {
-        for(i = 0; i < xml_rec_cnt; i++)
-        {
-            if (xml_records[i].xml_data) free(xml_records[i].xml_data);
-            if (xml_records[i].nacp_icons) free(xml_records[i].nacp_icons);
-        }
-        
-        free(xml_records);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving information from encrypted NCA content files...");
+        uiRefreshDisplay();
+        breaks += 2;
     }
     
-    if (xml_content_info) free(xml_content_info);
-    
-    ncmContentStorageClose(&ncmStorage);
-    
-    if (curStorageId == NcmStorageId_GameCard) closeGameCardStoragePartition();
-    
-    if (titleContentInfos) free(titleContentInfos);
-    
-    if (seqDumpNcaHashes) free(seqDumpNcaHashes);
-    
-    if (seqDumpFile) fclose(seqDumpFile);
-    
-    if (seqDumpFileRemove) remove(seqDumpFilename);
-    
-    if (dumpName) free(dumpName);
+    if (!prepareNspTitleCtx(&nspCtx, selectedNspDumpType, titleIndex, removeConsoleData, tiklessDump, npdmAcidRsaPatch, dumpDeltaFragments, &preInstall, (!batch && !seqDumpMode && !journal.resume))) goto out;
     
-    if (!batch) changeHomeButtonBlockStatus(false);
+    // Build the PFS0 layout for this title
+    if (!buildNspPfs0Layout(&nspLayout, &nspCtx, 1)) goto out;
     
-    return ret;
-}
-
-int batchEntryCmp(const void *a, const void *b)
-{
-	batchEntry *batchEntry1 = (batchEntry*)a;
-	batchEntry *batchEntry2 = (batchEntry*)b;
-	
-	return strcasecmp(batchEntry1->nspFilename, batchEntry2->nspFilename);
-}
-
-int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
-{
-    int ret = -1;
+    // Calculate total dump size
+    progressCtx.totalSize = (nspLayout.fullHeaderSize + nspLayout.dataSize);
     
-    if (!batchDumpCfg)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid batch dump configuration struct!", __func__);
-        breaks += 2;
-        return ret;
-    }
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
     
-    bool dumpAppTitles = batchDumpCfg->dumpAppTitles;
-    bool dumpPatchTitles = batchDumpCfg->dumpPatchTitles;
-    bool dumpAddOnTitles = batchDumpCfg->dumpAddOnTitles;
-    bool isFat32 = batchDumpCfg->isFat32;
-    bool removeConsoleData = batchDumpCfg->removeConsoleData;
-    bool tiklessDump = batchDumpCfg->tiklessDump;
-    bool npdmAcidRsaPatch = batchDumpCfg->npdmAcidRsaPatch;
-    bool dumpDeltaFragments = batchDumpCfg->dumpDeltaFragments;
-    bool skipDumpedTitles = batchDumpCfg->skipDumpedTitles;
-    bool rememberDumpedTitles = batchDumpCfg->rememberDumpedTitles;
-    bool haltOnErrors = batchDumpCfg->haltOnErrors;
-    bool useBrackets = batchDumpCfg->useBrackets;
-    batchModeSourceStorage batchModeSrc = batchDumpCfg->batchModeSrc;
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total NSP dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiRefreshDisplay();
+    breaks += 2;
     
-    if ((!dumpAppTitles && !dumpPatchTitles && !dumpAddOnTitles) || (batchModeSrc == BATCH_SOURCE_ALL && ((dumpAppTitles && !titleAppCount) || (dumpPatchTitles && !titlePatchCount) || (dumpAddOnTitles && !titleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_SDCARD && ((dumpAppTitles && !sdCardTitleAppCount) || (dumpPatchTitles && !sdCardTitlePatchCount) || (dumpAddOnTitles && !sdCardTitleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_EMMC && ((dumpAppTitles && !emmcTitleAppCount) || (dumpPatchTitles && !emmcTitlePatchCount) || (dumpAddOnTitles && !emmcTitleAddOnCount))) || batchModeSrc >= BATCH_SOURCE_CNT)
+    if (!batch || journal.resume)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to perform batch NSP dump!", __func__);
-        breaks += 2;
-        return ret;
-    }
-    
-    u32 i, j;
+        if (seqDumpMode || journal.resume)
+        {
+            const char *resumeFileStr = (seqDumpMode ? "sequential dump reference file" : "dump journal");
+            
+            // Check if the current offset doesn't exceed the total NSP size
+            // The dump journal may point right at the end of the NSP if the process was interrupted before writing the PFS0 header
+            if (progressCtx.curOffset > progressCtx.totalSize || (seqDumpMode && progressCtx.curOffset == progressCtx.totalSize) || (journal.resume && journal.header.totalSize != progressCtx.totalSize))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP offset in the %s!", __func__, resumeFileStr);
+                goto out;
+            }
+            
+            // Check if the NCA count is valid
+            // The CNMT NCA is excluded from the hash list
+            if (seqNspCtx.ncaCount != (nspCtx.titleContentInfoCnt - 1))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA count mismatch in the %s! (%u != %u)", __func__, resumeFileStr, seqNspCtx.ncaCount, nspCtx.titleContentInfoCnt - 1);
+                goto out;
+            }
+            
+            // Check if the Program NCA mod count is valid
+            if (seqNspCtx.programNcaModCount != nspCtx.ncaProgramModCnt)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: Program NCA mod count mismatch in the %s! (%u != %u)", __func__, resumeFileStr, seqNspCtx.programNcaModCount, nspCtx.ncaProgramModCnt);
+                goto out;
+            }
+            
+            // Check if the PFS0 file count is valid
+            if (seqNspCtx.pfs0FileCount != nspLayout.header.file_cnt)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: PFS0 file count mismatch in the %s! (%u != %u)", __func__, resumeFileStr, seqNspCtx.pfs0FileCount, nspLayout.header.file_cnt);
+                goto out;
+            }
+            
+            // Check if the current PFS0 file index is valid
+            if (seqNspCtx.fileIndex >= nspLayout.header.file_cnt)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid PFS0 file index in the %s!", __func__, resumeFileStr);
+                goto out;
+            }
+            
+            // Check if we're really dealing with a title with a missing ticket if preInstall == true
+            if (seqNspCtx.preInstall && !nspCtx.rights_info.missing_tik)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title preinstall status in the %s!", __func__, resumeFileStr);
+                goto out;
+            }
+            
+            // Check if the current overall offset is aligned to SPLIT_FILE_SEQUENTIAL_SIZE (or matches the dump journal)
+            u64 curNspOffset = (nspLayout.fullHeaderSize + nspLayout.entryTable[seqNspCtx.fileIndex].file_offset + seqNspCtx.fileOffset);
+            
+            if (curNspOffset != progressCtx.curOffset)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: overall NSP dump offset mismatch in the %s!", __func__, resumeFileStr);
+                goto out;
+            }
+            
+            // Check if there's enough free space to continue the sequential dump process
+            u64 restSize = (progressCtx.totalSize - curNspOffset);
+            if (seqDumpMode && progressCtx.totalSize > freeSpace && ((restSize > SPLIT_FILE_SEQUENTIAL_SIZE && freeSpace < SPLIT_FILE_SEQUENTIAL_SIZE) || (restSize <= SPLIT_FILE_SEQUENTIAL_SIZE && freeSpace < restSize)))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+                goto out;
+            }
+            
+            // Now check if the current PFS0 file entry offset is correct
+            // The dump journal may point right at the end of an entry
+            if (seqNspCtx.fileOffset > nspLayout.entryTable[seqNspCtx.fileIndex].file_size || (seqDumpMode && seqNspCtx.fileOffset == nspLayout.entryTable[seqNspCtx.fileIndex].file_size))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid offset for current PFS0 file entry in the %s!", __func__, resumeFileStr);
+                goto out;
+            }
+            
+            // Copy the NCA SHA-256 context data, but only if we're not dealing with the CNMT NCA
+            // Previously calculated NCA IDs and hashes are restored by writeNspPfs0Entries()
+            if (seqNspCtx.fileIndex < (nspCtx.titleContentInfoCnt - 1)) memcpy(&(nspStream.hashCtx), &(seqNspCtx.hashCtx), sizeof(Sha256Context));
+            
+            // Restore the modified Program NCA headers
+            // The NPDM signature from the NCA headers is generated using cryptographically secure random numbers, so the modified header is stored during the first sequential dump session
+            // If needed, it must be restored in later sessions
+            for(i = 0; i < nspCtx.ncaProgramModCnt; i++)
+            {
+                if (journal.resume)
+                {
+                    memcpy(nspCtx.xml_content_info[nspCtx.ncaProgramMod[i].nca_index].encrypted_header_mod, journal.state + sizeof(sequentialNspCtx) + (seqNspCtx.ncaCount * SHA256_HASH_SIZE) + (i * NCA_FULL_HEADER_LENGTH), NCA_FULL_HEADER_LENGTH);
+                    continue;
+                }
+                
+                read_res = fread(nspCtx.xml_content_info[nspCtx.ncaProgramMod[i].nca_index].encrypted_header_mod, 1, NCA_FULL_HEADER_LENGTH, seqDumpFile);
+                if (read_res != NCA_FULL_HEADER_LENGTH)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, NCA_FULL_HEADER_LENGTH, read_res);
+                    goto out;
+                }
+            }
+            
+            if (seqDumpMode) rewind(seqDumpFile);
+            
+            // Inform that we are resuming an already started sequential dump operation
+            // The interrupted dump message has already been displayed by dumpJournalResumePrompt()
+            if (journal.resume)
+            {
+                if (selectedNspDumpType == DUMP_APP_NSP || selectedNspDumpType == DUMP_PATCH_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Configuration parameters overrided. Remove console specific data: %s | Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
+                } else {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Configuration parameters overrided. Remove console specific data: %s | Generate ticket-less dump: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"));
+                }
+            } else
+            if (curStorageId == NcmStorageId_GameCard)
+            {
+                if (selectedNspDumpType == DUMP_APP_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Change NPDM RSA key/sig in Program NCA: %s.", (npdmAcidRsaPatch ? "Yes" : "No"));
+                } else
+                if (selectedNspDumpType == DUMP_PATCH_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
+                } else
+                if (selectedNspDumpType == DUMP_ADDON_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation.");
+                }
+            } else {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
+                breaks++;
+                
+                if (selectedNspDumpType == DUMP_APP_NSP || selectedNspDumpType == DUMP_PATCH_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
+                } else
+                if (selectedNspDumpType == DUMP_ADDON_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"));
+                }
+            }
+            
+            breaks++;
+        } else {
+            if (progressCtx.totalSize > freeSpace)
+            {
+                // Check if we have enough free space
+                // The CNMT NCA is excluded from the hash list
+                seqDumpFileSize = (sizeof(sequentialNspCtx) + ((nspCtx.titleContentInfoCnt - 1) * SHA256_HASH_SIZE) + (nspCtx.ncaProgramModCnt * NCA_FULL_HEADER_LENGTH));
+                if (freeSpace < (SPLIT_FILE_SEQUENTIAL_SIZE + seqDumpFileSize))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+                    goto out;
+                }
+                
+                // Ask the user if they want to use the sequential dump mode
+                int cur_breaks = breaks;
+                
+                if (!yesNoPrompt("There's not enough space available to generate a whole dump in this session. Do you want to use sequential dumping?\nIn this mode, the selected content will be dumped in more than one session.\nYou'll have to transfer the generated part files to a PC before continuing the process in the next session."))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                    goto out;
+                }
+                
+                // Remove the prompt from the screen
+                breaks = cur_breaks;
+                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+                uiRefreshDisplay();
+                
+                // Modify config parameters
+                isFat32 = true;
+                partSize = SPLIT_FILE_SEQUENTIAL_SIZE;
+                seqDumpMode = true;
+                
+                // Fill information in our sequential context
+                seqNspCtx.storageId = curStorageId;
+                seqNspCtx.removeConsoleData = removeConsoleData;
+                seqNspCtx.tiklessDump = tiklessDump;
+                seqNspCtx.npdmAcidRsaPatch = npdmAcidRsaPatch;
+                seqNspCtx.preInstall = preInstall;
+                seqNspCtx.pfs0FileCount = nspLayout.header.file_cnt;
+                seqNspCtx.ncaCount = (nspCtx.titleContentInfoCnt - 1); // Exclude the CNMT NCA from the hash list
+                seqNspCtx.programNcaModCount = nspCtx.ncaProgramModCnt;
+                
+                // Allocate memory for the NCA hashes
+                seqDumpNcaHashes = calloc(1, (nspCtx.titleContentInfoCnt - 1) * SHA256_HASH_SIZE);
+                if (!seqDumpNcaHashes)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the sequential dump reference file!", __func__);
+                    goto out;
+                }
+                
+                // Create sequential reference file and keep the handle to it opened
+                seqDumpFile = fopen(seqDumpFilename, "wb+");
+                if (!seqDumpFile)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to create sequential dump reference file! (\"%s\")", __func__, seqDumpFilename);
+                    goto out;
+                }
+                
+                // Write the sequential dump struct
+                write_res = fwrite(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
+                if (write_res != sizeof(sequentialNspCtx))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, sizeof(sequentialNspCtx), write_res);
+                    seqDumpFileRemove = true;
+                    goto out;
+                }
+                
+                // Write the NCA hashes block
+                write_res = fwrite(seqDumpNcaHashes, 1, (nspCtx.titleContentInfoCnt - 1) * SHA256_HASH_SIZE, seqDumpFile);
+                if (write_res != ((nspCtx.titleContentInfoCnt - 1) * SHA256_HASH_SIZE))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, (nspCtx.titleContentInfoCnt - 1) * SHA256_HASH_SIZE, write_res);
+                    seqDumpFileRemove = true;
+                    goto out;
+                }
+                
+                // Write the modified Program NCA headers
+                // The NPDM signature from the NCA headers is generated using cryptographically secure random numbers, so we must store the modified header during the first sequential dump session
+                for(i = 0; i < nspCtx.ncaProgramModCnt; i++)
+                {
+                    write_res = fwrite(nspCtx.xml_content_info[nspCtx.ncaProgramMod[i].nca_index].encrypted_header_mod, 1, NCA_FULL_HEADER_LENGTH, seqDumpFile);
+                    if (write_res != NCA_FULL_HEADER_LENGTH)
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, NCA_FULL_HEADER_LENGTH, write_res);
+                        seqDumpFileRemove = true;
+                        goto out;
+                    }
+                }
+                
+                rewind(seqDumpFile);
+                
+                // Update free space
+                freeSpace -= seqDumpFileSize;
+            }
+        }
+    } else {
+        if (progressCtx.totalSize > freeSpace)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+            goto out;
+        }
+    }
+    
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+    
+    if (!seqDumpMode && !journal.resume)
+    {
+        // Check if the dump already exists (it should have the archive bit set if so)
+        if (!batch && checkIfFileExists(dumpPath))
+        {
+            // Ask the user if they want to proceed anyway
+            int cur_breaks = breaks;
+            
+            proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
+            if (!proceed)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                removeFile = false;
+                goto out;
+            } else {
+                // Remove the prompt from the screen
+                breaks = cur_breaks;
+                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+            }
+        }
+        
+        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
+        // Better safe than sorry
+        remove(dumpPath);
+        fsdevDeleteDirectoryRecursively(dumpPath);
+    }
+    
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(getTransferSourceFromStorageId(curStorageId));
+    
+    // The output writer takes care of the part file naming
+    // The first sequential part file doesn't hold the PFS0 header
+    outputSplitMode splitMode = (seqDumpMode ? OUTPUT_SPLIT_SUFFIX : ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32) ? OUTPUT_SPLIT_DIRECTORY : OUTPUT_SPLIT_NONE));
+    
+    if (journal.resume)
+    {
+        if (!outputWriterResume(&writer, dumpPath, splitMode, progressCtx.totalSize, partSize, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to resume interrupted dump: %s", __func__, writer.errorStr);
+            goto out;
+        }
+        
+        journalRemove = false;
+    } else {
+        if (!outputWriterOpen(&writer, dumpPath, splitMode, progressCtx.totalSize, partSize, splitIndex, ((seqDumpMode && !seqNspCtx.partNumber) ? nspLayout.fullHeaderSize : progressCtx.curOffset), &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            goto out;
+        }
+    }
+    
+    if (!seqDumpMode)
+    {
+        // Fill information in our sequential context. It's used as the dump journal state
+        seqNspCtx.storageId = curStorageId;
+        seqNspCtx.removeConsoleData = removeConsoleData;
+        seqNspCtx.tiklessDump = tiklessDump;
+        seqNspCtx.npdmAcidRsaPatch = npdmAcidRsaPatch;
+        seqNspCtx.preInstall = preInstall;
+        seqNspCtx.pfs0FileCount = nspLayout.header.file_cnt;
+        seqNspCtx.ncaCount = (nspCtx.titleContentInfoCnt - 1); // Exclude the CNMT NCA from the hash list
+        seqNspCtx.programNcaModCount = nspCtx.ncaProgramModCnt;
+        
+        if (!seqDumpNcaHashes)
+        {
+            seqDumpNcaHashes = calloc(1, seqNspCtx.ncaCount * SHA256_HASH_SIZE);
+            if (!seqDumpNcaHashes)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes!", __func__);
+                goto out;
+            }
+        }
+        
+        // The journal state uses the same layout as the sequential dump reference file
+        journalStateSize = (sizeof(sequentialNspCtx) + (seqNspCtx.ncaCount * SHA256_HASH_SIZE) + (seqNspCtx.programNcaModCount * NCA_FULL_HEADER_LENGTH));
+        
+        journalState = calloc(1, journalStateSize);
+        if (!journalState)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the dump journal state!", __func__);
+            goto out;
+        }
+        
+        memcpy(journalState, &seqNspCtx, sizeof(sequentialNspCtx));
+        
+        // The modified Program NCA headers don't change during the dump process
+        for(i = 0; i < nspCtx.ncaProgramModCnt; i++) memcpy(journalState + sizeof(sequentialNspCtx) + (seqNspCtx.ncaCount * SHA256_HASH_SIZE) + (i * NCA_FULL_HEADER_LENGTH), nspCtx.xml_content_info[nspCtx.ncaProgramMod[i].nca_index].encrypted_header_mod, NCA_FULL_HEADER_LENGTH);
+    }
+    
+    // Start dump process
+    if (!batch)
+    {
+        dumpStartMsg();
+        transferChunkSizeMsg(getTransferSourceFromStorageId(curStorageId));
+    }
+    
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    
+    if (!batch)
+    {
+        breaks++;
+        changeHomeButtonBlockStatus(true);
+    }
+    
+    if (seqDumpMode)
+    {
+        // Skip the PFS0 header in the first part file
+        // It will be saved to an additional ".nsp.hdr" file
+        if (!seqNspCtx.partNumber) progressCtx.curOffset = seqDumpSessionOffset = nspLayout.fullHeaderSize;
+    } else
+    if (!journal.resume)
+    {
+        // Write placeholder zeroes
+        memset(dumpBuf, 0, nspLayout.fullHeaderSize);
+        if (!outputWriterWrite(&writer, dumpBuf, nspLayout.fullHeaderSize))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            goto out;
+        }
+        
+        // Advance our current offset
+        progressCtx.curOffset = nspLayout.fullHeaderSize;
+    }
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    dumping = true;
+    
+    nspStream.layout = &nspLayout;
+    nspStream.writer = &writer;
+    nspStream.progressCtx = &progressCtx;
+    nspStream.resume = (seqDumpMode || journal.resume);
+    nspStream.resumeFileIndex = seqNspCtx.fileIndex;
+    nspStream.resumeFileOffset = seqNspCtx.fileOffset;
+    nspStream.ncaHashes = seqDumpNcaHashes;
+    nspStream.journal = &journal;
+    nspStream.journalType = DUMP_JOURNAL_TYPE_NSP;
+    nspStream.journalState = journalState;
+    nspStream.journalStateSize = (u32)journalStateSize;
+    nspStream.seqDumpMode = seqDumpMode;
+    nspStream.seqPartNumber = seqNspCtx.partNumber;
+    nspStream.partSize = partSize;
+    nspStream.seqDumpSessionOffset = seqDumpSessionOffset;
+    
+    // Write all PFS0 entries
+    proceed = writeNspPfs0Entries(&nspStream);
+    
+    seqDumpSessionOffset = nspStream.seqDumpSessionOffset;
+    seqDumpFinish = nspStream.seqDumpFinish;
+    
+    if (!proceed)
+    {
+        // The error message has already been displayed
+        dumping = false;
+        if (nspStream.canceled) ret = -2;
+        setProgressBarError(&progressCtx);
+        if (seqDumpMode) seqDumpFileRemove = true;
+        goto out;
+    }
+    
+    // Finish the current sequential dump session if it can't hold the rest of the PFS0 entries
+    if (seqDumpFinish && nspStream.fileIndex < nspLayout.header.file_cnt)
+    {
+        ret = 0;
+        goto out;
+    }
+    
+    // Write our full PFS0 header
+    if (!writeNspPfs0Header(&nspStream)) goto out;
+    
+    if (seqDumpMode)
+    {
+        // Just in case
+        remove(pfs0HeaderFilename);
+        
+        // Check if we have enough space for the header file
+        u64 curFreeSpace = (freeSpace - seqDumpSessionOffset);
+        if (!seqNspCtx.partNumber) curFreeSpace += nspLayout.fullHeaderSize; // The PFS0 header size is skipped during the first sequential dump session
+        
+        if (curFreeSpace < nspLayout.fullHeaderSize)
+        {
+            // Finish current sequential dump session
+            seqDumpFinish = true;
+            ret = 0;
+            goto out;
+        }
+        
+        pfs0HeaderFile = fopen(pfs0HeaderFilename, "wb");
+        if (!pfs0HeaderFile)
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to create PFS0 header file!", __func__);
+            seqDumpFileRemove = true;
+            goto out;
+        }
+        
+        write_res = fwrite(dumpBuf, 1, nspLayout.fullHeaderSize, pfs0HeaderFile);
+        fclose(pfs0HeaderFile);
+        
+        if (write_res != nspLayout.fullHeaderSize)
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header file! (wrote %lu bytes)", __func__, nspLayout.fullHeaderSize, write_res);
+            remove(pfs0HeaderFilename);
+            seqDumpFileRemove = true;
+            goto out;
+        }
+        
+        // Update free space
+        freeSpace -= nspLayout.fullHeaderSize;
+    }
+    
+    dumping = false;
+    
+    breaks = (progressCtx.line_offset + 2);
+    
+    if (progressCtx.curOffset >= progressCtx.totalSize || (seqDumpMode && seqDumpFinish)) ret = 0;
+    
+    if (ret < 0)
+    {
+        setProgressBarError(&progressCtx);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
+        if (seqDumpMode) seqDumpFileRemove = true;
+        goto out;
+    }
+    
+    dumpJournalRemove(&journal);
+    
+    // Set archive bit (only for FAT32)
+    if (splitMode == OUTPUT_SPLIT_DIRECTORY)
+    {
+        result = outputWriterSetArchiveBit(&writer);
+        if (R_FAILED(result)) 
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Warning: failed to set archive bit on output directory! (0x%08X)", result);
+            breaks += 2;
+        }
+    }
+    
+out:
+    outputWriterClose(&writer);
+    
+    if (ret >= 0)
+    {
+        if (seqDumpMode)
+        {
+            if (seqDumpFinish)
+            {
+                // Update line count
+                breaks = (progressCtx.line_offset + 2);
+                
+                // Update the sequence reference file
+                seqNspCtx.partNumber = writer.partIndex;
+                seqNspCtx.fileIndex = nspStream.fileIndex;
+                seqNspCtx.fileOffset = nspStream.fileOffset;
+                
+                // Copy the SHA-256 context data, but only if we're not dealing with the CNMT NCA
+                // NCA ID/hash for the CNMT NCA is handled in patchCnmtNca()
+                if (seqNspCtx.fileIndex < nspCtx.titleContentInfoCnt && seqNspCtx.fileIndex != nspCtx.cnmtNcaIndex)
+                {
+                    memcpy(&(seqNspCtx.hashCtx), &(nspStream.hashCtx), sizeof(Sha256Context));
+                } else {
+                    memset(&(seqNspCtx.hashCtx), 0, sizeof(Sha256Context));
+                }
+                
+                // Write the struct data
+                write_res = fwrite(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
+                if (write_res == sizeof(sequentialNspCtx))
+                {
+                    // Write the NCA hashes
+                    write_res = fwrite(seqDumpNcaHashes, 1, seqNspCtx.ncaCount * SHA256_HASH_SIZE, seqDumpFile);
+                    if (write_res != (seqNspCtx.ncaCount * SHA256_HASH_SIZE))
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, seqNspCtx.ncaCount * SHA256_HASH_SIZE, write_res);
+                        ret = -1;
+                        seqDumpFileRemove = true;
+                    }
+                } else {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, sizeof(sequentialNspCtx), write_res);
+                    ret = -1;
+                    seqDumpFileRemove = true;
+                }
+            } else {
+                // Mark the file for deletion
+                seqDumpFileRemove = true;
+            }
+        }
+        
+        if (ret >= 0 && !batch)
+        {
+            timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+            progressCtx.now -= progressCtx.start;
+            
+            if (!seqDumpMode || (seqDumpMode && !seqDumpFinish))
+            {
+                progressCtx.progress = 100;
+                progressCtx.remainingTime = 0;
+            }
+            
+            printProgressBar(&progressCtx, false, 0);
+            
+            formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+            uiRefreshDisplay();
+            
+            // Only perform the checksum lookup if we have finished the dump process
+            if (useNoIntroLookup && (!seqDumpMode || (seqDumpMode && !seqDumpFinish)))
+            {
+                if (curStorageId != NcmStorageId_GameCard && !tiklessDump)
+                {
+                    // CRC32 checksum for the CNMT NCA was calculated while patching it
+                    crc = nspCtx.ncaCnmtMod.crc;
+                    
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "CNMT NCA CRC32 checksum: %08X.", crc);
+                    uiRefreshDisplay();
+                    breaks++;
+                    
+                    // Perform checksum lookup
+                    noIntroDumpCheck(true, crc);
+                } else {
+                    if (curStorageId != NcmStorageId_GameCard && tiklessDump)
+                    {
+                        breaks++;
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dump verification disabled (not compatible with NSP dumps with modified NCAs).");
+                    }
+                }
+            }
+            
+            if (seqDumpMode)
+            {
+                breaks += 2;
+                
+                if (seqDumpFinish)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Please remember to exit the application and transfer the generated part file(s) to a PC before continuing in the next session!");
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Do NOT move the \"%s\" file!", strrchr(seqDumpFilename, '/' ) + 1);
+                }
+                
+                if (checkIfFileExists(pfs0HeaderFilename))
+                {
+                    if (seqDumpFinish) breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "The \"%s\" file contains the PFS0 header.\nUse it as the first file when concatenating all parts!", strrchr(pfs0HeaderFilename, '/' ) + 1);
+                }
+            }
+            
+            breaks += 2;
+            
+            uiRefreshDisplay();
+        }
+    } else {
+        if (dumping) breaks += 6;
+        
+        breaks += 2;
+        
+        if (journalRemove) dumpJournalRemove(&journal);
+        
+        if (journal.saved)
+        {
+            // Keep the partial dump, so it can be resumed later
+            dumpJournalKeptMsg();
+        } else
+        if (removeFile)
+        {
+            if (seqDumpMode)
+            {
+                for(u8 i = 0; i <= writer.partIndex; i++)
+                {
+                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, i);
+                    remove(dumpPath);
+                }
+            } else {
+                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+                
+                if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+                {
+                    fsdevDeleteDirectoryRecursively(dumpPath);
+                } else {
+                    remove(dumpPath);
+                }
+            }
+        }
+    }
+    
+    freeNspPfs0Layout(&nspLayout);
+    
+    freeNspTitleCtx(&nspCtx);
+    
+    if (curStorageId == NcmStorageId_GameCard) closeGameCardStoragePartition();
+    
+    if (seqDumpNcaHashes) free(seqDumpNcaHashes);
+    
+    if (journalState) free(journalState);
+    
+    dumpJournalFree(&journal);
+    
+    if (seqDumpFile) fclose(seqDumpFile);
+    
+    if (seqDumpFileRemove) remove(seqDumpFilename);
+    
+    if (dumpName) free(dumpName);
+    
+    if (!batch) changeHomeButtonBlockStatus(false);
+    
+    return ret;
+}
+
+int dumpNintendoSubmissionPackageBundle(u32 appIndex, nspOptions *nspDumpCfg)
+{
+    int ret = -1;
+    
+    if (!nspDumpCfg)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP configuration struct!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    if (!titleAppCount || !baseAppEntries || appIndex >= titleAppCount)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid base application index!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    bool isFat32 = nspDumpCfg->isFat32;
+    bool removeConsoleData = nspDumpCfg->removeConsoleData;
+    bool tiklessDump = nspDumpCfg->tiklessDump;
+    bool npdmAcidRsaPatch = nspDumpCfg->npdmAcidRsaPatch;
+    bool dumpDeltaFragments = nspDumpCfg->dumpDeltaFragments;
+    bool useBrackets = nspDumpCfg->useBrackets;
+    bool preInstall = false;
+    
+    Result result;
+    u32 i = 0, j = 0, k = 0;
+    
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    char *dumpName = NULL;
+    
+    u32 bundleTitleCnt = 0;
+    nspDumpType *bundleTitleTypes = NULL;
+    u32 *bundleTitleIndexes = NULL;
+    
+    nspTitleCtx *bundleCtx = NULL;
+    bool gameCardBundle = (baseAppEntries[appIndex].storageId == NcmStorageId_GameCard);
+    
+    u32 patchIndex = 0, patchVersion = 0;
+    bool patchFound = false;
+    
+    nspPfs0Layout nspLayout;
+    memset(&nspLayout, 0, sizeof(nspPfs0Layout));
+    
+    nspPfs0Stream nspStream;
+    memset(&nspStream, 0, sizeof(nspPfs0Stream));
+    sha256ContextCreate(&(nspStream.hashCtx));
+    
+    bool proceed = true, dumping = false;
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
+    
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
+    bundleNspJournalCtx journalCtx;
+    memset(&journalCtx, 0, sizeof(bundleNspJournalCtx));
+    
+    u8 *journalState = NULL;
+    u64 journalStateSize = 0;
+    bool journalRemove = false;
+    
+    // Look for the latest update available for the selected base application
+    // Gamecard bundles only take titles from the inserted gamecard into account, and vice versa
+    for(i = 0; titlePatchCount && patchEntries && i < titlePatchCount; i++)
+    {
+        if (!checkIfPatchOrAddOnBelongsToBaseApplication(i, appIndex, false) || gameCardBundle != (patchEntries[i].storageId == NcmStorageId_GameCard)) continue;
+        
+        if (!patchFound || patchEntries[i].version > patchVersion)
+        {
+            patchIndex = i;
+            patchVersion = patchEntries[i].version;
+            patchFound = true;
+        }
+    }
+    
+    // Base application + update + DLCs
+    bundleTitleTypes = calloc(titleAddOnCount + 2, sizeof(nspDumpType));
+    bundleTitleIndexes = calloc(titleAddOnCount + 2, sizeof(u32));
+    if (!bundleTitleTypes || !bundleTitleIndexes)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the bundle title list!", __func__);
+        goto out;
+    }
+    
+    bundleTitleTypes[bundleTitleCnt] = DUMP_APP_NSP;
+    bundleTitleIndexes[bundleTitleCnt++] = appIndex;
+    
+    if (patchFound)
+    {
+        bundleTitleTypes[bundleTitleCnt] = DUMP_PATCH_NSP;
+        bundleTitleIndexes[bundleTitleCnt++] = patchIndex;
+    }
+    
+    for(i = 0; titleAddOnCount && addOnEntries && i < titleAddOnCount; i++)
+    {
+        if (!checkIfPatchOrAddOnBelongsToBaseApplication(i, appIndex, true) || gameCardBundle != (addOnEntries[i].storageId == NcmStorageId_GameCard)) continue;
+        
+        bundleTitleTypes[bundleTitleCnt] = DUMP_ADDON_NSP;
+        bundleTitleIndexes[bundleTitleCnt++] = i;
+    }
+    
+    if (bundleTitleCnt < 2)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no updates or DLCs available for the selected base application!", __func__);
+        goto out;
+    }
+    
+    dumpName = calloc(NAME_BUF_LEN, sizeof(char));
+    if (!dumpName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        goto out;
+    }
+    
+    // Use the version from the bundled update (if available)
+    if (useBrackets)
+    {
+        snprintf(dumpName, NAME_BUF_LEN, "%s [%016lX][v%u][BUNDLE]", baseAppEntries[appIndex].fixedName, baseAppEntries[appIndex].titleId, (patchFound ? patchVersion : baseAppEntries[appIndex].version));
+    } else {
+        snprintf(dumpName, NAME_BUF_LEN, "%s v%u (%016lX) (BUNDLE)", baseAppEntries[appIndex].fixedName, (patchFound ? patchVersion : baseAppEntries[appIndex].version), baseAppEntries[appIndex].titleId);
+    }
+    
+    // Check if a previous dump was interrupted
+    snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+    
+    if (dumpJournalLoad(&journal, strbuf, DUMP_JOURNAL_TYPE_NSP_BUNDLE, 0))
+    {
+        if (journal.header.stateSize < sizeof(bundleNspJournalCtx))
+        {
+            dumpJournalRemove(&journal);
+        } else
+        if (dumpJournalResumePrompt(&journal, false))
+        {
+            // Discard the journal if anything goes wrong before the output dump is re-opened
+            journalRemove = true;
+            
+            memcpy(&journalCtx, journal.state, sizeof(bundleNspJournalCtx));
+            
+            // Restore parameters from the journal
+            isFat32 = (journal.header.splitMode != OUTPUT_SPLIT_NONE);
+            removeConsoleData = journalCtx.removeConsoleData;
+            tiklessDump = journalCtx.tiklessDump;
+            npdmAcidRsaPatch = journalCtx.npdmAcidRsaPatch;
+            preInstall = journalCtx.preInstall;
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Configuration parameters overrided. Remove console specific data: %s | Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
+            breaks += 2;
+        }
+    }
+    
+    bundleCtx = calloc(bundleTitleCnt, sizeof(nspTitleCtx));
+    if (!bundleCtx)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the bundle title contexts!", __func__);
+        goto out;
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving information from encrypted NCA content files (%u titles)...", bundleTitleCnt);
+    uiRefreshDisplay();
+    breaks += 2;
+    
+    for(i = 0; i < bundleTitleCnt; i++)
+    {
+        if (!prepareNspTitleCtx(&(bundleCtx[i]), bundleTitleTypes[i], bundleTitleIndexes[i], removeConsoleData, tiklessDump, npdmAcidRsaPatch, dumpDeltaFragments, &preInstall, !journal.resume))
+        {
+            proceed = false;
+            break;
+        }
+    }
+    
+    if (!proceed) goto out;
+    
+    // Build the PFS0 layout for all the bundled titles
+    if (!buildNspPfs0Layout(&nspLayout, bundleCtx, bundleTitleCnt)) goto out;
+    
+    // Calculate total dump size
+    progressCtx.totalSize = (nspLayout.fullHeaderSize + nspLayout.dataSize);
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total NSP bundle dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiRefreshDisplay();
+    breaks += 2;
+    
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+    
+    u32 programNcaModCnt = 0;
+    for(i = 0; i < bundleTitleCnt; i++) programNcaModCnt += bundleCtx[i].ncaProgramModCnt;
+    
+    journalStateSize = (sizeof(bundleNspJournalCtx) + ((u64)nspLayout.header.file_cnt * SHA256_HASH_SIZE) + ((u64)programNcaModCnt * NCA_FULL_HEADER_LENGTH));
+    
+    if (journal.resume)
+    {
+        u64 curNspOffset = 0;
+        
+        if (journalCtx.fileIndex < nspLayout.header.file_cnt) curNspOffset = (nspLayout.fullHeaderSize + nspLayout.entryTable[journalCtx.fileIndex].file_offset + journalCtx.fileOffset);
+        
+        // Make sure the journal matches the current bundle
+        if (journal.header.totalSize != progressCtx.totalSize || journal.header.stateSize != journalStateSize || journalCtx.titleCount != bundleTitleCnt || journalCtx.pfs0FileCount != nspLayout.header.file_cnt || journalCtx.programNcaModCount != programNcaModCnt || journalCtx.fileIndex >= nspLayout.header.file_cnt || journalCtx.fileOffset > nspLayout.entryTable[journalCtx.fileIndex].file_size || curNspOffset != journal.header.dumpOffset)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid dump journal! Please restart the dump procedure.", __func__);
+            goto out;
+        }
+        
+        progressCtx.curOffset = curNspOffset;
+    } else
+    if (progressCtx.totalSize > freeSpace)
+    {
+        // Sequential dumps aren't supported for bundles
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    journalState = calloc(1, journalStateSize);
+    if (!journalState)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the dump journal state!", __func__);
+        goto out;
+    }
+    
+    // NCA checksums are stored for every PFS0 entry, so they can be looked up by entry index
+    u8 *journalHashes = (journalState + sizeof(bundleNspJournalCtx));
+    u8 *journalNcaHeaders = (journalHashes + ((u64)nspLayout.header.file_cnt * SHA256_HASH_SIZE));
+    
+    if (journal.resume)
+    {
+        // Previously calculated NCA IDs and hashes are restored by writeNspPfs0Entries()
+        memcpy(journalState, journal.state, journalStateSize);
+        
+        // Restore the modified Program NCA headers (the NPDM signature is randomly generated)
+        for(i = 0, k = 0; i < bundleTitleCnt; i++)
+        {
+            for(j = 0; j < bundleCtx[i].ncaProgramModCnt; j++, k++) memcpy(bundleCtx[i].xml_content_info[bundleCtx[i].ncaProgramMod[j].nca_index].encrypted_header_mod, journalNcaHeaders + ((u64)k * NCA_FULL_HEADER_LENGTH), NCA_FULL_HEADER_LENGTH);
+        }
+        
+        memcpy(&(nspStream.hashCtx), &(journalCtx.hashCtx), sizeof(Sha256Context));
+    } else {
+        journalCtx.removeConsoleData = removeConsoleData;
+        journalCtx.tiklessDump = tiklessDump;
+        journalCtx.npdmAcidRsaPatch = npdmAcidRsaPatch;
+        journalCtx.preInstall = preInstall;
+        journalCtx.titleCount = bundleTitleCnt;
+        journalCtx.pfs0FileCount = nspLayout.header.file_cnt;
+        journalCtx.programNcaModCount = programNcaModCnt;
+        
+        memcpy(journalState, &journalCtx, sizeof(bundleNspJournalCtx));
+        
+        // The modified Program NCA headers don't change during the dump process
+        for(i = 0, k = 0; i < bundleTitleCnt; i++)
+        {
+            for(j = 0; j < bundleCtx[i].ncaProgramModCnt; j++, k++) memcpy(journalNcaHeaders + ((u64)k * NCA_FULL_HEADER_LENGTH), bundleCtx[i].xml_content_info[bundleCtx[i].ncaProgramMod[j].nca_index].encrypted_header_mod, NCA_FULL_HEADER_LENGTH);
+        }
+    }
+    
+    // Check if the dump already exists
+    if (!journal.resume && checkIfFileExists(dumpPath))
+    {
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
+        
+        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
+        if (!proceed)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            goto out;
+        }
+        
+        // Remove the prompt from the screen
+        breaks = cur_breaks;
+        uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+    }
+    
+    // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
+    // Better safe than sorry
+    if (!journal.resume)
+    {
+        remove(dumpPath);
+        fsdevDeleteDirectoryRecursively(dumpPath);
+    }
+    
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(getTransferSourceFromStorageId(baseAppEntries[appIndex].storageId));
+    
+    outputSplitMode splitMode = ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32) ? OUTPUT_SPLIT_DIRECTORY : OUTPUT_SPLIT_NONE);
+    
+    if (journal.resume)
+    {
+        if (!outputWriterResume(&writer, dumpPath, splitMode, progressCtx.totalSize, SPLIT_FILE_NSP_PART_SIZE, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to resume interrupted dump: %s", __func__, writer.errorStr);
+            goto out;
+        }
+        
+        journalRemove = false;
+    } else {
+        if (!outputWriterOpen(&writer, dumpPath, splitMode, progressCtx.totalSize, SPLIT_FILE_NSP_PART_SIZE, 0, 0, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            goto out;
+        }
+    }
+    
+    dumpStartMsg();
+    transferChunkSizeMsg(getTransferSourceFromStorageId(baseAppEntries[appIndex].storageId));
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    
+    breaks++;
+    changeHomeButtonBlockStatus(true);
+    
+    if (!journal.resume)
+    {
+        // Write placeholder zeroes
+        memset(dumpBuf, 0, nspLayout.fullHeaderSize);
+        if (!outputWriterWrite(&writer, dumpBuf, nspLayout.fullHeaderSize))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            goto out;
+        }
+        
+        // Advance our current offset
+        progressCtx.curOffset = nspLayout.fullHeaderSize;
+    }
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    dumping = true;
+    
+    nspStream.layout = &nspLayout;
+    nspStream.writer = &writer;
+    nspStream.progressCtx = &progressCtx;
+    nspStream.resume = journal.resume;
+    nspStream.resumeFileIndex = journalCtx.fileIndex;
+    nspStream.resumeFileOffset = journalCtx.fileOffset;
+    nspStream.ncaHashes = journalHashes;
+    nspStream.journal = &journal;
+    nspStream.journalType = DUMP_JOURNAL_TYPE_NSP_BUNDLE;
+    nspStream.journalState = journalState;
+    nspStream.journalStateSize = (u32)journalStateSize;
+    
+    // Write all PFS0 entries
+    if (!writeNspPfs0Entries(&nspStream))
+    {
+        // The error message has already been displayed
+        dumping = false;
+        if (nspStream.canceled) ret = -2;
+        setProgressBarError(&progressCtx);
+        goto out;
+    }
+    
+    // Write our full PFS0 header
+    if (!writeNspPfs0Header(&nspStream)) goto out;
+    
+    dumping = false;
+    
+    breaks = (progressCtx.line_offset + 2);
+    
+    if (progressCtx.curOffset < progressCtx.totalSize)
+    {
+        setProgressBarError(&progressCtx);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
+        goto out;
+    }
+    
+    ret = 0;
+    
+    dumpJournalRemove(&journal);
+    
+    // Set archive bit (only for FAT32)
+    if (splitMode == OUTPUT_SPLIT_DIRECTORY)
+    {
+        result = outputWriterSetArchiveBit(&writer);
+        if (R_FAILED(result))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Warning: failed to set archive bit on output directory! (0x%08X)", result);
+            breaks += 2;
+        }
+    }
+    
+out:
+    outputWriterClose(&writer);
+    
+    if (ret >= 0)
+    {
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        progressCtx.progress = 100;
+        progressCtx.remainingTime = 0;
+        
+        printProgressBar(&progressCtx, false, 0);
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s! (%u titles bundled)", progressCtx.etaInfo, bundleTitleCnt);
+        breaks += 2;
+        
+        uiRefreshDisplay();
+    } else {
+        if (dumping) breaks += 6;
+        
+        breaks += 2;
+        
+        if (journalRemove) dumpJournalRemove(&journal);
+        
+        if (journal.saved)
+        {
+            // Keep the partial dump, so it can be resumed later
+            dumpJournalKeptMsg();
+        } else
+        if (dumpName && strlen(dumpPath))
+        {
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+            
+            if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+            {
+                fsdevDeleteDirectoryRecursively(dumpPath);
+            } else {
+                remove(dumpPath);
+            }
+        }
+    }
+    
+    if (journalState) free(journalState);
+    
+    dumpJournalFree(&journal);
+    
+    freeNspPfs0Layout(&nspLayout);
+    
+    if (bundleCtx)
+    {
+        for(i = 0; i < bundleTitleCnt; i++) freeNspTitleCtx(&(bundleCtx[i]));
+        free(bundleCtx);
+    }
+    
+    if (gameCardBundle) closeGameCardStoragePartition();
+    
+    if (bundleTitleIndexes) free(bundleTitleIndexes);
+    
+    if (bundleTitleTypes) free(bundleTitleTypes);
+    
+    if (dumpName) free(dumpName);
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return ret;
+}
+
+int batchEntryCmp(const void *a, const void *b)
+{
+	batchEntry *batchEntry1 = (batchEntry*)a;
+	batchEntry *batchEntry2 = (batchEntry*)b;
+	
+	return strcasecmp(batchEntry1->nspFilename, batchEntry2->nspFilename);
+}
+
+static int batchEntrySizeCmp(const void *a, const void *b)
+{
+    batchEntry *batchEntry1 = (batchEntry*)a;
+    batchEntry *batchEntry2 = (batchEntry*)b;
+    
+    if (batchEntry1->contentSize != batchEntry2->contentSize) return (batchEntry1->contentSize > batchEntry2->contentSize ? -1 : 1);
+    
+    return strcasecmp(batchEntry1->nspFilename, batchEntry2->nspFilename);
+}
+
+// Reorders the batch entries using the provided ordering policy. The entries must already be sorted by name
+static bool sortBatchEntries(batchEntry *batchEntries, u32 batchEntryCnt, batchOrderPolicy batchOrder)
+{
+    if (!batchEntries || batchEntryCnt < 2 || batchOrder == BATCH_ORDER_NAME || batchOrder >= BATCH_ORDER_CNT) return true;
+    
+    u32 i, j = 0;
+    u64 remainingSpace = freeSpace;
+    
+    batchEntry *sortedEntries = NULL;
+    bool *usedEntries = NULL;
+    
+    if (batchOrder == BATCH_ORDER_LARGEST_FIRST || batchOrder == BATCH_ORDER_FIT_FREE_SPACE) qsort(batchEntries, batchEntryCnt, sizeof(batchEntry), batchEntrySizeCmp);
+    
+    if (batchOrder == BATCH_ORDER_LARGEST_FIRST) return true;
+    
+    sortedEntries = malloc(batchEntryCnt * sizeof(batchEntry));
+    usedEntries = calloc(batchEntryCnt, sizeof(bool));
+    
+    if (!sortedEntries || !usedEntries)
+    {
+        if (sortedEntries) free(sortedEntries);
+        if (usedEntries) free(usedEntries);
+        return false;
+    }
+    
+    if (batchOrder == BATCH_ORDER_SOURCE_INTERLEAVED)
+    {
+        // Always pick the first remaining entry stored on a different device than the previous one
+        // Titles from a single device are only placed next to each other once the other devices run out of titles
+        while(j < batchEntryCnt)
+        {
+            u32 nextEntry = batchEntryCnt;
+            
+            for(i = 0; i < batchEntryCnt; i++)
+            {
+                if (usedEntries[i]) continue;
+                
+                if (nextEntry == batchEntryCnt) nextEntry = i;
+                
+                if (!j || batchEntries[i].storageId != sortedEntries[j - 1].storageId)
+                {
+                    nextEntry = i;
+                    break;
+                }
+            }
+            
+            memcpy(&(sortedEntries[j++]), &(batchEntries[nextEntry]), sizeof(batchEntry));
+            usedEntries[nextEntry] = true;
+        }
+    } else {
+        // Entries are already sorted by size at this point
+        for(i = 0; i < batchEntryCnt; i++)
+        {
+            if (batchEntries[i].contentSize > remainingSpace) continue;
+            
+            remainingSpace -= batchEntries[i].contentSize;
+            
+            memcpy(&(sortedEntries[j++]), &(batchEntries[i]), sizeof(batchEntry));
+            usedEntries[i] = true;
+        }
+        
+        for(i = 0; i < batchEntryCnt; i++)
+        {
+            if (!usedEntries[i]) memcpy(&(sortedEntries[j++]), &(batchEntries[i]), sizeof(batchEntry));
+        }
+    }
+    
+    memcpy(batchEntries, sortedEntries, batchEntryCnt * sizeof(batchEntry));
+    
+    free(sortedEntries);
+    free(usedEntries);
+    
+    return true;
+}
+
+// Returns the expected time (in seconds) needed to dump all the enabled batch entries, based on the measured transfer throughput for each source
+static u64 getBatchDumpTimeEstimate(batchEntry *batchEntries, u32 batchEntryCnt)
+{
+    u32 i;
+    u64 estimatedTime = 0;
+    
+    for(i = 0; i < batchEntryCnt; i++)
+    {
+        if (batchEntries[i].enabled) estimatedTime += (batchEntries[i].contentSize / getTransferThroughput(getTransferSourceFromStorageId(batchEntries[i].storageId)));
+    }
+    
+    return estimatedTime;
+}
+
+// Points the read-ahead worker thread to the next enabled batch entry, but only if it's stored on a different storage device than the one being dumped
+// Otherwise, the worker keeps reading from its current target
+static void batchReadAheadUpdate(batchReadAheadCtx *ctx, batchEntry *batchEntries, u32 batchEntryCnt, u32 curEntry)
+{
+    u32 i;
+    
+    NcmStorageId curStorageId, nextStorageId;
+    NcmContentMetaType metaType;
+    u32 titleCount = 0, ncmTitleIndex = 0;
+    
+    NcmContentInfo *contentInfos = NULL;
+    u32 contentInfoCnt = 0;
+    
+    for(i = (curEntry + 1); i < batchEntryCnt; i++)
+    {
+        if (batchEntries[i].enabled) break;
+    }
+    
+    // The target is only ever changed by the current thread
+    if (i >= batchEntryCnt || (ctx->contentInfos && ctx->entryIndex == i)) return;
+    
+    getNspTitleNcmInfo(batchEntries[curEntry].titleType, batchEntries[curEntry].titleIndex, &curStorageId, &metaType, &titleCount, &ncmTitleIndex);
+    getNspTitleNcmInfo(batchEntries[i].titleType, batchEntries[i].titleIndex, &nextStorageId, &metaType, &titleCount, &ncmTitleIndex);
+    
+    if (nextStorageId == curStorageId) return;
+    
+    if (!retrieveContentInfosFromTitle(nextStorageId, metaType, titleCount, ncmTitleIndex, &contentInfos, &contentInfoCnt)) return;
+    
+    batchReadAheadSetTarget(ctx, i, nextStorageId, contentInfos, contentInfoCnt);
+}
+
+int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
+{
+    int ret = -1;
+    
+    if (!batchDumpCfg)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid batch dump configuration struct!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    bool dumpAppTitles = batchDumpCfg->dumpAppTitles;
+    bool dumpPatchTitles = batchDumpCfg->dumpPatchTitles;
+    bool dumpAddOnTitles = batchDumpCfg->dumpAddOnTitles;
+    bool isFat32 = batchDumpCfg->isFat32;
+    bool removeConsoleData = batchDumpCfg->removeConsoleData;
+    bool tiklessDump = batchDumpCfg->tiklessDump;
+    bool npdmAcidRsaPatch = batchDumpCfg->npdmAcidRsaPatch;
+    bool dumpDeltaFragments = batchDumpCfg->dumpDeltaFragments;
+    bool skipDumpedTitles = batchDumpCfg->skipDumpedTitles;
+    bool rememberDumpedTitles = batchDumpCfg->rememberDumpedTitles;
+    bool haltOnErrors = batchDumpCfg->haltOnErrors;
+    bool useBrackets = batchDumpCfg->useBrackets;
+    batchModeSourceStorage batchModeSrc = batchDumpCfg->batchModeSrc;
+    batchOrderPolicy batchOrder = batchDumpCfg->batchOrder;
+    
+    if ((!dumpAppTitles && !dumpPatchTitles && !dumpAddOnTitles) || batchModeSrc >= BATCH_SOURCE_CNT || (dumpAppTitles && !getBatchModeSourceTitleCount(batchModeSrc, DUMP_APP_NSP)) || (dumpPatchTitles && !getBatchModeSourceTitleCount(batchModeSrc, DUMP_PATCH_NSP)) || (dumpAddOnTitles && !getBatchModeSourceTitleCount(batchModeSrc, DUMP_ADDON_NSP)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to perform batch NSP dump!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    u32 i, j;
+    
+    u32 totalTitleCount = 0, totalAppCount = 0, totalPatchCount = 0, totalAddOnCount = 0;
+    
+    u32 titleCount = 0, titleIndex = 0;
+    
+    char *dumpName = NULL;
+    char summary_str[128] = {'\0'};
+    
+    int initial_breaks = breaks, cur_breaks;
+    
+    const u32 maxSummaryFileCount = 8;
+    u32 summaryPage = 0, selectedSummaryEntry = 0;
+    u32 xpos = 0, ypos = 0;
+    u64 keysDown = 0, keysHeld = 0;
+    
+    u32 maxEntryCount = 0, batchEntryIndex = 0, disabledEntryCount = 0;
+    batchEntry *batchEntries = NULL, *tmpBatchEntries = NULL;
+    
+    bool proceed = true;
+    
+    batchReadAheadCtx readAhead;
+    memset(&readAhead, 0, sizeof(batchReadAheadCtx));
+    
+    // Generate NSP configuration struct
+    nspOptions nspDumpCfg;
+    
+    nspDumpCfg.isFat32 = isFat32;
+    nspDumpCfg.useNoIntroLookup = false;
+    nspDumpCfg.removeConsoleData = removeConsoleData;
+    nspDumpCfg.tiklessDump = tiklessDump;
+    nspDumpCfg.npdmAcidRsaPatch = npdmAcidRsaPatch;
+    nspDumpCfg.dumpDeltaFragments = dumpDeltaFragments;
+    nspDumpCfg.useBrackets = useBrackets;
+    
+    // Allocate memory for the batch entries
+    if (dumpAppTitles) maxEntryCount += getBatchModeSourceTitleCount(batchModeSrc, DUMP_APP_NSP);
+    if (dumpPatchTitles) maxEntryCount += getBatchModeSourceTitleCount(batchModeSrc, DUMP_PATCH_NSP);
+    if (dumpAddOnTitles) maxEntryCount += getBatchModeSourceTitleCount(batchModeSrc, DUMP_ADDON_NSP);
+    
+    batchEntries = calloc(maxEntryCount, sizeof(batchEntry));
+    if (!batchEntries)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for batch entries!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    for(i = 0; i < 3; i++)
+    {
+        if ((i == 0 && !dumpAppTitles) || (i == 1 && !dumpPatchTitles) || (i == 2 && !dumpAddOnTitles)) continue;
+        
+        nspDumpType curNspDumpType = DUMP_APP_NSP;
+        
+        switch(i)
+        {
+            case 0:
+                titleCount = titleAppCount;
+                curNspDumpType = DUMP_APP_NSP;
+                break;
+            case 1:
+                titleCount = titlePatchCount;
+                curNspDumpType = DUMP_PATCH_NSP;
+                break;
+            case 2:
+                titleCount = titleAddOnCount;
+                curNspDumpType = DUMP_ADDON_NSP;
+                break;
+            default:
+                break;
+        }
+        
+        for(j = 0; j < titleCount; j++)
+        {
+            titleIndex = j;
+            
+            // Base applications are sorted by name, so titles from each storage aren't contiguous
+            if (!isBatchModeSourceStorage(batchModeSrc, (i == 0 ? baseAppEntries[titleIndex].storageId : (i == 1 ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId)))) continue;
+            
+            dumpName = generateNSPDumpName(curNspDumpType, titleIndex, false);
+            if (!dumpName)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+                breaks += 2;
+                goto out;
+            }
+            
+            // Check if an override file already exists for this dump
+            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", BATCH_OVERRIDES_PATH, dumpName);
+            
+            if (checkIfFileExists(strbuf))
+            {
+                free(dumpName);
+                dumpName = NULL;
+                continue;
+            }
+            
+            snprintf(batchEntries[batchEntryIndex].nspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].nspFilename), strrchr(strbuf, '/') + 1);
+            snprintf(batchEntries[batchEntryIndex].truncatedNspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].truncatedNspFilename), batchEntries[batchEntryIndex].nspFilename);
+            
+            if (useBrackets)
+            {
+                // Generate output name with brackets
+                free(dumpName);
+                dumpName = NULL;
+                
+                dumpName = generateNSPDumpName(curNspDumpType, titleIndex, true);
+                if (!dumpName)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name with brackets!", __func__);
+                    breaks += 2;
+                    goto out;
+                }
+            }
+            
+            // Check if this title has already been dumped
+            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+            
+            free(dumpName);
+            dumpName = NULL;
+            
+            if (skipDumpedTitles && checkIfFileExists(strbuf))
+            {
+                // Interrupted dumps still need to be resumed
+                strncat(strbuf, DUMP_JOURNAL_EXTENSION, MAX_CHARACTERS(strbuf) - strlen(strbuf));
+                if (!checkIfFileExists(strbuf)) continue;
+            }
+            
+            // Save title properties
+            batchEntries[batchEntryIndex].enabled = true;
+            batchEntries[batchEntryIndex].titleType = curNspDumpType;
+            batchEntries[batchEntryIndex].titleIndex = titleIndex;
+            batchEntries[batchEntryIndex].storageId = (i == 0 ? baseAppEntries[titleIndex].storageId : (i == 1 ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
+            batchEntries[batchEntryIndex].contentSize = (i == 0 ? baseAppEntries[titleIndex].contentSize : (i == 1 ? patchEntries[titleIndex].contentSize : addOnEntries[titleIndex].contentSize));
+            batchEntries[batchEntryIndex].contentSizeStr = (i == 0 ? baseAppEntries[titleIndex].contentSizeStr : (i == 1 ? patchEntries[titleIndex].contentSizeStr : addOnEntries[titleIndex].contentSizeStr));
+            
+            // Fix entry name length
+            truncateBrowserEntryName(batchEntries[batchEntryIndex].truncatedNspFilename);
+            
+            // Increase batch entry index
+            batchEntryIndex++;
+            
+            // Increase total base application count
+            if (i == 0) totalAppCount++;
+            
+            // Increase total patch count
+            if (i == 1) totalPatchCount++;
+            
+            // Increase total addon count
+            if (i == 2) totalAddOnCount++;
+        }
+    }
+    
+    // Calculate total title count
+    totalTitleCount = (totalAppCount + totalPatchCount + totalAddOnCount);
+    if (!totalTitleCount)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "You have already dumped all titles matching the selected settings!");
+        breaks += 2;
+        goto out;
+    }
+    
+    // Sort batch entries by name
+    qsort(batchEntries, totalTitleCount, sizeof(batchEntry), batchEntryCmp);
+    
+    // Apply the selected ordering policy
+    if (!sortBatchEntries(batchEntries, totalTitleCount, batchOrder))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory to sort the batch entries!", __func__);
+        breaks += 2;
+        goto out;
+    }
+    
+    if (totalTitleCount < maxEntryCount)
+    {
+        tmpBatchEntries = realloc(batchEntries, totalTitleCount * sizeof(batchEntry));
+        if (!tmpBatchEntries)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: failed to reallocate batch entries!", __func__);
+            breaks += 2;
+            goto out;
+        }
+        
+        batchEntries = tmpBatchEntries;
+        tmpBatchEntries = NULL;
+    }
+    
+    // Measure the throughput from every source storage involved in the batch, so we can estimate the total dump time
+    for(i = 0; i < totalTitleCount; i++) calibrateTransferChunkSizes(getTransferSourceFromStorageId(batchEntries[i].storageId));
+    
+    // Display summary controls
+    if (totalTitleCount > maxSummaryFileCount)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_ZL " / " NINTENDO_FONT_ZR " ] Change page | [ " NINTENDO_FONT_A " ] Proceed | [ " NINTENDO_FONT_B " ] Cancel | [ " NINTENDO_FONT_Y " ] Toggle selected entry | [ "  NINTENDO_FONT_L " ] Disable all entries | [ " NINTENDO_FONT_R " ] Enable all entries\n[ " NINTENDO_FONT_PLUS " ] Exit");
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Proceed | [ " NINTENDO_FONT_B " ] Cancel | [ " NINTENDO_FONT_Y " ] Toggle selected entry | [ "  NINTENDO_FONT_L " ] Disable all entries | [ " NINTENDO_FONT_R " ] Enable all entries | [ " NINTENDO_FONT_PLUS " ] Exit");
+    }
+    
+    breaks += 2;
+    
+    // Display free space
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
+    breaks += 2;
+    
+    // Display summary
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Summary:");
+    breaks += 2;
+    
+    if (totalAppCount)
+    {
+        snprintf(strbuf, MAX_CHARACTERS(strbuf), "BASE: %u", totalAppCount);
+        strcat(summary_str, strbuf);
+    }
+    
+    if (totalPatchCount)
+    {
+        if (totalAppCount) strcat(summary_str, " | ");
+        snprintf(strbuf, MAX_CHARACTERS(strbuf), "UPD: %u", totalPatchCount);
+        strcat(summary_str, strbuf);
+    }
+    
+    if (totalAddOnCount)
+    {
+        if (totalAppCount || totalPatchCount) strcat(summary_str, " | ");
+        snprintf(strbuf, MAX_CHARACTERS(strbuf), "DLC: %u", totalAddOnCount);
+        strcat(summary_str, strbuf);
+    }
+    
+    strcat(summary_str, " | ");
+    snprintf(strbuf, MAX_CHARACTERS(strbuf), "Total: %u", totalTitleCount);
+    strcat(summary_str, strbuf);
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, summary_str);
+    breaks++;
+    
+    while(true)
+    {
+        cur_breaks = breaks;
+        
+        uiFill(0, 8 + (cur_breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (cur_breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+        
+        // Calculate the number of selected titles
+        j = 0;
+        u64 totalOutSize = 0;
+        char totalOutSizeStr[32] = {'\0'};
+        char estimatedTimeStr[32] = {'\0'};
+        
+        for(i = 0; i < totalTitleCount; i++)
+        {
+            if (batchEntries[i].enabled)
+            {
+                j++;
+                totalOutSize += batchEntries[i].contentSize;
+            }
+        }
+        
+        convertSize(totalOutSize, totalOutSizeStr, MAX_CHARACTERS(totalOutSizeStr));
+        formatETAString(getBatchDumpTimeEstimate(batchEntries, totalTitleCount), estimatedTimeStr, MAX_CHARACTERS(estimatedTimeStr));
+        
+        // Job files can't review the summary, so every enabled entry gets dumped right away
+        if (headlessMode)
+        {
+            proceed = (j > 0);
+            if (!proceed) uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_ERROR_RGB, "%s: no titles selected for the batch dump!", __func__);
+            break;
+        }
+        
+        if (totalTitleCount > maxSummaryFileCount)
+        {
+            if (j && totalOutSize)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Current page: %u | Selected titles: %u | Approximate total dump size: %s (%lu bytes) | Estimated dump time: %s", summaryPage + 1, j, totalOutSizeStr, totalOutSize, estimatedTimeStr);
+            } else {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Current page: %u | Selected titles: %u", summaryPage + 1, j);
+            }
+        } else {
+            if (j && totalOutSize)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Selected titles: %u | Approximate total dump size: %s (%lu bytes) | Estimated dump time: %s", j, totalOutSizeStr, totalOutSize, estimatedTimeStr);
+            } else {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Selected titles: %u", j);
+            }
+        }
+        
+        cur_breaks += 2;
+        
+        j = 0;
+        highlight = false;
+        
+        for(i = (summaryPage * maxSummaryFileCount); i < ((summaryPage + 1) * maxSummaryFileCount); i++, j++)
+        {
+            if (i >= totalTitleCount) break;
+            
+            xpos = STRING_X_POS;
+            ypos = (8 + (cur_breaks * LINE_HEIGHT) + (j * (font_height + 12)) + 6);
+            
+            if (i == selectedSummaryEntry)
+            {
+                highlight = true;
+                uiFill(0, ypos - 6, FB_WIDTH, font_height + 12, HIGHLIGHT_BG_COLOR_RGB);
+            }
+            
+            uiDrawIcon((highlight ? (batchEntries[i].enabled ? enabledHighlightIconBuf : disabledHighlightIconBuf) : (batchEntries[i].enabled ? enabledNormalIconBuf : disabledNormalIconBuf)), BROWSER_ICON_DIMENSION, BROWSER_ICON_DIMENSION, xpos, ypos);
+            xpos += (BROWSER_ICON_DIMENSION + 8);
+            
+            if (highlight)
+            {
+                uiDrawString(xpos, ypos, HIGHLIGHT_FONT_COLOR_RGB, batchEntries[i].truncatedNspFilename);
+                
+                if (batchEntries[i].contentSize)
+                {
+                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", batchEntries[i].contentSizeStr);
+                    uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, HIGHLIGHT_FONT_COLOR_RGB, strbuf);
+                }
+            } else {
+                uiDrawString(xpos, ypos, FONT_COLOR_RGB, batchEntries[i].truncatedNspFilename);
+                
+                if (batchEntries[i].contentSize)
+                {
+                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", batchEntries[i].contentSizeStr);
+                    uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, FONT_COLOR_RGB, strbuf);
+                }
+            }
+            
+            if (i == selectedSummaryEntry) highlight = false;
+        }
+        
+        while(true)
+        {
+            uiUpdateStatusMsg();
+            uiRefreshDisplay();
+            
+            scanPads();
+            
+            keysDown = getButtonsDown();
+            keysHeld = getButtonsHeld();
+            
+            if (keysDown || keysHeld) break;
+        }
+        
+        // Exit
+        if (keysDown & HidNpadButton_Plus)
+        {
+            ret = -2;
+            proceed = false;
+            break;
+        }
+        
+        // Start batch dump process
+        if (keysDown & HidNpadButton_A)
+        {
+            // Check if we have at least a single enabled entry
+            for(i = 0; i < totalTitleCount; i++)
+            {
+                if (batchEntries[i].enabled) break;
+            }
+            
+            if (i < totalTitleCount)
+            {
+                proceed = true;
+                break;
+            } else {
+                uiStatusMsg("Please enable at least one entry from the list.");
+            }
+        }
+        
+        // Cancel batch dump process
+        if (keysDown & HidNpadButton_B)
+        {
+            proceed = false;
+            break;
+        }
+        
+        // Toggle selected entry
+        if (keysDown & HidNpadButton_Y) batchEntries[selectedSummaryEntry].enabled ^= 0x01;
+        
+        // Disable all entries
+        if (keysDown & HidNpadButton_L)
+        {
+            for(i = 0; i < totalTitleCount; i++) batchEntries[i].enabled = false;
+        }
+        
+        // Enable all entries
+        if (keysDown & HidNpadButton_R)
+        {
+            for(i = 0; i < totalTitleCount; i++) batchEntries[i].enabled = true;
+        }
+        
+        // Change page (left)
+        if ((keysDown & HidNpadButton_ZL) && totalTitleCount > maxSummaryFileCount)
+        {
+            if (summaryPage > 0)
+            {
+                summaryPage--;
+                selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
+            }
+        }
+        
+        // Change page (right)
+        if ((keysDown & HidNpadButton_ZR) && totalTitleCount > maxSummaryFileCount)
+        {
+            if (((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount)
+            {
+                summaryPage++;
+                selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
+            }
+        }
+        
+        // Go up
+        if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp) || (keysHeld & HidNpadButton_StickRUp))
+        {
+            if (selectedSummaryEntry > (summaryPage * maxSummaryFileCount))
+            {
+                selectedSummaryEntry--;
+            } else {
+                if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp))
+                {
+                    if (((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount)
+                    {
+                        selectedSummaryEntry = (((summaryPage + 1) * maxSummaryFileCount) - 1);
+                    } else {
+                        selectedSummaryEntry = (totalTitleCount - 1);
+                    }
+                }
+            }
+        }
+        
+        // Go down
+        if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown) || (keysHeld & HidNpadButton_StickRDown))
+        {
+            if (((((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount) && selectedSummaryEntry < (((summaryPage + 1) * maxSummaryFileCount) - 1)) || ((((summaryPage + 1) * maxSummaryFileCount) >= totalTitleCount) && selectedSummaryEntry < (totalTitleCount - 1)))
+            {
+                selectedSummaryEntry++;
+            } else {
+                if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown))
+                {
+                    selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
+                }
+            }
+        }
+    }
     
-    u32 totalTitleCount = 0, totalAppCount = 0, totalPatchCount = 0, totalAddOnCount = 0;
+    uiClearStatusMsg();
     
-    u32 titleCount = 0, titleIndex = 0;
+    breaks = initial_breaks;
+    uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
     
-    char *dumpName = NULL;
-    char summary_str[128] = {'\0'};
+    if (!proceed)
+    {
+        if (ret != -2)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled");
+            breaks += 2;
+        }
+        
+        goto out;
+    }
     
-    int initial_breaks = breaks, cur_breaks;
+    // Calculate the disabled entry count
+    for(i = 0; i < totalTitleCount; i++)
+    {
+        if (!batchEntries[i].enabled) disabledEntryCount++;
+    }
     
-    const u32 maxSummaryFileCount = 8;
-    u32 summaryPage = 0, selectedSummaryEntry = 0;
-    u32 xpos = 0, ypos = 0;
-    u64 keysDown = 0, keysHeld = 0;
+    // Start dump process
+    dumpStartMsg();
     
-    u32 maxEntryCount = 0, batchEntryIndex = 0, disabledEntryCount = 0;
-    batchEntry *batchEntries = NULL, *tmpBatchEntries = NULL;
+    formatETAString(getBatchDumpTimeEstimate(batchEntries, totalTitleCount), strbuf, MAX_CHARACTERS(strbuf));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Estimated total dump time: %s.", strbuf);
+    breaks++;
     
-    bool proceed = true;
+    uiRefreshDisplay();
+    breaks++;
     
-    // Generate NSP configuration struct
-    nspOptions nspDumpCfg;
+    changeHomeButtonBlockStatus(true);
     
-    nspDumpCfg.isFat32 = isFat32;
-    nspDumpCfg.useNoIntroLookup = false;
-    nspDumpCfg.removeConsoleData = removeConsoleData;
-    nspDumpCfg.tiklessDump = tiklessDump;
-    nspDumpCfg.npdmAcidRsaPatch = npdmAcidRsaPatch;
-    nspDumpCfg.dumpDeltaFragments = dumpDeltaFragments;
-    nspDumpCfg.useBrackets = useBrackets;
+    initial_breaks = breaks;
+    
+    // SD card and eMMC titles come from different storage devices, so the next title can be read while the current one is being written
+    if (batchModeSrc == BATCH_SOURCE_ALL && batchReadAheadInit(&readAhead, dumpDeltaFragments)) nspReadAhead = &readAhead;
+    
+    j = 0;
+    
+    for(i = 0; i < totalTitleCount; i++)
+    {
+        if (!batchEntries[i].enabled) continue;
+        
+        if (nspReadAhead) batchReadAheadUpdate(nspReadAhead, batchEntries, totalTitleCount, i);
+        
+        breaks = initial_breaks;
+        
+        uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Title: %.*s [%u / %u].", strlen(batchEntries[i].nspFilename) - 4, batchEntries[i].nspFilename, j + 1, totalTitleCount - disabledEntryCount);
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
+        breaks++;
+        
+        uiRefreshDisplay();
+        
+        // Dump title
+        int nspRet = dumpNintendoSubmissionPackage(batchEntries[i].titleType, batchEntries[i].titleIndex, &nspDumpCfg, true);
+        
+        // Release any read-ahead data that wasn't used
+        if (nspReadAhead) batchReadAheadDiscard(nspReadAhead, i);
+        
+        if (nspRet >= 0)
+        {
+            // Create override file if necessary
+            if (rememberDumpedTitles)
+            {
+                snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s", BATCH_OVERRIDES_PATH, batchEntries[i].nspFilename);
+                FILE *overrideFile = fopen(strbuf, "wb");
+                if (overrideFile) fclose(overrideFile);
+            }
+        } else {
+            // If "Halt dump process on errors" is disabled, just wait a little bit and keep going (unless the process was truly canceled by the user)
+            if (!haltOnErrors && nspRet != -2)
+            {
+                delay(5);
+            } else {
+                goto out;
+            }
+        }
+        
+        // Update free space
+        updateFreeSpace();
+        
+        j++;
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed!");
+    breaks += 2;
+    
+    ret = 0;
+    
+out:
+    nspReadAhead = NULL;
+    batchReadAheadFree(&readAhead);
+    
+    if (batchEntries) free(batchEntries);
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return ret;
+}
+
+bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].size)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump raw HFS0 partition!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    Result result;
+    u64 partitionOffset;
+    bool success = false, fat32_error = false;
+    u64 n = DUMP_BUFFER_SIZE;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    openIStoragePartition storageIndex;
+    
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
+    
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
+    char *dumpName = generateGameCardDumpName(false);
+    if (!dumpName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    // The IStorage instance returned for partition == 0 contains the gamecard header, the gamecard certificate, the root HFS0 header and:
+    // * The "update" (0) partition and the "normal" (1) partition (for gamecard type 0x01)
+    // * The "update" (0) partition, the "logo" (1) partition and the "normal" (2) partition (for gamecard type 0x02)
+    // The IStorage instance returned for partition == 1 contains the "secure" partition (which can either be 2 or 3 depending on the gamecard type)
+    // This makes sure we just dump the *actual* raw HFS0 partition, without preceding data, padding, etc.
+    // Oddly enough, IFileSystem instances actually point to the specified partition ID filesystem. I don't understand why it doesn't work like that for IStorage, but whatever
+    // NOTE: Using partition == 2 returns error 0x149002, and using higher values probably do so, too
+    partitionOffset = gameCardInfo.hfs0Partitions[partition].offset; // Relative to IStorage instance
+    progressCtx.totalSize = gameCardInfo.hfs0Partitions[partition].size;
+    storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "HFS0 partition size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
+    
+    // Check if a previous dump was interrupted
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    if (dumpJournalLoad(&journal, dumpPath, DUMP_JOURNAL_TYPE_RAW_HFS0, progressCtx.totalSize) && dumpJournalResumePrompt(&journal, false)) doSplitting = (journal.header.splitMode != OUTPUT_SPLIT_NONE);
+    
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), 0);
+    } else {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    }
+    
+    // Check if the dump already exists
+    if (!journal.resume && checkIfFileExists(dumpPath))
+    {
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
+        
+        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            goto out;
+        } else {
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+        }
+    }
+    
+    result = openGameCardStoragePartition(storageIndex);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
+        goto out;
+    }
+    
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(TRANSFER_SOURCE_GAMECARD);
+    n = getTransferChunkSize(TRANSFER_SOURCE_GAMECARD);
+    
+    // The output writer takes care of the part file naming
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    
+    outputSplitMode splitMode = ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting) ? OUTPUT_SPLIT_SUFFIX : OUTPUT_SPLIT_NONE);
+    
+    if (journal.resume)
+    {
+        if (!outputWriterResume(&writer, dumpPath, splitMode, progressCtx.totalSize, SPLIT_FILE_GENERIC_PART_SIZE, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to resume interrupted dump: %s", __func__, writer.errorStr);
+            dumpJournalRemove(&journal);
+            goto out;
+        }
+    } else {
+        if (!outputWriterOpen(&writer, dumpPath, splitMode, progressCtx.totalSize, SPLIT_FILE_GENERIC_PART_SIZE, 0, 0, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            goto out;
+        }
+    }
+    
+    // Start dump process
+    dumpStartMsg();
+    transferChunkSizeMsg(TRANSFER_SOURCE_GAMECARD);
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
     
-    // Allocate memory for the batch entries
-    if (dumpAppTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
-    if (dumpPatchTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titlePatchCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitlePatchCount : emmcTitlePatchCount));
-    if (dumpAddOnTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAddOnCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
+    changeHomeButtonBlockStatus(true);
     
-    batchEntries = calloc(maxEntryCount, sizeof(batchEntry));
-    if (!batchEntries)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for batch entries!", __func__);
-        breaks += 2;
-        return ret;
-    }
+    progressCtx.line_offset = (breaks + 2);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    for(i = 0; i < 3; i++)
+    for (progressCtx.curOffset = writer.curOffset; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
     {
-        if ((i == 0 && !dumpAppTitles) || (i == 1 && !dumpPatchTitles) || (i == 2 && !dumpAddOnTitles)) continue;
+        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        u32 emmcRefTitleCount = 0;
-        nspDumpType curNspDumpType = DUMP_APP_NSP;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/' ) + 1);
         
-        switch(i)
+        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
+        
+        result = readGameCardStoragePartitionStream(partitionOffset + progressCtx.curOffset, &dumpBuf, n);
+        if (R_FAILED(result))
         {
-            case 0:
-                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
-                emmcRefTitleCount = sdCardTitleAppCount;
-                curNspDumpType = DUMP_APP_NSP;
-                break;
-            case 1:
-                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titlePatchCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitlePatchCount : emmcTitlePatchCount));
-                emmcRefTitleCount = sdCardTitlePatchCount;
-                curNspDumpType = DUMP_PATCH_NSP;
-                break;
-            case 2:
-                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titleAddOnCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
-                emmcRefTitleCount = sdCardTitleAddOnCount;
-                curNspDumpType = DUMP_ADDON_NSP;
-                break;
-            default:
-                break;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, partitionOffset + progressCtx.curOffset, storageIndex - 1, result);
+            break;
         }
         
-        for(j = 0; j < titleCount; j++)
+        if (!outputWriterWrite(&writer, dumpBuf, n))
         {
-            titleIndex = ((batchModeSrc == BATCH_SOURCE_ALL || batchModeSrc == BATCH_SOURCE_SDCARD) ? j : (j + emmcRefTitleCount));
-            
-            dumpName = generateNSPDumpName(curNspDumpType, titleIndex, false);
-            if (!dumpName)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-                breaks += 2;
-                goto out;
-            }
-            
-            // Check if an override file already exists for this dump
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", BATCH_OVERRIDES_PATH, dumpName);
-            
-            if (checkIfFileExists(strbuf))
-            {
-                free(dumpName);
-                dumpName = NULL;
-                continue;
-            }
-            
-            snprintf(batchEntries[batchEntryIndex].nspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].nspFilename), strrchr(strbuf, '/') + 1);
-            snprintf(batchEntries[batchEntryIndex].truncatedNspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].truncatedNspFilename), batchEntries[batchEntryIndex].nspFilename);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
             
-            if (useBrackets)
+            if (writer.splitMode == OUTPUT_SPLIT_NONE && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
             {
-                // Generate output name with brackets
-                free(dumpName);
-                dumpName = NULL;
-                
-                dumpName = generateNSPDumpName(curNspDumpType, titleIndex, true);
-                if (!dumpName)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name with brackets!", __func__);
-                    breaks += 2;
-                    goto out;
-                }
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
             }
             
-            // Check if this title has already been dumped
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-            
-            free(dumpName);
-            dumpName = NULL;
-            
-            if (skipDumpedTitles && checkIfFileExists(strbuf)) continue;
-            
-            // Save title properties
-            batchEntries[batchEntryIndex].enabled = true;
-            batchEntries[batchEntryIndex].titleType = curNspDumpType;
-            batchEntries[batchEntryIndex].titleIndex = titleIndex;
-            batchEntries[batchEntryIndex].contentSize = (i == 0 ? baseAppEntries[titleIndex].contentSize : (i == 1 ? patchEntries[titleIndex].contentSize : addOnEntries[titleIndex].contentSize));
-            batchEntries[batchEntryIndex].contentSizeStr = (i == 0 ? baseAppEntries[titleIndex].contentSizeStr : (i == 1 ? patchEntries[titleIndex].contentSizeStr : addOnEntries[titleIndex].contentSizeStr));
-            
-            // Fix entry name length
-            truncateBrowserEntryName(batchEntries[batchEntryIndex].truncatedNspFilename);
-            
-            // Increase batch entry index
-            batchEntryIndex++;
-            
-            // Increase total base application count
-            if (i == 0) totalAppCount++;
-            
-            // Increase total patch count
-            if (i == 1) totalPatchCount++;
-            
-            // Increase total addon count
-            if (i == 2) totalAddOnCount++;
+            break;
+        }
+        
+        // Periodically record the dump progress, so it can be resumed if the process gets interrupted
+        if (!dumpJournalCheckpoint(&journal, &writer, progressCtx.curOffset + n, NULL, 0, false))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            break;
+        }
+        
+        printProgressBar(&progressCtx, true, n);
+        
+        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            break;
         }
     }
     
-    // Calculate total title count
-    totalTitleCount = (totalAppCount + totalPatchCount + totalAddOnCount);
-    if (!totalTitleCount)
+    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
+    
+    // Support empty files
+    if (!progressCtx.totalSize)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "You have already dumped all titles matching the selected settings!");
-        breaks += 2;
-        goto out;
+        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/' ) + 1);
+        
+        progressCtx.progress = 100;
+        
+        printProgressBar(&progressCtx, false, 0);
     }
     
-    // Sort batch entries by name
-    qsort(batchEntries, totalTitleCount, sizeof(batchEntry), batchEntryCmp);
+    breaks = (progressCtx.line_offset + 2);
     
-    if (totalTitleCount < maxEntryCount)
+    if (success)
     {
-        tmpBatchEntries = realloc(batchEntries, totalTitleCount * sizeof(batchEntry));
-        if (!tmpBatchEntries)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: failed to reallocate batch entries!", __func__);
-            breaks += 2;
-            goto out;
-        }
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
         
-        batchEntries = tmpBatchEntries;
-        tmpBatchEntries = NULL;
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+        
+        dumpJournalRemove(&journal);
+    } else {
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
+        
+        // Keep the partial dump, so it can be resumed later
+        if (journal.saved) dumpJournalKeptMsg();
     }
     
-    // Display summary controls
-    if (totalTitleCount > maxSummaryFileCount)
+out:
+    outputWriterClose(&writer);
+    
+    dumpJournalFree(&journal);
+    
+    if (!success && !journal.saved)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_ZL " / " NINTENDO_FONT_ZR " ] Change page | [ " NINTENDO_FONT_A " ] Proceed | [ " NINTENDO_FONT_B " ] Cancel | [ " NINTENDO_FONT_Y " ] Toggle selected entry | [ "  NINTENDO_FONT_L " ] Disable all entries | [ " NINTENDO_FONT_R " ] Enable all entries\n[ " NINTENDO_FONT_PLUS " ] Exit");
-    } else {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Proceed | [ " NINTENDO_FONT_B " ] Cancel | [ " NINTENDO_FONT_Y " ] Toggle selected entry | [ "  NINTENDO_FONT_L " ] Disable all entries | [ " NINTENDO_FONT_R " ] Enable all entries | [ " NINTENDO_FONT_PLUS " ] Exit");
+        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
+        {
+            for(u8 i = 0; i <= writer.partIndex; i++)
+            {
+                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), i);
+                remove(dumpPath);
+            }
+        } else {
+            remove(dumpPath);
+        }
     }
     
-    breaks += 2;
+    closeGameCardStoragePartition();
     
-    // Display free space
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
-    breaks += 2;
+    if (dumpName) free(dumpName);
     
-    // Display summary
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Summary:");
     breaks += 2;
     
-    if (totalAppCount)
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
+}
+
+// Read window over the IStorage partition, shared by all the files copied from the same HFS0 partition
+// Files are stored back to back, so the tail of a chunk read for one file holds the head of the next one. This lets the whole partition be read in a single sequential pass
+typedef struct {
+    u64 offset;                                     // IStorage partition offset of the data currently held in dumpBuf
+    u64 size;                                       // Zero if the window is empty
+    u64 end;                                        // End offset of the last file from the partition. Reads never go past it
+} hfs0SweepWindow;
+
+bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *source, const u64 fileOffset, const u64 fileSize, progress_ctx_t *progressCtx, bool doSplitting, dumpJournal *journal, hfs0SweepWindow *window)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !dest || !strlen(dest) || !source || !strlen(source) || !progressCtx)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "BASE: %u", totalAppCount);
-        strcat(summary_str, strbuf);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to copy file from HFS0 partition!", __func__);
+        return false;
     }
     
-    if (totalPatchCount)
+    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
     {
-        if (totalAppCount) strcat(summary_str, " | ");
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "UPD: %u", totalPatchCount);
-        strcat(summary_str, strbuf);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        return false;
     }
     
-    if (totalAddOnCount)
+    // IStorage handle must have been retrieved beforehand by the caller function
+    
+    Result result;
+    bool success = false, fat32_error = false;
+    char splitFilename[NAME_BUF_LEN * 3] = {'\0'};
+    size_t destLen = strlen(dest);
+    u64 off, n = 0, chunkSize = getTransferChunkSize(TRANSFER_SOURCE_GAMECARD);
+    u8 *chunkBuf = dumpBuf;
+    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
+    
+    // dumpBuf may already hold data for this file if a sweep window is used
+    if (!window) memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", source);
+    
+    if ((destLen + 4) >= MAX_CHARACTERS(writer.basePath))
     {
-        if (totalAppCount || totalPatchCount) strcat(summary_str, " | ");
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "DLC: %u", totalAddOnCount);
-        strcat(summary_str, strbuf);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: destination path is too long! (%lu bytes)", __func__, destLen);
+        return false;
     }
     
-    strcat(summary_str, " | ");
-    snprintf(strbuf, MAX_CHARACTERS(strbuf), "Total: %u", totalTitleCount);
-    strcat(summary_str, strbuf);
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, summary_str);
-    breaks++;
+    if (!dumpJournalOpenOutputFile(journal, &writer, dest, ((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? OUTPUT_SPLIT_SUFFIX : OUTPUT_SPLIT_NONE), fileSize, SPLIT_FILE_GENERIC_PART_SIZE, progressCtx))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+        goto out;
+    }
     
-    while(true)
+    for (off = writer.curOffset; off < fileSize; off += n, progressCtx->curOffset += n)
     {
-        cur_breaks = breaks;
-        
-        uiFill(0, 8 + (cur_breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (cur_breaks * LINE_HEIGHT)), BG_COLOR_RGB);
-        
-        // Calculate the number of selected titles
-        j = 0;
-        u64 totalOutSize = 0;
-        char totalOutSizeStr[32] = {'\0'};
-        
-        for(i = 0; i < totalTitleCount; i++)
-        {
-            if (batchEntries[i].enabled)
-            {
-                j++;
-                totalOutSize += batchEntries[i].contentSize;
-            }
-        }
-        
-        convertSize(totalOutSize, totalOutSizeStr, MAX_CHARACTERS(totalOutSizeStr));
+        uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        if (totalTitleCount > maxSummaryFileCount)
-        {
-            if (j && totalOutSize)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Current page: %u | Selected titles: %u | Approximate total dump size: %s (%lu bytes)", summaryPage + 1, j, totalOutSizeStr, totalOutSize);
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Current page: %u | Selected titles: %u", summaryPage + 1, j);
-            }
-        } else {
-            if (j && totalOutSize)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Selected titles: %u | Approximate total dump size: %s (%lu bytes)", j, totalOutSizeStr, totalOutSize);
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Selected titles: %u", j);
-            }
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
         
-        cur_breaks += 2;
+        uiRefreshDisplay();
         
-        j = 0;
-        highlight = false;
+        n = chunkSize;
+        if (n > (fileSize - off)) n = (fileSize - off);
         
-        for(i = (summaryPage * maxSummaryFileCount); i < ((summaryPage + 1) * maxSummaryFileCount); i++, j++)
+        if (window)
         {
-            if (i >= totalTitleCount) break;
-            
-            xpos = STRING_X_POS;
-            ypos = (8 + (cur_breaks * LINE_HEIGHT) + (j * (font_height + 12)) + 6);
-            
-            if (i == selectedSummaryEntry)
-            {
-                highlight = true;
-                uiFill(0, ypos - 6, FB_WIDTH, font_height + 12, HIGHLIGHT_BG_COLOR_RGB);
-            }
-            
-            uiDrawIcon((highlight ? (batchEntries[i].enabled ? enabledHighlightIconBuf : disabledHighlightIconBuf) : (batchEntries[i].enabled ? enabledNormalIconBuf : disabledNormalIconBuf)), BROWSER_ICON_DIMENSION, BROWSER_ICON_DIMENSION, xpos, ypos);
-            xpos += (BROWSER_ICON_DIMENSION + 8);
-            
-            if (highlight)
+            // Only read from the IStorage partition if the current file offset isn't already covered by the sweep window
+            if ((fileOffset + off) < window->offset || (fileOffset + off) >= (window->offset + window->size))
             {
-                uiDrawString(xpos, ypos, HIGHLIGHT_FONT_COLOR_RGB, batchEntries[i].truncatedNspFilename);
+                u64 sweepEnd = (window->end > (fileOffset + fileSize) ? window->end : (fileOffset + fileSize));
                 
-                if (batchEntries[i].contentSize)
-                {
-                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", batchEntries[i].contentSizeStr);
-                    uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, HIGHLIGHT_FONT_COLOR_RGB, strbuf);
-                }
-            } else {
-                uiDrawString(xpos, ypos, FONT_COLOR_RGB, batchEntries[i].truncatedNspFilename);
+                window->offset = (fileOffset + off);
+                window->size = ((sweepEnd - window->offset) < chunkSize ? (sweepEnd - window->offset) : chunkSize);
                 
-                if (batchEntries[i].contentSize)
+                result = readGameCardStoragePartitionStream(window->offset, &dumpBuf, window->size);
+                if (R_FAILED(result))
                 {
-                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", batchEntries[i].contentSizeStr);
-                    uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, FONT_COLOR_RGB, strbuf);
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, window->size, window->offset, storageIndex - 1, result);
+                    window->size = 0;
+                    break;
                 }
             }
             
-            if (i == selectedSummaryEntry) highlight = false;
-        }
-        
-        while(true)
-        {
-            uiUpdateStatusMsg();
-            uiRefreshDisplay();
-            
-            scanPads();
-            
-            keysDown = getButtonsDown();
-            keysHeld = getButtonsHeld();
+            chunkBuf = (dumpBuf + ((fileOffset + off) - window->offset));
+            if (n > ((window->offset + window->size) - (fileOffset + off))) n = ((window->offset + window->size) - (fileOffset + off));
+        } else {
+            result = readGameCardStoragePartitionStream(fileOffset + off, &dumpBuf, n);
+            if (R_FAILED(result))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, fileOffset + off, storageIndex - 1, result);
+                break;
+            }
             
-            if (keysDown || keysHeld) break;
-        }
-        
-        // Exit
-        if (keysDown & HidNpadButton_Plus)
-        {
-            ret = -2;
-            proceed = false;
-            break;
+            // The read-ahead may have swapped dumpBuf
+            chunkBuf = dumpBuf;
         }
         
-        // Start batch dump process
-        if (keysDown & HidNpadButton_A)
+        if (!outputWriterWrite(&writer, chunkBuf, n))
         {
-            // Check if we have at least a single enabled entry
-            for(i = 0; i < totalTitleCount; i++)
-            {
-                if (batchEntries[i].enabled) break;
-            }
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
             
-            if (i < totalTitleCount)
+            if (writer.splitMode == OUTPUT_SPLIT_NONE && (off + n) > FAT32_FILESIZE_LIMIT)
             {
-                proceed = true;
-                break;
-            } else {
-                uiStatusMsg("Please enable at least one entry from the list.");
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
             }
+            
+            break;
         }
         
-        // Cancel batch dump process
-        if (keysDown & HidNpadButton_B)
+        if (journal && !dumpJournalCheckpoint(journal, &writer, progressCtx->curOffset + n, &doSplitting, sizeof(bool), false))
         {
-            proceed = false;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
             break;
         }
         
-        // Toggle selected entry
-        if (keysDown & HidNpadButton_Y) batchEntries[selectedSummaryEntry].enabled ^= 0x01;
+        printProgressBar(progressCtx, true, n);
         
-        // Disable all entries
-        if (keysDown & HidNpadButton_L)
+        if (((off + n) < fileSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
         {
-            for(i = 0; i < totalTitleCount; i++) batchEntries[i].enabled = false;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            break;
         }
+    }
+    
+    if (off >= fileSize) success = true;
+    
+    // Support empty files
+    if (!fileSize)
+    {
+        uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        // Enable all entries
-        if (keysDown & HidNpadButton_R)
-        {
-            for(i = 0; i < totalTitleCount; i++) batchEntries[i].enabled = true;
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dest, '/') + 1);
         
-        // Change page (left)
-        if ((keysDown & HidNpadButton_ZL) && totalTitleCount > maxSummaryFileCount)
-        {
-            if (summaryPage > 0)
-            {
-                summaryPage--;
-                selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
-            }
-        }
+        if (progressCtx->totalSize == fileSize) progressCtx->progress = 100;
         
-        // Change page (right)
-        if ((keysDown & HidNpadButton_ZR) && totalTitleCount > maxSummaryFileCount)
+        printProgressBar(progressCtx, false, 0);
+    }
+    
+    if (!success)
+    {
+        setProgressBarError(progressCtx);
+        breaks = (progressCtx->line_offset + 2);
+        if (fat32_error) breaks += 2;
+    }
+    
+out:
+    outputWriterClose(&writer);
+    
+    // Partial output files referenced by the dump journal are kept
+    if (!success && !(journal && journal->saved))
+    {
+        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting)
         {
-            if (((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount)
+            for(u8 i = 0; i <= writer.partIndex; i++)
             {
-                summaryPage++;
-                selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
+                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, i);
+                remove(splitFilename);
             }
+        } else {
+            remove(dest);
         }
+    }
+    
+    breaks += 2;
+    
+    return success;
+}
+
+bool copyHfs0PartitionContents(u32 partition, progress_ctx_t *progressCtx, const char *dest, bool splitting, dumpJournal *journal)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !progressCtx || !dest || !strlen(dest))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to copy HFS0 partition contents!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    Result result;
+    char dbuf[NAME_BUF_LEN * 2] = {'\0'};
+    hfs0_file_entry entry;
+    size_t dest_len = strlen(dest);
+    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    
+    u32 i;
+    bool success = false;
+    
+    hfs0SweepWindow window;
+    memset(&window, 0, sizeof(hfs0SweepWindow));
+    
+    if ((dest_len + 1) >= MAX_CHARACTERS(dbuf))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: destination directory name is too long! (%lu bytes)", __func__, dest_len);
+        breaks += 2;
+        return false;
+    }
+    
+    snprintf(dbuf, MAX_CHARACTERS(dbuf), dest);
+    mkdir(dbuf, 0744);
+    
+    dbuf[dest_len] = '/';
+    dest_len++;
+    
+    result = openGameCardStoragePartition(storageIndex);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
+        breaks += 2;
+        return false;
+    }
+    
+    // Get the end offset from the last file stored in the partition, so the sweep window never reads past the file data
+    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
+    {
+        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
         
-        // Go up
-        if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp) || (keysHeld & HidNpadButton_StickRUp))
-        {
-            if (selectedSummaryEntry > (summaryPage * maxSummaryFileCount))
-            {
-                selectedSummaryEntry--;
-            } else {
-                if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp))
-                {
-                    if (((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount)
-                    {
-                        selectedSummaryEntry = (((summaryPage + 1) * maxSummaryFileCount) - 1);
-                    } else {
-                        selectedSummaryEntry = (totalTitleCount - 1);
-                    }
-                }
-            }
-        }
+        u64 fileEnd = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset + entry.file_size);
+        if (fileEnd > window.end) window.end = fileEnd;
+    }
+    
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx->start));
+    
+    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
+    {
+        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
         
-        // Go down
-        if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown) || (keysHeld & HidNpadButton_StickRDown))
+        char *filename = (char*)(gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (gameCardInfo.hfs0Partitions[partition].file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
+        
+        dbuf[dest_len] = '\0';
+        strcat(dbuf, filename);
+        removeIllegalCharacters(dbuf + dest_len);
+        
+        u64 fileOffset = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset);
+        
+        if (dumpJournalSkipOutputFile(journal, entry.file_size, progressCtx))
         {
-            if (((((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount) && selectedSummaryEntry < (((summaryPage + 1) * maxSummaryFileCount) - 1)) || ((((summaryPage + 1) * maxSummaryFileCount) >= totalTitleCount) && selectedSummaryEntry < (totalTitleCount - 1)))
-            {
-                selectedSummaryEntry++;
-            } else {
-                if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown))
-                {
-                    selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
-                }
-            }
+            success = true;
+            continue;
         }
+        
+        success = copyFileFromHfs0Partition(partition, dbuf, filename, fileOffset, entry.file_size, progressCtx, splitting, journal, &window);
+        if (!success) break;
+    }
+    
+    closeGameCardStoragePartition();
+    
+    return success;
+}
+
+bool dumpHfs0PartitionData(u32 partition, bool doSplitting)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump HFS0 partition data!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        breaks += 2;
+        return false;
     }
     
-    uiClearStatusMsg();
+    u32 i;
+    hfs0_file_entry entry;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
     
-    breaks = initial_breaks;
-    uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    if (!proceed)
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
+    bool success = false;
+    
+    char *dumpName = generateGameCardDumpName(false);
+    if (!dumpName)
     {
-        if (ret != -2)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled");
-            breaks += 2;
-        }
-        
-        goto out;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        breaks += 2;
+        return false;
     }
     
-    // Calculate the disabled entry count
-    for(i = 0; i < totalTitleCount; i++)
+    // Calculate total size
+    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
     {
-        if (!batchEntries[i].enabled) disabledEntryCount++;
+        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+        progressCtx.totalSize += entry.file_size;
+    }
+    
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total partition data size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
+    
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s)", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    
+    dumpJournalLoadFileDump(&journal, dumpPath, DUMP_JOURNAL_TYPE_HFS0_DATA, progressCtx.totalSize, &doSplitting);
+    
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
     }
     
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(TRANSFER_SOURCE_GAMECARD);
+    
     // Start dump process
     dumpStartMsg();
+    transferChunkSizeMsg(TRANSFER_SOURCE_GAMECARD);
+    appletModeOperationWarning();
     uiRefreshDisplay();
     breaks++;
     
     changeHomeButtonBlockStatus(true);
     
-    initial_breaks = breaks;
+    progressCtx.line_offset = (breaks + 4);
     
-    j = 0;
+    success = copyHfs0PartitionContents(partition, &progressCtx, dumpPath, doSplitting, &journal);
     
-    for(i = 0; i < totalTitleCount; i++)
+    if (success)
     {
-        if (!batchEntries[i].enabled) continue;
-        
-        breaks = initial_breaks;
-        
-        uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+        dumpJournalRemove(&journal);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Title: %.*s [%u / %u].", strlen(batchEntries[i].nspFilename) - 4, batchEntries[i].nspFilename, j + 1, totalTitleCount - disabledEntryCount);
-        breaks++;
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
-        breaks++;
+        breaks = (progressCtx.line_offset + 2);
         
-        uiRefreshDisplay();
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
         
-        // Dump title
-        int nspRet = dumpNintendoSubmissionPackage(batchEntries[i].titleType, batchEntries[i].titleIndex, &nspDumpCfg, true);
-        if (nspRet >= 0)
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+    } else {
+        if (journal.saved)
         {
-            // Create override file if necessary
-            if (rememberDumpedTitles)
-            {
-                snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s", BATCH_OVERRIDES_PATH, batchEntries[i].nspFilename);
-                FILE *overrideFile = fopen(strbuf, "wb");
-                if (overrideFile) fclose(overrideFile);
-            }
+            dumpJournalKeptMsg();
         } else {
-            // If "Halt dump process on errors" is disabled, just wait a little bit and keep going (unless the process was truly canceled by the user)
-            if (!haltOnErrors && nspRet != -2)
-            {
-                delay(5);
-            } else {
-                goto out;
-            }
+            removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
         }
-        
-        // Update free space
-        updateFreeSpace();
-        
-        j++;
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed!");
-    breaks += 2;
+out:
+    dumpJournalFree(&journal);
     
-    ret = 0;
+    free(dumpName);
     
-out:
-    if (batchEntries) free(batchEntries);
+    breaks += 2;
     
     changeHomeButtonBlockStatus(false);
     
-    return ret;
+    return success;
 }
 
-bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
+bool dumpFileFromHfs0Partition(u32 partition, u32 fileIndex, char *filename, bool doSplitting)
 {
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].size)
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !filename || !strlen(filename))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump raw HFS0 partition!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump file from HFS0 partition!", __func__);
         breaks += 2;
         return false;
     }
     
-    Result result;
-    u64 partitionOffset;
-    bool success = false, fat32_error = false;
-    u64 n = DUMP_BUFFER_SIZE;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    openIStoragePartition storageIndex;
+    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        breaks += 2;
+        return false;
+    }
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    if (fileIndex >= gameCardInfo.hfs0Partitions[partition].file_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid file index!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    Result result;
+    hfs0_file_entry entry;
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    size_t write_res;
+    u64 fileOffset = 0;
+    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    
+    char destCopyPath[NAME_BUF_LEN * 2] = {'\0'};
+    
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
+    bool success = false;
     
     char *dumpName = generateGameCardDumpName(false);
     if (!dumpName)
@@ -3027,204 +5169,95 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
         return false;
     }
     
-    // The IStorage instance returned for partition == 0 contains the gamecard header, the gamecard certificate, the root HFS0 header and:
-    // * The "update" (0) partition and the "normal" (1) partition (for gamecard type 0x01)
-    // * The "update" (0) partition, the "logo" (1) partition and the "normal" (2) partition (for gamecard type 0x02)
-    // The IStorage instance returned for partition == 1 contains the "secure" partition (which can either be 2 or 3 depending on the gamecard type)
-    // This makes sure we just dump the *actual* raw HFS0 partition, without preceding data, padding, etc.
-    // Oddly enough, IFileSystem instances actually point to the specified partition ID filesystem. I don't understand why it doesn't work like that for IStorage, but whatever
-    // NOTE: Using partition == 2 returns error 0x149002, and using higher values probably do so, too
-    partitionOffset = gameCardInfo.hfs0Partitions[partition].offset; // Relative to IStorage instance
-    progressCtx.totalSize = gameCardInfo.hfs0Partitions[partition].size;
-    storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (fileIndex * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+    
+    fileOffset = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset);
     
+    progressCtx.totalSize = entry.file_size;
     convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "HFS0 partition size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks += 2;
     
-    if (progressCtx.totalSize > freeSpace)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
-    }
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
     
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
-    {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), splitIndex);
-    } else {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
-    }
+    snprintf(destCopyPath, MAX_CHARACTERS(destCopyPath), "%s%s - Partition %u (%s)", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    mkdir(destCopyPath, 0744);
     
-    // Check if the dump already exists
-    if (checkIfFileExists(dumpPath))
-    {
-        // Ask the user if they want to proceed anyway
-        int cur_breaks = breaks;
-        
-        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            goto out;
-        } else {
-            // Remove the prompt from the screen
-            breaks = cur_breaks;
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
-        }
-    }
+    strcat(destCopyPath, "/");
+    size_t cur_len = strlen(destCopyPath);
+    strcat(destCopyPath, filename);
+    removeIllegalCharacters(destCopyPath + cur_len);
     
-    result = openGameCardStoragePartition(storageIndex);
-    if (R_FAILED(result))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
-        goto out;
-    }
+    dumpJournalLoadFileDump(&journal, destCopyPath, DUMP_JOURNAL_TYPE_HFS0_FILE, progressCtx.totalSize, &doSplitting);
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
-    
-    // Start dump process
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    progressCtx.line_offset = (breaks + 2);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
-    
-    for (progressCtx.curOffset = 0; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
-    {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-        
-        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
-        
-        result = readGameCardStoragePartition(partitionOffset + progressCtx.curOffset, dumpBuf, n);
-        if (R_FAILED(result))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, partitionOffset + progressCtx.curOffset, storageIndex - 1, result);
-            break;
-        }
-        
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
-        {
-            u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
-            
-            if (old_file_chunk_size > 0)
-            {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                    break;
-                }
-            }
-            
-            fclose(outFile);
-            outFile = NULL;
-            
-            if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
-            {
-                splitIndex++;
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), splitIndex);
-                
-                outFile = fopen(dumpPath, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
-                
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
-        } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                
-                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
-            }
-        }
-        
-        printProgressBar(&progressCtx, true, n);
+    
+    // Check if the dump already exists
+    if (!journal.resume && checkIfFileExists(destCopyPath))
+    {
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
         
-        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            break;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            goto out;
+        } else {
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
         }
     }
     
-    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
-    
-    // Support empty files
-    if (!progressCtx.totalSize)
+    result = openGameCardStoragePartition(storageIndex);
+    if (R_FAILED(result))
     {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-        
-        progressCtx.progress = 100;
-        
-        printProgressBar(&progressCtx, false, 0);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
+        goto out;
     }
     
-    breaks = (progressCtx.line_offset + 2);
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(TRANSFER_SOURCE_GAMECARD);
+    
+    // Start dump process
+    dumpStartMsg();
+    transferChunkSizeMsg(TRANSFER_SOURCE_GAMECARD);
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    success = copyFileFromHfs0Partition(partition, destCopyPath, filename, fileOffset, progressCtx.totalSize, &progressCtx, doSplitting, &journal, NULL);
+    
+    closeGameCardStoragePartition();
     
     if (success)
     {
+        dumpJournalRemove(&journal);
+        
+        breaks = (progressCtx.line_offset + 2);
+        
         timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
         progressCtx.now -= progressCtx.start;
         
         formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
     } else {
-        setProgressBarError(&progressCtx);
-        if (fat32_error) breaks += 2;
+        breaks -= 2;
+        if (journal.saved) dumpJournalKeptMsg();
     }
     
 out:
-    if (outFile) fclose(outFile);
-    
-    if (!success)
-    {
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
-        {
-            for(u8 i = 0; i <= splitIndex; i++)
-            {
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), i);
-                remove(dumpPath);
-            }
-        } else {
-            remove(dumpPath);
-        }
-    }
+    dumpJournalFree(&journal);
     
-    closeGameCardStoragePartition();
-    
-    if (dumpName) free(dumpName);
+    free(dumpName);
     
     breaks += 2;
     
@@ -3233,316 +5266,568 @@ out:
     return success;
 }
 
-bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *source, const u64 fileOffset, const u64 fileSize, progress_ctx_t *progressCtx, bool doSplitting)
+// Retrieves the output size for an ExeFS entry, taking the selected NSO export format into account
+// 'convert' is only set if the entry is a NSO that must be converted. In that case, its header is stored in 'nsoHeader'
+static bool getExeFsEntryExportInfo(u32 fileIndex, nsoExportFormat nsoExportFmt, nso_header_t *nsoHeader, bool *convert, u64 *outSize)
 {
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !dest || !strlen(dest) || !source || !strlen(source) || !progressCtx)
+    u64 fileSize = exeFsContext.exefs_entries[fileIndex].file_size;
+    
+    *convert = false;
+    *outSize = fileSize;
+    
+    if (nsoExportFmt == NSO_EXPORT_ORIGINAL || fileSize < sizeof(nso_header_t)) return true;
+    
+    if (!processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[fileIndex].file_offset, nsoHeader, sizeof(nso_header_t), false)) return false;
+    
+    // Leave other files (e.g. main.npdm) untouched
+    if (__builtin_bswap32(nsoHeader->magic) != NSO_MAGIC) return true;
+    
+    if (!getNsoExportSize(nsoHeader, fileSize, nsoExportFmt, outSize)) return false;
+    
+    *convert = true;
+    
+    return true;
+}
+
+bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
+{
+    if (!exeFsDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to copy file from HFS0 partition!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ExeFS configuration struct!", __func__);
+        breaks += 2;
         return false;
     }
     
-    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    bool isFat32 = exeFsDumpCfg->isFat32;
+    bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
+    nsoExportFormat nsoExportFmt = exeFsDumpCfg->nsoExportFmt;
+    
+    u32 i;
+    u64 n = 0, offset = 0, fileSize = 0;
+    bool proceed = true, success = false, fat32_error = false, convertNso = false;
+    
+    nso_header_t nsoHeader;
+    u8 *nsoExportBuf = NULL;
+    
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
+    
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
+    char *dumpName = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'}, curDumpPath[NAME_BUF_LEN * 2] = {'\0'};
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    if ((!usePatch && !titleAppCount) || (usePatch && !titlePatchCount))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title count!", __func__);
+        breaks += 2;
         return false;
     }
     
-    // IStorage handle must have been retrieved beforehand by the caller function
+    if ((!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        breaks += 2;
+        return false;
+    }
     
-    Result result;
-    bool success = false, fat32_error = false;
-    char splitFilename[NAME_BUF_LEN * 3] = {'\0'};
-    size_t destLen = strlen(dest);
-    FILE *outFile = NULL;
-    u64 off, n = DUMP_BUFFER_SIZE;
-    u8 splitIndex = 0;
-    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    if (!useLayeredFSDir)
+    {
+        dumpName = generateNSPDumpName((!usePatch ? DUMP_APP_NSP : DUMP_PATCH_NSP), titleIndex, false);
+        if (!dumpName)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+            breaks += 2;
+            return false;
+        }
+    }
     
-    size_t write_res;
+    // Retrieve ExeFS from Program NCA
+    if (!readNcaExeFsSection(titleIndex, usePatch))
+    {
+        if (dumpName) free(dumpName);
+        breaks += 2;
+        return false;
+    }
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    // Calculate total dump size
+    if (!calculateExeFsExtractedDataSize(&(progressCtx.totalSize))) goto out;
     
-    uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+    // Converted NSOs don't match the size of their ExeFS entries
+    if (nsoExportFmt != NSO_EXPORT_ORIGINAL)
+    {
+        progressCtx.totalSize = 0;
+        
+        for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
+        {
+            if (!getExeFsEntryExportInfo(i, nsoExportFmt, &nsoHeader, &convertNso, &fileSize)) goto out;
+            progressCtx.totalSize += fileSize;
+        }
+    }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", source);
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted ExeFS dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiRefreshDisplay();
+    breaks++;
     
-    if ((destLen + 1) >= MAX_CHARACTERS(splitFilename))
+    // Generate output path
+    if (!useLayeredFSDir)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: destination path is too long! (%lu bytes)", __func__, destLen);
-        return false;
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", EXEFS_DUMP_PATH, dumpName);
+        
+        if (exeFsContext.idOffset > 0)
+        {
+            sprintf(strbuf, " (ID offset #%u)", exeFsContext.idOffset);
+            strcat(dumpPath, strbuf);
+        }
+    } else {
+        mkdir(cfwDirStr, 0744);
+        
+        // Always use the base application title ID
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, (usePatch ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : baseAppEntries[titleIndex].titleId) + exeFsContext.idOffset);
+        mkdir(dumpPath, 0744);
+        
+        strcat(dumpPath, "/exefs");
     }
     
-    if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting) snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, splitIndex);
+    dumpJournalLoadFileDump(&journal, dumpPath, DUMP_JOURNAL_TYPE_EXEFS_DATA, progressCtx.totalSize, &isFat32);
     
-    outFile = fopen(((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? splitFilename : dest), "wb");
-    if (!outFile)
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
-    for (off = 0; off < fileSize; off += n, progressCtx->curOffset += n)
+    mkdir(dumpPath, 0744);
+    
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(getTransferSourceFromStorageId(exeFsContext.storageId));
+    
+    // Start dump process
+    breaks++;
+    dumpStartMsg();
+    transferChunkSizeMsg(getTransferSourceFromStorageId(exeFsContext.storageId));
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
     {
-        uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        n = getTransferChunkSize(getTransferSourceFromStorageId(exeFsContext.storageId));
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", ((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? (strrchr(splitFilename, '/') + 1) : (strrchr(dest, '/') + 1)));
+        char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset);
         
-        uiRefreshDisplay();
+        // Check if we're dealing with a nameless file
+        if (!strlen(exeFsFilename))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
+            break;
+        }
         
-        if (n > (fileSize - off)) n = (fileSize - off);
+        snprintf(curDumpPath, MAX_CHARACTERS(curDumpPath), "%s/%s", dumpPath, exeFsFilename);
+        removeIllegalCharacters(curDumpPath + strlen(dumpPath) + 1);
         
-        result = readGameCardStoragePartition(fileOffset + off, dumpBuf, n);
-        if (R_FAILED(result))
+        breaks = (progressCtx.line_offset + 2);
+        proceed = getExeFsEntryExportInfo(i, nsoExportFmt, &nsoHeader, &convertNso, &fileSize);
+        breaks = (progressCtx.line_offset - 4);
+        
+        if (!proceed) break;
+        
+        if (convertNso && nsoExportFmt == NSO_EXPORT_ELF) strcat(curDumpPath, ".elf");
+        
+        if (dumpJournalSkipOutputFile(&journal, fileSize, &progressCtx)) continue;
+        
+        if (!dumpJournalOpenOutputFile(&journal, &writer, curDumpPath, ((fileSize > FAT32_FILESIZE_LIMIT && isFat32) ? OUTPUT_SPLIT_DIRECTORY : OUTPUT_SPLIT_NONE), fileSize, SPLIT_FILE_GENERIC_PART_SIZE, &progressCtx))
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, fileOffset + off, storageIndex - 1, result);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
             break;
         }
         
-        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting && (off + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "%s \"%s\"...", (convertNso ? "Converting" : "Copying"), exeFsFilename);
+        
+        if (convertNso)
         {
-            u64 new_file_chunk_size = ((off + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
+            uiRefreshDisplay();
             
-            if (old_file_chunk_size > 0)
+            breaks = (progressCtx.line_offset + 2);
+            proceed = exportNso(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[i].file_offset, exeFsContext.exefs_entries[i].file_size, &nsoHeader, nsoExportFmt, &nsoExportBuf, &fileSize);
+            breaks = (progressCtx.line_offset - 4);
+            
+            if (!proceed)
             {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, off, splitIndex, write_res);
-                    break;
-                }
+                outputWriterClose(&writer);
+                break;
             }
+        }
+        
+        for(offset = writer.curOffset; offset < fileSize; offset += n, progressCtx.curOffset += n)
+        {
+            uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
             
-            fclose(outFile);
-            outFile = NULL;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
             
-            if (new_file_chunk_size > 0 || (off + n) < fileSize)
+            uiRefreshDisplay();
+            
+            if (n > (fileSize - offset)) n = (fileSize - offset);
+            
+            // Converted NSOs are already available in memory
+            if (!nsoExportBuf)
             {
-                splitIndex++;
-                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, splitIndex);
-                
-                outFile = fopen(splitFilename, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
+                breaks = (progressCtx.line_offset + 2);
+                proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[i].file_offset + offset, dumpBuf, n, false);
+                breaks = (progressCtx.line_offset - 4);
                 
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, off + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
+                if (!proceed) break;
             }
-        } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
+            
+            if (!outputWriterWrite(&writer, (nsoExportBuf ? (nsoExportBuf + offset) : dumpBuf), n))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, off, write_res);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
                 
-                if ((off + n) > FAT32_FILESIZE_LIMIT)
+                if (writer.splitMode == OUTPUT_SPLIT_NONE && (offset + n) > FAT32_FILESIZE_LIMIT)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
                     fat32_error = true;
                 }
                 
+                proceed = false;
+                break;
+            }
+            
+            if (!dumpJournalCheckpoint(&journal, &writer, progressCtx.curOffset + n, &isFat32, sizeof(bool), false))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+                proceed = false;
+                break;
+            }
+            
+            printProgressBar(&progressCtx, true, n);
+            
+            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                proceed = false;
                 break;
             }
         }
         
-        printProgressBar(progressCtx, true, n);
+        outputWriterClose(&writer);
         
-        if (((off + n) < fileSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
+        if (nsoExportBuf)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            break;
+            free(nsoExportBuf);
+            nsoExportBuf = NULL;
         }
-    }
-    
-    if (off >= fileSize) success = true;
-    
-    // Support empty files
-    if (!fileSize)
-    {
-        uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dest, '/') + 1);
+        if (!proceed) break;
         
-        if (progressCtx->totalSize == fileSize) progressCtx->progress = 100;
+        // Support empty files
+        if (!fileSize)
+        {
+            uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
+            
+            if (progressCtx.totalSize == fileSize) progressCtx.progress = 100;
+            
+            printProgressBar(&progressCtx, false, 0);
+        }
         
-        printProgressBar(progressCtx, false, 0);
+        // Set archive bit (only for FAT32)
+        if (writer.splitMode == OUTPUT_SPLIT_DIRECTORY) outputWriterSetArchiveBit(&writer);
     }
     
-    if (!success)
+    if (proceed)
     {
-        setProgressBarError(progressCtx);
-        breaks = (progressCtx->line_offset + 2);
-        if (fat32_error) breaks += 2;
+        if (progressCtx.curOffset >= progressCtx.totalSize)
+        {
+            success = true;
+        } else {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
+        }
     }
     
-out:
-    if (outFile) fclose(outFile);
+    breaks = (progressCtx.line_offset + 2);
     
-    if (!success)
+    if (success)
     {
-        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting)
+        dumpJournalRemove(&journal);
+        
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+    } else {
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
+        
+        if (journal.saved)
         {
-            for(u8 i = 0; i <= splitIndex; i++)
-            {
-                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, i);
-                remove(splitFilename);
-            }
+            dumpJournalKeptMsg();
         } else {
-            remove(dest);
+            removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
         }
     }
     
+out:
+    dumpJournalFree(&journal);
+    
+    freeExeFsContext();
+    
+    if (dumpName) free(dumpName);
+    
     breaks += 2;
     
+    changeHomeButtonBlockStatus(false);
+    
     return success;
 }
 
-bool copyHfs0PartitionContents(u32 partition, progress_ctx_t *progressCtx, const char *dest, bool splitting)
+bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
 {
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !progressCtx || !dest || !strlen(dest))
+    if (!exeFsDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to copy HFS0 partition contents!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ExeFS configuration struct!", __func__);
         breaks += 2;
         return false;
     }
     
-    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    bool isFat32 = exeFsDumpCfg->isFat32;
+    bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
+    nsoExportFormat nsoExportFmt = exeFsDumpCfg->nsoExportFmt;
+    
+    if (!exeFsContext.exefs_header.file_cnt || fileIndex > (exeFsContext.exefs_header.file_cnt - 1) || !exeFsContext.exefs_entries || !exeFsContext.exefs_str_table || exeFsContext.exefs_data_offset <= exeFsContext.exefs_offset || (!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from ExeFS section!", __func__);
         breaks += 2;
         return false;
     }
     
-    Result result;
-    char dbuf[NAME_BUF_LEN * 2] = {'\0'};
-    hfs0_file_entry entry;
-    size_t dest_len = strlen(dest);
-    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    u64 n = DUMP_BUFFER_SIZE;
+    bool proceed = true, success = false, fat32_error = false, removeFile = true, convertNso = false;
     
-    u32 i;
-    bool success = false;
+    nso_header_t nsoHeader;
+    u8 *nsoExportBuf = NULL;
     
-    if ((dest_len + 1) >= MAX_CHARACTERS(dbuf))
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
+    
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
+    char *dumpName = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[fileIndex].filename_offset);
+    
+    // Check if we're dealing with a nameless file
+    if (!strlen(exeFsFilename))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: destination directory name is too long! (%lu bytes)", __func__, dest_len);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
         breaks += 2;
         return false;
     }
     
-    snprintf(dbuf, MAX_CHARACTERS(dbuf), dest);
-    mkdir(dbuf, 0744);
-    
-    dbuf[dest_len] = '/';
-    dest_len++;
-    
-    result = openGameCardStoragePartition(storageIndex);
-    if (R_FAILED(result))
+    if (!getExeFsEntryExportInfo(fileIndex, nsoExportFmt, &nsoHeader, &convertNso, &(progressCtx.totalSize)))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
         breaks += 2;
         return false;
     }
     
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx->start));
-    
-    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
+    // Generate output path
+    if (!useLayeredFSDir)
     {
-        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+        dumpName = generateNSPDumpName((!usePatch ? DUMP_APP_NSP : DUMP_PATCH_NSP), titleIndex, false);
+        if (!dumpName)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+            breaks += 2;
+            return false;
+        }
         
-        char *filename = (char*)(gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (gameCardInfo.hfs0Partitions[partition].file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", EXEFS_DUMP_PATH, dumpName);
         
-        dbuf[dest_len] = '\0';
-        strcat(dbuf, filename);
-        removeIllegalCharacters(dbuf + dest_len);
+        if (exeFsContext.idOffset > 0)
+        {
+            sprintf(strbuf, " (ID offset #%u)", exeFsContext.idOffset);
+            strcat(dumpPath, strbuf);
+        }
+    } else {
+        mkdir(cfwDirStr, 0744);
         
-        u64 fileOffset = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset);
+        // Always use the base application title ID
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, (usePatch ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : baseAppEntries[titleIndex].titleId) + + exeFsContext.idOffset);
+        mkdir(dumpPath, 0744);
         
-        success = copyFileFromHfs0Partition(partition, dbuf, filename, fileOffset, entry.file_size, progressCtx, splitting);
-        if (!success) break;
+        strcat(dumpPath, "/exefs");
     }
     
-    closeGameCardStoragePartition();
+    mkdir(dumpPath, 0744);
     
-    return success;
-}
-
-bool dumpHfs0PartitionData(u32 partition, bool doSplitting)
-{
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header)
+    strcat(dumpPath, "/");
+    size_t cur_len = strlen(dumpPath);
+    strcat(dumpPath, exeFsFilename);
+    removeIllegalCharacters(dumpPath + cur_len);
+    
+    if (convertNso && nsoExportFmt == NSO_EXPORT_ELF) strcat(dumpPath, ".elf");
+    
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks++;
+    
+    dumpJournalLoadFileDump(&journal, dumpPath, DUMP_JOURNAL_TYPE_EXEFS_FILE, progressCtx.totalSize, &isFat32);
+    
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump HFS0 partition data!", __func__);
-        breaks += 2;
-        return false;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
     }
     
-    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    breaks++;
+    
+    // Check if the dump already exists
+    if (!journal.resume && checkIfFileExists(dumpPath))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
-        breaks += 2;
-        return false;
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
+        
+        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
+        if (!proceed)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            removeFile = false;
+            goto out;
+        } else {
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+        }
     }
     
-    u32 i;
-    hfs0_file_entry entry;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    if (!journal.resume && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    {
+        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
+        // Better safe than sorry
+        remove(dumpPath);
+        fsdevDeleteDirectoryRecursively(dumpPath);
+    }
     
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(getTransferSourceFromStorageId(exeFsContext.storageId));
+    n = getTransferChunkSize(getTransferSourceFromStorageId(exeFsContext.storageId));
     
-    bool success = false;
+    // Start dump process
+    dumpStartMsg();
+    transferChunkSizeMsg(getTransferSourceFromStorageId(exeFsContext.storageId));
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
     
-    char *dumpName = generateGameCardDumpName(false);
-    if (!dumpName)
+    changeHomeButtonBlockStatus(true);
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s \"%s\"...", (convertNso ? "Converting" : "Copying"), exeFsFilename);
+    breaks += 2;
+    
+    uiRefreshDisplay();
+    
+    if (convertNso && !exportNso(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[fileIndex].file_offset, exeFsContext.exefs_entries[fileIndex].file_size, &nsoHeader, nsoExportFmt, &nsoExportBuf, &(progressCtx.totalSize))) goto out;
+    
+    if (!dumpJournalOpenOutputFile(&journal, &writer, dumpPath, ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32) ? OUTPUT_SPLIT_DIRECTORY : OUTPUT_SPLIT_NONE), progressCtx.totalSize, SPLIT_FILE_GENERIC_PART_SIZE, &progressCtx))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        breaks += 2;
-        return false;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+        goto out;
     }
     
-    // Calculate total size
-    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
+    progressCtx.line_offset = (breaks + 2);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    for(progressCtx.curOffset = writer.curOffset; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
     {
-        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
-        progressCtx.totalSize += entry.file_size;
+        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
+        
+        uiRefreshDisplay();
+        
+        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
+        
+        // Converted NSOs are already available in memory
+        if (!nsoExportBuf)
+        {
+            breaks = (progressCtx.line_offset + 2);
+            proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[fileIndex].file_offset + progressCtx.curOffset, dumpBuf, n, false);
+            breaks = (progressCtx.line_offset - 2);
+            
+            if (!proceed) break;
+        }
+        
+        if (!outputWriterWrite(&writer, (nsoExportBuf ? (nsoExportBuf + progressCtx.curOffset) : dumpBuf), n))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            
+            if (writer.splitMode == OUTPUT_SPLIT_NONE && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
+            }
+            
+            break;
+        }
+        
+        if (!dumpJournalCheckpoint(&journal, &writer, progressCtx.curOffset + n, &isFat32, sizeof(bool), false))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            break;
+        }
+        
+        printProgressBar(&progressCtx, true, n);
+        
+        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            break;
+        }
     }
     
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total partition data size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks += 2;
+    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
     
-    if (progressCtx.totalSize > freeSpace)
+    // Support empty files
+    if (!progressCtx.totalSize)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
+        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
+        
+        progressCtx.progress = 100;
+        
+        printProgressBar(&progressCtx, false, 0);
     }
     
-    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s)", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
-    
-    // Start dump process
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    progressCtx.line_offset = (breaks + 4);
-    
-    success = copyHfs0PartitionContents(partition, &progressCtx, dumpPath, doSplitting);
+    breaks = (progressCtx.line_offset + 2);
     
     if (success)
     {
-        breaks = (progressCtx.line_offset + 2);
+        dumpJournalRemove(&journal);
         
         timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
         progressCtx.now -= progressCtx.start;
@@ -3550,11 +5835,37 @@ bool dumpHfs0PartitionData(u32 partition, bool doSplitting)
         formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
     } else {
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
+        
+        if (journal.saved)
+        {
+            dumpJournalKeptMsg();
+            removeFile = false;
+        }
     }
     
 out:
-    free(dumpName);
+    outputWriterClose(&writer);
+    
+    if (nsoExportBuf) free(nsoExportBuf);
+    
+    dumpJournalFree(&journal);
+    
+    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    {
+        if (success)
+        {
+            // Set archive bit (only for FAT32)
+            outputWriterSetArchiveBit(&writer);
+        } else {
+            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
+        }
+    } else {
+        if (!success && removeFile) remove(dumpPath);
+    }
+    
+    if (dumpName) free(dumpName);
     
     breaks += 2;
     
@@ -3563,172 +5874,304 @@ out:
     return success;
 }
 
-bool dumpFileFromHfs0Partition(u32 partition, u32 fileIndex, char *filename, bool doSplitting)
+bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool isFat32, dumpJournal *journal)
 {
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !filename || !strlen(filename))
+    if ((!usePatch && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump file from HFS0 partition!", __func__);
-        breaks += 2;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
         return false;
     }
     
-    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
-        breaks += 2;
-        return false;
-    }
+    size_t orig_romfs_path_len = strlen(romfs_path);
+    size_t orig_output_path_len = strlen(output_path);
     
-    if (fileIndex >= gameCardInfo.hfs0Partitions[partition].file_cnt)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid file index!", __func__);
-        breaks += 2;
-        return false;
-    }
+    u64 n = DUMP_BUFFER_SIZE;
+    bool proceed = true, success = false, fat32_error = false;
     
-    Result result;
-    hfs0_file_entry entry;
+    // Used to overcome issues related to the max entry count per directory in FAT32
+    int dir_limit_counter = -1;
     
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    u32 romfs_file_offset = file_offset;
+    romfs_file *entry = NULL;
     
-    u64 fileOffset = 0;
-    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    u64 off = 0;
     
-    char destCopyPath[NAME_BUF_LEN * 2] = {'\0'};
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
     
-    bool success = false;
+    char tmp_idx[16];
     
-    char *dumpName = generateGameCardDumpName(false);
-    if (!dumpName)
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    while(romfs_file_offset != ROMFS_ENTRY_EMPTY)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        breaks += 2;
-        return false;
+        romfs_path[orig_romfs_path_len] = '\0';
+        output_path[orig_output_path_len] = '\0';
+        
+        n = getTransferChunkSize(getTransferSourceFromStorageId(usePatch ? bktrContext.storageId : romFsContext.storageId));
+        
+        entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + romfs_file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + romfs_file_offset));
+        
+        // Check if we're dealing with a nameless file
+        if (!entry->nameLen)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
+            break;
+        }
+        
+        if (dir_limit_counter >= 0)
+        {
+            sprintf(tmp_idx, "_%d", dir_limit_counter);
+        } else {
+            tmp_idx[0] = '\0';
+        }
+        
+        if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + strlen(tmp_idx) + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
+            break;
+        }
+        
+        // Generate current path
+        strcat(romfs_path, "/");
+        strncat(romfs_path, (char*)entry->name, entry->nameLen);
+        
+        if (dir_limit_counter >= 0) strcat(output_path, tmp_idx);
+        strcat(output_path, "/");
+        strncat(output_path, (char*)entry->name, entry->nameLen);
+        removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
+        
+        if (dumpJournalSkipOutputFile(journal, entry->dataSize, progressCtx))
+        {
+            romfs_file_offset = entry->sibling;
+            if (romfs_file_offset == ROMFS_ENTRY_EMPTY) success = true;
+            continue;
+        }
+        
+        // Start dump process
+        uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"romfs:%s\"...", romfs_path);
+        
+        outputSplitMode splitMode = ((entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32) ? OUTPUT_SPLIT_DIRECTORY : OUTPUT_SPLIT_NONE);
+        
+        // Only set for the output file referenced by the dump journal
+        bool resumeFile = (journal && journal->resume);
+        
+        if (!dumpJournalOpenOutputFile(journal, &writer, output_path, splitMode, entry->dataSize, SPLIT_FILE_GENERIC_PART_SIZE, progressCtx))
+        {
+            if (splitMode == OUTPUT_SPLIT_NONE && !resumeFile)
+            {
+                output_path[orig_output_path_len] = '\0';
+                
+                dir_limit_counter++;
+                sprintf(tmp_idx, "_%d", dir_limit_counter);
+                strcat(output_path, tmp_idx);
+                mkdir(output_path, 0744);
+                
+                strcat(output_path, "/");
+                strncat(output_path, (char*)entry->name, entry->nameLen);
+                removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
+                
+                outputWriterOpen(&writer, output_path, splitMode, entry->dataSize, SPLIT_FILE_GENERIC_PART_SIZE, 0, 0, journal);
+            }
+            
+            if (!writer.file)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+                break;
+            }
+        }
+        
+        for(off = writer.curOffset; off < entry->dataSize; off += n, progressCtx->curOffset += n)
+        {
+            uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
+            
+            uiRefreshDisplay();
+            
+            if (n > (entry->dataSize - off)) n = (entry->dataSize - off);
+            
+            breaks = (progressCtx->line_offset + 2);
+            
+            if (!usePatch)
+            {
+                proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + off, dumpBuf, n, false);
+            } else {
+                proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + off, dumpBuf, n);
+            }
+            
+            breaks = (progressCtx->line_offset - 4);
+            
+            if (!proceed) break;
+            
+            if (!outputWriterWrite(&writer, dumpBuf, n))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+                
+                if (splitMode == OUTPUT_SPLIT_NONE && (off + n) > FAT32_FILESIZE_LIMIT)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                    fat32_error = true;
+                }
+                
+                proceed = false;
+                break;
+            }
+            
+            if (journal && !dumpJournalCheckpoint(journal, &writer, progressCtx->curOffset + n, &isFat32, sizeof(bool), false))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+                proceed = false;
+                break;
+            }
+            
+            printProgressBar(progressCtx, true, n);
+            
+            if (((off + n) < entry->dataSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                proceed = false;
+                break;
+            }
+        }
+        
+        outputWriterClose(&writer);
+        
+        if (!proceed || off < entry->dataSize) break;
+        
+        // Support empty files
+        if (!entry->dataSize)
+        {
+            uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
+            
+            if (progressCtx->totalSize == entry->dataSize) progressCtx->progress = 100;
+            
+            printProgressBar(progressCtx, false, 0);
+        }
+        
+        // Set archive bit (only for FAT32)
+        if (splitMode == OUTPUT_SPLIT_DIRECTORY) outputWriterSetArchiveBit(&writer);
+        
+        romfs_file_offset = entry->sibling;
+        if (romfs_file_offset == ROMFS_ENTRY_EMPTY) success = true;
     }
     
-    memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (fileIndex * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+    if (!success)
+    {
+        breaks = (progressCtx->line_offset + 2);
+        if (fat32_error) breaks += 2;
+    }
     
-    fileOffset = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset);
+    romfs_path[orig_romfs_path_len] = '\0';
+    output_path[orig_output_path_len] = '\0';
     
-    progressCtx.totalSize = entry.file_size;
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    return success;
+}
+
+bool recursiveDumpRomFsDir(u32 dir_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir, bool isFat32, dumpJournal *journal)
+{
+    if ((!usePatch && (!romFsContext.romfs_dirtable_size || dir_offset > romFsContext.romfs_dirtable_size || !romFsContext.romfs_dir_entries || !romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_dirtable_size || dir_offset > bktrContext.romfs_dirtable_size || !bktrContext.romfs_dir_entries || !bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse directory entry from RomFS section!", __func__);
+        return false;
+    }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks += 2;
+    size_t orig_romfs_path_len = strlen(romfs_path);
+    size_t orig_output_path_len = strlen(output_path);
+    
+    romfs_dir *entry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
     
-    if (progressCtx.totalSize > freeSpace)
+    // Check if we're dealing with a nameless directory that's not the root directory
+    if (!entry->nameLen && dir_offset > 0)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: directory entry without name in RomFS section!", __func__);
+        return false;
     }
     
-    snprintf(destCopyPath, MAX_CHARACTERS(destCopyPath), "%s%s - Partition %u (%s)", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
-    mkdir(destCopyPath, 0744);
-    
-    strcat(destCopyPath, "/");
-    size_t cur_len = strlen(destCopyPath);
-    strcat(destCopyPath, filename);
-    removeIllegalCharacters(destCopyPath + cur_len);
+    if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section directory path is too long!", __func__);
+        return false;
+    }
     
-    // Check if the dump already exists
-    if (checkIfFileExists(destCopyPath))
+    // Generate current path
+    if (entry->nameLen)
     {
-        // Ask the user if they want to proceed anyway
-        int cur_breaks = breaks;
+        strcat(romfs_path, "/");
+        strncat(romfs_path, (char*)entry->name, entry->nameLen);
         
-        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
+        strcat(output_path, "/");
+        strncat(output_path, (char*)entry->name, entry->nameLen);
+        removeIllegalCharacters(output_path + orig_output_path_len + 1);
+        mkdir(output_path, 0744);
+    }
+    
+    if (entry->childFile != ROMFS_ENTRY_EMPTY)
+    {
+        if (!recursiveDumpRomFsFile(entry->childFile, romfs_path, output_path, progressCtx, usePatch, isFat32, journal))
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            goto out;
-        } else {
-            // Remove the prompt from the screen
-            breaks = cur_breaks;
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+            romfs_path[orig_romfs_path_len] = '\0';
+            output_path[orig_output_path_len] = '\0';
+            return false;
         }
     }
     
-    result = openGameCardStoragePartition(storageIndex);
-    if (R_FAILED(result))
+    if (entry->childDir != ROMFS_ENTRY_EMPTY)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
-        goto out;
+        if (!recursiveDumpRomFsDir(entry->childDir, romfs_path, output_path, progressCtx, usePatch, true, isFat32, journal))
+        {
+            romfs_path[orig_romfs_path_len] = '\0';
+            output_path[orig_output_path_len] = '\0';
+            return false;
+        }
     }
     
-    // Start dump process
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
-    
-    success = copyFileFromHfs0Partition(partition, destCopyPath, filename, fileOffset, progressCtx.totalSize, &progressCtx, doSplitting);
-    
-    closeGameCardStoragePartition();
+    romfs_path[orig_romfs_path_len] = '\0';
+    output_path[orig_output_path_len] = '\0';
     
-    if (success)
+    if (dumpSiblingDir && entry->sibling != ROMFS_ENTRY_EMPTY)
     {
-        breaks = (progressCtx.line_offset + 2);
-        
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        breaks -= 2;
+        if (!recursiveDumpRomFsDir(entry->sibling, romfs_path, output_path, progressCtx, usePatch, true, isFat32, journal)) return false;
     }
     
-out:
-    free(dumpName);
-    
-    breaks += 2;
-    
-    changeHomeButtonBlockStatus(false);
-    
-    return success;
+    return true;
 }
 
-bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
+bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
 {
-    if (!exeFsDumpCfg)
+    if (!romFsDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ExeFS configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
         breaks += 2;
         return false;
     }
     
-    bool isFat32 = exeFsDumpCfg->isFat32;
-    bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
-    
-    u32 i;
-    u64 n = 0, offset = 0;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    size_t write_res;
-    bool proceed = true, success = false, fat32_error = false;
-    
-    char tmp_idx[5] = {'\0'};
-    char *dumpName = NULL;
-    char dumpPath[NAME_BUF_LEN] = {'\0'}, curDumpPath[NAME_BUF_LEN * 2] = {'\0'};
+    bool isFat32 = romFsDumpCfg->isFat32;
+    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
     
-    if ((!usePatch && !titleAppCount) || (usePatch && !titlePatchCount))
+    char *dumpName = NULL;
+    char romFsPath[NAME_BUF_LEN * 2] = {'\0'}, dumpPath[NAME_BUF_LEN * 2] = {'\0'};
+    
+    bool success = false;
+    
+    if ((curRomFsType == ROMFS_TYPE_APP && !titleAppCount) || (curRomFsType == ROMFS_TYPE_PATCH && !titlePatchCount) || (curRomFsType == ROMFS_TYPE_ADDON && !titleAddOnCount))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title count!", __func__);
         breaks += 2;
         return false;
     }
     
-    if ((!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
+    if ((curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
         breaks += 2;
@@ -3737,7 +6180,7 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
     
     if (!useLayeredFSDir)
     {
-        dumpName = generateNSPDumpName((!usePatch ? DUMP_APP_NSP : DUMP_PATCH_NSP), titleIndex, false);
+        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
         if (!dumpName)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
@@ -3746,227 +6189,80 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
         }
     }
     
-    // Retrieve ExeFS from Program NCA
-    if (!readNcaExeFsSection(titleIndex, usePatch))
+    // Retrieve RomFS from Program NCA
+    if (readNcaRomFsSection(titleIndex, curRomFsType, -1) != 0)
     {
-        if (dumpName) free(dumpName);
+        free(dumpName);
         breaks += 2;
         return false;
     }
     
     // Calculate total dump size
-    if (!calculateExeFsExtractedDataSize(&(progressCtx.totalSize))) goto out;
+    if (!calculateRomFsFullExtractedSize((curRomFsType == ROMFS_TYPE_PATCH), &(progressCtx.totalSize))) goto out;
     
     convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted ExeFS dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted RomFS dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
     uiRefreshDisplay();
     breaks++;
     
-    if (progressCtx.totalSize > freeSpace)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
-    }
-    
     // Generate output path
-    if (!useLayeredFSDir)
-    {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", EXEFS_DUMP_PATH, dumpName);
-        
-        if (exeFsContext.idOffset > 0)
-        {
-            sprintf(strbuf, " (ID offset #%u)", exeFsContext.idOffset);
-            strcat(dumpPath, strbuf);
-        }
-    } else {
-        mkdir(cfwDirStr, 0744);
-        
-        // Always use the base application title ID
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, (usePatch ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : baseAppEntries[titleIndex].titleId) + exeFsContext.idOffset);
-        mkdir(dumpPath, 0744);
-        
-        strcat(dumpPath, "/exefs");
-    }
-    
-    mkdir(dumpPath, 0744);
-    
-    // Start dump process
-    breaks++;
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
-    
-    for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
-    {
-        n = DUMP_BUFFER_SIZE;
-        outFile = NULL;
-        splitIndex = 0;
-        
-        char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset);
-        
-        // Check if we're dealing with a nameless file
-        if (!strlen(exeFsFilename))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
-            break;
-        }
-        
-        snprintf(curDumpPath, MAX_CHARACTERS(curDumpPath), "%s/%s", dumpPath, exeFsFilename);
-        removeIllegalCharacters(curDumpPath + strlen(dumpPath) + 1);
-        
-        if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            mkdir(curDumpPath, 0744);
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(curDumpPath, tmp_idx);
-        }
-        
-        outFile = fopen(curDumpPath, "wb");
-        if (!outFile)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, curDumpPath);
-            break;
-        }
-        
-        uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", exeFsFilename);
-        
-        for(offset = 0; offset < exeFsContext.exefs_entries[i].file_size; offset += n, progressCtx.curOffset += n)
-        {
-            uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(curDumpPath, '/') + 1);
-            
-            uiRefreshDisplay();
-            
-            if (n > (exeFsContext.exefs_entries[i].file_size - offset)) n = (exeFsContext.exefs_entries[i].file_size - offset);
-            
-            breaks = (progressCtx.line_offset + 2);
-            proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[i].file_offset + offset, dumpBuf, n, false);
-            breaks = (progressCtx.line_offset - 4);
-            
-            if (!proceed) break;
-            
-            if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32 && (offset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
-            {
-                u64 new_file_chunk_size = ((offset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
-                
-                if (old_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, offset, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
-                }
-                
-                fclose(outFile);
-                outFile = NULL;
-                
-                if (new_file_chunk_size > 0 || (offset + n) < exeFsContext.exefs_entries[i].file_size)
-                {
-                    char *tmp = strrchr(curDumpPath, '/');
-                    if (tmp != NULL) *tmp = '\0';
-                    
-                    splitIndex++;
-                    sprintf(tmp_idx, "/%02u", splitIndex);
-                    strcat(curDumpPath, tmp_idx);
-                    
-                    outFile = fopen(curDumpPath, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, offset + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, offset, write_res);
-                    
-                    if ((offset + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                        fat32_error = true;
-                    }
-                    
-                    proceed = false;
-                    break;
-                }
-            }
-            
-            printProgressBar(&progressCtx, true, n);
-            
-            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                proceed = false;
-                break;
-            }
-        }
-        
-        if (outFile) fclose(outFile);
-        
-        if (!proceed) break;
+    if (!useLayeredFSDir)
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
         
-        // Support empty files
-        if (!exeFsContext.exefs_entries[i].file_size)
+        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
         {
-            uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(curDumpPath, '/') + 1);
-            
-            if (progressCtx.totalSize == exeFsContext.exefs_entries[i].file_size) progressCtx.progress = 100;
-            
-            printProgressBar(&progressCtx, false, 0);
+            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
+            strcat(dumpPath, strbuf);
         }
+    } else {
+        mkdir(cfwDirStr, 0744);
         
-        // Set archive bit (only for FAT32)
-        if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            char *tmp = strrchr(curDumpPath, '/');
-            if (tmp != NULL) *tmp = '\0';
-            fsdevSetConcatenationFileAttribute(curDumpPath);
-        }
+        // Base applications and updates: always use the base application title ID
+        // DLCs: use DLC title ID
+        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
+        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
+        mkdir(dumpPath, 0744);
+        
+        strcat(dumpPath, "/romfs");
     }
     
-    if (proceed)
+    dumpJournalLoadFileDump(&journal, dumpPath, DUMP_JOURNAL_TYPE_ROMFS_DATA, progressCtx.totalSize, &isFat32);
+    
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
     {
-        if (progressCtx.curOffset >= progressCtx.totalSize)
-        {
-            success = true;
-        } else {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
     }
     
-    breaks = (progressCtx.line_offset + 2);
+    mkdir(dumpPath, 0744);
+    
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(getTransferSourceFromStorageId(curRomFsType == ROMFS_TYPE_PATCH ? bktrContext.storageId : romFsContext.storageId));
+    
+    // Start dump process
+    breaks++;
+    dumpStartMsg();
+    transferChunkSizeMsg(getTransferSourceFromStorageId(curRomFsType == ROMFS_TYPE_PATCH ? bktrContext.storageId : romFsContext.storageId));
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    success = recursiveDumpRomFsDir(0, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), true, isFat32, &journal);
     
     if (success)
     {
+        dumpJournalRemove(&journal);
+        
+        breaks = (progressCtx.line_offset + 2);
+        
         timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
         progressCtx.now -= progressCtx.start;
         
@@ -3974,12 +6270,21 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
     } else {
         setProgressBarError(&progressCtx);
-        if (fat32_error) breaks += 2;
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        
+        if (journal.saved)
+        {
+            dumpJournalKeptMsg();
+        } else {
+            removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        }
     }
     
 out:
-    freeExeFsContext();
+    dumpJournalFree(&journal);
+    
+    if (curRomFsType == ROMFS_TYPE_PATCH) freeBktrContext();
+    
+    freeRomFsContext();
     
     if (dumpName) free(dumpName);
     
@@ -3990,54 +6295,62 @@ out:
     return success;
 }
 
-bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
+bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
 {
-    if (!exeFsDumpCfg)
+    if (!romFsDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ExeFS configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
         breaks += 2;
         return false;
     }
     
-    bool isFat32 = exeFsDumpCfg->isFat32;
-    bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
+    bool isFat32 = romFsDumpCfg->isFat32;
+    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
     
-    if (!exeFsContext.exefs_header.file_cnt || fileIndex > (exeFsContext.exefs_header.file_cnt - 1) || !exeFsContext.exefs_entries || !exeFsContext.exefs_str_table || exeFsContext.exefs_data_offset <= exeFsContext.exefs_offset || (!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
+    if ((curRomFsType != ROMFS_TYPE_PATCH && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_PATCH && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from ExeFS section!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
         breaks += 2;
         return false;
     }
     
     u64 n = DUMP_BUFFER_SIZE;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    size_t write_res;
     bool proceed = true, success = false, fat32_error = false, removeFile = true;
     
-    char tmp_idx[5];
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
+    
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
     char *dumpName = NULL;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    char dumpPath[NAME_BUF_LEN * 2] = {'\0'};
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
-    char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[fileIndex].filename_offset);
+    romfs_file *entry = (curRomFsType != ROMFS_TYPE_PATCH ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
     
     // Check if we're dealing with a nameless file
-    if (!strlen(exeFsFilename))
+    if (!entry->nameLen)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
         breaks += 2;
         return false;
     }
     
+    progressCtx.totalSize = entry->dataSize;
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
+    
     // Generate output path
     if (!useLayeredFSDir)
     {
-        dumpName = generateNSPDumpName((!usePatch ? DUMP_APP_NSP : DUMP_PATCH_NSP), titleIndex, false);
+        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
         if (!dumpName)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
@@ -4045,557 +6358,249 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
             return false;
         }
         
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", EXEFS_DUMP_PATH, dumpName);
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
         
-        if (exeFsContext.idOffset > 0)
+        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
         {
-            sprintf(strbuf, " (ID offset #%u)", exeFsContext.idOffset);
+            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
             strcat(dumpPath, strbuf);
         }
     } else {
         mkdir(cfwDirStr, 0744);
         
-        // Always use the base application title ID
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, (usePatch ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : baseAppEntries[titleIndex].titleId) + + exeFsContext.idOffset);
+        // Base applications and updates: always use the base application title ID
+        // DLCs: use DLC title ID
+        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
+        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
         mkdir(dumpPath, 0744);
         
-        strcat(dumpPath, "/exefs");
+        strcat(dumpPath, "/romfs");
     }
     
     mkdir(dumpPath, 0744);
     
-    strcat(dumpPath, "/");
-    size_t cur_len = strlen(dumpPath);
-    strcat(dumpPath, exeFsFilename);
-    removeIllegalCharacters(dumpPath + cur_len);
-    
-    progressCtx.totalSize = exeFsContext.exefs_entries[fileIndex].file_size;
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks++;
-    
-    if (progressCtx.totalSize > freeSpace)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
-    }
-    
-    breaks++;
-    
-    // Check if the dump already exists
-    if (checkIfFileExists(dumpPath))
-    {
-        // Ask the user if they want to proceed anyway
-        int cur_breaks = breaks;
-        
-        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
-        if (!proceed)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            removeFile = false;
-            goto out;
-        } else {
-            // Remove the prompt from the screen
-            breaks = cur_breaks;
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
-        }
-    }
-    
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-    {
-        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
-        // Better safe than sorry
-        remove(dumpPath);
-        fsdevDeleteDirectoryRecursively(dumpPath);
-        
-        mkdir(dumpPath, 0744);
-        sprintf(tmp_idx, "/%02u", splitIndex);
-        strcat(dumpPath, tmp_idx);
-    }
-    
-    // Start dump process
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"%s\"...", exeFsFilename);
-    breaks += 2;
-    
-    uiRefreshDisplay();
-    
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file!", __func__);
-        goto out;
-    }
+    // Create subdirectories
+    char *tmp1 = NULL, *tmp2 = NULL;
+    size_t cur_len;
     
-    progressCtx.line_offset = (breaks + 2);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    tmp1 = strchr(curRomFsPath, '/');
     
-    for(progressCtx.curOffset = 0; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
+    while(tmp1 != NULL)
     {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
-        
-        uiRefreshDisplay();
+        tmp1++;
         
-        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
+        if (!strlen(tmp1)) break;
         
-        breaks = (progressCtx.line_offset + 2);
-        proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[fileIndex].file_offset + progressCtx.curOffset, dumpBuf, n, false);
-        breaks = (progressCtx.line_offset - 2);
+        strcat(dumpPath, "/");
         
-        if (!proceed) break;
+        cur_len = strlen(dumpPath);
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        tmp2 = strchr(tmp1, '/');
+        if (tmp2 != NULL)
         {
-            u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
-            
-            if (old_file_chunk_size > 0)
-            {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                    break;
-                }
-            }
-            
-            fclose(outFile);
-            outFile = NULL;
+            strncat(dumpPath, tmp1, tmp2 - tmp1);
             
-            if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
-            {
-                char *tmp = strrchr(dumpPath, '/');
-                if (tmp != NULL) *tmp = '\0';
-                
-                splitIndex++;
-                sprintf(tmp_idx, "/%02u", splitIndex);
-                strcat(dumpPath, tmp_idx);
-                
-                outFile = fopen(dumpPath, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
-                
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
+            tmp1 = tmp2;
         } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                
-                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
-            }
-        }
-        
-        printProgressBar(&progressCtx, true, n);
-        
-        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            break;
+            strcat(dumpPath, tmp1);
+            
+            tmp1 = NULL;
         }
-    }
-    
-    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
-    
-    // Support empty files
-    if (!progressCtx.totalSize)
-    {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
         
-        progressCtx.progress = 100;
+        removeIllegalCharacters(dumpPath + cur_len);
         
-        printProgressBar(&progressCtx, false, 0);
+        mkdir(dumpPath, 0744);
     }
     
-    breaks = (progressCtx.line_offset + 2);
+    strcat(dumpPath, "/");
+    cur_len = strlen(dumpPath);
+    strncat(dumpPath, (char*)entry->name, entry->nameLen);
+    removeIllegalCharacters(dumpPath + cur_len);
     
-    if (success)
+    dumpJournalLoadFileDump(&journal, dumpPath, DUMP_JOURNAL_TYPE_ROMFS_FILE, progressCtx.totalSize, &isFat32);
+    
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
     {
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        if (fat32_error) breaks += 2;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        removeFile = false;
+        goto out;
     }
     
-out:
-    if (outFile) fclose(outFile);
-    
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    // Check if the dump already exists
+    if (!journal.resume && checkIfFileExists(dumpPath))
     {
-        char *tmp = strrchr(dumpPath, '/');
-        if (tmp != NULL) *tmp = '\0';
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
         
-        if (success)
+        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
+        if (!proceed)
         {
-            // Set archive bit (only for FAT32)
-            fsdevSetConcatenationFileAttribute(dumpPath);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            removeFile = false;
+            goto out;
         } else {
-            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
         }
-    } else {
-        if (!success && removeFile) remove(dumpPath);
     }
     
-    if (dumpName) free(dumpName);
-    
-    breaks += 2;
-    
-    changeHomeButtonBlockStatus(false);
-    
-    return success;
-}
-
-bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool isFat32)
-{
-    if ((!usePatch && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
+    if (!journal.resume && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
-        return false;
+        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
+        // Better safe than sorry
+        remove(dumpPath);
+        fsdevDeleteDirectoryRecursively(dumpPath);
     }
     
-    size_t orig_romfs_path_len = strlen(romfs_path);
-    size_t orig_output_path_len = strlen(output_path);
-    
-    u64 n = DUMP_BUFFER_SIZE;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    bool proceed = true, success = false, fat32_error = false;
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(getTransferSourceFromStorageId(curRomFsType == ROMFS_TYPE_PATCH ? bktrContext.storageId : romFsContext.storageId));
+    n = getTransferChunkSize(getTransferSourceFromStorageId(curRomFsType == ROMFS_TYPE_PATCH ? bktrContext.storageId : romFsContext.storageId));
     
-    // Used to overcome issues related to the max entry count per directory in FAT32
-    int dir_limit_counter = -1;
+    // Start dump process
+    dumpStartMsg();
+    transferChunkSizeMsg(getTransferSourceFromStorageId(curRomFsType == ROMFS_TYPE_PATCH ? bktrContext.storageId : romFsContext.storageId));
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
     
-    u32 romfs_file_offset = file_offset;
-    romfs_file *entry = NULL;
+    changeHomeButtonBlockStatus(true);
     
-    u64 off = 0;
+    if (strlen(curRomFsPath) > 1)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"romfs:%s/%.*s\"...", curRomFsPath, entry->nameLen, entry->name);
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"romfs:/%.*s\"...", entry->nameLen, entry->name);
+    }
     
-    size_t write_res;
+    breaks += 2;
     
-    char tmp_idx[16];
+    if (!dumpJournalOpenOutputFile(&journal, &writer, dumpPath, ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32) ? OUTPUT_SPLIT_DIRECTORY : OUTPUT_SPLIT_NONE), progressCtx.totalSize, SPLIT_FILE_GENERIC_PART_SIZE, &progressCtx))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+        goto out;
+    }
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    progressCtx.line_offset = (breaks + 2);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    while(romfs_file_offset != ROMFS_ENTRY_EMPTY)
+    for(progressCtx.curOffset = writer.curOffset; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
     {
-        romfs_path[orig_romfs_path_len] = '\0';
-        output_path[orig_output_path_len] = '\0';
-        
-        n = DUMP_BUFFER_SIZE;
-        splitIndex = 0;
-        
-        entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + romfs_file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + romfs_file_offset));
-        
-        // Check if we're dealing with a nameless file
-        if (!entry->nameLen)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
-            break;
-        }
+        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        if (dir_limit_counter >= 0)
-        {
-            sprintf(tmp_idx, "_%d", dir_limit_counter);
-        } else {
-            tmp_idx[0] = '\0';
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
         
-        if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + strlen(tmp_idx) + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
-            break;
-        }
+        uiRefreshDisplay();
         
-        // Generate current path
-        strcat(romfs_path, "/");
-        strncat(romfs_path, (char*)entry->name, entry->nameLen);
+        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
         
-        if (dir_limit_counter >= 0) strcat(output_path, tmp_idx);
-        strcat(output_path, "/");
-        strncat(output_path, (char*)entry->name, entry->nameLen);
-        removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
+        breaks = (progressCtx.line_offset + 2);
         
-        if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32)
+        if (curRomFsType != ROMFS_TYPE_PATCH)
         {
-            mkdir(output_path, 0744);
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(output_path, tmp_idx);
+            proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n, false);
+        } else {
+            proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n);
         }
         
-        // Start dump process
-        uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"romfs:%s\"...", romfs_path);
+        breaks = (progressCtx.line_offset - 2);
         
-        outFile = fopen(output_path, "wb");
-        if (!outFile)
-        {
-            if (entry->dataSize <= FAT32_FILESIZE_LIMIT || !isFat32)
-            {
-                output_path[orig_output_path_len] = '\0';
-                
-                dir_limit_counter++;
-                sprintf(tmp_idx, "_%d", dir_limit_counter);
-                strcat(output_path, tmp_idx);
-                mkdir(output_path, 0744);
-                
-                strcat(output_path, "/");
-                strncat(output_path, (char*)entry->name, entry->nameLen);
-                removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
-                
-                outFile = fopen(output_path, "wb");
-            }
-            
-            if (!outFile)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, output_path);
-                break;
-            }
-        }
+        if (!proceed) break;
         
-        for(off = 0; off < entry->dataSize; off += n, progressCtx->curOffset += n)
+        if (!outputWriterWrite(&writer, dumpBuf, n))
         {
-            uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
-            
-            uiRefreshDisplay();
-            
-            if (n > (entry->dataSize - off)) n = (entry->dataSize - off);
-            
-            breaks = (progressCtx->line_offset + 2);
-            
-            if (!usePatch)
-            {
-                proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + off, dumpBuf, n, false);
-            } else {
-                proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + off, dumpBuf, n);
-            }
-            
-            breaks = (progressCtx->line_offset - 4);
-            
-            if (!proceed) break;
-            
-            if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32 && (off + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
-            {
-                u64 new_file_chunk_size = ((off + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
-                
-                if (old_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, off, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
-                }
-                
-                fclose(outFile);
-                outFile = NULL;
-                
-                if (new_file_chunk_size > 0 || (off + n) < entry->dataSize)
-                {
-                    char *tmp = strrchr(output_path, '/');
-                    if (tmp != NULL) *tmp = '\0';
-                    
-                    splitIndex++;
-                    sprintf(tmp_idx, "/%02u", splitIndex);
-                    strcat(output_path, tmp_idx);
-                    
-                    outFile = fopen(output_path, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, off + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, off, write_res);
-                    
-                    if ((off + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                        fat32_error = true;
-                    }
-                    
-                    proceed = false;
-                    break;
-                }
-            }
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
             
-            printProgressBar(progressCtx, true, n);
-            
-            if (((off + n) < entry->dataSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
+            if (writer.splitMode == OUTPUT_SPLIT_NONE && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                proceed = false;
-                break;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
             }
-        }
-        
-        if (outFile)
-        {
-            fclose(outFile);
-            outFile = NULL;
-        }
-        
-        if (!proceed || off < entry->dataSize) break;
-        
-        // Support empty files
-        if (!entry->dataSize)
-        {
-            uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
-            
-            if (progressCtx->totalSize == entry->dataSize) progressCtx->progress = 100;
             
-            printProgressBar(progressCtx, false, 0);
-        }
-        
-        // Set archive bit (only for FAT32)
-        if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            char *tmp = strrchr(output_path, '/');
-            if (tmp != NULL) *tmp = '\0';
-            fsdevSetConcatenationFileAttribute(output_path);
-        }
-        
-        romfs_file_offset = entry->sibling;
-        if (romfs_file_offset == ROMFS_ENTRY_EMPTY) success = true;
-    }
-    
-    if (!success)
-    {
-        breaks = (progressCtx->line_offset + 2);
-        if (fat32_error) breaks += 2;
-    }
-    
-    romfs_path[orig_romfs_path_len] = '\0';
-    output_path[orig_output_path_len] = '\0';
-    
-    return success;
-}
-
-bool recursiveDumpRomFsDir(u32 dir_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir, bool isFat32)
-{
-    if ((!usePatch && (!romFsContext.romfs_dirtable_size || dir_offset > romFsContext.romfs_dirtable_size || !romFsContext.romfs_dir_entries || !romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_dirtable_size || dir_offset > bktrContext.romfs_dirtable_size || !bktrContext.romfs_dir_entries || !bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse directory entry from RomFS section!", __func__);
-        return false;
+            break;
+        }
+        
+        if (!dumpJournalCheckpoint(&journal, &writer, progressCtx.curOffset + n, &isFat32, sizeof(bool), false))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            break;
+        }
+        
+        printProgressBar(&progressCtx, true, n);
+        
+        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            break;
+        }
     }
     
-    size_t orig_romfs_path_len = strlen(romfs_path);
-    size_t orig_output_path_len = strlen(output_path);
-    
-    romfs_dir *entry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
     
-    // Check if we're dealing with a nameless directory that's not the root directory
-    if (!entry->nameLen && dir_offset > 0)
+    // Support empty files
+    if (!progressCtx.totalSize)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: directory entry without name in RomFS section!", __func__);
-        return false;
+        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/') + 1);
+        
+        progressCtx.progress = 100;
+        
+        printProgressBar(&progressCtx, false, 0);
     }
     
-    if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section directory path is too long!", __func__);
-        return false;
-    }
+    breaks = (progressCtx.line_offset + 2);
     
-    // Generate current path
-    if (entry->nameLen)
+    if (success)
     {
-        strcat(romfs_path, "/");
-        strncat(romfs_path, (char*)entry->name, entry->nameLen);
+        dumpJournalRemove(&journal);
         
-        strcat(output_path, "/");
-        strncat(output_path, (char*)entry->name, entry->nameLen);
-        removeIllegalCharacters(output_path + orig_output_path_len + 1);
-        mkdir(output_path, 0744);
-    }
-    
-    if (entry->childFile != ROMFS_ENTRY_EMPTY)
-    {
-        if (!recursiveDumpRomFsFile(entry->childFile, romfs_path, output_path, progressCtx, usePatch, isFat32))
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+    } else {
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
+        
+        if (journal.saved)
         {
-            romfs_path[orig_romfs_path_len] = '\0';
-            output_path[orig_output_path_len] = '\0';
-            return false;
+            dumpJournalKeptMsg();
+            removeFile = false;
         }
     }
     
-    if (entry->childDir != ROMFS_ENTRY_EMPTY)
+out:
+    outputWriterClose(&writer);
+    
+    dumpJournalFree(&journal);
+    
+    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
     {
-        if (!recursiveDumpRomFsDir(entry->childDir, romfs_path, output_path, progressCtx, usePatch, true, isFat32))
+        if (success)
         {
-            romfs_path[orig_romfs_path_len] = '\0';
-            output_path[orig_output_path_len] = '\0';
-            return false;
+            // Set archive bit (only for FAT32)
+            outputWriterSetArchiveBit(&writer);
+        } else {
+            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
         }
+    } else {
+        if (!success && removeFile) remove(dumpPath);
     }
     
-    romfs_path[orig_romfs_path_len] = '\0';
-    output_path[orig_output_path_len] = '\0';
+    if (dumpName) free(dumpName);
     
-    if (dumpSiblingDir && entry->sibling != ROMFS_ENTRY_EMPTY)
-    {
-        if (!recursiveDumpRomFsDir(entry->sibling, romfs_path, output_path, progressCtx, usePatch, true, isFat32)) return false;
-    }
+    breaks += 2;
     
-    return true;
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
 }
 
-bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
+bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
 {
     if (!romFsDumpCfg)
     {
@@ -4610,6 +6615,9 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
+    
     char *dumpName = NULL;
     char romFsPath[NAME_BUF_LEN * 2] = {'\0'}, dumpPath[NAME_BUF_LEN * 2] = {'\0'};
     
@@ -4640,226 +6648,361 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
         }
     }
     
-    // Retrieve RomFS from Program NCA
-    if (readNcaRomFsSection(titleIndex, curRomFsType, -1) != 0)
+    // Calculate total dump size
+    if (!calculateRomFsExtractedDirSize(curRomFsDirOffset, (curRomFsType == ROMFS_TYPE_PATCH), &(progressCtx.totalSize))) goto out;
+    
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted RomFS directory size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiRefreshDisplay();
+    breaks++;
+    
+    if (strlen(curRomFsPath) > 1)
     {
-        free(dumpName);
+        // Copy the whole current path and remove the last element (current directory) from it
+        // It will be re-added later
+        snprintf(romFsPath, MAX_CHARACTERS(romFsPath), curRomFsPath);
+        char *slash = strrchr(romFsPath, '/');
+        if (slash) *slash = '\0';
+    }
+    
+    // Generate output path
+    if (!useLayeredFSDir)
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
+        
+        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
+        {
+            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
+            strcat(dumpPath, strbuf);
+        }
+    } else {
+        mkdir(cfwDirStr, 0744);
+        
+        // Base applications and updates: always use the base application title ID
+        // DLCs: use DLC title ID
+        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
+        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
+        mkdir(dumpPath, 0744);
+        
+        strcat(dumpPath, "/romfs");
+    }
+    
+    mkdir(dumpPath, 0744);
+    
+    // Create subdirectories
+    char *tmp1 = NULL, *tmp2 = NULL;
+    size_t cur_len;
+    
+    tmp1 = strchr(curRomFsPath, '/');
+    
+    while(tmp1 != NULL)
+    {
+        tmp1++;
+        
+        if (!strlen(tmp1)) break;
+        
+        tmp2 = strchr(tmp1, '/');
+        if (tmp2 != NULL)
+        {
+            strcat(dumpPath, "/");
+            
+            cur_len = strlen(dumpPath);
+            
+            strncat(dumpPath, tmp1, tmp2 - tmp1);
+            
+            removeIllegalCharacters(dumpPath + cur_len);
+            
+            mkdir(dumpPath, 0744);
+            
+            tmp1 = tmp2;
+        } else {
+            // Skip last entry
+            tmp1 = NULL;
+        }
+    }
+    
+    // The dump journal is placed next to the output directory for the current RomFS directory
+    if (strlen(curRomFsPath) > 1)
+    {
+        char journalPath[NAME_BUF_LEN * 2] = {'\0'};
+        cur_len = (strlen(dumpPath) + 1);
+        
+        snprintf(journalPath, MAX_CHARACTERS(journalPath), "%s%s", dumpPath, strrchr(curRomFsPath, '/'));
+        removeIllegalCharacters(journalPath + cur_len);
+        
+        dumpJournalLoadFileDump(&journal, journalPath, DUMP_JOURNAL_TYPE_ROMFS_DATA, progressCtx.totalSize, &isFat32);
+    } else {
+        dumpJournalLoadFileDump(&journal, dumpPath, DUMP_JOURNAL_TYPE_ROMFS_DATA, progressCtx.totalSize, &isFat32);
+    }
+    
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    // Calibrate transfer chunk sizes for this source (only performed once)
+    calibrateTransferChunkSizes(getTransferSourceFromStorageId(curRomFsType == ROMFS_TYPE_PATCH ? bktrContext.storageId : romFsContext.storageId));
+    
+    // Start dump process
+    breaks++;
+    dumpStartMsg();
+    transferChunkSizeMsg(getTransferSourceFromStorageId(curRomFsType == ROMFS_TYPE_PATCH ? bktrContext.storageId : romFsContext.storageId));
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    success = recursiveDumpRomFsDir(curRomFsDirOffset, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), false, isFat32, &journal);
+    
+    if (success)
+    {
+        dumpJournalRemove(&journal);
+        
+        breaks = (progressCtx.line_offset + 2);
+        
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+    } else {
+        setProgressBarError(&progressCtx);
+        
+        if (journal.saved)
+        {
+            dumpJournalKeptMsg();
+        } else {
+            removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        }
+    }
+    
+out:
+    dumpJournalFree(&journal);
+    
+    if (dumpName) free(dumpName);
+    
+    breaks += 2;
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
+}
+
+bool dumpGameCardCertificate()
+{
+    u32 crc = 0;
+    Result result;
+    bool success = false;
+    FILE *outFile = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    size_t write_res;
+    
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    char *dumpName = generateGameCardDumpName(false);
+    if (!dumpName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
         breaks += 2;
         return false;
     }
     
-    // Calculate total dump size
-    if (!calculateRomFsFullExtractedSize((curRomFsType == ROMFS_TYPE_PATCH), &(progressCtx.totalSize))) goto out;
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dumping gamecard certificate. Please wait.");
+    breaks++;
     
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted RomFS dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    uiRefreshDisplay();
+    appletModeOperationWarning();
     breaks++;
     
-    if (progressCtx.totalSize > freeSpace)
+    uiRefreshDisplay();
+    
+    result = openGameCardStoragePartition(ISTORAGE_PARTITION_NORMAL);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #0! (0x%08X)", __func__, result);
+        goto out;
+    }
+    
+    if (CERT_SIZE > freeSpace)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
-    // Generate output path
-    if (!useLayeredFSDir)
+    result = readGameCardStoragePartition(CERT_OFFSET, dumpBuf, CERT_SIZE);
+    if (R_FAILED(result))
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %u bytes long certificate at offset 0x%016lX from IStorage partition #0! (0x%08X)", __func__, CERT_SIZE, CERT_OFFSET, result);
+        goto out;
+    }
+    
+    // Calculate CRC32
+    crc32(dumpBuf, CERT_SIZE, &crc);
+    
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Certificate (%08X).bin", CERT_DUMP_PATH, dumpName, crc);
+    
+    // Check if the dump already exists
+    if (checkIfFileExists(dumpPath))
+    {
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
         
-        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
+        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
         {
-            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
-            strcat(dumpPath, strbuf);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            goto out;
+        } else {
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
         }
-    } else {
-        mkdir(cfwDirStr, 0744);
-        
-        // Base applications and updates: always use the base application title ID
-        // DLCs: use DLC title ID
-        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
-        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
-        
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
-        mkdir(dumpPath, 0744);
-        
-        strcat(dumpPath, "/romfs");
     }
     
-    mkdir(dumpPath, 0744);
-    
-    // Start dump process
-    breaks++;
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
+    outFile = fopen(dumpPath, "wb");
+    if (!outFile)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        goto out;
+    }
     
-    changeHomeButtonBlockStatus(true);
+    write_res = fwrite(dumpBuf, 1, CERT_SIZE, outFile);
+    if (write_res != CERT_SIZE)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %u bytes certificate data! (wrote %lu bytes)", __func__, CERT_SIZE, write_res);
+        goto out;
+    }
     
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed!");
+    breaks++;
     
-    success = recursiveDumpRomFsDir(0, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), true, isFat32);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Certificate dumped to: \"%s\".", strrchr(dumpPath, '/' ) + 1);
     
-    if (success)
-    {
-        breaks = (progressCtx.line_offset + 2);
-        
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
-    }
+    success = true;
     
 out:
-    if (curRomFsType == ROMFS_TYPE_PATCH) freeBktrContext();
+    if (outFile) fclose(outFile);
     
-    freeRomFsContext();
+    if (!success && strlen(dumpPath)) remove(dumpPath);
     
-    if (dumpName) free(dumpName);
+    closeGameCardStoragePartition();
     
-    breaks += 2;
+    free(dumpName);
     
-    changeHomeButtonBlockStatus(false);
+    breaks += 2;
     
     return success;
 }
 
-bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
+bool dumpTicketFromTitle(u32 titleIndex, selectedTicketType curTikType, ticketOptions *tikDumpCfg)
 {
-    if (!romFsDumpCfg)
+    if (!tikDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket dump configuration struct!", __func__);
         breaks += 2;
         return false;
     }
     
-    bool isFat32 = romFsDumpCfg->isFat32;
-    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
+    bool removeConsoleData = tikDumpCfg->removeConsoleData;
     
-    if ((curRomFsType != ROMFS_TYPE_PATCH && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_PATCH && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
-        breaks += 2;
-        return false;
-    }
+    u32 i = 0;
+    Result result;
     
-    u64 n = DUMP_BUFFER_SIZE;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    size_t write_res;
-    bool proceed = true, success = false, fat32_error = false, removeFile = true;
+    NcmStorageId curStorageId;
+    NcmContentMetaType metaType;
+    u32 titleCount = 0, ncmTitleIndex = 0;
     
-    char tmp_idx[5];
     char *dumpName = NULL;
-    char dumpPath[NAME_BUF_LEN * 2] = {'\0'};
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
     
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    NcmContentInfo *titleContentInfos = NULL;
+    u32 titleContentInfoCnt = 0;
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    NcmContentId ncaId;
+    char ncaIdStr[SHA256_HASH_SIZE + 1] = {'\0'};
     
-    romfs_file *entry = (curRomFsType != ROMFS_TYPE_PATCH ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
+    NcmContentStorage ncmStorage;
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
     
-    // Check if we're dealing with a nameless file
-    if (!entry->nameLen)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
-        breaks += 2;
-        return false;
-    }
+    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
+    nca_header_t dec_nca_header;
     
-    progressCtx.totalSize = entry->dataSize;
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks++;
+    title_rights_ctx rights_info;
+    memset(&rights_info, 0, sizeof(title_rights_ctx));
     
-    if (progressCtx.totalSize > freeSpace)
+    char encTitleKeyStr[0x21] = {'\0'};
+    char decTitleKeyStr[0x21] = {'\0'};
+    
+    FILE *outFile = NULL;
+    
+    bool success = false, proceed = true, foundRightsIdAndTik = false, removeFile = false;
+    
+    if (curTikType != TICKET_TYPE_APP && curTikType != TICKET_TYPE_PATCH && curTikType != TICKET_TYPE_ADDON)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        breaks += 2;
-        return false;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket title type!", __func__);
+        goto out;
     }
     
-    breaks++;
+    if ((curTikType == TICKET_TYPE_APP && !baseAppEntries) || (curTikType == TICKET_TYPE_PATCH && !patchEntries) || (curTikType == TICKET_TYPE_ADDON && !addOnEntries))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title storage ID unavailable!", __func__);
+        goto out;
+    }
     
-    // Generate output path
-    if (!useLayeredFSDir)
+    if ((curTikType == TICKET_TYPE_APP && titleIndex >= titleAppCount) || (curTikType == TICKET_TYPE_PATCH && titleIndex >= titlePatchCount) || (curTikType == TICKET_TYPE_ADDON && titleIndex >= titleAddOnCount))
     {
-        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
-        if (!dumpName)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-            breaks += 2;
-            return false;
-        }
-        
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
-        
-        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
-        {
-            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
-            strcat(dumpPath, strbuf);
-        }
-    } else {
-        mkdir(cfwDirStr, 0744);
-        
-        // Base applications and updates: always use the base application title ID
-        // DLCs: use DLC title ID
-        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
-        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
-        
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
-        mkdir(dumpPath, 0744);
-        
-        strcat(dumpPath, "/romfs");
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        goto out;
     }
     
-    mkdir(dumpPath, 0744);
+    curStorageId = (curTikType == TICKET_TYPE_APP ? baseAppEntries[titleIndex].storageId : (curTikType == TICKET_TYPE_PATCH ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
     
-    // Create subdirectories
-    char *tmp1 = NULL, *tmp2 = NULL;
-    size_t cur_len;
+    ncmTitleIndex = (curTikType == TICKET_TYPE_APP ? baseAppEntries[titleIndex].ncmIndex : (curTikType == TICKET_TYPE_PATCH ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
     
-    tmp1 = strchr(curRomFsPath, '/');
+    metaType = (curTikType == TICKET_TYPE_APP ? NcmContentMetaType_Application : (curTikType == TICKET_TYPE_PATCH ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
     
-    while(tmp1 != NULL)
+    if (curStorageId == NcmStorageId_GameCard)
     {
-        tmp1++;
-        
-        if (!strlen(tmp1)) break;
-        
-        strcat(dumpPath, "/");
-        
-        cur_len = strlen(dumpPath);
-        
-        tmp2 = strchr(tmp1, '/');
-        if (tmp2 != NULL)
-        {
-            strncat(dumpPath, tmp1, tmp2 - tmp1);
-            
-            tmp1 = tmp2;
-        } else {
-            strcat(dumpPath, tmp1);
-            
-            tmp1 = NULL;
-        }
-        
-        removeIllegalCharacters(dumpPath + cur_len);
-        
-        mkdir(dumpPath, 0744);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title storage ID!", __func__);
+        goto out;
+    }
+    
+    if (sizeof(rsa2048_sha256_ticket) > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    switch(curStorageId)
+    {
+        case NcmStorageId_SdCard:
+            titleCount = (curTikType == TICKET_TYPE_APP ? sdCardTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
+            break;
+        case NcmStorageId_BuiltInUser:
+            titleCount = (curTikType == TICKET_TYPE_APP ? emmcTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? emmcTitlePatchCount : emmcTitleAddOnCount));
+            break;
+        case LOCAL_CONTENT_STORAGE_ID:
+            titleCount = (curTikType == TICKET_TYPE_APP ? localTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? localTitlePatchCount : localTitleAddOnCount));
+            break;
+        default:
+            break;
+    }
+    
+    dumpName = generateNSPDumpName((nspDumpType)curTikType, titleIndex, false);
+    if (!dumpName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        goto out;
     }
     
-    strcat(dumpPath, "/");
-    cur_len = strlen(dumpPath);
-    strncat(dumpPath, (char*)entry->name, entry->nameLen);
-    removeIllegalCharacters(dumpPath + cur_len);
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.tik", TICKET_PATH, dumpName);
     
     // Check if the dump already exists
     if (checkIfFileExists(dumpPath))
@@ -4871,7 +7014,6 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
         if (!proceed)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            removeFile = false;
             goto out;
         } else {
             // Remove the prompt from the screen
@@ -4880,571 +7022,585 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
         }
     }
     
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-    {
-        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
-        // Better safe than sorry
-        remove(dumpPath);
-        fsdevDeleteDirectoryRecursively(dumpPath);
-        
-        mkdir(dumpPath, 0744);
-        sprintf(tmp_idx, "/%02u", splitIndex);
-        strcat(dumpPath, tmp_idx);
-    }
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving Rights ID and Ticket for the selected %s...", (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
+    breaks++;
     
-    // Start dump process
-    dumpStartMsg();
     appletModeOperationWarning();
-    uiRefreshDisplay();
     breaks++;
     
-    changeHomeButtonBlockStatus(true);
+    uiRefreshDisplay();
     
-    if (strlen(curRomFsPath) > 1)
+    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"romfs:%s/%.*s\"...", curRomFsPath, entry->nameLen, entry->name);
-    } else {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"romfs:/%.*s\"...", entry->nameLen, entry->name);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        goto out;
     }
     
-    breaks += 2;
-    
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    result = ncmLocalOpenContentStorage(&ncmStorage, curStorageId);
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
         goto out;
     }
     
-    progressCtx.line_offset = (breaks + 2);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
-    
-    for(progressCtx.curOffset = 0; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
+    for(i = 0; i < titleContentInfoCnt; i++)
     {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
-        
-        uiRefreshDisplay();
-        
-        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
-        
-        breaks = (progressCtx.line_offset + 2);
+        memcpy(&ncaId, &(titleContentInfos[i].content_id), sizeof(NcmContentId));
+        convertDataToHexString(titleContentInfos[i].content_id.c, SHA256_HASH_SIZE / 2, ncaIdStr, SHA256_HASH_SIZE + 1);
         
-        if (curRomFsType != ROMFS_TYPE_PATCH)
+        if (!isNcaHeaderCached(&ncaId) && !readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
         {
-            proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n, false);
-        } else {
-            proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n);
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from NCA \"%s\"!", __func__, ncaIdStr);
+            proceed = false;
+            break;
         }
         
-        breaks = (progressCtx.line_offset - 2);
-        
+        // Decrypt the NCA header
+        proceed = decryptNcaHeader(&ncaId, ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, true, curStorageId);
         if (!proceed) break;
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
-        {
-            u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
-            
-            if (old_file_chunk_size > 0)
-            {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                    break;
-                }
-            }
-            
-            fclose(outFile);
-            outFile = NULL;
-            
-            if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
-            {
-                char *tmp = strrchr(dumpPath, '/');
-                if (tmp != NULL) *tmp = '\0';
-                
-                splitIndex++;
-                sprintf(tmp_idx, "/%02u", splitIndex);
-                strcat(dumpPath, tmp_idx);
-                
-                outFile = fopen(dumpPath, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
-                
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
-        } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                
-                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
-            }
-        }
-        
-        printProgressBar(&progressCtx, true, n);
-        
-        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+        // Check if we hit the right spot
+        if (rights_info.has_rights_id && rights_info.retrieved_tik)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            convertDataToHexString(rights_info.enc_titlekey, 0x10, encTitleKeyStr, 0x21);
+            convertDataToHexString(rights_info.dec_titlekey, 0x10, decTitleKeyStr, 0x21);
+            foundRightsIdAndTik = true;
             break;
         }
     }
     
-    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
+    if (!proceed) goto out;
     
-    // Support empty files
-    if (!progressCtx.totalSize)
+    if (!foundRightsIdAndTik)
     {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
-        
-        progressCtx.progress = 100;
+        if (!rights_info.has_rights_id)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected %s doesn't use titlekey crypto! Rights ID field is empty in all the NCAs!", __func__, (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
+            goto out;
+        }
         
-        printProgressBar(&progressCtx, false, 0);
+        if (rights_info.missing_tik)
+        {
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected %s uses titlekey crypto, but no ticket for it is available! This is probably a pre-install.", __func__, (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
+            goto out;
+        }
     }
     
-    breaks = (progressCtx.line_offset + 2);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Rights ID: \"%s\".", rights_info.rights_id_str);
+    breaks++;
     
-    if (success)
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Ticket type: %s (0x%02X).", (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_COMMON ? "common" : (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED ? "personalized" : "unknown")), rights_info.tik_data.titlekey_type);
+    breaks++;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Encrypted title key: \"%s\".", encTitleKeyStr);
+    breaks++;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Decrypted title key: \"%s\".", decTitleKeyStr);
+    breaks += 2;
+    
+    uiRefreshDisplay();
+    
+    // Only mess with the ticket data if removeConsoleData is true and if we're dealing with a personalized ticket (checked in removeConsoleDataFromTicket())
+    if (removeConsoleData) removeConsoleDataFromTicket(&rights_info);
+    
+    outFile = fopen(dumpPath, "wb");
+    if (!outFile)
     {
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        if (fat32_error) breaks += 2;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        goto out;
     }
     
-out:
-    if (outFile) fclose(outFile);
-    
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    size_t wr = fwrite(&(rights_info.tik_data), 1, sizeof(rsa2048_sha256_ticket), outFile);
+    if (wr != sizeof(rsa2048_sha256_ticket))
     {
-        char *tmp = strrchr(dumpPath, '/');
-        if (tmp != NULL) *tmp = '\0';
-        
-        if (success)
-        {
-            // Set archive bit (only for FAT32)
-            fsdevSetConcatenationFileAttribute(dumpPath);
-        } else {
-            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
-        }
-    } else {
-        if (!success && removeFile) remove(dumpPath);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %u bytes long ticket data to \"%s\"! Wrote %lu bytes.", __func__, sizeof(rsa2048_sha256_ticket), dumpPath, wr);
+        removeFile = true;
+        goto out;
     }
     
-    if (dumpName) free(dumpName);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully finished!");
+    breaks++;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Ticket saved to \"%s\".", dumpPath);
+    
+    success = true;
     
+out:
     breaks += 2;
     
-    changeHomeButtonBlockStatus(false);
+    if (outFile) fclose(outFile);
+    
+    if (!success && removeFile) remove(dumpPath);
+    
+    ncmContentStorageClose(&ncmStorage);
+    
+    if (titleContentInfos) free(titleContentInfos);
+    
+    if (dumpName) free(dumpName);
     
     return success;
 }
 
-bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
+bool dumpAllTickets(ticketOptions *tikDumpCfg)
 {
-    if (!romFsDumpCfg)
+    if (!tikDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket dump configuration struct!", __func__);
         breaks += 2;
         return false;
     }
     
-    bool isFat32 = romFsDumpCfg->isFat32;
-    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
+    bool removeConsoleData = tikDumpCfg->removeConsoleData;
     
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    u32 i, j;
+    Result result;
+    
+    u32 totalTitleCount = (titleAppCount + titlePatchCount + titleAddOnCount);
+    u32 dumpedTikCount = 0, noRightsIdCount = 0, missingTikCount = 0, errorCount = 0;
+    
+    selectedTicketType curTikType;
+    u32 titleIndex = 0;
+    
+    NcmStorageId curStorageId;
+    NcmContentMetaType metaType;
+    u32 titleCount = 0, ncmTitleIndex = 0;
     
     char *dumpName = NULL;
-    char romFsPath[NAME_BUF_LEN * 2] = {'\0'}, dumpPath[NAME_BUF_LEN * 2] = {'\0'};
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
     
-    bool success = false;
+    NcmContentInfo *titleContentInfos = NULL;
+    u32 titleContentInfoCnt = 0;
     
-    if ((curRomFsType == ROMFS_TYPE_APP && !titleAppCount) || (curRomFsType == ROMFS_TYPE_PATCH && !titlePatchCount) || (curRomFsType == ROMFS_TYPE_ADDON && !titleAddOnCount))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title count!", __func__);
-        breaks += 2;
-        return false;
-    }
+    NcmContentId ncaId;
     
-    if ((curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
+    NcmContentStorage ncmStorage;
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    
+    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
+    nca_header_t dec_nca_header;
+    
+    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
+    
+    title_rights_ctx rights_info;
+    
+    FILE *outFile = NULL;
+    
+    int initial_breaks;
+    
+    bool success = false, proceed, cacheLoaded = false;
+    
+    if (!totalTitleCount || (!baseAppEntries && !patchEntries && !addOnEntries))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no installed titles available!", __func__);
         breaks += 2;
         return false;
     }
     
-    if (!useLayeredFSDir)
-    {
-        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
-        if (!dumpName)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-            breaks += 2;
-            return false;
-        }
-    }
-    
-    // Calculate total dump size
-    if (!calculateRomFsExtractedDirSize(curRomFsDirOffset, (curRomFsType == ROMFS_TYPE_PATCH), &(progressCtx.totalSize))) goto out;
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Reading all tickets from the ES savefiles...");
+    breaks++;
     
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted RomFS directory size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    uiRefreshDisplay();
+    appletModeOperationWarning();
     breaks++;
     
-    if (progressCtx.totalSize > freeSpace)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
-    }
+    uiRefreshDisplay();
     
-    if (strlen(curRomFsPath) > 1)
-    {
-        // Copy the whole current path and remove the last element (current directory) from it
-        // It will be re-added later
-        snprintf(romFsPath, MAX_CHARACTERS(romFsPath), curRomFsPath);
-        char *slash = strrchr(romFsPath, '/');
-        if (slash) *slash = '\0';
-    }
+    // Both ES savefiles are only scanned once. Every ticket lookup from this point on is served from the cache
+    cacheLoaded = loadEticketCache();
+    if (!cacheLoaded) goto out;
     
-    // Generate output path
-    if (!useLayeredFSDir)
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Tickets available in this console: %u.", getEticketCacheCount());
+    breaks += 2;
+    
+    initial_breaks = breaks;
+    
+    for(i = 0; i < totalTitleCount; i++)
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
+        curTikType = (i < titleAppCount ? TICKET_TYPE_APP : (i < (titleAppCount + titlePatchCount) ? TICKET_TYPE_PATCH : TICKET_TYPE_ADDON));
+        titleIndex = (curTikType == TICKET_TYPE_APP ? i : (curTikType == TICKET_TYPE_PATCH ? (i - titleAppCount) : (i - titleAppCount - titlePatchCount)));
         
-        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
+        getNspTitleNcmInfo((nspDumpType)curTikType, titleIndex, &curStorageId, &metaType, &titleCount, &ncmTitleIndex);
+        if (curStorageId == NcmStorageId_GameCard || curStorageId == LOCAL_CONTENT_STORAGE_ID) continue;
+        
+        memset(&rights_info, 0, sizeof(title_rights_ctx));
+        proceed = true;
+        
+        breaks = initial_breaks;
+        uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+        
+        dumpName = generateNSPDumpName((nspDumpType)curTikType, titleIndex, false);
+        if (!dumpName)
         {
-            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
-            strcat(dumpPath, strbuf);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+            breaks += 2;
+            errorCount++;
+            continue;
         }
-    } else {
-        mkdir(cfwDirStr, 0744);
         
-        // Base applications and updates: always use the base application title ID
-        // DLCs: use DLC title ID
-        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
-        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Title: %s [%u / %u].", dumpName, i + 1, totalTitleCount);
+        breaks += 2;
         
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
-        mkdir(dumpPath, 0744);
+        uiRefreshDisplay();
         
-        strcat(dumpPath, "/romfs");
-    }
-    
-    mkdir(dumpPath, 0744);
-    
-    // Create subdirectories
-    char *tmp1 = NULL, *tmp2 = NULL;
-    size_t cur_len;
-    
-    tmp1 = strchr(curRomFsPath, '/');
-    
-    while(tmp1 != NULL)
-    {
-        tmp1++;
+        if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+            proceed = false;
+        }
         
-        if (!strlen(tmp1)) break;
+        if (proceed)
+        {
+            result = ncmLocalOpenContentStorage(&ncmStorage, curStorageId);
+            if (R_FAILED(result))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
+                proceed = false;
+            }
+        }
         
-        tmp2 = strchr(tmp1, '/');
-        if (tmp2 != NULL)
+        // Only the first NCA with a rights ID is needed
+        for(j = 0; proceed && j < titleContentInfoCnt && !rights_info.has_rights_id; j++)
         {
-            strcat(dumpPath, "/");
+            memcpy(&ncaId, &(titleContentInfos[j].content_id), sizeof(NcmContentId));
             
-            cur_len = strlen(dumpPath);
-            
-            strncat(dumpPath, tmp1, tmp2 - tmp1);
-            
-            removeIllegalCharacters(dumpPath + cur_len);
-            
-            mkdir(dumpPath, 0744);
+            if (!isNcaHeaderCached(&ncaId) && !readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read NCA header!", __func__);
+                proceed = false;
+                break;
+            }
             
-            tmp1 = tmp2;
-        } else {
-            // Skip last entry
-            tmp1 = NULL;
+            proceed = decryptNcaHeader(&ncaId, ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, true, curStorageId);
+        }
+        
+        ncmContentStorageClose(&ncmStorage);
+        memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+        
+        if (titleContentInfos)
+        {
+            free(titleContentInfos);
+            titleContentInfos = NULL;
+        }
+        
+        titleContentInfoCnt = 0;
+        
+        if (proceed)
+        {
+            if (!rights_info.has_rights_id)
+            {
+                noRightsIdCount++;
+            } else
+            if (!rights_info.retrieved_tik)
+            {
+                missingTikCount++;
+            } else {
+                // Only mess with the ticket data if removeConsoleData is true and if we're dealing with a personalized ticket (checked in removeConsoleDataFromTicket())
+                if (removeConsoleData) removeConsoleDataFromTicket(&rights_info);
+                
+                if (!retrieveCertData(rights_info.cert_data, (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED)))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+                    proceed = false;
+                }
+                
+                if (proceed && (sizeof(rsa2048_sha256_ticket) + ETICKET_CERT_FILE_SIZE) > freeSpace)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+                    free(dumpName);
+                    dumpName = NULL;
+                    breaks += 2;
+                    goto out;
+                }
+                
+                for(j = 0; proceed && j < 2; j++)
+                {
+                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.%s", TICKET_PATH, dumpName, (j == 0 ? "tik" : "cert"));
+                    
+                    outFile = fopen(dumpPath, "wb");
+                    if (!outFile)
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+                        proceed = false;
+                        break;
+                    }
+                    
+                    size_t size = (j == 0 ? sizeof(rsa2048_sha256_ticket) : ETICKET_CERT_FILE_SIZE);
+                    size_t wr = fwrite((j == 0 ? (void*)&(rights_info.tik_data) : (void*)rights_info.cert_data), 1, size, outFile);
+                    
+                    fclose(outFile);
+                    outFile = NULL;
+                    
+                    if (wr != size)
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes long data to \"%s\"! Wrote %lu bytes.", __func__, size, dumpPath, wr);
+                        remove(dumpPath);
+                        proceed = false;
+                    }
+                }
+                
+                if (proceed) dumpedTikCount++;
+            }
         }
+        
+        if (!proceed) errorCount++;
+        
+        free(dumpName);
+        dumpName = NULL;
     }
     
-    // Start dump process
-    breaks++;
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
+    breaks = initial_breaks;
+    uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
     
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    if (!errorCount)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully finished! Dumped %u %s to \"%s\".", dumpedTikCount, (dumpedTikCount == 1 ? "ticket" : "tickets"), TICKET_PATH);
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process finished with errors. Dumped %u %s to \"%s\".", dumpedTikCount, (dumpedTikCount == 1 ? "ticket" : "tickets"), TICKET_PATH);
+    }
     
-    success = recursiveDumpRomFsDir(curRomFsDirOffset, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), false, isFat32);
+    breaks++;
     
-    if (success)
+    if (noRightsIdCount || missingTikCount || errorCount)
     {
-        breaks = (progressCtx.line_offset + 2);
-        
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Titles without titlekey crypto: %u | Titles with missing tickets (pre-installs): %u | Errors: %u.", noRightsIdCount, missingTikCount, errorCount);
+        breaks++;
     }
     
-out:
-    if (dumpName) free(dumpName);
+    success = (!errorCount);
     
+out:
     breaks += 2;
     
-    changeHomeButtonBlockStatus(false);
+    if (cacheLoaded) freeEticketCache();
     
     return success;
 }
 
-bool dumpGameCardCertificate()
+// Builds an allocation map from the first FAT of a FAT32 partition
+// Returns false if the partition doesn't hold a valid FAT32 filesystem, in which case the whole partition must be dumped
+static bool loadFatAllocationMap(FsStorage *storage, u64 partitionSize, fatAllocationMap *map)
 {
-    u32 crc = 0;
+    if (!storage || !partitionSize || !map) return false;
+    
     Result result;
-    bool success = false;
-    FILE *outFile = NULL;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
-    size_t write_res;
+    u8 bootSector[FAT_BOOT_SECTOR_SIZE];
+    u16 bytesPerSector = 0, reservedSectorCnt = 0, rootEntryCnt = 0, totalSectorCnt16 = 0;
+    u8 sectorsPerCluster = 0, fatCnt = 0;
+    u32 i, entry, cluster, fatSectorCnt = 0, totalSectorCnt = 0;
+    u64 fatOffset, fatSize, volumeSize, fatReadSize, off, n = DUMP_BUFFER_SIZE;
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    memset(map, 0, sizeof(fatAllocationMap));
     
-    char *dumpName = generateGameCardDumpName(false);
-    if (!dumpName)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        breaks += 2;
-        return false;
-    }
+    result = fsStorageRead(storage, 0, bootSector, FAT_BOOT_SECTOR_SIZE);
+    if (R_FAILED(result) || bootSector[0x1FE] != 0x55 || bootSector[0x1FF] != 0xAA) return false;
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dumping gamecard certificate. Please wait.");
-    breaks++;
+    // Boot sector fields aren't aligned
+    memcpy(&bytesPerSector, bootSector + 0x0B, sizeof(u16));
+    sectorsPerCluster = bootSector[0x0D];
+    memcpy(&reservedSectorCnt, bootSector + 0x0E, sizeof(u16));
+    fatCnt = bootSector[0x10];
+    memcpy(&rootEntryCnt, bootSector + 0x11, sizeof(u16));
+    memcpy(&totalSectorCnt16, bootSector + 0x13, sizeof(u16));
+    memcpy(&totalSectorCnt, bootSector + 0x20, sizeof(u32));
+    memcpy(&fatSectorCnt, bootSector + 0x24, sizeof(u32));
     
-    appletModeOperationWarning();
-    breaks++;
+    // FAT32 volumes don't have a fixed root directory area, and always use the 32-bit total sector count field
+    if (bytesPerSector < FAT_BOOT_SECTOR_SIZE || bytesPerSector > 0x1000 || (bytesPerSector & (bytesPerSector - 1)) != 0 || !sectorsPerCluster || (sectorsPerCluster & (sectorsPerCluster - 1)) != 0 || !reservedSectorCnt || !fatCnt || rootEntryCnt || totalSectorCnt16 || !totalSectorCnt || !fatSectorCnt) return false;
     
-    uiRefreshDisplay();
+    fatOffset = ((u64)reservedSectorCnt * bytesPerSector);
+    fatSize = ((u64)fatSectorCnt * bytesPerSector);
+    volumeSize = ((u64)totalSectorCnt * bytesPerSector);
     
-    result = openGameCardStoragePartition(ISTORAGE_PARTITION_NORMAL);
-    if (R_FAILED(result))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #0! (0x%08X)", __func__, result);
-        goto out;
-    }
+    map->dataOffset = (fatOffset + ((u64)fatCnt * fatSize));
+    map->clusterSize = ((u64)sectorsPerCluster * bytesPerSector);
     
-    if (CERT_SIZE > freeSpace)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
-    }
+    if (volumeSize > partitionSize || map->dataOffset >= volumeSize) return false;
     
-    result = readGameCardStoragePartition(CERT_OFFSET, dumpBuf, CERT_SIZE);
-    if (R_FAILED(result))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %u bytes long certificate at offset 0x%016lX from IStorage partition #0! (0x%08X)", __func__, CERT_SIZE, CERT_OFFSET, result);
-        goto out;
-    }
+    map->clusterCnt = (u32)((volumeSize - map->dataOffset) / map->clusterSize);
     
-    // Calculate CRC32
-    crc32(dumpBuf, CERT_SIZE, &crc);
+    // The FAT must hold an entry for every cluster, plus the two reserved entries
+    if (map->clusterCnt < FAT32_MIN_CLUSTER_CNT || (fatSize / sizeof(u32)) < ((u64)map->clusterCnt + 2)) return false;
     
-    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Certificate (%08X).bin", CERT_DUMP_PATH, dumpName, crc);
+    map->bitmap = calloc((map->clusterCnt + 7) / 8, sizeof(u8));
+    if (!map->bitmap) return false;
     
-    // Check if the dump already exists
-    if (checkIfFileExists(dumpPath))
+    map->freeClusterCnt = map->clusterCnt;
+    
+    // Only the first FAT is used. Reads are kept sector aligned
+    fatReadSize = round_up(((u64)map->clusterCnt + 2) * sizeof(u32), bytesPerSector);
+    
+    for(off = 0; off < fatReadSize; off += n)
     {
-        // Ask the user if they want to proceed anyway
-        int cur_breaks = breaks;
+        if (n > (fatReadSize - off)) n = (fatReadSize - off);
         
-        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
+        result = fsStorageRead(storage, fatOffset + off, dumpBuf, n);
+        if (R_FAILED(result))
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            goto out;
-        } else {
-            // Remove the prompt from the screen
-            breaks = cur_breaks;
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+            free(map->bitmap);
+            memset(map, 0, sizeof(fatAllocationMap));
+            return false;
+        }
+        
+        for(i = 0; i < (u32)(n / sizeof(u32)); i++)
+        {
+            // Entries #0 and #1 are reserved
+            cluster = (u32)((off / sizeof(u32)) + i);
+            if (cluster < 2 || cluster >= (map->clusterCnt + 2)) continue;
+            
+            memcpy(&entry, dumpBuf + (i * sizeof(u32)), sizeof(u32));
+            if (!(entry & FAT32_ENTRY_MASK)) continue;
+            
+            map->bitmap[(cluster - 2) / 8] |= (u8)(1 << ((cluster - 2) % 8));
+            map->freeClusterCnt--;
         }
     }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
-    }
-    
-    write_res = fwrite(dumpBuf, 1, CERT_SIZE, outFile);
-    if (write_res != CERT_SIZE)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %u bytes certificate data! (wrote %lu bytes)", __func__, CERT_SIZE, write_res);
-        goto out;
-    }
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed!");
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Certificate dumped to: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-    
-    success = true;
+    return true;
+}
+
+static void freeFatAllocationMap(fatAllocationMap *map)
+{
+    if (!map) return;
     
-out:
-    if (outFile) fclose(outFile);
+    if (map->bitmap) free(map->bitmap);
     
-    if (!success && strlen(dumpPath)) remove(dumpPath);
+    memset(map, 0, sizeof(fatAllocationMap));
+}
+
+// Zeroes out the unallocated clusters from a partition data chunk. If 'buf' is NULL, the chunk is only checked
+// Returns true if the chunk holds any data that must be read from the partition (allocated clusters, or data located outside of the FAT data area)
+static bool processFatAllocationMapChunk(fatAllocationMap *map, u64 offset, u64 size, u8 *buf)
+{
+    if (!map || !map->bitmap || !size) return true;
     
-    closeGameCardStoragePartition();
+    u32 cluster;
+    u64 pos, clusterEnd;
+    u64 dataEnd = (map->dataOffset + ((u64)map->clusterCnt * map->clusterSize));
+    u64 start = (offset > map->dataOffset ? offset : map->dataOffset);
+    u64 end = ((offset + size) < dataEnd ? (offset + size) : dataEnd);
     
-    free(dumpName);
+    bool allocated = (offset < map->dataOffset || (offset + size) > dataEnd);
     
-    breaks += 2;
+    for(pos = start; pos < end && (buf || !allocated); pos = clusterEnd)
+    {
+        cluster = (u32)((pos - map->dataOffset) / map->clusterSize);
+        
+        clusterEnd = (map->dataOffset + (((u64)cluster + 1) * map->clusterSize));
+        if (clusterEnd > end) clusterEnd = end;
+        
+        if (map->bitmap[cluster / 8] & (1 << (cluster % 8)))
+        {
+            allocated = true;
+        } else
+        if (buf)
+        {
+            memset(buf + (pos - offset), 0, clusterEnd - pos);
+        }
+    }
     
-    return success;
+    return allocated;
 }
 
-bool dumpTicketFromTitle(u32 titleIndex, selectedTicketType curTikType, ticketOptions *tikDumpCfg)
+bool dumpBisPartitionImage(bisPartitionType partition, bisOptions *bisDumpCfg)
 {
-    if (!tikDumpCfg)
+    if (partition >= BIS_PARTITION_CNT || !bisDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket dump configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump BIS partition image!", __func__);
         breaks += 2;
         return false;
     }
     
-    bool removeConsoleData = tikDumpCfg->removeConsoleData;
+    const FsBisPartitionId bisPartitionIds[BIS_PARTITION_CNT] = { FsBisPartitionId_CalibrationBinary, FsBisPartitionId_CalibrationFile, FsBisPartitionId_SafeMode, FsBisPartitionId_System, FsBisPartitionId_User };
     
-    u32 i = 0;
     Result result;
+    s64 partitionSize = 0;
+    bool success = false, fat32_error = false, outputOpened = false, readChunk;
+    bool doSplitting = bisDumpCfg->isFat32;
+    u64 n = DUMP_BUFFER_SIZE, skippedSize = 0;
+    char dumpPath[NAME_BUF_LEN] = {'\0'}, sizeStr[32] = {'\0'}, hashStr[(SHA256_HASH_SIZE * 2) + 1] = {'\0'};
+    u8 hash[SHA256_HASH_SIZE];
+    u32 crc = 0;
+    FILE *hashFile = NULL;
     
-    NcmStorageId curStorageId;
-    NcmContentMetaType metaType;
-    u32 titleCount = 0, ncmTitleIndex = 0;
-    
-    char *dumpName = NULL;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
-    
-    NcmContentInfo *titleContentInfos = NULL;
-    u32 titleContentInfoCnt = 0;
-    
-    NcmContentId ncaId;
-    char ncaIdStr[SHA256_HASH_SIZE + 1] = {'\0'};
-    
-    NcmContentStorage ncmStorage;
-    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
-    
-    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
-    nca_header_t dec_nca_header;
+    Sha256Context hashCtx;
+    sha256ContextCreate(&hashCtx);
     
-    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
+    FsStorage bisStorage;
+    memset(&bisStorage, 0, sizeof(FsStorage));
     
-    title_rights_ctx rights_info;
-    memset(&rights_info, 0, sizeof(title_rights_ctx));
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    char encTitleKeyStr[0x21] = {'\0'};
-    char decTitleKeyStr[0x21] = {'\0'};
+    outputWriter writer;
+    memset(&writer, 0, sizeof(outputWriter));
     
-    FILE *outFile = NULL;
+    dumpJournal journal;
+    memset(&journal, 0, sizeof(dumpJournal));
     
-    bool success = false, proceed = true, foundRightsIdAndTik = false, removeFile = false;
+    fatAllocationMap fatMap;
+    memset(&fatMap, 0, sizeof(fatAllocationMap));
     
-    if (curTikType != TICKET_TYPE_APP && curTikType != TICKET_TYPE_PATCH && curTikType != TICKET_TYPE_ADDON)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket title type!", __func__);
-        goto out;
-    }
+    bisJournalCtx bisCtx;
+    memset(&bisCtx, 0, sizeof(bisJournalCtx));
+    bisCtx.skipFreeClusters = bisDumpCfg->skipFreeClusters;
     
-    if ((curTikType == TICKET_TYPE_APP && !baseAppEntries) || (curTikType == TICKET_TYPE_PATCH && !patchEntries) || (curTikType == TICKET_TYPE_ADDON && !addOnEntries))
+    // The partitions are dumped while the system is running, so the SYSTEM and USER images are a snapshot of live filesystems
+    result = fsOpenBisStorage(&bisStorage, bisPartitionIds[partition]);
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title storage ID unavailable!", __func__);
-        goto out;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open BIS %s partition! (0x%08X)", __func__, BIS_PARTITION_NAME(partition), result);
+        breaks += 2;
+        return false;
     }
     
-    if ((curTikType == TICKET_TYPE_APP && titleIndex >= titleAppCount) || (curTikType == TICKET_TYPE_PATCH && titleIndex >= titlePatchCount) || (curTikType == TICKET_TYPE_ADDON && titleIndex >= titleAddOnCount))
+    result = fsStorageGetSize(&bisStorage, &partitionSize);
+    if (R_FAILED(result) || partitionSize <= 0)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to retrieve BIS %s partition size! (0x%08X)", __func__, BIS_PARTITION_NAME(partition), result);
         goto out;
     }
     
-    curStorageId = (curTikType == TICKET_TYPE_APP ? baseAppEntries[titleIndex].storageId : (curTikType == TICKET_TYPE_PATCH ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
+    progressCtx.totalSize = (u64)partitionSize;
     
-    ncmTitleIndex = (curTikType == TICKET_TYPE_APP ? baseAppEntries[titleIndex].ncmIndex : (curTikType == TICKET_TYPE_PATCH ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "BIS %s partition size: %s (%lu bytes).", BIS_PARTITION_NAME(partition), progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
     
-    metaType = (curTikType == TICKET_TYPE_APP ? NcmContentMetaType_Application : (curTikType == TICKET_TYPE_PATCH ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
+    // Check if a previous dump was interrupted
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.bin", BIS_DUMP_PATH, BIS_PARTITION_NAME(partition));
     
-    if (curStorageId == NcmStorageId_GameCard)
+    if (dumpJournalLoad(&journal, dumpPath, DUMP_JOURNAL_TYPE_BIS_PARTITION, progressCtx.totalSize))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title storage ID!", __func__);
-        goto out;
+        if (journal.header.stateSize != sizeof(bisJournalCtx))
+        {
+            dumpJournalRemove(&journal);
+        } else
+        if (dumpJournalResumePrompt(&journal, false))
+        {
+            // Restore the checksums calculated before the dump got interrupted
+            memcpy(&bisCtx, journal.state, sizeof(bisJournalCtx));
+            memcpy(&hashCtx, &(bisCtx.hashCtx), sizeof(Sha256Context));
+            crc = bisCtx.crc;
+            doSplitting = (journal.header.splitMode != OUTPUT_SPLIT_NONE);
+        }
     }
     
-    if (sizeof(rsa2048_sha256_ticket) > freeSpace)
+    if (!journal.resume && progressCtx.totalSize > freeSpace)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
-    switch(curStorageId)
-    {
-        case NcmStorageId_SdCard:
-            titleCount = (curTikType == TICKET_TYPE_APP ? sdCardTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
-            break;
-        case NcmStorageId_BuiltInUser:
-            titleCount = (curTikType == TICKET_TYPE_APP ? emmcTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? emmcTitlePatchCount : emmcTitleAddOnCount));
-            break;
-        default:
-            break;
-    }
-    
-    dumpName = generateNSPDumpName((nspDumpType)curTikType, titleIndex, false);
-    if (!dumpName)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        goto out;
-    }
-    
-    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.tik", TICKET_PATH, dumpName);
+    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting) snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.bin.%02u", BIS_DUMP_PATH, BIS_PARTITION_NAME(partition), 0);
     
     // Check if the dump already exists
-    if (checkIfFileExists(dumpPath))
+    if (!journal.resume && checkIfFileExists(dumpPath))
     {
         // Ask the user if they want to proceed anyway
         int cur_breaks = breaks;
         
-        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
-        if (!proceed)
+        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
             goto out;
@@ -5455,123 +7611,202 @@ bool dumpTicketFromTitle(u32 titleIndex, selectedTicketType curTikType, ticketOp
         }
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving Rights ID and Ticket for the selected %s...", (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
-    breaks++;
-    
-    appletModeOperationWarning();
-    breaks++;
-    
-    uiRefreshDisplay();
+    // The calibrated eMMC chunk size is measured with NCM content reads, which don't go through the same path as raw BIS storage reads
+    // Stick to the default chunk size instead
+    n = DUMP_BUFFER_SIZE;
     
-    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
+    // Only FAT32 partitions can have their unallocated clusters skipped
+    if (bisCtx.skipFreeClusters && (partition == BIS_PARTITION_SAFE || partition == BIS_PARTITION_SYSTEM || partition == BIS_PARTITION_USER))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        goto out;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Reading FAT allocation table, please wait...");
+        uiRefreshDisplay();
+        breaks++;
+        
+        if (loadFatAllocationMap(&bisStorage, progressCtx.totalSize, &fatMap))
+        {
+            convertSize((u64)fatMap.freeClusterCnt * fatMap.clusterSize, sizeStr, MAX_CHARACTERS(sizeStr));
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Unallocated clusters: %u / %u (%s). They will be written as zeroes.", fatMap.freeClusterCnt, fatMap.clusterCnt, sizeStr);
+        } else {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "No valid FAT32 filesystem found. The whole partition will be dumped.");
+        }
+        
+        breaks += 2;
     }
     
-    result = ncmOpenContentStorage(&ncmStorage, curStorageId);
-    if (R_FAILED(result))
+    // The output writer takes care of the part file naming
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.bin", BIS_DUMP_PATH, BIS_PARTITION_NAME(partition));
+    
+    outputSplitMode splitMode = ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting) ? OUTPUT_SPLIT_SUFFIX : OUTPUT_SPLIT_NONE);
+    
+    if (journal.resume)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
-        goto out;
+        if (!outputWriterResume(&writer, dumpPath, splitMode, progressCtx.totalSize, SPLIT_FILE_GENERIC_PART_SIZE, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to resume interrupted dump: %s", __func__, writer.errorStr);
+            dumpJournalRemove(&journal);
+            goto out;
+        }
+    } else {
+        if (!outputWriterOpen(&writer, dumpPath, splitMode, progressCtx.totalSize, SPLIT_FILE_GENERIC_PART_SIZE, 0, 0, &journal))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            goto out;
+        }
     }
     
-    for(i = 0; i < titleContentInfoCnt; i++)
+    outputOpened = true;
+    
+    // Start dump process
+    dumpStartMsg();
+    transferChunkSizeMsg(TRANSFER_SOURCE_CNT); // Uncalibrated source: reports the default read chunk size
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 2);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    for (progressCtx.curOffset = writer.curOffset; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
     {
-        memcpy(&ncaId, &(titleContentInfos[i].content_id), sizeof(NcmContentId));
-        convertDataToHexString(titleContentInfos[i].content_id.c, SHA256_HASH_SIZE / 2, ncaIdStr, SHA256_HASH_SIZE + 1);
+        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(writer.curPath, '/' ) + 1);
+        
+        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
         
-        if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
+        // Chunks made up entirely of unallocated clusters aren't read at all
+        readChunk = (!fatMap.bitmap || processFatAllocationMapChunk(&fatMap, progressCtx.curOffset, n, NULL));
+        
+        if (readChunk)
         {
-            breaks++;
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from NCA \"%s\"!", __func__, ncaIdStr);
-            proceed = false;
+            result = fsStorageRead(&bisStorage, progressCtx.curOffset, dumpBuf, n);
+            if (R_FAILED(result))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from BIS %s partition! (0x%08X)", __func__, n, progressCtx.curOffset, BIS_PARTITION_NAME(partition), result);
+                break;
+            }
+            
+            if (fatMap.bitmap) processFatAllocationMapChunk(&fatMap, progressCtx.curOffset, n, dumpBuf);
+        } else {
+            memset(dumpBuf, 0, n);
+            skippedSize += n;
+        }
+        
+        // The checksums are calculated over the output image while it's being streamed, so the data doesn't have to be read back afterwards
+        sha256ContextUpdate(&hashCtx, dumpBuf, n);
+        crc32(dumpBuf, n, &crc);
+        
+        if (!outputWriterWrite(&writer, dumpBuf, n))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            
+            if (writer.splitMode == OUTPUT_SPLIT_NONE && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
+            }
+            
             break;
         }
         
-        // Decrypt the NCA header
-        proceed = decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, true);
-        if (!proceed) break;
+        // Periodically record the dump progress, so it can be resumed if the process gets interrupted
+        memcpy(&(bisCtx.hashCtx), &hashCtx, sizeof(Sha256Context));
+        bisCtx.crc = crc;
         
-        // Check if we hit the right spot
-        if (rights_info.has_rights_id && rights_info.retrieved_tik)
+        if (!dumpJournalCheckpoint(&journal, &writer, progressCtx.curOffset + n, &bisCtx, sizeof(bisJournalCtx), false))
         {
-            convertDataToHexString(rights_info.enc_titlekey, 0x10, encTitleKeyStr, 0x21);
-            convertDataToHexString(rights_info.dec_titlekey, 0x10, decTitleKeyStr, 0x21);
-            foundRightsIdAndTik = true;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writer.errorStr);
+            break;
+        }
+        
+        printProgressBar(&progressCtx, true, n);
+        
+        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
             break;
         }
     }
     
-    if (!proceed) goto out;
+    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
     
-    if (!foundRightsIdAndTik)
+    breaks = (progressCtx.line_offset + 2);
+    
+    if (success)
     {
-        if (!rights_info.has_rights_id)
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+        breaks += 2;
+        
+        if (skippedSize)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected %s doesn't use titlekey crypto! Rights ID field is empty in all the NCAs!", __func__, (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
-            goto out;
+            convertSize(skippedSize, sizeStr, MAX_CHARACTERS(sizeStr));
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Skipped unallocated FAT clusters: %s.", sizeStr);
+            breaks++;
         }
         
-        if (rights_info.missing_tik)
+        sha256ContextGetHash(&hashCtx, hash);
+        convertDataToHexString(hash, SHA256_HASH_SIZE, hashStr, MAX_ELEMENTS(hashStr));
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "SHA-256 checksum: %s", hashStr);
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "CRC32 checksum: %08X", crc);
+        
+        // Save the SHA-256 checksum next to the output image, using the sha256sum format. It covers the whole image, even if it was split
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.bin.sha256", BIS_DUMP_PATH, BIS_PARTITION_NAME(partition));
+        
+        hashFile = fopen(dumpPath, "w");
+        if (hashFile)
         {
+            fprintf(hashFile, "%s *%s.bin\n", hashStr, BIS_PARTITION_NAME(partition));
+            fclose(hashFile);
+        } else {
             breaks++;
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected %s uses titlekey crypto, but no ticket for it is available! This is probably a pre-install.", __func__, (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
-            goto out;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to save SHA-256 checksum to \"%s\"!", __func__, dumpPath);
         }
+        
+        dumpJournalRemove(&journal);
+    } else {
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
+        
+        // Keep the partial dump, so it can be resumed later
+        if (journal.saved) dumpJournalKeptMsg();
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Rights ID: \"%s\".", rights_info.rights_id_str);
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Ticket type: %s (0x%02X).", (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_COMMON ? "common" : (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED ? "personalized" : "unknown")), rights_info.tik_data.titlekey_type);
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Encrypted title key: \"%s\".", encTitleKeyStr);
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Decrypted title key: \"%s\".", decTitleKeyStr);
-    breaks += 2;
-    
-    uiRefreshDisplay();
-    
-    // Only mess with the ticket data if removeConsoleData is true and if we're dealing with a personalized ticket (checked in removeConsoleDataFromTicket())
-    if (removeConsoleData) removeConsoleDataFromTicket(&rights_info);
+out:
+    outputWriterClose(&writer);
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
-    }
+    dumpJournalFree(&journal);
     
-    size_t wr = fwrite(&(rights_info.tik_data), 1, sizeof(rsa2048_sha256_ticket), outFile);
-    if (wr != sizeof(rsa2048_sha256_ticket))
+    if (!success && outputOpened && !journal.saved)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %u bytes long ticket data to \"%s\"! Wrote %lu bytes.", __func__, sizeof(rsa2048_sha256_ticket), dumpPath, wr);
-        removeFile = true;
-        goto out;
+        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
+        {
+            for(u8 i = 0; i <= writer.partIndex; i++)
+            {
+                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.bin.%02u", BIS_DUMP_PATH, BIS_PARTITION_NAME(partition), i);
+                remove(dumpPath);
+            }
+        } else {
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.bin", BIS_DUMP_PATH, BIS_PARTITION_NAME(partition));
+            remove(dumpPath);
+        }
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully finished!");
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Ticket saved to \"%s\".", dumpPath);
+    freeFatAllocationMap(&fatMap);
     
-    success = true;
+    fsStorageClose(&bisStorage);
     
-out:
     breaks += 2;
     
-    if (outFile) fclose(outFile);
-    
-    if (!success && removeFile) remove(dumpPath);
-    
-    ncmContentStorageClose(&ncmStorage);
-    
-    if (titleContentInfos) free(titleContentInfos);
-    
-    if (dumpName) free(dumpName);
+    changeHomeButtonBlockStatus(false);
     
     return success;
 }
@@ -13,6 +13,10 @@
 #define SPLIT_FILE_GENERIC_PART_SIZE    SPLIT_FILE_NSP_PART_SIZE
 #define SPLIT_FILE_SEQUENTIAL_SIZE      (u64)0x40000000             // 1 GiB (used for sequential dumps when there's not enough storage space available)
 
+#define FAT_BOOT_SECTOR_SIZE            0x200
+#define FAT32_MIN_CLUSTER_CNT           65525                       // FAT volumes with less clusters than this are FAT12 / FAT16
+#define FAT32_ENTRY_MASK                (u32)0x0FFFFFFF             // The upper 4 bits from each FAT32 entry are reserved
+
 #define CERT_OFFSET                     0x7000
 #define CERT_SIZE                       0x200
 
@@ -44,10 +48,78 @@ typedef struct {
     Sha256Context hashCtx;                          // Current NCA SHA-256 checksum context. Only used when dealing with the same NCA between different parts
 } PACKED sequentialNspCtx;
 
+// Dump journal state for NSP bundles
+// This struct is followed by a SHA-256 checksum for each PFS0 entry (only NCA entries are actually used) and the modified + reencrypted Program NCA headers from all bundled titles, in order
+typedef struct {
+    bool removeConsoleData;                         // Original value for the "Remove console specific data" option. Overrides the selected setting in the current session
+    bool tiklessDump;                               // Original value for the "Generate ticket-less dump" option. Overrides the selected setting in the current session
+    bool npdmAcidRsaPatch;                          // Original value for the "Change NPDM RSA key/sig in Program NCA" option. Overrides the selected setting in the current session
+    bool preInstall;                                // Indicates if we're dealing with a preinstalled title
+    u32 titleCount;                                 // Bundled title count
+    u32 pfs0FileCount;                              // PFS0 file count
+    u32 programNcaModCount;                         // Program NCA mod count (all bundled titles)
+    u32 fileIndex;                                  // Current PFS0 file entry index
+    u64 fileOffset;                                 // Current PFS0 file entry offset
+    Sha256Context hashCtx;                          // Current NCA SHA-256 checksum context
+} PACKED bundleNspJournalCtx;
+
+// Holds all the data retrieved from a single title that's needed to generate its PFS0 entries
+// Used by both regular and bundled NSP dumps
+typedef struct {
+    NcmStorageId storageId;                         // Source storage from which the data is dumped
+    NcmContentStorage ncmStorage;                   // Content storage instance for the source storage
+    NcmContentInfo *titleContentInfos;              // Raw content records retrieved from the content meta database
+    u32 titleContentInfoCnt;                        // NCA count. Skipped Delta Fragments are excluded after the CNMT NCA is processed
+    cnmt_xml_program_info xml_program_info;
+    cnmt_xml_content_info *xml_content_info;        // The CNMT NCA is always placed at the end
+    nca_cnmt_mod_data ncaCnmtMod;
+    u32 ncaProgramModCnt;
+    nca_program_mod_data *ncaProgramMod;
+    title_rights_ctx rights_info;
+    u32 cnmtNcaIndex;
+    char *cnmtXml;
+    u32 xml_rec_cnt;
+    xml_record_info *xml_records;
+    bool includeTikAndCert;                         // Set if the ticket and certificate chain must be added to the PFS0
+} nspTitleCtx;
+
+#define NSP_METADATA_WORKER_CNT         3                           // One worker thread per content type with metadata: Program, Control and LegalInformation
+
+#define BATCH_READ_AHEAD_SLOT_CNT       8                           // DUMP_BUFFER_SIZE blocks read ahead from the next title in a batch dump (32 MiB)
+
+// Metadata extraction request for a single NCA (programinfo.xml, NACP XML + icons or legalinfo.xml)
+// Requests are queued while the NCA headers are processed and handled afterwards by the worker thread for their content type
+typedef struct {
+    u32 ncaIndex;                                   // Index into nspTitleCtx::xml_content_info
+    u32 recordIndex;                                // Index into nspTitleCtx::xml_records
+    NcmContentId ncaId;
+    nca_header_t dec_header;                        // Decrypted NCA header, as it was when the request was queued
+    bool useAcidPubKey;                             // Only used with Program NCAs
+} nspMetadataJob;
+
+// Dump journal state for BIS partition images
+// Holds the streaming checksums calculated over the data dumped so far
+typedef struct {
+    bool skipFreeClusters;                          // Original value for the "Skip unallocated FAT clusters" option. Overrides the selected setting in the current session
+    u32 crc;                                        // CRC32 checksum accumulator
+    Sha256Context hashCtx;                          // SHA-256 checksum context
+} PACKED bisJournalCtx;
+
+// Allocation map for a FAT32 partition, built from its first FAT
+// Only the data area is covered. Everything located before it (boot sectors, FATs) is always dumped
+typedef struct {
+    u64 dataOffset;                                 // Partition offset of the first data cluster (cluster #2)
+    u64 clusterSize;
+    u32 clusterCnt;
+    u32 freeClusterCnt;
+    u8 *bitmap;                                     // One bit per cluster, set if the cluster is allocated
+} fatAllocationMap;
+
 typedef struct {
     bool enabled;
     nspDumpType titleType;
     u32 titleIndex;
+    NcmStorageId storageId;
     u64 contentSize;
     char *contentSizeStr;
     char nspFilename[NAME_BUF_LEN];
@@ -57,6 +129,7 @@ typedef struct {
 bool dumpNXCardImage(xciOptions *xciDumpCfg);
 int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleIndex, nspOptions *nspDumpCfg, bool batch);
 int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg);
+int dumpNintendoSubmissionPackageBundle(u32 appIndex, nspOptions *nspDumpCfg);
 bool dumpRawHfs0Partition(u32 partition, bool doSplitting);
 bool dumpHfs0PartitionData(u32 partition, bool doSplitting);
 bool dumpFileFromHfs0Partition(u32 partition, u32 fileIndex, char *filename, bool doSplitting);
@@ -67,5 +140,7 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
 bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg);
 bool dumpGameCardCertificate();
 bool dumpTicketFromTitle(u32 titleIndex, selectedTicketType curTikType, ticketOptions *tikDumpCfg);
+bool dumpAllTickets(ticketOptions *tikDumpCfg);
+bool dumpBisPartitionImage(bisPartitionType partition, bisOptions *bisDumpCfg);
 
 #endif
@@ -0,0 +1,606 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <json-c/json.h>
+
+#include "jobs.h"
+#include "dumper.h"
+#include "ui.h"
+#include "util.h"
+#include "writer.h"
+
+/* Extern variables */
+
+extern __thread int breaks;
+extern int font_height;
+
+extern curMenuType menuType;
+
+extern dumpOptions dumpCfg;
+
+extern gamecard_ctx_t gameCardInfo;
+
+extern u32 titleAppCount, titlePatchCount, titleAddOnCount;
+
+extern base_app_ctx_t *baseAppEntries;
+extern patch_addon_ctx_t *patchEntries, *addOnEntries;
+
+extern bool headlessMode, headlessPromptAnswer;
+
+/* Statically allocated variables */
+
+typedef struct {
+    const char *name;
+    size_t offset;                                  // Offset to the bool member within the options struct
+} jobBoolOption;
+
+static const char *jobTypeNames[JOB_TYPE_CNT] = { "xci", "nsp", "nsp_bundle", "batch" };
+static const char *jobResultNames[JOB_RESULT_CNT] = { "success", "error", "cancelled", "invalid" };
+
+static const char *jobTitleTypeNames[] = { "app", "patch", "addon" };   // Indexed by nspDumpType
+static const char *jobBatchSourceNames[BATCH_SOURCE_CNT] = { "all", "sdcard", "emmc", "local" };
+static const char *jobBatchOrderNames[BATCH_ORDER_CNT] = { "name", "largest_first", "source_interleaved", "fit_free_space" };
+static const char *jobWriteBackendNames[] = { "stdio", "async" };     // Indexed by outputWriterBackend
+
+static const char *batchJobExtraOptions[] = { "batchModeSrc", "batchOrder", NULL };   // Non-boolean batchOptions members, parsed separately
+
+static const jobBoolOption xciJobOptions[] = {
+    { "isFat32", offsetof(xciOptions, isFat32) },
+    { "setXciArchiveBit", offsetof(xciOptions, setXciArchiveBit) },
+    { "keepCert", offsetof(xciOptions, keepCert) },
+    { "trimDump", offsetof(xciOptions, trimDump) },
+    { "calcCrc", offsetof(xciOptions, calcCrc) },
+    { "useNoIntroLookup", offsetof(xciOptions, useNoIntroLookup) },
+    { "useBrackets", offsetof(xciOptions, useBrackets) }
+};
+
+static const jobBoolOption nspJobOptions[] = {
+    { "isFat32", offsetof(nspOptions, isFat32) },
+    { "useNoIntroLookup", offsetof(nspOptions, useNoIntroLookup) },
+    { "removeConsoleData", offsetof(nspOptions, removeConsoleData) },
+    { "tiklessDump", offsetof(nspOptions, tiklessDump) },
+    { "npdmAcidRsaPatch", offsetof(nspOptions, npdmAcidRsaPatch) },
+    { "dumpDeltaFragments", offsetof(nspOptions, dumpDeltaFragments) },
+    { "useBrackets", offsetof(nspOptions, useBrackets) }
+};
+
+static const jobBoolOption batchJobOptions[] = {
+    { "dumpAppTitles", offsetof(batchOptions, dumpAppTitles) },
+    { "dumpPatchTitles", offsetof(batchOptions, dumpPatchTitles) },
+    { "dumpAddOnTitles", offsetof(batchOptions, dumpAddOnTitles) },
+    { "isFat32", offsetof(batchOptions, isFat32) },
+    { "removeConsoleData", offsetof(batchOptions, removeConsoleData) },
+    { "tiklessDump", offsetof(batchOptions, tiklessDump) },
+    { "npdmAcidRsaPatch", offsetof(batchOptions, npdmAcidRsaPatch) },
+    { "dumpDeltaFragments", offsetof(batchOptions, dumpDeltaFragments) },
+    { "skipDumpedTitles", offsetof(batchOptions, skipDumpedTitles) },
+    { "rememberDumpedTitles", offsetof(batchOptions, rememberDumpedTitles) },
+    { "haltOnErrors", offsetof(batchOptions, haltOnErrors) },
+    { "useBrackets", offsetof(batchOptions, useBrackets) }
+};
+
+#define JOB_OPTION_CNT(x)   (sizeof(x) / sizeof((x)[0]))
+
+static int findJobStringIndex(const char **names, int nameCnt, const char *str)
+{
+    if (!names || !str) return -1;
+    
+    for(int i = 0; i < nameCnt; i++)
+    {
+        if (!strcasecmp(names[i], str)) return i;
+    }
+    
+    return -1;
+}
+
+// Returns NULL if the member doesn't exist. Sets *outInvalid if it exists but doesn't match the provided type
+static struct json_object *getJobMember(struct json_object *jobj, const char *name, json_type type, bool *outInvalid)
+{
+    struct json_object *member = NULL;
+    
+    if (!json_object_object_get_ex(jobj, name, &member) || !member) return NULL;
+    
+    if (json_object_get_type(member) != type)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid type for member \"%s\" in job! (got \"%s\", expected \"%s\")", __func__, name, json_type_to_name(json_object_get_type(member)), json_type_to_name(type));
+        breaks++;
+        *outInvalid = true;
+        return NULL;
+    }
+    
+    return member;
+}
+
+// Overrides the members from an options struct with the values from the "options" object of a job
+// Unknown options are rejected, so a typo doesn't silently leave the configured value in place
+static bool parseJobOptions(struct json_object *job, const jobBoolOption *table, u32 tableCnt, void *outCfg, const char **extraOptionNames)
+{
+    u32 i;
+    bool invalid = false;
+    
+    struct json_object *options = getJobMember(job, JOB_FILE_JOB_OPTIONS, json_type_object, &invalid);
+    if (!options) return !invalid;
+    
+    json_object_object_foreach(options, key, val)
+    {
+        if (extraOptionNames)
+        {
+            for(i = 0; extraOptionNames[i]; i++)
+            {
+                if (!strcmp(key, extraOptionNames[i])) break;
+            }
+            
+            if (extraOptionNames[i]) continue;
+        }
+        
+        for(i = 0; i < tableCnt; i++)
+        {
+            if (!strcmp(key, table[i].name)) break;
+        }
+        
+        if (i == tableCnt)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unknown option \"%s\"!", __func__, key);
+            breaks++;
+            return false;
+        }
+        
+        if (json_object_get_type(val) != json_type_boolean)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: option \"%s\" must be a boolean!", __func__, key);
+            breaks++;
+            return false;
+        }
+        
+        *((bool*)((u8*)outCfg + table[i].offset)) = json_object_get_boolean(val);
+    }
+    
+    return true;
+}
+
+static bool parseJobTitleId(struct json_object *job, u64 *outTitleId)
+{
+    bool invalid = false;
+    char *endPtr = NULL;
+    
+    struct json_object *titleIdObj = getJobMember(job, JOB_FILE_JOB_TITLE_ID, json_type_string, &invalid);
+    if (!titleIdObj)
+    {
+        if (!invalid)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: job doesn't specify a title ID!", __func__);
+            breaks++;
+        }
+        
+        return false;
+    }
+    
+    const char *titleIdStr = json_object_get_string(titleIdObj);
+    
+    *outTitleId = strtoull(titleIdStr, &endPtr, 16);
+    if (strlen(titleIdStr) != 16 || !endPtr || *endPtr != '\0')
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title ID \"%s\"!", __func__, titleIdStr);
+        breaks++;
+        return false;
+    }
+    
+    return true;
+}
+
+static bool parseJobSource(struct json_object *job, curMenuType *outSource)
+{
+    bool invalid = false;
+    
+    struct json_object *sourceObj = getJobMember(job, JOB_FILE_JOB_SOURCE, json_type_string, &invalid);
+    if (!sourceObj)
+    {
+        if (invalid) return false;
+        
+        // Titles are looked up in the SD card / eMMC by default
+        *outSource = MENUTYPE_SDCARD_EMMC;
+        return true;
+    }
+    
+    const char *sourceStr = json_object_get_string(sourceObj);
+    
+    if (!strcasecmp(sourceStr, "gamecard"))
+    {
+        *outSource = MENUTYPE_GAMECARD;
+    } else
+    if (!strcasecmp(sourceStr, "sdcard_emmc"))
+    {
+        *outSource = MENUTYPE_SDCARD_EMMC;
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid source \"%s\"!", __func__, sourceStr);
+        breaks++;
+        return false;
+    }
+    
+    return true;
+}
+
+// Loads the title info for the provided source, just like entering its menu would
+static bool selectJobSource(curMenuType source)
+{
+    if (menuType != source)
+    {
+        // Go through the main menu first, so the title info from the previous source gets discarded
+        menuType = MENUTYPE_MAIN;
+        loadTitleInfo();
+        menuType = source;
+    }
+    
+    loadTitleInfo();
+    
+    if (source == MENUTYPE_GAMECARD && !gameCardInfo.isInserted)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: gamecard not inserted!", __func__);
+        breaks++;
+        return false;
+    }
+    
+    return true;
+}
+
+static bool findJobTitleIndex(nspDumpType titleType, u64 titleId, u32 *outIndex)
+{
+    u32 i;
+    
+    switch(titleType)
+    {
+        case DUMP_APP_NSP:
+            for(i = 0; i < titleAppCount; i++)
+            {
+                if (baseAppEntries[i].titleId == titleId) break;
+            }
+            
+            if (i < titleAppCount) *outIndex = i;
+            return (i < titleAppCount);
+        case DUMP_PATCH_NSP:
+            for(i = 0; i < titlePatchCount; i++)
+            {
+                if (patchEntries[i].titleId == titleId) break;
+            }
+            
+            if (i < titlePatchCount) *outIndex = i;
+            return (i < titlePatchCount);
+        case DUMP_ADDON_NSP:
+            for(i = 0; i < titleAddOnCount; i++)
+            {
+                if (addOnEntries[i].titleId == titleId) break;
+            }
+            
+            if (i < titleAddOnCount) *outIndex = i;
+            return (i < titleAddOnCount);
+        default:
+            break;
+    }
+    
+    return false;
+}
+
+static jobResult runNspJob(struct json_object *job, bool bundle)
+{
+    bool invalid = false;
+    
+    int titleType = DUMP_APP_NSP, ret;
+    curMenuType source;
+    u64 titleId = 0;
+    u32 titleIndex = 0;
+    
+    nspOptions nspDumpCfg;
+    memcpy(&nspDumpCfg, &(dumpCfg.nspDumpCfg), sizeof(nspOptions));
+    
+    if (!parseJobSource(job, &source) || !parseJobTitleId(job, &titleId) || !parseJobOptions(job, nspJobOptions, JOB_OPTION_CNT(nspJobOptions), &nspDumpCfg, NULL)) return JOB_RESULT_INVALID;
+    
+    // Bundles are always requested through their base application
+    if (!bundle)
+    {
+        struct json_object *titleTypeObj = getJobMember(job, JOB_FILE_JOB_TITLE_TYPE, json_type_string, &invalid);
+        if (invalid) return JOB_RESULT_INVALID;
+        
+        if (titleTypeObj)
+        {
+            titleType = findJobStringIndex(jobTitleTypeNames, DUMP_ADDON_NSP + 1, json_object_get_string(titleTypeObj));
+            if (titleType < 0)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title type \"%s\"!", __func__, json_object_get_string(titleTypeObj));
+                breaks++;
+                return JOB_RESULT_INVALID;
+            }
+        }
+    }
+    
+    if (!selectJobSource(source)) return JOB_RESULT_ERROR;
+    
+    if (!findJobTitleIndex((nspDumpType)titleType, titleId, &titleIndex))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title %016lX not found!", __func__, titleId);
+        breaks++;
+        return JOB_RESULT_ERROR;
+    }
+    
+    if (bundle)
+    {
+        ret = dumpNintendoSubmissionPackageBundle(titleIndex, &nspDumpCfg);
+    } else {
+        ret = dumpNintendoSubmissionPackage((nspDumpType)titleType, titleIndex, &nspDumpCfg, false);
+    }
+    
+    return (ret == 0 ? JOB_RESULT_SUCCESS : (ret == -2 ? JOB_RESULT_CANCELLED : JOB_RESULT_ERROR));
+}
+
+static jobResult runJob(struct json_object *job, jobType type)
+{
+    bool invalid = false;
+    int ret;
+    
+    switch(type)
+    {
+        case JOB_TYPE_XCI:
+        {
+            xciOptions xciDumpCfg;
+            memcpy(&xciDumpCfg, &(dumpCfg.xciDumpCfg), sizeof(xciOptions));
+            
+            if (!parseJobOptions(job, xciJobOptions, JOB_OPTION_CNT(xciJobOptions), &xciDumpCfg, NULL)) return JOB_RESULT_INVALID;
+            
+            struct json_object *imageObj = getJobMember(job, JOB_FILE_JOB_GAMECARD_IMAGE, json_type_string, &invalid);
+            if (invalid) return JOB_RESULT_INVALID;
+            
+            if (imageObj && !setGameCardImageFile(json_object_get_string(imageObj)))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to use \"%s\" as a gamecard image!", __func__, json_object_get_string(imageObj));
+                breaks++;
+                return JOB_RESULT_ERROR;
+            }
+            
+            jobResult result = JOB_RESULT_ERROR;
+            if (selectJobSource(MENUTYPE_GAMECARD) && dumpNXCardImage(&xciDumpCfg)) result = JOB_RESULT_SUCCESS;
+            
+            // Go back to the inserted gamecard
+            if (imageObj)
+            {
+                menuType = MENUTYPE_MAIN;
+                loadTitleInfo();
+                setGameCardImageFile(NULL);
+            }
+            
+            return result;
+        }
+        case JOB_TYPE_NSP:
+            return runNspJob(job, false);
+        case JOB_TYPE_NSP_BUNDLE:
+            return runNspJob(job, true);
+        case JOB_TYPE_BATCH:
+        {
+            batchOptions batchDumpCfg;
+            memcpy(&batchDumpCfg, &(dumpCfg.batchDumpCfg), sizeof(batchOptions));
+            
+            if (!parseJobOptions(job, batchJobOptions, JOB_OPTION_CNT(batchJobOptions), &batchDumpCfg, batchJobExtraOptions)) return JOB_RESULT_INVALID;
+            
+            struct json_object *options = getJobMember(job, JOB_FILE_JOB_OPTIONS, json_type_object, &invalid);
+            struct json_object *batchSrcObj = (options ? getJobMember(options, "batchModeSrc", json_type_string, &invalid) : NULL);
+            struct json_object *batchOrderObj = (options ? getJobMember(options, "batchOrder", json_type_string, &invalid) : NULL);
+            if (invalid) return JOB_RESULT_INVALID;
+            
+            if (batchSrcObj)
+            {
+                int batchSrc = findJobStringIndex(jobBatchSourceNames, BATCH_SOURCE_CNT, json_object_get_string(batchSrcObj));
+                if (batchSrc < 0)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid batch source \"%s\"!", __func__, json_object_get_string(batchSrcObj));
+                    breaks++;
+                    return JOB_RESULT_INVALID;
+                }
+                
+                batchDumpCfg.batchModeSrc = (batchModeSourceStorage)batchSrc;
+            }
+            
+            if (batchOrderObj)
+            {
+                int batchOrder = findJobStringIndex(jobBatchOrderNames, BATCH_ORDER_CNT, json_object_get_string(batchOrderObj));
+                if (batchOrder < 0)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid batch order \"%s\"!", __func__, json_object_get_string(batchOrderObj));
+                    breaks++;
+                    return JOB_RESULT_INVALID;
+                }
+                
+                batchDumpCfg.batchOrder = (batchOrderPolicy)batchOrder;
+            }
+            
+            if (!selectJobSource(MENUTYPE_SDCARD_EMMC)) return JOB_RESULT_ERROR;
+            
+            ret = dumpNintendoSubmissionPackageBatch(&batchDumpCfg);
+            
+            return (ret == 0 ? JOB_RESULT_SUCCESS : (ret == -2 ? JOB_RESULT_CANCELLED : JOB_RESULT_ERROR));
+        }
+        default:
+            break;
+    }
+    
+    return JOB_RESULT_INVALID;
+}
+
+bool runJobFile(const char *path)
+{
+    if (!path || !strlen(path)) return false;
+    
+    u32 i, succeeded = 0, failed = 0;
+    size_t jobCnt = 0;
+    bool invalid = false, assumeYes = false, success = false;
+    
+    struct json_object *jobFile = NULL, *jobs = NULL, *report = NULL, *reportJobs = NULL, *assumeYesObj = NULL, *writeBackendObj = NULL;
+    
+    int writeBackend = OUTPUT_WRITER_BACKEND_STDIO;
+    
+    char donePath[NAME_BUF_LEN] = {'\0'};
+    
+    uiPrintHeadline();
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Loading job file \"%s\"...", path);
+    breaks++;
+    
+    uiRefreshDisplay();
+    
+    jobFile = json_object_from_file(path);
+    if (!jobFile || json_object_get_type(jobFile) != json_type_object)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to parse job file! (%s)", __func__, json_util_get_last_err());
+        goto out;
+    }
+    
+    assumeYesObj = getJobMember(jobFile, JOB_FILE_ASSUME_YES, json_type_boolean, &invalid);
+    if (assumeYesObj) assumeYes = json_object_get_boolean(assumeYesObj);
+    
+    writeBackendObj = getJobMember(jobFile, JOB_FILE_WRITE_BACKEND, json_type_string, &invalid);
+    if (writeBackendObj)
+    {
+        writeBackend = findJobStringIndex(jobWriteBackendNames, MAX_ELEMENTS(jobWriteBackendNames), json_object_get_string(writeBackendObj));
+        if (writeBackend < 0)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid write backend \"%s\"!", __func__, json_object_get_string(writeBackendObj));
+            goto out;
+        }
+    }
+    
+    jobs = getJobMember(jobFile, JOB_FILE_JOBS, json_type_array, &invalid);
+    if (invalid) goto out;
+    
+    if (!jobs || !(jobCnt = json_object_array_length(jobs)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: job file doesn't contain any jobs!", __func__);
+        goto out;
+    }
+    
+    report = json_object_new_object();
+    reportJobs = json_object_new_array();
+    if (!report || !reportJobs)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the job report!", __func__);
+        if (reportJobs) json_object_put(reportJobs);
+        goto out;
+    }
+    
+    json_object_object_add(report, "jobFile", json_object_new_string(path));
+    json_object_object_add(report, "jobs", reportJobs);
+    
+    // Every yes/no prompt gets answered automatically and "press any button" screens are skipped
+    headlessMode = true;
+    
+    outputWriterSetDefaultBackend((outputWriterBackend)writeBackend);
+    
+    for(i = 0; i < jobCnt; i++)
+    {
+        struct json_object *job = json_object_array_get_idx(jobs, i);
+        struct json_object *reportJob = json_object_new_object();
+        struct json_object *typeObj = NULL, *jobAssumeYesObj = NULL, *titleIdObj = NULL;
+        
+        int type = -1;
+        jobResult result = JOB_RESULT_INVALID;
+        
+        invalid = false;
+        
+        uiPrintHeadline();
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "Job %u / %lu", i + 1, jobCnt);
+        breaks += 2;
+        
+        uiRefreshDisplay();
+        
+        u64 start = armGetSystemTick();
+        
+        if (job && json_object_get_type(job) == json_type_object)
+        {
+            typeObj = getJobMember(job, JOB_FILE_JOB_TYPE, json_type_string, &invalid);
+            if (typeObj) type = findJobStringIndex(jobTypeNames, JOB_TYPE_CNT, json_object_get_string(typeObj));
+            
+            jobAssumeYesObj = getJobMember(job, JOB_FILE_ASSUME_YES, json_type_boolean, &invalid);
+            headlessPromptAnswer = (jobAssumeYesObj ? json_object_get_boolean(jobAssumeYesObj) : assumeYes);
+            
+            if (!invalid && type >= 0)
+            {
+                result = runJob(job, (jobType)type);
+            } else
+            if (!invalid)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid job type!", __func__);
+                breaks++;
+            }
+        } else {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: job #%u is not a JSON object!", __func__, i);
+            breaks++;
+        }
+        
+        u64 elapsed = armTicksToNs(armGetSystemTick() - start);
+        
+        if (result == JOB_RESULT_SUCCESS)
+        {
+            succeeded++;
+        } else {
+            failed++;
+        }
+        
+        updateFreeSpace();
+        
+        if (reportJob)
+        {
+            json_object_object_add(reportJob, "index", json_object_new_int((int)i));
+            if (typeObj) json_object_object_add(reportJob, "type", json_object_new_string(json_object_get_string(typeObj)));
+            if (job && json_object_object_get_ex(job, JOB_FILE_JOB_TITLE_ID, &titleIdObj)) json_object_object_add(reportJob, "titleId", json_object_get(titleIdObj));
+            json_object_object_add(reportJob, "result", json_object_new_string(jobResultNames[result]));
+            json_object_object_add(reportJob, "elapsedSeconds", json_object_new_double((double)elapsed / 1000000000.0));
+            json_object_array_add(reportJobs, reportJob);
+        }
+        
+        // The report is rewritten after every job, so it's still useful if the console crashes or runs out of battery halfway through
+        json_object_object_add(report, "succeeded", json_object_new_int((int)succeeded));
+        json_object_object_add(report, "failed", json_object_new_int((int)failed));
+        json_object_object_add(report, "finished", json_object_new_boolean(i == (jobCnt - 1)));
+        
+        if (json_object_to_file_ext(JOB_RESULT_PATH, report, JSON_C_TO_STRING_PRETTY) != 0)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write job report to \"%s\"!", __func__, JOB_RESULT_PATH);
+            breaks++;
+        }
+    }
+    
+    headlessMode = false;
+    headlessPromptAnswer = false;
+    
+    // Interactive dumps always use the default backend
+    outputWriterSetDefaultBackend(OUTPUT_WRITER_BACKEND_STDIO);
+    
+    // Leave the title info the way the main menu expects it
+    menuType = MENUTYPE_MAIN;
+    loadTitleInfo();
+    
+    // Don't run the same job file again on the next launch
+    snprintf(donePath, MAX_CHARACTERS(donePath), "%s" JOB_FILE_DONE_SUFFIX, path);
+    remove(donePath);
+    rename(path, donePath);
+    
+    if (failed)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Job file processed. Succeeded: %u | Failed: %u.", succeeded, failed);
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Job file processed. Succeeded: %u | Failed: %u.", succeeded, failed);
+    }
+    
+    breaks++;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Job report saved to \"%s\".", JOB_RESULT_PATH);
+    
+    success = (failed == 0);
+
+out:
+    breaks += 2;
+    
+    if (report) json_object_put(report);
+    if (jobFile) json_object_put(jobFile);
+    
+    return success;
+}
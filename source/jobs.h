@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef __JOBS_H__
+#define __JOBS_H__
+
+#include <switch.h>
+#include "util.h"
+
+#define JOB_FILE_PATH                   APP_BASE_PATH "jobs.json"
+#define JOB_RESULT_PATH                 APP_BASE_PATH "jobs_result.json"
+#define JOB_FILE_DONE_SUFFIX            ".done"
+
+#define JOB_FILE_ASSUME_YES             "assumeYes"
+#define JOB_FILE_WRITE_BACKEND          "writeBackend"
+#define JOB_FILE_JOBS                   "jobs"
+#define JOB_FILE_JOB_TYPE               "type"
+#define JOB_FILE_JOB_SOURCE             "source"
+#define JOB_FILE_JOB_TITLE_ID           "titleId"
+#define JOB_FILE_JOB_TITLE_TYPE         "titleType"
+#define JOB_FILE_JOB_OPTIONS            "options"
+#define JOB_FILE_JOB_GAMECARD_IMAGE     "gameCardImage"
+
+typedef enum {
+    JOB_TYPE_XCI = 0,
+    JOB_TYPE_NSP,
+    JOB_TYPE_NSP_BUNDLE,
+    JOB_TYPE_BATCH,
+    JOB_TYPE_CNT
+} jobType;
+
+typedef enum {
+    JOB_RESULT_SUCCESS = 0,
+    JOB_RESULT_ERROR,
+    JOB_RESULT_CANCELLED,
+    JOB_RESULT_INVALID,
+    JOB_RESULT_CNT
+} jobResult;
+
+// Runs every job from the provided JSON job file without any user interaction, then writes a JSON report to JOB_RESULT_PATH
+// Job file layout:
+// {
+//     "assumeYes": false,                          // Optional. Answer used for every yes/no prompt. Can be overridden by each job
+//     "writeBackend": "stdio",                     // Optional. Output writer backend used by every job: "stdio" (default) or "async" (a worker thread writes the data while the next block is read, only used with outputs of 64 MiB or more)
+//     "jobs": [
+//         { "type": "xci", "gameCardImage": "...", "options": { ... } },                               // xciOptions members. "gameCardImage" is optional, and replaces the inserted gamecard with a XCI image file
+//         { "type": "nsp", "source": "gamecard", "titleId": "...", "titleType": "app", "options": { ... } },  // nspOptions members. "titleType" can be "app", "patch" or "addon"
+//         { "type": "nsp_bundle", "source": "sdcard_emmc", "titleId": "...", "options": { ... } },     // nspOptions members
+//         { "type": "batch", "options": { ... } }                                                      // batchOptions members. "batchModeSrc" can be "all", "sdcard", "emmc" or "local", "batchOrder" can be "name", "largest_first", "source_interleaved" or "fit_free_space"
+//     ]
+// }
+// Missing options keep the values from the current configuration
+// The job file is renamed after being processed (JOB_FILE_DONE_SUFFIX is appended to its name), so it doesn't run again on the next launch
+bool runJobFile(const char *path);
+
+#endif
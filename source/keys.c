@@ -7,12 +7,14 @@
 #include "keys.h"
 #include "util.h"
 #include "ui.h"
+#include "sha256_fast.h"
 #include "es.h"
 #include "save.h"
+#include "ncm_local.h"
 
 /* Extern variables */
 
-extern int breaks;
+extern __thread int breaks;
 extern int font_height;
 
 extern u8 *dumpBuf;
@@ -26,6 +28,10 @@ nca_keyset_t nca_keyset;
 static SetCalRsa2048DeviceKey eticket_data;
 static bool setcal_eticket_retrieved = false;
 
+static u8 *eticket_cache = NULL;                    // Raw tickets (ETICKET_TIK_FILE_SIZE bytes each) from both ES savefiles. Filled by loadEticketCache()
+static u32 eticket_cache_cnt = 0;
+static bool eticket_cache_loaded = false;
+
 static keyLocation FSRodata = {
     FS_TID,
     SEG_RODATA,
@@ -254,22 +260,30 @@ bool findKeyInProcessMemory(const keyLocation *location, const keyInfo *findKey,
     }
     
     u64 i;
-    u8 temp_hash[SHA256_HASH_SIZE];
+    u32 j, cnt;
+    
+    const void *candidates[SHA256_FAST_MAX_LANES];
+    u8 temp_hashes[SHA256_FAST_MAX_LANES * SHA256_HASH_SIZE];
+    
     bool found = false;
     
     // Hash every key-length-sized byte chunk in data until it matches a key hash
-    for(i = 0; i < location->dataSize; i++)
+    // Several consecutive chunks are hashed at once to take advantage of the multi-buffer SHA-256 implementation
+    for(i = 0; !found && i < location->dataSize && (location->dataSize - i) >= findKey->size; i += cnt)
     {
-        if (!found && (location->dataSize - i) < findKey->size) break;
+        for(cnt = 0; cnt < SHA256_FAST_MAX_LANES && (location->dataSize - (i + cnt)) >= findKey->size; cnt++) candidates[cnt] = (location->data + i + cnt);
         
-        sha256CalculateHash(temp_hash, location->data + i, findKey->size);
+        sha256MultiCalculateHash(temp_hashes, candidates, findKey->size, cnt);
         
-        if (!memcmp(temp_hash, findKey->hash, SHA256_HASH_SIZE))
+        for(j = 0; j < cnt; j++)
         {
-            // Jackpot
-            memcpy(out, location->data + i, findKey->size);
-            found = true;
-            break;
+            if (!memcmp(temp_hashes + (j * SHA256_HASH_SIZE), findKey->hash, SHA256_HASH_SIZE))
+            {
+                // Jackpot
+                memcpy(out, location->data + i + j, findKey->size);
+                found = true;
+                break;
+            }
         }
     }
     
@@ -763,310 +777,555 @@ void mgf1(const u8 *data, size_t data_length, u8 *mask, size_t mask_length)
     free(data_counter);
 }
 
-int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key)
+static const u8 *findEticketCacheEntry(const u8 *rightsId)
 {
-    int ret = -1;
+    u32 i;
     
-    if (!dec_nca_header || dec_nca_header->kaek_ind > 2 || (!out_tik && !out_dec_key && !out_enc_key))
+    for(i = 0; i < eticket_cache_cnt; i++)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve NCA ticket and/or titlekey.", __func__);
-        return ret;
+        if (!memcmp(eticket_cache + (i * ETICKET_TIK_FILE_SIZE) + ETICKET_RIGHTSID_OFFSET, rightsId, 0x10)) return (eticket_cache + (i * ETICKET_TIK_FILE_SIZE));
     }
     
-    u32 i, j;
-    bool has_rights_id = false;
+    return NULL;
+}
+
+// Retrieves the eTicket RSA device key from PRODINFO and decrypts it. Only needed to handle personalized tickets
+static bool loadEticketDeviceKey()
+{
+    if (setcal_eticket_retrieved) return true;
     
-    for(i = 0; i < 0x10; i++)
+    Result result;
+    
+    Aes128CtrContext eticket_aes_ctx;
+    unsigned char ctr[0x10];
+    
+    u8 *D = NULL, *N = NULL, *E = NULL;
+    
+    memset(&eticket_data, 0, sizeof(SetCalRsa2048DeviceKey));
+    
+    result = setcalInitialize();
+    if (R_FAILED(result))
     {
-        if (dec_nca_header->rights_id[i] != 0)
-        {
-            has_rights_id = true;
-            break;
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the set:cal service! (0x%08X)", __func__, result);
+        return false;
     }
     
-    if (!has_rights_id)
+    result = setcalGetEticketDeviceKey(&eticket_data);
+    
+    setcalExit();
+    
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA doesn't use titlekey crypto.", __func__);
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: setcalGetEticketDeviceKey failed! (0x%08X)", __func__, result);
+        return false;
     }
     
-    u8 crypto_type = (dec_nca_header->crypto_type2 > dec_nca_header->crypto_type ? dec_nca_header->crypto_type2 : dec_nca_header->crypto_type);
-    if (crypto_type) crypto_type--;
+    // Decrypt eTicket RSA key
+    memcpy(ctr, eticket_data.key, ETICKET_DEVKEY_RSA_CTR_SIZE);
+    aes128CtrContextCreate(&eticket_aes_ctx, nca_keyset.eticket_rsa_kek, ctr);
+    aes128CtrCrypt(&eticket_aes_ctx, eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET, eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET, ETICKET_DEVKEY_RSA_SIZE);
     
-    if (crypto_type >= 0x20)
+    // Public exponent must use RSA-2048 SHA-1 signature method
+    // The value is stored use big endian byte order
+    if (__builtin_bswap32(*((u32*)(eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET + 0x200))) != SIGTYPE_RSA2048_SHA1)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA keyblob index.", __func__);
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid public RSA exponent for eTicket data! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
+        return false;
     }
     
+    D = (eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET);
+    N = (eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET + 0x100);
+    E = (eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET + 0x200);
+    
+    if (!testKeyPair(E, D, N)) return false;
+    
+    setcal_eticket_retrieved = true;
+    
+    return true;
+}
+
+// Unwraps the titlekey from the RSA-OAEP titlekey block of a personalized ticket. loadEticketDeviceKey() must have been called first
+// The output titlekey is still encrypted with the titlekek, just like the one from a common ticket
+static bool decryptPersonalizedTitleKey(const u8 *titleKeyBlock, u8 *out)
+{
     Result result;
-    u32 common_count, personalized_count, ids_written;
-    FsRightsId *common_rights_ids = NULL, *personalized_rights_ids = NULL;
+    u32 i;
     
-    bool foundRightsId = false;
-    u8 rightsIdType = 0; // 1 = Common, 2 = Personalized
+    u8 M[0x100], salt[0x20], db[0xDF];
     
-    Aes128CtrContext eticket_aes_ctx;
-    unsigned char ctr[0x10];
+    u8 *D = (eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET);
+    u8 *N = (eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET + 0x100);
     
-    u8 *D = NULL, *N = NULL, *E = NULL;
+    result = splUserExpMod(titleKeyBlock, N, D, 0x100, M);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splUserExpMod failed! (titleKeyBlock) (0x%08X)", __func__, result);
+        return false;
+    }
+    
+    // Decrypt the titlekey
+    mgf1(M + 0x21, 0xDF, salt, 0x20);
+    for(i = 0; i < 0x20; i++) salt[i] ^= M[i + 1];
+    
+    mgf1(salt, 0x20, db, 0xDF);
+    for(i = 0; i < 0xDF; i++) db[i] ^= M[i + 0x21];
     
+    // Verify if it starts with a null string hash
+    if (memcmp(db, null_hash, 0x20) != 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: titlekey decryption failed! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
+        return false;
+    }
+    
+    memcpy(out, db + 0xCF, 0x10);
+    
+    return true;
+}
+
+// Opens the "/ticket.bin" file from the ES common or personalized eTicket savefile
+// FatFs is used to mount the BIS System partition and read the ES savedata files to avoid 0xE02 (file already in use) errors
+static bool openEticketSave(bool personalized, FIL **outFile, save_ctx_t **outSaveCtx, allocation_table_storage_ctx_t *outFatStorage, u64 *outSize)
+{
     FRESULT fr = FR_OK;
     FIL *eTicketSave = NULL;
     
     save_ctx_t *save_ctx = NULL;
-    allocation_table_storage_ctx_t fat_storage;
     save_fs_list_entry_t entry;
     const char ticket_bin_path[SAVE_FS_LIST_MAX_NAME_LENGTH] = "/ticket.bin";
     
-    u32 buf_size = (ETICKET_ENTRY_SIZE * 0x10);
-    u32 br = buf_size;
-    u64 total_br = 0;
+    char tmp[NAME_BUF_LEN / 2] = {'\0'};
+    
+    eTicketSave = calloc(1, sizeof(FIL));
+    if (!eTicketSave)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for FatFs file descriptor!", __func__);
+        return false;
+    }
+    
+    fr = f_open(eTicketSave, (!personalized ? BIS_COMMON_TIK_SAVE_NAME : BIS_PERSONALIZED_TIK_SAVE_NAME), FA_READ | FA_OPEN_EXISTING);
+    if (fr)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open ES %s eTicket save! (%u)", __func__, (!personalized ? "common" : "personalized"), fr);
+        free(eTicketSave);
+        return false;
+    }
+    
+    save_ctx = calloc(1, sizeof(save_ctx_t));
+    if (!save_ctx)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for ticket savefile context!", __func__);
+        f_close(eTicketSave);
+        free(eTicketSave);
+        return false;
+    }
     
+    save_ctx->file = eTicketSave;
+    save_ctx->tool_ctx.action = 0;
+    
+    if (!save_process(save_ctx))
+    {
+        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to process ticket savefile!", __func__);
+        strcat(strbuf, tmp);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        free(save_ctx);
+        f_close(eTicketSave);
+        free(eTicketSave);
+        return false;
+    }
+    
+    if (!save_hierarchical_file_table_get_file_entry_by_path(&save_ctx->save_filesystem_core.file_table, ticket_bin_path, &entry))
+    {
+        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to get file entry for \"%s\" in ticket savefile!", __func__, ticket_bin_path);
+        strcat(strbuf, tmp);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        save_free_contexts(save_ctx);
+        free(save_ctx);
+        f_close(eTicketSave);
+        free(eTicketSave);
+        return false;
+    }
+    
+    if (!save_open_fat_storage(&save_ctx->save_filesystem_core, outFatStorage, entry.value.save_file_info.start_block))
+    {
+        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to open FAT storage at block 0x%X for \"%s\" in ticket savefile!", __func__, entry.value.save_file_info.start_block, ticket_bin_path);
+        strcat(strbuf, tmp);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        save_free_contexts(save_ctx);
+        free(save_ctx);
+        f_close(eTicketSave);
+        free(eTicketSave);
+        return false;
+    }
+    
+    *outFile = eTicketSave;
+    *outSaveCtx = save_ctx;
+    *outSize = entry.value.save_file_info.length;
+    
+    return true;
+}
+
+static void closeEticketSave(FIL *eTicketSave, save_ctx_t *save_ctx)
+{
+    if (save_ctx)
+    {
+        save_free_contexts(save_ctx);
+        free(save_ctx);
+    }
+    
+    if (eTicketSave)
+    {
+        f_close(eTicketSave);
+        free(eTicketSave);
+    }
+}
+
+// Reads the next eTicket list chunk into dumpBuf. Returns zero once the end of the list has been reached, or -1 if a read error occurred
+static int readEticketSaveChunk(allocation_table_storage_ctx_t *fat_storage, u64 offset, u64 size)
+{
     char tmp[NAME_BUF_LEN / 2] = {'\0'};
+    u32 buf_size = (ETICKET_ENTRY_SIZE * 0x10);
+    u32 br;
     
-    bool foundEticket = false, proceed = true;
+    if (offset >= size) return 0;
     
-    u8 titlekey[0x10];
-    Aes128Context titlekey_aes_ctx;
+    br = save_allocation_table_storage_read(fat_storage, dumpBuf, offset, buf_size);
+    if (br != buf_size)
+    {
+        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read %u bytes chunk at offset 0x%lX from \"/ticket.bin\" in ticket savefile!", __func__, buf_size, offset);
+        strcat(strbuf, tmp);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        return -1;
+    }
     
-    result = esInitialize();
+    if (dumpBuf[0] == 0) return 0;
+    
+    return (int)br;
+}
+
+// Retrieves the rights IDs from all the common or personalized tickets available in the ES service
+// Returns false if an error occurred. *outRightsIds is set to NULL if no tickets are available
+static bool listEticketRightsIds(bool personalized, FsRightsId **outRightsIds, u32 *outCount)
+{
+    Result result;
+    u32 count = 0, ids_written = 0;
+    FsRightsId *rights_ids = NULL;
+    
+    *outRightsIds = NULL;
+    *outCount = 0;
+    
+    result = (!personalized ? esCountCommonTicket(&count) : esCountPersonalizedTicket(&count));
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the ES service! (0x%08X)", __func__, result);
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esCount%sTicket failed! (0x%08X)", __func__, (!personalized ? "Common" : "Personalized"), result);
+        return false;
+    }
+    
+    if (!count) return true;
+    
+    rights_ids = calloc(count, sizeof(FsRightsId));
+    if (!rights_ids)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for %s tickets' rights IDs!", __func__, (!personalized ? "common" : "personalized"));
+        return false;
     }
     
-    result = esCountCommonTicket(&common_count);
+    result = (!personalized ? esListCommonTicket(&ids_written, rights_ids, count * sizeof(FsRightsId)) : esListPersonalizedTicket(&ids_written, rights_ids, count * sizeof(FsRightsId)));
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esCountCommonTicket failed! (0x%08X)", __func__, result);
-        esExit();
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esList%sTicket failed! (0x%08X)", __func__, (!personalized ? "Common" : "Personalized"), result);
+        free(rights_ids);
+        return false;
     }
     
-    result = esCountPersonalizedTicket(&personalized_count);
+    *outRightsIds = rights_ids;
+    *outCount = (ids_written < count ? ids_written : count);
+    
+    return true;
+}
+
+static bool findRightsIdInList(const FsRightsId *rightsIds, u32 count, const u8 *rightsId)
+{
+    u32 i;
+    
+    for(i = 0; i < count; i++)
+    {
+        if (!memcmp(rightsIds[i].c, rightsId, 0x10)) return true;
+    }
+    
+    return false;
+}
+
+bool loadEticketCache()
+{
+    if (eticket_cache_loaded) return true;
+    
+    Result result;
+    u32 i, j;
+    
+    FsRightsId *rights_ids[2] = { NULL, NULL };
+    u32 rights_id_cnt[2] = { 0, 0 };
+    
+    FIL *eTicketSave = NULL;
+    save_ctx_t *save_ctx = NULL;
+    allocation_table_storage_ctx_t fat_storage;
+    u64 save_size = 0, total_br = 0;
+    int br = 0;
+    
+    bool success = false;
+    
+    result = esInitialize();
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esCountPersonalizedTicket failed! (0x%08X)", __func__, result);
-        esExit();
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the ES service! (0x%08X)", __func__, result);
+        return false;
     }
     
-    if (!common_count && !personalized_count)
+    // Index 0: common tickets, index 1: personalized tickets
+    // Only rights IDs listed by ES are cached, so stale entries from the savefiles are ignored
+    for(i = 0; i < 2; i++)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no tickets available!", __func__);
-        esExit();
-        return ret;
+        if (!listEticketRightsIds((i == 1), &(rights_ids[i]), &(rights_id_cnt[i]))) break;
     }
     
-    if (common_count)
+    esExit();
+    
+    if (i < 2) goto out;
+    
+    if (rights_id_cnt[0] || rights_id_cnt[1])
     {
-        common_rights_ids = calloc(common_count, sizeof(FsRightsId));
-        if (!common_rights_ids)
+        eticket_cache = calloc(rights_id_cnt[0] + rights_id_cnt[1], ETICKET_TIK_FILE_SIZE);
+        if (!eticket_cache)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for common tickets' rights IDs!", __func__);
-            esExit();
-            return ret;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the eTicket cache!", __func__);
+            goto out;
         }
+    }
+    
+    for(i = 0; i < 2; i++)
+    {
+        if (!rights_id_cnt[i]) continue;
         
-        result = esListCommonTicket(&ids_written, common_rights_ids, common_count * sizeof(FsRightsId));
-        if (R_FAILED(result))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esListCommonTicket failed! (0x%08X)", __func__, result);
-            free(common_rights_ids);
-            esExit();
-            return ret;
-        }
+        if (!openEticketSave((i == 1), &eTicketSave, &save_ctx, &fat_storage, &save_size)) goto out;
         
-        for(i = 0; i < common_count; i++)
+        total_br = 0;
+        
+        while((br = readEticketSaveChunk(&fat_storage, total_br, save_size)) > 0)
         {
-            if (!memcmp(common_rights_ids[i].c, dec_nca_header->rights_id, 0x10))
+            for(j = 0; j < (u32)br; j += ETICKET_ENTRY_SIZE)
             {
-                foundRightsId = true;
-                rightsIdType = 1; // Common
-                break;
+                // Only read eTicket entries with RSA-2048 SHA-256 signature method
+                if (*((u32*)(dumpBuf + j)) != SIGTYPE_RSA2048_SHA256 || !findRightsIdInList(rights_ids[i], rights_id_cnt[i], dumpBuf + j + ETICKET_RIGHTSID_OFFSET)) continue;
+                
+                // Skip duplicate entries
+                if (findEticketCacheEntry(dumpBuf + j + ETICKET_RIGHTSID_OFFSET)) continue;
+                
+                if (eticket_cache_cnt >= (rights_id_cnt[0] + rights_id_cnt[1])) break;
+                
+                memcpy(eticket_cache + (eticket_cache_cnt * ETICKET_TIK_FILE_SIZE), dumpBuf + j, ETICKET_TIK_FILE_SIZE);
+                eticket_cache_cnt++;
             }
+            
+            total_br += (u64)br;
         }
         
-        free(common_rights_ids);
+        closeEticketSave(eTicketSave, save_ctx);
+        eTicketSave = NULL;
+        save_ctx = NULL;
+        
+        if (br < 0) goto out;
+    }
+    
+    eticket_cache_loaded = success = true;
+    
+out:
+    for(i = 0; i < 2; i++)
+    {
+        if (rights_ids[i]) free(rights_ids[i]);
+    }
+    
+    if (!success) freeEticketCache();
+    
+    return success;
+}
+
+void freeEticketCache()
+{
+    if (eticket_cache)
+    {
+        free(eticket_cache);
+        eticket_cache = NULL;
+    }
+    
+    eticket_cache_cnt = 0;
+    eticket_cache_loaded = false;
+}
+
+u32 getEticketCacheCount()
+{
+    return eticket_cache_cnt;
+}
+
+int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, NcmStorageId storageId, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key)
+{
+    int ret = -1;
+    
+    if (!dec_nca_header || dec_nca_header->kaek_ind > 2 || (!out_tik && !out_dec_key && !out_enc_key))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve NCA ticket and/or titlekey.", __func__);
+        return ret;
+    }
+    
+    u32 i;
+    bool has_rights_id = false;
+    
+    for(i = 0; i < 0x10; i++)
+    {
+        if (dec_nca_header->rights_id[i] != 0)
+        {
+            has_rights_id = true;
+            break;
+        }
+    }
+    
+    if (!has_rights_id)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA doesn't use titlekey crypto.", __func__);
+        return ret;
     }
     
-    if (!foundRightsId && personalized_count)
+    u8 crypto_type = (dec_nca_header->crypto_type2 > dec_nca_header->crypto_type ? dec_nca_header->crypto_type2 : dec_nca_header->crypto_type);
+    if (crypto_type) crypto_type--;
+    
+    if (crypto_type >= 0x20)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA keyblob index.", __func__);
+        return ret;
+    }
+    
+    Result result;
+    FsRightsId *rights_ids = NULL;
+    u32 rights_id_cnt = 0, total_rights_id_cnt = 0;
+    
+    bool foundRightsId = false;
+    u8 rightsIdType = 0; // 1 = Common, 2 = Personalized
+    
+    FIL *eTicketSave = NULL;
+    save_ctx_t *save_ctx = NULL;
+    allocation_table_storage_ctx_t fat_storage;
+    u64 save_size = 0, total_br = 0;
+    int br = 0;
+    
+    const u8 *cache_entry = NULL;
+    
+    bool foundEticket = false, proceed = true;
+    
+    u8 titlekey[0x10];
+    Aes128Context titlekey_aes_ctx;
+    
+    // Common tickets from the local content storage don't need to go through ES at all
+    // They're never used with installed titles, so a stray ticket file can't override the one from the console
+    if (storageId == LOCAL_CONTENT_STORAGE_ID && readLocalContentTicket(dec_nca_header->rights_id, dumpBuf))
     {
-        personalized_rights_ids = calloc(personalized_count, sizeof(FsRightsId));
-        if (!personalized_rights_ids)
+        if (((rsa2048_sha256_ticket*)dumpBuf)->titlekey_type != ETICKET_TITLEKEY_COMMON)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for personalized tickets' rights IDs!", __func__);
-            esExit();
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: personalized tickets from the local content storage aren't supported!", __func__);
             return ret;
         }
         
-        result = esListPersonalizedTicket(&ids_written, personalized_rights_ids, personalized_count * sizeof(FsRightsId));
-        if (R_FAILED(result))
+        if (!loadExternalKeys()) return ret;
+        
+        memcpy(titlekey, dumpBuf + ETICKET_TITLEKEY_OFFSET, 0x10);
+        i = 0;
+        
+        goto found;
+    }
+    
+    // If the eTicket cache has been loaded, it already holds every ticket available in this console
+    if (eticket_cache_loaded)
+    {
+        cache_entry = findEticketCacheEntry(dec_nca_header->rights_id);
+        if (!cache_entry)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esListPersonalizedTicket failed! (0x%08X)", __func__, result);
-            free(personalized_rights_ids);
-            esExit();
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA rights ID unavailable in this console!", __func__);
+            breaks++;
+            ret = -2;
             return ret;
         }
         
-        for(i = 0; i < personalized_count; i++)
+        if (!loadExternalKeys()) return ret;
+        
+        memcpy(dumpBuf, cache_entry, ETICKET_TIK_FILE_SIZE);
+        
+        if (((rsa2048_sha256_ticket*)dumpBuf)->titlekey_type == ETICKET_TITLEKEY_PERSONALIZED)
         {
-            if (!memcmp(personalized_rights_ids[i].c, dec_nca_header->rights_id, 0x10))
-            {
-                foundRightsId = true;
-                rightsIdType = 2; // Personalized
-                break;
-            }
+            if (!loadEticketDeviceKey() || !decryptPersonalizedTitleKey(dumpBuf + ETICKET_TITLEKEY_OFFSET, titlekey)) return ret;
+        } else {
+            memcpy(titlekey, dumpBuf + ETICKET_TITLEKEY_OFFSET, 0x10);
         }
         
-        free(personalized_rights_ids);
+        i = 0;
+        
+        goto found;
     }
     
-    esExit();
-    
-    if (!foundRightsId || (rightsIdType != 1 && rightsIdType != 2))
+    result = esInitialize();
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA rights ID unavailable in this console!", __func__);
-        breaks++;
-        ret = -2;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the ES service! (0x%08X)", __func__, result);
         return ret;
     }
     
-    // Load external keys
-    if (!loadExternalKeys()) return ret;
-    
-    if (rightsIdType == 2)
+    for(i = 0; i < 2 && !foundRightsId; i++)
     {
-        if (!setcal_eticket_retrieved)
+        if (!listEticketRightsIds((i == 1), &rights_ids, &rights_id_cnt))
         {
-            // Get extended eTicket RSA key from PRODINFO
-            memset(&eticket_data, 0, sizeof(SetCalRsa2048DeviceKey));
-            
-            result = setcalInitialize();
-            if (R_FAILED(result))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the set:cal service! (0x%08X)", __func__, result);
-                return ret;
-            }
-            
-            result = setcalGetEticketDeviceKey(&eticket_data);
-            
-            setcalExit();
-            
-            if (R_FAILED(result))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: setcalGetEticketDeviceKey failed! (0x%08X)", __func__, result);
-                return ret;
-            }
-            
-            // Decrypt eTicket RSA key
-            memcpy(ctr, eticket_data.key, ETICKET_DEVKEY_RSA_CTR_SIZE);
-            aes128CtrContextCreate(&eticket_aes_ctx, nca_keyset.eticket_rsa_kek, ctr);
-            aes128CtrCrypt(&eticket_aes_ctx, eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET, eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET, ETICKET_DEVKEY_RSA_SIZE);
-            
-            // Public exponent must use RSA-2048 SHA-1 signature method
-            // The value is stored use big endian byte order
-            if (__builtin_bswap32(*((u32*)(eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET + 0x200))) != SIGTYPE_RSA2048_SHA1)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid public RSA exponent for eTicket data! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
-                return ret;
-            }
+            esExit();
+            return ret;
         }
         
-        D = (eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET);
-        N = (eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET + 0x100);
-        E = (eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET + 0x200);
+        total_rights_id_cnt += rights_id_cnt;
         
-        if (!setcal_eticket_retrieved)
+        if (rights_ids)
         {
-            if (!testKeyPair(E, D, N)) return ret;
-            setcal_eticket_retrieved = true;
+            if (findRightsIdInList(rights_ids, rights_id_cnt, dec_nca_header->rights_id))
+            {
+                foundRightsId = true;
+                rightsIdType = (i + 1);
+            }
+            
+            free(rights_ids);
+            rights_ids = NULL;
         }
     }
     
-    eTicketSave = calloc(1, sizeof(FIL));
-    if (!eTicketSave)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for FatFs file descriptor!", __func__);
-        return ret;
-    }
+    esExit();
     
-    // FatFs is used to mount the BIS System partition and read the ES savedata files to avoid 0xE02 (file already in use) errors
-    fr = f_open(eTicketSave, (rightsIdType == 1 ? BIS_COMMON_TIK_SAVE_NAME : BIS_PERSONALIZED_TIK_SAVE_NAME), FA_READ | FA_OPEN_EXISTING);
-    if (fr)
+    if (!total_rights_id_cnt)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open ES %s eTicket save! (%u)", __func__, (rightsIdType == 1 ? "common" : "personalized"), fr);
-        free(eTicketSave);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no tickets available!", __func__);
         return ret;
     }
     
-    save_ctx = calloc(1, sizeof(save_ctx_t));
-    if (!save_ctx)
+    if (!foundRightsId || (rightsIdType != 1 && rightsIdType != 2))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for ticket savefile context!");
-        f_close(eTicketSave);
-        free(eTicketSave);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA rights ID unavailable in this console!", __func__);
+        breaks++;
+        ret = -2;
         return ret;
     }
     
-    save_ctx->file = eTicketSave;
-    save_ctx->tool_ctx.action = 0;
+    // Load external keys
+    if (!loadExternalKeys()) return ret;
     
-    if (!save_process(save_ctx))
-    {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to process ticket savefile!", __func__);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        free(save_ctx);
-        f_close(eTicketSave);
-        free(eTicketSave);
-        return ret;
-    }
+    if (rightsIdType == 2 && !loadEticketDeviceKey()) return ret;
     
-    if (!save_hierarchical_file_table_get_file_entry_by_path(&save_ctx->save_filesystem_core.file_table, ticket_bin_path, &entry))
-    {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to get file entry for \"%s\" in ticket savefile!", __func__, ticket_bin_path);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        save_free_contexts(save_ctx);
-        free(save_ctx);
-        f_close(eTicketSave);
-        free(eTicketSave);
-        return ret;
-    }
+    if (!openEticketSave((rightsIdType == 2), &eTicketSave, &save_ctx, &fat_storage, &save_size)) return ret;
     
-    if (!save_open_fat_storage(&save_ctx->save_filesystem_core, &fat_storage, entry.value.save_file_info.start_block))
+    while((br = readEticketSaveChunk(&fat_storage, total_br, save_size)) > 0)
     {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to open FAT storage at block 0x%X for \"%s\" in ticket savefile!", __func__, entry.value.save_file_info.start_block, ticket_bin_path);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        save_free_contexts(save_ctx);
-        free(save_ctx);
-        f_close(eTicketSave);
-        free(eTicketSave);
-        return ret;
-    }
-    
-    while(br == buf_size && total_br < entry.value.save_file_info.length)
-    {
-        br = save_allocation_table_storage_read(&fat_storage, dumpBuf, total_br, buf_size);
-        if (br != buf_size)
-        {
-            snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read %u bytes chunk at offset 0x%lX from \"%s\" in ticket savefile!", __func__, buf_size, total_br, ticket_bin_path);
-            strcat(strbuf, tmp);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-            proceed = false;
-            break;
-        }
-        
-        if (dumpBuf[0] == 0) break;
+        total_br += (u64)br;
         
-        total_br += br;
-        
-        for(i = 0; i < buf_size; i += ETICKET_ENTRY_SIZE)
+        for(i = 0; i < (u32)br; i += ETICKET_ENTRY_SIZE)
         {
             // Only read eTicket entries with RSA-2048 SHA-256 signature method
             // Also check if our current eTicket entry matches our rights ID
@@ -1080,34 +1339,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
                 memcpy(titlekey, dumpBuf + i + ETICKET_TITLEKEY_OFFSET, 0x10);
             } else {
                 // Personalized
-                u8 M[0x100], salt[0x20], db[0xDF];
-                
-                u8 *titleKeyBlock = (dumpBuf + i + ETICKET_TITLEKEY_OFFSET);
-                
-                result = splUserExpMod(titleKeyBlock, N, D, 0x100, M);
-                if (R_FAILED(result))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splUserExpMod failed! (titleKeyBlock) (0x%08X)", __func__, result);
-                    proceed = false;
-                    break;
-                }
-                
-                // Decrypt the titlekey
-                mgf1(M + 0x21, 0xDF, salt, 0x20);
-                for(j = 0; j < 0x20; j++) salt[j] ^= M[j + 1];
-                
-                mgf1(salt, 0x20, db, 0xDF);
-                for(j = 0; j < 0xDF; j++) db[j] ^= M[j + 0x21];
-                
-                // Verify if it starts with a null string hash
-                if (memcmp(db, null_hash, 0x20) != 0)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: titlekey decryption failed! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
-                    proceed = false;
-                    break;
-                }
-                
-                memcpy(titlekey, db + 0xCF, 0x10);
+                proceed = decryptPersonalizedTitleKey(dumpBuf + i + ETICKET_TITLEKEY_OFFSET, titlekey);
             }
             
             break;
@@ -1116,10 +1348,9 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         if (foundEticket) break;
     }
     
-    save_free_contexts(save_ctx);
-    free(save_ctx);
-    f_close(eTicketSave);
-    free(eTicketSave);
+    if (br < 0) proceed = false;
+    
+    closeEticketSave(eTicketSave, save_ctx);
     
     if (!proceed) return ret;
     
@@ -1131,6 +1362,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         return ret;
     }
     
+found:
     ret = 0;
     
     // Copy ticket data to output pointer
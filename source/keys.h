@@ -59,7 +59,15 @@ typedef struct {
 bool loadMemoryKeys();
 bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out);
 bool loadExternalKeys();
-int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key);
+
+// Reads every common and personalized ticket listed by ES from the ES savefiles, in a single pass over each savefile
+// While the cache is loaded, retrieveNcaTikTitleKey() looks up tickets in it instead of scanning the savefiles again
+bool loadEticketCache();
+void freeEticketCache();
+u32 getEticketCacheCount();
+
+// Tickets from the local content storage are only used with titles served from it (storageId == LOCAL_CONTENT_STORAGE_ID)
+int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, NcmStorageId storageId, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key);
 bool generateEncryptedNcaKeyAreaWithTitlekey(nca_header_t *dec_nca_header, u8 *decrypted_nca_keys);
 
 #endif
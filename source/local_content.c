@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "local_content.h"
+#include "nca.h"
+
+bool parseLocalContentId(const char *name, NcmContentId *outId, bool *outIsMeta)
+{
+    u32 i;
+    size_t nameLen = strlen(name);
+    
+    if (nameLen != (SHA256_HASH_SIZE + 4) && nameLen != (SHA256_HASH_SIZE + 9)) return false;
+    
+    if (nameLen == (SHA256_HASH_SIZE + 4))
+    {
+        if (strcasecmp(name + SHA256_HASH_SIZE, ".nca") != 0) return false;
+        *outIsMeta = false;
+    } else {
+        if (strcasecmp(name + SHA256_HASH_SIZE, ".cnmt.nca") != 0) return false;
+        *outIsMeta = true;
+    }
+    
+    for(i = 0; i < SHA256_HASH_SIZE; i++)
+    {
+        char c = name[i];
+        u8 val;
+        
+        if (c >= '0' && c <= '9')
+        {
+            val = (u8)(c - '0');
+        } else
+        if (c >= 'a' && c <= 'f')
+        {
+            val = (u8)(c - 'a' + 0xA);
+        } else
+        if (c >= 'A' && c <= 'F')
+        {
+            val = (u8)(c - 'A' + 0xA);
+        } else {
+            return false;
+        }
+        
+        if (!(i % 2))
+        {
+            outId->c[i / 2] = (val << 4);
+        } else {
+            outId->c[i / 2] |= val;
+        }
+    }
+    
+    return true;
+}
+
+static bool addLocalContentEntry(const char *path, const char *name, bool isDir, localContentEntry **entries, u32 *entryCnt)
+{
+    NcmContentId contentId;
+    bool isMeta = false;
+    
+    if (!parseLocalContentId(name, &contentId, &isMeta)) return false;
+    
+    localContentEntry entry;
+    memset(&entry, 0, sizeof(localContentEntry));
+    
+    memcpy(&(entry.contentId), &contentId, sizeof(NcmContentId));
+    entry.isMeta = isMeta;
+    snprintf(entry.path, sizeof(entry.path), "%s", path);
+    
+    struct stat st;
+    
+    if (!isDir)
+    {
+        if (stat(path, &st) != 0 || !st.st_size) return false;
+        entry.size = (u64)st.st_size;
+    } else {
+        // Split content: "00", "01"... parts
+        char partPath[LOCAL_CONTENT_PATH_LEN] = {'\0'};
+        
+        while(true)
+        {
+            snprintf(partPath, sizeof(partPath), "%s/%02u", path, entry.partCnt);
+            if (stat(partPath, &st) != 0) break;
+            
+            if (!entry.partCnt) entry.partSize = (u64)st.st_size;
+            entry.size += (u64)st.st_size;
+            entry.partCnt++;
+        }
+        
+        if (!entry.partCnt || !entry.partSize || !entry.size) return false;
+    }
+    
+    localContentEntry *tmpEntries = realloc(*entries, (*entryCnt + 1) * sizeof(localContentEntry));
+    if (!tmpEntries) return false;
+    
+    *entries = tmpEntries;
+    memcpy(&((*entries)[*entryCnt]), &entry, sizeof(localContentEntry));
+    (*entryCnt)++;
+    
+    return true;
+}
+
+static void scanLocalContentSubdirectory(const char *path, u32 depth, localContentEntry **entries, u32 *entryCnt)
+{
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    
+    struct dirent *ent;
+    char entryPath[LOCAL_CONTENT_PATH_LEN] = {'\0'};
+    
+    while((ent = readdir(dir)) != NULL)
+    {
+        if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+        
+        snprintf(entryPath, sizeof(entryPath), "%s%s%s", path, (path[strlen(path) - 1] == '/' ? "" : "/"), ent->d_name);
+        
+        if (ent->d_type == DT_DIR)
+        {
+            // Directories named after a content ID hold split contents. Everything else is scanned recursively
+            if (!addLocalContentEntry(entryPath, ent->d_name, true, entries, entryCnt) && depth < LOCAL_CONTENT_MAX_DIR_DEPTH) scanLocalContentSubdirectory(entryPath, depth + 1, entries, entryCnt);
+        } else {
+            addLocalContentEntry(entryPath, ent->d_name, false, entries, entryCnt);
+        }
+    }
+    
+    closedir(dir);
+}
+
+void scanLocalContentDirectory(const char *path, localContentEntry **entries, u32 *entryCnt)
+{
+    if (!path || !strlen(path) || !entries || !entryCnt) return;
+    scanLocalContentSubdirectory(path, 0, entries, entryCnt);
+}
+
+bool parseLocalContentMeta(const localContentEntry *entry, u64 pfs0Offset, localContentMetaReadFunc readFunc, void *userData, localContentMetaEntry *outMeta)
+{
+    if (!entry || !entry->isMeta || !readFunc || !outMeta) return false;
+    
+    u32 i;
+    
+    u64 nca_pfs0_str_table_offset, nca_pfs0_data_offset;
+    pfs0_header nca_pfs0_header;
+    pfs0_file_entry *nca_pfs0_entries = NULL;
+    char *nca_pfs0_str_table = NULL;
+    
+    bool found_cnmt = false;
+    
+    u64 title_cnmt_offset = 0, title_cnmt_size = 0;
+    
+    cnmt_header title_cnmt_header;
+    cnmt_extended_header title_cnmt_extended_header;
+    memset(&title_cnmt_extended_header, 0, sizeof(cnmt_extended_header));
+    
+    u64 title_cnmt_content_records_offset, title_cnmt_content_records_size;
+    cnmt_content_record *title_cnmt_content_records = NULL;
+    
+    NcmContentInfo *content_infos = NULL;
+    u32 content_info_cnt = 0;
+    
+    bool success = false;
+    
+    if (!readFunc(userData, pfs0Offset, &nca_pfs0_header, sizeof(pfs0_header))) return false;
+    
+    if (__builtin_bswap32(nca_pfs0_header.magic) != PFS0_MAGIC || !nca_pfs0_header.file_cnt || !nca_pfs0_header.str_table_size) return false;
+    
+    nca_pfs0_entries = calloc(nca_pfs0_header.file_cnt, sizeof(pfs0_file_entry));
+    nca_pfs0_str_table = calloc((u64)nca_pfs0_header.str_table_size + 1, sizeof(char));
+    if (!nca_pfs0_entries || !nca_pfs0_str_table) goto out;
+    
+    nca_pfs0_str_table_offset = (pfs0Offset + sizeof(pfs0_header) + ((u64)nca_pfs0_header.file_cnt * sizeof(pfs0_file_entry)));
+    nca_pfs0_data_offset = (nca_pfs0_str_table_offset + (u64)nca_pfs0_header.str_table_size);
+    
+    if (!readFunc(userData, pfs0Offset + sizeof(pfs0_header), nca_pfs0_entries, (u64)nca_pfs0_header.file_cnt * sizeof(pfs0_file_entry))) goto out;
+    
+    if (!readFunc(userData, nca_pfs0_str_table_offset, nca_pfs0_str_table, (u64)nca_pfs0_header.str_table_size)) goto out;
+    
+    // The CNMT filename depends on the title type and ID, which we don't know yet
+    for(i = 0; i < nca_pfs0_header.file_cnt; i++)
+    {
+        if (nca_pfs0_entries[i].filename_offset >= nca_pfs0_header.str_table_size) continue;
+        
+        const char *filename = (nca_pfs0_str_table + nca_pfs0_entries[i].filename_offset);
+        size_t filename_len = strlen(filename);
+        
+        if (filename_len > 5 && !strcasecmp(filename + filename_len - 5, ".cnmt"))
+        {
+            found_cnmt = true;
+            title_cnmt_offset = (nca_pfs0_data_offset + nca_pfs0_entries[i].file_offset);
+            title_cnmt_size = nca_pfs0_entries[i].file_size;
+            break;
+        }
+    }
+    
+    if (!found_cnmt || title_cnmt_size < (sizeof(cnmt_header) + (u64)SHA256_HASH_SIZE)) goto out;
+    
+    if (!readFunc(userData, title_cnmt_offset, &title_cnmt_header, sizeof(cnmt_header))) goto out;
+    
+    if (title_cnmt_header.type != NcmContentMetaType_Application && title_cnmt_header.type != NcmContentMetaType_Patch && title_cnmt_header.type != NcmContentMetaType_AddOnContent) goto out;
+    
+    if (title_cnmt_header.extended_header_size < sizeof(cnmt_extended_header)) goto out;
+    
+    if (!readFunc(userData, title_cnmt_offset + sizeof(cnmt_header), &title_cnmt_extended_header, sizeof(cnmt_extended_header))) goto out;
+    
+    title_cnmt_content_records_offset = (title_cnmt_offset + sizeof(cnmt_header) + (u64)title_cnmt_header.extended_header_size);
+    title_cnmt_content_records_size = ((u64)title_cnmt_header.content_cnt * sizeof(cnmt_content_record));
+    
+    if ((title_cnmt_content_records_offset + title_cnmt_content_records_size) > (title_cnmt_offset + title_cnmt_size)) goto out;
+    
+    if (title_cnmt_header.content_cnt)
+    {
+        title_cnmt_content_records = calloc(title_cnmt_header.content_cnt, sizeof(cnmt_content_record));
+        if (!title_cnmt_content_records) goto out;
+        
+        if (!readFunc(userData, title_cnmt_content_records_offset, title_cnmt_content_records, title_cnmt_content_records_size)) goto out;
+    }
+    
+    // ncm also lists the Meta NCA itself, even though it isn't part of the CNMT content records
+    content_infos = calloc((u32)title_cnmt_header.content_cnt + 1, sizeof(NcmContentInfo));
+    if (!content_infos) goto out;
+    
+    for(i = 0; i < title_cnmt_header.content_cnt; i++)
+    {
+        memcpy(content_infos[content_info_cnt].content_id.c, title_cnmt_content_records[i].nca_id, sizeof(NcmContentId));
+        memcpy(content_infos[content_info_cnt].size, title_cnmt_content_records[i].size, 6);
+        content_infos[content_info_cnt].content_type = title_cnmt_content_records[i].type;
+        content_infos[content_info_cnt].id_offset = title_cnmt_content_records[i].id_offset;
+        content_info_cnt++;
+    }
+    
+    // Same 48-bit little endian layout used by convertU64ToNcaSize()
+    memcpy(&(content_infos[content_info_cnt].content_id), &(entry->contentId), sizeof(NcmContentId));
+    for(i = 0; i < 6; i++) content_infos[content_info_cnt].size[i] = (u8)(entry->size >> (i * 8));
+    content_infos[content_info_cnt].content_type = NcmContentType_Meta;
+    content_info_cnt++;
+    
+    memset(outMeta, 0, sizeof(localContentMetaEntry));
+    
+    outMeta->key.key.id = title_cnmt_header.title_id;
+    outMeta->key.key.version = title_cnmt_header.version;
+    outMeta->key.key.type = title_cnmt_header.type;
+    
+    // The extended header holds the application ID for patches and add-ons
+    outMeta->key.application_id = (title_cnmt_header.type == NcmContentMetaType_Application ? title_cnmt_header.title_id : title_cnmt_extended_header.patch_tid);
+    
+    outMeta->contentInfoCnt = content_info_cnt;
+    outMeta->contentInfos = content_infos;
+    content_infos = NULL;
+    
+    success = true;
+
+out:
+    if (content_infos) free(content_infos);
+    
+    if (title_cnmt_content_records) free(title_cnmt_content_records);
+    
+    if (nca_pfs0_str_table) free(nca_pfs0_str_table);
+    
+    if (nca_pfs0_entries) free(nca_pfs0_entries);
+    
+    return success;
+}
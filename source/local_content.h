@@ -0,0 +1,40 @@
+#pragma once
+
+#ifndef __LOCAL_CONTENT_H__
+#define __LOCAL_CONTENT_H__
+
+#include <switch.h>
+
+#define LOCAL_CONTENT_MAX_DIR_DEPTH     4
+#define LOCAL_CONTENT_PATH_LEN          2048                                // Same as NAME_BUF_LEN
+
+typedef struct {
+    NcmContentId contentId;
+    bool isMeta;                                    // Set for "<content_id>.cnmt.nca" entries
+    u32 partCnt;                                    // Zero if the content is stored as a single file
+    u64 partSize;                                   // Size from the first part. Only used if partCnt > 0
+    u64 size;
+    char path[LOCAL_CONTENT_PATH_LEN];
+} localContentEntry;
+
+typedef struct {
+    NcmApplicationContentMetaKey key;
+    u32 contentInfoCnt;
+    NcmContentInfo *contentInfos;                   // Content records from the CNMT, followed by the Meta NCA itself (same as ncmContentMetaDatabaseListContentInfo())
+} localContentMetaEntry;
+
+// Reads decrypted data from the PFS0 section of a Meta NCA. 'offset' is relative to the start of the NCA
+typedef bool (*localContentMetaReadFunc)(void *userData, u64 offset, void *outBuf, u64 size);
+
+// Parses "<content_id>.nca" and "<content_id>.cnmt.nca" names (case insensitive)
+bool parseLocalContentId(const char *name, NcmContentId *outId, bool *outIsMeta);
+
+// Appends every content found in 'path' to the provided entry list, looking into subdirectories up to LOCAL_CONTENT_MAX_DIR_DEPTH levels deep
+// Directories named after a content ID are treated as split contents ("00", "01"... parts)
+void scanLocalContentDirectory(const char *path, localContentEntry **entries, u32 *entryCnt);
+
+// Retrieves the content meta key and content records from the CNMT stored in the PFS0 section of a Meta NCA, which starts at 'pfs0Offset'
+// Only the PFS0 header, the CNMT header and its content records are read. outMeta->contentInfos must be freed by the caller
+bool parseLocalContentMeta(const localContentEntry *entry, u64 pfs0Offset, localContentMetaReadFunc readFunc, void *userData, localContentMetaEntry *outMeta);
+
+#endif
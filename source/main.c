@@ -3,6 +3,7 @@
 #include <string.h>
 #include <switch.h>
 
+#include "jobs.h"
 #include "ui.h"
 #include "util.h"
 
@@ -18,6 +19,13 @@ int main(int argc, char *argv[])
         goto out;
     }
     
+    /* Process the job file, if available */
+    if (checkIfFileExists(JOB_FILE_PATH))
+    {
+        runJobFile(JOB_FILE_PATH);
+        waitForButtonPress();
+    }
+    
     /* Main application loop */
     while(appletMainLoop())
     {
@@ -51,6 +59,9 @@ int main(int argc, char *argv[])
             case resultDumpNsp:
                 uiSetState(stateDumpNsp);
                 break;
+            case resultDumpNspBundle:
+                uiSetState(stateDumpNspBundle);
+                break;
             case resultShowHfs0Menu:
                 uiSetState(stateHfs0Menu);
                 break;
@@ -150,6 +161,15 @@ int main(int argc, char *argv[])
             case resultDumpTicket:
                 uiSetState(stateDumpTicket);
                 break;
+            case resultDumpAllTickets:
+                uiSetState(stateDumpAllTickets);
+                break;
+            case resultShowBisMenu:
+                uiSetState(stateBisMenu);
+                break;
+            case resultDumpBisPartition:
+                uiSetState(stateDumpBisPartition);
+                break;
             case resultShowUpdateMenu:
                 uiSetState(stateUpdateMenu);
                 break;
@@ -159,6 +179,9 @@ int main(int argc, char *argv[])
             case resultUpdateApplication:
                 uiSetState(stateUpdateApplication);
                 break;
+            case resultCalibrateTransferChunkSizes:
+                uiSetState(stateCalibrateTransferChunkSizes);
+                break;
             case resultExit:
                 exitMainLoop = true;
                 break;
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <mbedtls/base64.h>
 
 #include "keys.h"
@@ -8,10 +9,12 @@
 #include "ui.h"
 #include "rsa.h"
 #include "nso.h"
+#include "ncm_local.h"
+#include "crc32_fast.h"
 
 /* Extern variables */
 
-extern int breaks;
+extern __thread int breaks;
 extern int font_height;
 
 extern exefs_ctx_t exeFsContext;
@@ -20,8 +23,24 @@ extern bktr_ctx_t bktrContext;
 
 extern nca_keyset_t nca_keyset;
 
+extern gamecard_ctx_t gameCardInfo;
+
 extern u8 *ncaCtrBuf;
 
+/* Static variables */
+
+static Aes128XtsContext nca_hdr_dec_ctx, nca_hdr_enc_ctx;
+static bool nca_hdr_ctx_init = false;
+
+static nca_header_cache_entry nca_hdr_cache[NCA_HEADER_CACHE_SIZE];
+static u32 nca_hdr_cache_next = 0;
+
+// Worker threads decrypt NCA sections through their own CTR buffer instead of the global one
+static __thread u8 *nca_ctr_thread_buf = NULL;
+
+// Raw gamecard IStorage reads go through global partition state, so they can't overlap
+static pthread_mutex_t nca_gc_read_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 char *getTitleType(u8 type)
 {
     char *out = NULL;
@@ -295,8 +314,11 @@ static void nca_update_bktr_ctr(unsigned char *ctr, u32 ctr_val, u64 ofs)
     }
 }
 
-bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize)
+// If 'streamBuf' is provided, the data is read into '*streamBuf'. Gamecard NCAs are then read using the gamecard read-ahead, which may swap '*streamBuf' with its own buffer
+static bool readNcaData(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, u8 **streamBuf, size_t bufSize)
 {
+    if (streamBuf) outBuf = *streamBuf;
+    
     if (!ncmStorage || !ncaId || !outBuf || !bufSize)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to read data from NCA!", __func__);
@@ -309,7 +331,7 @@ bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *n
     char nca_id[SHA256_HASH_SIZE + 1] = {'\0'}, nca_path[0x301] = {'\0'};
     convertDataToHexString(ncaId->c, SHA256_HASH_SIZE / 2, nca_id, SHA256_HASH_SIZE + 1);
     
-    result = ncmContentStorageGetPath(ncmStorage, nca_path, MAX_CHARACTERS(nca_path), ncaId);
+    result = ncmLocalContentStorageGetPath(ncmStorage, nca_path, MAX_CHARACTERS(nca_path), ncaId);
     if (R_FAILED(result) || !strlen(nca_path))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to retrieve content path for NCA \"%s\"! (0x%08X)", __func__, nca_id, result);
@@ -321,12 +343,21 @@ bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *n
     {
         // Retrieve NCA data using raw IStorage reads
         // Fixes NCA access problems with gamecards under low HOS versions when using ncmContentStorageReadContentIdFile()
-        success = readFileFromSecureHfs0PartitionByName(strrchr(nca_path, '/') + 1, offset, outBuf, bufSize);
+        pthread_mutex_lock(&nca_gc_read_mutex);
+        if (streamBuf)
+        {
+            success = readFileFromSecureHfs0PartitionByNameStream(strrchr(nca_path, '/') + 1, offset, streamBuf, bufSize);
+        } else {
+            success = readFileFromSecureHfs0PartitionByName(strrchr(nca_path, '/') + 1, offset, outBuf, bufSize);
+        }
+        pthread_mutex_unlock(&nca_gc_read_mutex);
+        
         if (!success) breaks++;
     } else {
         // Retrieve NCA data normally
         // This strips NAX0 encryption from SD card NCAs (not used with eMMC NCAs)
-        result = ncmContentStorageReadContentIdFile(ncmStorage, outBuf, bufSize, ncaId, offset);
+        // NCAs from the local content storage are read straight from their files
+        result = ncmLocalContentStorageReadContentIdFile(ncmStorage, outBuf, bufSize, ncaId, offset);
         success = R_SUCCEEDED(result);
     }
     
@@ -335,6 +366,16 @@ bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *n
     return success;
 }
 
+bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize)
+{
+    return readNcaData(ncmStorage, ncaId, offset, outBuf, NULL, bufSize);
+}
+
+bool readNcaDataStreamByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, u8 **outBuf, size_t bufSize)
+{
+    return readNcaData(ncmStorage, ncaId, offset, NULL, outBuf, bufSize);
+}
+
 bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *ctx, u64 offset, void *outBuf, size_t bufSize, bool encrypt)
 {
     if (!ncmStorage || !ncaId || !outBuf || !bufSize || !ctx)
@@ -347,6 +388,9 @@ bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId
     
     unsigned char ctr[0x10];
     
+    u8 *ctr_buf = (nca_ctr_thread_buf ? nca_ctr_thread_buf : ncaCtrBuf);
+    u64 ctr_buf_size = (nca_ctr_thread_buf ? NCA_CTR_THREAD_BUFFER_SIZE : NCA_CTR_BUFFER_SIZE);
+    
     char nca_id[SHA256_HASH_SIZE + 1] = {'\0'};
     convertDataToHexString(ncaId->c, SHA256_HASH_SIZE / 2, nca_id, SHA256_HASH_SIZE + 1);
     
@@ -354,10 +398,10 @@ bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId
     u64 block_end_offset = (u64)round_up(offset + bufSize, 0x10);
     u64 block_size = (block_end_offset - block_start_offset);
     
-    u64 block_size_used = (block_size > NCA_CTR_BUFFER_SIZE ? NCA_CTR_BUFFER_SIZE : block_size);
-    u64 output_block_size = (block_size > NCA_CTR_BUFFER_SIZE ? (NCA_CTR_BUFFER_SIZE - (offset - block_start_offset)) : bufSize);
+    u64 block_size_used = (block_size > ctr_buf_size ? ctr_buf_size : block_size);
+    u64 output_block_size = (block_size > ctr_buf_size ? (ctr_buf_size - (offset - block_start_offset)) : bufSize);
     
-    if (!readNcaDataByContentId(ncmStorage, ncaId, block_start_offset, ncaCtrBuf, block_size_used))
+    if (!readNcaDataByContentId(ncmStorage, ncaId, block_start_offset, ctr_buf, block_size_used))
     {
         breaks++;
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read encrypted data block from NCA \"%s\"!", __func__, nca_id);
@@ -370,27 +414,49 @@ bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId
     aes128CtrContextResetCtr(ctx, ctr);
     
     // Decrypt CTR block
-    aes128CtrCrypt(ctx, ncaCtrBuf, ncaCtrBuf, block_size_used);
+    aes128CtrCrypt(ctx, ctr_buf, ctr_buf, block_size_used);
     
     if (encrypt)
     {
         // Copy data to be encrypted
-        memcpy(ncaCtrBuf + (offset - block_start_offset), outBuf, output_block_size);
+        memcpy(ctr_buf + (offset - block_start_offset), outBuf, output_block_size);
         
         // Reset CTR
         aes128CtrContextResetCtr(ctx, ctr);
         
         // Encrypt CTR block
-        aes128CtrCrypt(ctx, ncaCtrBuf, ncaCtrBuf, block_size_used);
+        aes128CtrCrypt(ctx, ctr_buf, ctr_buf, block_size_used);
     }
     
-    memcpy(outBuf, ncaCtrBuf + (offset - block_start_offset), output_block_size);
+    memcpy(outBuf, ctr_buf + (offset - block_start_offset), output_block_size);
     
-    if (block_size > NCA_CTR_BUFFER_SIZE) return processNcaCtrSectionBlock(ncmStorage, ncaId, ctx, offset + output_block_size, outBuf + output_block_size, bufSize - output_block_size, encrypt);
+    if (block_size > ctr_buf_size) return processNcaCtrSectionBlock(ncmStorage, ncaId, ctx, offset + output_block_size, outBuf + output_block_size, bufSize - output_block_size, encrypt);
     
     return true;
 }
 
+bool initNcaCtrThreadBuffer()
+{
+    if (nca_ctr_thread_buf) return true;
+    
+    nca_ctr_thread_buf = malloc(NCA_CTR_THREAD_BUFFER_SIZE);
+    if (!nca_ctr_thread_buf)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NCA CTR thread buffer!", __func__);
+        return false;
+    }
+    
+    return true;
+}
+
+void freeNcaCtrThreadBuffer()
+{
+    if (!nca_ctr_thread_buf) return;
+    
+    free(nca_ctr_thread_buf);
+    nca_ctr_thread_buf = NULL;
+}
+
 bktr_relocation_bucket_t *bktr_get_relocation_bucket(bktr_relocation_block_t *block, u32 i)
 {
     return (bktr_relocation_bucket_t*)((u8*)block->buckets + ((sizeof(bktr_relocation_bucket_t) + sizeof(bktr_relocation_entry_t)) * (u64)i));
@@ -643,6 +709,54 @@ bool readBktrSectionBlock(u64 offset, void *outBuf, size_t bufSize)
     return true;
 }
 
+// The header key doesn't change during the session, so the AES-XTS contexts only need to be created once
+static void initNcaHeaderCryptoContexts()
+{
+    if (nca_hdr_ctx_init) return;
+    
+    u8 header_key_0[16];
+    u8 header_key_1[16];
+    
+    memcpy(header_key_0, nca_keyset.header_key, 16);
+    memcpy(header_key_1, nca_keyset.header_key + 16, 16);
+    
+    aes128XtsContextCreate(&nca_hdr_dec_ctx, header_key_0, header_key_1, false);
+    aes128XtsContextCreate(&nca_hdr_enc_ctx, header_key_0, header_key_1, true);
+    
+    nca_hdr_ctx_init = true;
+}
+
+static nca_header_cache_entry *getNcaHeaderCacheEntry(const NcmContentId *ncaId)
+{
+    if (!ncaId) return NULL;
+    
+    u32 i;
+    
+    for(i = 0; i < NCA_HEADER_CACHE_SIZE; i++)
+    {
+        if (nca_hdr_cache[i].valid && !memcmp(&(nca_hdr_cache[i].ncaId), ncaId, sizeof(NcmContentId))) return &(nca_hdr_cache[i]);
+    }
+    
+    return NULL;
+}
+
+static nca_header_cache_entry *addNcaHeaderCacheEntry(const NcmContentId *ncaId, const nca_header_t *header)
+{
+    if (!ncaId || !header) return NULL;
+    
+    // Replace the oldest entry once the cache is full
+    nca_header_cache_entry *entry = &(nca_hdr_cache[nca_hdr_cache_next]);
+    nca_hdr_cache_next = ((nca_hdr_cache_next + 1) % NCA_HEADER_CACHE_SIZE);
+    
+    memset(entry, 0, sizeof(nca_header_cache_entry));
+    
+    entry->valid = true;
+    memcpy(&(entry->ncaId), ncaId, sizeof(NcmContentId));
+    memcpy(&(entry->header), header, sizeof(nca_header_t));
+    
+    return entry;
+}
+
 bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize)
 {
     if (!input || !outBuf || !outBufSize || outBufSize < NCA_FULL_HEADER_LENGTH || (__builtin_bswap32(input->magic) != NCA3_MAGIC && __builtin_bswap32(input->magic) != NCA2_MAGIC))
@@ -655,19 +769,12 @@ bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize)
     
     u32 i;
     size_t crypt_res;
-    Aes128XtsContext hdr_aes_ctx;
-    
-    u8 header_key_0[16];
-    u8 header_key_1[16];
     
-    memcpy(header_key_0, nca_keyset.header_key, 16);
-    memcpy(header_key_1, nca_keyset.header_key + 16, 16);
-    
-    aes128XtsContextCreate(&hdr_aes_ctx, header_key_0, header_key_1, true);
+    initNcaHeaderCryptoContexts();
     
     if (__builtin_bswap32(input->magic) == NCA3_MAGIC)
     {
-        crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, outBuf, input, NCA_FULL_HEADER_LENGTH, 0, true);
+        crypt_res = aes128XtsNintendoCrypt(&nca_hdr_enc_ctx, outBuf, input, NCA_FULL_HEADER_LENGTH, 0, true);
         if (crypt_res != NCA_FULL_HEADER_LENGTH)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for encrypted NCA header! (%u != %lu)", __func__, NCA_FULL_HEADER_LENGTH, crypt_res);
@@ -676,7 +783,7 @@ bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize)
     } else
     if (__builtin_bswap32(input->magic) == NCA2_MAGIC)
     {
-        crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, outBuf, input, NCA_HEADER_LENGTH, 0, true);
+        crypt_res = aes128XtsNintendoCrypt(&nca_hdr_enc_ctx, outBuf, input, NCA_HEADER_LENGTH, 0, true);
         if (crypt_res != NCA_HEADER_LENGTH)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for encrypted NCA header! (%u != %lu)", __func__, NCA_HEADER_LENGTH, crypt_res);
@@ -685,7 +792,7 @@ bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize)
         
         for(i = 0; i < NCA_SECTION_HEADER_CNT; i++)
         {
-            crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, outBuf + NCA_HEADER_LENGTH + (i * NCA_SECTION_HEADER_LENGTH), &(input->fs_headers[i]), NCA_SECTION_HEADER_LENGTH, 0, true);
+            crypt_res = aes128XtsNintendoCrypt(&nca_hdr_enc_ctx, outBuf + NCA_HEADER_LENGTH + (i * NCA_SECTION_HEADER_LENGTH), &(input->fs_headers[i]), NCA_SECTION_HEADER_LENGTH, 0, true);
             if (crypt_res != NCA_SECTION_HEADER_LENGTH)
             {
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for encrypted NCA header section #%u! (%u != %lu)", __func__, i, NCA_SECTION_HEADER_LENGTH, crypt_res);
@@ -700,7 +807,7 @@ bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize)
     return true;
 }
 
-bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData)
+bool decryptNcaHeader(const NcmContentId *ncaId, const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData, NcmStorageId storageId)
 {
     if (!ncaBuf || !ncaBufSize || ncaBufSize < NCA_FULL_HEADER_LENGTH || !out || !decrypted_nca_keys)
     {
@@ -714,19 +821,20 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
     
     u32 i;
     size_t crypt_res;
-    Aes128XtsContext hdr_aes_ctx;
-    
-    u8 header_key_0[16];
-    u8 header_key_1[16];
     
     bool has_rights_id = false;
     
-    memcpy(header_key_0, nca_keyset.header_key, 16);
-    memcpy(header_key_1, nca_keyset.header_key + 16, 16);
+    // Check if this NCA header has already been decrypted
+    nca_header_cache_entry *cache_entry = getNcaHeaderCacheEntry(ncaId);
+    if (cache_entry)
+    {
+        memcpy(out, &(cache_entry->header), sizeof(nca_header_t));
+        goto rights;
+    }
     
-    aes128XtsContextCreate(&hdr_aes_ctx, header_key_0, header_key_1, false);
+    initNcaHeaderCryptoContexts();
     
-    crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, out, ncaBuf, NCA_HEADER_LENGTH, 0, false);
+    crypt_res = aes128XtsNintendoCrypt(&nca_hdr_dec_ctx, out, ncaBuf, NCA_HEADER_LENGTH, 0, false);
     if (crypt_res != NCA_HEADER_LENGTH)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for decrypted NCA header! (%u != %lu)", __func__, NCA_HEADER_LENGTH, crypt_res);
@@ -735,7 +843,7 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
     
     if (__builtin_bswap32(out->magic) == NCA3_MAGIC)
     {
-        crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, out, ncaBuf, NCA_FULL_HEADER_LENGTH, 0, false);
+        crypt_res = aes128XtsNintendoCrypt(&nca_hdr_dec_ctx, out, ncaBuf, NCA_FULL_HEADER_LENGTH, 0, false);
         if (crypt_res != NCA_FULL_HEADER_LENGTH)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for decrypted NCA header! (%u != %lu)", __func__, NCA_FULL_HEADER_LENGTH, crypt_res);
@@ -748,7 +856,7 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
         {
             if (out->fs_headers[i]._0x148[0] != 0 || memcmp(out->fs_headers[i]._0x148, out->fs_headers[i]._0x148 + 1, 0xB7))
             {
-                crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, &(out->fs_headers[i]), ncaBuf + NCA_HEADER_LENGTH + (i * NCA_SECTION_HEADER_LENGTH), NCA_SECTION_HEADER_LENGTH, 0, false);
+                crypt_res = aes128XtsNintendoCrypt(&nca_hdr_dec_ctx, &(out->fs_headers[i]), ncaBuf + NCA_HEADER_LENGTH + (i * NCA_SECTION_HEADER_LENGTH), NCA_SECTION_HEADER_LENGTH, 0, false);
                 if (crypt_res != NCA_SECTION_HEADER_LENGTH)
                 {
                     uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for decrypted NCA header section #%u! (%u != %lu)", __func__, i, NCA_SECTION_HEADER_LENGTH, crypt_res);
@@ -763,6 +871,9 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
         return false;
     }
     
+    cache_entry = addNcaHeaderCacheEntry(ncaId, out);
+    
+rights:
     for(i = 0; i < 0x10; i++)
     {
         if (out->rights_id[i] != 0)
@@ -789,7 +900,24 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
                 
                 if (retrieveTitleKeyData)
                 {
-                    ret = retrieveNcaTikTitleKey(out, (u8*)(&(rights_info->tik_data)), rights_info->enc_titlekey, rights_info->dec_titlekey);
+                    if (cache_entry && cache_entry->tik_retrieved && storageId != LOCAL_CONTENT_STORAGE_ID)
+                    {
+                        memcpy(&(rights_info->tik_data), &(cache_entry->tik_data), sizeof(rsa2048_sha256_ticket));
+                        memcpy(rights_info->enc_titlekey, cache_entry->enc_titlekey, 0x10);
+                        memcpy(rights_info->dec_titlekey, cache_entry->dec_titlekey, 0x10);
+                        ret = 0;
+                    } else {
+                        ret = retrieveNcaTikTitleKey(out, storageId, (u8*)(&(rights_info->tik_data)), rights_info->enc_titlekey, rights_info->dec_titlekey);
+                        
+                        // Tickets from the local content storage aren't cached, since the same NCA may also be installed in the console
+                        if (ret >= 0 && cache_entry && storageId != LOCAL_CONTENT_STORAGE_ID)
+                        {
+                            memcpy(&(cache_entry->tik_data), &(rights_info->tik_data), sizeof(rsa2048_sha256_ticket));
+                            memcpy(cache_entry->enc_titlekey, rights_info->enc_titlekey, 0x10);
+                            memcpy(cache_entry->dec_titlekey, rights_info->dec_titlekey, 0x10);
+                            cache_entry->titlekey_retrieved = cache_entry->tik_retrieved = true;
+                        }
+                    }
                     
                     if (ret >= 0)
                     {
@@ -822,19 +950,121 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
             {
                 u8 tmp_dec_titlekey[0x10];
                 
-                if (retrieveNcaTikTitleKey(out, NULL, NULL, tmp_dec_titlekey) < 0) return false;
+                if (cache_entry && cache_entry->titlekey_retrieved && storageId != LOCAL_CONTENT_STORAGE_ID)
+                {
+                    memcpy(tmp_dec_titlekey, cache_entry->dec_titlekey, 0x10);
+                } else {
+                    if (retrieveNcaTikTitleKey(out, storageId, NULL, NULL, tmp_dec_titlekey) < 0) return false;
+                    
+                    if (cache_entry && storageId != LOCAL_CONTENT_STORAGE_ID)
+                    {
+                        memcpy(cache_entry->dec_titlekey, tmp_dec_titlekey, 0x10);
+                        cache_entry->titlekey_retrieved = true;
+                    }
+                }
                 
                 memset(decrypted_nca_keys, 0, NCA_KEY_AREA_SIZE);
                 memcpy(decrypted_nca_keys + (NCA_KEY_AREA_KEY_SIZE * 2), tmp_dec_titlekey, 0x10);
             }
         }
     } else {
-        if (!decryptNcaKeyArea(out, decrypted_nca_keys)) return false;
+        if (cache_entry && cache_entry->key_area_decrypted)
+        {
+            memcpy(decrypted_nca_keys, cache_entry->decrypted_nca_keys, NCA_KEY_AREA_SIZE);
+        } else {
+            if (!decryptNcaKeyArea(out, decrypted_nca_keys)) return false;
+            
+            if (cache_entry)
+            {
+                memcpy(cache_entry->decrypted_nca_keys, decrypted_nca_keys, NCA_KEY_AREA_SIZE);
+                cache_entry->key_area_decrypted = true;
+            }
+        }
     }
     
     return true;
 }
 
+bool isNcaHeaderCached(const NcmContentId *ncaId)
+{
+    return (getNcaHeaderCacheEntry(ncaId) != NULL);
+}
+
+// Reads the raw header from a NCA without printing any errors, since failed prefetches are simply retried by the regular code paths
+static bool prefetchNcaHeaderData(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u8 *outBuf)
+{
+    Result result = 0;
+    char nca_path[0x301] = {'\0'};
+    
+    result = ncmLocalContentStorageGetPath(ncmStorage, nca_path, MAX_CHARACTERS(nca_path), ncaId);
+    if (R_FAILED(result) || !strlen(nca_path)) return false;
+    
+    if (!strncmp(nca_path, "@Gc", 3))
+    {
+        // Only possible if the secure IStorage partition has already been opened
+        if (gameCardInfo.curIStorageIndex != ISTORAGE_PARTITION_SECURE || !gameCardInfo.hfs0PartitionCnt) return false;
+        
+        hfs0_file_index_entry *entry = getGameCardFileIndexEntry(gameCardInfo.hfs0PartitionCnt - 1, strrchr(nca_path, '/') + 1);
+        if (!entry || entry->size < NCA_FULL_HEADER_LENGTH) return false;
+        
+        result = readGameCardStoragePartition(entry->offset, outBuf, NCA_FULL_HEADER_LENGTH);
+    } else {
+        result = ncmLocalContentStorageReadContentIdFile(ncmStorage, outBuf, NCA_FULL_HEADER_LENGTH, ncaId, 0);
+    }
+    
+    return R_SUCCEEDED(result);
+}
+
+// Reads the headers from multiple NCAs back-to-back and decrypts them in a single pass, storing them in the NCA header cache
+// Headers that are already cached are skipped. Only NCA3 headers are prefetched (NCA2 section headers are decrypted individually by decryptNcaHeader())
+// At most NCA_HEADER_CACHE_SIZE headers are prefetched, so they don't evict each other
+u32 prefetchNcaHeaders(NcmContentStorage *ncmStorage, const NcmContentId *ncaIds, u32 ncaCount)
+{
+    if (!ncmStorage || !ncaIds || !ncaCount || !loadNcaKeyset()) return 0;
+    
+    u32 i, readCount = 0, cachedCount = 0;
+    u8 *encBuf = NULL;
+    u32 *readIdx = NULL;
+    nca_header_t dec_header;
+    
+    if (ncaCount > NCA_HEADER_CACHE_SIZE) ncaCount = NCA_HEADER_CACHE_SIZE;
+    
+    encBuf = malloc((u64)ncaCount * NCA_FULL_HEADER_LENGTH);
+    readIdx = calloc(ncaCount, sizeof(u32));
+    if (!encBuf || !readIdx) goto out;
+    
+    // Issue all header reads first
+    for(i = 0; i < ncaCount; i++)
+    {
+        if (getNcaHeaderCacheEntry(&(ncaIds[i]))) continue;
+        
+        if (!prefetchNcaHeaderData(ncmStorage, &(ncaIds[i]), encBuf + ((u64)readCount * NCA_FULL_HEADER_LENGTH))) continue;
+        
+        readIdx[readCount++] = i;
+    }
+    
+    if (!readCount) goto out;
+    
+    initNcaHeaderCryptoContexts();
+    
+    // Then decrypt them all at once
+    for(i = 0; i < readCount; i++)
+    {
+        if (aes128XtsNintendoCrypt(&nca_hdr_dec_ctx, &dec_header, encBuf + ((u64)i * NCA_FULL_HEADER_LENGTH), NCA_FULL_HEADER_LENGTH, 0, false) != NCA_FULL_HEADER_LENGTH) continue;
+        
+        if (__builtin_bswap32(dec_header.magic) != NCA3_MAGIC) continue;
+        
+        if (addNcaHeaderCacheEntry(&(ncaIds[readIdx[i]]), &dec_header)) cachedCount++;
+    }
+    
+out:
+    if (readIdx) free(readIdx);
+    
+    if (encBuf) free(encBuf);
+    
+    return cachedCount;
+}
+
 bool retrieveTitleKeyFromGameCardTicket(title_rights_ctx *rights_info, u8 *decrypted_nca_keys)
 {
     if (!rights_info || !rights_info->has_rights_id || !strlen(rights_info->tik_filename) || !decrypted_nca_keys)
@@ -1137,16 +1367,7 @@ bool processProgramNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
     // Calculate section hash
     sha256CalculateHash(dec_nca_header->section_hashes[0], &(dec_nca_header->fs_headers[0]), sizeof(nca_fs_header_t));
     
-    // Recreate NPDM signature
-    if (!rsa_sign(&(dec_nca_header->magic), NPDM_SIGNATURE_AREA_SIZE, dec_nca_header->npdm_key_sig, NPDM_SIGNATURE_SIZE))
-    {
-        breaks++;
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to recreate Program NCA NPDM signature!", __func__);
-        free(block_data[0]);
-        if (block_data[1]) free(block_data[1]);
-        free(hash_table);
-        return false;
-    }
+    // The NPDM signature isn't recreated here. It only covers the NCA header, so the caller function takes care of it (see rsa_sign_submit())
     
     // Reencrypt relevant data blocks
     if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &aes_ctx, block_start_offset[0], block_data[0], block_size[0], true))
@@ -1223,21 +1444,21 @@ bool processProgramNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
     return true;
 }
 
-bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, u32 cnmtNcaIndex, nca_cnmt_mod_data *output, title_rights_ctx *rights_info)
+bool retrieveCnmtNcaData(NcmStorageId curStorageId, NcmContentStorage *ncmStorage, cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, u32 cnmtNcaIndex, nca_cnmt_mod_data *output, title_rights_ctx *rights_info)
 {
-    if (!ncaBuf || !xml_program_info || !xml_content_info || !output || !rights_info)
+    if (!ncmStorage || !xml_program_info || !xml_content_info || !output || !rights_info)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve CNMT NCA!", __func__);
         return false;
     }
     
+    u8 enc_header[NCA_FULL_HEADER_LENGTH];
     nca_header_t dec_header;
     
     u32 i, j, k = 0;
     
     u64 section_offset;
     u64 section_size;
-    u8 *section_data = NULL;
     
     Aes128CtrContext aes_ctx;
     
@@ -1246,6 +1467,7 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
     u64 nca_pfs0_data_offset;
     pfs0_header nca_pfs0_header;
     pfs0_file_entry *nca_pfs0_entries = NULL;
+    char *nca_pfs0_str_table = NULL;
     
     bool found_cnmt = false;
     
@@ -1255,15 +1477,34 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
     cnmt_header title_cnmt_header;
     cnmt_extended_header title_cnmt_extended_header;
     
+    u64 title_cnmt_content_records_offset;
+    u64 title_cnmt_content_records_size;
+    cnmt_content_record *title_cnmt_content_records = NULL;
+    
     u64 digest_offset;
     
+    u64 first_blk, last_blk;
+    u64 block_end_offset;
+    
+    bool success = false;
+    
     // Generate filename for our required CNMT file
     char cnmtFileName[50] = {'\0'};
     snprintf(cnmtFileName, MAX_CHARACTERS(cnmtFileName), "%s_%016lx.cnmt", getTitleType(xml_program_info->type), xml_program_info->title_id);
     
+    NcmContentId cnmtNcaId;
+    memcpy(cnmtNcaId.c, xml_content_info[cnmtNcaIndex].nca_id, SHA256_HASH_SIZE / 2);
+    
+    if (!readNcaDataByContentId(ncmStorage, &cnmtNcaId, 0, enc_header, NCA_FULL_HEADER_LENGTH))
+    {
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from CNMT NCA \"%s\"!", __func__, xml_content_info[cnmtNcaIndex].nca_id_str);
+        return false;
+    }
+    
     // Decrypt the NCA header
     // Don't retrieve the ticket and/or titlekey if we're dealing with a Patch with titlekey crypto bundled with the inserted gamecard
-    if (!decryptNcaHeader(ncaBuf, xml_content_info[cnmtNcaIndex].size, &dec_header, rights_info, xml_content_info[cnmtNcaIndex].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard))) return false;
+    if (!decryptNcaHeader(&cnmtNcaId, enc_header, NCA_FULL_HEADER_LENGTH, &dec_header, rights_info, xml_content_info[cnmtNcaIndex].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard), curStorageId)) return false;
     
     if (dec_header.fs_headers[0].partition_type != NCA_FS_HEADER_PARTITION_PFS0 || dec_header.fs_headers[0].fs_type != NCA_FS_HEADER_FSTYPE_PFS0)
     {
@@ -1271,7 +1512,7 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
         return false;
     }
     
-    if (!dec_header.fs_headers[0].pfs0_superblock.pfs0_size)
+    if (!dec_header.fs_headers[0].pfs0_superblock.pfs0_size || !dec_header.fs_headers[0].pfs0_superblock.block_size || !dec_header.fs_headers[0].pfs0_superblock.hash_table_size)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid size for PFS0 partition in CNMT NCA section #0!", __func__);
         return false;
@@ -1307,7 +1548,7 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
     section_offset = ((u64)dec_header.section_entries[0].media_start_offset * (u64)MEDIA_UNIT_SIZE);
     section_size = (((u64)dec_header.section_entries[0].media_end_offset * (u64)MEDIA_UNIT_SIZE) - section_offset);
     
-    if (!section_offset || section_offset < NCA_FULL_HEADER_LENGTH || !section_size)
+    if (!section_offset || section_offset < NCA_FULL_HEADER_LENGTH || !section_size || (section_offset + section_size) > xml_content_info[cnmtNcaIndex].size)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid offset/size for CNMT NCA section #0!", __func__);
         return false;
@@ -1328,50 +1569,45 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
     memcpy(ctr_key, xml_content_info[cnmtNcaIndex].decrypted_nca_keys + (NCA_KEY_AREA_KEY_SIZE * 2), NCA_KEY_AREA_KEY_SIZE);
     aes128CtrContextCreate(&aes_ctx, ctr_key, ctr);
     
-    section_data = malloc(section_size);
-    if (!section_data)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the decrypted CNMT NCA section #0!", __func__);
-        return false;
-    }
-    
-    aes128CtrCrypt(&aes_ctx, section_data, ncaBuf + section_offset, section_size);
+    // Only the PFS0 header, the CNMT header and its content records are read from the NCA
+    // Everything else is left untouched until patchCnmtNca() is called
+    nca_pfs0_offset = (section_offset + dec_header.fs_headers[0].pfs0_superblock.pfs0_offset);
     
-    nca_pfs0_offset = dec_header.fs_headers[0].pfs0_superblock.pfs0_offset;
-    memcpy(&nca_pfs0_header, section_data + nca_pfs0_offset, sizeof(pfs0_header));
+    if (!processNcaCtrSectionBlock(ncmStorage, &cnmtNcaId, &aes_ctx, nca_pfs0_offset, &nca_pfs0_header, sizeof(pfs0_header), false)) return false;
     
     if (__builtin_bswap32(nca_pfs0_header.magic) != PFS0_MAGIC)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid magic word for CNMT NCA section #0 PFS0 partition! Wrong KAEK? (0x%08X)\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__, __builtin_bswap32(nca_pfs0_header.magic));
-        free(section_data);
         return false;
     }
     
     if (!nca_pfs0_header.file_cnt || !nca_pfs0_header.str_table_size)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: CNMT NCA section #0 PFS0 partition is empty! Wrong KAEK?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
-        free(section_data);
         return false;
     }
     
     nca_pfs0_entries = calloc(nca_pfs0_header.file_cnt, sizeof(pfs0_file_entry));
-    if (!nca_pfs0_entries)
+    nca_pfs0_str_table = calloc((u64)nca_pfs0_header.str_table_size + 1, sizeof(char));
+    if (!nca_pfs0_entries || !nca_pfs0_str_table)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for CNMT NCA section #0 PFS0 partition entries!", __func__);
-        free(section_data);
-        return false;
+        goto out;
     }
     
-    memcpy(nca_pfs0_entries, section_data + nca_pfs0_offset + sizeof(pfs0_header), (u64)nca_pfs0_header.file_cnt * sizeof(pfs0_file_entry));
-    
     nca_pfs0_str_table_offset = (nca_pfs0_offset + sizeof(pfs0_header) + ((u64)nca_pfs0_header.file_cnt * sizeof(pfs0_file_entry)));
     nca_pfs0_data_offset = (nca_pfs0_str_table_offset + (u64)nca_pfs0_header.str_table_size);
     
+    if (!processNcaCtrSectionBlock(ncmStorage, &cnmtNcaId, &aes_ctx, nca_pfs0_offset + sizeof(pfs0_header), nca_pfs0_entries, (u64)nca_pfs0_header.file_cnt * sizeof(pfs0_file_entry), false)) goto out;
+    
+    if (!processNcaCtrSectionBlock(ncmStorage, &cnmtNcaId, &aes_ctx, nca_pfs0_str_table_offset, nca_pfs0_str_table, (u64)nca_pfs0_header.str_table_size, false)) goto out;
+    
     // Look for the CNMT
     for(i = 0; i < nca_pfs0_header.file_cnt; i++)
     {
-        u64 filename_offset = (nca_pfs0_str_table_offset + nca_pfs0_entries[i].filename_offset);
-        if (!strncasecmp((char*)section_data + filename_offset, cnmtFileName, strlen(cnmtFileName)))
+        if (nca_pfs0_entries[i].filename_offset >= nca_pfs0_header.str_table_size) continue;
+        
+        if (!strncasecmp(nca_pfs0_str_table + nca_pfs0_entries[i].filename_offset, cnmtFileName, strlen(cnmtFileName)))
         {
             found_cnmt = true;
             title_cnmt_offset = (nca_pfs0_data_offset + nca_pfs0_entries[i].file_offset);
@@ -1380,21 +1616,44 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
         }
     }
     
-    free(nca_pfs0_entries);
-    
     if (!found_cnmt)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find file \"%s\" in PFS0 partition from CNMT NCA section #0!", __func__, cnmtFileName);
-        free(section_data);
-        return false;
+        goto out;
+    }
+    
+    if (title_cnmt_size < (sizeof(cnmt_header) + sizeof(cnmt_extended_header) + (u64)SHA256_HASH_SIZE))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid size for file \"%s\" in PFS0 partition from CNMT NCA section #0!", __func__, cnmtFileName);
+        goto out;
     }
     
-    memcpy(&title_cnmt_header, section_data + title_cnmt_offset, sizeof(cnmt_header));
-    memcpy(&title_cnmt_extended_header, section_data + title_cnmt_offset + sizeof(cnmt_header), sizeof(cnmt_extended_header));
+    if (!processNcaCtrSectionBlock(ncmStorage, &cnmtNcaId, &aes_ctx, title_cnmt_offset, &title_cnmt_header, sizeof(cnmt_header), false)) goto out;
+    
+    if (!processNcaCtrSectionBlock(ncmStorage, &cnmtNcaId, &aes_ctx, title_cnmt_offset + sizeof(cnmt_header), &title_cnmt_extended_header, sizeof(cnmt_extended_header), false)) goto out;
+    
+    title_cnmt_content_records_offset = (title_cnmt_offset + sizeof(cnmt_header) + (u64)title_cnmt_header.extended_header_size);
+    title_cnmt_content_records_size = ((u64)title_cnmt_header.content_cnt * sizeof(cnmt_content_record));
+    
+    if (!title_cnmt_header.content_cnt || (title_cnmt_content_records_offset + title_cnmt_content_records_size + (u64)SHA256_HASH_SIZE) > (title_cnmt_offset + title_cnmt_size))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid content record entries in the CNMT NCA!", __func__);
+        goto out;
+    }
+    
+    title_cnmt_content_records = calloc(title_cnmt_header.content_cnt, sizeof(cnmt_content_record));
+    if (!title_cnmt_content_records)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT content records!", __func__);
+        goto out;
+    }
+    
+    if (!processNcaCtrSectionBlock(ncmStorage, &cnmtNcaId, &aes_ctx, title_cnmt_content_records_offset, title_cnmt_content_records, title_cnmt_content_records_size, false)) goto out;
     
     // Fill information for our CNMT XML
     digest_offset = (title_cnmt_offset + title_cnmt_size - (u64)SHA256_HASH_SIZE);
-    memcpy(xml_program_info->digest, section_data + digest_offset, SHA256_HASH_SIZE);
+    if (!processNcaCtrSectionBlock(ncmStorage, &cnmtNcaId, &aes_ctx, digest_offset, xml_program_info->digest, SHA256_HASH_SIZE, false)) goto out;
+    
     convertDataToHexString(xml_program_info->digest, SHA256_HASH_SIZE, xml_program_info->digest_str, (SHA256_HASH_SIZE * 2) + 1);
     xml_content_info[cnmtNcaIndex].keyblob = (dec_header.crypto_type2 > dec_header.crypto_type ? dec_header.crypto_type2 : dec_header.crypto_type);
     xml_program_info->required_dl_sysver = title_cnmt_header.required_dl_sysver;
@@ -1403,23 +1662,17 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
     xml_program_info->patch_tid = title_cnmt_extended_header.patch_tid;
     xml_program_info->min_appver = title_cnmt_extended_header.min_appver;
     
-    // Retrieve the ID offset and content record offset for each of our NCAs (except the CNMT NCA)
-    // Also wipe each of the content records we're gonna replace
+    // Retrieve the content record offset for each of our NCAs (except the CNMT NCA)
+    // All of them are overwritten by patchCnmtNca()
     for(i = 0; i < (xml_program_info->nca_cnt - 1); i++) // Discard CNMT NCA
     {
         for(j = 0; j < title_cnmt_header.content_cnt; j++)
         {
-            cnmt_content_record cnt_record;
-            memcpy(&cnt_record, section_data + title_cnmt_offset + sizeof(cnmt_header) + (u64)title_cnmt_header.extended_header_size + (j * sizeof(cnmt_content_record)), sizeof(cnmt_content_record));
-            
-            if (memcmp(xml_content_info[i].nca_id, cnt_record.nca_id, SHA256_HASH_SIZE / 2) != 0) continue;
+            if (memcmp(xml_content_info[i].nca_id, title_cnmt_content_records[j].nca_id, SHA256_HASH_SIZE / 2) != 0) continue;
             
             // Save content record offset
             xml_content_info[i].cnt_record_offset = (j * sizeof(cnmt_content_record));
             
-            // Empty CNMT content record
-            memset(section_data + title_cnmt_offset + sizeof(cnmt_header) + (u64)title_cnmt_header.extended_header_size + (j * sizeof(cnmt_content_record)), 0, sizeof(cnmt_content_record));
-            
             // Increase counter
             k++;
             
@@ -1431,37 +1684,79 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
     if (k != (xml_program_info->nca_cnt - 1))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid content record entries in the CNMT NCA!", __func__);
-        free(section_data);
-        return false;
+        goto out;
     }
     
-    // Replace input buffer data in-place
-    memcpy(ncaBuf, &dec_header, NCA_FULL_HEADER_LENGTH);
-    memcpy(ncaBuf + section_offset, section_data, section_size);
+    // Calculate the range of PFS0 hash blocks holding the content records
+    // These are the only blocks that need to be kept in memory while patching the CNMT NCA
+    output->hash_block_size = dec_header.fs_headers[0].pfs0_superblock.block_size;
+    output->hash_block_cnt = (dec_header.fs_headers[0].pfs0_superblock.hash_table_size / SHA256_HASH_SIZE);
+    output->pfs0_offset = nca_pfs0_offset;
+    output->pfs0_size = dec_header.fs_headers[0].pfs0_superblock.pfs0_size;
     
-    free(section_data);
+    first_blk = ((title_cnmt_content_records_offset - nca_pfs0_offset) / output->hash_block_size);
+    last_blk = ((title_cnmt_content_records_offset + title_cnmt_content_records_size - 1 - nca_pfs0_offset) / output->hash_block_size);
     
-    // Update offsets
-    nca_pfs0_offset += section_offset;
-    title_cnmt_offset += section_offset;
+    if (title_cnmt_content_records_offset < nca_pfs0_offset || last_blk >= output->hash_block_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: CNMT content records are out of the PFS0 hash table bounds!", __func__);
+        goto out;
+    }
+    
+    block_end_offset = ((last_blk + 1) * output->hash_block_size);
+    if (block_end_offset > output->pfs0_size) block_end_offset = output->pfs0_size;
     
     // Save data to output struct
+    memcpy(&(output->nca_id), &cnmtNcaId, sizeof(NcmContentId));
+    output->nca_size = xml_content_info[cnmtNcaIndex].size;
     output->section_offset = section_offset;
     output->section_size = section_size;
     output->hash_table_offset = (section_offset + dec_header.fs_headers[0].pfs0_superblock.hash_table_offset);
-    output->hash_block_size = dec_header.fs_headers[0].pfs0_superblock.block_size;
-    output->hash_block_cnt = (dec_header.fs_headers[0].pfs0_superblock.hash_table_size / SHA256_HASH_SIZE);
-    output->pfs0_offset = nca_pfs0_offset;
-    output->pfs0_size = dec_header.fs_headers[0].pfs0_superblock.pfs0_size;
+    output->hash_table_size = dec_header.fs_headers[0].pfs0_superblock.hash_table_size;
     output->title_cnmt_offset = title_cnmt_offset;
     output->title_cnmt_size = title_cnmt_size;
+    output->content_records_offset = title_cnmt_content_records_offset;
+    output->content_records_size = title_cnmt_content_records_size;
+    output->block_offset = (nca_pfs0_offset + (first_blk * output->hash_block_size));
+    output->block_size = (block_end_offset - (first_blk * output->hash_block_size));
+    memcpy(&(output->dec_header), &dec_header, sizeof(nca_header_t));
+    
+    success = true;
+    
+out:
+    if (title_cnmt_content_records) free(title_cnmt_content_records);
+    
+    if (nca_pfs0_str_table) free(nca_pfs0_str_table);
+    
+    if (nca_pfs0_entries) free(nca_pfs0_entries);
+    
+    return success;
+}
+
+bool readCnmtNcaData(NcmContentStorage *ncmStorage, nca_cnmt_mod_data *cnmt_mod, u64 offset, void *outBuf, size_t bufSize)
+{
+    if (!ncmStorage || !cnmt_mod || !cnmt_mod->overlays.count || !outBuf || !bufSize || (offset + bufSize) > cnmt_mod->nca_size)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to read patched CNMT NCA data!", __func__);
+        return false;
+    }
+    
+    if (!readNcaDataByContentId(ncmStorage, &(cnmt_mod->nca_id), offset, outBuf, bufSize))
+    {
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from CNMT NCA!", __func__, bufSize, offset);
+        return false;
+    }
+    
+    // Replace the NCA header, the PFS0 hash table and the content record blocks with our patched ones
+    dataOverlayListApply(&(cnmt_mod->overlays), offset, outBuf, bufSize);
     
     return true;
 }
 
-bool patchCnmtNca(u8 *ncaBuf, u64 ncaBufSize, cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, nca_cnmt_mod_data *cnmt_mod)
+bool patchCnmtNca(NcmContentStorage *ncmStorage, cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, nca_cnmt_mod_data *cnmt_mod)
 {
-    if (!ncaBuf || !ncaBufSize || !xml_program_info || xml_program_info->nca_cnt <= 1 || !xml_content_info || !cnmt_mod)
+    if (!ncmStorage || !xml_program_info || xml_program_info->nca_cnt <= 1 || !xml_content_info || !cnmt_mod || !cnmt_mod->nca_size || !cnmt_mod->hash_table_size || !cnmt_mod->block_size)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to patch CNMT NCA!", __func__);
         return false;
@@ -1471,19 +1766,60 @@ bool patchCnmtNca(u8 *ncaBuf, u64 ncaBufSize, cnmt_xml_program_info *xml_program
     
     u32 nca_cnt = (xml_program_info->nca_cnt - 1); // Discard CNMT NCA
     
-    cnmt_header title_cnmt_header;
     cnmt_content_record title_cnmt_content_record;
-    u64 title_cnmt_content_records_offset;
     
-    nca_header_t dec_header;
+    u64 first_blk;
+    u64 blk_offset, blk_size;
+    
+    u64 offset, read_size;
     
     Aes128CtrContext aes_ctx;
+    Sha256Context sha_ctx;
     
-    // Copy CNMT header
-    memcpy(&title_cnmt_header, ncaBuf + cnmt_mod->title_cnmt_offset, sizeof(cnmt_header));
+    bool success = false;
     
-    // Calculate the start offset for the content records
-    title_cnmt_content_records_offset = (cnmt_mod->title_cnmt_offset + sizeof(cnmt_header) + (u64)title_cnmt_header.extended_header_size);
+    // Discard data from a previous patch attempt (e.g. a resumed dump revisiting the CNMT NCA)
+    dataOverlayListClear(&(cnmt_mod->overlays));
+    
+    if (cnmt_mod->hash_table)
+    {
+        free(cnmt_mod->hash_table);
+        cnmt_mod->hash_table = NULL;
+    }
+    
+    if (cnmt_mod->block_data)
+    {
+        free(cnmt_mod->block_data);
+        cnmt_mod->block_data = NULL;
+    }
+    
+    // Generate initial CTR
+    unsigned char ctr[0x10];
+    u64 ofs = (cnmt_mod->section_offset >> 4);
+    
+    for(i = 0; i < 0x8; i++)
+    {
+        ctr[i] = cnmt_mod->dec_header.fs_headers[0].section_ctr[0x08 - i - 1];
+        ctr[0x10 - i - 1] = (unsigned char)(ofs & 0xFF);
+        ofs >>= 8;
+    }
+    
+    u8 ctr_key[NCA_KEY_AREA_KEY_SIZE];
+    memcpy(ctr_key, xml_content_info[xml_program_info->nca_cnt - 1].decrypted_nca_keys + (NCA_KEY_AREA_KEY_SIZE * 2), NCA_KEY_AREA_KEY_SIZE);
+    aes128CtrContextCreate(&aes_ctx, ctr_key, ctr);
+    
+    cnmt_mod->hash_table = malloc(cnmt_mod->hash_table_size);
+    cnmt_mod->block_data = malloc(cnmt_mod->block_size);
+    if (!cnmt_mod->hash_table || !cnmt_mod->block_data)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for CNMT NCA hash data!", __func__);
+        goto out;
+    }
+    
+    // Only decrypt the PFS0 hash table and the hash blocks holding the content records
+    if (!processNcaCtrSectionBlock(ncmStorage, &(cnmt_mod->nca_id), &aes_ctx, cnmt_mod->hash_table_offset, cnmt_mod->hash_table, cnmt_mod->hash_table_size, false)) goto out;
+    
+    if (!processNcaCtrSectionBlock(ncmStorage, &(cnmt_mod->nca_id), &aes_ctx, cnmt_mod->block_offset, cnmt_mod->block_data, cnmt_mod->block_size, false)) goto out;
     
     // Write content records
     for(i = 0; i < nca_cnt; i++)
@@ -1496,61 +1832,84 @@ bool patchCnmtNca(u8 *ncaBuf, u64 ncaBufSize, cnmt_xml_program_info *xml_program
         title_cnmt_content_record.type = xml_content_info[i].type;
         title_cnmt_content_record.id_offset = xml_content_info[i].id_offset;
         
-        memcpy(ncaBuf + title_cnmt_content_records_offset + xml_content_info[i].cnt_record_offset, &title_cnmt_content_record, sizeof(cnmt_content_record));
+        memcpy(cnmt_mod->block_data + (cnmt_mod->content_records_offset - cnmt_mod->block_offset) + xml_content_info[i].cnt_record_offset, &title_cnmt_content_record, sizeof(cnmt_content_record));
     }
     
-    // Recalculate block hashes
-    for(i = 0; i < cnmt_mod->hash_block_cnt; i++)
+    // Recalculate block hashes for the modified blocks
+    first_blk = ((cnmt_mod->block_offset - cnmt_mod->pfs0_offset) / cnmt_mod->hash_block_size);
+    
+    for(blk_offset = 0, i = 0; blk_offset < cnmt_mod->block_size; blk_offset += cnmt_mod->hash_block_size, i++)
     {
-        u64 blk_offset = ((u64)i * cnmt_mod->hash_block_size);
-        
-        u64 rest_size = (cnmt_mod->pfs0_size - blk_offset);
-        u64 blk_size = (rest_size > cnmt_mod->hash_block_size ? cnmt_mod->hash_block_size : rest_size);
-        
-        sha256CalculateHash(ncaBuf + cnmt_mod->hash_table_offset + (i * SHA256_HASH_SIZE), ncaBuf + cnmt_mod->pfs0_offset + blk_offset, blk_size);
+        blk_size = ((cnmt_mod->block_size - blk_offset) > cnmt_mod->hash_block_size ? cnmt_mod->hash_block_size : (cnmt_mod->block_size - blk_offset));
+        sha256CalculateHash(cnmt_mod->hash_table + ((first_blk + i) * SHA256_HASH_SIZE), cnmt_mod->block_data + blk_offset, blk_size);
     }
     
-    // Copy header to struct
-    memcpy(&dec_header, ncaBuf, sizeof(nca_header_t));
-    
     // Calculate PFS0 superblock master hash
-    sha256CalculateHash(dec_header.fs_headers[0].pfs0_superblock.master_hash, ncaBuf + cnmt_mod->hash_table_offset, dec_header.fs_headers[0].pfs0_superblock.hash_table_size);
+    sha256CalculateHash(cnmt_mod->dec_header.fs_headers[0].pfs0_superblock.master_hash, cnmt_mod->hash_table, cnmt_mod->hash_table_size);
     
     // Calculate section hash
-    sha256CalculateHash(dec_header.section_hashes[0], &(dec_header.fs_headers[0]), sizeof(nca_fs_header_t));
+    sha256CalculateHash(cnmt_mod->dec_header.section_hashes[0], &(cnmt_mod->dec_header.fs_headers[0]), sizeof(nca_fs_header_t));
     
-    // Generate initial CTR
-    unsigned char ctr[0x10];
-    u64 ofs = (cnmt_mod->section_offset >> 4);
-    
-    for(i = 0; i < 0x8; i++)
+    // Reencrypt the modified CNMT NCA data
+    if (!encryptNcaHeader(&(cnmt_mod->dec_header), cnmt_mod->encrypted_header, NCA_FULL_HEADER_LENGTH))
     {
-        ctr[i] = dec_header.fs_headers[0].section_ctr[0x08 - i - 1];
-        ctr[0x10 - i - 1] = (unsigned char)(ofs & 0xFF);
-        ofs >>= 8;
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to encrypt modified CNMT NCA header!", __func__);
+        goto out;
     }
     
-    u8 ctr_key[NCA_KEY_AREA_KEY_SIZE];
-    memcpy(ctr_key, xml_content_info[xml_program_info->nca_cnt - 1].decrypted_nca_keys + (NCA_KEY_AREA_KEY_SIZE * 2), NCA_KEY_AREA_KEY_SIZE);
-    aes128CtrContextCreate(&aes_ctx, ctr_key, ctr);
+    if (!processNcaCtrSectionBlock(ncmStorage, &(cnmt_mod->nca_id), &aes_ctx, cnmt_mod->hash_table_offset, cnmt_mod->hash_table, cnmt_mod->hash_table_size, true)) goto out;
+    
+    if (!processNcaCtrSectionBlock(ncmStorage, &(cnmt_mod->nca_id), &aes_ctx, cnmt_mod->block_offset, cnmt_mod->block_data, cnmt_mod->block_size, true)) goto out;
     
-    // Reencrypt CNMT NCA
-    if (!encryptNcaHeader(&dec_header, ncaBuf, ncaBufSize))
+    if (!dataOverlayListAdd(&(cnmt_mod->overlays), 0, cnmt_mod->encrypted_header, NCA_FULL_HEADER_LENGTH) || !dataOverlayListAdd(&(cnmt_mod->overlays), cnmt_mod->hash_table_offset, cnmt_mod->hash_table, cnmt_mod->hash_table_size) || !dataOverlayListAdd(&(cnmt_mod->overlays), cnmt_mod->block_offset, cnmt_mod->block_data, cnmt_mod->block_size))
     {
-        breaks++;
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to encrypt modified CNMT NCA header!", __func__);
-        return false;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to build CNMT NCA overlay list!", __func__);
+        goto out;
     }
     
-    aes128CtrCrypt(&aes_ctx, ncaBuf + cnmt_mod->section_offset, ncaBuf + cnmt_mod->section_offset, cnmt_mod->section_size);
+    // Calculate the SHA-256 and CRC32 checksums for the patched CNMT NCA
+    // Its data is streamed through the CTR buffer with the modified regions applied on top of it
+    sha256ContextCreate(&sha_ctx);
+    cnmt_mod->crc = 0;
     
-    // Calculate CNMT NCA SHA-256 checksum and fill information for our CNMT XML
-    sha256CalculateHash(xml_content_info[xml_program_info->nca_cnt - 1].hash, ncaBuf, ncaBufSize);
+    for(offset = 0; offset < cnmt_mod->nca_size; offset += read_size)
+    {
+        read_size = ((cnmt_mod->nca_size - offset) > NCA_CTR_BUFFER_SIZE ? NCA_CTR_BUFFER_SIZE : (cnmt_mod->nca_size - offset));
+        
+        if (!readCnmtNcaData(ncmStorage, cnmt_mod, offset, ncaCtrBuf, read_size)) goto out;
+        
+        sha256ContextUpdate(&sha_ctx, ncaCtrBuf, read_size);
+        crc32(ncaCtrBuf, read_size, &(cnmt_mod->crc));
+    }
+    
+    // Fill information for our CNMT XML
+    sha256ContextGetHash(&sha_ctx, xml_content_info[xml_program_info->nca_cnt - 1].hash);
     convertDataToHexString(xml_content_info[xml_program_info->nca_cnt - 1].hash, SHA256_HASH_SIZE, xml_content_info[xml_program_info->nca_cnt - 1].hash_str, (SHA256_HASH_SIZE * 2) + 1);
     memcpy(xml_content_info[xml_program_info->nca_cnt - 1].nca_id, xml_content_info[xml_program_info->nca_cnt - 1].hash, SHA256_HASH_SIZE / 2);
     convertDataToHexString(xml_content_info[xml_program_info->nca_cnt - 1].nca_id, SHA256_HASH_SIZE / 2, xml_content_info[xml_program_info->nca_cnt - 1].nca_id_str, SHA256_HASH_SIZE + 1);
     
-    return true;
+    success = true;
+    
+out:
+    if (!success)
+    {
+        dataOverlayListClear(&(cnmt_mod->overlays));
+        
+        if (cnmt_mod->hash_table)
+        {
+            free(cnmt_mod->hash_table);
+            cnmt_mod->hash_table = NULL;
+        }
+        
+        if (cnmt_mod->block_data)
+        {
+            free(cnmt_mod->block_data);
+            cnmt_mod->block_data = NULL;
+        }
+    }
+    
+    return success;
 }
 
 bool parseExeFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys)
@@ -1693,9 +2052,9 @@ bool parseExeFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *n
     return true;
 }
 
-int parseRomFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys)
+static int parseRomFsEntryIntoCtx(romfs_ctx_t *ctx, NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys)
 {
-    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys)
+    if (!ctx || !ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to read RomFS section from NCA!", __func__);
         return -1;
@@ -1726,7 +2085,7 @@ int parseRomFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *nc
     romfs_dir *romfs_dir_entries = NULL;
     romfs_file *romfs_file_entries = NULL;
     
-    initRomFsContext();
+    memset(ctx, 0, sizeof(romfs_ctx_t));
     
     for(romfs_index = 0; romfs_index < 4; romfs_index++)
     {
@@ -1856,24 +2215,30 @@ int parseRomFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *nc
     
     // Save data to output struct
     // The caller function must free these data pointers
-    memcpy(&(romFsContext.ncmStorage), ncmStorage, sizeof(NcmContentStorage));
-    memcpy(&(romFsContext.ncaId), ncaId, sizeof(NcmContentId));
-    memcpy(&(romFsContext.aes_ctx), &aes_ctx, sizeof(Aes128CtrContext));
-    romFsContext.section_offset = section_offset;
-    romFsContext.section_size = section_size;
-    romFsContext.romfs_offset = romfs_offset;
-    romFsContext.romfs_size = romfs_size;
-    romFsContext.romfs_dirtable_offset = romfs_dirtable_offset;
-    romFsContext.romfs_dirtable_size = romfs_dirtable_size;
-    romFsContext.romfs_dir_entries = romfs_dir_entries;
-    romFsContext.romfs_filetable_offset = romfs_filetable_offset;
-    romFsContext.romfs_filetable_size = romfs_filetable_size;
-    romFsContext.romfs_file_entries = romfs_file_entries;
-    romFsContext.romfs_filedata_offset = romfs_filedata_offset;
+    memcpy(&(ctx->ncmStorage), ncmStorage, sizeof(NcmContentStorage));
+    memcpy(&(ctx->ncaId), ncaId, sizeof(NcmContentId));
+    memcpy(&(ctx->aes_ctx), &aes_ctx, sizeof(Aes128CtrContext));
+    ctx->section_offset = section_offset;
+    ctx->section_size = section_size;
+    ctx->romfs_offset = romfs_offset;
+    ctx->romfs_size = romfs_size;
+    ctx->romfs_dirtable_offset = romfs_dirtable_offset;
+    ctx->romfs_dirtable_size = romfs_dirtable_size;
+    ctx->romfs_dir_entries = romfs_dir_entries;
+    ctx->romfs_filetable_offset = romfs_filetable_offset;
+    ctx->romfs_filetable_size = romfs_filetable_size;
+    ctx->romfs_file_entries = romfs_file_entries;
+    ctx->romfs_filedata_offset = romfs_filedata_offset;
     
     return 0;
 }
 
+int parseRomFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys)
+{
+    initRomFsContext();
+    return parseRomFsEntryIntoCtx(&romFsContext, ncmStorage, ncaId, dec_nca_header, decrypted_nca_keys);
+}
+
 bool parseBktrEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, bool use_base_romfs)
 {
     if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || (bktrContext.use_base_romfs && (!romFsContext.section_offset || !romFsContext.section_size || !romFsContext.romfs_dir_entries || !romFsContext.romfs_file_entries)))
@@ -2949,12 +3314,15 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
     
     bool availableSGC = false, availableRGC = false;
     
-    if (parseRomFsEntryFromNca(ncmStorage, ncaId, dec_nca_header, decrypted_nca_keys) != 0) return false;
+    // Use our own RomFS context instead of the global one, so this can run alongside other NCA parsers
+    romfs_ctx_t romfs_ctx;
+    
+    if (parseRomFsEntryIntoCtx(&romfs_ctx, ncmStorage, ncaId, dec_nca_header, decrypted_nca_keys) != 0) return false;
     
     // Look for the control.nacp file
-    while(entryOffset < romFsContext.romfs_filetable_size)
+    while(entryOffset < romfs_ctx.romfs_filetable_size)
     {
-        entry = (romfs_file*)((u8*)romFsContext.romfs_file_entries + entryOffset);
+        entry = (romfs_file*)((u8*)romfs_ctx.romfs_file_entries + entryOffset);
         
         if (entry->parent == 0 && entry->nameLen == 12 && !strncasecmp((char*)entry->name, "control.nacp", 12))
         {
@@ -2971,7 +3339,7 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
         goto out;
     }
     
-    if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff, &controlNacp, sizeof(nacp_t), false))
+    if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romfs_ctx.aes_ctx), romfs_ctx.romfs_filedata_offset + entry->dataOff, &controlNacp, sizeof(nacp_t), false))
     {
         breaks++;
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read \"control.nacp\" from RomFS section in Control NCA!", __func__);
@@ -3143,9 +3511,9 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
             entryOffset = 0;
             sprintf(tmp, "icon_%s.dat", getNacpLangName(i));
             
-            while(entryOffset < romFsContext.romfs_filetable_size)
+            while(entryOffset < romfs_ctx.romfs_filetable_size)
             {
-                entry = (romfs_file*)((u8*)romFsContext.romfs_file_entries + entryOffset);
+                entry = (romfs_file*)((u8*)romfs_ctx.romfs_file_entries + entryOffset);
                 
                 if (entry->parent == 0 && entry->nameLen == strlen(tmp) && !strncasecmp((char*)entry->name, tmp, strlen(tmp)) && entry->dataSize <= 0x20000)
                 {
@@ -3171,7 +3539,7 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
             sprintf(nacpIcons[j].filename, "%s.nx.%s.jpg", ncaIdStr, getNacpLangName(i)); // Temporary, the NCA ID is subject to change
             nacpIcons[j].icon_size = entry->dataSize;
             
-            if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff, nacpIcons[j].icon_data, nacpIcons[j].icon_size, false))
+            if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romfs_ctx.aes_ctx), romfs_ctx.romfs_filedata_offset + entry->dataOff, nacpIcons[j].icon_data, nacpIcons[j].icon_size, false))
             {
                 breaks++;
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read \"%s\" from RomFS section in Control NCA!", __func__, tmp);
@@ -3397,11 +3765,11 @@ out:
     
     // Manually free these pointers
     // Calling freeRomFsContext() would also close the ncmStorage handle
-    free(romFsContext.romfs_dir_entries);
-    romFsContext.romfs_dir_entries = NULL;
+    free(romfs_ctx.romfs_dir_entries);
+    romfs_ctx.romfs_dir_entries = NULL;
     
-    free(romFsContext.romfs_file_entries);
-    romFsContext.romfs_file_entries = NULL;
+    free(romfs_ctx.romfs_file_entries);
+    romfs_ctx.romfs_file_entries = NULL;
     
     return success;
 }
@@ -3421,12 +3789,15 @@ bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContent
     u64 legalInfoXmlSize = 0;
     char *legalInfoXml = NULL;
     
-    if (parseRomFsEntryFromNca(ncmStorage, ncaId, dec_nca_header, decrypted_nca_keys) != 0) return false;
+    // Use our own RomFS context instead of the global one, so this can run alongside other NCA parsers
+    romfs_ctx_t romfs_ctx;
+    
+    if (parseRomFsEntryIntoCtx(&romfs_ctx, ncmStorage, ncaId, dec_nca_header, decrypted_nca_keys) != 0) return false;
     
     // Look for the legalinfo.xml file
-    while(entryOffset < romFsContext.romfs_filetable_size)
+    while(entryOffset < romfs_ctx.romfs_filetable_size)
     {
-        entry = (romfs_file*)((u8*)romFsContext.romfs_file_entries + entryOffset);
+        entry = (romfs_file*)((u8*)romfs_ctx.romfs_file_entries + entryOffset);
         
         if (entry->parent == 0 && entry->nameLen == 13 && !strncasecmp((char*)entry->name, "legalinfo.xml", 13))
         {
@@ -3452,7 +3823,7 @@ bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContent
         goto out;
     }
     
-    if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff, legalInfoXml, legalInfoXmlSize, false))
+    if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romfs_ctx.aes_ctx), romfs_ctx.romfs_filedata_offset + entry->dataOff, legalInfoXml, legalInfoXmlSize, false))
     {
         breaks++;
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read \"legalinfo.xml\" from RomFS section in Manual NCA!", __func__);
@@ -3469,11 +3840,11 @@ out:
     
     // Manually free these pointers
     // Calling freeRomFsContext() would also close the ncmStorage handle
-    free(romFsContext.romfs_dir_entries);
-    romFsContext.romfs_dir_entries = NULL;
+    free(romfs_ctx.romfs_dir_entries);
+    romfs_ctx.romfs_dir_entries = NULL;
     
-    free(romFsContext.romfs_file_entries);
-    romFsContext.romfs_file_entries = NULL;
+    free(romfs_ctx.romfs_file_entries);
+    romfs_ctx.romfs_file_entries = NULL;
     
     return success;
 }
@@ -4,6 +4,7 @@
 #define __NCA_H__
 
 #include <switch.h>
+#include "overlay.h"
 
 #define NCA3_MAGIC                      (u32)0x4E434133     // "NCA3"
 #define NCA2_MAGIC                      (u32)0x4E434132     // "NCA2"
@@ -19,6 +20,8 @@
 #define NCA_KEY_AREA_KEY_SIZE           0x10
 #define NCA_KEY_AREA_SIZE               (NCA_KEY_AREA_KEY_CNT * NCA_KEY_AREA_KEY_SIZE)
 
+#define NCA_HEADER_CACHE_SIZE           32                  // Max number of decrypted NCA headers kept in memory
+
 #define NCA_FS_HEADER_PARTITION_PFS0    0x01
 #define NCA_FS_HEADER_FSTYPE_PFS0       0x02
 
@@ -303,16 +306,30 @@ typedef struct {
     nacp_icons_ctx *nacp_icons; // Only used with Control NCAs
 } xml_record_info;
 
+// The CNMT NCA is never fully loaded in memory. Only the regions modified by patchCnmtNca() are kept here, and applied on top of the original NCA data by readCnmtNcaData()
 typedef struct {
+    NcmContentId nca_id; // Original CNMT NCA ID
+    u64 nca_size;
     u64 section_offset; // Relative to NCA start
     u64 section_size;
     u64 hash_table_offset; // Relative to NCA start
+    u64 hash_table_size;
     u64 hash_block_size;
     u32 hash_block_cnt;
     u64 pfs0_offset; // Relative to NCA start
     u64 pfs0_size;
     u64 title_cnmt_offset; // Relative to NCA start
     u64 title_cnmt_size;
+    u64 content_records_offset; // Relative to NCA start
+    u64 content_records_size;
+    nca_header_t dec_header;
+    u8 encrypted_header[NCA_FULL_HEADER_LENGTH];
+    u8 *hash_table; // Reencrypted PFS0 hash table
+    u8 *block_data; // Reencrypted PFS0 hash blocks holding the content records
+    u64 block_offset; // Relative to NCA start
+    u64 block_size;
+    dataOverlayList overlays; // Header, hash table and block data overlays. Filled by patchCnmtNca()
+    u32 crc; // CRC32 checksum for the patched CNMT NCA
 } nca_cnmt_mod_data;
 
 typedef struct {
@@ -347,6 +364,20 @@ typedef struct {
     bool missing_tik;
 } title_rights_ctx;
 
+// Decrypted NCA header cache entry, keyed by NCA ID
+typedef struct {
+    bool valid;
+    NcmContentId ncaId;
+    nca_header_t header;
+    bool key_area_decrypted;                            // Only used with NCAs that don't use titlekey crypto
+    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
+    bool titlekey_retrieved;                            // Set if dec_titlekey holds the decrypted titlekey
+    bool tik_retrieved;                                 // Set if tik_data and enc_titlekey are also available
+    u8 enc_titlekey[0x10];
+    u8 dec_titlekey[0x10];
+    rsa2048_sha256_ticket tik_data;
+} nca_header_cache_entry;
+
 typedef struct {
     NcmStorageId storageId;
     NcmContentStorage ncmStorage;
@@ -731,21 +762,33 @@ void convertU64ToNcaSize(const u64 size, u8 out[0x6]);
 
 bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize);
 
+bool readNcaDataStreamByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, u8 **outBuf, size_t bufSize);
+
 bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *ctx, u64 offset, void *outBuf, size_t bufSize, bool encrypt);
 
+bool initNcaCtrThreadBuffer();
+
+void freeNcaCtrThreadBuffer();
+
 bool readBktrSectionBlock(u64 offset, void *outBuf, size_t bufSize);
 
 bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize);
 
-bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData);
+bool decryptNcaHeader(const NcmContentId *ncaId, const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData, NcmStorageId storageId);
+
+bool isNcaHeaderCached(const NcmContentId *ncaId);
+
+u32 prefetchNcaHeaders(NcmContentStorage *ncmStorage, const NcmContentId *ncaIds, u32 ncaCount);
 
 bool retrieveTitleKeyFromGameCardTicket(title_rights_ctx *rights_info, u8 *decrypted_nca_keys);
 
 bool processProgramNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, cnmt_xml_content_info *xml_content_info, nca_program_mod_data **output, u32 *cur_mod_cnt, u32 idx);
 
-bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, u32 cnmtNcaIndex, nca_cnmt_mod_data *output, title_rights_ctx *rights_info);
+bool retrieveCnmtNcaData(NcmStorageId curStorageId, NcmContentStorage *ncmStorage, cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, u32 cnmtNcaIndex, nca_cnmt_mod_data *output, title_rights_ctx *rights_info);
+
+bool readCnmtNcaData(NcmContentStorage *ncmStorage, nca_cnmt_mod_data *cnmt_mod, u64 offset, void *outBuf, size_t bufSize);
 
-bool patchCnmtNca(u8 *ncaBuf, u64 ncaBufSize, cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, nca_cnmt_mod_data *cnmt_mod);
+bool patchCnmtNca(NcmContentStorage *ncmStorage, cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, nca_cnmt_mod_data *cnmt_mod);
 
 bool parseExeFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys);
 
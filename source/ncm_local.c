@@ -0,0 +1,438 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "ncm_local.h"
+#include "nca.h"
+#include "keys.h"
+#include "ui.h"
+#include "util.h"
+
+/* Extern variables */
+
+extern __thread int breaks;
+extern int font_height;
+
+/* Static variables */
+
+static localContentEntry *localContents = NULL;
+static u32 localContentCnt = 0;
+
+static localContentMetaEntry *localContentMetas = NULL;
+static u32 localContentMetaCnt = 0;
+
+static bool localContentLoaded = false;
+
+// The last opened content file (or split content part) is kept open, since NCA data is usually read sequentially
+// Metadata worker threads read NCA data concurrently, so access to it is serialized
+static FILE *localContentFile = NULL;
+static localContentEntry *localContentFileEntry = NULL;
+static u32 localContentFilePart = 0;
+static pthread_mutex_t localContentFileMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int localContentEntryCmp(const void *a, const void *b)
+{
+    return memcmp(((localContentEntry*)a)->contentId.c, ((localContentEntry*)b)->contentId.c, sizeof(NcmContentId));
+}
+
+static int localContentMetaEntryCmp(const void *a, const void *b)
+{
+    const NcmContentMetaKey *key1 = &(((localContentMetaEntry*)a)->key.key);
+    const NcmContentMetaKey *key2 = &(((localContentMetaEntry*)b)->key.key);
+    
+    if (key1->type != key2->type) return (key1->type < key2->type ? -1 : 1);
+    if (key1->id != key2->id) return (key1->id < key2->id ? -1 : 1);
+    if (key1->version != key2->version) return (key1->version < key2->version ? -1 : 1);
+    
+    return 0;
+}
+
+static localContentEntry *getLocalContentEntry(const NcmContentId *contentId)
+{
+    if (!localContents || !localContentCnt || !contentId) return NULL;
+    
+    localContentEntry key;
+    memcpy(&(key.contentId), contentId, sizeof(NcmContentId));
+    
+    return (localContentEntry*)bsearch(&key, localContents, localContentCnt, sizeof(localContentEntry), localContentEntryCmp);
+}
+
+static void closeLocalContentFile()
+{
+    if (localContentFile)
+    {
+        fclose(localContentFile);
+        localContentFile = NULL;
+    }
+    
+    localContentFileEntry = NULL;
+    localContentFilePart = 0;
+}
+
+static bool readLocalContentData(localContentEntry *entry, u64 offset, void *outBuf, size_t bufSize)
+{
+    if (!entry || !outBuf || !bufSize || (offset + bufSize) > entry->size) return false;
+    
+    bool success = true;
+    
+    u8 *outPtr = (u8*)outBuf;
+    u64 curOffset = offset;
+    size_t remaining = bufSize;
+    
+    char partPath[NAME_BUF_LEN] = {'\0'};
+    
+    pthread_mutex_lock(&localContentFileMutex);
+    
+    while(remaining)
+    {
+        u32 part = (entry->partCnt ? (u32)(curOffset / entry->partSize) : 0);
+        u64 partOffset = (entry->partCnt ? (curOffset % entry->partSize) : curOffset);
+        size_t readSize = remaining;
+        
+        if (entry->partCnt && (partOffset + readSize) > entry->partSize) readSize = (size_t)(entry->partSize - partOffset);
+        
+        if (!localContentFile || localContentFileEntry != entry || localContentFilePart != part)
+        {
+            closeLocalContentFile();
+            
+            if (entry->partCnt)
+            {
+                snprintf(partPath, MAX_CHARACTERS(partPath), "%s/%02u", entry->path, part);
+                localContentFile = fopen(partPath, "rb");
+            } else {
+                localContentFile = fopen(entry->path, "rb");
+            }
+            
+            if (!localContentFile)
+            {
+                success = false;
+                break;
+            }
+            
+            localContentFileEntry = entry;
+            localContentFilePart = part;
+        }
+        
+        if (fseek(localContentFile, (long)partOffset, SEEK_SET) != 0 || fread(outPtr, 1, readSize, localContentFile) != readSize)
+        {
+            closeLocalContentFile();
+            success = false;
+            break;
+        }
+        
+        outPtr += readSize;
+        curOffset += readSize;
+        remaining -= readSize;
+    }
+    
+    pthread_mutex_unlock(&localContentFileMutex);
+    
+    return success;
+}
+
+typedef struct {
+    NcmContentStorage *ncmStorage;
+    localContentEntry *entry;
+    Aes128CtrContext *aes_ctx;
+} localContentMetaReader;
+
+static bool readLocalContentMetaSection(void *userData, u64 offset, void *outBuf, u64 size)
+{
+    localContentMetaReader *reader = (localContentMetaReader*)userData;
+    return processNcaCtrSectionBlock(reader->ncmStorage, &(reader->entry->contentId), reader->aes_ctx, offset, outBuf, size, false);
+}
+
+// Decrypts the Meta NCA header and retrieves the content meta key and content records from its PFS0 section (see parseLocalContentMeta())
+static bool loadLocalContentMeta(localContentEntry *entry)
+{
+    if (!entry || !entry->isMeta) return false;
+    
+    // Zeroed content storage: all NCA reads are served by the local content storage
+    NcmContentStorage ncmStorage;
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    
+    u8 enc_header[NCA_FULL_HEADER_LENGTH];
+    nca_header_t dec_header;
+    
+    title_rights_ctx rights_info;
+    memset(&rights_info, 0, sizeof(title_rights_ctx));
+    
+    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
+    
+    u32 i;
+    
+    u64 section_offset, section_size;
+    
+    Aes128CtrContext aes_ctx;
+    unsigned char ctr[0x10];
+    u64 ofs;
+    
+    localContentMetaReader reader;
+    localContentMetaEntry meta;
+    localContentMetaEntry *tmp_metas = NULL;
+    
+    if (!readLocalContentData(entry, 0, enc_header, NCA_FULL_HEADER_LENGTH)) return false;
+    
+    if (!decryptNcaHeader(&(entry->contentId), enc_header, NCA_FULL_HEADER_LENGTH, &dec_header, &rights_info, decrypted_nca_keys, false, LOCAL_CONTENT_STORAGE_ID)) return false;
+    
+    if (dec_header.content_type != NcmContentType_Meta || dec_header.fs_headers[0].partition_type != NCA_FS_HEADER_PARTITION_PFS0 || dec_header.fs_headers[0].fs_type != NCA_FS_HEADER_FSTYPE_PFS0 || dec_header.fs_headers[0].crypt_type != NCA_FS_HEADER_CRYPT_CTR) return false;
+    
+    section_offset = ((u64)dec_header.section_entries[0].media_start_offset * (u64)MEDIA_UNIT_SIZE);
+    section_size = (((u64)dec_header.section_entries[0].media_end_offset * (u64)MEDIA_UNIT_SIZE) - section_offset);
+    
+    if (!section_offset || section_offset < NCA_FULL_HEADER_LENGTH || !section_size || (section_offset + section_size) > entry->size) return false;
+    
+    // Generate initial CTR
+    ofs = (section_offset >> 4);
+    
+    for(i = 0; i < 0x8; i++)
+    {
+        ctr[i] = dec_header.fs_headers[0].section_ctr[0x08 - i - 1];
+        ctr[0x10 - i - 1] = (unsigned char)(ofs & 0xFF);
+        ofs >>= 8;
+    }
+    
+    aes128CtrContextCreate(&aes_ctx, decrypted_nca_keys + (NCA_KEY_AREA_KEY_SIZE * 2), ctr);
+    
+    reader.ncmStorage = &ncmStorage;
+    reader.entry = entry;
+    reader.aes_ctx = &aes_ctx;
+    
+    if (!parseLocalContentMeta(entry, section_offset + dec_header.fs_headers[0].pfs0_superblock.pfs0_offset, readLocalContentMetaSection, &reader, &meta)) return false;
+    
+    tmp_metas = realloc(localContentMetas, (localContentMetaCnt + 1) * sizeof(localContentMetaEntry));
+    if (!tmp_metas)
+    {
+        free(meta.contentInfos);
+        return false;
+    }
+    
+    localContentMetas = tmp_metas;
+    memcpy(&(localContentMetas[localContentMetaCnt]), &meta, sizeof(localContentMetaEntry));
+    localContentMetaCnt++;
+    
+    return true;
+}
+
+bool loadLocalContentStorage()
+{
+    if (localContentLoaded) return (localContentMetaCnt > 0);
+    
+    u32 i;
+    
+    freeLocalContentStorage();
+    
+    // Don't try again until the title info is reloaded, even if nothing was found
+    localContentLoaded = true;
+    
+    if (!checkIfFileExists(LOCAL_CONTENT_REGISTERED_PATH)) return false;
+    
+    scanLocalContentDirectory(LOCAL_CONTENT_REGISTERED_PATH, &localContents, &localContentCnt);
+    if (!localContentCnt) return false;
+    
+    // Content lookups use a binary search
+    qsort(localContents, localContentCnt, sizeof(localContentEntry), localContentEntryCmp);
+    
+    for(i = 0; i < localContentCnt; i++)
+    {
+        if (localContents[i].isMeta) loadLocalContentMeta(&(localContents[i]));
+    }
+    
+    if (!localContentMetaCnt) return false;
+    
+    // Keep a stable title order between scans
+    qsort(localContentMetas, localContentMetaCnt, sizeof(localContentMetaEntry), localContentMetaEntryCmp);
+    
+    return true;
+}
+
+void freeLocalContentStorage()
+{
+    u32 i;
+    
+    pthread_mutex_lock(&localContentFileMutex);
+    closeLocalContentFile();
+    pthread_mutex_unlock(&localContentFileMutex);
+    
+    if (localContentMetas)
+    {
+        for(i = 0; i < localContentMetaCnt; i++)
+        {
+            if (localContentMetas[i].contentInfos) free(localContentMetas[i].contentInfos);
+        }
+        
+        free(localContentMetas);
+        localContentMetas = NULL;
+    }
+    
+    localContentMetaCnt = 0;
+    
+    if (localContents)
+    {
+        free(localContents);
+        localContents = NULL;
+    }
+    
+    localContentCnt = 0;
+    
+    localContentLoaded = false;
+}
+
+bool readLocalContentTicket(const u8 *rightsId, u8 *outBuf)
+{
+    if (!rightsId || !outBuf) return false;
+    
+    char rightsIdStr[SHA256_HASH_SIZE + 1] = {'\0'}, tikPath[NAME_BUF_LEN] = {'\0'};
+    convertDataToHexString(rightsId, 0x10, rightsIdStr, MAX_ELEMENTS(rightsIdStr));
+    
+    snprintf(tikPath, MAX_CHARACTERS(tikPath), "%s%s.tik", LOCAL_CONTENT_TICKET_PATH, rightsIdStr);
+    
+    FILE *tikFile = fopen(tikPath, "rb");
+    if (!tikFile) return false;
+    
+    size_t read_bytes = fread(outBuf, 1, ETICKET_TIK_FILE_SIZE, tikFile);
+    fclose(tikFile);
+    
+    rsa2048_sha256_ticket *tik = (rsa2048_sha256_ticket*)outBuf;
+    
+    // Only common tickets with RSA-2048 SHA-256 signatures are supported
+    if (read_bytes != ETICKET_TIK_FILE_SIZE || tik->sig_type != SIGTYPE_RSA2048_SHA256 || memcmp(tik->rights_id, rightsId, 0x10) != 0 || tik->titlekey_type != ETICKET_TITLEKEY_COMMON) return false;
+    
+    return true;
+}
+
+static localContentMetaEntry *getLocalContentMetaEntry(const NcmContentMetaKey *key)
+{
+    if (!key) return NULL;
+    
+    u32 i;
+    
+    for(i = 0; i < localContentMetaCnt; i++)
+    {
+        if (localContentMetas[i].key.key.id == key->id && localContentMetas[i].key.key.version == key->version && localContentMetas[i].key.key.type == key->type) return &(localContentMetas[i]);
+    }
+    
+    return NULL;
+}
+
+Result ncmLocalOpenContentMetaDatabase(NcmContentMetaDatabase *ncmDb, NcmStorageId storageId)
+{
+    if (storageId != LOCAL_CONTENT_STORAGE_ID) return ncmOpenContentMetaDatabase(ncmDb, storageId);
+    
+    if (!ncmDb) return MAKERESULT(Module_Libnx, LibnxError_BadInput);
+    
+    memset(ncmDb, 0, sizeof(NcmContentMetaDatabase));
+    
+    return (loadLocalContentStorage() ? 0 : MAKERESULT(Module_Libnx, LibnxError_NotFound));
+}
+
+Result ncmLocalContentMetaDatabaseListApplication(NcmContentMetaDatabase *ncmDb, s32 *outEntriesTotal, s32 *outEntriesWritten, NcmApplicationContentMetaKey *outKeys, s32 count, NcmContentMetaType metaType)
+{
+    if (serviceIsActive(&(ncmDb->s))) return ncmContentMetaDatabaseListApplication(ncmDb, outEntriesTotal, outEntriesWritten, outKeys, count, metaType);
+    
+    if (!outEntriesTotal || !outEntriesWritten || !outKeys || count <= 0) return MAKERESULT(Module_Libnx, LibnxError_BadInput);
+    
+    u32 i;
+    s32 total = 0, written = 0;
+    
+    for(i = 0; i < localContentMetaCnt; i++)
+    {
+        if (localContentMetas[i].key.key.type != (u8)metaType) continue;
+        
+        if (written < count)
+        {
+            memcpy(&(outKeys[written]), &(localContentMetas[i].key), sizeof(NcmApplicationContentMetaKey));
+            written++;
+        }
+        
+        total++;
+    }
+    
+    *outEntriesTotal = total;
+    *outEntriesWritten = written;
+    
+    return 0;
+}
+
+Result ncmLocalContentMetaDatabaseGet(NcmContentMetaDatabase *ncmDb, const NcmContentMetaKey *key, u64 *outSize, void *outData, u64 outDataSize)
+{
+    if (serviceIsActive(&(ncmDb->s))) return ncmContentMetaDatabaseGet(ncmDb, key, outSize, outData, outDataSize);
+    
+    // Only the content meta header is ever retrieved
+    if (!outSize || !outData || outDataSize < sizeof(NcmContentMetaHeader)) return MAKERESULT(Module_Libnx, LibnxError_BadInput);
+    
+    localContentMetaEntry *meta = getLocalContentMetaEntry(key);
+    if (!meta) return MAKERESULT(Module_Libnx, LibnxError_NotFound);
+    
+    NcmContentMetaHeader *header = (NcmContentMetaHeader*)outData;
+    memset(header, 0, sizeof(NcmContentMetaHeader));
+    
+    header->extended_header_size = (u16)sizeof(cnmt_extended_header);
+    header->content_count = (u16)meta->contentInfoCnt;
+    header->storage_id = (u8)LOCAL_CONTENT_STORAGE_ID;
+    
+    *outSize = sizeof(NcmContentMetaHeader);
+    
+    return 0;
+}
+
+Result ncmLocalContentMetaDatabaseListContentInfo(NcmContentMetaDatabase *ncmDb, s32 *outEntriesWritten, NcmContentInfo *outInfos, s32 count, const NcmContentMetaKey *key, s32 startIndex)
+{
+    if (serviceIsActive(&(ncmDb->s))) return ncmContentMetaDatabaseListContentInfo(ncmDb, outEntriesWritten, outInfos, count, key, startIndex);
+    
+    if (!outEntriesWritten || !outInfos || count <= 0 || startIndex < 0) return MAKERESULT(Module_Libnx, LibnxError_BadInput);
+    
+    localContentMetaEntry *meta = getLocalContentMetaEntry(key);
+    if (!meta) return MAKERESULT(Module_Libnx, LibnxError_NotFound);
+    
+    s32 written = 0;
+    
+    while(written < count && (u32)(startIndex + written) < meta->contentInfoCnt)
+    {
+        memcpy(&(outInfos[written]), &(meta->contentInfos[startIndex + written]), sizeof(NcmContentInfo));
+        written++;
+    }
+    
+    *outEntriesWritten = written;
+    
+    return 0;
+}
+
+Result ncmLocalOpenContentStorage(NcmContentStorage *ncmStorage, NcmStorageId storageId)
+{
+    if (storageId != LOCAL_CONTENT_STORAGE_ID) return ncmOpenContentStorage(ncmStorage, storageId);
+    
+    if (!ncmStorage) return MAKERESULT(Module_Libnx, LibnxError_BadInput);
+    
+    memset(ncmStorage, 0, sizeof(NcmContentStorage));
+    
+    return (loadLocalContentStorage() ? 0 : MAKERESULT(Module_Libnx, LibnxError_NotFound));
+}
+
+Result ncmLocalContentStorageGetPath(NcmContentStorage *ncmStorage, char *outPath, size_t outSize, const NcmContentId *contentId)
+{
+    if (serviceIsActive(&(ncmStorage->s))) return ncmContentStorageGetPath(ncmStorage, outPath, outSize, contentId);
+    
+    if (!outPath || !outSize) return MAKERESULT(Module_Libnx, LibnxError_BadInput);
+    
+    localContentEntry *entry = getLocalContentEntry(contentId);
+    if (!entry) return MAKERESULT(Module_Libnx, LibnxError_NotFound);
+    
+    snprintf(outPath, outSize, "%s", entry->path);
+    
+    return 0;
+}
+
+Result ncmLocalContentStorageReadContentIdFile(NcmContentStorage *ncmStorage, void *outBuf, size_t bufSize, const NcmContentId *contentId, u64 offset)
+{
+    if (serviceIsActive(&(ncmStorage->s))) return ncmContentStorageReadContentIdFile(ncmStorage, outBuf, bufSize, contentId, offset);
+    
+    localContentEntry *entry = getLocalContentEntry(contentId);
+    if (!entry) return MAKERESULT(Module_Libnx, LibnxError_NotFound);
+    
+    return (readLocalContentData(entry, offset, outBuf, bufSize) ? 0 : MAKERESULT(Module_Libnx, LibnxError_IoError));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef __NCM_LOCAL_H__
+#define __NCM_LOCAL_H__
+
+#include <switch.h>
+#include "local_content.h"
+#include "util.h"
+
+#define LOCAL_CONTENT_PATH              APP_BASE_PATH "local_content/"
+#define LOCAL_CONTENT_REGISTERED_PATH   LOCAL_CONTENT_PATH "registered/"    // Laid out like a registered content folder: "<content_id>.nca" files (or split "<content_id>.nca/00", "01"... directories), placed in any subdirectory
+#define LOCAL_CONTENT_TICKET_PATH       LOCAL_CONTENT_PATH "tickets/"       // "<rights_id>.tik" files. Only common tickets are supported
+
+#define LOCAL_CONTENT_STORAGE_ID        NcmStorageId_Host                   // Storage ID used by titles served from the local content storage
+
+// Scans LOCAL_CONTENT_REGISTERED_PATH and parses every Meta NCA found in it
+// Returns false if the directory doesn't exist or if no valid content meta records could be retrieved
+bool loadLocalContentStorage();
+void freeLocalContentStorage();
+
+// Reads a common ticket for the provided rights ID from LOCAL_CONTENT_TICKET_PATH
+// outBuf must be at least ETICKET_TIK_FILE_SIZE bytes long
+bool readLocalContentTicket(const u8 *rightsId, u8 *outBuf);
+
+// Drop-in replacements for the ncm calls used to retrieve titles and NCA data
+// Calls with LOCAL_CONTENT_STORAGE_ID return a zeroed (inactive) service, which makes all the other wrappers use the local content storage instead of ncm
+// Closing the zeroed services through ncmContentMetaDatabaseClose() / ncmContentStorageClose() is a no-op
+Result ncmLocalOpenContentMetaDatabase(NcmContentMetaDatabase *ncmDb, NcmStorageId storageId);
+Result ncmLocalContentMetaDatabaseListApplication(NcmContentMetaDatabase *ncmDb, s32 *outEntriesTotal, s32 *outEntriesWritten, NcmApplicationContentMetaKey *outKeys, s32 count, NcmContentMetaType metaType);
+Result ncmLocalContentMetaDatabaseGet(NcmContentMetaDatabase *ncmDb, const NcmContentMetaKey *key, u64 *outSize, void *outData, u64 outDataSize);
+Result ncmLocalContentMetaDatabaseListContentInfo(NcmContentMetaDatabase *ncmDb, s32 *outEntriesWritten, NcmContentInfo *outInfos, s32 count, const NcmContentMetaKey *key, s32 startIndex);
+
+Result ncmLocalOpenContentStorage(NcmContentStorage *ncmStorage, NcmStorageId storageId);
+Result ncmLocalContentStorageGetPath(NcmContentStorage *ncmStorage, char *outPath, size_t outSize, const NcmContentId *contentId);
+Result ncmLocalContentStorageReadContentIdFile(NcmContentStorage *ncmStorage, void *outBuf, size_t bufSize, const NcmContentId *contentId, u64 offset);
+
+#endif
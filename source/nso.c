@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "nso.h"
 #include "lz4.h"
@@ -10,7 +11,7 @@
 
 /* Extern variables */
 
-extern int breaks;
+extern __thread int breaks;
 extern int font_height;
 
 /* Statically allocated variables */
@@ -27,6 +28,28 @@ static u64 nsoBinaryRodataSectionSize = 0;
 static u64 nsoBinaryDataSectionOffset = 0;
 static u64 nsoBinaryDataSectionSize = 0;
 
+static const char *nsoSegmentNames[NSO_SEGMENT_CNT] = { ".text", ".rodata", ".data" };
+
+typedef enum {
+    NSO_SEGMENT_RESULT_OK = 0,
+    NSO_SEGMENT_RESULT_DECOMPRESSION_ERROR,
+    NSO_SEGMENT_RESULT_HASH_MISMATCH
+} nsoSegmentResult;
+
+// Decompresses a single NSO segment into its final location within the output buffer, then verifies it
+typedef struct {
+    const u8 *src;
+    u64 srcSize;
+    u8 *dst;
+    u64 dstSize;
+    bool compressed;
+    bool checkHash;
+    const u8 *hash;
+    pthread_t thread;
+    bool threadCreated;
+    nsoSegmentResult result;
+} nsoSegmentWorker;
+
 void freeNsoBinaryData()
 {
     if (nsoBinaryData)
@@ -428,3 +451,263 @@ out:
     
     return success;
 }
+
+static segment_header_t *getNsoSegmentHeader(nso_header_t *nsoHeader, u8 idx)
+{
+    return (idx == 0 ? &(nsoHeader->text_segment_header) : (idx == 1 ? &(nsoHeader->rodata_segment_header) : &(nsoHeader->data_segment_header)));
+}
+
+static u64 getNsoSegmentStoredSize(nso_header_t *nsoHeader, u8 idx)
+{
+    if (!(nsoHeader->flags & NSO_FLAG_COMPRESSED(idx))) return (u64)getNsoSegmentHeader(nsoHeader, idx)->decompressed_size;
+    return (u64)(idx == 0 ? nsoHeader->text_compressed_size : (idx == 1 ? nsoHeader->rodata_compressed_size : nsoHeader->data_compressed_size));
+}
+
+static u8 *getNsoSegmentHash(nso_header_t *nsoHeader, u8 idx)
+{
+    return (idx == 0 ? nsoHeader->text_decompressed_hash : (idx == 1 ? nsoHeader->rodata_decompressed_hash : nsoHeader->data_decompressed_hash));
+}
+
+static void processNsoSegment(nsoSegmentWorker *worker)
+{
+    u8 hash[SHA256_HASH_SIZE];
+    
+    worker->result = NSO_SEGMENT_RESULT_OK;
+    
+    if (worker->compressed)
+    {
+        if (worker->dstSize && LZ4_decompress_safe((const char*)worker->src, (char*)worker->dst, (int)worker->srcSize, (int)worker->dstSize) != (int)worker->dstSize)
+        {
+            worker->result = NSO_SEGMENT_RESULT_DECOMPRESSION_ERROR;
+            return;
+        }
+    } else {
+        memcpy(worker->dst, worker->src, worker->dstSize);
+    }
+    
+    // Verify the decompressed data while it's still hot in the cache
+    if (worker->checkHash)
+    {
+        sha256CalculateHash(hash, worker->dst, worker->dstSize);
+        if (memcmp(hash, worker->hash, SHA256_HASH_SIZE) != 0) worker->result = NSO_SEGMENT_RESULT_HASH_MISMATCH;
+    }
+}
+
+static void *nsoSegmentWorkerThreadFunc(void *arg)
+{
+    processNsoSegment((nsoSegmentWorker*)arg);
+    return NULL;
+}
+
+bool getNsoExportSize(nso_header_t *nsoHeader, u64 nso_size, nsoExportFormat exportFormat, u64 *outSize)
+{
+    if (!nsoHeader || !nso_size || exportFormat >= NSO_EXPORT_CNT || !outSize)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to calculate NSO export size!", __func__);
+        return false;
+    }
+    
+    u8 i;
+    segment_header_t *segment, *prevSegment = NULL;
+    u64 headerSize = nso_size, exportSize = 0;
+    
+    if (exportFormat == NSO_EXPORT_ORIGINAL)
+    {
+        *outSize = nso_size;
+        return true;
+    }
+    
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        segment = getNsoSegmentHeader(nsoHeader, i);
+        
+        if (((u64)segment->file_offset + getNsoSegmentStoredSize(nsoHeader, i)) > nso_size)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s segment exceeds NSO boundaries!", __func__, nsoSegmentNames[i]);
+            return false;
+        }
+        
+        // The ELF image is built using the memory layout from the NSO, so segments must be sorted and can't overlap
+        if (prevSegment && segment->memory_offset < ((u64)prevSegment->memory_offset + (u64)prevSegment->decompressed_size))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s segment overlaps the previous segment in the NSO memory layout!", __func__, nsoSegmentNames[i]);
+            return false;
+        }
+        
+        if (segment->file_offset < headerSize) headerSize = segment->file_offset;
+        
+        exportSize += (u64)segment->decompressed_size;
+        
+        prevSegment = segment;
+    }
+    
+    if (headerSize < sizeof(nso_header_t))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid segment file offsets in NSO header!", __func__);
+        return false;
+    }
+    
+    if (exportFormat == NSO_EXPORT_DECOMPRESSED)
+    {
+        exportSize += headerSize;
+    } else {
+        exportSize = (ELF_SEGMENT_ALIGNMENT + (u64)nsoHeader->data_segment_header.memory_offset + (u64)nsoHeader->data_segment_header.decompressed_size);
+    }
+    
+    *outSize = exportSize;
+    
+    return true;
+}
+
+bool exportNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, u64 nso_base_offset, u64 nso_size, nso_header_t *nsoHeader, nsoExportFormat exportFormat, u8 **outBuf, u64 *outSize)
+{
+    if (!ncmStorage || !ncaId || !aes_ctx || !nso_base_offset || !nso_size || !nsoHeader || exportFormat == NSO_EXPORT_ORIGINAL || exportFormat >= NSO_EXPORT_CNT || !outBuf || !outSize)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to export NSO from Program NCA!", __func__);
+        return false;
+    }
+    
+    u8 i;
+    segment_header_t *segment;
+    
+    u8 *nsoData = NULL, *exportData = NULL;
+    u64 exportSize = 0, headerSize = nso_size, curOffset = 0;
+    u64 segmentOffsets[NSO_SEGMENT_CNT];
+    
+    nsoSegmentWorker workers[NSO_SEGMENT_CNT];
+    memset(workers, 0, sizeof(workers));
+    
+    bool success = false;
+    
+    if (!getNsoExportSize(nsoHeader, nso_size, exportFormat, &exportSize)) return false;
+    
+    nsoData = malloc(nso_size);
+    if (!nsoData)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NSO from Program NCA!", __func__);
+        return false;
+    }
+    
+    if (!processNcaCtrSectionBlock(ncmStorage, ncaId, aes_ctx, nso_base_offset, nsoData, nso_size, false))
+    {
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes NSO from Program NCA!", __func__, nso_size);
+        goto out;
+    }
+    
+    exportData = calloc(exportSize, sizeof(u8));
+    if (!exportData)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the exported NSO!", __func__);
+        goto out;
+    }
+    
+    // Decompressed NSO: the header and module name are kept, and the segments are stored sequentially right after them
+    // ELF: segments are stored using their memory layout, right after the first page (which holds the ELF and program headers)
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        segment = getNsoSegmentHeader(nsoHeader, i);
+        if (segment->file_offset < headerSize) headerSize = segment->file_offset;
+    }
+    
+    curOffset = headerSize;
+    
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        segment = getNsoSegmentHeader(nsoHeader, i);
+        
+        segmentOffsets[i] = (exportFormat == NSO_EXPORT_DECOMPRESSED ? curOffset : (ELF_SEGMENT_ALIGNMENT + (u64)segment->memory_offset));
+        curOffset += (u64)segment->decompressed_size;
+        
+        workers[i].src = (nsoData + segment->file_offset);
+        workers[i].srcSize = getNsoSegmentStoredSize(nsoHeader, i);
+        workers[i].dst = (exportData + segmentOffsets[i]);
+        workers[i].dstSize = (u64)segment->decompressed_size;
+        workers[i].compressed = ((nsoHeader->flags & NSO_FLAG_COMPRESSED(i)) != 0);
+        workers[i].checkHash = ((nsoHeader->flags & NSO_FLAG_HASH_CHECK(i)) != 0);
+        workers[i].hash = getNsoSegmentHash(nsoHeader, i);
+        
+        workers[i].threadCreated = (pthread_create(&(workers[i].thread), NULL, &nsoSegmentWorkerThreadFunc, &(workers[i])) == 0);
+        
+        // Process the segment on the current thread if the worker couldn't be created
+        if (!workers[i].threadCreated) processNsoSegment(&(workers[i]));
+    }
+    
+    success = true;
+    
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        if (workers[i].threadCreated) pthread_join(workers[i].thread, NULL);
+        
+        if (workers[i].result == NSO_SEGMENT_RESULT_OK) continue;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s %s segment from NSO in Program NCA!", __func__, (workers[i].result == NSO_SEGMENT_RESULT_DECOMPRESSION_ERROR ? "unable to decompress" : "hash mismatch for"), nsoSegmentNames[i]);
+        breaks++;
+        success = false;
+    }
+    
+    if (!success) goto out;
+    
+    if (exportFormat == NSO_EXPORT_DECOMPRESSED)
+    {
+        memcpy(exportData, nsoData, headerSize);
+        
+        nso_header_t *exportHeader = (nso_header_t*)exportData;
+        
+        for(i = 0; i < NSO_SEGMENT_CNT; i++)
+        {
+            exportHeader->flags &= ~NSO_FLAG_COMPRESSED(i);
+            getNsoSegmentHeader(exportHeader, i)->file_offset = (u32)segmentOffsets[i];
+        }
+        
+        exportHeader->text_compressed_size = exportHeader->text_segment_header.decompressed_size;
+        exportHeader->rodata_compressed_size = exportHeader->rodata_segment_header.decompressed_size;
+        exportHeader->data_compressed_size = exportHeader->data_segment_header.decompressed_size;
+        
+        // Drop the module name if it wasn't stored before the segments
+        if (((u64)exportHeader->module_offset + (u64)exportHeader->module_file_size) > headerSize)
+        {
+            exportHeader->module_offset = 0;
+            exportHeader->module_file_size = 0;
+        }
+    } else {
+        elf64_header_t *elfHeader = (elf64_header_t*)exportData;
+        elf64_program_header_t *elfProgramHeaders = (elf64_program_header_t*)(exportData + sizeof(elf64_header_t));
+        
+        elfHeader->magic = __builtin_bswap32(ELF_MAGIC);
+        elfHeader->elf_class = ELF_CLASS_64;
+        elfHeader->data_encoding = ELF_DATA_LSB;
+        elfHeader->ident_version = ELF_VERSION_CURRENT;
+        elfHeader->type = ELF_TYPE_DYN;
+        elfHeader->machine = ELF_MACHINE_AARCH64;
+        elfHeader->version = ELF_VERSION_CURRENT;
+        elfHeader->entry = (u64)nsoHeader->text_segment_header.memory_offset;
+        elfHeader->phdr_offset = sizeof(elf64_header_t);
+        elfHeader->ehdr_size = sizeof(elf64_header_t);
+        elfHeader->phdr_entry_size = sizeof(elf64_program_header_t);
+        elfHeader->phdr_count = NSO_SEGMENT_CNT;
+        
+        for(i = 0; i < NSO_SEGMENT_CNT; i++)
+        {
+            segment = getNsoSegmentHeader(nsoHeader, i);
+            
+            elfProgramHeaders[i].type = ELF_PT_LOAD;
+            elfProgramHeaders[i].flags = (i == 0 ? (ELF_PF_R | ELF_PF_X) : (i == 1 ? ELF_PF_R : (ELF_PF_R | ELF_PF_W)));
+            elfProgramHeaders[i].offset = segmentOffsets[i];
+            elfProgramHeaders[i].vaddr = elfProgramHeaders[i].paddr = (u64)segment->memory_offset;
+            elfProgramHeaders[i].file_size = (u64)segment->decompressed_size;
+            elfProgramHeaders[i].mem_size = ((u64)segment->decompressed_size + (i == 2 ? (u64)nsoHeader->bss_size : 0));
+            elfProgramHeaders[i].align = ELF_SEGMENT_ALIGNMENT;
+        }
+    }
+    
+    *outBuf = exportData;
+    *outSize = exportSize;
+    
+out:
+    if (!success && exportData) free(exportData);
+    
+    free(nsoData);
+    
+    return success;
+}
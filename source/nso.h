@@ -4,6 +4,7 @@
 #define __NSO_H__
 
 #include <switch.h>
+#include "util.h"
 
 #define NSO_MAGIC       (u32)0x4E534F30     // "NSO0"
 #define MOD_MAGIC       (u32)0x4D4F4430     // "MOD0"
@@ -14,6 +15,24 @@
 
 #define ST_OBJECT       0x01
 
+#define NSO_SEGMENT_CNT                 3
+#define NSO_FLAG_COMPRESSED(idx)        (1 << (idx))            // Segment order: .text, .rodata, .data
+#define NSO_FLAG_HASH_CHECK(idx)        (1 << ((idx) + 3))
+
+#define ELF_MAGIC                       (u32)0x7F454C46         // "\x7FELF"
+#define ELF_CLASS_64                    2
+#define ELF_DATA_LSB                    1
+#define ELF_VERSION_CURRENT             1
+#define ELF_TYPE_DYN                    3
+#define ELF_MACHINE_AARCH64             183
+
+#define ELF_PT_LOAD                     1
+#define ELF_PF_X                        1
+#define ELF_PF_W                        2
+#define ELF_PF_R                        4
+
+#define ELF_SEGMENT_ALIGNMENT           0x1000
+
 typedef struct {
     u32 file_offset;
     u32 memory_offset;
@@ -49,10 +68,54 @@ typedef struct {
     u8 data_decompressed_hash[0x20];
 } PACKED nso_header_t;
 
+typedef struct {
+    u32 magic;
+    u8 elf_class;
+    u8 data_encoding;
+    u8 ident_version;
+    u8 os_abi;
+    u8 abi_version;
+    u8 ident_padding[7];
+    u16 type;
+    u16 machine;
+    u32 version;
+    u64 entry;
+    u64 phdr_offset;
+    u64 shdr_offset;
+    u32 flags;
+    u16 ehdr_size;
+    u16 phdr_entry_size;
+    u16 phdr_count;
+    u16 shdr_entry_size;
+    u16 shdr_count;
+    u16 shdr_str_index;
+} PACKED elf64_header_t;
+
+typedef struct {
+    u32 type;
+    u32 flags;
+    u64 offset;
+    u64 vaddr;
+    u64 paddr;
+    u64 file_size;
+    u64 mem_size;
+    u64 align;
+} PACKED elf64_program_header_t;
+
 // Retrieves the middleware list from a NSO stored in a partition from a NCA file
 bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml);
 
 // Retrieves the symbols list from a NSO stored in a partition from a NCA file
 bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml);
 
+// Calculates the output size for a NSO converted to the provided export format, using only the data from its header
+bool getNsoExportSize(nso_header_t *nsoHeader, u64 nso_size, nsoExportFormat exportFormat, u64 *outSize);
+
+// Converts a NSO stored in a partition from a NCA file to the provided export format
+// NSO_EXPORT_DECOMPRESSED keeps the original header (and segment hashes), with the compression flags cleared and the segments stored right after the module name
+// NSO_EXPORT_ELF generates a minimal ELF image with a PT_LOAD program header per segment. No section headers are generated
+// Each segment is decompressed and verified against its hash from the NSO header by its own worker thread
+// The output buffer must be freed by the caller
+bool exportNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, u64 nso_base_offset, u64 nso_size, nso_header_t *nsoHeader, nsoExportFormat exportFormat, u8 **outBuf, u64 *outSize);
+
 #endif
@@ -0,0 +1,103 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "overlay.h"
+
+void dataOverlayListInit(dataOverlayList *list)
+{
+    if (!list) return;
+    memset(list, 0, sizeof(dataOverlayList));
+}
+
+// Returns the index of the first entry that ends after the provided offset
+static u32 dataOverlayListFindFirst(const dataOverlayList *list, u64 offset)
+{
+    u32 low = 0, high = list->count;
+    
+    // Entries don't intersect, so their end offsets are sorted as well
+    while(low < high)
+    {
+        u32 mid = (low + ((high - low) / 2));
+        
+        if ((list->entries[mid].offset + list->entries[mid].size) <= offset)
+        {
+            low = (mid + 1);
+        } else {
+            high = mid;
+        }
+    }
+    
+    return low;
+}
+
+bool dataOverlayListAdd(dataOverlayList *list, u64 offset, const void *data, u64 size)
+{
+    if (!list || !data) return false;
+    
+    // Nothing to patch
+    if (!size) return true;
+    
+    u32 idx = dataOverlayListFindFirst(list, offset);
+    
+    // Reject overlays that intersect an existing entry
+    if (idx < list->count && list->entries[idx].offset < (offset + size)) return false;
+    
+    if (list->count == list->capacity)
+    {
+        u32 capacity = (list->capacity ? (list->capacity * 2) : DATA_OVERLAY_LIST_INITIAL_CAPACITY);
+        
+        dataOverlay *tmp = realloc(list->entries, capacity * sizeof(dataOverlay));
+        if (!tmp) return false;
+        
+        list->entries = tmp;
+        list->capacity = capacity;
+    }
+    
+    if (idx < list->count) memmove(&(list->entries[idx + 1]), &(list->entries[idx]), (list->count - idx) * sizeof(dataOverlay));
+    
+    list->entries[idx].offset = offset;
+    list->entries[idx].size = size;
+    list->entries[idx].data = (const u8*)data;
+    
+    list->count++;
+    
+    return true;
+}
+
+void dataOverlayListClear(dataOverlayList *list)
+{
+    if (!list) return;
+    
+    // Keep the allocated entries around. They'll be reused by the next file
+    list->count = 0;
+}
+
+void dataOverlayListFree(dataOverlayList *list)
+{
+    if (!list) return;
+    
+    if (list->entries) free(list->entries);
+    
+    memset(list, 0, sizeof(dataOverlayList));
+}
+
+void dataOverlayListApply(const dataOverlayList *list, u64 offset, void *buf, u64 size)
+{
+    if (!list || !list->count || !buf || !size) return;
+    
+    u32 i;
+    u8 *out = (u8*)buf;
+    u64 end = (offset + size);
+    
+    for(i = dataOverlayListFindFirst(list, offset); i < list->count && list->entries[i].offset < end; i++)
+    {
+        const dataOverlay *entry = &(list->entries[i]);
+        
+        u64 entry_end = (entry->offset + entry->size);
+        
+        u64 copy_start = (entry->offset > offset ? entry->offset : offset);
+        u64 copy_end = (entry_end < end ? entry_end : end);
+        
+        memcpy(out + (copy_start - offset), entry->data + (copy_start - entry->offset), copy_end - copy_start);
+    }
+}
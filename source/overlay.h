@@ -0,0 +1,31 @@
+#pragma once
+
+#ifndef __OVERLAY_H__
+#define __OVERLAY_H__
+
+#include <switch.h>
+
+#define DATA_OVERLAY_LIST_INITIAL_CAPACITY  8
+
+// Replacement data for a single region of an output file
+typedef struct {
+    u64 offset;                                     // Relative to the start of the output file
+    u64 size;
+    const u8 *data;                                 // Not owned by the overlay list. Must remain valid until the list is cleared
+} dataOverlay;
+
+// Holds all the patches for a single output file (e.g. a modified NCA)
+// Entries are kept sorted by offset and never intersect each other, which lets dataOverlayListApply() patch each chunk with a single merge-walk
+typedef struct {
+    u32 count;
+    u32 capacity;
+    dataOverlay *entries;
+} dataOverlayList;
+
+void dataOverlayListInit(dataOverlayList *list);
+bool dataOverlayListAdd(dataOverlayList *list, u64 offset, const void *data, u64 size);
+void dataOverlayListClear(dataOverlayList *list);
+void dataOverlayListFree(dataOverlayList *list);
+void dataOverlayListApply(const dataOverlayList *list, u64 offset, void *buf, u64 size);
+
+#endif
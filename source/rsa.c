@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
 #include <mbedtls/md.h>
@@ -13,63 +14,217 @@
 
 /* Extern variables */
 
-extern int breaks;
+extern __thread int breaks;
 extern int font_height;
 
-bool rsa_sign(void* input, size_t input_size, unsigned char* output, size_t output_size)
+/* Statically allocated variables */
+
+typedef struct {
+    mbedtls_pk_context pk;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+} rsa_sign_ctx;
+
+static rsa_sign_ctx signCtx[RSA_SIGN_WORKER_CNT];
+static pthread_t signThreads[RSA_SIGN_WORKER_CNT];
+static u32 signThreadCnt = 0;
+
+static pthread_mutex_t signMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t signQueueCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t signDoneCond = PTHREAD_COND_INITIALIZER;
+
+static rsa_sign_job *signQueueHead = NULL, *signQueueTail = NULL;
+static bool signInit = false, signExit = false;
+
+static void *rsa_sign_thread_func(void *arg)
 {
+    rsa_sign_ctx *ctx = (rsa_sign_ctx*)arg;
+    
     unsigned char hash[32];
     unsigned char buf[MBEDTLS_MPI_MAX_SIZE];
-    const char *pers = "rsa_sign_pss";
     size_t olen = 0;
     
-    int ret;
-    bool success = false;
+    rsa_sign_job *job = NULL;
     
-    mbedtls_pk_context pk;
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
+    while(true)
+    {
+        pthread_mutex_lock(&signMutex);
+        
+        while(!signQueueHead && !signExit) pthread_cond_wait(&signQueueCond, &signMutex);
+        
+        if (!signQueueHead)
+        {
+            pthread_mutex_unlock(&signMutex);
+            break;
+        }
+        
+        job = signQueueHead;
+        signQueueHead = job->next;
+        if (!signQueueHead) signQueueTail = NULL;
+        
+        pthread_mutex_unlock(&signMutex);
+        
+        // Calculate SHA-256 checksum for the input data
+        sha256CalculateHash(hash, job->input, job->input_size);
+        
+        // Calculate hash signature
+        job->ret = mbedtls_pk_sign(&(ctx->pk), MBEDTLS_MD_SHA256, hash, 0, buf, &olen, mbedtls_ctr_drbg_random, &(ctx->ctr_drbg));
+        if (job->ret == 0) memcpy(job->output, buf, job->output_size);
+        
+        pthread_mutex_lock(&signMutex);
+        job->done = true;
+        pthread_cond_broadcast(&signDoneCond);
+        pthread_mutex_unlock(&signMutex);
+    }
     
-    mbedtls_entropy_init(&entropy);
-    mbedtls_pk_init(&pk);
-    mbedtls_ctr_drbg_init(&ctr_drbg);
+    return 0;
+}
+
+static void rsa_sign_free_ctx(rsa_sign_ctx *ctx)
+{
+    mbedtls_ctr_drbg_free(&(ctx->ctr_drbg));
+    mbedtls_pk_free(&(ctx->pk));
+    mbedtls_entropy_free(&(ctx->entropy));
+}
+
+static bool rsa_sign_init()
+{
+    if (signInit) return true;
     
-    // Calculate SHA-256 checksum for the input data
-    sha256CalculateHash(hash, input, input_size);
+    const char *pers = "rsa_sign_pss";
+    int ret;
+    u32 i;
     
-    // Seed the random number generator
-    ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, (const unsigned char *)pers, strlen(pers));
-    if (ret == 0)
+    for(i = 0; i < RSA_SIGN_WORKER_CNT; i++)
     {
+        rsa_sign_ctx *ctx = &(signCtx[i]);
+        
+        mbedtls_entropy_init(&(ctx->entropy));
+        mbedtls_pk_init(&(ctx->pk));
+        mbedtls_ctr_drbg_init(&(ctx->ctr_drbg));
+        
+        // Seed the random number generator
+        ret = mbedtls_ctr_drbg_seed(&(ctx->ctr_drbg), mbedtls_entropy_func, &(ctx->entropy), (const unsigned char *)pers, strlen(pers));
+        if (ret != 0)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: mbedtls_ctr_drbg_seed failed! (%d)", __func__, ret);
+            break;
+        }
+        
         // Parse private key
-        ret = mbedtls_pk_parse_key(&pk, (unsigned char*)rsa_private_key, strlen(rsa_private_key) + 1, NULL, 0);
-        if (ret == 0)
+        ret = mbedtls_pk_parse_key(&(ctx->pk), (unsigned char*)rsa_private_key, strlen(rsa_private_key) + 1, NULL, 0);
+        if (ret != 0)
         {
-            // Set RSA padding
-            mbedtls_rsa_set_padding(mbedtls_pk_rsa(pk), MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
-            
-            // Calculate hash signature
-            ret = mbedtls_pk_sign(&pk, MBEDTLS_MD_SHA256, hash, 0, buf, &olen, mbedtls_ctr_drbg_random, &ctr_drbg);
-            if (ret == 0)
-            {
-                // Copy signature to output
-                memcpy(output, buf, output_size);
-                success = true;
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: mbedtls_pk_sign failed! (%d)", __func__, ret);
-            }
-        } else {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: mbedtls_pk_parse_key failed! (%d)", __func__, ret);
+            break;
         }
+        
+        // Set RSA padding
+        mbedtls_rsa_set_padding(mbedtls_pk_rsa(ctx->pk), MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
+    }
+    
+    if (i < RSA_SIGN_WORKER_CNT)
+    {
+        for(u32 j = 0; j <= i; j++) rsa_sign_free_ctx(&(signCtx[j]));
+        return false;
+    }
+    
+    signExit = false;
+    
+    for(signThreadCnt = 0; signThreadCnt < RSA_SIGN_WORKER_CNT; signThreadCnt++)
+    {
+        ret = pthread_create(&(signThreads[signThreadCnt]), NULL, &rsa_sign_thread_func, &(signCtx[signThreadCnt]));
+        if (ret != 0) break;
+    }
+    
+    if (!signThreadCnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to create thread! (%d)", __func__, ret);
+        for(i = 0; i < RSA_SIGN_WORKER_CNT; i++) rsa_sign_free_ctx(&(signCtx[i]));
+        return false;
+    }
+    
+    // Keep going with fewer threads if only some of them could be created
+    signInit = true;
+    
+    return true;
+}
+
+bool rsa_sign_submit(rsa_sign_job *job, const void *input, size_t input_size, unsigned char *output, size_t output_size)
+{
+    if (!job || !input || !input_size || !output || !output_size)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters!", __func__);
+        return false;
+    }
+    
+    if (!rsa_sign_init()) return false;
+    
+    memset(job, 0, sizeof(rsa_sign_job));
+    
+    job->input = input;
+    job->input_size = input_size;
+    job->output = output;
+    job->output_size = output_size;
+    
+    pthread_mutex_lock(&signMutex);
+    
+    if (signQueueTail)
+    {
+        signQueueTail->next = job;
     } else {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: mbedtls_ctr_drbg_seed failed! (%d)", __func__, ret);
+        signQueueHead = job;
     }
     
-    mbedtls_ctr_drbg_free(&ctr_drbg);
-    mbedtls_pk_free(&pk);
-    mbedtls_entropy_free(&entropy);
+    signQueueTail = job;
+    
+    pthread_cond_signal(&signQueueCond);
+    pthread_mutex_unlock(&signMutex);
+    
+    return true;
+}
+
+bool rsa_sign_wait(rsa_sign_job *job)
+{
+    if (!job || !job->input) return false;
+    
+    pthread_mutex_lock(&signMutex);
+    while(!job->done) pthread_cond_wait(&signDoneCond, &signMutex);
+    pthread_mutex_unlock(&signMutex);
+    
+    if (job->ret != 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: mbedtls_pk_sign failed! (%d)", __func__, job->ret);
+        return false;
+    }
+    
+    return true;
+}
+
+bool rsa_sign(void* input, size_t input_size, unsigned char* output, size_t output_size)
+{
+    rsa_sign_job job;
+    
+    if (!rsa_sign_submit(&job, input, input_size, output, output_size)) return false;
+    
+    return rsa_sign_wait(&job);
+}
+
+void rsa_sign_exit()
+{
+    if (!signInit) return;
+    
+    // Pending requests are still processed before the worker threads exit
+    pthread_mutex_lock(&signMutex);
+    signExit = true;
+    pthread_cond_broadcast(&signQueueCond);
+    pthread_mutex_unlock(&signMutex);
+    
+    for(u32 i = 0; i < signThreadCnt; i++) pthread_join(signThreads[i], NULL);
+    for(u32 i = 0; i < RSA_SIGN_WORKER_CNT; i++) rsa_sign_free_ctx(&(signCtx[i]));
     
-    return success;
+    signThreadCnt = 0;
+    signInit = false;
 }
 
 const unsigned char *rsa_get_public_key()
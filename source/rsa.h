@@ -5,7 +5,29 @@
 
 #include <switch.h>
 
+#define RSA_SIGN_WORKER_CNT     2                           // Background threads used to calculate RSA-PSS signatures. Each one holds its own parsed private key and DRBG instance
+
+// Asynchronous RSA-PSS signing request
+// Both the input and output buffers must remain valid until the request has been waited on
+typedef struct rsa_sign_job {
+    const void *input;
+    size_t input_size;
+    unsigned char *output;
+    size_t output_size;
+    int ret;                                                // mbedtls_pk_sign() return value. Only valid after rsa_sign_wait() returns
+    bool done;
+    struct rsa_sign_job *next;
+} rsa_sign_job;
+
+// Parses the private key and seeds the DRBG instances (only once per session), then queues the signing request
+bool rsa_sign_submit(rsa_sign_job *job, const void *input, size_t input_size, unsigned char *output, size_t output_size);
+
+// Blocks until the provided signing request has been completed
+bool rsa_sign_wait(rsa_sign_job *job);
+
 bool rsa_sign(void* input, size_t input_size, unsigned char* output, size_t output_size);
+void rsa_sign_exit();
+
 const unsigned char *rsa_get_public_key();
 
 #endif
@@ -0,0 +1,241 @@
+/* Multi-buffer SHA-256 implementation.
+ * Independent messages with the same size are processed in lockstep, so the
+ * dependency chains from each one of them can be interleaved by the CPU.
+ * Uses the ARMv8 SHA2 instructions if available, or the x86 SHA extensions
+ * when built for a host with them (tests and benchmarks). Otherwise it falls
+ * back to a portable C implementation. */
+
+#include <string.h>
+
+#if defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+#include <arm_neon.h>
+#define SHA256_FAST_USE_ARMV8
+#elif defined(__SHA__) && defined(__SSE4_1__)
+#include <immintrin.h>
+#define SHA256_FAST_USE_SHANI
+#endif
+
+#include "sha256_fast.h"
+
+#define SHA256_BLOCK_SIZE   0x40
+#define SHA256_HASH_SIZE    0x20
+
+static const u32 sha256_k[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static const u32 sha256_h0[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+#ifdef SHA256_FAST_USE_ARMV8
+
+// Processes a single 64-byte block for each lane
+static void sha256CompressBlocks(u32 states[][8], const u8 * const *blocks, u32 lanes)
+{
+    u32 i, j;
+    
+    uint32x4_t abcd[SHA256_FAST_MAX_LANES], efgh[SHA256_FAST_MAX_LANES];
+    uint32x4_t abcd_save[SHA256_FAST_MAX_LANES], efgh_save[SHA256_FAST_MAX_LANES];
+    uint32x4_t msg[SHA256_FAST_MAX_LANES][4];
+    
+    for(j = 0; j < lanes; j++)
+    {
+        abcd[j] = abcd_save[j] = vld1q_u32(&(states[j][0]));
+        efgh[j] = efgh_save[j] = vld1q_u32(&(states[j][4]));
+        
+        for(i = 0; i < 4; i++) msg[j][i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(blocks[j] + (i * 0x10))));
+    }
+    
+    // 16 groups of 4 rounds. The message schedule is expanded in-place, 4 words at a time
+    for(i = 0; i < 16; i++)
+    {
+        uint32x4_t k = vld1q_u32(&(sha256_k[i * 4]));
+        
+        for(j = 0; j < lanes; j++)
+        {
+            uint32x4_t wk = vaddq_u32(msg[j][i & 3], k);
+            uint32x4_t abcd_prev = abcd[j];
+            
+            if (i < 12) msg[j][i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[j][i & 3], msg[j][(i + 1) & 3]), msg[j][(i + 2) & 3], msg[j][(i + 3) & 3]);
+            
+            abcd[j] = vsha256hq_u32(abcd[j], efgh[j], wk);
+            efgh[j] = vsha256h2q_u32(efgh[j], abcd_prev, wk);
+        }
+    }
+    
+    for(j = 0; j < lanes; j++)
+    {
+        vst1q_u32(&(states[j][0]), vaddq_u32(abcd[j], abcd_save[j]));
+        vst1q_u32(&(states[j][4]), vaddq_u32(efgh[j], efgh_save[j]));
+    }
+}
+
+#elif defined(SHA256_FAST_USE_SHANI)
+
+// Processes a single 64-byte block for each lane
+// The state is kept as ABEF / CDGH pairs, which is the layout expected by SHA256RNDS2
+static void sha256CompressBlocks(u32 states[][8], const u8 * const *blocks, u32 lanes)
+{
+    u32 i, j;
+    
+    const __m128i bswap_mask = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+    
+    __m128i abef[SHA256_FAST_MAX_LANES], cdgh[SHA256_FAST_MAX_LANES];
+    __m128i abef_save[SHA256_FAST_MAX_LANES], cdgh_save[SHA256_FAST_MAX_LANES];
+    __m128i msg[SHA256_FAST_MAX_LANES][4];
+    
+    for(j = 0; j < lanes; j++)
+    {
+        __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&(states[j][0])), 0xB1);
+        __m128i hgfe = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&(states[j][4])), 0x1B);
+        
+        abef[j] = abef_save[j] = _mm_alignr_epi8(dcba, hgfe, 8);
+        cdgh[j] = cdgh_save[j] = _mm_blend_epi16(hgfe, dcba, 0xF0);
+        
+        for(i = 0; i < 4; i++) msg[j][i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(blocks[j] + (i * 0x10))), bswap_mask);
+    }
+    
+    // 16 groups of 4 rounds. The message schedule is expanded in-place, 4 words at a time
+    for(i = 0; i < 16; i++)
+    {
+        __m128i k = _mm_loadu_si128((const __m128i*)&(sha256_k[i * 4]));
+        
+        for(j = 0; j < lanes; j++)
+        {
+            __m128i wk = _mm_add_epi32(msg[j][i & 3], k);
+            
+            if (i < 12) msg[j][i & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(msg[j][i & 3], msg[j][(i + 1) & 3]), _mm_alignr_epi8(msg[j][(i + 3) & 3], msg[j][(i + 2) & 3], 4)), msg[j][(i + 3) & 3]);
+            
+            cdgh[j] = _mm_sha256rnds2_epu32(cdgh[j], abef[j], wk);
+            abef[j] = _mm_sha256rnds2_epu32(abef[j], cdgh[j], _mm_shuffle_epi32(wk, 0x0E));
+        }
+    }
+    
+    for(j = 0; j < lanes; j++)
+    {
+        __m128i feba = _mm_shuffle_epi32(_mm_add_epi32(abef[j], abef_save[j]), 0x1B);
+        __m128i dchg = _mm_shuffle_epi32(_mm_add_epi32(cdgh[j], cdgh_save[j]), 0xB1);
+        
+        _mm_storeu_si128((__m128i*)&(states[j][0]), _mm_blend_epi16(feba, dchg, 0xF0));
+        _mm_storeu_si128((__m128i*)&(states[j][4]), _mm_alignr_epi8(dchg, feba, 8));
+    }
+}
+
+#else
+
+#define ROTR32(x, n)    (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256CompressBlock(u32 *state, const u8 *block)
+{
+    u32 i;
+    u32 w[64];
+    u32 a, b, c, d, e, f, g, h;
+    
+    for(i = 0; i < 16; i++) w[i] = (((u32)block[i * 4] << 24) | ((u32)block[(i * 4) + 1] << 16) | ((u32)block[(i * 4) + 2] << 8) | (u32)block[(i * 4) + 3]);
+    
+    for(i = 16; i < 64; i++)
+    {
+        u32 s0 = (ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3));
+        u32 s1 = (ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10));
+        w[i] = (w[i - 16] + s0 + w[i - 7] + s1);
+    }
+    
+    a = state[0]; b = state[1]; c = state[2]; d = state[3];
+    e = state[4]; f = state[5]; g = state[6]; h = state[7];
+    
+    for(i = 0; i < 64; i++)
+    {
+        u32 t1 = (h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i]);
+        u32 t2 = ((ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c)));
+        
+        h = g; g = f; f = e; e = (d + t1);
+        d = c; c = b; b = a; a = (t1 + t2);
+    }
+    
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+static void sha256CompressBlocks(u32 states[][8], const u8 * const *blocks, u32 lanes)
+{
+    u32 j;
+    for(j = 0; j < lanes; j++) sha256CompressBlock(states[j], blocks[j]);
+}
+
+#endif
+
+// Hashes up to SHA256_FAST_MAX_LANES messages with the same size
+static void sha256MultiCalculateHashLanes(u8 *outHashes, const void * const *inputs, u64 size, u32 lanes)
+{
+    u32 i, j;
+    u64 offset;
+    
+    u32 states[SHA256_FAST_MAX_LANES][8];
+    const u8 *blocks[SHA256_FAST_MAX_LANES];
+    
+    // Room for the last partial block plus the padding
+    u8 tail[SHA256_FAST_MAX_LANES][SHA256_BLOCK_SIZE * 2];
+    
+    u64 tail_size = (size % SHA256_BLOCK_SIZE);
+    u64 tail_blocks = ((tail_size + 9) > SHA256_BLOCK_SIZE ? 2 : 1);
+    u64 bit_size = (size * 8);
+    
+    for(j = 0; j < lanes; j++) memcpy(states[j], sha256_h0, sizeof(sha256_h0));
+    
+    // Full blocks are read straight from the input buffers
+    for(offset = 0; (offset + SHA256_BLOCK_SIZE) <= size; offset += SHA256_BLOCK_SIZE)
+    {
+        for(j = 0; j < lanes; j++) blocks[j] = ((const u8*)inputs[j] + offset);
+        sha256CompressBlocks(states, blocks, lanes);
+    }
+    
+    // Generate the padded tail for each lane
+    for(j = 0; j < lanes; j++)
+    {
+        memset(tail[j], 0, tail_blocks * SHA256_BLOCK_SIZE);
+        if (tail_size) memcpy(tail[j], (const u8*)inputs[j] + offset, tail_size);
+        tail[j][tail_size] = 0x80;
+        
+        for(i = 0; i < 8; i++) tail[j][(tail_blocks * SHA256_BLOCK_SIZE) - 1 - i] = (u8)(bit_size >> (i * 8));
+    }
+    
+    for(i = 0; i < tail_blocks; i++)
+    {
+        for(j = 0; j < lanes; j++) blocks[j] = (tail[j] + (i * SHA256_BLOCK_SIZE));
+        sha256CompressBlocks(states, blocks, lanes);
+    }
+    
+    // Store big endian hashes
+    for(j = 0; j < lanes; j++)
+    {
+        for(i = 0; i < 8; i++)
+        {
+            u8 *out = (outHashes + (j * SHA256_HASH_SIZE) + (i * 4));
+            out[0] = (u8)(states[j][i] >> 24);
+            out[1] = (u8)(states[j][i] >> 16);
+            out[2] = (u8)(states[j][i] >> 8);
+            out[3] = (u8)states[j][i];
+        }
+    }
+}
+
+void sha256MultiCalculateHash(u8 *outHashes, const void * const *inputs, u64 size, u32 count)
+{
+    if (!outHashes || !inputs || !count) return;
+    
+    u32 i, lanes;
+    
+    for(i = 0; i < count; i += lanes)
+    {
+        lanes = ((count - i) > SHA256_FAST_MAX_LANES ? SHA256_FAST_MAX_LANES : (count - i));
+        sha256MultiCalculateHashLanes(outHashes + (i * SHA256_HASH_SIZE), inputs + i, size, lanes);
+    }
+}
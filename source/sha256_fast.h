@@ -0,0 +1,15 @@
+#pragma once
+
+#ifndef __SHA256_FAST_H__
+#define __SHA256_FAST_H__
+
+#include <switch/types.h>
+
+#define SHA256_FAST_MAX_LANES   4                   // Maximum number of messages hashed at the same time
+
+// Calculates the SHA-256 checksums for 'count' independent messages of the same size
+// Up to SHA256_FAST_MAX_LANES messages are processed at once with interleaved ARMv8 SHA2 instructions. 'outHashes' must hold (count * 0x20) bytes
+// This is meant for lots of small messages (e.g. key candidates or hash table blocks), where the per-call overhead of sha256CalculateHash() dominates
+void sha256MultiCalculateHash(u8 *outHashes, const void * const *inputs, u64 size, u32 count);
+
+#endif
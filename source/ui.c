@@ -5,6 +5,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <math.h>
+#include <pthread.h>
 
 #include <switch.h>
 
@@ -18,6 +19,7 @@
 #include "ui.h"
 #include "util.h"
 #include "keys.h"
+#include "ncm_local.h"
 
 /* Extern variables */
 
@@ -30,6 +32,7 @@ extern gamecard_ctx_t gameCardInfo;
 extern u32 titleAppCount, titlePatchCount, titleAddOnCount;
 extern u32 sdCardTitleAppCount, sdCardTitlePatchCount, sdCardTitleAddOnCount;
 extern u32 emmcTitleAppCount, emmcTitlePatchCount, emmcTitleAddOnCount;
+extern u32 localTitleAppCount, localTitlePatchCount, localTitleAddOnCount;
 
 extern base_app_ctx_t *baseAppEntries;
 extern patch_addon_ctx_t *patchEntries, *addOnEntries;
@@ -58,12 +61,16 @@ static Framebuffer fb;
 static u32 *framebuf = NULL;
 static u32 framebuf_width = 0;
 
+static pthread_mutex_t uiDrawMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread uiMessageLog *capturedMessages = NULL;
+
 static const u8 bgColors[3] = { BG_COLOR_RGB };
 static const u8 hlBgColors[3] = { HIGHLIGHT_BG_COLOR_RGB };
 
 int cursor = 0;
 int scroll = 0;
-int breaks = 0;
+__thread int breaks = 0;                    // Thread-local: worker threads capture their messages instead, see uiCaptureMessages()
 int font_height = 0;
 
 int titleListCursor = 0, titleListScroll = 0;
@@ -91,6 +98,8 @@ static selectedRomFsType curRomFsType = ROMFS_TYPE_APP;
 
 static selectedTicketType curTikType = TICKET_TYPE_APP;
 
+static bisPartitionType curBisPartition = BIS_PARTITION_PRODINFO;
+
 static bool updatePerformed = false;
 
 bool highlight = false;
@@ -138,11 +147,11 @@ static const char *appControlsSdCardEmmcNoOrphan = "[ " NINTENDO_FONT_DPAD " / "
 static const char *appControlsSdCardEmmcNoApp = "[ " NINTENDO_FONT_B " ] Back | [ " NINTENDO_FONT_X " ] Batch mode | [ " NINTENDO_FONT_Y " ] Dump installed content with missing base application | [ " NINTENDO_FONT_PLUS " ] Exit";
 static const char *appControlsRomFs = "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Select | [ " NINTENDO_FONT_B " ] Back | [ " NINTENDO_FONT_Y " ] Dump current directory | [ " NINTENDO_FONT_PLUS " ] Exit";
 
-static const char *mainMenuItems[] = { "Dump gamecard content", "Dump installed SD card / eMMC content", "Update options" };
+static const char *mainMenuItems[] = { "Dump gamecard content", "Dump installed SD card / eMMC content", "Dump eMMC BIS partitions", "Update options" };
 static const char *gameCardMenuItems[] = { "NX Card Image (XCI) dump", "Nintendo Submission Package (NSP) dump", "HFS0 options", "ExeFS options", "RomFS options", "Dump gamecard certificate" };
 static const char *xciDumpMenuItems[] = { "Start XCI dump process", "Split output dump (FAT32 support): ", "Create directory with archive bit set: ", "Keep certificate: ", "Trim output dump: ", "CRC32 checksum calculation + dump verification: ", "Dump verification method: ", "Output naming scheme: " };
-static const char *nspDumpGameCardMenuItems[] = { "Dump base application NSP", "Dump bundled update NSP", "Dump bundled DLC NSP" };
-static const char *nspDumpSdCardEmmcMenuItems[] = { "Dump base application NSP", "Dump installed update NSP", "Dump installed DLC NSP" };
+static const char *nspDumpGameCardMenuItems[] = { "Dump base application NSP", "Dump bundled update NSP", "Dump bundled DLC NSP", "Dump base application + update + DLC NSP bundle", "Base application to bundle: " };
+static const char *nspDumpSdCardEmmcMenuItems[] = { "Dump base application NSP", "Dump installed update NSP", "Dump installed DLC NSP", "Dump base application + update + DLC NSP bundle" };
 static const char *nspAppDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Base application to dump: ", "Output naming scheme: " };
 static const char *nspPatchDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments: ", "Update to dump: ", "Output naming scheme: " };
 static const char *nspAddOnDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "DLC to dump: ", "Output naming scheme: " };
@@ -151,21 +160,24 @@ static const char *hfs0PartitionDumpType1MenuItems[] = { "Dump HFS0 partition 0
 static const char *hfs0PartitionDumpType2MenuItems[] = { "Dump HFS0 partition 0 (Update)", "Dump HFS0 partition 1 (Logo)", "Dump HFS0 partition 2 (Normal)", "Dump HFS0 partition 3 (Secure)" };
 static const char *hfs0BrowserType1MenuItems[] = { "Browse HFS0 partition 0 (Update)", "Browse HFS0 partition 1 (Normal)", "Browse HFS0 partition 2 (Secure)" };
 static const char *hfs0BrowserType2MenuItems[] = { "Browse HFS0 partition 0 (Update)", "Browse HFS0 partition 1 (Logo)", "Browse HFS0 partition 2 (Normal)", "Browse HFS0 partition 3 (Secure)" };
-static const char *exeFsMenuItems[] = { "ExeFS section data dump", "Browse ExeFS section", "Split files bigger than 4 GiB (FAT32 support): ", "Save data to CFW directory (LayeredFS): ", "Use update: " };
+static const char *exeFsMenuItems[] = { "ExeFS section data dump", "Browse ExeFS section", "Split files bigger than 4 GiB (FAT32 support): ", "Save data to CFW directory (LayeredFS): ", "NSO export format: ", "Use update: " };
 static const char *exeFsSectionDumpMenuItems[] = { "Start ExeFS data dump process", "Base application to dump: ", "Use update: " };
 static const char *exeFsSectionBrowserMenuItems[] = { "Browse ExeFS section", "Base application to browse: ", "Use update: " };
 static const char *romFsMenuItems[] = { "RomFS section data dump", "Browse RomFS section", "Split files bigger than 4 GiB (FAT32 support): ", "Save data to CFW directory (LayeredFS): ", "Use update/DLC: " };
 static const char *romFsSectionDumpMenuItems[] = { "Start RomFS data dump process", "Base application to dump: ", "Use update/DLC: " };
 static const char *romFsSectionBrowserMenuItems[] = { "Browse RomFS section", "Base application to browse: ", "Use update/DLC: " };
 static const char *sdCardEmmcMenuItems[] = { "Nintendo Submission Package (NSP) dump", "ExeFS options", "RomFS options", "Ticket options" };
-static const char *batchModeMenuItems[] = { "Start batch dump process", "Dump base applications: ", "Dump updates: ", "Dump DLCs: ", "Split output dumps (FAT32 support): ", "Remove console specific data: ", "Generate ticket-less dumps: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments from updates: ", "Skip already dumped titles: ", "Remember dumped titles: ", "Halt dump process on errors: ", "Output naming scheme: ", "Source storage: " };
-static const char *ticketMenuItems[] = { "Start ticket dump", "Remove console specific data: ", "Use ticket from title: " };
-static const char *updateMenuItems[] = { "Update NSWDB.COM XML database", "Update application" };
+static const char *batchModeMenuItems[] = { "Start batch dump process", "Dump base applications: ", "Dump updates: ", "Dump DLCs: ", "Split output dumps (FAT32 support): ", "Remove console specific data: ", "Generate ticket-less dumps: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments from updates: ", "Skip already dumped titles: ", "Remember dumped titles: ", "Halt dump process on errors: ", "Output naming scheme: ", "Source storage: ", "Dump order: " };
+static const char *ticketMenuItems[] = { "Start ticket dump", "Remove console specific data: ", "Use ticket from title: ", "Dump tickets from all installed titles" };
+static const char *bisMenuItems[] = { "Start BIS partition image dump", "BIS partition: ", "Split output dump (FAT32 support): ", "Skip unallocated FAT clusters: " };
+static const char *updateMenuItems[] = { "Update NSWDB.COM XML database", "Update application", "Calibrate transfer chunk sizes" };
 
 static const char *xciChecksumLookupMethods[] = { "NSWDB.COM XML database (offline)", "No-Intro database lookup (online)" };
 
 static const char *xciNamingSchemes[] = { "TitleName v[TitleVersion] ([TitleID])", "TitleName [[TitleID]][v[TitleVersion]]" };
 static const char *nspNamingSchemes[] = { "TitleName v[TitleVersion] ([TitleID]) ([TitleType])", "TitleName [[TitleID]][v[TitleVersion]][[TitleType]]" };
+static const char *nsoExportFormats[] = { "Original", "Decompressed NSO", "ELF" };
+static const char *batchOrderPolicies[] = { "Alphabetical", "Largest titles first", "Alternate source storages", "Fit to free SD card space" };
 
 void uiFill(int x, int y, int width, int height, u8 r, u8 g, u8 b)
 {
@@ -456,6 +468,25 @@ void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...)
     vsnprintf(string, MAX_CHARACTERS(string), fmt, args);
     va_end(args);
     
+    if (capturedMessages)
+    {
+        // The position is discarded: uiFlushMessageLog() draws the messages on the next available lines
+        uiMessageLogEntry *tmpEntries = realloc(capturedMessages->entries, (capturedMessages->count + 1) * sizeof(uiMessageLogEntry));
+        if (!tmpEntries) return;
+        
+        capturedMessages->entries = tmpEntries;
+        
+        uiMessageLogEntry *entry = &(capturedMessages->entries[capturedMessages->count]);
+        entry->r = r;
+        entry->g = g;
+        entry->b = b;
+        entry->str = strdup(string);
+        
+        if (entry->str) capturedMessages->count++;
+        
+        return;
+    }
+    
     u32 tmpx = (x < 8 ? 8 : x);
     u32 tmpy = (font_height + (y < 8 ? 8 : y));
     
@@ -467,6 +498,9 @@ void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...)
     u32 tmpchar;
     ssize_t unitcount = 0;
     
+    // Secondary threads are expected to capture their messages (see uiCaptureMessages()), but keep the framebuffer consistent if one doesn't
+    pthread_mutex_lock(&uiDrawMutex);
+    
     if (framebuf == NULL)
     {
         /* Begin new frame */
@@ -523,6 +557,31 @@ void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...)
         tmpx += (sharedFontsFaces[j]->glyph->advance.x >> 6);
         tmpy += (sharedFontsFaces[j]->glyph->advance.y >> 6);
     }
+    
+    pthread_mutex_unlock(&uiDrawMutex);
+}
+
+void uiCaptureMessages(uiMessageLog *log)
+{
+    capturedMessages = log;
+}
+
+void uiFlushMessageLog(uiMessageLog *log)
+{
+    if (!log) return;
+    
+    u32 i;
+    
+    for(i = 0; i < log->count; i++)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), log->entries[i].r, log->entries[i].g, log->entries[i].b, "%s", log->entries[i].str);
+        breaks++;
+        free(log->entries[i].str);
+    }
+    
+    if (log->entries) free(log->entries);
+    
+    memset(log, 0, sizeof(uiMessageLog));
 }
 
 u32 uiGetStrWidth(const char *fmt, ...)
@@ -992,7 +1051,7 @@ UIResult uiProcess()
     uiPrintHeadline();
     loadTitleInfo();
     
-    if (uiState == stateMainMenu || uiState == stateGameCardMenu || uiState == stateXciDumpMenu || uiState == stateNspDumpMenu || uiState == stateNspAppDumpMenu || uiState == stateNspPatchDumpMenu || uiState == stateNspAddOnDumpMenu || uiState == stateHfs0Menu || uiState == stateRawHfs0PartitionDumpMenu || uiState == stateHfs0PartitionDataDumpMenu || uiState == stateHfs0BrowserMenu || uiState == stateHfs0Browser || uiState == stateExeFsMenu || uiState == stateExeFsSectionDataDumpMenu || uiState == stateExeFsSectionBrowserMenu || uiState == stateExeFsSectionBrowser || uiState == stateRomFsMenu || uiState == stateRomFsSectionDataDumpMenu || uiState == stateRomFsSectionBrowserMenu || uiState == stateRomFsSectionBrowser || uiState == stateSdCardEmmcMenu || uiState == stateSdCardEmmcTitleMenu || uiState == stateSdCardEmmcOrphanPatchAddOnMenu || uiState == stateSdCardEmmcBatchModeMenu || uiState == stateTicketMenu || uiState == stateUpdateMenu)
+    if (uiState == stateMainMenu || uiState == stateGameCardMenu || uiState == stateXciDumpMenu || uiState == stateNspDumpMenu || uiState == stateNspAppDumpMenu || uiState == stateNspPatchDumpMenu || uiState == stateNspAddOnDumpMenu || uiState == stateHfs0Menu || uiState == stateRawHfs0PartitionDumpMenu || uiState == stateHfs0PartitionDataDumpMenu || uiState == stateHfs0BrowserMenu || uiState == stateHfs0Browser || uiState == stateExeFsMenu || uiState == stateExeFsSectionDataDumpMenu || uiState == stateExeFsSectionBrowserMenu || uiState == stateExeFsSectionBrowser || uiState == stateRomFsMenu || uiState == stateRomFsSectionDataDumpMenu || uiState == stateRomFsSectionBrowserMenu || uiState == stateRomFsSectionBrowser || uiState == stateSdCardEmmcMenu || uiState == stateSdCardEmmcTitleMenu || uiState == stateSdCardEmmcOrphanPatchAddOnMenu || uiState == stateSdCardEmmcBatchModeMenu || uiState == stateTicketMenu || uiState == stateBisMenu || uiState == stateUpdateMenu)
     {
         switch(menuType)
         {
@@ -1196,7 +1255,7 @@ UIResult uiProcess()
         }
     }
     
-    if (uiState == stateMainMenu || uiState == stateGameCardMenu || uiState == stateXciDumpMenu || uiState == stateNspDumpMenu || uiState == stateNspAppDumpMenu || uiState == stateNspPatchDumpMenu || uiState == stateNspAddOnDumpMenu || uiState == stateHfs0Menu || uiState == stateRawHfs0PartitionDumpMenu || uiState == stateHfs0PartitionDataDumpMenu || uiState == stateHfs0BrowserMenu || uiState == stateHfs0Browser || uiState == stateExeFsMenu || uiState == stateExeFsSectionDataDumpMenu || uiState == stateExeFsSectionBrowserMenu || uiState == stateExeFsSectionBrowser || uiState == stateRomFsMenu || uiState == stateRomFsSectionDataDumpMenu || uiState == stateRomFsSectionBrowserMenu || uiState == stateRomFsSectionBrowser || uiState == stateSdCardEmmcMenu || uiState == stateSdCardEmmcTitleMenu || uiState == stateSdCardEmmcOrphanPatchAddOnMenu || uiState == stateSdCardEmmcBatchModeMenu || uiState == stateTicketMenu || uiState == stateUpdateMenu)
+    if (uiState == stateMainMenu || uiState == stateGameCardMenu || uiState == stateXciDumpMenu || uiState == stateNspDumpMenu || uiState == stateNspAppDumpMenu || uiState == stateNspPatchDumpMenu || uiState == stateNspAddOnDumpMenu || uiState == stateHfs0Menu || uiState == stateRawHfs0PartitionDumpMenu || uiState == stateHfs0PartitionDataDumpMenu || uiState == stateHfs0BrowserMenu || uiState == stateHfs0Browser || uiState == stateExeFsMenu || uiState == stateExeFsSectionDataDumpMenu || uiState == stateExeFsSectionBrowserMenu || uiState == stateExeFsSectionBrowser || uiState == stateRomFsMenu || uiState == stateRomFsSectionDataDumpMenu || uiState == stateRomFsSectionBrowserMenu || uiState == stateRomFsSectionBrowser || uiState == stateSdCardEmmcMenu || uiState == stateSdCardEmmcTitleMenu || uiState == stateSdCardEmmcOrphanPatchAddOnMenu || uiState == stateSdCardEmmcBatchModeMenu || uiState == stateTicketMenu || uiState == stateBisMenu || uiState == stateUpdateMenu)
     {
         if ((menuType == MENUTYPE_GAMECARD && uiState != stateHfs0Browser && uiState != stateExeFsSectionBrowser && uiState != stateRomFsSectionBrowser) || (menuType == MENUTYPE_SDCARD_EMMC && !orphanMode && uiState != stateSdCardEmmcMenu && uiState != stateSdCardEmmcBatchModeMenu && uiState != stateExeFsSectionBrowser && uiState != stateRomFsSectionBrowser))
         {
@@ -1588,6 +1647,9 @@ UIResult uiProcess()
                 {
                     menu = nspDumpGameCardMenuItems;
                     menuItemsCount = MAX_ELEMENTS(nspDumpGameCardMenuItems);
+                    
+                    // Only display the bundled application selector if the gamecard holds more than one base application
+                    if (titleAppCount <= 1) menuItemsCount--;
                 } else
                 if (menuType == MENUTYPE_SDCARD_EMMC)
                 {
@@ -1679,7 +1741,7 @@ UIResult uiProcess()
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, exeFsMenuItems[1]);
                 breaks++;
                 
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s", exeFsMenuItems[2], (dumpCfg.exeFsDumpCfg.isFat32 ? "Yes" : "No"), exeFsMenuItems[3], (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"));
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s | %s%s", exeFsMenuItems[2], (dumpCfg.exeFsDumpCfg.isFat32 ? "Yes" : "No"), exeFsMenuItems[3], (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"), exeFsMenuItems[4], nsoExportFormats[dumpCfg.exeFsDumpCfg.nsoExportFmt]);
                 breaks++;
                 
                 if (!exeFsUpdateFlag)
@@ -1819,12 +1881,19 @@ UIResult uiProcess()
                 
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, sdCardEmmcMenuItems[3]);
                 
+                break;
+            case stateBisMenu:
+                menu = bisMenuItems;
+                menuItemsCount = MAX_ELEMENTS(bisMenuItems);
+                
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, mainMenuItems[2]);
+                
                 break;
             case stateUpdateMenu:
                 menu = updateMenuItems;
                 menuItemsCount = MAX_ELEMENTS(updateMenuItems);
                 
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, mainMenuItems[2]);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, mainMenuItems[3]);
                 
                 break;
             default:
@@ -1862,7 +1931,8 @@ UIResult uiProcess()
                 
                 // Avoid printing the "Dump bundled update NSP" / "Dump installed update NSP" option in the NSP dump menu if we're dealing with a gamecard and it doesn't include any bundled updates, or if we're dealing with a SD/eMMC title without installed updates
                 // Also avoid printing the "Dump bundled DLC NSP" / "Dump installed DLC NSP" option in the NSP dump menu if we're dealing with a gamecard and it doesn't include any bundled DLCs, or if we're dealing with a SD/eMMC title without installed DLCs
-                if (uiState == stateNspDumpMenu && ((i == 1 && (!titlePatchCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)))) || (i == 2 && (!titleAddOnCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, true))))))
+                // Also avoid printing the "Dump base application + update + DLC NSP bundle" option if neither of them are available
+                if (uiState == stateNspDumpMenu && ((i == 1 && (!titlePatchCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)))) || (i == 2 && (!titleAddOnCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, true)))) || (i == 3 && (!titlePatchCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false))) && (!titleAddOnCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, true))))))
                 {
                     j--;
                     continue;
@@ -1892,7 +1962,7 @@ UIResult uiProcess()
                 }
                 
                 // Avoid printing the "Dump base applications", "Dump updates" and/or "Dump DLCs" options in the batch mode menu if we're dealing with a storage source that doesn't hold any title belonging to the current category
-                if (uiState == stateSdCardEmmcBatchModeMenu && ((dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL && ((!titleAppCount && i == 1) || (!titlePatchCount && i == 2) || (!titleAddOnCount && i == 3))) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD && ((!sdCardTitleAppCount && i == 1) || (!sdCardTitlePatchCount && i == 2) || (!sdCardTitleAddOnCount && i == 3))) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC && ((!emmcTitleAppCount && i == 1) || (!emmcTitlePatchCount && i == 2) || (!emmcTitleAddOnCount && i == 3)))))
+                if (uiState == stateSdCardEmmcBatchModeMenu && i >= 1 && i <= 3 && !getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, (nspDumpType)(i - 1)))
                 {
                     j--;
                     continue;
@@ -1912,8 +1982,8 @@ UIResult uiProcess()
                     continue;
                 }
                 
-                // Avoid printing the "Source storage" option in the batch mode menu if we only have titles available in a single source storage device
-                if (uiState == stateSdCardEmmcBatchModeMenu && i == 13 && ((!sdCardTitleAppCount && !sdCardTitlePatchCount && !sdCardTitleAddOnCount) || (!emmcTitleAppCount && !emmcTitlePatchCount && !emmcTitleAddOnCount)))
+                // Avoid printing the "Source storage" option in the batch mode menu if we only have titles available in a single source storage device (and no local content storage titles)
+                if (uiState == stateSdCardEmmcBatchModeMenu && i == 13 && ((!sdCardTitleAppCount && !sdCardTitlePatchCount && !sdCardTitleAddOnCount) || (!emmcTitleAppCount && !emmcTitlePatchCount && !emmcTitleAddOnCount)) && !localTitleAppCount && !localTitlePatchCount && !localTitleAddOnCount)
                 {
                     j--;
                     continue;
@@ -1921,7 +1991,7 @@ UIResult uiProcess()
                 
                 // Avoid printing the "Use update" option in the ExeFS menu if we're dealing with a gamecard and either its base application count is greater than 1 or it has no available patches
                 // Also avoid printing it if we're dealing with a SD/eMMC title and it has no available patches, or if we're dealing with an orphan Patch
-                if (uiState == stateExeFsMenu && i == 4 && ((menuType == MENUTYPE_GAMECARD && (titleAppCount > 1 || !checkIfBaseApplicationHasPatchOrAddOn(0, false))) || (menuType == MENUTYPE_SDCARD_EMMC && ((!orphanMode && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)) || orphanMode))))
+                if (uiState == stateExeFsMenu && i == 5 && ((menuType == MENUTYPE_GAMECARD && (titleAppCount > 1 || !checkIfBaseApplicationHasPatchOrAddOn(0, false))) || (menuType == MENUTYPE_SDCARD_EMMC && ((!orphanMode && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)) || orphanMode))))
                 {
                     j--;
                     continue;
@@ -2236,9 +2306,16 @@ UIResult uiProcess()
                             break;
                         case 13: // Source storage
                             leftArrowCondition = (dumpCfg.batchDumpCfg.batchModeSrc != BATCH_SOURCE_ALL);
-                            rightArrowCondition = (dumpCfg.batchDumpCfg.batchModeSrc != BATCH_SOURCE_EMMC);                            
+                            rightArrowCondition = (dumpCfg.batchDumpCfg.batchModeSrc < BATCH_SOURCE_EMMC || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC && (localTitleAppCount || localTitlePatchCount || localTitleAddOnCount)));
+                            
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL ? "All (SD card + eMMC)" : (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD ? "SD card" : (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC ? "eMMC" : "Local content storage"))));
+                            
+                            break;
+                        case 14: // Dump order
+                            leftArrowCondition = (dumpCfg.batchDumpCfg.batchOrder != BATCH_ORDER_NAME);
+                            rightArrowCondition = (dumpCfg.batchDumpCfg.batchOrder != BATCH_ORDER_FIT_FREE_SPACE);
                             
-                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL ? "All (SD card + eMMC)" : (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD ? "SD card" : "eMMC")));
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, batchOrderPolicies[dumpCfg.batchDumpCfg.batchOrder]);
                             
                             break;
                         default:
@@ -2259,7 +2336,14 @@ UIResult uiProcess()
                         case 3: // Save data to CFW directory (LayeredFS)
                             uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.exeFsDumpCfg.useLayeredFSDir, !dumpCfg.exeFsDumpCfg.useLayeredFSDir, (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? 0 : 255), (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? 255 : 0), 0, (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"));
                             break;
-                        case 4: // Use update
+                        case 4: // NSO export format
+                            leftArrowCondition = (dumpCfg.exeFsDumpCfg.nsoExportFmt != NSO_EXPORT_ORIGINAL);
+                            rightArrowCondition = (dumpCfg.exeFsDumpCfg.nsoExportFmt != NSO_EXPORT_ELF);
+                            
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, nsoExportFormats[dumpCfg.exeFsDumpCfg.nsoExportFmt]);
+                            
+                            break;
+                        case 5: // Use update
                             if (exeFsUpdateFlag)
                             {
                                 if (!strlen(exeFsAndRomFsSelectorStr))
@@ -2269,7 +2353,7 @@ UIResult uiProcess()
                                     retrieveDescriptionForPatchOrAddOn(selectedPatchIndex, false, (menuType == MENUTYPE_GAMECARD && titleAppCount > 1), NULL, exeFsAndRomFsSelectorStr, MAX_CHARACTERS(exeFsAndRomFsSelectorStr));
                                     
                                     // Concatenate patch source storage
-                                    strcat(exeFsAndRomFsSelectorStr, (patchEntries[selectedPatchIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (patchEntries[selectedPatchIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : " (eMMC)")));
+                                    strcat(exeFsAndRomFsSelectorStr, (patchEntries[selectedPatchIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (patchEntries[selectedPatchIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : (patchEntries[selectedPatchIndex].storageId == LOCAL_CONTENT_STORAGE_ID ? " (local storage)" : " (eMMC)"))));
                                     
                                     uiTruncateOptionStr(exeFsAndRomFsSelectorStr, xpos, ypos, OPTIONS_X_END_POS_NSP);
                                 }
@@ -2291,6 +2375,22 @@ UIResult uiProcess()
                     }
                 }
                 
+                // Print the bundled application selector in the gamecard NSP dump menu
+                if (uiState == stateNspDumpMenu && menuType == MENUTYPE_GAMECARD && i == 4)
+                {
+                    if (!strlen(titleSelectorStr))
+                    {
+                        // Print application name
+                        snprintf(titleSelectorStr, MAX_CHARACTERS(titleSelectorStr), "%s v%s", baseAppEntries[selectedAppIndex].name, baseAppEntries[selectedAppIndex].versionStr);
+                        uiTruncateOptionStr(titleSelectorStr, xpos, ypos, OPTIONS_X_END_POS_NSP);
+                    }
+                    
+                    leftArrowCondition = (selectedAppIndex > 0);
+                    rightArrowCondition = (selectedAppIndex < (titleAppCount - 1));
+                    
+                    uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, titleSelectorStr);
+                }
+                
                 // Print settings values for ExeFS submenus
                 if ((uiState == stateExeFsSectionDataDumpMenu || uiState == stateExeFsSectionBrowserMenu) && i > 0)
                 {
@@ -2320,7 +2420,7 @@ UIResult uiProcess()
                                     retrieveDescriptionForPatchOrAddOn(selectedPatchIndex, false, (menuType == MENUTYPE_GAMECARD), NULL, exeFsAndRomFsSelectorStr, MAX_CHARACTERS(exeFsAndRomFsSelectorStr));
                                     
                                     // Concatenate patch source storage
-                                    strcat(exeFsAndRomFsSelectorStr, (patchEntries[selectedPatchIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (patchEntries[selectedPatchIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : " (eMMC)")));
+                                    strcat(exeFsAndRomFsSelectorStr, (patchEntries[selectedPatchIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (patchEntries[selectedPatchIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : (patchEntries[selectedPatchIndex].storageId == LOCAL_CONTENT_STORAGE_ID ? " (local storage)" : " (eMMC)"))));
                                     
                                     uiTruncateOptionStr(exeFsAndRomFsSelectorStr, xpos, ypos, OPTIONS_X_END_POS_NSP);
                                 }
@@ -2369,12 +2469,12 @@ UIResult uiProcess()
                                         case ROMFS_TYPE_PATCH:
                                             retrieveDescriptionForPatchOrAddOn(selectedPatchIndex, false, (menuType == MENUTYPE_GAMECARD && titleAppCount > 1), NULL, exeFsAndRomFsSelectorStr, MAX_CHARACTERS(exeFsAndRomFsSelectorStr));
                                             strcat(exeFsAndRomFsSelectorStr, " (UPD)");
-                                            strcat(exeFsAndRomFsSelectorStr, (patchEntries[selectedPatchIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (patchEntries[selectedPatchIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : " (eMMC)")));
+                                            strcat(exeFsAndRomFsSelectorStr, (patchEntries[selectedPatchIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (patchEntries[selectedPatchIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : (patchEntries[selectedPatchIndex].storageId == LOCAL_CONTENT_STORAGE_ID ? " (local storage)" : " (eMMC)"))));
                                             break;
                                         case ROMFS_TYPE_ADDON:
                                             retrieveDescriptionForPatchOrAddOn(selectedAddOnIndex, true, (menuType == MENUTYPE_GAMECARD && titleAppCount > 1), NULL, exeFsAndRomFsSelectorStr, MAX_CHARACTERS(exeFsAndRomFsSelectorStr));
                                             strcat(exeFsAndRomFsSelectorStr, " (DLC)");
-                                            strcat(exeFsAndRomFsSelectorStr, (addOnEntries[selectedAddOnIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (addOnEntries[selectedAddOnIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : " (eMMC)")));
+                                            strcat(exeFsAndRomFsSelectorStr, (addOnEntries[selectedAddOnIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (addOnEntries[selectedAddOnIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : (addOnEntries[selectedAddOnIndex].storageId == LOCAL_CONTENT_STORAGE_ID ? " (local storage)" : " (eMMC)"))));
                                             break;
                                         default:
                                             break;
@@ -2433,12 +2533,12 @@ UIResult uiProcess()
                                         case ROMFS_TYPE_PATCH:
                                             retrieveDescriptionForPatchOrAddOn(selectedPatchIndex, false, (menuType == MENUTYPE_GAMECARD), NULL, exeFsAndRomFsSelectorStr, MAX_CHARACTERS(exeFsAndRomFsSelectorStr));
                                             strcat(exeFsAndRomFsSelectorStr, " (UPD)");
-                                            strcat(exeFsAndRomFsSelectorStr, (patchEntries[selectedPatchIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (patchEntries[selectedPatchIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : " (eMMC)")));
+                                            strcat(exeFsAndRomFsSelectorStr, (patchEntries[selectedPatchIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (patchEntries[selectedPatchIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : (patchEntries[selectedPatchIndex].storageId == LOCAL_CONTENT_STORAGE_ID ? " (local storage)" : " (eMMC)"))));
                                             break;
                                         case ROMFS_TYPE_ADDON:
                                             retrieveDescriptionForPatchOrAddOn(selectedAddOnIndex, true, (menuType == MENUTYPE_GAMECARD), NULL, exeFsAndRomFsSelectorStr, MAX_CHARACTERS(exeFsAndRomFsSelectorStr));
                                             strcat(exeFsAndRomFsSelectorStr, " (DLC)");
-                                            strcat(exeFsAndRomFsSelectorStr, (addOnEntries[selectedAddOnIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (addOnEntries[selectedAddOnIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : " (eMMC)")));
+                                            strcat(exeFsAndRomFsSelectorStr, (addOnEntries[selectedAddOnIndex].storageId == NcmStorageId_GameCard ? " (gamecard)" : (addOnEntries[selectedAddOnIndex].storageId == NcmStorageId_SdCard ? " (SD card)" : (addOnEntries[selectedAddOnIndex].storageId == LOCAL_CONTENT_STORAGE_ID ? " (local storage)" : " (eMMC)"))));
                                             break;
                                         default:
                                             break;
@@ -2517,6 +2617,28 @@ UIResult uiProcess()
                     }
                 }
                 
+                // Print settings values for the BIS partition menu
+                if (uiState == stateBisMenu && i > 0)
+                {
+                    switch(i)
+                    {
+                        case 1: // BIS partition
+                            leftArrowCondition = (curBisPartition != BIS_PARTITION_PRODINFO);
+                            rightArrowCondition = (curBisPartition != BIS_PARTITION_USER);
+                            
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, BIS_PARTITION_NAME(curBisPartition));
+                            break;
+                        case 2: // Split output dump (FAT32 support)
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.bisDumpCfg.isFat32, !dumpCfg.bisDumpCfg.isFat32, (dumpCfg.bisDumpCfg.isFat32 ? 0 : 255), (dumpCfg.bisDumpCfg.isFat32 ? 255 : 0), 0, (dumpCfg.bisDumpCfg.isFat32 ? "Yes" : "No"));
+                            break;
+                        case 3: // Skip unallocated FAT clusters
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.bisDumpCfg.skipFreeClusters, !dumpCfg.bisDumpCfg.skipFreeClusters, (dumpCfg.bisDumpCfg.skipFreeClusters ? 0 : 255), (dumpCfg.bisDumpCfg.skipFreeClusters ? 255 : 0), 0, (dumpCfg.bisDumpCfg.skipFreeClusters ? "Yes" : "No"));
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                
                 if (i == cursor) highlight = false;
             }
             
@@ -2590,6 +2712,21 @@ UIResult uiProcess()
                 uiDrawString(STRING_X_POS, ypos, FONT_COLOR_RGB, "Enabling this option will save output data to \"%s[TitleID]/%s/\" (LayeredFS directory structure).", strchr(cfwDirStr, '/'), (uiState == stateExeFsMenu ? "exefs" : "romfs"));
             }
             
+            // Print information about the "NSO export format" option
+            if (uiState == stateExeFsMenu && cursor == 4)
+            {
+                uiDrawString(STRING_X_POS, ypos, FONT_COLOR_RGB, "Decompresses NSO executables while dumping. They can be saved as uncompressed NSOs or converted to minimal ELF images.");
+            }
+            
+            // Print information about the "Skip unallocated FAT clusters" option
+            if (uiState == stateBisMenu && cursor == 3)
+            {
+                uiDrawString(STRING_X_POS, ypos, FONT_COLOR_RGB, "Unallocated clusters from the SAFE, SYSTEM and USER partitions are written as zeroes instead of being read from the eMMC.");
+                ypos += (LINE_HEIGHT + LINE_STRING_OFFSET);
+                
+                uiDrawString(STRING_X_POS, ypos, FONT_COLOR_RGB, "The output image keeps its full size and can still be mounted, but deleted data can't be recovered from it.");
+            }
+            
             // Print hint about dumping RomFS content from DLCs
             if ((uiState == stateRomFsMenu && cursor == 4 && ((menuType == MENUTYPE_GAMECARD && titleAppCount <= 1 && checkIfBaseApplicationHasPatchOrAddOn(0, true)) || (menuType == MENUTYPE_SDCARD_EMMC && !orphanMode && checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, true)))) || ((uiState == stateRomFsSectionDataDumpMenu || uiState == stateRomFsSectionBrowserMenu) && cursor == 2 && (menuType == MENUTYPE_GAMECARD && titleAppCount > 1 && checkIfBaseApplicationHasPatchOrAddOn(selectedAppIndex, true))))
             {
@@ -3058,26 +3195,14 @@ UIResult uiProcess()
                             {
                                 dumpCfg.batchDumpCfg.batchModeSrc--;
                                 
-                                if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL)
-                                {
-                                    dumpCfg.batchDumpCfg.dumpAppTitles = (titleAppCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpPatchTitles = (titlePatchCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpAddOnTitles = (titleAddOnCount > 0);
-                                } else
-                                if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD)
-                                {
-                                    dumpCfg.batchDumpCfg.dumpAppTitles = (sdCardTitleAppCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpPatchTitles = (sdCardTitlePatchCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpAddOnTitles = (sdCardTitleAddOnCount > 0);
-                                } else
-                                if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC)
-                                {
-                                    dumpCfg.batchDumpCfg.dumpAppTitles = (emmcTitleAppCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpPatchTitles = (emmcTitlePatchCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpAddOnTitles = (emmcTitleAddOnCount > 0);
-                                }
+                                dumpCfg.batchDumpCfg.dumpAppTitles = (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_APP_NSP) > 0);
+                                dumpCfg.batchDumpCfg.dumpPatchTitles = (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_PATCH_NSP) > 0);
+                                dumpCfg.batchDumpCfg.dumpAddOnTitles = (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_ADDON_NSP) > 0);
                             }
                             break;
+                        case 14: // Dump order
+                            if (dumpCfg.batchDumpCfg.batchOrder != BATCH_ORDER_NAME) dumpCfg.batchDumpCfg.batchOrder--;
+                            break;
                         default:
                             break;
                     }
@@ -3128,30 +3253,18 @@ UIResult uiProcess()
                             dumpCfg.batchDumpCfg.useBrackets = true;
                             break;
                         case 13: // Source storage
-                            if (dumpCfg.batchDumpCfg.batchModeSrc != BATCH_SOURCE_EMMC)
+                            if (dumpCfg.batchDumpCfg.batchModeSrc < BATCH_SOURCE_EMMC || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC && (localTitleAppCount || localTitlePatchCount || localTitleAddOnCount)))
                             {
                                 dumpCfg.batchDumpCfg.batchModeSrc++;
                                 
-                                if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL)
-                                {
-                                    dumpCfg.batchDumpCfg.dumpAppTitles = (titleAppCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpPatchTitles = (titlePatchCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpAddOnTitles = (titleAddOnCount > 0);
-                                } else
-                                if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD)
-                                {
-                                    dumpCfg.batchDumpCfg.dumpAppTitles = (sdCardTitleAppCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpPatchTitles = (sdCardTitlePatchCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpAddOnTitles = (sdCardTitleAddOnCount > 0);
-                                } else
-                                if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC)
-                                {
-                                    dumpCfg.batchDumpCfg.dumpAppTitles = (emmcTitleAppCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpPatchTitles = (emmcTitlePatchCount > 0);
-                                    dumpCfg.batchDumpCfg.dumpAddOnTitles = (emmcTitleAddOnCount > 0);
-                                }
+                                dumpCfg.batchDumpCfg.dumpAppTitles = (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_APP_NSP) > 0);
+                                dumpCfg.batchDumpCfg.dumpPatchTitles = (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_PATCH_NSP) > 0);
+                                dumpCfg.batchDumpCfg.dumpAddOnTitles = (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_ADDON_NSP) > 0);
                             }
                             break;
+                        case 14: // Dump order
+                            if (dumpCfg.batchDumpCfg.batchOrder != BATCH_ORDER_FIT_FREE_SPACE) dumpCfg.batchDumpCfg.batchOrder++;
+                            break;
                         default:
                             break;
                     }
@@ -3218,7 +3331,10 @@ UIResult uiProcess()
                         case 3: // Save data to CFW directory (LayeredFS)
                             dumpCfg.exeFsDumpCfg.useLayeredFSDir = false;
                             break;
-                        case 4: // Use update
+                        case 4: // NSO export format
+                            if (dumpCfg.exeFsDumpCfg.nsoExportFmt != NSO_EXPORT_ORIGINAL) dumpCfg.exeFsDumpCfg.nsoExportFmt--;
+                            break;
+                        case 5: // Use update
                             if ((menuType == MENUTYPE_GAMECARD && titleAppCount == 1 && checkIfBaseApplicationHasPatchOrAddOn(0, false)) || (menuType == MENUTYPE_SDCARD_EMMC && checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)))
                             {
                                 if (exeFsUpdateFlag)
@@ -3252,7 +3368,10 @@ UIResult uiProcess()
                         case 3: // Save data to CFW directory (LayeredFS)
                             dumpCfg.exeFsDumpCfg.useLayeredFSDir = true;
                             break;
-                        case 4: // Use update
+                        case 4: // NSO export format
+                            if (dumpCfg.exeFsDumpCfg.nsoExportFmt != NSO_EXPORT_ELF) dumpCfg.exeFsDumpCfg.nsoExportFmt++;
+                            break;
+                        case 5: // Use update
                             if ((menuType == MENUTYPE_GAMECARD && titleAppCount == 1 && checkIfBaseApplicationHasPatchOrAddOn(0, false)) || (menuType == MENUTYPE_SDCARD_EMMC && checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)))
                             {
                                 u32 appIndex = (menuType == MENUTYPE_GAMECARD ? 0 : selectedAppInfoIndex);
@@ -3699,6 +3818,8 @@ UIResult uiProcess()
                 // Select
                 if ((keysDown & HidNpadButton_A) && cursor == 0) res = resultDumpTicket;
                 
+                if ((keysDown & HidNpadButton_A) && cursor == 3) res = resultDumpAllTickets;
+                
                 // Back
                 if (keysDown & HidNpadButton_B) res = resultShowSdCardEmmcTitleMenu;
                 
@@ -3817,6 +3938,74 @@ UIResult uiProcess()
                     scrollWithKeysDown = ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp));
                 }
                 
+                // Go down
+                if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown) || (keysHeld & HidNpadButton_StickRDown))
+                {
+                    scrollAmount = 1;
+                    scrollWithKeysDown = ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown));
+                }
+            } else
+            if (uiState == stateBisMenu)
+            {
+                // Select
+                if ((keysDown & HidNpadButton_A) && cursor == 0) res = resultDumpBisPartition;
+                
+                // Back
+                if (keysDown & HidNpadButton_B)
+                {
+                    res = resultShowMainMenu;
+                    menuType = MENUTYPE_MAIN;
+                }
+                
+                // Go left
+                if (keysDown & HidNpadButton_AnyLeft)
+                {
+                    switch(cursor)
+                    {
+                        case 1: // BIS partition
+                            if (curBisPartition != BIS_PARTITION_PRODINFO) curBisPartition--;
+                            break;
+                        case 2: // Split output dump (FAT32 support)
+                            dumpCfg.bisDumpCfg.isFat32 = false;
+                            saveConfig();
+                            break;
+                        case 3: // Skip unallocated FAT clusters
+                            dumpCfg.bisDumpCfg.skipFreeClusters = false;
+                            saveConfig();
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                
+                // Go right
+                if (keysDown & HidNpadButton_AnyRight)
+                {
+                    switch(cursor)
+                    {
+                        case 1: // BIS partition
+                            if (curBisPartition != BIS_PARTITION_USER) curBisPartition++;
+                            break;
+                        case 2: // Split output dump (FAT32 support)
+                            dumpCfg.bisDumpCfg.isFat32 = true;
+                            saveConfig();
+                            break;
+                        case 3: // Skip unallocated FAT clusters
+                            dumpCfg.bisDumpCfg.skipFreeClusters = true;
+                            saveConfig();
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                
+                // Go up
+                if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp) || (keysHeld & HidNpadButton_StickRUp))
+                {
+                    scrollAmount = -1;
+                    scrollWithKeysDown = ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp));
+                }
+                
                 // Go down
                 if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown) || (keysHeld & HidNpadButton_StickRDown))
                 {
@@ -3847,6 +4036,9 @@ UIResult uiProcess()
                                 }
                                 break;
                             case 2:
+                                res = resultShowBisMenu;
+                                break;
+                            case 3:
                                 res = resultShowUpdateMenu;
                                 break;
                             default:
@@ -3863,15 +4055,10 @@ UIResult uiProcess()
                             case 1:
                                 if (keysFileAvailable)
                                 {
-                                    if (!titlePatchCount && !titleAddOnCount)
-                                    {
-                                        res = resultShowNspAppDumpMenu;
-                                        
-                                        // Reset option to its default value
-                                        selectedAppIndex = 0;
-                                    } else {
-                                        res = resultShowNspDumpMenu;
-                                    }
+                                    // Reset option to its default value
+                                    selectedAppIndex = 0;
+                                    
+                                    res = ((!titlePatchCount && !titleAddOnCount) ? resultShowNspAppDumpMenu : resultShowNspDumpMenu);
                                 } else {
                                     uiStatusMsg("Keys file unavailable at \"%s\". Option disabled.", KEYS_FILE_PATH);
                                 }
@@ -3917,6 +4104,9 @@ UIResult uiProcess()
                     } else
                     if (uiState == stateNspDumpMenu)
                     {
+                        // The bundled application selector is only available in the gamecard NSP dump menu
+                        u32 bundleAppIndex = (menuType == MENUTYPE_SDCARD_EMMC ? selectedAppInfoIndex : selectedAppIndex);
+                        
                         // Reset options to their default values
                         selectedAppIndex = 0;
                         selectedPatchIndex = 0;
@@ -3936,6 +4126,13 @@ UIResult uiProcess()
                                 res = resultShowNspAddOnDumpMenu;
                                 if (menuType == MENUTYPE_SDCARD_EMMC) selectedAddOnIndex = retrieveFirstPatchOrAddOnIndexFromBaseApplication(selectedAppInfoIndex, true);
                                 break;
+                            case 3:
+                                res = resultDumpNspBundle;
+                                selectedAppIndex = bundleAppIndex;
+                                break;
+                            case 4: // Base application to bundle
+                                selectedAppIndex = bundleAppIndex;
+                                break;
                             default:
                                 break;
                         }
@@ -4101,6 +4298,9 @@ UIResult uiProcess()
                                     uiStatusMsg("Update already performed. Please restart the application.");
                                 }
                                 break;
+                            case 2:
+                                res = resultCalibrateTransferChunkSizes;
+                                break;
                             default:
                                 break;
                         }
@@ -4194,16 +4394,41 @@ UIResult uiProcess()
                         // Batch mode
                         res = resultShowSdCardEmmcBatchModeMenu;
                         
+                        // The local content storage may be gone since the last time it was selected
+                        if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_LOCAL && !localTitleAppCount && !localTitlePatchCount && !localTitleAddOnCount)
+                        {
+                            dumpCfg.batchDumpCfg.batchModeSrc = BATCH_SOURCE_ALL;
+                            dumpCfg.batchDumpCfg.dumpAppTitles = dumpCfg.batchDumpCfg.dumpPatchTitles = dumpCfg.batchDumpCfg.dumpAddOnTitles = false;
+                        }
+                        
                         // Check if we're using the default configuration
                         if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL && !dumpCfg.batchDumpCfg.dumpAppTitles && !dumpCfg.batchDumpCfg.dumpPatchTitles && !dumpCfg.batchDumpCfg.dumpAddOnTitles)
                         {
-                            dumpCfg.batchDumpCfg.dumpAppTitles = (titleAppCount > 0);
-                            dumpCfg.batchDumpCfg.dumpPatchTitles = (titlePatchCount > 0);
-                            dumpCfg.batchDumpCfg.dumpAddOnTitles = (titleAddOnCount > 0);
+                            dumpCfg.batchDumpCfg.dumpAppTitles = (getBatchModeSourceTitleCount(BATCH_SOURCE_ALL, DUMP_APP_NSP) > 0);
+                            dumpCfg.batchDumpCfg.dumpPatchTitles = (getBatchModeSourceTitleCount(BATCH_SOURCE_ALL, DUMP_PATCH_NSP) > 0);
+                            dumpCfg.batchDumpCfg.dumpAddOnTitles = (getBatchModeSourceTitleCount(BATCH_SOURCE_ALL, DUMP_ADDON_NSP) > 0);
                         }
                     }
                 }
                 
+                // Bundled application selector in the gamecard NSP dump menu
+                bool bundleAppSelector = (uiState == stateNspDumpMenu && menuType == MENUTYPE_GAMECARD && titleAppCount > 1 && cursor == 4);
+                
+                if (bundleAppSelector)
+                {
+                    if ((keysDown & HidNpadButton_AnyLeft) && selectedAppIndex > 0)
+                    {
+                        selectedAppIndex--;
+                        titleSelectorStr[0] = '\0';
+                    }
+                    
+                    if ((keysDown & HidNpadButton_AnyRight) && selectedAppIndex < (titleAppCount - 1))
+                    {
+                        selectedAppIndex++;
+                        titleSelectorStr[0] = '\0';
+                    }
+                }
+                
                 if (menu && menuItemsCount)
                 {
                     // Go up
@@ -4213,7 +4438,7 @@ UIResult uiProcess()
                         scrollWithKeysDown = ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp));
                     }
                     
-                    if ((keysDown & HidNpadButton_Left) || (keysDown & HidNpadButton_StickLLeft) || (keysHeld & HidNpadButton_StickRLeft)) scrollAmount = -5;
+                    if (!bundleAppSelector && ((keysDown & HidNpadButton_Left) || (keysDown & HidNpadButton_StickLLeft) || (keysHeld & HidNpadButton_StickRLeft))) scrollAmount = -5;
                     
                     // Go down
                     if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown) || (keysHeld & HidNpadButton_StickRDown))
@@ -4222,7 +4447,7 @@ UIResult uiProcess()
                         scrollWithKeysDown = ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown));
                     }
                     
-                    if ((keysDown & HidNpadButton_Right) || (keysDown & HidNpadButton_StickLRight) || (keysHeld & HidNpadButton_StickRRight)) scrollAmount = 5;
+                    if (!bundleAppSelector && ((keysDown & HidNpadButton_Right) || (keysDown & HidNpadButton_StickLRight) || (keysHeld & HidNpadButton_StickRRight))) scrollAmount = 5;
                 }
             }
             
@@ -4289,40 +4514,37 @@ UIResult uiProcess()
                 
                 // Avoid placing the cursor on the "Dump bundled update NSP" / "Dump installed update NSP" option in the NSP dump menu if we're dealing with a gamecard and it doesn't include any bundled updates, or if we're dealing with a SD/eMMC title without installed updates
                 // Also avoid placing the cursor on the "Dump bundled DLC NSP" / "Dump installed DLC NSP" option in the NSP dump menu if we're dealing with a gamecard and it doesn't include any bundled DLCs, or if we're dealing with a SD/eMMC title without installed DLCs
-                if (uiState == stateNspDumpMenu && ((cursor == 1 && (!titlePatchCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)))) || (cursor == 2 && (!titleAddOnCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, true))))))
+                // Also avoid placing the cursor on the "Dump base application + update + DLC NSP bundle" option if neither of them are available
+                if (uiState == stateNspDumpMenu && cursor > 0)
                 {
-                    if (cursor == 1)
+                    bool noPatch = (!titlePatchCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)));
+                    bool noAddOn = (!titleAddOnCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, true)));
+                    
+                    if (noPatch && noAddOn)
+                    {
+                        // Just in case
+                        cursor = 0;
+                    } else
+                    if (cursor == 1 && noPatch)
                     {
-                        if ((!titleAddOnCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, true))))
+                        if (scrollAmount > 0)
+                        {
+                            cursor = 2;
+                        } else
+                        if (scrollAmount < 0)
                         {
-                            // Just in case
                             cursor = 0;
-                        } else {
-                            if (scrollAmount > 0)
-                            {
-                                cursor = 2;
-                            } else
-                            if (scrollAmount < 0)
-                            {
-                                cursor = 0;
-                            }
                         }
                     } else
-                    if (cursor == 2)
+                    if (cursor == 2 && noAddOn)
                     {
-                        if (!titlePatchCount || (menuType == MENUTYPE_SDCARD_EMMC && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)))
+                        if (scrollAmount > 0)
                         {
-                            // Just in case
-                            cursor = 0;
-                        } else {
-                            if (scrollAmount > 0)
-                            {
-                                cursor = (scrollWithKeysDown ? 0 : 1);
-                            } else
-                            if (scrollAmount < 0)
-                            {
-                                cursor = 1;
-                            }
+                            cursor = 3;
+                        } else
+                        if (scrollAmount < 0)
+                        {
+                            cursor = 1;
                         }
                     }
                 }
@@ -4369,84 +4591,15 @@ UIResult uiProcess()
                 }
                 
                 // Avoid placing the cursor on the "Dump base applications", "Dump updates" and/or "Dump DLCs" options in the batch mode menu if we're dealing with a storage source that doesn't hold any title belonging to the current category
-                if (uiState == stateSdCardEmmcBatchModeMenu && ((dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL && ((!titleAppCount && cursor == 1) || (!titlePatchCount && cursor == 2) || (!titleAddOnCount && cursor == 3))) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD && ((!sdCardTitleAppCount && cursor == 1) || (!sdCardTitlePatchCount && cursor == 2) || (!sdCardTitleAddOnCount && cursor == 3))) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC && ((!emmcTitleAppCount && cursor == 1) || (!emmcTitlePatchCount && cursor == 2) || (!emmcTitleAddOnCount && cursor == 3)))))
+                if (uiState == stateSdCardEmmcBatchModeMenu && cursor >= 1 && cursor <= 3 && !getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, (nspDumpType)(cursor - 1)))
                 {
-                    if (cursor == 1)
-                    {
-                        if (scrollAmount > 0)
-                        {
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL)
-                            {
-                                cursor = (titlePatchCount ? 2 : (titleAddOnCount ? 3 : 4));
-                            } else
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD)
-                            {
-                                cursor = (sdCardTitlePatchCount ? 2 : (sdCardTitleAddOnCount ? 3 : 4));
-                            } else
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC)
-                            {
-                                cursor = (emmcTitlePatchCount ? 2 : (emmcTitleAddOnCount ? 3 : 4));
-                            }
-                        } else
-                        if (scrollAmount < 0)
-                        {
-                            cursor = 0;
-                        }
-                    } else
-                    if (cursor == 2)
+                    if (scrollAmount > 0)
                     {
-                        if (scrollAmount > 0)
-                        {
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL)
-                            {
-                                cursor = (titleAddOnCount ? 3 : 4);
-                            } else
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD)
-                            {
-                                cursor = (sdCardTitleAddOnCount ? 3 : 4);
-                            } else
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC)
-                            {
-                                cursor = (emmcTitleAddOnCount ? 3 : 4);
-                            }
-                        } else
-                        if (scrollAmount < 0)
-                        {
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL)
-                            {
-                                cursor = (titleAppCount ? 1 : 0);
-                            } else
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD)
-                            {
-                                cursor = (sdCardTitleAppCount ? 1 : 0);
-                            } else
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC)
-                            {
-                                cursor = (emmcTitleAppCount ? 1 : 0);
-                            }
-                        }
+                        while(cursor <= 3 && !getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, (nspDumpType)(cursor - 1))) cursor++;
                     } else
-                    if (cursor == 3)
+                    if (scrollAmount < 0)
                     {
-                        if (scrollAmount > 0)
-                        {
-                            cursor = 4;
-                        } else
-                        if (scrollAmount < 0)
-                        {
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL)
-                            {
-                                cursor = (titlePatchCount ? 2 : (titleAppCount ? 1 : 0));
-                            } else
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD)
-                            {
-                                cursor = (sdCardTitlePatchCount ? 2 : (sdCardTitleAppCount ? 1 : 0));
-                            } else
-                            if (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC)
-                            {
-                                cursor = (emmcTitlePatchCount ? 2 : (emmcTitleAppCount ? 1 : 0));
-                            }
-                        }
+                        while(cursor >= 1 && !getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, (nspDumpType)(cursor - 1))) cursor--;
                     }
                 }
                 
@@ -4476,12 +4629,12 @@ UIResult uiProcess()
                     }
                 }
                 
-                // Avoid placing the cursor on the "Source storage" option in the batch mode menu if we only have titles available in a single source storage device
-                if (uiState == stateSdCardEmmcBatchModeMenu && cursor == 13 && ((!sdCardTitleAppCount && !sdCardTitlePatchCount && !sdCardTitleAddOnCount) || (!emmcTitleAppCount && !emmcTitlePatchCount && !emmcTitleAddOnCount)))
+                // Avoid placing the cursor on the "Source storage" option in the batch mode menu if we only have titles available in a single source storage device (and no local content storage titles)
+                if (uiState == stateSdCardEmmcBatchModeMenu && cursor == 13 && ((!sdCardTitleAppCount && !sdCardTitlePatchCount && !sdCardTitleAddOnCount) || (!emmcTitleAppCount && !emmcTitlePatchCount && !emmcTitleAddOnCount)) && !localTitleAppCount && !localTitlePatchCount && !localTitleAddOnCount)
                 {
                     if (scrollAmount > 0)
                     {
-                        cursor = (scrollWithKeysDown ? 0 : 12);
+                        cursor++;
                     } else
                     if (scrollAmount < 0)
                     {
@@ -4491,15 +4644,15 @@ UIResult uiProcess()
                 
                 // Avoid placing the cursor on the "Use update" option in the ExeFS menu if we're dealing with a gamecard and either its base application count is greater than 1 or it has no available patches
                 // Also avoid placing the cursor on it if we're dealing with a SD/eMMC title and it has no available patches, or if we're dealing with an orphan Patch
-                if (uiState == stateExeFsMenu && cursor == 4 && ((menuType == MENUTYPE_GAMECARD && (titleAppCount > 1 || !checkIfBaseApplicationHasPatchOrAddOn(0, false))) || (menuType == MENUTYPE_SDCARD_EMMC && ((!orphanMode && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)) || orphanMode))))
+                if (uiState == stateExeFsMenu && cursor == 5 && ((menuType == MENUTYPE_GAMECARD && (titleAppCount > 1 || !checkIfBaseApplicationHasPatchOrAddOn(0, false))) || (menuType == MENUTYPE_SDCARD_EMMC && ((!orphanMode && !checkIfBaseApplicationHasPatchOrAddOn(selectedAppInfoIndex, false)) || orphanMode))))
                 {
                     if (scrollAmount > 0)
                     {
-                        cursor = (scrollWithKeysDown ? 0 : 1);
+                        cursor = (scrollWithKeysDown ? 0 : 4);
                     } else
                     if (scrollAmount < 0)
                     {
-                        cursor = (scrollWithKeysDown ? 1 : 0);
+                        cursor--;
                     }
                 }
                 
@@ -4562,11 +4715,11 @@ UIResult uiProcess()
                 {
                     if (scrollAmount > 0)
                     {
-                        cursor = (scrollWithKeysDown ? 0 : 1);
+                        cursor++;
                     } else
                     if (scrollAmount < 0)
                     {
-                        cursor = (scrollWithKeysDown ? 1 : 0);
+                        cursor--;
                     }
                 }
             }
@@ -4707,6 +4860,44 @@ UIResult uiProcess()
         
         dumpedContentInfoStr[0] = '\0';
     } else
+    if (uiState == stateDumpNspBundle)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, (menuType == MENUTYPE_GAMECARD ? nspDumpGameCardMenuItems[3] : nspDumpSdCardEmmcMenuItems[3]));
+        breaks++;
+        
+        // The options from the base application NSP dump menu are used for all the bundled titles
+        menu = nspAppDumpMenuItems;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", menu[1], (dumpCfg.nspDumpCfg.isFat32 ? "Yes" : "No"));
+        breaks++;
+        
+        if (menuType == MENUTYPE_SDCARD_EMMC)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s", menu[3], (dumpCfg.nspDumpCfg.removeConsoleData ? "Yes" : "No"), menu[4], (dumpCfg.nspDumpCfg.removeConsoleData && dumpCfg.nspDumpCfg.tiklessDump ? "Yes" : "No"));
+            breaks++;
+        }
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s", menu[5], (dumpCfg.nspDumpCfg.npdmAcidRsaPatch ? "Yes" : "No"), nspPatchDumpMenuItems[6], (dumpCfg.nspDumpCfg.dumpDeltaFragments ? "Yes" : "No"));
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s v%s", menu[6], baseAppEntries[selectedAppIndex].name, baseAppEntries[selectedAppIndex].versionStr);
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", menu[7], (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
+        breaks += 2;
+        
+        uiRefreshDisplay();
+        
+        dumpNintendoSubmissionPackageBundle(selectedAppIndex, &(dumpCfg.nspDumpCfg));
+        
+        waitForButtonPress();
+        
+        updateFreeSpace();
+        
+        res = resultShowNspDumpMenu;
+        
+        dumpedContentInfoStr[0] = '\0';
+    } else
     if (uiState == stateSdCardEmmcBatchDump)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "Batch dump");
@@ -4717,20 +4908,20 @@ UIResult uiProcess()
         char tmp[128] = {'\0'};
         strbuf[0] = '\0';
         
-        if ((dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL && titleAppCount) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD && sdCardTitleAppCount) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC && emmcTitleAppCount))
+        if (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_APP_NSP))
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "%s%s", menu[1], (dumpCfg.batchDumpCfg.dumpAppTitles ? "Yes" : "No"));
             strcat(strbuf, tmp);
         }
         
-        if ((dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL && titlePatchCount) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD && sdCardTitlePatchCount) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC && emmcTitlePatchCount))
+        if (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_PATCH_NSP))
         {
             if (strlen(strbuf)) strcat(strbuf, " | ");
             snprintf(tmp, MAX_CHARACTERS(tmp), "%s%s", menu[2], (dumpCfg.batchDumpCfg.dumpPatchTitles ? "Yes" : "No"));
             strcat(strbuf, tmp);
         }
         
-        if ((dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL && titleAddOnCount) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD && sdCardTitleAddOnCount) || (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC && emmcTitleAddOnCount))
+        if (getBatchModeSourceTitleCount(dumpCfg.batchDumpCfg.batchModeSrc, DUMP_ADDON_NSP))
         {
             if (strlen(strbuf)) strcat(strbuf, " | ");
             snprintf(tmp, MAX_CHARACTERS(tmp), "%s%s", menu[3], (dumpCfg.batchDumpCfg.dumpAddOnTitles ? "Yes" : "No"));
@@ -4774,12 +4965,15 @@ UIResult uiProcess()
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", menu[12], (dumpCfg.batchDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
         breaks++;
         
-        if ((sdCardTitleAppCount || sdCardTitlePatchCount || sdCardTitleAddOnCount) && (emmcTitleAppCount || emmcTitlePatchCount || emmcTitleAddOnCount))
+        if (((sdCardTitleAppCount || sdCardTitlePatchCount || sdCardTitleAddOnCount) && (emmcTitleAppCount || emmcTitlePatchCount || emmcTitleAddOnCount)) || localTitleAppCount || localTitlePatchCount || localTitleAddOnCount)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", menu[13], (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL ? "All (SD card + eMMC)" : (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD ? "SD card" : "eMMC")));
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", menu[13], (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL ? "All (SD card + eMMC)" : (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD ? "SD card" : (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_EMMC ? "eMMC" : "Local content storage"))));
             breaks++;
         }
         
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", menu[14], batchOrderPolicies[dumpCfg.batchDumpCfg.batchOrder]);
+        breaks++;
+        
         breaks++;
         uiRefreshDisplay();
         
@@ -4859,7 +5053,7 @@ UIResult uiProcess()
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, exeFsMenuItems[0]);
         breaks++;
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s", exeFsMenuItems[2], (dumpCfg.exeFsDumpCfg.isFat32 ? "Yes" : "No"), exeFsMenuItems[3], (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s | %s%s", exeFsMenuItems[2], (dumpCfg.exeFsDumpCfg.isFat32 ? "Yes" : "No"), exeFsMenuItems[3], (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"), exeFsMenuItems[4], nsoExportFormats[dumpCfg.exeFsDumpCfg.nsoExportFmt]);
         breaks++;
         
         if (!exeFsUpdateFlag)
@@ -4889,7 +5083,7 @@ UIResult uiProcess()
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, exeFsMenuItems[1]);
         breaks++;
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s", exeFsMenuItems[2], (dumpCfg.exeFsDumpCfg.isFat32 ? "Yes" : "No"), exeFsMenuItems[3], (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s | %s%s", exeFsMenuItems[2], (dumpCfg.exeFsDumpCfg.isFat32 ? "Yes" : "No"), exeFsMenuItems[3], (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"), exeFsMenuItems[4], nsoExportFormats[dumpCfg.exeFsDumpCfg.nsoExportFmt]);
         breaks++;
         
         if (!exeFsUpdateFlag)
@@ -4934,7 +5128,7 @@ UIResult uiProcess()
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "Manual File Dump: %s (ExeFS)", filenameBuffer[selectedFileIndex]);
         breaks++;
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s", exeFsMenuItems[2], (dumpCfg.exeFsDumpCfg.isFat32 ? "Yes" : "No"), exeFsMenuItems[3], (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s | %s%s", exeFsMenuItems[2], (dumpCfg.exeFsDumpCfg.isFat32 ? "Yes" : "No"), exeFsMenuItems[3], (dumpCfg.exeFsDumpCfg.useLayeredFSDir ? "Yes" : "No"), exeFsMenuItems[4], nsoExportFormats[dumpCfg.exeFsDumpCfg.nsoExportFmt]);
         breaks++;
         
         if (!exeFsUpdateFlag)
@@ -5248,6 +5442,36 @@ UIResult uiProcess()
         updateFreeSpace();
         res = resultShowTicketMenu;
     } else
+    if (uiState == stateDumpAllTickets)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "Dump tickets from all installed titles");
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", ticketMenuItems[1], (dumpCfg.tikDumpCfg.removeConsoleData ? "Yes" : "No"));
+        breaks += 2;
+        
+        dumpAllTickets(&(dumpCfg.tikDumpCfg));
+        
+        waitForButtonPress();
+        
+        updateFreeSpace();
+        res = resultShowTicketMenu;
+    } else
+    if (uiState == stateDumpBisPartition)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, mainMenuItems[2]);
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s | %s%s", bisMenuItems[1], BIS_PARTITION_NAME(curBisPartition), bisMenuItems[2], (dumpCfg.bisDumpCfg.isFat32 ? "Yes" : "No"), bisMenuItems[3], (dumpCfg.bisDumpCfg.skipFreeClusters ? "Yes" : "No"));
+        breaks += 2;
+        
+        dumpBisPartitionImage(curBisPartition, &(dumpCfg.bisDumpCfg));
+        
+        waitForButtonPress();
+        
+        updateFreeSpace();
+        res = resultShowBisMenu;
+    } else
     if (uiState == stateUpdateNSWDBXml)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, updateMenuItems[0]);
@@ -5269,6 +5493,35 @@ UIResult uiProcess()
         
         waitForButtonPress();
         
+        updateFreeSpace();
+        res = resultShowUpdateMenu;
+    } else
+    if (uiState == stateCalibrateTransferChunkSizes)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, updateMenuItems[2]);
+        breaks += 2;
+        
+        calibrateAllTransferChunkSizes(true);
+        
+        char readChunkSizeStr[32] = {'\0'}, writeChunkSizeStr[32] = {'\0'};
+        
+        convertSize(getTransferChunkSize(TRANSFER_SOURCE_SDCARD), readChunkSizeStr, MAX_CHARACTERS(readChunkSizeStr));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "SD card read chunk size: %s.", readChunkSizeStr);
+        breaks++;
+        
+        convertSize(getTransferChunkSize(TRANSFER_SOURCE_EMMC), readChunkSizeStr, MAX_CHARACTERS(readChunkSizeStr));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "eMMC read chunk size: %s.", readChunkSizeStr);
+        breaks++;
+        
+        convertSize(getTransferWriteChunkSize(), writeChunkSizeStr, MAX_CHARACTERS(writeChunkSizeStr));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "SD card write chunk size: %s.", writeChunkSizeStr);
+        breaks += 2;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed! Gamecards will be calibrated right before their next dump.");
+        breaks += 2;
+        
+        waitForButtonPress();
+        
         updateFreeSpace();
         res = resultShowUpdateMenu;
     }
@@ -74,6 +74,7 @@ typedef enum {
     resultShowNspPatchDumpMenu,
     resultShowNspAddOnDumpMenu,
     resultDumpNsp,
+    resultDumpNspBundle,
     resultShowHfs0Menu,
     resultShowRawHfs0PartitionDumpMenu,
     resultDumpRawHfs0Partition,
@@ -107,9 +108,13 @@ typedef enum {
     resultSdCardEmmcBatchDump,
     resultShowTicketMenu,
     resultDumpTicket,
+    resultDumpAllTickets,
+    resultShowBisMenu,
+    resultDumpBisPartition,
     resultShowUpdateMenu,
     resultUpdateNSWDBXml,
     resultUpdateApplication,
+    resultCalibrateTransferChunkSizes,
     resultExit
 } UIResult;
 
@@ -123,6 +128,7 @@ typedef enum {
     stateNspPatchDumpMenu,
     stateNspAddOnDumpMenu,
     stateDumpNsp,
+    stateDumpNspBundle,
     stateHfs0Menu,
     stateRawHfs0PartitionDumpMenu,
     stateDumpRawHfs0Partition,
@@ -156,11 +162,26 @@ typedef enum {
     stateSdCardEmmcBatchDump,
     stateTicketMenu,
     stateDumpTicket,
+    stateDumpAllTickets,
+    stateBisMenu,
+    stateDumpBisPartition,
     stateUpdateMenu,
     stateUpdateNSWDBXml,
-    stateUpdateApplication
+    stateUpdateApplication,
+    stateCalibrateTransferChunkSizes
 } UIState;
 
+// Holds the messages drawn by a worker thread while message capturing is enabled on it
+typedef struct {
+    u8 r, g, b;
+    char *str;
+} uiMessageLogEntry;
+
+typedef struct {
+    u32 count;
+    uiMessageLogEntry *entries;
+} uiMessageLog;
+
 typedef enum {
     MENUTYPE_MAIN = 0,
     MENUTYPE_GAMECARD,
@@ -177,6 +198,13 @@ bool uiLoadJpgFromFile(const char *filename, int expectedWidth, int expectedHeig
 
 void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...);
 
+// Makes uiDrawString() calls issued by the current thread append their messages to the provided log instead of drawing them
+// Meant for worker threads, which must not draw or update the line counter on their own. Passing NULL disables capturing
+void uiCaptureMessages(uiMessageLog *log);
+
+// Draws the captured messages on the current thread, one per line, and frees the log
+void uiFlushMessageLog(uiMessageLog *log);
+
 u32 uiGetStrWidth(const char *fmt, ...);
 
 void uiRefreshDisplay();
@@ -20,6 +20,8 @@
 #include "dumper.h"
 #include "fs_ext.h"
 #include "keys.h"
+#include "ncm_local.h"
+#include "rsa.h"
 #include "ui.h"
 #include "util.h"
 #include "fatfs/ff.h"
@@ -28,7 +30,7 @@
 
 extern bool highlight;
 
-extern int breaks;
+extern __thread int breaks;
 extern int font_height;
 
 extern int cursor;
@@ -52,6 +54,9 @@ dumpOptions dumpCfg;
 
 bool keysFileAvailable = false;
 
+bool headlessMode = false;                                  // Set while a job file is being processed. Prompts are answered automatically
+bool headlessPromptAnswer = false;                          // Answer used by yesNoPrompt() in headless mode
+
 static pthread_t gameCardDetectionThread;
 static UEvent exitEvent;
 
@@ -61,9 +66,20 @@ char cfwDirStr[32] = {'\0'};
 
 gamecard_ctx_t gameCardInfo;
 
+static gamecard_read_ahead_ctx gcReadAhead;
+
+static pthread_mutex_t gcLayoutMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gcLayoutCond = PTHREAD_COND_INITIALIZER;
+static gamecard_layout_t *gcLayoutCache = NULL;             // Last parsed gamecard layout. Kept after the gamecard is removed, so re-inserting the same gamecard doesn't require parsing it again
+static volatile bool gcLayoutPending = false;               // Set while the detection thread is waiting to parse a freshly inserted gamecard
+static bool gcLayoutCurrent = false;                        // Set if gcLayoutCache belongs to the currently inserted gamecard
+
+static char gcImagePath[NAME_BUF_LEN] = {'\0'};             // Set if gamecard reads are served from a XCI image file instead of the inserted gamecard
+
 u32 titleAppCount = 0, titlePatchCount = 0, titleAddOnCount = 0;
 u32 sdCardTitleAppCount = 0, sdCardTitlePatchCount = 0, sdCardTitleAddOnCount = 0;
 u32 emmcTitleAppCount = 0, emmcTitlePatchCount = 0, emmcTitleAddOnCount = 0;
+u32 localTitleAppCount = 0, localTitlePatchCount = 0, localTitleAddOnCount = 0;
 u32 gameCardSdCardEmmcPatchCount = 0, gameCardSdCardEmmcAddOnCount = 0;
 
 base_app_ctx_t *baseAppEntries = NULL;
@@ -128,59 +144,965 @@ void loadConfig()
     dumpCfg.batchDumpCfg.haltOnErrors = true;
     dumpCfg.batchDumpCfg.batchModeSrc = BATCH_SOURCE_ALL;
     
-    dumpCfg.exeFsDumpCfg.isFat32 = true;
+    dumpCfg.bisDumpCfg.isFat32 = true;
+    
+    dumpCfg.exeFsDumpCfg.isFat32 = true;
+    
+    dumpCfg.romFsDumpCfg.isFat32 = true;
+    
+    FILE *configFile = fopen(CONFIG_PATH, "rb");
+    if (!configFile) return;
+    
+    fseek(configFile, 0, SEEK_END);
+    size_t configFileSize = ftell(configFile);
+    rewind(configFile);
+    
+    if (configFileSize != sizeof(dumpOptions))
+    {
+        fclose(configFile);
+        remove(CONFIG_PATH);
+        return;
+    }
+    
+    dumpOptions tmpCfg;
+    size_t read_res = fread(&tmpCfg, 1, sizeof(dumpOptions), configFile);
+    fclose(configFile);
+    
+    if (read_res != sizeof(dumpOptions))
+    {
+        remove(CONFIG_PATH);
+        return;
+    }
+    
+    memcpy(&dumpCfg, &tmpCfg, sizeof(dumpOptions));
+    
+    // Check if the configuration is correct
+    if (dumpCfg.xciDumpCfg.setXciArchiveBit && !dumpCfg.xciDumpCfg.isFat32) dumpCfg.xciDumpCfg.setXciArchiveBit = false;
+    
+    if (dumpCfg.nspDumpCfg.tiklessDump && !dumpCfg.nspDumpCfg.removeConsoleData) dumpCfg.nspDumpCfg.tiklessDump = false;
+    
+    if (dumpCfg.batchDumpCfg.tiklessDump && !dumpCfg.batchDumpCfg.removeConsoleData) dumpCfg.batchDumpCfg.tiklessDump = false;
+    
+    if (dumpCfg.batchDumpCfg.batchModeSrc >= BATCH_SOURCE_CNT) dumpCfg.batchDumpCfg.batchModeSrc = BATCH_SOURCE_ALL;
+    
+    if (dumpCfg.batchDumpCfg.batchOrder >= BATCH_ORDER_CNT) dumpCfg.batchDumpCfg.batchOrder = BATCH_ORDER_NAME;
+    
+    if (dumpCfg.exeFsDumpCfg.nsoExportFmt >= NSO_EXPORT_CNT) dumpCfg.exeFsDumpCfg.nsoExportFmt = NSO_EXPORT_ORIGINAL;
+    
+    dumpCfg.romFsDumpCfg.nsoExportFmt = NSO_EXPORT_ORIGINAL;
+    
+    // Discard invalid transfer chunk sizes. They'll be recalibrated the next time they're needed
+    for(u32 i = 0; i < TRANSFER_SOURCE_CNT; i++)
+    {
+        if (dumpCfg.transferCfg.readChunkSize[i] < TRANSFER_CHUNK_SIZE_MIN || dumpCfg.transferCfg.readChunkSize[i] > DUMP_BUFFER_SIZE || (dumpCfg.transferCfg.readChunkSize[i] % MEDIA_UNIT_SIZE) != 0) dumpCfg.transferCfg.readChunkSize[i] = 0;
+        if (!dumpCfg.transferCfg.readChunkSize[i]) dumpCfg.transferCfg.readSpeed[i] = 0;
+    }
+    
+    if (dumpCfg.transferCfg.writeChunkSize < TRANSFER_CHUNK_SIZE_MIN || dumpCfg.transferCfg.writeChunkSize > DUMP_BUFFER_SIZE || (dumpCfg.transferCfg.writeChunkSize % MEDIA_UNIT_SIZE) != 0) dumpCfg.transferCfg.writeChunkSize = 0;
+    if (!dumpCfg.transferCfg.writeChunkSize) dumpCfg.transferCfg.writeSpeed = 0;
+}
+
+void saveConfig()
+{
+    FILE *configFile = fopen(CONFIG_PATH, "wb");
+    if (!configFile) return;
+    
+    size_t write_res = fwrite(&dumpCfg, 1, sizeof(dumpOptions), configFile);
+    fclose(configFile);
+    
+    if (write_res != sizeof(dumpOptions)) remove(CONFIG_PATH);
+}
+
+// Emulates a gamecard IStorage partition using a XCI image file (see xci_image.c)
+static Result openGameCardImageFileStorage(const char *path, gamecard_storage_t *storage, u32 idx)
+{
+    memset(storage, 0, sizeof(gamecard_storage_t));
+    storage->type = GAMECARD_STORAGE_XCI;
+    
+    if (!xciImageStorageOpen(&(storage->xci), path, idx)) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    return 0;
+}
+
+static Result readGameCardStorageRaw(gamecard_storage_t *storage, u64 off, void *buf, size_t len)
+{
+    if (storage->type == GAMECARD_STORAGE_FS) return fsStorageRead(&(storage->fsStorage), off, buf, len);
+    
+    if (!xciImageStorageRead(&(storage->xci), off, buf, len)) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    return 0;
+}
+
+static Result getGameCardStorageSize(gamecard_storage_t *storage, u64 *out)
+{
+    if (storage->type == GAMECARD_STORAGE_FS) return fsStorageGetSize(&(storage->fsStorage), (s64*)out);
+    
+    *out = storage->xci.size;
+    
+    return 0;
+}
+
+static void closeGameCardStorageHandle(gamecard_storage_t *storage)
+{
+    if (storage->type == GAMECARD_STORAGE_FS)
+    {
+        fsStorageClose(&(storage->fsStorage));
+    } else {
+        xciImageStorageClose(&(storage->xci));
+    }
+    
+    memset(storage, 0, sizeof(gamecard_storage_t));
+}
+
+static void closeGameCardHandle()
+{
+    svcCloseHandle(gameCardInfo.fsGameCardHandle.value);
+    gameCardInfo.fsGameCardHandle.value = 0;
+}
+
+// If 'discard' is false, a finished prefetch is kept around for the next streaming read
+static void waitForGameCardReadAhead(bool discard)
+{
+    if (!gcReadAhead.init) return;
+    
+    pthread_mutex_lock(&(gcReadAhead.mutex));
+    while(gcReadAhead.state == GAMECARD_READ_AHEAD_QUEUED) pthread_cond_wait(&(gcReadAhead.cond), &(gcReadAhead.mutex));
+    if (discard) gcReadAhead.state = GAMECARD_READ_AHEAD_IDLE;
+    pthread_mutex_unlock(&(gcReadAhead.mutex));
+}
+
+static void closeGameCardStorage(u32 idx)
+{
+    if (idx >= ISTORAGE_PARTITION_CNT || !gameCardInfo.gameCardStorageOpen[idx]) return;
+    
+    closeGameCardStorageHandle(&(gameCardInfo.gameCardStorages[idx]));
+    
+    gameCardInfo.gameCardStorageOpen[idx] = false;
+}
+
+void closeGameCardStoragePartitions()
+{
+    closeGameCardImage();
+    
+    for(u32 i = 0; i < ISTORAGE_PARTITION_CNT; i++) closeGameCardStorage(i);
+    
+    closeGameCardHandle();
+    
+    gameCardInfo.curIStorageIndex = ISTORAGE_PARTITION_NONE;
+}
+
+void closeGameCardStoragePartition()
+{
+    // Both IStorage partitions are kept open until the gamecard info is freed (see closeGameCardStoragePartitions()), so switching between them is free
+    // We only need to forget about the currently selected one
+    gameCardInfo.curIStorageIndex = ISTORAGE_PARTITION_NONE;
+}
+
+static Result openGameCardStorage(u32 idx)
+{
+    if (idx >= ISTORAGE_PARTITION_CNT) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    // Check if this IStorage partition is already open
+    if (gameCardInfo.gameCardStorageOpen[idx]) return 0;
+    
+    // XCI image files don't need a gamecard handle
+    if (strlen(gcImagePath))
+    {
+        Result result = openGameCardImageFileStorage(gcImagePath, &(gameCardInfo.gameCardStorages[idx]), idx);
+        if (R_SUCCEEDED(result)) gameCardInfo.gameCardStorageOpen[idx] = true;
+        return result;
+    }
+    
+    u8 i;
+    u32 j;
+    Result res1 = 0, res2 = 0, out = 0;
+    bool fallback = false;
+    
+    while(true)
+    {
+        // 10 tries
+        for(i = 0; i < 10; i++)
+        {
+            // First try to retrieve the IStorage partition handle using the current gamecard handle
+            gameCardInfo.gameCardStorages[idx].type = GAMECARD_STORAGE_FS;
+            res1 = fsOpenGameCardStorage(&(gameCardInfo.gameCardStorages[idx].fsStorage), &(gameCardInfo.fsGameCardHandle), idx);
+            if (R_SUCCEEDED(res1)) break;
+            
+            // If the previous call failed, we may have an invalid handle, so let's close the current one and try to retrieve a new one
+            closeGameCardHandle();
+            res2 = fsDeviceOperatorGetGameCardHandle(&(gameCardInfo.fsOperatorInstance), &(gameCardInfo.fsGameCardHandle));
+        }
+        
+        if ((R_SUCCEEDED(res1) && R_SUCCEEDED(res2)) || fallback) break;
+        
+        // Fall back to a single open IStorage partition if the other one is holding us back
+        for(j = 0; j < ISTORAGE_PARTITION_CNT; j++)
+        {
+            if (gameCardInfo.gameCardStorageOpen[j]) fallback = true;
+            closeGameCardStorage(j);
+        }
+        
+        if (!fallback) break;
+        
+        res1 = res2 = 0;
+    }
+    
+    if (R_SUCCEEDED(res1) && R_SUCCEEDED(res2))
+    {
+        gameCardInfo.gameCardStorageOpen[idx] = true;
+    } else {
+        // res2 takes precedence over res1
+        out = (R_FAILED(res2) ? res2 : res1);
+        
+        // Close leftover gamecard handle
+        closeGameCardHandle();
+    }
+    
+    // If everything worked properly, a functional gamecard handle + IStorage handle are guaranteed up to this point
+    return out;
+}
+
+Result openGameCardStoragePartition(openIStoragePartition partitionIndex)
+{
+    // Check if the provided IStorage index is valid
+    if (!partitionIndex || partitionIndex >= ISTORAGE_PARTITION_INVALID) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    // Opening a partition may close the other one in fallback mode
+    waitForGameCardReadAhead(true);
+    
+    Result result = openGameCardStorage((u32)(partitionIndex - 1));
+    
+    // Update current IStorage index
+    gameCardInfo.curIStorageIndex = (R_SUCCEEDED(result) ? partitionIndex : ISTORAGE_PARTITION_NONE);
+    
+    return result;
+}
+
+static Result readGameCardStorage(gamecard_storage_t *storage, u64 off, void *buf, size_t len, u8 *bounceBuf)
+{
+    // Optimization for reads that are already aligned to MEDIA_UNIT_SIZE bytes
+    if (!(off % MEDIA_UNIT_SIZE) && !(len % MEDIA_UNIT_SIZE)) return readGameCardStorageRaw(storage, off, buf, len);
+    
+    Result result = 0;
+    u8 *outBuf = (u8*)buf;
+    
+    u64 head_offset = (off % MEDIA_UNIT_SIZE);
+    u64 chunk_size = 0;
+    
+    // Misaligned head: only bounce the first media unit
+    if (head_offset)
+    {
+        chunk_size = (MEDIA_UNIT_SIZE - head_offset);
+        if (chunk_size > len) chunk_size = len;
+        
+        result = readGameCardStorageRaw(storage, off - head_offset, bounceBuf, MEDIA_UNIT_SIZE);
+        if (R_FAILED(result)) return result;
+        
+        memcpy(outBuf, bounceBuf + head_offset, chunk_size);
+        
+        off += chunk_size;
+        outBuf += chunk_size;
+        len -= chunk_size;
+    }
+    
+    // Aligned middle: read straight into the output buffer
+    chunk_size = (len - (len % MEDIA_UNIT_SIZE));
+    if (chunk_size)
+    {
+        result = readGameCardStorageRaw(storage, off, outBuf, chunk_size);
+        if (R_FAILED(result)) return result;
+        
+        off += chunk_size;
+        outBuf += chunk_size;
+        len -= chunk_size;
+    }
+    
+    // Misaligned tail: only bounce the last media unit
+    if (len)
+    {
+        result = readGameCardStorageRaw(storage, off, bounceBuf, MEDIA_UNIT_SIZE);
+        if (R_FAILED(result)) return result;
+        
+        memcpy(outBuf, bounceBuf, len);
+    }
+    
+    return result;
+}
+
+Result readGameCardStoragePartition(u64 off, void *buf, size_t len)
+{
+    if (!gameCardInfo.curIStorageIndex || gameCardInfo.curIStorageIndex >= ISTORAGE_PARTITION_INVALID || !buf || !len) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    // Don't issue requests on the same IStorage partition from two threads at once
+    waitForGameCardReadAhead(false);
+    
+    return readGameCardStorage(&(gameCardInfo.gameCardStorages[gameCardInfo.curIStorageIndex - 1]), off, buf, len, gcReadBuf);
+}
+
+static Result getGameCardStoragePartitionSize(u64 *out)
+{
+    if (!gameCardInfo.curIStorageIndex || gameCardInfo.curIStorageIndex >= ISTORAGE_PARTITION_INVALID || !out) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    return getGameCardStorageSize(&(gameCardInfo.gameCardStorages[gameCardInfo.curIStorageIndex - 1]), out);
+}
+
+// Reads data from the linear gamecard address space (normal IStorage partition followed by the secure IStorage partition, just like a XCI image)
+// If 'openPartitions' is false, only partitions that are already open are used. This is what the read-ahead thread does, since it must never change the gamecard handle state
+static Result readGameCardImageDirect(u64 off, void *buf, size_t len, u8 *bounceBuf, bool openPartitions)
+{
+    Result result = 0;
+    u8 *outBuf = (u8*)buf;
+    u64 partitionStart = 0, chunk_size = 0;
+    
+    for(u32 i = 0; i < ISTORAGE_PARTITION_CNT && len > 0; i++)
+    {
+        u64 partitionEnd = (partitionStart + gameCardInfo.IStoragePartitionSizes[i]);
+        
+        if (off < partitionEnd)
+        {
+            if (openPartitions)
+            {
+                result = openGameCardStorage(i);
+                if (R_FAILED(result)) return result;
+            } else
+            if (!gameCardInfo.gameCardStorageOpen[i])
+            {
+                return MAKERESULT(Module_Libnx, LibnxError_NotInitialized);
+            }
+            
+            chunk_size = (partitionEnd - off);
+            if (chunk_size > len) chunk_size = len;
+            
+            result = readGameCardStorage(&(gameCardInfo.gameCardStorages[i]), off - partitionStart, outBuf, chunk_size, bounceBuf);
+            if (R_FAILED(result)) return result;
+            
+            off += chunk_size;
+            outBuf += chunk_size;
+            len -= chunk_size;
+        }
+        
+        partitionStart = partitionEnd;
+    }
+    
+    // Out of bounds
+    if (len > 0) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    return result;
+}
+
+static void *gameCardReadAheadThreadFunc(void *arg)
+{
+    (void)arg;
+    
+    u8 bounceBuf[MEDIA_UNIT_SIZE];
+    
+    pthread_mutex_lock(&(gcReadAhead.mutex));
+    
+    while(true)
+    {
+        while(gcReadAhead.state != GAMECARD_READ_AHEAD_QUEUED && !gcReadAhead.exit) pthread_cond_wait(&(gcReadAhead.cond), &(gcReadAhead.mutex));
+        
+        if (gcReadAhead.exit) break;
+        
+        // The buffer pointer is swapped by readGameCardStream(), so grab it while holding the lock
+        u64 offset = gcReadAhead.offset, size = gcReadAhead.size;
+        u8 *buf = gcReadAhead.buf;
+        
+        pthread_mutex_unlock(&(gcReadAhead.mutex));
+        
+        Result result = readGameCardImageDirect(offset, buf, size, bounceBuf, false);
+        
+        pthread_mutex_lock(&(gcReadAhead.mutex));
+        
+        gcReadAhead.result = result;
+        gcReadAhead.state = GAMECARD_READ_AHEAD_DONE;
+        pthread_cond_broadcast(&(gcReadAhead.cond));
+    }
+    
+    pthread_mutex_unlock(&(gcReadAhead.mutex));
+    
+    return 0;
+}
+
+// Starts the read-ahead thread used by readGameCardStream(). Streaming reads still work without it, just without any prefetching
+static void startGameCardReadAhead()
+{
+    if (gcReadAhead.init) return;
+    
+    // Allocated just like dumpBuf, since both buffers are swapped on every prefetch hit
+    gcReadAhead.buf = calloc(GAMECARD_READ_AHEAD_SIZE, sizeof(u8));
+    if (!gcReadAhead.buf) return;
+    
+    pthread_mutex_init(&(gcReadAhead.mutex), NULL);
+    pthread_cond_init(&(gcReadAhead.cond), NULL);
+    
+    gcReadAhead.state = GAMECARD_READ_AHEAD_IDLE;
+    gcReadAhead.exit = false;
+    
+    if (pthread_create(&(gcReadAhead.thread), NULL, &gameCardReadAheadThreadFunc, NULL) != 0)
+    {
+        pthread_cond_destroy(&(gcReadAhead.cond));
+        pthread_mutex_destroy(&(gcReadAhead.mutex));
+        free(gcReadAhead.buf);
+        gcReadAhead.buf = NULL;
+        return;
+    }
+    
+    gcReadAhead.init = true;
+}
+
+// Sequential reads from the linear gamecard address space. Prefetching stops at 'end'
+// On a prefetch hit, '*buf' is swapped with the read-ahead buffer instead of copying the data. '*buf' must be a heap buffer with GAMECARD_READ_AHEAD_SIZE bytes (e.g. dumpBuf)
+static Result readGameCardStream(u64 off, u8 **buf, size_t len, u64 end, bool openPartitions)
+{
+    Result result = 0;
+    bool hit = false;
+    
+    if (gcReadAhead.init)
+    {
+        // Wait for the pending prefetch, then check if it's the data we need
+        pthread_mutex_lock(&(gcReadAhead.mutex));
+        
+        while(gcReadAhead.state == GAMECARD_READ_AHEAD_QUEUED) pthread_cond_wait(&(gcReadAhead.cond), &(gcReadAhead.mutex));
+        
+        hit = (gcReadAhead.state == GAMECARD_READ_AHEAD_DONE && R_SUCCEEDED(gcReadAhead.result) && gcReadAhead.offset == off && gcReadAhead.size >= len);
+        gcReadAhead.state = GAMECARD_READ_AHEAD_IDLE;
+        
+        if (hit)
+        {
+            u8 *tmp = *buf;
+            *buf = gcReadAhead.buf;
+            gcReadAhead.buf = tmp;
+        }
+        
+        pthread_mutex_unlock(&(gcReadAhead.mutex));
+    }
+    
+    if (!hit)
+    {
+        result = readGameCardImageDirect(off, *buf, len, gcReadBuf, openPartitions);
+        if (R_FAILED(result)) return result;
+    }
+    
+    // Prefetch the next chunk with the same size into the other buffer while the caller processes this one
+    if (gcReadAhead.init && len <= GAMECARD_READ_AHEAD_SIZE && (off + len) < end)
+    {
+        pthread_mutex_lock(&(gcReadAhead.mutex));
+        
+        gcReadAhead.offset = (off + len);
+        gcReadAhead.size = ((end - gcReadAhead.offset) < len ? (end - gcReadAhead.offset) : len);
+        gcReadAhead.state = GAMECARD_READ_AHEAD_QUEUED;
+        pthread_cond_broadcast(&(gcReadAhead.cond));
+        
+        pthread_mutex_unlock(&(gcReadAhead.mutex));
+    }
+    
+    return result;
+}
+
+Result readGameCardStoragePartitionStream(u64 off, u8 **buf, size_t len)
+{
+    if (!gameCardInfo.curIStorageIndex || gameCardInfo.curIStorageIndex >= ISTORAGE_PARTITION_INVALID || !buf || !*buf || !len || len > GAMECARD_READ_AHEAD_SIZE) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    u32 idx = (u32)(gameCardInfo.curIStorageIndex - 1);
+    u64 partitionStart = 0, partitionSize = gameCardInfo.IStoragePartitionSizes[idx];
+    
+    // The gamecard layout hasn't been retrieved yet
+    if (!partitionSize) return readGameCardStoragePartition(off, *buf, len);
+    
+    if ((off + len) > partitionSize) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    for(u32 i = 0; i < idx; i++) partitionStart += gameCardInfo.IStoragePartitionSizes[i];
+    
+    startGameCardReadAhead();
+    
+    // Only the current IStorage partition is used here. Opening the other one may close this one in fallback mode
+    return readGameCardStream(partitionStart + off, buf, len, partitionStart + partitionSize, false);
+}
+
+Result openGameCardImage()
+{
+    Result result = 0;
+    
+    waitForGameCardReadAhead(true);
+    
+    // Keep both IStorage partitions warm
+    for(u32 i = 0; i < ISTORAGE_PARTITION_CNT; i++)
+    {
+        result = openGameCardStorage(i);
+        if (R_FAILED(result)) return result;
+    }
+    
+    startGameCardReadAhead();
+    
+    return 0;
+}
+
+Result readGameCardImage(u64 off, u8 **buf, size_t len)
+{
+    if (!buf || !*buf || !len || len > GAMECARD_READ_AHEAD_SIZE) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    
+    u64 imageSize = 0;
+    
+    for(u32 i = 0; i < ISTORAGE_PARTITION_CNT; i++) imageSize += gameCardInfo.IStoragePartitionSizes[i];
+    
+    return readGameCardStream(off, buf, len, imageSize, true);
+}
+
+void closeGameCardImage()
+{
+    if (!gcReadAhead.init) return;
+    
+    pthread_mutex_lock(&(gcReadAhead.mutex));
+    while(gcReadAhead.state == GAMECARD_READ_AHEAD_QUEUED) pthread_cond_wait(&(gcReadAhead.cond), &(gcReadAhead.mutex));
+    gcReadAhead.exit = true;
+    pthread_cond_broadcast(&(gcReadAhead.cond));
+    pthread_mutex_unlock(&(gcReadAhead.mutex));
+    
+    pthread_join(gcReadAhead.thread, NULL);
+    
+    pthread_cond_destroy(&(gcReadAhead.cond));
+    pthread_mutex_destroy(&(gcReadAhead.mutex));
+    
+    free(gcReadAhead.buf);
+    
+    memset(&gcReadAhead, 0, sizeof(gamecard_read_ahead_ctx));
+}
+
+static void freeGameCardLayout(gamecard_layout_t *layout)
+{
+    if (!layout) return;
+    
+    if (layout->rootHfs0Header) free(layout->rootHfs0Header);
+    
+    if (layout->hfs0Partitions)
+    {
+        for(u32 i = 0; i < layout->hfs0PartitionCnt; i++)
+        {
+            if (layout->hfs0Partitions[i].header) free(layout->hfs0Partitions[i].header);
+        }
+        
+        free(layout->hfs0Partitions);
+    }
+    
+    if (layout->fileIndex) free(layout->fileIndex);
+    
+    free(layout);
+}
+
+// Replaces the cached gamecard layout. The previous one is only freed if gameCardInfo isn't referencing it
+// Must be called with gcLayoutMutex locked
+static void publishGameCardLayout(gamecard_layout_t *layout)
+{
+    if (gcLayoutCache && gcLayoutCache != layout && !gcLayoutCache->refCount) freeGameCardLayout(gcLayoutCache);
+    
+    gcLayoutCache = layout;
+    gcLayoutCurrent = (layout != NULL);
+}
+
+static gamecard_layout_t *acquireGameCardLayout()
+{
+    gamecard_layout_t *layout = NULL;
+    
+    pthread_mutex_lock(&gcLayoutMutex);
+    
+    // Wait until the detection thread is done with the gamecard that was just inserted
+    while(gcLayoutPending) pthread_cond_wait(&gcLayoutCond, &gcLayoutMutex);
+    
+    if (gcLayoutCurrent && gcLayoutCache)
+    {
+        layout = gcLayoutCache;
+        layout->refCount++;
+    }
+    
+    pthread_mutex_unlock(&gcLayoutMutex);
+    
+    return layout;
+}
+
+static void releaseGameCardLayout(gamecard_layout_t *layout)
+{
+    if (!layout) return;
+    
+    pthread_mutex_lock(&gcLayoutMutex);
+    
+    if (layout->refCount) layout->refCount--;
+    
+    // Free layouts that have already been replaced in the cache
+    if (!layout->refCount && layout != gcLayoutCache) freeGameCardLayout(layout);
+    
+    pthread_mutex_unlock(&gcLayoutMutex);
+}
+
+static int gameCardFileIndexEntryCmp(const void *a, const void *b)
+{
+    const hfs0_file_index_entry *entry1 = (const hfs0_file_index_entry*)a;
+    const hfs0_file_index_entry *entry2 = (const hfs0_file_index_entry*)b;
+    
+    if (entry1->partition != entry2->partition) return (entry1->partition < entry2->partition ? -1 : 1);
+    
+    return strcasecmp(entry1->name, entry2->name);
+}
+
+hfs0_file_index_entry *getGameCardFileIndexEntry(u32 partition, const char *filename)
+{
+    if (!gameCardInfo.layout || !gameCardInfo.layout->fileIndex || !gameCardInfo.layout->fileCnt || !filename || !strlen(filename)) return NULL;
+    
+    hfs0_file_index_entry key;
+    key.name = (char*)filename;
+    key.partition = partition;
+    
+    return (hfs0_file_index_entry*)bsearch(&key, gameCardInfo.layout->fileIndex, gameCardInfo.layout->fileCnt, sizeof(hfs0_file_index_entry), gameCardFileIndexEntryCmp);
+}
+
+// Uses its own gamecard handle and IStorage partition handles, so it can safely run on the detection thread while gameCardInfo still references the previous gamecard
+static Result openGameCardLayoutStorage(FsGameCardHandle *handle, gamecard_storage_t *storage, u32 idx)
+{
+    if (strlen(gcImagePath)) return openGameCardImageFileStorage(gcImagePath, storage, idx);
+    
+    u8 i;
+    Result result = 0;
+    
+    memset(storage, 0, sizeof(gamecard_storage_t));
+    storage->type = GAMECARD_STORAGE_FS;
+    
+    // 10 tries
+    for(i = 0; i < 10; i++)
+    {
+        if (!handle->value)
+        {
+            result = fsDeviceOperatorGetGameCardHandle(&(gameCardInfo.fsOperatorInstance), handle);
+            if (R_FAILED(result)) continue;
+        }
+        
+        result = fsOpenGameCardStorage(&(storage->fsStorage), handle, idx);
+        if (R_SUCCEEDED(result)) break;
+        
+        // We may have an invalid handle, so let's close it and try to retrieve a new one
+        svcCloseHandle(handle->value);
+        handle->value = 0;
+    }
+    
+    return result;
+}
+
+// Parses the full gamecard layout (gamecard header, root HFS0 header, HFS0 partition headers and file index)
+// If 'cached' holds a layout with the same package ID as the inserted gamecard, it is returned instead
+static gamecard_layout_t *parseGameCardLayout(gamecard_layout_t *cached, char *errorStr, size_t errorStrSize)
+{
+    Result result;
+    bool success = false;
+    
+    u32 i, j;
+    hfs0_header header;
+    hfs0_file_entry entry;
+    
+    FsGameCardHandle handle;
+    gamecard_storage_t storage;
+    bool storageOpen = false;
+    
+    u8 bounceBuf[MEDIA_UNIT_SIZE];
+    
+    gamecard_layout_t *layout = NULL;
+    
+    memset(&handle, 0, sizeof(FsGameCardHandle));
+    memset(&storage, 0, sizeof(gamecard_storage_t));
+    
+    layout = calloc(1, sizeof(gamecard_layout_t));
+    if (!layout)
+    {
+        snprintf(errorStr, errorStrSize, "%s: unable to allocate memory for the gamecard layout!", __func__);
+        return NULL;
+    }
+    
+    // Open normal IStorage partition
+    result = openGameCardLayoutStorage(&handle, &storage, 0);
+    if (R_FAILED(result))
+    {
+        snprintf(errorStr, errorStrSize, "%s: failed to open normal IStorage partition! (0x%08X)", __func__, result);
+        goto out;
+    }
+    
+    storageOpen = true;
+    
+    // Read gamecard header
+    result = readGameCardStorage(&storage, 0, &(layout->header), sizeof(gamecard_header_t), bounceBuf);
+    if (R_FAILED(result))
+    {
+        snprintf(errorStr, errorStrSize, "%s: failed to read %lu bytes long gamecard header! (0x%08X)", __func__, sizeof(gamecard_header_t), result);
+        goto out;
+    }
+    
+    if (__builtin_bswap32(layout->header.magic) != GAMECARD_HEADER_MAGIC)
+    {
+        snprintf(errorStr, errorStrSize, "%s: invalid gamecard header magic word! (0x%08X)", __func__, __builtin_bswap32(layout->header.magic));
+        goto out;
+    }
+    
+    // Reuse the cached layout if we're dealing with the same gamecard
+    // Layouts parsed from XCI image files aren't mixed up with the ones from real gamecards, since their IStorage partition sizes may differ
+    if (cached && cached->packageId == layout->header.packageId && cached->imageFile == (strlen(gcImagePath) > 0))
+    {
+        free(layout);
+        layout = cached;
+        success = true;
+        goto out;
+    }
+    
+    layout->packageId = layout->header.packageId;
+    layout->imageFile = (strlen(gcImagePath) > 0);
+    
+    // Retrieve normal IStorage partition size
+    result = getGameCardStorageSize(&storage, &(layout->IStoragePartitionSizes[0]));
+    if (R_FAILED(result))
+    {
+        snprintf(errorStr, errorStrSize, "%s: failed to retrieve size for normal IStorage partition! (0x%08X)", __func__, result);
+        goto out;
+    }
+    
+    layout->size = getGameCardCapacity(layout->header.size);
+    if (!layout->size)
+    {
+        snprintf(errorStr, errorStrSize, "%s: invalid gamecard size value! (0x%02X)", __func__, layout->header.size);
+        goto out;
+    }
+    
+    layout->trimmedSize = (sizeof(gamecard_header_t) + (layout->header.validDataEndAddr * MEDIA_UNIT_SIZE));
+    
+    layout->rootHfs0Header = calloc(1, layout->header.rootHfs0HeaderSize);
+    if (!layout->rootHfs0Header)
+    {
+        snprintf(errorStr, errorStrSize, "%s: unable to allocate memory for the root HFS0 header!", __func__);
+        goto out;
+    }
+    
+    result = readGameCardStorage(&storage, layout->header.rootHfs0HeaderOffset, layout->rootHfs0Header, layout->header.rootHfs0HeaderSize, bounceBuf);
+    if (R_FAILED(result))
+    {
+        snprintf(errorStr, errorStrSize, "%s: failed to read %lu bytes long root HFS0 header! (0x%08X)", __func__, layout->header.rootHfs0HeaderSize, result);
+        goto out;
+    }
+    
+    memcpy(&header, layout->rootHfs0Header, sizeof(hfs0_header));
+    
+    if (__builtin_bswap32(header.magic) != HFS0_MAGIC)
+    {
+        snprintf(errorStr, errorStrSize, "%s: invalid magic word in root HFS0 header! (0x%08X)", __func__, __builtin_bswap32(header.magic));
+        goto out;
+    }
+    
+    if (!header.file_cnt)
+    {
+        snprintf(errorStr, errorStrSize, "%s: invalid file count in root HFS0 header!", __func__);
+        goto out;
+    }
+    
+    if (!header.str_table_size)
+    {
+        snprintf(errorStr, errorStrSize, "%s: invalid string table size in root HFS0 header!", __func__);
+        goto out;
+    }
+    
+    layout->hfs0PartitionCnt = header.file_cnt;
+    
+    // Retrieve partition data
+    layout->hfs0Partitions = calloc(layout->hfs0PartitionCnt, sizeof(hfs0_partition_info));
+    if (!layout->hfs0Partitions)
+    {
+        snprintf(errorStr, errorStrSize, "%s: unable to allocate memory for HFS0 partition headers!", __func__);
+        goto out;
+    }
+    
+    for(i = 0; i < layout->hfs0PartitionCnt; i++)
+    {
+        memcpy(&entry, layout->rootHfs0Header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+        
+        if (!entry.file_size)
+        {
+            snprintf(errorStr, errorStrSize, "%s: invalid size for %s HFS0 partition!", __func__, GAMECARD_PARTITION_NAME(layout->hfs0PartitionCnt, i));
+            goto out;
+        }
+        
+        layout->hfs0Partitions[i].size = entry.file_size;
+        
+        // Check if we're dealing with the secure HFS0 partition
+        if (i == (layout->hfs0PartitionCnt - 1))
+        {
+            // The partition offset must be zero, because the secure HFS0 partition is stored at the start of the secure IStorage partition
+            layout->hfs0Partitions[i].offset = 0;
+            
+            // Open secure IStorage partition
+            closeGameCardStorageHandle(&storage);
+            storageOpen = false;
+            
+            result = openGameCardLayoutStorage(&handle, &storage, 1);
+            if (R_FAILED(result))
+            {
+                snprintf(errorStr, errorStrSize, "%s: failed to open secure IStorage partition! (0x%08X)", __func__, result);
+                goto out;
+            }
+            
+            storageOpen = true;
+            
+            if (strncmp(cfwDirStr, CFW_PATH_SXOS, strlen(CFW_PATH_SXOS)) != 0)
+            {
+                // Retrieve secure IStorage partition size
+                result = getGameCardStorageSize(&storage, &(layout->IStoragePartitionSizes[1]));
+                if (R_FAILED(result))
+                {
+                    snprintf(errorStr, errorStrSize, "%s: failed to retrieve size for secure IStorage partition! (0x%08X)", __func__, result);
+                    goto out;
+                }
+            } else {
+                // Total size for the secure IStorage partition is maxed out under SX OS, so let's try to calculate it manually
+                layout->IStoragePartitionSizes[1] = getGameCardSecureStorageSize(layout->size, layout->IStoragePartitionSizes[0]);
+            }
+        } else {
+            // The partition offset is relative to the start of the normal IStorage partition (true gamecard image start)
+            layout->hfs0Partitions[i].offset = (layout->header.rootHfs0HeaderOffset + layout->header.rootHfs0HeaderSize + entry.file_offset);
+        }
+        
+        // Partially read the current HFS0 partition header
+        result = readGameCardStorage(&storage, layout->hfs0Partitions[i].offset, &header, sizeof(hfs0_header), bounceBuf);
+        if (R_FAILED(result))
+        {
+            snprintf(errorStr, errorStrSize, "%s: failed to read %lu bytes long chunk from %s HFS0 partition! (0x%08X)", __func__, sizeof(hfs0_header), GAMECARD_PARTITION_NAME(layout->hfs0PartitionCnt, i), result);
+            goto out;
+        }
+        
+        // Check the HFS0 magic word
+        if (__builtin_bswap32(header.magic) != HFS0_MAGIC)
+        {
+            snprintf(errorStr, errorStrSize, "%s: invalid magic word in %s HFS0 partition header! (0x%08X)", __func__, GAMECARD_PARTITION_NAME(layout->hfs0PartitionCnt, i), __builtin_bswap32(header.magic));
+            goto out;
+        }
+        
+        if (!header.str_table_size)
+        {
+            snprintf(errorStr, errorStrSize, "%s: invalid string table size in %s HFS0 partition header!", __func__, GAMECARD_PARTITION_NAME(layout->hfs0PartitionCnt, i));
+            goto out;
+        }
+        
+        // Calculate the size for the HFS0 partition header and round it to a MEDIA_UNIT_SIZE bytes boundary
+        layout->hfs0Partitions[i].header_size = (sizeof(hfs0_header) + (header.file_cnt * sizeof(hfs0_file_entry)) + header.str_table_size);
+        layout->hfs0Partitions[i].header_size = round_up(layout->hfs0Partitions[i].header_size, MEDIA_UNIT_SIZE);
+        
+        layout->hfs0Partitions[i].file_cnt = header.file_cnt;
+        layout->hfs0Partitions[i].str_table_size = header.str_table_size;
+        
+        layout->hfs0Partitions[i].header = calloc(1, layout->hfs0Partitions[i].header_size);
+        if (!layout->hfs0Partitions[i].header)
+        {
+            snprintf(errorStr, errorStrSize, "%s: unable to allocate memory for %s HFS0 partition header!", __func__, GAMECARD_PARTITION_NAME(layout->hfs0PartitionCnt, i));
+            goto out;
+        }
+        
+        // Finally, read the full HFS0 partition header
+        result = readGameCardStorage(&storage, layout->hfs0Partitions[i].offset, layout->hfs0Partitions[i].header, layout->hfs0Partitions[i].header_size, bounceBuf);
+        if (R_FAILED(result))
+        {
+            snprintf(errorStr, errorStrSize, "%s: failed to read %lu bytes long %s HFS0 partition header! (0x%08X)", __func__, layout->hfs0Partitions[i].header_size, GAMECARD_PARTITION_NAME(layout->hfs0PartitionCnt, i), result);
+            goto out;
+        }
+        
+        layout->fileCnt += layout->hfs0Partitions[i].file_cnt;
+    }
+    
+    // Build the file index, sorted by partition and filename
+    if (layout->fileCnt)
+    {
+        layout->fileIndex = calloc(layout->fileCnt, sizeof(hfs0_file_index_entry));
+        if (!layout->fileIndex)
+        {
+            snprintf(errorStr, errorStrSize, "%s: unable to allocate memory for the gamecard file index!", __func__);
+            goto out;
+        }
+        
+        hfs0_file_index_entry *indexEntry = layout->fileIndex;
+        
+        for(i = 0; i < layout->hfs0PartitionCnt; i++)
+        {
+            hfs0_partition_info *partition = &(layout->hfs0Partitions[i]);
+            
+            for(j = 0; j < partition->file_cnt; j++, indexEntry++)
+            {
+                memcpy(&entry, partition->header + sizeof(hfs0_header) + (j * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+                
+                indexEntry->name = (char*)(partition->header + sizeof(hfs0_header) + (partition->file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
+                indexEntry->partition = i;
+                indexEntry->index = j;
+                indexEntry->offset = (partition->offset + partition->header_size + entry.file_offset);
+                indexEntry->size = entry.file_size;
+            }
+        }
+        
+        qsort(layout->fileIndex, layout->fileCnt, sizeof(hfs0_file_index_entry), gameCardFileIndexEntryCmp);
+    }
+    
+    // Get bundled FW version update. Not available for XCI image files
+    result = (strlen(gcImagePath) ? MAKERESULT(Module_Libnx, LibnxError_NotFound) : fsDeviceOperatorUpdatePartitionInfo(&(gameCardInfo.fsOperatorInstance), &handle, &(layout->updateVersion), &(layout->updateTitleId)));
+    if (R_FAILED(result))
+    {
+        layout->updateVersion = 0;
+        layout->updateTitleId = 0;
+    }
     
-    dumpCfg.romFsDumpCfg.isFat32 = true;
+    success = true;
     
-    FILE *configFile = fopen(CONFIG_PATH, "rb");
-    if (!configFile) return;
+out:
+    if (storageOpen) closeGameCardStorageHandle(&storage);
     
-    fseek(configFile, 0, SEEK_END);
-    size_t configFileSize = ftell(configFile);
-    rewind(configFile);
+    if (handle.value) svcCloseHandle(handle.value);
     
-    if (configFileSize != sizeof(dumpOptions))
+    if (!success)
     {
-        fclose(configFile);
-        remove(CONFIG_PATH);
-        return;
+        freeGameCardLayout(layout);
+        layout = NULL;
     }
     
-    dumpOptions tmpCfg;
-    size_t read_res = fread(&tmpCfg, 1, sizeof(dumpOptions), configFile);
-    fclose(configFile);
-    
-    if (read_res != sizeof(dumpOptions))
-    {
-        remove(CONFIG_PATH);
-        return;
-    }
+    return layout;
+}
+
+// Runs on the detection thread after a gamecard is inserted
+static void updateGameCardLayoutCache()
+{
+    char errorStr[256] = {'\0'};
+    gamecard_layout_t *layout = NULL;
     
-    memcpy(&dumpCfg, &tmpCfg, sizeof(dumpOptions));
+    pthread_mutex_lock(&gcLayoutMutex);
     
-    // Check if the configuration is correct
-    if (dumpCfg.xciDumpCfg.setXciArchiveBit && !dumpCfg.xciDumpCfg.isFat32) dumpCfg.xciDumpCfg.setXciArchiveBit = false;
+    layout = parseGameCardLayout(gcLayoutCache, errorStr, sizeof(errorStr));
     
-    if (dumpCfg.nspDumpCfg.tiklessDump && !dumpCfg.nspDumpCfg.removeConsoleData) dumpCfg.nspDumpCfg.tiklessDump = false;
+    // If parsing failed, retrieveGameCardInfo() will try again and display the error
+    if (layout)
+    {
+        publishGameCardLayout(layout);
+    } else {
+        gcLayoutCurrent = false;
+    }
     
-    if (dumpCfg.batchDumpCfg.tiklessDump && !dumpCfg.batchDumpCfg.removeConsoleData) dumpCfg.batchDumpCfg.tiklessDump = false;
+    gcLayoutPending = false;
+    pthread_cond_broadcast(&gcLayoutCond);
     
-    if (dumpCfg.batchDumpCfg.batchModeSrc >= BATCH_SOURCE_CNT) dumpCfg.batchDumpCfg.batchModeSrc = BATCH_SOURCE_ALL;
+    pthread_mutex_unlock(&gcLayoutMutex);
 }
 
-void saveConfig()
+static void setGameCardLayoutPending(bool pending)
 {
-    FILE *configFile = fopen(CONFIG_PATH, "wb");
-    if (!configFile) return;
+    pthread_mutex_lock(&gcLayoutMutex);
     
-    size_t write_res = fwrite(&dumpCfg, 1, sizeof(dumpOptions), configFile);
-    fclose(configFile);
+    gcLayoutPending = pending;
+    gcLayoutCurrent = false;
+    pthread_cond_broadcast(&gcLayoutCond);
     
-    if (write_res != sizeof(dumpOptions)) remove(CONFIG_PATH);
+    pthread_mutex_unlock(&gcLayoutMutex);
 }
 
 static bool isGameCardInserted()
 {
+    // XCI image files are always "inserted"
+    if (strlen(gcImagePath)) return true;
+    
     bool inserted = false;
     fsDeviceOperatorIsGameCardInserted(&(gameCardInfo.fsOperatorInstance), &inserted);
     return inserted;
@@ -213,12 +1135,19 @@ static void *fsGameCardDetectionThreadFunc(void *arg)
     /* Retrieve initial gamecard status */
     bool curGcStatus = isGameCardInserted();
     changeAtomicBool(&(gameCardInfo.isInserted), curGcStatus);
+    setGameCardLayoutPending(curGcStatus);
     
     while(true)
     {
         // Wait until an event is triggered
-        result = waitMulti(&idx, -1, gameCardEventWaiter, exitEventWaiter);
-        if (R_FAILED(result)) continue;
+        // If a gamecard was just inserted, don't access it immediately to avoid conflicts with the fsp-srv, ncm and ns services
+        result = waitMulti(&idx, (gcLayoutPending ? ((u64)GAMECARD_WAIT_TIME * 1000000000ULL) : -1), gameCardEventWaiter, exitEventWaiter);
+        if (R_FAILED(result))
+        {
+            // Parse the gamecard layout once it's safe to do so
+            if (result == KERNELRESULT(TimedOut) && gcLayoutPending) updateGameCardLayoutCache();
+            continue;
+        }
         
         // Exit event triggered
         if (idx == 1) break;
@@ -228,8 +1157,13 @@ static void *fsGameCardDetectionThreadFunc(void *arg)
         curGcStatus = isGameCardInserted();
         changeAtomicBool(&(gameCardInfo.isInserted), curGcStatus);
         if (!curGcStatus && gameCardInfoLoaded) changeAtomicBool(&gameCardInfoLoaded, false);
+        
+        setGameCardLayoutPending(curGcStatus);
     }
     
+    // Don't leave retrieveGameCardInfo() waiting for us
+    setGameCardLayoutPending(false);
+    
     waitMulti(&idx, 0, gameCardEventWaiter, exitEventWaiter);
     
     return 0;
@@ -258,103 +1192,33 @@ static bool createGameCardDetectionThread()
     return true;
 }
 
-static void closeGameCardHandle()
-{
-    svcCloseHandle(gameCardInfo.fsGameCardHandle.value);
-    gameCardInfo.fsGameCardHandle.value = 0;
-}
-
-void closeGameCardStoragePartition()
-{
-    if (!gameCardInfo.curIStorageIndex || gameCardInfo.curIStorageIndex >= ISTORAGE_PARTITION_INVALID) return;
-    
-    fsStorageClose(&(gameCardInfo.fsGameCardStorage));
-    memset(&(gameCardInfo.fsGameCardStorage), 0, sizeof(FsStorage));
-    
-    closeGameCardHandle();
-    
-    gameCardInfo.curIStorageIndex = ISTORAGE_PARTITION_NONE;
-}
-
-Result openGameCardStoragePartition(openIStoragePartition partitionIndex)
+bool setGameCardImageFile(const char *path)
 {
-    // Check if the provided IStorage index is valid
-    if (!partitionIndex || partitionIndex >= ISTORAGE_PARTITION_INVALID) return MAKERESULT(Module_Libnx, LibnxError_IoError);
+    gamecard_storage_t storage;
     
-    // Safety check: check if we have already opened an IStorage instance
-    if (gameCardInfo.curIStorageIndex && gameCardInfo.curIStorageIndex < ISTORAGE_PARTITION_INVALID)
+    // Make sure the image file can actually be used before dropping the current gamecard
+    if (path && strlen(path))
     {
-        // If the opened IStorage instance is the same as the requested one, just return right away
-        if (gameCardInfo.curIStorageIndex == partitionIndex) return 0;
-        
-        // Otherwise, close the current IStorage instance
-        closeGameCardStoragePartition();
+        if (R_FAILED(openGameCardImageFileStorage(path, &storage, 1))) return false;
+        closeGameCardStorageHandle(&storage);
     }
     
-    u8 i;
-    u32 idx = (u32)(partitionIndex - 1);
-    Result res1 = 0, res2 = 0, out = 0;
+    snprintf(gcImagePath, MAX_CHARACTERS(gcImagePath), "%s", (path ? path : ""));
     
-    // 10 tries
-    for(i = 0; i < 10; i++)
-    {
-        // First try to retrieve the IStorage partition handle using the current gamecard handle
-        res1 = fsOpenGameCardStorage(&(gameCardInfo.fsGameCardStorage), &(gameCardInfo.fsGameCardHandle), idx);
-        if (R_SUCCEEDED(res1)) break;
-        
-        // If the previous call failed, we may have an invalid handle, so let's close the current one and try to retrieve a new one
-        closeGameCardHandle();
-        res2 = fsDeviceOperatorGetGameCardHandle(&(gameCardInfo.fsOperatorInstance), &(gameCardInfo.fsGameCardHandle));
-    }
+    // Force loadTitleInfo() to free the current gamecard info and load it again
+    changeAtomicBool(&gameCardInfoLoaded, false);
+    changeAtomicBool(&(gameCardInfo.isInserted), isGameCardInserted());
     
-    if (R_SUCCEEDED(res1) && R_SUCCEEDED(res2))
+    // Parse the new layout right away instead of waiting for the detection thread
+    if (gameCardInfo.isInserted)
     {
-        // Update current IStorage index
-        gameCardInfo.curIStorageIndex = partitionIndex;
+        setGameCardLayoutPending(true);
+        updateGameCardLayoutCache();
     } else {
-        // res2 takes precedence over res1
-        out = (R_FAILED(res2) ? res2 : res1);
-        
-        // Close leftover gamecard handle
-        closeGameCardHandle();
+        setGameCardLayoutPending(false);
     }
     
-    // If everything worked properly, a functional gamecard handle + IStorage handle are guaranteed up to this point
-    return out;
-}
-
-Result readGameCardStoragePartition(u64 off, void *buf, size_t len)
-{
-    if (!gameCardInfo.curIStorageIndex || gameCardInfo.curIStorageIndex >= ISTORAGE_PARTITION_INVALID || !buf || !len) return MAKERESULT(Module_Libnx, LibnxError_IoError);
-    
-    // Optimization for reads that are already aligned to MEDIA_UNIT_SIZE bytes
-    if (!(off % MEDIA_UNIT_SIZE) && !(len % MEDIA_UNIT_SIZE)) return fsStorageRead(&(gameCardInfo.fsGameCardStorage), off, buf, len);
-    
-    Result result;
-    u8 *outBuf = (u8*)buf;
-    
-    u64 block_start_offset = (off - (off % MEDIA_UNIT_SIZE));
-    u64 block_end_offset = (u64)round_up(off + len, MEDIA_UNIT_SIZE);
-    u64 block_size = (block_end_offset - block_start_offset);
-    
-    u64 block_size_used = (block_size > GAMECARD_READ_BUFFER_SIZE ? GAMECARD_READ_BUFFER_SIZE : block_size);
-    u64 output_block_size = (block_size > GAMECARD_READ_BUFFER_SIZE ? (GAMECARD_READ_BUFFER_SIZE - (off - block_start_offset)) : len);
-    
-    result = fsStorageRead(&(gameCardInfo.fsGameCardStorage), block_start_offset, gcReadBuf, block_size_used);
-    if (R_FAILED(result)) return result;
-    
-    memcpy(outBuf, gcReadBuf + (off - block_start_offset), output_block_size);
-    
-    if (block_size > GAMECARD_READ_BUFFER_SIZE) return readGameCardStoragePartition(off + output_block_size, outBuf + output_block_size, len - output_block_size);
-    
-    return result;
-}
-
-static Result getGameCardStoragePartitionSize(u64 *out)
-{
-    if (!gameCardInfo.curIStorageIndex || gameCardInfo.curIStorageIndex >= ISTORAGE_PARTITION_INVALID || !out) return MAKERESULT(Module_Libnx, LibnxError_IoError);
-    
-    return fsStorageGetSize(&(gameCardInfo.fsGameCardStorage), (s64*)out);
+    return true;
 }
 
 bool mountSysEmmcPartition()
@@ -488,6 +1352,7 @@ static void createOutputDirectories()
     mkdir(CERT_DUMP_PATH, 0744);
     mkdir(BATCH_OVERRIDES_PATH, 0744);
     mkdir(TICKET_PATH, 0744);
+    mkdir(BIS_DUMP_PATH, 0744);
 }
 
 static bool getSdCardFreeSpace(u64 *out)
@@ -713,22 +1578,12 @@ static void freeGameCardInfo()
     
     memset(&(gameCardInfo.header), 0, sizeof(gamecard_header_t));
     
-    if (gameCardInfo.rootHfs0Header)
-    {
-        free(gameCardInfo.rootHfs0Header);
-        gameCardInfo.rootHfs0Header = NULL;
-    }
+    // The root HFS0 header and the HFS0 partition headers are owned by the cached gamecard layout
+    gameCardInfo.rootHfs0Header = NULL;
+    gameCardInfo.hfs0Partitions = NULL;
     
-    if (gameCardInfo.hfs0Partitions)
-    {
-        for(i = 0; i < gameCardInfo.hfs0PartitionCnt; i++)
-        {
-            if (gameCardInfo.hfs0Partitions[i].header) free(gameCardInfo.hfs0Partitions[i].header);
-        }
-        
-        free(gameCardInfo.hfs0Partitions);
-        gameCardInfo.hfs0Partitions = NULL;
-    }
+    releaseGameCardLayout(gameCardInfo.layout);
+    gameCardInfo.layout = NULL;
     
     gameCardInfo.hfs0PartitionCnt = 0;
     
@@ -744,7 +1599,7 @@ static void freeGameCardInfo()
     gameCardInfo.updateVersion = 0;
     memset(gameCardInfo.updateVersionStr, 0, sizeof(gameCardInfo.updateVersionStr));
     
-    closeGameCardStoragePartition();
+    closeGameCardStoragePartitions();
 }
 
 static void freeOrphanPatchOrAddOnList()
@@ -800,6 +1655,12 @@ static void freeTitleInfo()
     emmcTitlePatchCount = 0;
     emmcTitleAddOnCount = 0;
     
+    localTitleAppCount = 0;
+    localTitlePatchCount = 0;
+    localTitleAddOnCount = 0;
+    
+    freeLocalContentStorage();
+    
     gameCardSdCardEmmcPatchCount = 0;
     gameCardSdCardEmmcAddOnCount = 0;
     
@@ -1105,6 +1966,9 @@ bool initApplicationResources(int argc, char **argv)
     /* Update free space */
     updateFreeSpace();
     
+    /* Calibrate transfer chunk sizes on first launch, so the SD card write test never runs in the middle of a dump */
+    if (!dumpCfg.transferCfg.writeChunkSize) calibrateAllTransferChunkSizes(false);
+    
     /* Set output status */
     success = true;
     
@@ -1126,6 +1990,9 @@ void deinitApplicationResources()
     /* Save current settings to configuration file */
     saveConfig();
     
+    /* Stop RSA signing threads */
+    rsa_sign_exit();
+    
     if (gcThreadInit)
     {
         /* Signal the exit event to terminate the gamecard detection thread */
@@ -1133,6 +2000,11 @@ void deinitApplicationResources()
         
         /* Wait for the gamecard detection thread to exit */
         pthread_join(gameCardDetectionThread, NULL);
+        
+        /* Free cached gamecard layout */
+        pthread_mutex_lock(&gcLayoutMutex);
+        publishGameCardLayout(NULL);
+        pthread_mutex_unlock(&gcLayoutMutex);
     }
     
     /* Close gamecard detection kernel event */
@@ -1281,7 +2153,7 @@ static bool listTitlesByType(NcmContentMetaDatabase *ncmDb, NcmContentMetaType m
         goto out;
     }
     
-    result = ncmContentMetaDatabaseListApplication(ncmDb, (s32*)&total, (s32*)&written, titleList, 1, metaType);
+    result = ncmLocalContentMetaDatabaseListApplication(ncmDb, (s32*)&total, (s32*)&written, titleList, 1, metaType);
     if (R_FAILED(result))
     {
         uiStatusMsg("%s: ncmContentMetaDatabaseListApplication failed! (0x%08X) (meta type: 0x%02X).", __func__, result, (u8)metaType);
@@ -1304,7 +2176,7 @@ static bool listTitlesByType(NcmContentMetaDatabase *ncmDb, NcmContentMetaType m
             titleList = titleListTmp;
             memset(titleList, 0, titleListSize);
             
-            result = ncmContentMetaDatabaseListApplication(ncmDb, (s32*)&total, (s32*)&written, titleList, (s32)total, metaType);
+            result = ncmLocalContentMetaDatabaseListApplication(ncmDb, (s32*)&total, (s32*)&written, titleList, (s32)total, metaType);
             if (R_SUCCEEDED(result))
             {
                 if (written != total)
@@ -1413,7 +2285,7 @@ out:
 
 static bool getTitleIDAndVersionList(NcmStorageId storageId, bool loadBaseApps, bool loadPatches, bool loadAddOns)
 {
-    if ((storageId != NcmStorageId_GameCard && storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser) || (!loadBaseApps && !loadPatches && !loadAddOns))
+    if ((storageId != NcmStorageId_GameCard && storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser && storageId != LOCAL_CONTENT_STORAGE_ID) || (!loadBaseApps && !loadPatches && !loadAddOns))
     {
         uiStatusMsg("%s: invalid parameters to retrieve Title ID + version list!", __func__);
         return false;
@@ -1430,7 +2302,7 @@ static bool getTitleIDAndVersionList(NcmStorageId storageId, bool loadBaseApps,
     u32 i;
     u32 curAppCount = titleAppCount, curPatchCount = titlePatchCount, curAddOnCount = titleAddOnCount;
     
-    result = ncmOpenContentMetaDatabase(&ncmDb, storageId);
+    result = ncmLocalOpenContentMetaDatabase(&ncmDb, storageId);
     if (R_FAILED(result))
     {
         if (storageId == NcmStorageId_SdCard && result == 0x21005)
@@ -1655,251 +2527,87 @@ void strtrim(char *str)
     
     while(--end >= start)
     {
-        if (!isspace((unsigned char)*end)) break;
-    }
-    
-    *(++end) = '\0';
-    
-    while(isspace((unsigned char)*start)) start++;
-    
-    if (start != str) memmove(str, start, end - start + 1);
-}
-
-bool retrieveGameCardInfo()
-{
-    Result result;
-    bool success = false;
-    
-    u32 i;
-    hfs0_header header;
-    hfs0_file_entry entry;
-    
-    u8 major = 0, minor = 0, micro = 0;
-    u16 bugfix = 0;
-    
-    // Open normal IStorage partition
-    result = openGameCardStoragePartition(ISTORAGE_PARTITION_NORMAL);
-    if (R_FAILED(result))
-    {
-        uiStatusMsg("%s: failed to open normal IStorage partition! (0x%08X)", __func__, result);
-        return false;
-    }
-    
-    // Retrieve normal IStorage partition size
-    result = getGameCardStoragePartitionSize(&(gameCardInfo.IStoragePartitionSizes[0]));
-    if (R_FAILED(result))
-    {
-        uiStatusMsg("%s: failed to retrieve size for normal IStorage partition! (0x%08X)", __func__, result);
-        return false;
-    }
-    
-    // Read gamecard header
-    result = readGameCardStoragePartition(0, &(gameCardInfo.header), sizeof(gamecard_header_t));
-    if (R_FAILED(result))
-    {
-        uiStatusMsg("%s: failed to read %lu bytes long gamecard header! (0x%08X)", __func__, sizeof(gamecard_header_t), result);
-        goto out;
-    }
-    
-    if (__builtin_bswap32(gameCardInfo.header.magic) != GAMECARD_HEADER_MAGIC)
-    {
-        uiStatusMsg("%s: invalid gamecard header magic word! (0x%08X)", __func__, __builtin_bswap32(gameCardInfo.header.magic));
-        goto out;
-    }
-    
-    switch(gameCardInfo.header.size)
-    {
-        case 0xFA: // 1 GiB
-            gameCardInfo.size = GAMECARD_SIZE_1GiB;
-            break;
-        case 0xF8: // 2 GiB
-            gameCardInfo.size = GAMECARD_SIZE_2GiB;
-            break;
-        case 0xF0: // 4 GiB
-            gameCardInfo.size = GAMECARD_SIZE_4GiB;
-            break;
-        case 0xE0: // 8 GiB
-            gameCardInfo.size = GAMECARD_SIZE_8GiB;
-            break;
-        case 0xE1: // 16 GiB
-            gameCardInfo.size = GAMECARD_SIZE_16GiB;
-            break;
-        case 0xE2: // 32 GiB
-            gameCardInfo.size = GAMECARD_SIZE_32GiB;
-            break;
-        default:
-            uiStatusMsg("%s: invalid gamecard size value! (0x%02X)", __func__, gameCardInfo.header.size);
-            goto out;
-    }
-    
-    convertSize(gameCardInfo.size, gameCardInfo.sizeStr, MAX_CHARACTERS(gameCardInfo.sizeStr));
-    
-    gameCardInfo.trimmedSize = (sizeof(gamecard_header_t) + (gameCardInfo.header.validDataEndAddr * MEDIA_UNIT_SIZE));
-    convertSize(gameCardInfo.trimmedSize, gameCardInfo.trimmedSizeStr, MAX_CHARACTERS(gameCardInfo.trimmedSizeStr));
-    
-    gameCardInfo.rootHfs0Header = calloc(1, gameCardInfo.header.rootHfs0HeaderSize);
-    if (!gameCardInfo.rootHfs0Header)
-    {
-        uiStatusMsg("%s: unable to allocate memory for the root HFS0 header!", __func__);
-        goto out;
-    }
-    
-    result = readGameCardStoragePartition(gameCardInfo.header.rootHfs0HeaderOffset, gameCardInfo.rootHfs0Header, gameCardInfo.header.rootHfs0HeaderSize);
-    if (R_FAILED(result))
-    {
-        uiStatusMsg("%s: failed to read %lu bytes long root HFS0 header! (0x%08X)", __func__, gameCardInfo.header.rootHfs0HeaderSize, result);
-        goto out;
-    }
-    
-    memcpy(&header, gameCardInfo.rootHfs0Header, sizeof(hfs0_header));
-    
-    if (__builtin_bswap32(header.magic) != HFS0_MAGIC)
-    {
-        uiStatusMsg("%s: invalid magic word in root HFS0 header! (0x%08X)", __func__, __builtin_bswap32(header.magic));
-        goto out;
-    }
-    
-    if (!header.file_cnt)
-    {
-        uiStatusMsg("%s: invalid file count in root HFS0 header!", __func__);
-        goto out;
-    }
-    
-    if (!header.str_table_size)
-    {
-        uiStatusMsg("%s: invalid string table size in root HFS0 header!", __func__);
-        goto out;
-    }
-    
-    gameCardInfo.hfs0PartitionCnt = header.file_cnt;
-    
-    // Retrieve partition data
-    gameCardInfo.hfs0Partitions = calloc(gameCardInfo.hfs0PartitionCnt, sizeof(hfs0_partition_info));
-    if (!gameCardInfo.hfs0Partitions)
-    {
-        uiStatusMsg("%s: unable to allocate memory for HFS0 partition headers!", __func__);
-        goto out;
-    }
-    
-    for(i = 0; i < gameCardInfo.hfs0PartitionCnt; i++)
-    {
-        memcpy(&entry, gameCardInfo.rootHfs0Header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
-        
-        if (!entry.file_size)
-        {
-            uiStatusMsg("%s: invalid size for %s HFS0 partition!", __func__, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, i));
-            goto out;
-        }
-        
-        gameCardInfo.hfs0Partitions[i].size = entry.file_size;
-        
-        // Check if we're dealing with the secure HFS0 partition
-        if (i == (gameCardInfo.hfs0PartitionCnt - 1))
-        {
-            // The partition offset must be zero, because the secure HFS0 partition is stored at the start of the secure IStorage partition
-            gameCardInfo.hfs0Partitions[i].offset = 0;
-            
-            // Open secure IStorage partition
-            result = openGameCardStoragePartition(ISTORAGE_PARTITION_SECURE);
-            if (R_FAILED(result))
-            {
-                uiStatusMsg("%s: failed to open secure IStorage partition! (0x%08X)", __func__, result);
-                goto out;
-            }
-            
-            if (strncmp(cfwDirStr, CFW_PATH_SXOS, strlen(CFW_PATH_SXOS)) != 0)
-            {
-                // Retrieve secure IStorage partition size
-                result = getGameCardStoragePartitionSize(&(gameCardInfo.IStoragePartitionSizes[1]));
-                if (R_FAILED(result))
-                {
-                    uiStatusMsg("%s: failed to retrieve size for secure IStorage partition! (0x%08X)", __func__, result);
-                    goto out;
-                }
-            } else {
-                // Total size for the secure IStorage partition is maxed out under SX OS, so let's try to calculate it manually
-                gameCardInfo.IStoragePartitionSizes[1] = ((gameCardInfo.size - ((gameCardInfo.size / GAMECARD_ECC_BLOCK_SIZE) * GAMECARD_ECC_DATA_SIZE)) - gameCardInfo.IStoragePartitionSizes[0]);
-            }
-        } else {
-            // The partition offset is relative to the start of the normal IStorage partition (true gamecard image start)
-            gameCardInfo.hfs0Partitions[i].offset = (gameCardInfo.header.rootHfs0HeaderOffset + gameCardInfo.header.rootHfs0HeaderSize + entry.file_offset);
-        }
-        
-        // Partially read the current HFS0 partition header
-        result = readGameCardStoragePartition(gameCardInfo.hfs0Partitions[i].offset, &header, sizeof(hfs0_header));
-        if (R_FAILED(result))
-        {
-            uiStatusMsg("%s: failed to read %lu bytes long chunk from %s HFS0 partition! (0x%08X)", __func__, sizeof(hfs0_header), GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, i), result);
-            goto out;
-        }
-        
-        // Check the HFS0 magic word
-        if (__builtin_bswap32(header.magic) != HFS0_MAGIC)
-        {
-            uiStatusMsg("%s: invalid magic word in %s HFS0 partition header! (0x%08X)", __func__, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, i), __builtin_bswap32(header.magic));
-            goto out;
-        }
+        if (!isspace((unsigned char)*end)) break;
+    }
+    
+    *(++end) = '\0';
+    
+    while(isspace((unsigned char)*start)) start++;
+    
+    if (start != str) memmove(str, start, end - start + 1);
+}
+
+bool retrieveGameCardInfo()
+{
+    u32 i;
+    char errorStr[256] = {'\0'};
+    
+    u8 major = 0, minor = 0, micro = 0;
+    u16 bugfix = 0;
+    
+    // The gamecard layout is usually parsed by the detection thread as soon as the gamecard is inserted
+    gamecard_layout_t *layout = acquireGameCardLayout();
+    if (!layout)
+    {
+        // Parse it right now if the detection thread failed to do so
+        pthread_mutex_lock(&gcLayoutMutex);
         
-        if (!header.str_table_size)
+        layout = parseGameCardLayout(gcLayoutCache, errorStr, sizeof(errorStr));
+        if (layout)
         {
-            uiStatusMsg("%s: invalid string table size in %s HFS0 partition header!", __func__, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, i));
-            goto out;
+            publishGameCardLayout(layout);
+            layout->refCount++;
         }
         
-        // Calculate the size for the HFS0 partition header and round it to a MEDIA_UNIT_SIZE bytes boundary
-        gameCardInfo.hfs0Partitions[i].header_size = (sizeof(hfs0_header) + (header.file_cnt * sizeof(hfs0_file_entry)) + header.str_table_size);
-        gameCardInfo.hfs0Partitions[i].header_size = round_up(gameCardInfo.hfs0Partitions[i].header_size, MEDIA_UNIT_SIZE);
-        
-        gameCardInfo.hfs0Partitions[i].file_cnt = header.file_cnt;
-        gameCardInfo.hfs0Partitions[i].str_table_size = header.str_table_size;
-        
-        gameCardInfo.hfs0Partitions[i].header = calloc(1, gameCardInfo.hfs0Partitions[i].header_size);
-        if (!gameCardInfo.hfs0Partitions[i].header)
-        {
-            uiStatusMsg("%s: unable to allocate memory for %s HFS0 partition header!", __func__, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, i));
-            goto out;
-        }
+        pthread_mutex_unlock(&gcLayoutMutex);
         
-        // Finally, read the full HFS0 partition header
-        result = readGameCardStoragePartition(gameCardInfo.hfs0Partitions[i].offset, gameCardInfo.hfs0Partitions[i].header, gameCardInfo.hfs0Partitions[i].header_size);
-        if (R_FAILED(result))
+        if (!layout)
         {
-            uiStatusMsg("%s: failed to read %lu bytes long %s HFS0 partition header! (0x%08X)", __func__, gameCardInfo.hfs0Partitions[i].header_size, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, i), result);
-            goto out;
+            uiStatusMsg("%s", errorStr);
+            return false;
         }
     }
     
-    // Get bundled FW version update
-    result = fsDeviceOperatorUpdatePartitionInfo(&(gameCardInfo.fsOperatorInstance), &(gameCardInfo.fsGameCardHandle), &(gameCardInfo.updateVersion), &(gameCardInfo.updateTitleId));
-    if (R_SUCCEEDED(result))
-    {
-        if (gameCardInfo.updateTitleId == GAMECARD_UPDATE_TITLEID)
-        {
-            convertTitleVersionToDotNotation(gameCardInfo.updateVersion, &major, &minor, &micro, &bugfix);
-            snprintf(gameCardInfo.updateVersionStr, MAX_CHARACTERS(gameCardInfo.updateVersionStr), "%u.%u.%u (v%u)", major, minor, micro, gameCardInfo.updateVersion);
-        } else {
-            uiStatusMsg("%s: update Title ID mismatch! (%016lX != %016lX)", __func__, gameCardInfo.updateTitleId, GAMECARD_UPDATE_TITLEID);
-        }
-    } else {
-        uiStatusMsg("%s: UpdatePartitionInfo failed! (0x%08X)", __func__, result);
-    }
+    gameCardInfo.layout = layout;
     
-    success = true;
+    memcpy(&(gameCardInfo.header), &(layout->header), sizeof(gamecard_header_t));
     
-out:
-    if (success)
+    gameCardInfo.size = layout->size;
+    convertSize(gameCardInfo.size, gameCardInfo.sizeStr, MAX_CHARACTERS(gameCardInfo.sizeStr));
+    
+    gameCardInfo.trimmedSize = layout->trimmedSize;
+    convertSize(gameCardInfo.trimmedSize, gameCardInfo.trimmedSizeStr, MAX_CHARACTERS(gameCardInfo.trimmedSizeStr));
+    
+    gameCardInfo.rootHfs0Header = layout->rootHfs0Header;
+    gameCardInfo.hfs0PartitionCnt = layout->hfs0PartitionCnt;
+    gameCardInfo.hfs0Partitions = layout->hfs0Partitions;
+    
+    for(i = 0; i < ISTORAGE_PARTITION_CNT; i++) gameCardInfo.IStoragePartitionSizes[i] = layout->IStoragePartitionSizes[i];
+    
+    // Get bundled FW version update
+    gameCardInfo.updateTitleId = layout->updateTitleId;
+    gameCardInfo.updateVersion = layout->updateVersion;
+    
+    if (gameCardInfo.updateTitleId == GAMECARD_UPDATE_TITLEID)
     {
-        closeGameCardStoragePartition();
-    } else {
-        freeGameCardInfo();
+        convertTitleVersionToDotNotation(gameCardInfo.updateVersion, &major, &minor, &micro, &bugfix);
+        snprintf(gameCardInfo.updateVersionStr, MAX_CHARACTERS(gameCardInfo.updateVersionStr), "%u.%u.%u (v%u)", major, minor, micro, gameCardInfo.updateVersion);
+    } else
+    if (gameCardInfo.updateTitleId)
+    {
+        uiStatusMsg("%s: update Title ID mismatch! (%016lX != %016lX)", __func__, gameCardInfo.updateTitleId, GAMECARD_UPDATE_TITLEID);
+    } else
+    if (!strlen(gcImagePath))
+    {
+        uiStatusMsg("%s: UpdatePartitionInfo failed!", __func__);
     }
     
-    return success;
+    return true;
 }
 
 u64 calculateSizeFromContentRecords(NcmStorageId curStorageId, NcmContentMetaType metaType, u32 ncmTitleCount, u32 ncmTitleIndex)
 {
-    if ((curStorageId != NcmStorageId_GameCard && curStorageId != NcmStorageId_SdCard && curStorageId != NcmStorageId_BuiltInUser) || (metaType != NcmContentMetaType_Application && metaType != NcmContentMetaType_Patch && metaType != NcmContentMetaType_AddOnContent) || ncmTitleIndex >= ncmTitleCount) return 0;
+    if ((curStorageId != NcmStorageId_GameCard && curStorageId != NcmStorageId_SdCard && curStorageId != NcmStorageId_BuiltInUser && curStorageId != LOCAL_CONTENT_STORAGE_ID) || (metaType != NcmContentMetaType_Application && metaType != NcmContentMetaType_Patch && metaType != NcmContentMetaType_AddOnContent) || ncmTitleIndex >= ncmTitleCount) return 0;
     
     NcmContentInfo *titleContentInfos = NULL;
     u32 i, titleContentInfoCnt = 0;
@@ -1920,6 +2628,50 @@ u64 calculateSizeFromContentRecords(NcmStorageId curStorageId, NcmContentMetaTyp
     return outSize;
 }
 
+// Checks if titles from the provided storage are dumped when using the provided batch mode source storage
+bool isBatchModeSourceStorage(batchModeSourceStorage batchModeSrc, NcmStorageId storageId)
+{
+    switch(batchModeSrc)
+    {
+        case BATCH_SOURCE_ALL:
+            return (storageId == NcmStorageId_SdCard || storageId == NcmStorageId_BuiltInUser);
+        case BATCH_SOURCE_SDCARD:
+            return (storageId == NcmStorageId_SdCard);
+        case BATCH_SOURCE_EMMC:
+            return (storageId == NcmStorageId_BuiltInUser);
+        case BATCH_SOURCE_LOCAL:
+            return (storageId == LOCAL_CONTENT_STORAGE_ID);
+        default:
+            break;
+    }
+    
+    return false;
+}
+
+// Returns the number of titles from the provided category available in a batch mode source storage
+u32 getBatchModeSourceTitleCount(batchModeSourceStorage batchModeSrc, nspDumpType titleType)
+{
+    u32 sdCardCount = (titleType == DUMP_APP_NSP ? sdCardTitleAppCount : (titleType == DUMP_PATCH_NSP ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
+    u32 emmcCount = (titleType == DUMP_APP_NSP ? emmcTitleAppCount : (titleType == DUMP_PATCH_NSP ? emmcTitlePatchCount : emmcTitleAddOnCount));
+    u32 localCount = (titleType == DUMP_APP_NSP ? localTitleAppCount : (titleType == DUMP_PATCH_NSP ? localTitlePatchCount : localTitleAddOnCount));
+    
+    switch(batchModeSrc)
+    {
+        case BATCH_SOURCE_ALL:
+            return (sdCardCount + emmcCount);
+        case BATCH_SOURCE_SDCARD:
+            return sdCardCount;
+        case BATCH_SOURCE_EMMC:
+            return emmcCount;
+        case BATCH_SOURCE_LOCAL:
+            return localCount;
+        default:
+            break;
+    }
+    
+    return 0;
+}
+
 int baseAppCmp(const void *a, const void *b)
 {
 	base_app_ctx_t *baseApp1 = (base_app_ctx_t*)a;
@@ -1956,13 +2708,14 @@ void loadTitleInfo()
         
         if (!gameCardInfo.isInserted) return;
         
-        /* Don't access the gamecard immediately to avoid conflicts with the fsp-srv, ncm and ns services */
-        uiPleaseWait(GAMECARD_WAIT_TIME);
+        /* The detection thread waits a bit before accessing a freshly inserted gamecard, so we don't have to */
+        uiPleaseWait(0);
         
         proceed = retrieveGameCardInfo();
         changeAtomicBool(&gameCardInfoLoaded, true);
         
-        if (proceed) proceed = getTitleIDAndVersionList(NcmStorageId_GameCard, true, true, true);
+        // Titles are retrieved through ncm, which knows nothing about XCI image files
+        if (proceed && !strlen(gcImagePath)) proceed = getTitleIDAndVersionList(NcmStorageId_GameCard, true, true, true);
     } else
     if (menuType == MENUTYPE_SDCARD_EMMC)
     {
@@ -1984,6 +2737,14 @@ void loadTitleInfo()
                 emmcTitlePatchCount = (titlePatchCount - sdCardTitlePatchCount);
                 emmcTitleAddOnCount = (titleAddOnCount - sdCardTitleAddOnCount);
                 
+                // Titles from the local content storage are listed after the eMMC titles, if there are any
+                if (loadLocalContentStorage() && getTitleIDAndVersionList(LOCAL_CONTENT_STORAGE_ID, true, true, true))
+                {
+                    localTitleAppCount = (titleAppCount - sdCardTitleAppCount - emmcTitleAppCount);
+                    localTitlePatchCount = (titlePatchCount - sdCardTitlePatchCount - emmcTitlePatchCount);
+                    localTitleAddOnCount = (titleAddOnCount - sdCardTitleAddOnCount - emmcTitleAddOnCount);
+                }
+                
                 proceed = true;
             }
         }
@@ -2004,10 +2765,16 @@ void loadTitleInfo()
                 strtrim(baseAppEntries[i].author);
                 snprintf(baseAppEntries[i].fixedName, MAX_CHARACTERS(baseAppEntries[i].fixedName), baseAppEntries[i].name);
                 removeIllegalCharacters(baseAppEntries[i].fixedName);
+            } else
+            if (baseAppEntries[i].storageId == LOCAL_CONTENT_STORAGE_ID)
+            {
+                // Titles from the local content storage aren't installed, so ns doesn't know about them
+                snprintf(baseAppEntries[i].name, MAX_CHARACTERS(baseAppEntries[i].name), "%016lX", baseAppEntries[i].titleId);
+                snprintf(baseAppEntries[i].fixedName, MAX_CHARACTERS(baseAppEntries[i].fixedName), baseAppEntries[i].name);
             }
             
             // Retrieve base application content size
-            ncmTitleCount = (baseAppEntries[i].storageId == NcmStorageId_GameCard ? titleAppCount : (baseAppEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitleAppCount : emmcTitleAppCount));
+            ncmTitleCount = (baseAppEntries[i].storageId == NcmStorageId_GameCard ? titleAppCount : (baseAppEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitleAppCount : (baseAppEntries[i].storageId == LOCAL_CONTENT_STORAGE_ID ? localTitleAppCount : emmcTitleAppCount)));
             baseAppEntries[i].contentSize = calculateSizeFromContentRecords(baseAppEntries[i].storageId, NcmContentMetaType_Application, ncmTitleCount, baseAppEntries[i].ncmIndex);
             convertSize(baseAppEntries[i].contentSize, baseAppEntries[i].contentSizeStr, MAX_CHARACTERS(baseAppEntries[i].contentSizeStr));
         }
@@ -2018,7 +2785,7 @@ void loadTitleInfo()
         for(i = 0; i < titlePatchCount; i++)
         {
             // Retrieve patch content size
-            ncmTitleCount = (patchEntries[i].storageId == NcmStorageId_GameCard ? titlePatchCount : (patchEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitlePatchCount : emmcTitlePatchCount));
+            ncmTitleCount = (patchEntries[i].storageId == NcmStorageId_GameCard ? titlePatchCount : (patchEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitlePatchCount : (patchEntries[i].storageId == LOCAL_CONTENT_STORAGE_ID ? localTitlePatchCount : emmcTitlePatchCount)));
             patchEntries[i].contentSize = calculateSizeFromContentRecords(patchEntries[i].storageId, NcmContentMetaType_Patch, ncmTitleCount, patchEntries[i].ncmIndex);
             convertSize(patchEntries[i].contentSize, patchEntries[i].contentSizeStr, MAX_CHARACTERS(patchEntries[i].contentSizeStr));
         }
@@ -2026,7 +2793,7 @@ void loadTitleInfo()
         for(i = 0; i < titleAddOnCount; i++)
         {
             // Retrieve add-on content size
-            ncmTitleCount = (addOnEntries[i].storageId == NcmStorageId_GameCard ? titleAddOnCount : (addOnEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
+            ncmTitleCount = (addOnEntries[i].storageId == NcmStorageId_GameCard ? titleAddOnCount : (addOnEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitleAddOnCount : (addOnEntries[i].storageId == LOCAL_CONTENT_STORAGE_ID ? localTitleAddOnCount : emmcTitleAddOnCount)));
             addOnEntries[i].contentSize = calculateSizeFromContentRecords(addOnEntries[i].storageId, NcmContentMetaType_AddOnContent, ncmTitleCount, addOnEntries[i].ncmIndex);
             convertSize(addOnEntries[i].contentSize, addOnEntries[i].contentSizeStr, MAX_CHARACTERS(addOnEntries[i].contentSizeStr));
         }
@@ -2132,48 +2899,40 @@ bool getHfs0FileList(u32 partition)
 
 // Used to retrieve data from files in the HFS0 Secure partition
 // An IStorage instance must have been opened beforehand
-bool readFileFromSecureHfs0PartitionByName(const char *filename, u64 offset, void *outBuf, size_t bufSize)
+// If 'streamBuf' is provided, the data is read into '*streamBuf' using the gamecard read-ahead (see readGameCardStoragePartitionStream())
+static bool readFileFromSecureHfs0Partition(const char *filename, u64 offset, void *outBuf, u8 **streamBuf, size_t bufSize)
 {
+    if (streamBuf) outBuf = *streamBuf;
+    
     if (!gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[gameCardInfo.hfs0PartitionCnt - 1].header || !gameCardInfo.hfs0Partitions[gameCardInfo.hfs0PartitionCnt - 1].header_size || !gameCardInfo.hfs0Partitions[gameCardInfo.hfs0PartitionCnt - 1].file_cnt || !gameCardInfo.hfs0Partitions[gameCardInfo.hfs0PartitionCnt - 1].str_table_size || !filename || !strlen(filename) || !outBuf || !bufSize)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to read file from Secure HFS0 partition!", __func__);
         return false;
     }
     
-    u32 i;
     Result result;
-    hfs0_file_entry entry;
-    
-    bool proceed = true, found = false;
     
     u32 partition = (gameCardInfo.hfs0PartitionCnt - 1); // Select the Secure HFS0 partition
     
-    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
+    hfs0_file_index_entry *entry = getGameCardFileIndexEntry(partition, filename);
+    if (!entry)
     {
-        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
-        
-        char *cur_filename = (char*)(gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (gameCardInfo.hfs0Partitions[partition].file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
-        
-        if (strncasecmp(cur_filename, filename, strlen(filename)) != 0) continue;
-        
-        found = true;
-        
-        if (!entry.file_size || (offset + bufSize) > entry.file_size)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid file size for \"%s\"!", __func__, filename);
-            proceed = false;
-        }
-        
-        break;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find file \"%s\" in Secure HFS0 partition!", __func__, filename);
+        return false;
     }
     
-    if (!proceed || !found)
+    if (!entry->size || (offset + bufSize) > entry->size)
     {
-        if (proceed && !found) uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find file \"%s\" in Secure HFS0 partition!", __func__, filename);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid file size for \"%s\"!", __func__, filename);
         return false;
     }
     
-    result = readGameCardStoragePartition(gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset + offset, outBuf, bufSize);
+    if (streamBuf)
+    {
+        result = readGameCardStoragePartitionStream(entry->offset + offset, streamBuf, bufSize);
+    } else {
+        result = readGameCardStoragePartition(entry->offset + offset, outBuf, bufSize);
+    }
     if (R_FAILED(result))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read file \"%s\"! (0x%08X)", __func__, filename, result);
@@ -2183,6 +2942,16 @@ bool readFileFromSecureHfs0PartitionByName(const char *filename, u64 offset, voi
     return true;
 }
 
+bool readFileFromSecureHfs0PartitionByName(const char *filename, u64 offset, void *outBuf, size_t bufSize)
+{
+    return readFileFromSecureHfs0Partition(filename, offset, outBuf, NULL, bufSize);
+}
+
+bool readFileFromSecureHfs0PartitionByNameStream(const char *filename, u64 offset, u8 **outBuf, size_t bufSize)
+{
+    return readFileFromSecureHfs0Partition(filename, offset, NULL, outBuf, bufSize);
+}
+
 bool calculateExeFsExtractedDataSize(u64 *out)
 {
     if (!exeFsContext.exefs_header.file_cnt || !exeFsContext.exefs_entries || !out)
@@ -2307,7 +3076,7 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
     
     bool success = false;
     
-    if (storageId != NcmStorageId_GameCard && storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser)
+    if (storageId != NcmStorageId_GameCard && storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser && storageId != LOCAL_CONTENT_STORAGE_ID)
     {
         snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title storage ID!", __func__);
         goto out;
@@ -2344,14 +3113,14 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
         goto out;
     }
     
-    result = ncmOpenContentMetaDatabase(&ncmDb, storageId);
+    result = ncmLocalOpenContentMetaDatabase(&ncmDb, storageId);
     if (R_FAILED(result))
     {
         snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmOpenContentMetaDatabase failed! (0x%08X)", __func__, result);
         goto out;
     }
     
-    result = ncmContentMetaDatabaseListApplication(&ncmDb, (s32*)&total, (s32*)&written, titleList, (s32)titleCount, metaType);
+    result = ncmLocalContentMetaDatabaseListApplication(&ncmDb, (s32*)&total, (s32*)&written, titleList, (s32)titleCount, metaType);
     if (R_FAILED(result))
     {
         snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseListApplication failed! (0x%08X)", __func__, result);
@@ -2376,7 +3145,7 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
         goto out;
     }
     
-    result = ncmContentMetaDatabaseGet(&ncmDb, &(titleList[titleIndex].key), &cnmtHeaderReadSize, &cnmtHeader, sizeof(NcmContentMetaHeader));
+    result = ncmLocalContentMetaDatabaseGet(&ncmDb, &(titleList[titleIndex].key), &cnmtHeaderReadSize, &cnmtHeader, sizeof(NcmContentMetaHeader));
     if (R_FAILED(result))
     {
         snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseGet failed! (0x%08X)", __func__, result);
@@ -2394,7 +3163,7 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
     
     written = 0;
     
-    result = ncmContentMetaDatabaseListContentInfo(&ncmDb, (s32*)&written, titleContentInfos, (s32)titleContentInfoCnt, &(titleList[titleIndex].key), 0);
+    result = ncmLocalContentMetaDatabaseListContentInfo(&ncmDb, (s32*)&written, titleContentInfos, (s32)titleContentInfoCnt, &(titleList[titleIndex].key), 0);
     if (R_FAILED(result))
     {
         snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseListContentInfo failed! (0x%08X)", __func__, result);
@@ -2667,6 +3436,9 @@ bool readNcaExeFsSection(u32 titleIndex, bool usePatch)
         case NcmStorageId_BuiltInUser:
             titleCount = (!usePatch ? emmcTitleAppCount : emmcTitlePatchCount);
             break;
+        case LOCAL_CONTENT_STORAGE_ID:
+            titleCount = (!usePatch ? localTitleAppCount : localTitlePatchCount);
+            break;
         default:
             break;
     }
@@ -2708,7 +3480,7 @@ bool readNcaExeFsSection(u32 titleIndex, bool usePatch)
     uiRefreshDisplay();
     breaks++;*/
     
-    result = ncmOpenContentStorage(&ncmStorage, curStorageId);
+    result = ncmLocalOpenContentStorage(&ncmStorage, curStorageId);
     if (R_FAILED(result))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
@@ -2723,7 +3495,7 @@ bool readNcaExeFsSection(u32 titleIndex, bool usePatch)
     }
     
     // Decrypt the NCA header
-    if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard || (curStorageId == NcmStorageId_GameCard && usePatch)))) goto out;
+    if (!decryptNcaHeader(&ncaId, ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard || (curStorageId == NcmStorageId_GameCard && usePatch)), curStorageId)) goto out;
     
     if (curStorageId == NcmStorageId_GameCard)
     {
@@ -2836,6 +3608,9 @@ int readNcaRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, int desi
         case NcmStorageId_BuiltInUser:
             titleCount = (curRomFsType == ROMFS_TYPE_APP ? emmcTitleAppCount : (curRomFsType == ROMFS_TYPE_PATCH ? emmcTitlePatchCount : emmcTitleAddOnCount));
             break;
+        case LOCAL_CONTENT_STORAGE_ID:
+            titleCount = (curRomFsType == ROMFS_TYPE_APP ? localTitleAppCount : (curRomFsType == ROMFS_TYPE_PATCH ? localTitlePatchCount : localTitleAddOnCount));
+            break;
         default:
             break;
     }
@@ -2877,7 +3652,7 @@ int readNcaRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, int desi
     uiRefreshDisplay();
     breaks++;*/
     
-    result = ncmOpenContentStorage(&ncmStorage, curStorageId);
+    result = ncmLocalOpenContentStorage(&ncmStorage, curStorageId);
     if (R_FAILED(result))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
@@ -2892,7 +3667,7 @@ int readNcaRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, int desi
     }
     
     // Decrypt the NCA header
-    if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard || (curStorageId == NcmStorageId_GameCard && curRomFsType == ROMFS_TYPE_PATCH)))) goto out;
+    if (!decryptNcaHeader(&ncaId, ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard || (curStorageId == NcmStorageId_GameCard && curRomFsType == ROMFS_TYPE_PATCH)), curStorageId)) goto out;
     
     if (curStorageId == NcmStorageId_GameCard)
     {
@@ -3256,7 +4031,7 @@ out:
 
 char *generateGameCardDumpName(bool useBrackets)
 {
-    if (menuType != MENUTYPE_GAMECARD || !titleAppCount || !baseAppEntries) return NULL;
+    if (menuType != MENUTYPE_GAMECARD) return NULL;
     
     u32 i, j;
     
@@ -3266,6 +4041,16 @@ char *generateGameCardDumpName(bool useBrackets)
     
     size_t strsize = NAME_BUF_LEN;
     
+    // There's no title list for XCI image files, so the package ID is used instead
+    if (strlen(gcImagePath) && (!titleAppCount || !baseAppEntries))
+    {
+        fullname = calloc(strsize + 1, sizeof(char));
+        if (fullname) snprintf(fullname, strsize, (useBrackets ? "GameCard [%016lX]" : "GameCard (%016lX)"), gameCardInfo.header.packageId);
+        return fullname;
+    }
+    
+    if (!titleAppCount || !baseAppEntries) return NULL;
+    
     fullname = calloc(strsize + 1, sizeof(char));
     if (!fullname) return NULL;
     
@@ -3704,6 +4489,8 @@ u32 retrieveLastPatchOrAddOnIndexFromBaseApplication(u32 appIndex, bool addOn)
 
 void waitForButtonPress()
 {
+    if (headlessMode) return;
+    
     uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Press any button to continue");
     
     /* Don't consider stick movement as button inputs. */
@@ -3834,6 +4621,280 @@ bool checkIfFileExists(const char *path)
     return false;
 }
 
+FILE *openDumpOutputFile(const char *path, u64 size)
+{
+    if (!path || !strlen(path)) return NULL;
+    
+    FILE *outFile = fopen(path, "wb");
+    if (!outFile) return NULL;
+    
+    // Files big enough to be preallocated get a large stdio buffer, so data reaches the filesystem in large blocks
+    // The buffer never exceeds the file size, and smaller files keep the default buffer to avoid a big allocation per file (e.g. RomFS dumps)
+    if (size >= OUTPUT_FILE_PREALLOC_THRESHOLD)
+    {
+        u64 bufSize = getTransferWriteChunkSize();
+        if (bufSize > size) bufSize = size;
+        setvbuf(outFile, NULL, _IOFBF, (size_t)bufSize);
+    }
+    
+    // Preallocate the output file to its final size
+    // This avoids growing the file (and updating the FAT) on every single write, and makes us fail early if there's not enough free space
+    if (size >= OUTPUT_FILE_PREALLOC_THRESHOLD && ftruncate(fileno(outFile), (off_t)size) != 0)
+    {
+        fclose(outFile);
+        remove(path);
+        return NULL;
+    }
+    
+    return outFile;
+}
+
+transferSource getTransferSourceFromStorageId(NcmStorageId storageId)
+{
+    // Local content storage titles are read straight from files on the SD card
+    return (storageId == NcmStorageId_GameCard ? TRANSFER_SOURCE_GAMECARD : ((storageId == NcmStorageId_SdCard || storageId == LOCAL_CONTENT_STORAGE_ID) ? TRANSFER_SOURCE_SDCARD : TRANSFER_SOURCE_EMMC));
+}
+
+u64 getTransferChunkSize(transferSource src)
+{
+    if (src >= TRANSFER_SOURCE_CNT || !dumpCfg.transferCfg.readChunkSize[src]) return DUMP_BUFFER_SIZE;
+    return (u64)dumpCfg.transferCfg.readChunkSize[src];
+}
+
+u64 getTransferWriteChunkSize()
+{
+    if (!dumpCfg.transferCfg.writeChunkSize) return OUTPUT_FILE_BUFFER_SIZE;
+    return (u64)dumpCfg.transferCfg.writeChunkSize;
+}
+
+u64 getTransferThroughput(transferSource src)
+{
+    u64 readSpeed = ((src < TRANSFER_SOURCE_CNT && dumpCfg.transferCfg.readSpeed[src]) ? (u64)((double)dumpCfg.transferCfg.readSpeed[src] * KiB) : TRANSFER_DEFAULT_SPEED);
+    u64 writeSpeed = (dumpCfg.transferCfg.writeSpeed ? (u64)((double)dumpCfg.transferCfg.writeSpeed * KiB) : TRANSFER_DEFAULT_SPEED);
+    
+    // Reads and writes overlap, so the slowest side dictates the dump speed
+    return (readSpeed < writeSpeed ? readSpeed : writeSpeed);
+}
+
+// Returns the read throughput (in MiB/s) achieved with the provided chunk size, or zero if a read error occurred
+static double measureReadThroughput(transferSource src, NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 dataOffset, u64 chunkSize)
+{
+    Result result = 0;
+    u64 off, n = chunkSize;
+    u64 start = armGetSystemTick();
+    
+    for(off = 0; off < TRANSFER_CALIBRATION_SIZE; off += n)
+    {
+        if (n > (TRANSFER_CALIBRATION_SIZE - off)) n = (TRANSFER_CALIBRATION_SIZE - off);
+        
+        if (src == TRANSFER_SOURCE_GAMECARD)
+        {
+            result = readGameCardStoragePartition(dataOffset + off, dumpBuf, n);
+        } else {
+            result = ncmContentStorageReadContentIdFile(ncmStorage, dumpBuf, n, ncaId, dataOffset + off);
+        }
+        
+        if (R_FAILED(result)) return 0;
+    }
+    
+    u64 elapsed = armTicksToNs(armGetSystemTick() - start);
+    if (!elapsed) return 0;
+    
+    return (((double)TRANSFER_CALIBRATION_SIZE / (double)MiB) / ((double)elapsed / 1000000000.0));
+}
+
+// Returns the SD card write throughput (in MiB/s) achieved with the provided chunk size, or zero if a write error occurred
+static double measureWriteThroughput(u64 chunkSize)
+{
+    u64 off, n = chunkSize;
+    bool success = true;
+    
+    FILE *calibrationFile = fopen(TRANSFER_CALIBRATION_PATH, "wb");
+    if (!calibrationFile) return 0;
+    
+    // Bypass the stdio buffer, we want to measure the actual write size
+    setvbuf(calibrationFile, NULL, _IONBF, 0);
+    
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    u64 start = armGetSystemTick();
+    
+    for(off = 0; off < TRANSFER_CALIBRATION_SIZE; off += n)
+    {
+        if (n > (TRANSFER_CALIBRATION_SIZE - off)) n = (TRANSFER_CALIBRATION_SIZE - off);
+        
+        if (fwrite(dumpBuf, 1, n, calibrationFile) != n)
+        {
+            success = false;
+            break;
+        }
+    }
+    
+    fclose(calibrationFile);
+    
+    u64 elapsed = armTicksToNs(armGetSystemTick() - start);
+    
+    remove(TRANSFER_CALIBRATION_PATH);
+    
+    if (!success || !elapsed) return 0;
+    
+    return (((double)TRANSFER_CALIBRATION_SIZE / (double)MiB) / ((double)elapsed / 1000000000.0));
+}
+
+// Retrieves the ID of the biggest content file available in the provided content storage
+static bool getBiggestContentIdFromStorage(NcmContentStorage *ncmStorage, NcmContentId *outId, u64 *outSize)
+{
+    NcmContentId contentIds[32];
+    s32 contentIdCnt = 0, startOffset = 0, i;
+    s64 contentSize = 0;
+    
+    *outSize = 0;
+    
+    // Page through the whole content storage
+    do {
+        if (R_FAILED(ncmContentStorageListContentId(ncmStorage, &contentIdCnt, contentIds, MAX_ELEMENTS(contentIds), startOffset))) break;
+        
+        for(i = 0; i < contentIdCnt; i++)
+        {
+            if (R_FAILED(ncmContentStorageGetSizeFromContentId(ncmStorage, &contentSize, &(contentIds[i])))) continue;
+            
+            if ((u64)contentSize > *outSize)
+            {
+                memcpy(outId, &(contentIds[i]), sizeof(NcmContentId));
+                *outSize = (u64)contentSize;
+            }
+        }
+        
+        startOffset += contentIdCnt;
+    } while(contentIdCnt == (s32)MAX_ELEMENTS(contentIds));
+    
+    return (*outSize > 0);
+}
+
+void calibrateTransferChunkSizes(transferSource src)
+{
+    if (src >= TRANSFER_SOURCE_CNT || dumpCfg.transferCfg.readChunkSize[src]) return;
+    
+    const char *sourceNames[TRANSFER_SOURCE_CNT] = { "gamecard", "SD card", "eMMC" };
+    
+    Result result;
+    u32 i;
+    double speed, bestSpeed;
+    u64 chunkSize, dataSize = 0;
+    
+    NcmContentStorage ncmStorage;
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    NcmContentId ncaId;
+    
+    bool closePartition = false, closeStorage = false;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Calibrating read chunk size (%s), please wait...", sourceNames[src]);
+    uiRefreshDisplay();
+    breaks++;
+    
+    if (src == TRANSFER_SOURCE_GAMECARD)
+    {
+        // Use the currently opened IStorage partition, or the secure one if none is available
+        if (!gameCardInfo.curIStorageIndex || gameCardInfo.curIStorageIndex >= ISTORAGE_PARTITION_INVALID)
+        {
+            result = openGameCardStoragePartition(ISTORAGE_PARTITION_SECURE);
+            closePartition = R_SUCCEEDED(result);
+        }
+        
+        if (R_FAILED(getGameCardStoragePartitionSize(&dataSize))) dataSize = 0;
+    } else {
+        result = ncmOpenContentStorage(&ncmStorage, (src == TRANSFER_SOURCE_SDCARD ? NcmStorageId_SdCard : NcmStorageId_BuiltInUser));
+        if (R_SUCCEEDED(result))
+        {
+            closeStorage = true;
+            if (!getBiggestContentIdFromStorage(&ncmStorage, &ncaId, &dataSize)) dataSize = 0;
+        }
+    }
+    
+    // Each chunk size is measured using a different data region, in order to avoid hitting any caches
+    // If there's not enough data available, the default chunk size is kept
+    chunkSize = DUMP_BUFFER_SIZE;
+    bestSpeed = 0;
+    
+    if (dataSize >= (TRANSFER_CALIBRATION_SIZE * 2))
+    {
+        u64 regionCnt = (dataSize / TRANSFER_CALIBRATION_SIZE);
+        
+        for(i = 0; (TRANSFER_CHUNK_SIZE_MIN << i) <= DUMP_BUFFER_SIZE; i++)
+        {
+            speed = measureReadThroughput(src, &ncmStorage, &ncaId, (u64)(i % regionCnt) * TRANSFER_CALIBRATION_SIZE, TRANSFER_CHUNK_SIZE_MIN << i);
+            if (speed > bestSpeed)
+            {
+                bestSpeed = speed;
+                chunkSize = (TRANSFER_CHUNK_SIZE_MIN << i);
+            }
+        }
+    }
+    
+    dumpCfg.transferCfg.readChunkSize[src] = (u32)chunkSize;
+    dumpCfg.transferCfg.readSpeed[src] = (u32)(bestSpeed * KiB);
+    
+    if (closePartition) closeGameCardStoragePartition();
+    if (closeStorage) ncmContentStorageClose(&ncmStorage);
+    
+    // Cache the results
+    saveConfig();
+    
+    // Remove the calibration message from the screen
+    breaks--;
+    uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+}
+
+// Writes TRANSFER_CALIBRATION_SIZE bytes to the SD card per chunk size, which is why this is never performed in the middle of a dump
+static void calibrateTransferWriteChunkSize()
+{
+    if (dumpCfg.transferCfg.writeChunkSize) return;
+    
+    u32 i;
+    double speed, bestSpeed = 0;
+    u64 chunkSize = OUTPUT_FILE_BUFFER_SIZE;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Calibrating write chunk size (SD card), please wait...");
+    uiRefreshDisplay();
+    breaks++;
+    
+    if (freeSpace > (TRANSFER_CALIBRATION_SIZE * 2))
+    {
+        for(i = 0; (TRANSFER_CHUNK_SIZE_MIN << i) <= DUMP_BUFFER_SIZE; i++)
+        {
+            speed = measureWriteThroughput(TRANSFER_CHUNK_SIZE_MIN << i);
+            if (speed > bestSpeed)
+            {
+                bestSpeed = speed;
+                chunkSize = (TRANSFER_CHUNK_SIZE_MIN << i);
+            }
+        }
+    }
+    
+    dumpCfg.transferCfg.writeChunkSize = (u32)chunkSize;
+    dumpCfg.transferCfg.writeSpeed = (u32)(bestSpeed * KiB);
+    
+    // Cache the results
+    saveConfig();
+    
+    // Remove the calibration message from the screen
+    breaks--;
+    uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+}
+
+void calibrateAllTransferChunkSizes(bool force)
+{
+    // Discard the cached results
+    if (force) memset(&(dumpCfg.transferCfg), 0, sizeof(transferOptions));
+    
+    // Gamecards are calibrated right before their first dump, since they may not be inserted (or loaded) at this point
+    // That only involves reads, so no data gets written to the SD card in the middle of the dump
+    calibrateTransferChunkSizes(TRANSFER_SOURCE_SDCARD);
+    calibrateTransferChunkSizes(TRANSFER_SOURCE_EMMC);
+    
+    calibrateTransferWriteChunkSize();
+}
+
 bool yesNoPrompt(const char *message)
 {
     if (message && strlen(message))
@@ -3842,6 +4903,14 @@ bool yesNoPrompt(const char *message)
         breaks++;
     }
     
+    if (headlessMode)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Job file: answering \"%s\" automatically.", (headlessPromptAnswer ? "Yes" : "No"));
+        breaks += 2;
+        uiRefreshDisplay();
+        return headlessPromptAnswer;
+    }
+    
     uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ %s ] Yes | [ %s ] No", NINTENDO_FONT_A, NINTENDO_FONT_B);
     breaks += 2;
     
@@ -3,8 +3,11 @@
 #ifndef __UTIL_H__
 #define __UTIL_H__
 
+#include <stdio.h>
+#include <pthread.h>
 #include <switch.h>
 #include "nca.h"
+#include "xci_image.h"
 
 #define HBLOADER_BASE_PATH              "sdmc:/switch/"
 #define APP_BASE_PATH                   HBLOADER_BASE_PATH APP_TITLE "/"
@@ -16,8 +19,10 @@
 #define CERT_DUMP_PATH                  APP_BASE_PATH "Certificate/"
 #define BATCH_OVERRIDES_PATH            NSP_DUMP_PATH "BatchOverrides/"
 #define TICKET_PATH                     APP_BASE_PATH "Ticket/"
+#define BIS_DUMP_PATH                   APP_BASE_PATH "BIS/"
 
 #define CONFIG_PATH                     APP_BASE_PATH "config.bin"
+#define TRANSFER_CALIBRATION_PATH       APP_BASE_PATH "calibration.bin"
 #define NRO_NAME                        APP_TITLE ".nro"
 #define NRO_PATH                        APP_BASE_PATH NRO_NAME
 #define NSWDB_XML_PATH                  APP_BASE_PATH "NSWreleases.xml"
@@ -54,9 +59,18 @@
 
 #define DUMP_BUFFER_SIZE                (u64)0x400000		                    // 4 MiB (4194304 bytes)
 
-#define GAMECARD_READ_BUFFER_SIZE       DUMP_BUFFER_SIZE                        // 4 MiB (4194304 bytes)
+#define GAMECARD_READ_BUFFER_SIZE       MEDIA_UNIT_SIZE                         // Only used to bounce the misaligned head / tail of a gamecard read
+#define GAMECARD_READ_AHEAD_SIZE        DUMP_BUFFER_SIZE                        // Prefetch buffer swapped with dumpBuf by readGameCardImage() / readGameCardStoragePartitionStream()
 
 #define NCA_CTR_BUFFER_SIZE             DUMP_BUFFER_SIZE                        // 4 MiB (4194304 bytes)
+#define NCA_CTR_THREAD_BUFFER_SIZE      (u64)0x100000                           // 1 MiB (1048576 bytes). Used by worker threads that decrypt NCA sections
+
+#define OUTPUT_FILE_BUFFER_SIZE         DUMP_BUFFER_SIZE                        // 4 MiB (4194304 bytes). Full dump buffer writes bypass the stdio buffer, smaller writes get coalesced
+
+#define TRANSFER_CHUNK_SIZE_MIN         (u64)0x40000                            // 256 KiB (262144 bytes). Transfer chunk sizes are calibrated between this value and DUMP_BUFFER_SIZE
+#define TRANSFER_CALIBRATION_SIZE       (u64)0x1000000                          // 16 MiB (16777216 bytes). Data transferred per chunk size during calibration
+#define TRANSFER_DEFAULT_SPEED          (u64)0x1400000                          // 20 MiB/s (20971520 bytes). Used to estimate dump times if the throughput for a source couldn't be measured
+#define OUTPUT_FILE_PREALLOC_THRESHOLD  OUTPUT_FILE_BUFFER_SIZE                 // Output files smaller than this aren't preallocated
 
 #define NSP_XML_BUFFER_SIZE             (u64)0xA00000                           // 10 MiB (10485760 bytes)
 
@@ -67,26 +81,12 @@
 #define NACP_AUTHOR_LEN                 0x100
 #define VERSION_STR_LEN                 0x40
 
-#define MEDIA_UNIT_SIZE                 0x200
-
 #define ISTORAGE_PARTITION_CNT          2
 
 #define GAMECARD_WAIT_TIME              3                                       // 3 seconds
 
-#define GAMECARD_HEADER_MAGIC           (u32)0x48454144                         // "HEAD"
-
-#define GAMECARD_SIZE_1GiB              (u64)0x40000000
-#define GAMECARD_SIZE_2GiB              (u64)0x80000000
-#define GAMECARD_SIZE_4GiB              (u64)0x100000000
-#define GAMECARD_SIZE_8GiB              (u64)0x200000000
-#define GAMECARD_SIZE_16GiB             (u64)0x400000000
-#define GAMECARD_SIZE_32GiB             (u64)0x800000000
-
 #define GAMECARD_UPDATE_TITLEID         (u64)0x0100000000000816
 
-#define GAMECARD_ECC_BLOCK_SIZE         (u64)0x200                              // 512 bytes
-#define GAMECARD_ECC_DATA_SIZE          (u64)0x24                               // 36 bytes
-
 #define GAMECARD_TYPE1_PARTITION_CNT    3                                       // "update" (0), "normal" (1), "secure" (2)
 #define GAMECARD_TYPE2_PARTITION_CNT    4                                       // "update" (0), "logo" (1), "normal" (2), "secure" (3)
 #define GAMECARD_TYPE(x)                ((x) == GAMECARD_TYPE1_PARTITION_CNT ? "Type 0x01" : ((x) == GAMECARD_TYPE2_PARTITION_CNT ? "Type 0x02" : "Unknown"))
@@ -114,33 +114,12 @@
 #define BIS_COMMON_TIK_SAVE_NAME        BIS_MOUNT_NAME "/save/80000000000000e1"
 #define BIS_PERSONALIZED_TIK_SAVE_NAME  BIS_MOUNT_NAME "/save/80000000000000e2"
 
+#define BIS_PARTITION_NAME(x)           ((x) == BIS_PARTITION_PRODINFO ? "PRODINFO" : ((x) == BIS_PARTITION_PRODINFOF ? "PRODINFOF" : ((x) == BIS_PARTITION_SAFE ? "SAFE" : ((x) == BIS_PARTITION_SYSTEM ? "SYSTEM" : ((x) == BIS_PARTITION_USER ? "USER" : "Unknown")))))
+
 #define SMOOTHING_FACTOR                (double)0.1
 
 #define CANCEL_BTN_SEC_HOLD             2                           // The cancel button must be held for at least CANCEL_BTN_SEC_HOLD seconds to cancel an ongoing operation
 
-typedef struct {
-    u8 signature[0x100];
-    u32 magic;
-    u32 secureAreaStartAddr;
-    u32 backupAreaStartAddr;
-    u8 titleKeyIndex;
-    u8 size;
-    u8 headerVersion;
-    u8 flags;
-    u64 packageId;
-    u64 validDataEndAddr;
-    u8 iv[0x10];
-    u64 rootHfs0HeaderOffset;
-    u64 rootHfs0HeaderSize;
-    u8 rootHfs0HeaderHash[SHA256_HASH_SIZE];
-    u8 initialDataHash[SHA256_HASH_SIZE];
-    u32 securityMode;
-    u32 t1KeyIndex;
-    u32 keyIndex;
-    u32 normalAreaEndAddr;
-    u8 encryptedInfoBlock[0x70];
-} PACKED gamecard_header_t;
-
 typedef struct {
     u64 offset;
     u64 size;
@@ -157,14 +136,73 @@ typedef enum {
     ISTORAGE_PARTITION_INVALID
 } openIStoragePartition;
 
+typedef struct {
+    char *name;                                                 // Points to the string table from the HFS0 partition header
+    u32 partition;                                              // HFS0 partition index
+    u32 index;                                                  // HFS0 file entry index
+    u64 offset;                                                 // Relative to the start of the IStorage partition that holds the HFS0 partition
+    u64 size;
+} hfs0_file_index_entry;
+
+// Parsed once per gamecard insertion by the gamecard detection thread, and reused if the same gamecard is inserted again (keyed by package ID)
+typedef struct {
+    u64 packageId;
+    u32 refCount;
+    gamecard_header_t header;
+    u64 size;
+    u64 trimmedSize;
+    u8 *rootHfs0Header;
+    u32 hfs0PartitionCnt;
+    hfs0_partition_info *hfs0Partitions;
+    u64 IStoragePartitionSizes[ISTORAGE_PARTITION_CNT];
+    u64 updateTitleId;
+    u32 updateVersion;
+    u32 fileCnt;
+    hfs0_file_index_entry *fileIndex;                           // Sorted by HFS0 partition index and filename
+    bool imageFile;                                             // Set if the layout was parsed from a XCI image file
+} gamecard_layout_t;
+
+typedef enum {
+    GAMECARD_READ_AHEAD_IDLE = 0,
+    GAMECARD_READ_AHEAD_QUEUED,
+    GAMECARD_READ_AHEAD_DONE
+} gamecardReadAheadState;
+
+typedef struct {
+    bool init;
+    bool exit;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    gamecardReadAheadState state;
+    u64 offset;                                                 // Linear gamecard address space offset
+    u64 size;
+    Result result;
+    u8 *buf;                                                    // GAMECARD_READ_AHEAD_SIZE bytes long
+} gamecard_read_ahead_ctx;
+
+typedef enum {
+    GAMECARD_STORAGE_FS = 0,                                    // IStorage partition from the inserted gamecard
+    GAMECARD_STORAGE_XCI                                        // IStorage partition emulated from a XCI image file (see setGameCardImageFile())
+} gamecardStorageType;
+
+// A single gamecard IStorage partition. Every gamecard read goes through one of these
+typedef struct {
+    gamecardStorageType type;
+    FsStorage fsStorage;                                        // Only used with GAMECARD_STORAGE_FS
+    xci_image_storage_t xci;                                    // Only used with GAMECARD_STORAGE_XCI
+} gamecard_storage_t;
+
 typedef struct {
     FsDeviceOperator fsOperatorInstance;
     FsEventNotifier fsGameCardEventNotifier;
     Event fsGameCardKernelEvent;
     FsGameCardHandle fsGameCardHandle;
-    FsStorage fsGameCardStorage;
-    openIStoragePartition curIStorageIndex;
+    gamecard_storage_t gameCardStorages[ISTORAGE_PARTITION_CNT]; // IStorage partitions are opened on demand and kept open until the gamecard info is freed
+    bool gameCardStorageOpen[ISTORAGE_PARTITION_CNT];
+    openIStoragePartition curIStorageIndex;                     // IStorage partition used by readGameCardStoragePartition()
     volatile bool isInserted;
+    gamecard_layout_t *layout;                                  // Owns rootHfs0Header and hfs0Partitions
     gamecard_header_t header;
     u8 *rootHfs0Header;
     u32 hfs0PartitionCnt;
@@ -259,6 +297,15 @@ typedef enum {
     TICKET_TYPE_ADDON
 } selectedTicketType;
 
+typedef enum {
+    BIS_PARTITION_PRODINFO = 0,
+    BIS_PARTITION_PRODINFOF,
+    BIS_PARTITION_SAFE,
+    BIS_PARTITION_SYSTEM,
+    BIS_PARTITION_USER,
+    BIS_PARTITION_CNT
+} bisPartitionType;
+
 typedef struct {
     bool isFat32;
     bool setXciArchiveBit;
@@ -283,9 +330,18 @@ typedef enum {
     BATCH_SOURCE_ALL = 0,
     BATCH_SOURCE_SDCARD,
     BATCH_SOURCE_EMMC,
+    BATCH_SOURCE_LOCAL,                             // Titles from the local content storage (see ncm_local.h)
     BATCH_SOURCE_CNT
 } batchModeSourceStorage;
 
+typedef enum {
+    BATCH_ORDER_NAME = 0,                           // Alphabetical order
+    BATCH_ORDER_LARGEST_FIRST,                      // Biggest titles first, so the long transfers don't end up at the tail of the batch
+    BATCH_ORDER_SOURCE_INTERLEAVED,                 // Alternate between SD card and eMMC titles, so the next title can be read ahead from the idle device
+    BATCH_ORDER_FIT_FREE_SPACE,                     // Titles that fit in the available SD card space first (biggest first), then the rest
+    BATCH_ORDER_CNT
+} batchOrderPolicy;
+
 typedef struct {
     bool dumpAppTitles;
     bool dumpPatchTitles;
@@ -300,24 +356,54 @@ typedef struct {
     bool haltOnErrors;
     bool useBrackets;
     batchModeSourceStorage batchModeSrc;
+    batchOrderPolicy batchOrder;
 } PACKED batchOptions;
 
 typedef struct {
     bool removeConsoleData;
 } PACKED ticketOptions;
 
+typedef struct {
+    bool isFat32;
+    bool skipFreeClusters;                          // Unallocated FAT clusters aren't read from the eMMC, and are written as zeroes instead. Only used with FAT32 partitions (SAFE, SYSTEM and USER)
+} PACKED bisOptions;
+
+typedef enum {
+    NSO_EXPORT_ORIGINAL = 0,
+    NSO_EXPORT_DECOMPRESSED,
+    NSO_EXPORT_ELF,
+    NSO_EXPORT_CNT
+} nsoExportFormat;
+
 typedef struct {
     bool isFat32;
     bool useLayeredFSDir;
+    nsoExportFormat nsoExportFmt;                   // Only used with ExeFS dumps
 } PACKED ncaFsOptions;
 
+typedef enum {
+    TRANSFER_SOURCE_GAMECARD = 0,
+    TRANSFER_SOURCE_SDCARD,
+    TRANSFER_SOURCE_EMMC,
+    TRANSFER_SOURCE_CNT
+} transferSource;
+
+typedef struct {
+    u32 readChunkSize[TRANSFER_SOURCE_CNT];                                     // Calibrated read chunk size for each source. Zero if the source hasn't been calibrated yet
+    u32 writeChunkSize;                                                         // Calibrated SD card write chunk size. Zero if it hasn't been calibrated yet
+    u32 readSpeed[TRANSFER_SOURCE_CNT];                                         // Read throughput (in KiB/s) measured with the calibrated chunk size. Zero if it couldn't be measured
+    u32 writeSpeed;                                                             // SD card write throughput (in KiB/s) measured with the calibrated chunk size. Zero if it couldn't be measured
+} PACKED transferOptions;
+
 typedef struct {
     xciOptions xciDumpCfg;
     nspOptions nspDumpCfg;
     batchOptions batchDumpCfg;
     ticketOptions tikDumpCfg;
+    bisOptions bisDumpCfg;
     ncaFsOptions exeFsDumpCfg;
     ncaFsOptions romFsDumpCfg;
+    transferOptions transferCfg;
 } PACKED dumpOptions;
 
 void loadConfig();
@@ -326,6 +412,16 @@ void saveConfig();
 void closeGameCardStoragePartition();
 Result openGameCardStoragePartition(openIStoragePartition partitionIndex);
 Result readGameCardStoragePartition(u64 off, void *buf, size_t len);
+Result readGameCardStoragePartitionStream(u64 off, u8 **buf, size_t len);
+void closeGameCardStoragePartitions();
+
+bool setGameCardImageFile(const char *path);
+
+Result openGameCardImage();
+Result readGameCardImage(u64 off, u8 **buf, size_t len);
+void closeGameCardImage();
+
+hfs0_file_index_entry *getGameCardFileIndexEntry(u32 partition, const char *filename);
 
 void delay(u8 seconds);
 
@@ -371,12 +467,17 @@ void strtrim(char *str);
 
 void loadTitleInfo();
 
+bool isBatchModeSourceStorage(batchModeSourceStorage batchModeSrc, NcmStorageId storageId);
+u32 getBatchModeSourceTitleCount(batchModeSourceStorage batchModeSrc, nspDumpType titleType);
+
 void truncateBrowserEntryName(char *str);
 
 bool getHfs0FileList(u32 partition);
 
 bool readFileFromSecureHfs0PartitionByName(const char *filename, u64 offset, void *outBuf, size_t bufSize);
 
+bool readFileFromSecureHfs0PartitionByNameStream(const char *filename, u64 offset, u8 **outBuf, size_t bufSize);
+
 bool calculateExeFsExtractedDataSize(u64 *out);
 
 bool calculateRomFsFullExtractedSize(bool usePatch, u64 *out);
@@ -429,6 +530,24 @@ void convertDataToHexString(const u8 *data, const u32 dataSize, char *outBuf, co
 
 bool checkIfFileExists(const char *path);
 
+FILE *openDumpOutputFile(const char *path, u64 size);
+
+transferSource getTransferSourceFromStorageId(NcmStorageId storageId);
+
+u64 getTransferChunkSize(transferSource src);
+
+u64 getTransferWriteChunkSize();
+
+// Returns the expected dump throughput (in bytes per second) for the provided source, taking the SD card write throughput into account
+u64 getTransferThroughput(transferSource src);
+
+// Only measures the read chunk size for the provided source. Nothing gets written to the SD card
+void calibrateTransferChunkSizes(transferSource src);
+
+// Measures the SD card and eMMC read chunk sizes, as well as the SD card write chunk size
+// Performed on first launch and on demand from the update options menu. Cached results are discarded if force is true
+void calibrateAllTransferChunkSizes(bool force);
+
 bool yesNoPrompt(const char *message);
 
 bool checkIfDumpedXciContainsCertificate(const char *xciPath);
@@ -0,0 +1,1205 @@
+#ifdef __linux__
+#define _GNU_SOURCE                                 // O_DIRECT
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "writer.h"
+#include "util.h"
+#include "crc32_fast.h"
+
+static outputWriterBackend defaultBackend = OUTPUT_WRITER_BACKEND_STDIO;
+
+static bool outputWriterIsSplit(outputWriter *writer)
+{
+    return (writer->splitMode != OUTPUT_SPLIT_NONE);
+}
+
+static u64 outputWriterGetPartStart(outputWriter *writer, u8 partIndex)
+{
+    if (!outputWriterIsSplit(writer)) return 0;
+    
+    u64 partStart = ((u64)partIndex * writer->partSize);
+    
+    // The first part file handled by this writer may start at a later offset
+    return (partStart < writer->startOffset ? writer->startOffset : partStart);
+}
+
+static u64 outputWriterGetPartEnd(outputWriter *writer, u8 partIndex)
+{
+    if (!outputWriterIsSplit(writer)) return writer->totalSize;
+    
+    u64 partEnd = (((u64)partIndex + 1) * writer->partSize);
+    return (partEnd > writer->totalSize ? writer->totalSize : partEnd);
+}
+
+static void outputWriterGeneratePartPath(outputWriter *writer, u8 partIndex, char *outPath, size_t outPathSize)
+{
+    switch(writer->splitMode)
+    {
+        case OUTPUT_SPLIT_DIRECTORY:
+            snprintf(outPath, outPathSize, "%s/%02u", writer->basePath, partIndex);
+            break;
+        case OUTPUT_SPLIT_SUFFIX:
+            snprintf(outPath, outPathSize, "%s.%02u", writer->basePath, partIndex);
+            break;
+        case OUTPUT_SPLIT_XCI:
+            snprintf(outPath, outPathSize, "%.*s%u", (int)(strlen(writer->basePath) - 1), writer->basePath, partIndex);
+            break;
+        default:
+            snprintf(outPath, outPathSize, "%s", writer->basePath);
+            break;
+    }
+}
+
+static bool outputWriterOpenPart(outputWriter *writer)
+{
+    u64 partStart = outputWriterGetPartStart(writer, writer->partIndex);
+    u64 partEnd = outputWriterGetPartEnd(writer, writer->partIndex);
+    
+    outputWriterGeneratePartPath(writer, writer->partIndex, writer->curPath, MAX_CHARACTERS(writer->curPath));
+    
+    // Preallocate the part file to its final size
+    writer->file = openDumpOutputFile(writer->curPath, (partEnd > partStart ? (partEnd - partStart) : 0));
+    if (!writer->file)
+    {
+        if (outputWriterIsSplit(writer))
+        {
+            snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to open output file for part #%u!", writer->partIndex);
+        } else {
+            snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to open output file \"%s\"!", writer->curPath);
+        }
+        
+        return false;
+    }
+    
+    return true;
+}
+
+static void *outputWriterAsyncThreadFunc(void *arg)
+{
+    outputWriterAsyncCtx *async = (outputWriterAsyncCtx*)arg;
+    outputWriterAsyncSlot *slot;
+    size_t write_res;
+    bool error;
+    
+    pthread_mutex_lock(&(async->mutex));
+    
+    while(true)
+    {
+        while(!async->count && !async->exit) pthread_cond_wait(&(async->cond), &(async->mutex));
+        if (!async->count) break;
+        
+        slot = &(async->slots[async->head]);
+        error = async->error;
+        
+        pthread_mutex_unlock(&(async->mutex));
+        
+        // Keep going after an error, in order to close every queued part file
+        write_res = 0;
+        if (!error && slot->size) write_res = fwrite(slot->data, 1, slot->size, slot->file);
+        
+        if (slot->closeFile) fclose(slot->file);
+        
+        pthread_mutex_lock(&(async->mutex));
+        
+        if (!error && write_res != slot->size)
+        {
+            snprintf(async->errorStr, MAX_CHARACTERS(async->errorStr), "failed to write %lu bytes chunk to output file! (wrote %lu bytes)", slot->size, write_res);
+            async->error = true;
+        }
+        
+        async->head = ((async->head + 1) % OUTPUT_WRITER_ASYNC_SLOT_CNT);
+        async->count--;
+        
+        pthread_cond_broadcast(&(async->cond));
+    }
+    
+    pthread_mutex_unlock(&(async->mutex));
+    
+    return NULL;
+}
+
+static bool outputWriterAsyncCheckError(outputWriter *writer)
+{
+    if (!writer->async->error) return true;
+    
+    snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "%s", writer->async->errorStr);
+    
+    return false;
+}
+
+// Waits for a free slot and starts filling it with data for the current part file
+static bool outputWriterAsyncAcquireSlot(outputWriter *writer)
+{
+    outputWriterAsyncCtx *async = writer->async;
+    
+    pthread_mutex_lock(&(async->mutex));
+    
+    while(async->count == OUTPUT_WRITER_ASYNC_SLOT_CNT && !async->error) pthread_cond_wait(&(async->cond), &(async->mutex));
+    
+    bool success = outputWriterAsyncCheckError(writer);
+    
+    // The worker thread only advances 'head' while releasing slots, so this index stays valid until the slot is queued
+    if (success) async->fillIndex = ((async->head + async->count) % OUTPUT_WRITER_ASYNC_SLOT_CNT);
+    
+    pthread_mutex_unlock(&(async->mutex));
+    
+    if (!success) return false;
+    
+    async->slots[async->fillIndex].file = writer->file;
+    async->slots[async->fillIndex].size = 0;
+    async->slots[async->fillIndex].closeFile = false;
+    async->filling = true;
+    
+    return true;
+}
+
+static void outputWriterAsyncQueueSlot(outputWriter *writer)
+{
+    outputWriterAsyncCtx *async = writer->async;
+    
+    pthread_mutex_lock(&(async->mutex));
+    
+    async->count++;
+    async->filling = false;
+    
+    pthread_cond_broadcast(&(async->cond));
+    pthread_mutex_unlock(&(async->mutex));
+}
+
+static bool outputWriterAsyncWrite(outputWriter *writer, const u8 *data, u64 size)
+{
+    outputWriterAsyncCtx *async = writer->async;
+    outputWriterAsyncSlot *slot;
+    u64 chunkSize;
+    
+    while(size > 0)
+    {
+        if (!async->filling && !outputWriterAsyncAcquireSlot(writer)) return false;
+        
+        slot = &(async->slots[async->fillIndex]);
+        
+        // Small writes are coalesced until the slot is full
+        chunkSize = (OUTPUT_WRITER_ASYNC_SLOT_SIZE - slot->size);
+        if (chunkSize > size) chunkSize = size;
+        
+        memcpy(slot->data + slot->size, data, chunkSize);
+        slot->size += chunkSize;
+        
+        data += chunkSize;
+        size -= chunkSize;
+        
+        if (slot->size == OUTPUT_WRITER_ASYNC_SLOT_SIZE) outputWriterAsyncQueueSlot(writer);
+    }
+    
+    return true;
+}
+
+// Queues a close request for the current part file, right after its pending data
+static bool outputWriterAsyncClosePart(outputWriter *writer)
+{
+    outputWriterAsyncCtx *async = writer->async;
+    
+    if (!async->filling && !outputWriterAsyncAcquireSlot(writer))
+    {
+        // The worker thread is no longer writing data, so it's safe to close it here
+        fclose(writer->file);
+        return false;
+    }
+    
+    async->slots[async->fillIndex].closeFile = true;
+    outputWriterAsyncQueueSlot(writer);
+    
+    return true;
+}
+
+// Waits until the worker thread has written all the queued data
+static bool outputWriterAsyncDrain(outputWriter *writer)
+{
+    outputWriterAsyncCtx *async = writer->async;
+    
+    if (async->filling) outputWriterAsyncQueueSlot(writer);
+    
+    pthread_mutex_lock(&(async->mutex));
+    
+    while(async->count) pthread_cond_wait(&(async->cond), &(async->mutex));
+    
+    bool success = outputWriterAsyncCheckError(writer);
+    
+    pthread_mutex_unlock(&(async->mutex));
+    
+    return success;
+}
+
+static void outputWriterAsyncStop(outputWriter *writer)
+{
+    outputWriterAsyncCtx *async = writer->async;
+    
+    outputWriterAsyncDrain(writer);
+    
+    pthread_mutex_lock(&(async->mutex));
+    async->exit = true;
+    pthread_cond_broadcast(&(async->cond));
+    pthread_mutex_unlock(&(async->mutex));
+    
+    pthread_join(async->thread, NULL);
+    
+    pthread_cond_destroy(&(async->cond));
+    pthread_mutex_destroy(&(async->mutex));
+    
+    free(async->buffer);
+    free(async);
+    
+    writer->async = NULL;
+    writer->backend = OUTPUT_WRITER_BACKEND_STDIO;
+}
+
+static bool outputWriterAsyncStart(outputWriter *writer)
+{
+    outputWriterAsyncCtx *async = calloc(1, sizeof(outputWriterAsyncCtx));
+    if (!async) return false;
+    
+    async->buffer = malloc(OUTPUT_WRITER_ASYNC_SLOT_SIZE * OUTPUT_WRITER_ASYNC_SLOT_CNT);
+    if (!async->buffer)
+    {
+        free(async);
+        return false;
+    }
+    
+    for(u32 i = 0; i < OUTPUT_WRITER_ASYNC_SLOT_CNT; i++) async->slots[i].data = (async->buffer + (i * OUTPUT_WRITER_ASYNC_SLOT_SIZE));
+    
+    pthread_mutex_init(&(async->mutex), NULL);
+    pthread_cond_init(&(async->cond), NULL);
+    
+    if (pthread_create(&(async->thread), NULL, &outputWriterAsyncThreadFunc, async) != 0)
+    {
+        pthread_cond_destroy(&(async->cond));
+        pthread_mutex_destroy(&(async->mutex));
+        free(async->buffer);
+        free(async);
+        return false;
+    }
+    
+    writer->async = async;
+    writer->backend = OUTPUT_WRITER_BACKEND_ASYNC;
+    
+    return true;
+}
+
+#ifdef __linux__
+static bool outputWriterUringFail(outputWriter *writer, const char *action, int err)
+{
+    snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to %s! (%s)", action, strerror(err));
+    writer->uring->error = true;
+    return false;
+}
+
+static bool outputWriterUringSubmit(outputWriter *writer, u32 slotIndex)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    outputWriterUringSlot *slot = &(uring->slots[slotIndex]);
+    
+    // The ring has at least OUTPUT_WRITER_URING_SLOT_CNT entries, so there's always room for one request per slot
+    u32 tail = *(uring->sqTail);
+    u32 index = (tail & *(uring->sqMask));
+    
+    struct io_uring_sqe *sqe = &(uring->sqes[index]);
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = uring->fd;
+    sqe->addr = (u64)(uintptr_t)(slot->data + slot->written);
+    sqe->len = (u32)(slot->length - slot->written);
+    sqe->off = (slot->offset + slot->written);
+    sqe->user_data = slotIndex;
+    
+    uring->sqArray[index] = index;
+    __atomic_store_n(uring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    
+    int ret;
+    while((ret = (int)syscall(__NR_io_uring_enter, uring->ringFd, 1, 0, 0, NULL, 0)) < 0 && errno == EINTR);
+    if (ret < 0) return outputWriterUringFail(writer, "submit io_uring write request", errno);
+    
+    return true;
+}
+
+// Waits until at least 'minComplete' writes have completed, or until nothing is in flight anymore
+static bool outputWriterUringReap(outputWriter *writer, u32 minComplete)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    u32 completed = 0;
+    bool success = !uring->error;
+    
+    while(true)
+    {
+        u32 head = *(uring->cqHead);
+        u32 tail = __atomic_load_n(uring->cqTail, __ATOMIC_ACQUIRE);
+        
+        for(; head != tail; head++)
+        {
+            struct io_uring_cqe *cqe = &(uring->cqes[head & *(uring->cqMask)]);
+            outputWriterUringSlot *slot = &(uring->slots[cqe->user_data]);
+            int res = cqe->res;
+            
+            if (res > 0 && success)
+            {
+                slot->written += (u64)res;
+                
+                // Resubmit the rest of a short write
+                if (slot->written < slot->length)
+                {
+                    if (outputWriterUringSubmit(writer, (u32)cqe->user_data)) continue;
+                    success = false;
+                }
+            } else
+            if (success)
+            {
+                success = outputWriterUringFail(writer, "write data to output file", (res < 0 ? -res : EIO));
+            }
+            
+            slot->inFlight = false;
+            uring->inFlightCnt--;
+            completed++;
+        }
+        
+        __atomic_store_n(uring->cqHead, head, __ATOMIC_RELEASE);
+        
+        if (completed >= minComplete || !uring->inFlightCnt) break;
+        
+        if (syscall(__NR_io_uring_enter, uring->ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+        {
+            // Nothing else can be done with the requests still in flight
+            success = outputWriterUringFail(writer, "wait for io_uring write requests", errno);
+            break;
+        }
+    }
+    
+    return success;
+}
+
+// Submits the buffered data from the slot being filled, padded with zeroes up to the alignment if needed
+static bool outputWriterUringQueueSlot(outputWriter *writer)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    outputWriterUringSlot *slot = &(uring->slots[uring->fillIndex]);
+    
+    slot->length = round_up(slot->size, OUTPUT_WRITER_URING_ALIGNMENT);
+    slot->written = 0;
+    
+    if (slot->length > slot->size)
+    {
+        memset(slot->data + slot->size, 0, slot->length - slot->size);
+        uring->padded = true;
+    }
+    
+    slot->inFlight = true;
+    uring->inFlightCnt++;
+    
+    if (outputWriterUringSubmit(writer, uring->fillIndex)) return true;
+    
+    slot->inFlight = false;
+    uring->inFlightCnt--;
+    
+    return false;
+}
+
+static bool outputWriterUringOpenPart(outputWriter *writer)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    outputWriterUringSlot *slot = &(uring->slots[uring->fillIndex]);
+    
+    u64 partStart = outputWriterGetPartStart(writer, writer->partIndex);
+    
+    // Not every filesystem supports O_DIRECT. Buffered writes still benefit from having several requests in flight
+    uring->fd = open(writer->curPath, O_WRONLY | O_DIRECT);
+    if (uring->fd < 0 && errno == EINVAL) uring->fd = open(writer->curPath, O_WRONLY);
+    if (uring->fd < 0) return outputWriterUringFail(writer, "open output file for io_uring writes", errno);
+    
+    uring->partLength = (outputWriterGetPartEnd(writer, writer->partIndex) - partStart);
+    uring->padded = false;
+    
+    slot->offset = (writer->curOffset - partStart);
+    slot->size = 0;
+    
+    return true;
+}
+
+static bool outputWriterUringWrite(outputWriter *writer, const u8 *data, u64 size)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    outputWriterUringSlot *slot;
+    u64 chunkSize;
+    
+    if (uring->error) return false;
+    
+    if (uring->fd < 0 && !outputWriterUringOpenPart(writer)) return false;
+    
+    while(size > 0)
+    {
+        slot = &(uring->slots[uring->fillIndex]);
+        
+        while(slot->inFlight)
+        {
+            if (!outputWriterUringReap(writer, 1)) return false;
+        }
+        
+        chunkSize = (OUTPUT_WRITER_URING_SLOT_SIZE - slot->size);
+        if (chunkSize > size) chunkSize = size;
+        
+        memcpy(slot->data + slot->size, data, chunkSize);
+        slot->size += chunkSize;
+        
+        data += chunkSize;
+        size -= chunkSize;
+        
+        if (slot->size == OUTPUT_WRITER_URING_SLOT_SIZE)
+        {
+            if (!outputWriterUringQueueSlot(writer)) return false;
+            
+            // Full slots are always aligned, so the next one starts right after this one
+            uring->fillIndex = ((uring->fillIndex + 1) % OUTPUT_WRITER_URING_SLOT_CNT);
+            uring->slots[uring->fillIndex].offset = (slot->offset + slot->size);
+            uring->slots[uring->fillIndex].size = 0;
+        }
+    }
+    
+    return true;
+}
+
+// Writes all the buffered data and waits for every request to complete
+// The unaligned tail of the slot being filled is kept around, since it'll be written again along with the data that follows it
+static bool outputWriterUringDrain(outputWriter *writer)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    outputWriterUringSlot *slot = &(uring->slots[uring->fillIndex]);
+    
+    if (uring->fd < 0) return !uring->error;
+    
+    if (!uring->error && slot->size && !slot->inFlight) outputWriterUringQueueSlot(writer);
+    
+    bool success = outputWriterUringReap(writer, OUTPUT_WRITER_URING_SLOT_CNT);
+    
+    u64 alignedSize = (slot->size - (slot->size % OUTPUT_WRITER_URING_ALIGNMENT));
+    if (alignedSize)
+    {
+        memmove(slot->data, slot->data + alignedSize, slot->size - alignedSize);
+        slot->offset += alignedSize;
+        slot->size -= alignedSize;
+    }
+    
+    return success;
+}
+
+// Replaces data from a patched region that's still kept in the slot being filled
+static void outputWriterUringPatchTail(outputWriter *writer, u64 offset, const u8 *data, u64 size)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    outputWriterUringSlot *slot = &(uring->slots[uring->fillIndex]);
+    
+    if (uring->fd < 0 || !slot->size) return;
+    
+    u64 tailStart = (outputWriterGetPartStart(writer, writer->partIndex) + slot->offset);
+    u64 tailEnd = (tailStart + slot->size);
+    
+    if ((offset + size) <= tailStart || offset >= tailEnd) return;
+    
+    u64 start = (offset > tailStart ? offset : tailStart);
+    u64 end = ((offset + size) < tailEnd ? (offset + size) : tailEnd);
+    
+    memcpy(slot->data + (start - tailStart), data + (start - offset), end - start);
+}
+
+static bool outputWriterUringClosePart(outputWriter *writer)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    
+    if (uring->fd < 0) return !uring->error;
+    
+    bool success = outputWriterUringDrain(writer);
+    
+    // Get rid of the zero padding written past the end of the part file
+    if (uring->padded && ftruncate(uring->fd, (off_t)uring->partLength) != 0 && success) success = outputWriterUringFail(writer, "truncate output file", errno);
+    
+    close(uring->fd);
+    uring->fd = -1;
+    
+    uring->slots[uring->fillIndex].size = 0;
+    
+    return success;
+}
+
+static void outputWriterUringStop(outputWriter *writer)
+{
+    outputWriterUringCtx *uring = writer->uring;
+    
+    outputWriterUringClosePart(writer);
+    
+    munmap(uring->sqes, uring->sqesSize);
+    if (uring->cqRing != uring->sqRing) munmap(uring->cqRing, uring->cqRingSize);
+    munmap(uring->sqRing, uring->sqRingSize);
+    close(uring->ringFd);
+    
+    free(uring->buffer);
+    free(uring);
+    
+    writer->uring = NULL;
+    writer->backend = OUTPUT_WRITER_BACKEND_STDIO;
+}
+
+static bool outputWriterUringStart(outputWriter *writer)
+{
+    // O_DIRECT writes must start at an aligned file offset, which isn't the case with every resumed dump
+    if ((writer->curOffset - outputWriterGetPartStart(writer, writer->partIndex)) % OUTPUT_WRITER_URING_ALIGNMENT) return false;
+    
+    outputWriterUringCtx *uring = calloc(1, sizeof(outputWriterUringCtx));
+    if (!uring) return false;
+    
+    uring->fd = -1;
+    
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(struct io_uring_params));
+    
+    uring->ringFd = (int)syscall(__NR_io_uring_setup, OUTPUT_WRITER_URING_SLOT_CNT, &params);
+    if (uring->ringFd < 0)
+    {
+        free(uring);
+        return false;
+    }
+    
+    uring->sqRingSize = (params.sq_off.array + (params.sq_entries * sizeof(u32)));
+    uring->cqRingSize = (params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe)));
+    uring->sqesSize = (params.sq_entries * sizeof(struct io_uring_sqe));
+    
+    // Both rings share a single mapping on most kernels
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (uring->cqRingSize > uring->sqRingSize) uring->sqRingSize = uring->cqRingSize;
+        uring->cqRingSize = uring->sqRingSize;
+    }
+    
+    uring->sqRing = mmap(NULL, uring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ringFd, IORING_OFF_SQ_RING);
+    uring->cqRing = ((params.features & IORING_FEAT_SINGLE_MMAP) ? uring->sqRing : mmap(NULL, uring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ringFd, IORING_OFF_CQ_RING));
+    uring->sqes = mmap(NULL, uring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ringFd, IORING_OFF_SQES);
+    uring->buffer = aligned_alloc(OUTPUT_WRITER_URING_ALIGNMENT, OUTPUT_WRITER_URING_SLOT_SIZE * OUTPUT_WRITER_URING_SLOT_CNT);
+    
+    if (uring->sqRing == MAP_FAILED || uring->cqRing == MAP_FAILED || uring->sqes == MAP_FAILED || !uring->buffer)
+    {
+        if (uring->sqes != MAP_FAILED) munmap(uring->sqes, uring->sqesSize);
+        if (uring->cqRing != MAP_FAILED && uring->cqRing != uring->sqRing) munmap(uring->cqRing, uring->cqRingSize);
+        if (uring->sqRing != MAP_FAILED) munmap(uring->sqRing, uring->sqRingSize);
+        close(uring->ringFd);
+        free(uring->buffer);
+        free(uring);
+        return false;
+    }
+    
+    uring->sqTail = (u32*)((u8*)uring->sqRing + params.sq_off.tail);
+    uring->sqMask = (u32*)((u8*)uring->sqRing + params.sq_off.ring_mask);
+    uring->sqArray = (u32*)((u8*)uring->sqRing + params.sq_off.array);
+    uring->cqHead = (u32*)((u8*)uring->cqRing + params.cq_off.head);
+    uring->cqTail = (u32*)((u8*)uring->cqRing + params.cq_off.tail);
+    uring->cqMask = (u32*)((u8*)uring->cqRing + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe*)((u8*)uring->cqRing + params.cq_off.cqes);
+    
+    for(u32 i = 0; i < OUTPUT_WRITER_URING_SLOT_CNT; i++) uring->slots[i].data = (uring->buffer + (i * OUTPUT_WRITER_URING_SLOT_SIZE));
+    
+    writer->uring = uring;
+    writer->backend = OUTPUT_WRITER_BACKEND_IO_URING;
+    
+    return true;
+}
+#endif
+
+void outputWriterSetDefaultBackend(outputWriterBackend backend)
+{
+    defaultBackend = (backend < OUTPUT_WRITER_BACKEND_CNT ? backend : OUTPUT_WRITER_BACKEND_STDIO);
+}
+
+outputWriterBackend outputWriterGetDefaultBackend()
+{
+    return defaultBackend;
+}
+
+// Starts the selected backend for the output dump. Must be called once the first part file has been opened
+// Falls back to the stdio backend if the output is too small, or if the selected backend can't be started
+static void outputWriterStartBackend(outputWriter *writer)
+{
+    writer->backend = OUTPUT_WRITER_BACKEND_STDIO;
+    writer->async = NULL;
+#ifdef __linux__
+    writer->uring = NULL;
+#endif
+    
+    if ((writer->totalSize - writer->curOffset) < OUTPUT_WRITER_BACKEND_MIN_SIZE) return;
+    
+    switch(defaultBackend)
+    {
+        case OUTPUT_WRITER_BACKEND_ASYNC:
+            outputWriterAsyncStart(writer);
+            break;
+#ifdef __linux__
+        case OUTPUT_WRITER_BACKEND_IO_URING:
+            outputWriterUringStart(writer);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+static bool outputWriterStdioWrite(outputWriter *writer, const u8 *data, u64 size)
+{
+    size_t write_res = fwrite(data, 1, size, writer->file);
+    if (write_res == size) return true;
+    
+    if (outputWriterIsSplit(writer))
+    {
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", size, writer->curOffset, writer->partIndex, write_res);
+    } else {
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", size, writer->curOffset, write_res);
+    }
+    
+    return false;
+}
+
+static bool outputWriterBackendWrite(outputWriter *writer, const u8 *data, u64 size)
+{
+    switch(writer->backend)
+    {
+        case OUTPUT_WRITER_BACKEND_ASYNC:
+            return outputWriterAsyncWrite(writer, data, size);
+#ifdef __linux__
+        case OUTPUT_WRITER_BACKEND_IO_URING:
+            return outputWriterUringWrite(writer, data, size);
+#endif
+        default:
+            return outputWriterStdioWrite(writer, data, size);
+    }
+}
+
+// Closes the current part file once all of its data has been written
+static bool outputWriterBackendClosePart(outputWriter *writer)
+{
+    bool success = true;
+    
+    switch(writer->backend)
+    {
+        case OUTPUT_WRITER_BACKEND_ASYNC:
+            success = outputWriterAsyncClosePart(writer);
+            break;
+#ifdef __linux__
+        case OUTPUT_WRITER_BACKEND_IO_URING:
+            success = outputWriterUringClosePart(writer);
+            fclose(writer->file);
+            break;
+#endif
+        default:
+            fclose(writer->file);
+            break;
+    }
+    
+    writer->file = NULL;
+    
+    return success;
+}
+
+// Makes sure all the data passed to outputWriterWrite() has been handed over to the C runtime
+static bool outputWriterBackendFlush(outputWriter *writer)
+{
+    switch(writer->backend)
+    {
+        case OUTPUT_WRITER_BACKEND_ASYNC:
+            return outputWriterAsyncDrain(writer);
+#ifdef __linux__
+        case OUTPUT_WRITER_BACKEND_IO_URING:
+            return outputWriterUringDrain(writer);
+#endif
+        default:
+            return true;
+    }
+}
+
+bool outputWriterOpen(outputWriter *writer, const char *basePath, outputSplitMode splitMode, u64 totalSize, u64 partSize, u8 partIndex, u64 curOffset, const dumpJournal *journal)
+{
+    if (!writer || !basePath || !strlen(basePath) || (splitMode != OUTPUT_SPLIT_NONE && !partSize)) return false;
+    
+    memset(writer, 0, sizeof(outputWriter));
+    
+    writer->trackCheckpointCrc = (journal != NULL);
+    
+    writer->splitMode = splitMode;
+    snprintf(writer->basePath, MAX_CHARACTERS(writer->basePath), "%s", basePath);
+    writer->totalSize = totalSize;
+    writer->partSize = partSize;
+    writer->startOffset = writer->curOffset = writer->checkpointOffset = curOffset;
+    writer->partIndex = partIndex;
+    
+    if (splitMode == OUTPUT_SPLIT_DIRECTORY) mkdir(writer->basePath, 0744);
+    
+    if (!outputWriterOpenPart(writer)) return false;
+    
+    outputWriterStartBackend(writer);
+    
+    return true;
+}
+
+bool outputWriterWrite(outputWriter *writer, const void *buf, u64 size)
+{
+    if (!writer || !buf) return false;
+    
+    const u8 *data = (const u8*)buf;
+    u64 chunkSize;
+    
+    while(size > 0)
+    {
+        // Open the next part file, if needed
+        if (!writer->file && !outputWriterOpenPart(writer)) return false;
+        
+        chunkSize = (outputWriterGetPartEnd(writer, writer->partIndex) - writer->curOffset);
+        if (!outputWriterIsSplit(writer) || chunkSize > size) chunkSize = size;
+        
+        if (!outputWriterBackendWrite(writer, data, chunkSize)) return false;
+        
+        // Keep track of the data written since the previous checkpoint. Uses the hardware CRC32 instructions
+        if (writer->trackCheckpointCrc) writer->checkpointCrc = crc32CalculateWithSeed(writer->checkpointCrc, data, chunkSize);
+        
+        data += chunkSize;
+        size -= chunkSize;
+        writer->curOffset += chunkSize;
+        
+        // Close the current part file as soon as it's full
+        // The next one is only created if there's more data to write
+        if (outputWriterIsSplit(writer) && writer->curOffset >= outputWriterGetPartEnd(writer, writer->partIndex) && writer->curOffset < writer->totalSize)
+        {
+            writer->partIndex++;
+            if (!outputWriterBackendClosePart(writer)) return false;
+        }
+    }
+    
+    // Report any pending write errors before the caller considers the dump complete
+    if (writer->curOffset >= writer->totalSize) return outputWriterBackendFlush(writer);
+    
+    return true;
+}
+
+bool outputWriterWriteVectored(outputWriter *writer, const outputWriterChunk *chunks, u32 chunkCnt)
+{
+    if (!writer || !chunks) return false;
+    
+    for(u32 i = 0; i < chunkCnt; i++)
+    {
+        if (!chunks[i].size) continue;
+        if (!outputWriterWrite(writer, chunks[i].data, chunks[i].size)) return false;
+    }
+    
+    return true;
+}
+
+bool outputWriterPatch(outputWriter *writer, u64 offset, const void *buf, u64 size)
+{
+    if (!writer || !buf || offset < writer->startOffset || (offset + size) > writer->curOffset) return false;
+    
+    // Queued data may overlap the patched region, and the part files may still be in use by the worker thread
+    if (!outputWriterBackendFlush(writer)) return false;
+    
+#ifdef __linux__
+    if (writer->uring) outputWriterUringPatchTail(writer, offset, (const u8*)buf, size);
+#endif
+    
+    const u8 *data = (const u8*)buf;
+    char partPath[NAME_BUF_LEN] = {'\0'};
+    
+    u8 partIndex = (outputWriterIsSplit(writer) ? (u8)(offset / writer->partSize) : 0);
+    u64 partStart, chunkSize;
+    size_t write_res;
+    
+    FILE *partFile = NULL;
+    long curFilePos = 0;
+    bool success = true;
+    
+    while(size > 0)
+    {
+        partStart = outputWriterGetPartStart(writer, partIndex);
+        
+        chunkSize = (outputWriterGetPartEnd(writer, partIndex) - offset);
+        if (chunkSize > size) chunkSize = size;
+        
+        if (writer->file && partIndex == writer->partIndex)
+        {
+            // Reuse the current part file. Files are preallocated, so we need to restore the current position afterwards
+            partFile = writer->file;
+            curFilePos = ftell(partFile);
+        } else {
+            outputWriterGeneratePartPath(writer, partIndex, partPath, MAX_CHARACTERS(partPath));
+            
+            partFile = fopen(partPath, "rb+");
+            if (!partFile)
+            {
+                snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to re-open output file for part #%u!", partIndex);
+                return false;
+            }
+        }
+        
+        fseek(partFile, (long)(offset - partStart), SEEK_SET);
+        write_res = fwrite(data, 1, chunkSize, partFile);
+        
+        if (partFile == writer->file)
+        {
+            fseek(partFile, curFilePos, SEEK_SET);
+        } else {
+            fclose(partFile);
+        }
+        
+        if (write_res != chunkSize)
+        {
+            snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to write %lu bytes chunk to output file offset 0x%016lX! (wrote %lu bytes)", chunkSize, offset, write_res);
+            success = false;
+            break;
+        }
+        
+        data += chunkSize;
+        offset += chunkSize;
+        size -= chunkSize;
+        partIndex++;
+    }
+    
+    return success;
+}
+
+void outputWriterClose(outputWriter *writer)
+{
+    if (!writer) return;
+    
+    if (writer->async) outputWriterAsyncStop(writer);
+    
+#ifdef __linux__
+    if (writer->uring) outputWriterUringStop(writer);
+#endif
+    
+    if (!writer->file) return;
+    
+    fclose(writer->file);
+    writer->file = NULL;
+}
+
+static bool outputWriterVerify(outputWriter *writer, u64 offset, u64 endOffset, u32 expectedCrc)
+{
+    if (offset >= endOffset) return true;
+    
+    u8 *buf = malloc(OUTPUT_WRITER_VERIFY_BUFFER_SIZE);
+    if (!buf)
+    {
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to allocate memory for the output verification buffer!");
+        return false;
+    }
+    
+    char partPath[NAME_BUF_LEN] = {'\0'};
+    
+    u8 partIndex = (outputWriterIsSplit(writer) ? (u8)(offset / writer->partSize) : 0);
+    u64 partStart, partEnd, chunkSize;
+    
+    FILE *partFile = NULL;
+    u32 crc = 0;
+    bool success = true;
+    
+    while(offset < endOffset)
+    {
+        partStart = outputWriterGetPartStart(writer, partIndex);
+        partEnd = outputWriterGetPartEnd(writer, partIndex);
+        if (partEnd > endOffset) partEnd = endOffset;
+        
+        outputWriterGeneratePartPath(writer, partIndex, partPath, MAX_CHARACTERS(partPath));
+        
+        partFile = fopen(partPath, "rb");
+        if (!partFile)
+        {
+            snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to open output file for part #%u!", partIndex);
+            success = false;
+            break;
+        }
+        
+        fseek(partFile, (long)(offset - partStart), SEEK_SET);
+        
+        while(offset < partEnd)
+        {
+            chunkSize = (partEnd - offset);
+            if (chunkSize > OUTPUT_WRITER_VERIFY_BUFFER_SIZE) chunkSize = OUTPUT_WRITER_VERIFY_BUFFER_SIZE;
+            
+            if (fread(buf, 1, chunkSize, partFile) != chunkSize)
+            {
+                snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to read %lu bytes chunk from output file offset 0x%016lX!", chunkSize, offset);
+                success = false;
+                break;
+            }
+            
+            crc = crc32CalculateWithSeed(crc, buf, chunkSize);
+            offset += chunkSize;
+        }
+        
+        fclose(partFile);
+        if (!success) break;
+        
+        partIndex++;
+    }
+    
+    free(buf);
+    
+    if (success && crc != expectedCrc)
+    {
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "output file checksum mismatch! (%08X != %08X)", crc, expectedCrc);
+        success = false;
+    }
+    
+    return success;
+}
+
+bool outputWriterResume(outputWriter *writer, const char *basePath, outputSplitMode splitMode, u64 totalSize, u64 partSize, dumpJournal *journal)
+{
+    if (!writer || !basePath || !strlen(basePath) || (splitMode != OUTPUT_SPLIT_NONE && !partSize) || !journal || !journal->resume) return false;
+    
+    dumpJournalHeader *header = &(journal->header);
+    
+    memset(writer, 0, sizeof(outputWriter));
+    
+    writer->splitMode = splitMode;
+    snprintf(writer->basePath, MAX_CHARACTERS(writer->basePath), "%s", basePath);
+    writer->totalSize = totalSize;
+    writer->partSize = partSize;
+    writer->curOffset = writer->checkpointOffset = header->fileOffset;
+    writer->trackCheckpointCrc = true;
+    
+    if (header->splitMode != (u32)splitMode || (splitMode != OUTPUT_SPLIT_NONE && header->partSize != partSize))
+    {
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "dump journal doesn't match the current output file layout!");
+        return false;
+    }
+    
+    if (header->verifyOffset > header->fileOffset || header->fileOffset > totalSize)
+    {
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "invalid dump journal offsets!");
+        return false;
+    }
+    
+    // Re-validate the data written since the previous checkpoint. Everything before it was already flushed and validated back then
+    if (!outputWriterVerify(writer, header->verifyOffset, header->fileOffset, header->verifyCrc)) return false;
+    
+    if (outputWriterIsSplit(writer))
+    {
+        writer->partIndex = (u8)(writer->curOffset / partSize);
+        
+        // Mimic outputWriterWrite(): the last part file is never closed
+        if (writer->partIndex > 0 && writer->curOffset == totalSize && !(writer->curOffset % partSize)) writer->partIndex--;
+    }
+    
+    u64 partStart = outputWriterGetPartStart(writer, writer->partIndex);
+    
+    outputWriterGeneratePartPath(writer, writer->partIndex, writer->curPath, MAX_CHARACTERS(writer->curPath));
+    
+    writer->file = fopen(writer->curPath, "rb+");
+    if (!writer->file)
+    {
+        // The part file holding the current offset may not have been created yet
+        if (writer->curOffset != partStart || !outputWriterOpenPart(writer))
+        {
+            if (writer->curOffset != partStart) snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to re-open output file for part #%u!", writer->partIndex);
+            return false;
+        }
+    } else {
+        fseek(writer->file, (long)(writer->curOffset - partStart), SEEK_SET);
+    }
+    
+    outputWriterStartBackend(writer);
+    
+    return true;
+}
+
+Result outputWriterSetArchiveBit(outputWriter *writer)
+{
+    if (!writer || writer->splitMode != OUTPUT_SPLIT_DIRECTORY) return MAKERESULT(Module_Libnx, LibnxError_BadInput);
+    
+    return fsdevSetConcatenationFileAttribute(writer->basePath);
+}
+
+static u32 dumpJournalCalculateCrc(dumpJournalHeader *header, const void *state)
+{
+    u32 crc = 0, journalCrc = header->journalCrc;
+    
+    header->journalCrc = 0;
+    crc32(header, sizeof(dumpJournalHeader), &crc);
+    if (header->stateSize) crc32(state, header->stateSize, &crc);
+    header->journalCrc = journalCrc;
+    
+    return crc;
+}
+
+bool dumpJournalLoad(dumpJournal *journal, const char *outputPath, dumpJournalType type, u64 totalSize)
+{
+    if (!journal || !outputPath || !strlen(outputPath)) return false;
+    
+    memset(journal, 0, sizeof(dumpJournal));
+    
+    snprintf(journal->path, MAX_CHARACTERS(journal->path), "%s%s", outputPath, DUMP_JOURNAL_EXTENSION);
+    
+    journal->header.magic = DUMP_JOURNAL_MAGIC;
+    journal->header.type = (u32)type;
+    journal->header.totalSize = totalSize;
+    
+    // Recover the journal from its temporary file if we got interrupted while replacing it
+    char tmpPath[NAME_BUF_LEN + 8] = {'\0'};
+    snprintf(tmpPath, MAX_CHARACTERS(tmpPath), "%s%s", journal->path, DUMP_JOURNAL_TMP_EXTENSION);
+    
+    if (!checkIfFileExists(journal->path) && checkIfFileExists(tmpPath)) rename(tmpPath, journal->path);
+    
+    FILE *journalFile = fopen(journal->path, "rb");
+    if (!journalFile) return false;
+    
+    dumpJournalHeader header;
+    u8 *state = NULL;
+    bool success = false;
+    
+    if (fread(&header, 1, sizeof(dumpJournalHeader), journalFile) != sizeof(dumpJournalHeader)) goto out;
+    
+    if (header.magic != DUMP_JOURNAL_MAGIC || header.type != (u32)type || (totalSize && header.totalSize != totalSize) || header.stateSize > DUMP_BUFFER_SIZE) goto out;
+    
+    if (header.stateSize)
+    {
+        state = malloc(header.stateSize);
+        if (!state || fread(state, 1, header.stateSize, journalFile) != header.stateSize) goto out;
+    }
+    
+    if (dumpJournalCalculateCrc(&header, state) != header.journalCrc) goto out;
+    
+    memcpy(&(journal->header), &header, sizeof(dumpJournalHeader));
+    journal->state = state;
+    journal->resume = journal->saved = true;
+    
+    success = true;
+    
+out:
+    fclose(journalFile);
+    
+    if (!success)
+    {
+        if (state) free(state);
+        
+        // Get rid of corrupted or outdated journals
+        remove(journal->path);
+    }
+    
+    return success;
+}
+
+bool dumpJournalCheckpoint(dumpJournal *journal, outputWriter *writer, u64 dumpOffset, const void *state, u32 stateSize, bool force)
+{
+    if (!journal || !writer || !strlen(journal->path) || (stateSize && !state)) return false;
+    
+    // The interval is measured using the overall dump progress instead of the current output file, in order to also cover dumps made up of lots of small files
+    if (!force && dumpOffset >= journal->header.dumpOffset && (dumpOffset - journal->header.dumpOffset) < DUMP_JOURNAL_CHECKPOINT_INTERVAL) return true;
+    
+    // Make sure the data referenced by the journal has actually reached the storage medium
+    // Part files that have already been closed don't need this, but the async backend may still be writing them
+    // Output files are never fsync'd anywhere else, so metadata flushes are batched once per checkpoint window instead of once per write or per file
+    if (!outputWriterBackendFlush(writer)) return false;
+    
+    if (writer->file)
+    {
+        fflush(writer->file);
+        fsync(fileno(writer->file));
+    }
+    
+    dumpJournalHeader *header = &(journal->header);
+    
+    header->splitMode = (u32)writer->splitMode;
+    header->partSize = writer->partSize;
+    header->dumpOffset = dumpOffset;
+    header->fileIndex = journal->curFileIndex;
+    header->fileOffset = writer->curOffset;
+    header->verifyOffset = writer->checkpointOffset;
+    header->verifyCrc = writer->checkpointCrc;
+    header->stateSize = stateSize;
+    header->journalCrc = dumpJournalCalculateCrc(header, state);
+    
+    // Never rewrite the journal in place: a crash halfway through would leave a truncated journal behind, right when it's needed the most
+    // The new journal is written to a temporary file, flushed to the storage medium and then renamed over the previous one
+    char tmpPath[NAME_BUF_LEN + 8] = {'\0'};
+    snprintf(tmpPath, MAX_CHARACTERS(tmpPath), "%s%s", journal->path, DUMP_JOURNAL_TMP_EXTENSION);
+    
+    FILE *journalFile = fopen(tmpPath, "wb");
+    if (!journalFile)
+    {
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to open dump journal file!");
+        return false;
+    }
+    
+    bool success = (fwrite(header, 1, sizeof(dumpJournalHeader), journalFile) == sizeof(dumpJournalHeader) && (!stateSize || fwrite(state, 1, stateSize, journalFile) == stateSize));
+    
+    if (success) success = (fflush(journalFile) == 0 && fsync(fileno(journalFile)) == 0);
+    
+    fclose(journalFile);
+    
+    if (!success)
+    {
+        remove(tmpPath);
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to write dump journal file!");
+        return false;
+    }
+    
+    // The SD card filesystem doesn't let us rename over an existing file, so the previous journal is removed first if needed
+    // dumpJournalLoad() picks up the temporary file if we get interrupted right between both operations
+    if (rename(tmpPath, journal->path) != 0 && (remove(journal->path) != 0 || rename(tmpPath, journal->path) != 0))
+    {
+        remove(tmpPath);
+        snprintf(writer->errorStr, MAX_CHARACTERS(writer->errorStr), "failed to replace dump journal file!");
+        return false;
+    }
+    
+    journal->saved = true;
+    
+    // Start a new checkpoint window
+    writer->checkpointOffset = writer->curOffset;
+    writer->checkpointCrc = 0;
+    
+    return true;
+}
+
+void dumpJournalFree(dumpJournal *journal)
+{
+    if (!journal) return;
+    
+    if (journal->state)
+    {
+        free(journal->state);
+        journal->state = NULL;
+    }
+}
+
+void dumpJournalRemove(dumpJournal *journal)
+{
+    if (!journal) return;
+    
+    dumpJournalFree(journal);
+    journal->resume = false;
+    journal->header.dumpOffset = 0;
+    
+    if (journal->saved)
+    {
+        char tmpPath[NAME_BUF_LEN + 8] = {'\0'};
+        snprintf(tmpPath, MAX_CHARACTERS(tmpPath), "%s%s", journal->path, DUMP_JOURNAL_TMP_EXTENSION);
+        
+        remove(journal->path);
+        remove(tmpPath);
+        journal->saved = false;
+    }
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#ifndef __WRITER_H__
+#define __WRITER_H__
+
+#include <stdio.h>
+#include <pthread.h>
+#include <switch.h>
+#include "util.h"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+#define OUTPUT_WRITER_VERIFY_BUFFER_SIZE    (u64)0x100000               // 1 MiB
+
+#define OUTPUT_WRITER_BACKEND_MIN_SIZE      (u64)0x4000000              // 64 MiB. Smaller outputs always use the stdio backend, regardless of the selected one
+#define OUTPUT_WRITER_ASYNC_SLOT_SIZE       DUMP_BUFFER_SIZE
+#define OUTPUT_WRITER_ASYNC_SLOT_CNT        4
+
+#ifdef __linux__
+#define OUTPUT_WRITER_URING_SLOT_SIZE       DUMP_BUFFER_SIZE
+#define OUTPUT_WRITER_URING_SLOT_CNT        4                           // Maximum number of writes in flight
+#define OUTPUT_WRITER_URING_ALIGNMENT       (u64)0x1000                 // O_DIRECT buffer, file offset and write size alignment
+#endif
+
+typedef enum {
+    OUTPUT_SPLIT_NONE = 0,                          // Single output file
+    OUTPUT_SPLIT_DIRECTORY,                         // Parts are stored as "<path>/00", "<path>/01", etc. Used alongside the archive bit
+    OUTPUT_SPLIT_SUFFIX,                            // Parts are stored as "<path>.00", "<path>.01", etc. Used for sequential and generic split dumps
+    OUTPUT_SPLIT_XCI                                // Parts are stored as ".xc0", ".xc1", etc. (based on XCI-Cutter). The last character from the base path is replaced
+} outputSplitMode;
+
+typedef enum {
+    OUTPUT_WRITER_BACKEND_STDIO = 0,                // Blocking fwrite() calls on the calling thread. Default backend
+    OUTPUT_WRITER_BACKEND_ASYNC,                    // Data is copied to a ring of buffers and written by a dedicated thread, so the next block can be read while previous ones are still being written
+#ifdef __linux__
+    OUTPUT_WRITER_BACKEND_IO_URING,                 // Data is copied to block aligned buffers and written with O_DIRECT io_uring requests, keeping several writes in flight. Host builds only
+#endif
+    OUTPUT_WRITER_BACKEND_CNT
+} outputWriterBackend;
+
+typedef struct {
+    FILE *file;                                     // Destination part file
+    u8 *data;
+    u64 size;                                       // Buffered data size. Zero for close requests
+    bool closeFile;                                 // Set if the part file must be closed after writing the buffered data
+} outputWriterAsyncSlot;
+
+// State for OUTPUT_WRITER_BACKEND_ASYNC
+// Slots in [head, head + count) are queued for the worker thread. The slot right after them is the one being filled, if 'filling' is set
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;                            // Broadcasted whenever a slot is queued or released
+    outputWriterAsyncSlot slots[OUTPUT_WRITER_ASYNC_SLOT_CNT];
+    u8 *buffer;
+    u32 head;
+    u32 count;
+    u32 fillIndex;
+    bool filling;
+    bool exit;
+    bool error;
+    char errorStr[NAME_BUF_LEN];                    // Set by the worker thread
+} outputWriterAsyncCtx;
+
+#ifdef __linux__
+typedef struct {
+    u8 *data;                                       // OUTPUT_WRITER_URING_SLOT_SIZE bytes long, OUTPUT_WRITER_URING_ALIGNMENT aligned
+    u64 offset;                                     // Part file offset of the first buffered byte. Always aligned
+    u64 size;                                       // Buffered data size
+    u64 length;                                     // Write request length (size rounded up to the alignment, padded with zeroes)
+    u64 written;                                    // Request bytes already written. Short writes are resubmitted
+    bool inFlight;
+} outputWriterUringSlot;
+
+// State for OUTPUT_WRITER_BACKEND_IO_URING. Uses the raw io_uring syscalls, so it doesn't depend on liburing
+// Slots are filled in order. A full slot is submitted right away, and the next one is filled once its previous write has completed
+typedef struct {
+    int ringFd;
+    int fd;                                         // Descriptor for the current part file, opened with O_DIRECT if the filesystem supports it. -1 if not open yet
+    u64 partLength;                                 // Current part file size, used to drop the zero padding from the last write
+    bool padded;                                    // Set if zero padding was written past the end of the buffered data
+    void *sqRing;
+    void *cqRing;
+    size_t sqRingSize;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    u32 *sqTail;
+    u32 *sqMask;
+    u32 *sqArray;
+    u32 *cqHead;
+    u32 *cqTail;
+    u32 *cqMask;
+    struct io_uring_cqe *cqes;
+    outputWriterUringSlot slots[OUTPUT_WRITER_URING_SLOT_CNT];
+    u8 *buffer;
+    u32 fillIndex;
+    u32 inFlightCnt;
+    bool error;
+} outputWriterUringCtx;
+#endif
+
+typedef struct {
+    outputSplitMode splitMode;
+    char basePath[NAME_BUF_LEN];                    // Output path without any part suffix
+    char curPath[NAME_BUF_LEN];                     // Path to the current part file
+    u64 totalSize;                                  // Full output dump size
+    u64 partSize;                                   // Part file size. Ignored if splitMode == OUTPUT_SPLIT_NONE
+    u64 startOffset;                                // Output dump offset at which the first part file handled by this writer starts (e.g. when resuming a sequential dump)
+    u64 curOffset;                                  // Current output dump offset
+    u8 partIndex;                                   // Current part index
+    FILE *file;                                     // Current part file. NULL if no part file is open
+    u64 checkpointOffset;                           // Output dump offset at which the current checkpoint window starts
+    bool trackCheckpointCrc;                        // Only set if the output is covered by a dump journal
+    u32 checkpointCrc;                              // CRC32 checksum of the data written since checkpointOffset. Used to re-validate the output when resuming from a journal
+    outputWriterBackend backend;                    // Selected while opening the writer (see outputWriterSetDefaultBackend())
+    outputWriterAsyncCtx *async;                    // Only allocated if backend == OUTPUT_WRITER_BACKEND_ASYNC
+#ifdef __linux__
+    outputWriterUringCtx *uring;                    // Only allocated if backend == OUTPUT_WRITER_BACKEND_IO_URING
+#endif
+    char errorStr[NAME_BUF_LEN];                    // Description of the last error
+} outputWriter;
+
+typedef struct {
+    const void *data;
+    u64 size;
+} outputWriterChunk;
+
+#define DUMP_JOURNAL_MAGIC                  (u32)0x4C4E4A44             // "DJNL"
+#define DUMP_JOURNAL_EXTENSION              ".jnl"
+#define DUMP_JOURNAL_TMP_EXTENSION          ".tmp"
+#define DUMP_JOURNAL_CHECKPOINT_INTERVAL    (u64)0x4000000              // 64 MiB
+
+typedef enum {
+    DUMP_JOURNAL_TYPE_XCI = 0,
+    DUMP_JOURNAL_TYPE_NSP,
+    DUMP_JOURNAL_TYPE_NSP_BUNDLE,
+    DUMP_JOURNAL_TYPE_RAW_HFS0,
+    DUMP_JOURNAL_TYPE_HFS0_DATA,
+    DUMP_JOURNAL_TYPE_HFS0_FILE,
+    DUMP_JOURNAL_TYPE_EXEFS_DATA,
+    DUMP_JOURNAL_TYPE_EXEFS_FILE,
+    DUMP_JOURNAL_TYPE_ROMFS_DATA,
+    DUMP_JOURNAL_TYPE_ROMFS_FILE,
+    DUMP_JOURNAL_TYPE_BIS_PARTITION
+} dumpJournalType;
+
+// Stored at the start of the journal file, followed by 'stateSize' bytes of dump specific state (hash contexts, CRC32 accumulators, etc.)
+typedef struct {
+    u32 magic;                                      // DUMP_JOURNAL_MAGIC
+    u32 type;                                       // dumpJournalType
+    u64 totalSize;                                  // Full dump size. Used to make sure the journal matches the current dump
+    u32 splitMode;                                  // outputSplitMode used by the output file that was being written
+    u64 partSize;                                   // Part file size used by the output file that was being written
+    u64 dumpOffset;                                 // Dump progress (all output files) at the time of the last checkpoint
+    u32 fileIndex;                                  // Index of the output file that was being written at the time of the last checkpoint. Always zero for single file dumps
+    u64 fileOffset;                                 // Offset within that output file. Everything before it has already been flushed to the storage medium
+    u64 verifyOffset;                               // Start offset of the output file block covered by verifyCrc
+    u32 verifyCrc;                                  // CRC32 checksum of the output file block located at [verifyOffset, fileOffset)
+    u32 stateSize;                                  // Dump specific state size
+    u32 journalCrc;                                 // CRC32 checksum of this header (calculated with this field set to zero) and the dump specific state
+} PACKED dumpJournalHeader;
+
+typedef struct {
+    char path[NAME_BUF_LEN];                        // Journal file path
+    dumpJournalHeader header;                       // Last loaded / written journal header
+    u8 *state;                                      // Dump specific state loaded from the journal file. Only valid if resume == true
+    bool resume;                                    // Set if a valid journal was found and the dump is being resumed
+    bool saved;                                     // Set if the journal file on the storage medium holds the current dump progress
+    u32 curFileIndex;                               // Index of the output file currently being written. Updated by multi-file dumps
+    u32 fileCount;                                  // Number of output files handled so far by multi-file dumps
+} dumpJournal;
+
+// Selects the backend used by writers opened from now on. OUTPUT_WRITER_BACKEND_STDIO is used by default
+// Writers fall back to the stdio backend if the output is smaller than OUTPUT_WRITER_BACKEND_MIN_SIZE, or if the selected backend can't be started
+void outputWriterSetDefaultBackend(outputWriterBackend backend);
+
+outputWriterBackend outputWriterGetDefaultBackend();
+
+// Opens the output writer and creates the part file that holds the data located at 'curOffset'
+// 'partIndex' must match the part that holds 'curOffset' (e.g. when resuming a sequential dump)
+bool outputWriterOpen(outputWriter *writer, const char *basePath, outputSplitMode splitMode, u64 totalSize, u64 partSize, u8 partIndex, u64 curOffset, const dumpJournal *journal);
+
+// Writes data at the current output dump offset, switching to a new part file whenever a part boundary is reached
+// With the async and io_uring backends, data is only guaranteed to be on the storage medium after a checkpoint, a patch or the write that completes the output dump. Errors are reported by the next call
+bool outputWriterWrite(outputWriter *writer, const void *buf, u64 size);
+
+// Writes multiple chunks at the current output dump offset, in order
+bool outputWriterWriteVectored(outputWriter *writer, const outputWriterChunk *chunks, u32 chunkCnt);
+
+// Overwrites previously written data (e.g. placeholder headers). The current output dump offset isn't modified
+bool outputWriterPatch(outputWriter *writer, u64 offset, const void *buf, u64 size);
+
+// Waits for all pending writes, then closes the current part file
+void outputWriterClose(outputWriter *writer);
+
+// Re-opens a partially written output dump at the offset recorded in the journal, after re-validating the data written since the previous checkpoint
+// Returns false if the output files are missing or if their contents don't match the journal, in which case the dump must be restarted from scratch
+bool outputWriterResume(outputWriter *writer, const char *basePath, outputSplitMode splitMode, u64 totalSize, u64 partSize, dumpJournal *journal);
+
+// Sets the archive bit on the output directory. Only valid if splitMode == OUTPUT_SPLIT_DIRECTORY
+Result outputWriterSetArchiveBit(outputWriter *writer);
+
+// Generates the journal path for the provided output path and loads the journal file, if available
+// journal->resume is only set if the journal is valid and matches the provided dump type and size. Invalid journals are deleted
+// The size check is skipped if 'totalSize' is zero (e.g. if the dump size depends on options restored from the journal state)
+bool dumpJournalLoad(dumpJournal *journal, const char *outputPath, dumpJournalType type, u64 totalSize);
+
+// Flushes the output writer and updates the journal file if at least DUMP_JOURNAL_CHECKPOINT_INTERVAL bytes have been written since the previous checkpoint (or if 'force' is true)
+bool dumpJournalCheckpoint(dumpJournal *journal, outputWriter *writer, u64 dumpOffset, const void *state, u32 stateSize, bool force);
+
+// Frees the loaded dump specific state. The journal file is kept, so the dump can be resumed later
+void dumpJournalFree(dumpJournal *journal);
+
+// Frees the loaded dump specific state and deletes the journal file (e.g. after a successful dump, or if the user chose not to resume it)
+void dumpJournalRemove(dumpJournal *journal);
+
+#endif
@@ -0,0 +1,117 @@
+#include <string.h>
+
+#include "xci_image.h"
+
+u64 getGameCardCapacity(u8 sizeValue)
+{
+    switch(sizeValue)
+    {
+        case 0xFA: // 1 GiB
+            return GAMECARD_SIZE_1GiB;
+        case 0xF8: // 2 GiB
+            return GAMECARD_SIZE_2GiB;
+        case 0xF0: // 4 GiB
+            return GAMECARD_SIZE_4GiB;
+        case 0xE0: // 8 GiB
+            return GAMECARD_SIZE_8GiB;
+        case 0xE1: // 16 GiB
+            return GAMECARD_SIZE_16GiB;
+        case 0xE2: // 32 GiB
+            return GAMECARD_SIZE_32GiB;
+        default:
+            break;
+    }
+    
+    return 0;
+}
+
+u64 getGameCardSecureStorageSize(u64 capacity, u64 normalSize)
+{
+    return ((capacity - ((capacity / GAMECARD_ECC_BLOCK_SIZE) * GAMECARD_ECC_DATA_SIZE)) - normalSize);
+}
+
+bool xciImageStorageOpen(xci_image_storage_t *storage, const char *path, u32 idx)
+{
+    if (!storage) return false;
+    
+    memset(storage, 0, sizeof(xci_image_storage_t));
+    
+    if (!path || !strlen(path) || idx > XCI_IMAGE_STORAGE_SECURE) return false;
+    
+    u32 i;
+    bool success = false;
+    gamecard_header_t header;
+    u64 fileSize = 0, baseOffset = 0, capacity = 0, normalSize = 0;
+    
+    storage->file = fopen(path, "rb");
+    if (!storage->file) return false;
+    
+    fseek(storage->file, 0, SEEK_END);
+    fileSize = ftell(storage->file);
+    
+    // Look for the gamecard header, skipping the key area if the image has one
+    for(i = 0; i < 2; i++)
+    {
+        baseOffset = (i * GAMECARD_KEY_AREA_SIZE);
+        
+        if (fseek(storage->file, baseOffset, SEEK_SET) != 0 || fread(&header, 1, sizeof(gamecard_header_t), storage->file) != sizeof(gamecard_header_t)) goto out;
+        
+        if (__builtin_bswap32(header.magic) == GAMECARD_HEADER_MAGIC) break;
+    }
+    
+    if (i == 2) goto out;
+    
+    capacity = getGameCardCapacity(header.size);
+    normalSize = ((u64)header.secureAreaStartAddr * MEDIA_UNIT_SIZE);
+    if (!capacity || !normalSize || normalSize >= capacity || fileSize < (baseOffset + normalSize)) goto out;
+    
+    if (idx == XCI_IMAGE_STORAGE_NORMAL)
+    {
+        storage->offset = baseOffset;
+        storage->size = normalSize;
+    } else {
+        storage->offset = (baseOffset + normalSize);
+        storage->size = getGameCardSecureStorageSize(capacity, normalSize);
+    }
+    
+    storage->availableSize = (fileSize - storage->offset);
+    if (storage->availableSize > storage->size) storage->availableSize = storage->size;
+    
+    success = true;
+    
+out:
+    if (!success)
+    {
+        fclose(storage->file);
+        storage->file = NULL;
+    }
+    
+    return success;
+}
+
+bool xciImageStorageRead(xci_image_storage_t *storage, u64 off, void *buf, size_t len)
+{
+    if (!storage || !storage->file || !buf || (off + len) > storage->size) return false;
+    
+    u64 fileReadSize = (off < storage->availableSize ? (storage->availableSize - off) : 0);
+    if (fileReadSize > len) fileReadSize = len;
+    
+    if (fileReadSize)
+    {
+        if (fseek(storage->file, storage->offset + off, SEEK_SET) != 0 || fread(buf, 1, fileReadSize, storage->file) != fileReadSize) return false;
+    }
+    
+    // Trimmed images don't hold the padding from the end of the secure area
+    if (fileReadSize < len) memset((u8*)buf + fileReadSize, 0xFF, len - fileReadSize);
+    
+    return true;
+}
+
+void xciImageStorageClose(xci_image_storage_t *storage)
+{
+    if (!storage) return;
+    
+    if (storage->file) fclose(storage->file);
+    
+    memset(storage, 0, sizeof(xci_image_storage_t));
+}
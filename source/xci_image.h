@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef __XCI_IMAGE_H__
+#define __XCI_IMAGE_H__
+
+#include <stdio.h>
+#include <switch/types.h>
+#include <switch/crypto/sha256.h>
+
+#define GAMECARD_HEADER_MAGIC           (u32)0x48454144                         // "HEAD"
+
+#define GAMECARD_SIZE_1GiB              (u64)0x40000000
+#define GAMECARD_SIZE_2GiB              (u64)0x80000000
+#define GAMECARD_SIZE_4GiB              (u64)0x100000000
+#define GAMECARD_SIZE_8GiB              (u64)0x200000000
+#define GAMECARD_SIZE_16GiB             (u64)0x400000000
+#define GAMECARD_SIZE_32GiB             (u64)0x800000000
+
+#define GAMECARD_ECC_BLOCK_SIZE         (u64)0x200                              // 512 bytes
+#define GAMECARD_ECC_DATA_SIZE          (u64)0x24                               // 36 bytes
+
+#define GAMECARD_KEY_AREA_SIZE          (u64)0x1000                             // Some XCI image files start with the gamecard key area, followed by the gamecard header
+
+#define MEDIA_UNIT_SIZE                 0x200
+
+#define XCI_IMAGE_STORAGE_NORMAL        0
+#define XCI_IMAGE_STORAGE_SECURE        1
+
+typedef struct {
+    u8 signature[0x100];
+    u32 magic;
+    u32 secureAreaStartAddr;
+    u32 backupAreaStartAddr;
+    u8 titleKeyIndex;
+    u8 size;
+    u8 headerVersion;
+    u8 flags;
+    u64 packageId;
+    u64 validDataEndAddr;
+    u8 iv[0x10];
+    u64 rootHfs0HeaderOffset;
+    u64 rootHfs0HeaderSize;
+    u8 rootHfs0HeaderHash[SHA256_HASH_SIZE];
+    u8 initialDataHash[SHA256_HASH_SIZE];
+    u32 securityMode;
+    u32 t1KeyIndex;
+    u32 keyIndex;
+    u32 normalAreaEndAddr;
+    u8 encryptedInfoBlock[0x70];
+} PACKED gamecard_header_t;
+
+// Gamecard IStorage partition emulated from a XCI image file
+// The normal IStorage partition ends where the secure area starts, and the secure IStorage partition spans the rest of the gamecard capacity (minus ECC data)
+typedef struct {
+    FILE *file;                                                 // Each storage has its own file handle, so different storages can be read from different threads
+    u64 offset;                                                 // Partition start offset within the XCI image file
+    u64 size;                                                   // Partition size, just like the gamecard would report it
+    u64 availableSize;                                          // Partition bytes actually stored in the XCI image file. Trimmed images are shorter than 'size', and the missing area is read back as 0xFF padding
+} xci_image_storage_t;
+
+// Returns the gamecard capacity for a gamecard header size value, or 0 if it's unknown
+u64 getGameCardCapacity(u8 sizeValue);
+
+// Returns the size of the secure IStorage partition for the provided gamecard capacity and normal IStorage partition size
+u64 getGameCardSecureStorageSize(u64 capacity, u64 normalSize);
+
+// 'idx' must be either XCI_IMAGE_STORAGE_NORMAL or XCI_IMAGE_STORAGE_SECURE
+bool xciImageStorageOpen(xci_image_storage_t *storage, const char *path, u32 idx);
+bool xciImageStorageRead(xci_image_storage_t *storage, u64 off, void *buf, size_t len);
+void xciImageStorageClose(xci_image_storage_t *storage);
+
+#endif
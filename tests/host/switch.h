@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef __HOST_SWITCH_H__
+#define __HOST_SWITCH_H__
+
+// Minimal stand-in for libnx's switch.h, used to build platform-independent modules on the host
+// Service-backed types are opaque here, since the host builds never talk to any service
+
+#include <switch/types.h>
+#include <switch/crypto/sha256.h>
+
+typedef struct {
+    u8 c[0x10];
+} NcmContentId;
+
+typedef struct {
+    u64 id;
+    u32 version;
+    u8 type;
+    u8 install_type;
+    u8 padding[2];
+} NcmContentMetaKey;
+
+typedef struct {
+    NcmContentMetaKey key;
+    u64 application_id;
+} NcmApplicationContentMetaKey;
+
+typedef struct {
+    NcmContentId content_id;
+    u8 size[0x6];
+    u8 content_type;
+    u8 id_offset;
+} NcmContentInfo;
+
+typedef enum {
+    NcmStorageId_None          = 0,
+    NcmStorageId_Host          = 1,
+    NcmStorageId_GameCard      = 2,
+    NcmStorageId_BuiltInSystem = 3,
+    NcmStorageId_BuiltInUser   = 4,
+    NcmStorageId_SdCard        = 5,
+    NcmStorageId_Any           = 6
+} NcmStorageId;
+
+typedef enum {
+    NcmContentType_Meta             = 0,
+    NcmContentType_Program          = 1,
+    NcmContentType_Data             = 2,
+    NcmContentType_Control          = 3,
+    NcmContentType_HtmlDocument     = 4,
+    NcmContentType_LegalInformation = 5,
+    NcmContentType_DeltaFragment    = 6
+} NcmContentType;
+
+typedef enum {
+    NcmContentMetaType_Unknown              = 0x00,
+    NcmContentMetaType_SystemProgram        = 0x01,
+    NcmContentMetaType_SystemData           = 0x02,
+    NcmContentMetaType_SystemUpdate         = 0x03,
+    NcmContentMetaType_BootImagePackage     = 0x04,
+    NcmContentMetaType_BootImagePackageSafe = 0x05,
+    NcmContentMetaType_Application          = 0x80,
+    NcmContentMetaType_Patch                = 0x81,
+    NcmContentMetaType_AddOnContent         = 0x82,
+    NcmContentMetaType_Delta                = 0x83
+} NcmContentMetaType;
+
+typedef struct {
+    void *opaque;
+} NcmContentStorage;
+
+typedef struct {
+    u8 opaque[0x130];
+} Aes128CtrContext;
+
+typedef struct romfs_dir romfs_dir;
+typedef struct romfs_file romfs_file;
+
+typedef u32 Result;
+
+#define R_SUCCEEDED(res)    ((res) == 0)
+#define R_FAILED(res)       ((res) != 0)
+#define MAKERESULT(module, description)     ((((module) & 0x1FF)) | ((description) & 0x1FFF) << 9)
+
+enum {
+    Module_Libnx = 345
+};
+
+enum {
+    LibnxError_BadInput = 2,
+    LibnxError_OutOfMemory = 4,
+    LibnxError_IoError = 5,
+    LibnxError_NotInitialized = 7
+};
+
+typedef struct {
+    void *opaque;
+} FsStorage;
+
+typedef struct {
+    void *opaque;
+} FsDeviceOperator;
+
+typedef struct {
+    void *opaque;
+} FsEventNotifier;
+
+typedef struct {
+    void *opaque;
+} Event;
+
+typedef struct {
+    u32 value;
+} FsGameCardHandle;
+
+// Implemented by the host test programs that need them
+u32 crc32CalculateWithSeed(u32 seed, const void *src, size_t size);
+Result fsdevSetConcatenationFileAttribute(const char *path);
+
+#endif
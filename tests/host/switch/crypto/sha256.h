@@ -0,0 +1,12 @@
+#pragma once
+
+#ifndef __HOST_SWITCH_CRYPTO_SHA256_H__
+#define __HOST_SWITCH_CRYPTO_SHA256_H__
+
+// Minimal stand-in for libnx's switch/crypto/sha256.h
+
+#include <switch/types.h>
+
+#define SHA256_HASH_SIZE    0x20
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef __HOST_SWITCH_TYPES_H__
+#define __HOST_SWITCH_TYPES_H__
+
+// Minimal stand-in for libnx's switch/types.h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#define PACKED  __attribute__((packed))
+
+#endif
@@ -0,0 +1,60 @@
+// Host implementations of the libnx and util.c functions used by writer.c
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <switch.h>
+
+bool checkIfFileExists(const char *path)
+{
+    if (!path || !strlen(path)) return false;
+    
+    FILE *chkfile = fopen(path, "rb");
+    if (chkfile)
+    {
+        fclose(chkfile);
+        return true;
+    }
+    
+    return false;
+}
+
+// Same as the util.c version, minus the transfer chunk size based stdio buffer
+FILE *openDumpOutputFile(const char *path, u64 size)
+{
+    if (!path || !strlen(path)) return NULL;
+    
+    FILE *outFile = fopen(path, "wb");
+    if (!outFile) return NULL;
+    
+    if (size && ftruncate(fileno(outFile), (off_t)size) != 0)
+    {
+        fclose(outFile);
+        remove(path);
+        return NULL;
+    }
+    
+    return outFile;
+}
+
+// Bitwise CRC32 (reflected 0xEDB88320 polynomial), matching libnx's crc32CalculateWithSeed()
+u32 crc32CalculateWithSeed(u32 seed, const void *src, size_t size)
+{
+    const u8 *data = (const u8*)src;
+    u32 crc = ~seed;
+    
+    for(size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for(u32 j = 0; j < 8; j++) crc = ((crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1))));
+    }
+    
+    return ~crc;
+}
+
+Result fsdevSetConcatenationFileAttribute(const char *path)
+{
+    (void)path;
+    return 0;
+}
@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "local_content.h"
+#include "nca.h"
+
+#define PFS0_OFFSET     0x4000      // Where the PFS0 section starts within the fake Meta NCA
+#define META_NCA_SIZE   0x8000
+
+static u32 failedChecks = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failedChecks++; \
+        } \
+    } while(0)
+
+static const char *appNcaName = "0123456789abcdef0123456789ABCDEF.nca";
+static const char *metaNcaName = "fedcba9876543210fedcba9876543210.cnmt.nca";
+static const char *splitNcaName = "00112233445566778899aabbccddeeff.nca";
+static const char *deepNcaName = "ffffffffffffffffffffffffffffffff.nca";
+
+static char rootPath[64];
+
+static bool writeFile(const char *dir, const char *name, u64 size)
+{
+    char path[LOCAL_CONTENT_PATH_LEN];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return false;
+    
+    bool success = (!size || (fseek(fp, (long)(size - 1), SEEK_SET) == 0 && fputc(0, fp) == 0));
+    fclose(fp);
+    
+    return success;
+}
+
+static void makeDir(char *path, size_t pathSize, const char *parent, const char *name)
+{
+    snprintf(path, pathSize, "%s/%s", parent, name);
+    CHECK(mkdir(path, 0755) == 0);
+}
+
+static const localContentEntry *findEntry(const localContentEntry *entries, u32 entryCnt, const char *name)
+{
+    NcmContentId contentId;
+    bool isMeta;
+    
+    if (!parseLocalContentId(name, &contentId, &isMeta)) return NULL;
+    
+    for(u32 i = 0; i < entryCnt; i++)
+    {
+        if (!memcmp(entries[i].contentId.c, contentId.c, sizeof(NcmContentId))) return &(entries[i]);
+    }
+    
+    return NULL;
+}
+
+static void testParseContentId(void)
+{
+    NcmContentId contentId;
+    bool isMeta = true;
+    
+    CHECK(parseLocalContentId(appNcaName, &contentId, &isMeta));
+    CHECK(!isMeta);
+    CHECK(contentId.c[0] == 0x01 && contentId.c[7] == 0xEF && contentId.c[8] == 0x01 && contentId.c[15] == 0xEF);
+    
+    CHECK(parseLocalContentId(metaNcaName, &contentId, &isMeta));
+    CHECK(isMeta);
+    CHECK(contentId.c[0] == 0xFE && contentId.c[15] == 0x10);
+    
+    CHECK(parseLocalContentId("0123456789ABCDEF0123456789ABCDEF.NCA", &contentId, &isMeta));
+    
+    CHECK(!parseLocalContentId("0123456789abcdef0123456789abcdeg.nca", &contentId, &isMeta));
+    CHECK(!parseLocalContentId("0123456789abcdef0123456789abcdef.nsp", &contentId, &isMeta));
+    CHECK(!parseLocalContentId("0123456789abcdef0123456789abcde.nca", &contentId, &isMeta));
+    CHECK(!parseLocalContentId("0123456789abcdef0123456789abcdef.cnmt.xml", &contentId, &isMeta));
+}
+
+// registered/
+//   <app>.nca                    single file
+//   a/b/<meta>.cnmt.nca          nested file
+//   <split>.nca/00, 01, 02       split content
+//   empty.nca (zero size), notes.txt
+//   1/2/3/4/5/<deep>.nca         deeper than LOCAL_CONTENT_MAX_DIR_DEPTH
+static void testScanDirectory(void)
+{
+    u32 i;
+    char path[LOCAL_CONTENT_PATH_LEN], subPath[LOCAL_CONTENT_PATH_LEN];
+    
+    localContentEntry *entries = NULL;
+    u32 entryCnt = 0;
+    
+    CHECK(writeFile(rootPath, appNcaName, 0x1234));
+    CHECK(writeFile(rootPath, "notes.txt", 0x10));
+    CHECK(writeFile(rootPath, "00000000000000000000000000000000.nca", 0));
+    
+    makeDir(path, sizeof(path), rootPath, "a");
+    makeDir(subPath, sizeof(subPath), path, "b");
+    CHECK(writeFile(subPath, metaNcaName, META_NCA_SIZE));
+    
+    makeDir(path, sizeof(path), rootPath, splitNcaName);
+    CHECK(writeFile(path, "00", 0x1000));
+    CHECK(writeFile(path, "01", 0x1000));
+    CHECK(writeFile(path, "02", 0x200));
+    
+    snprintf(path, sizeof(path), "%s", rootPath);
+    for(i = 1; i <= (LOCAL_CONTENT_MAX_DIR_DEPTH + 1); i++)
+    {
+        char name[4];
+        snprintf(name, sizeof(name), "%u", i);
+        makeDir(subPath, sizeof(subPath), path, name);
+        snprintf(path, sizeof(path), "%s", subPath);
+    }
+    
+    CHECK(writeFile(path, deepNcaName, 0x200));
+    
+    scanLocalContentDirectory(rootPath, &entries, &entryCnt);
+    CHECK(entryCnt == 3);
+    
+    const localContentEntry *entry = findEntry(entries, entryCnt, appNcaName);
+    CHECK(entry && !entry->isMeta && !entry->partCnt && entry->size == 0x1234);
+    
+    entry = findEntry(entries, entryCnt, metaNcaName);
+    CHECK(entry && entry->isMeta && entry->size == META_NCA_SIZE && strstr(entry->path, "/a/b/") != NULL);
+    
+    entry = findEntry(entries, entryCnt, splitNcaName);
+    CHECK(entry && entry->partCnt == 3 && entry->partSize == 0x1000 && entry->size == 0x2200);
+    
+    CHECK(findEntry(entries, entryCnt, deepNcaName) == NULL);
+    
+    free(entries);
+}
+
+typedef struct {
+    const u8 *data;
+    u64 size;
+} memoryReader;
+
+static bool readMemory(void *userData, u64 offset, void *outBuf, u64 size)
+{
+    memoryReader *reader = (memoryReader*)userData;
+    if ((offset + size) > reader->size) return false;
+    
+    memcpy(outBuf, reader->data + offset, size);
+    return true;
+}
+
+// Builds a plaintext Meta NCA PFS0 section: a single "<type>_<title_id>.cnmt" file with two content records
+static u64 buildMetaSection(u8 *nca, u8 type, u64 titleId, u64 applicationId, u16 contentCnt)
+{
+    u32 i;
+    char strTable[0x30] = {'\0'};
+    
+    snprintf(strTable, sizeof(strTable), "%s_%016lx.cnmt", (type == NcmContentMetaType_Patch ? "Patch" : "Application"), (unsigned long)titleId);
+    
+    u64 cnmtSize = (sizeof(cnmt_header) + sizeof(cnmt_extended_header) + (contentCnt * sizeof(cnmt_content_record)) + SHA256_HASH_SIZE);
+    
+    pfs0_header header = { __builtin_bswap32(PFS0_MAGIC), 1, sizeof(strTable), 0 };
+    pfs0_file_entry fileEntry = { 0, cnmtSize, 0, 0 };
+    
+    u8 *ptr = (nca + PFS0_OFFSET);
+    memcpy(ptr, &header, sizeof(pfs0_header));
+    ptr += sizeof(pfs0_header);
+    memcpy(ptr, &fileEntry, sizeof(pfs0_file_entry));
+    ptr += sizeof(pfs0_file_entry);
+    memcpy(ptr, strTable, sizeof(strTable));
+    ptr += sizeof(strTable);
+    
+    cnmt_header cnmtHeader;
+    memset(&cnmtHeader, 0, sizeof(cnmt_header));
+    cnmtHeader.title_id = titleId;
+    cnmtHeader.version = 0x10000;
+    cnmtHeader.type = type;
+    cnmtHeader.extended_header_size = sizeof(cnmt_extended_header);
+    cnmtHeader.content_cnt = contentCnt;
+    memcpy(ptr, &cnmtHeader, sizeof(cnmt_header));
+    ptr += sizeof(cnmt_header);
+    
+    cnmt_extended_header extHeader = { applicationId, 0, 0 };
+    memcpy(ptr, &extHeader, sizeof(cnmt_extended_header));
+    ptr += sizeof(cnmt_extended_header);
+    
+    for(i = 0; i < contentCnt; i++)
+    {
+        cnmt_content_record record;
+        memset(&record, 0, sizeof(cnmt_content_record));
+        memset(record.nca_id, 0x10 + i, sizeof(record.nca_id));
+        record.size[0] = 0x00;
+        record.size[1] = (u8)(0x10 + i);
+        record.type = (u8)(i == 0 ? NcmContentType_Program : NcmContentType_Control);
+        memcpy(ptr, &record, sizeof(cnmt_content_record));
+        ptr += sizeof(cnmt_content_record);
+    }
+    
+    return cnmtSize;
+}
+
+static void testParseMeta(void)
+{
+    u8 *nca = calloc(1, META_NCA_SIZE);
+    if (!nca)
+    {
+        CHECK(nca != NULL);
+        return;
+    }
+    
+    localContentEntry entry;
+    memset(&entry, 0, sizeof(localContentEntry));
+    CHECK(parseLocalContentId(metaNcaName, &(entry.contentId), &(entry.isMeta)));
+    entry.size = META_NCA_SIZE;
+    
+    memoryReader reader = { nca, META_NCA_SIZE };
+    localContentMetaEntry meta;
+    
+    // Base application: the application ID is the title ID
+    buildMetaSection(nca, NcmContentMetaType_Application, 0x0100000000010000ULL, 0x0100000000010800ULL, 2);
+    CHECK(parseLocalContentMeta(&entry, PFS0_OFFSET, readMemory, &reader, &meta));
+    CHECK(meta.key.key.id == 0x0100000000010000ULL && meta.key.key.version == 0x10000 && meta.key.key.type == NcmContentMetaType_Application);
+    CHECK(meta.key.application_id == 0x0100000000010000ULL);
+    CHECK(meta.contentInfoCnt == 3);
+    
+    if (meta.contentInfos && meta.contentInfoCnt == 3)
+    {
+        CHECK(meta.contentInfos[0].content_id.c[0] == 0x10 && meta.contentInfos[0].size[1] == 0x10 && meta.contentInfos[0].content_type == NcmContentType_Program);
+        CHECK(meta.contentInfos[1].content_id.c[15] == 0x11 && meta.contentInfos[1].content_type == NcmContentType_Control);
+        
+        // The Meta NCA itself comes last
+        CHECK(!memcmp(meta.contentInfos[2].content_id.c, entry.contentId.c, sizeof(NcmContentId)));
+        CHECK(meta.contentInfos[2].content_type == NcmContentType_Meta);
+        CHECK(meta.contentInfos[2].size[0] == 0x00 && meta.contentInfos[2].size[1] == 0x80 && meta.contentInfos[2].size[2] == 0x00);
+    }
+    
+    free(meta.contentInfos);
+    
+    // Patch: the application ID comes from the extended header
+    memset(nca, 0, META_NCA_SIZE);
+    buildMetaSection(nca, NcmContentMetaType_Patch, 0x0100000000010800ULL, 0x0100000000010000ULL, 1);
+    CHECK(parseLocalContentMeta(&entry, PFS0_OFFSET, readMemory, &reader, &meta));
+    CHECK(meta.key.key.type == NcmContentMetaType_Patch && meta.key.application_id == 0x0100000000010000ULL);
+    CHECK(meta.contentInfoCnt == 2);
+    free(meta.contentInfos);
+    
+    // Content records that don't fit in the CNMT file
+    memset(nca, 0, META_NCA_SIZE);
+    buildMetaSection(nca, NcmContentMetaType_Application, 0x0100000000010000ULL, 0, 2);
+    ((pfs0_file_entry*)(nca + PFS0_OFFSET + sizeof(pfs0_header)))->file_size = (sizeof(cnmt_header) + sizeof(cnmt_extended_header) + SHA256_HASH_SIZE);
+    CHECK(!parseLocalContentMeta(&entry, PFS0_OFFSET, readMemory, &reader, &meta));
+    
+    // Bad PFS0 magic
+    memset(nca, 0, META_NCA_SIZE);
+    buildMetaSection(nca, NcmContentMetaType_Application, 0x0100000000010000ULL, 0, 2);
+    nca[PFS0_OFFSET] ^= 0xFF;
+    CHECK(!parseLocalContentMeta(&entry, PFS0_OFFSET, readMemory, &reader, &meta));
+    
+    // Reads past the end of the NCA
+    reader.size = (PFS0_OFFSET + 0x20);
+    nca[PFS0_OFFSET] ^= 0xFF;
+    CHECK(!parseLocalContentMeta(&entry, PFS0_OFFSET, readMemory, &reader, &meta));
+    
+    free(nca);
+}
+
+int main(void)
+{
+    char cmd[128];
+    
+    snprintf(rootPath, sizeof(rootPath), "/tmp/local_content_testXXXXXX");
+    if (!mkdtemp(rootPath))
+    {
+        fprintf(stderr, "local_content_test: unable to create a temporary directory\n");
+        return 1;
+    }
+    
+    testParseContentId();
+    testScanDirectory();
+    testParseMeta();
+    
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", rootPath);
+    if (system(cmd) != 0) fprintf(stderr, "local_content_test: unable to remove %s\n", rootPath);
+    
+    if (failedChecks)
+    {
+        fprintf(stderr, "local_content_test: %u check(s) failed\n", failedChecks);
+        return 1;
+    }
+    
+    printf("local_content_test: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "overlay.h"
+
+#define BUF_SIZE    64
+
+static u32 failedChecks = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failedChecks++; \
+        } \
+    } while(0)
+
+static const u8 patchA[4] = { 0xA0, 0xA1, 0xA2, 0xA3 };
+static const u8 patchB[8] = { 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7 };
+static const u8 patchC[2] = { 0xC0, 0xC1 };
+
+// Regions: A = [16, 20), B = [32, 40), C = [48, 50)
+static void setupList(dataOverlayList *list)
+{
+    dataOverlayListInit(list);
+    
+    // Inserted out of order on purpose
+    CHECK(dataOverlayListAdd(list, 32, patchB, sizeof(patchB)));
+    CHECK(dataOverlayListAdd(list, 48, patchC, sizeof(patchC)));
+    CHECK(dataOverlayListAdd(list, 16, patchA, sizeof(patchA)));
+}
+
+static void fillBuffer(u8 *buf, u64 size)
+{
+    memset(buf, 0xEE, size);
+}
+
+static void testAdd(void)
+{
+    dataOverlayList list;
+    setupList(&list);
+    
+    CHECK(list.count == 3);
+    CHECK(list.entries[0].offset == 16 && list.entries[1].offset == 32 && list.entries[2].offset == 48);
+    
+    // Overlapping inserts are rejected and leave the list untouched
+    CHECK(!dataOverlayListAdd(&list, 14, patchA, sizeof(patchA)));     // Straddles the start of A
+    CHECK(!dataOverlayListAdd(&list, 38, patchA, sizeof(patchA)));     // Straddles the end of B
+    CHECK(!dataOverlayListAdd(&list, 33, patchC, sizeof(patchC)));     // Contained in B
+    CHECK(!dataOverlayListAdd(&list, 30, patchB, sizeof(patchB)));     // Covers the start of B
+    CHECK(!dataOverlayListAdd(&list, 12, patchB, sizeof(patchB)));     // Contains A
+    CHECK(list.count == 3);
+    
+    // Adjacent regions don't overlap
+    CHECK(dataOverlayListAdd(&list, 20, patchA, sizeof(patchA)));
+    CHECK(dataOverlayListAdd(&list, 28, patchA, sizeof(patchA)));
+    CHECK(dataOverlayListAdd(&list, 0, patchC, sizeof(patchC)));
+    CHECK(list.count == 6);
+    
+    u32 i;
+    for(i = 1; i < list.count; i++) CHECK((list.entries[i - 1].offset + list.entries[i - 1].size) <= list.entries[i].offset);
+    
+    // Empty overlays are accepted but not stored, invalid arguments are rejected
+    CHECK(dataOverlayListAdd(&list, 33, patchB, 0));
+    CHECK(!dataOverlayListAdd(&list, 60, NULL, 4));
+    CHECK(!dataOverlayListAdd(NULL, 60, patchA, sizeof(patchA)));
+    CHECK(list.count == 6);
+    
+    // Growing past the initial capacity keeps the entries sorted
+    dataOverlayListClear(&list);
+    CHECK(list.count == 0);
+    
+    for(i = 0; i < (DATA_OVERLAY_LIST_INITIAL_CAPACITY * 3); i++) CHECK(dataOverlayListAdd(&list, (u64)((DATA_OVERLAY_LIST_INITIAL_CAPACITY * 3) - i - 1) * 4, patchA, sizeof(patchA)));
+    CHECK(list.count == (DATA_OVERLAY_LIST_INITIAL_CAPACITY * 3));
+    for(i = 0; i < list.count; i++) CHECK(list.entries[i].offset == ((u64)i * 4));
+    
+    dataOverlayListFree(&list);
+    CHECK(list.count == 0 && list.capacity == 0 && list.entries == NULL);
+}
+
+static void testApply(void)
+{
+    dataOverlayList list;
+    setupList(&list);
+    
+    u8 buf[BUF_SIZE], expected[BUF_SIZE];
+    
+    // Chunk that misses all regions
+    fillBuffer(buf, 8);
+    fillBuffer(expected, 8);
+    dataOverlayListApply(&list, 20, buf, 8);
+    CHECK(!memcmp(buf, expected, 8));
+    
+    // Chunk past the last region
+    fillBuffer(buf, 8);
+    dataOverlayListApply(&list, 50, buf, 8);
+    CHECK(!memcmp(buf, expected, 8));
+    
+    // Chunk that straddles the start of B: [28, 36)
+    fillBuffer(buf, 8);
+    fillBuffer(expected, 8);
+    memcpy(expected + 4, patchB, 4);
+    dataOverlayListApply(&list, 28, buf, 8);
+    CHECK(!memcmp(buf, expected, 8));
+    
+    // Chunk that straddles the end of B: [36, 44)
+    fillBuffer(buf, 8);
+    fillBuffer(expected, 8);
+    memcpy(expected, patchB + 4, 4);
+    dataOverlayListApply(&list, 36, buf, 8);
+    CHECK(!memcmp(buf, expected, 8));
+    
+    // Chunk contained in B: [34, 37)
+    fillBuffer(buf, 3);
+    dataOverlayListApply(&list, 34, buf, 3);
+    CHECK(!memcmp(buf, patchB + 2, 3));
+    
+    // Chunk that contains every region: [8, 56)
+    fillBuffer(buf, 48);
+    fillBuffer(expected, 48);
+    memcpy(expected + 8, patchA, sizeof(patchA));
+    memcpy(expected + 24, patchB, sizeof(patchB));
+    memcpy(expected + 40, patchC, sizeof(patchC));
+    dataOverlayListApply(&list, 8, buf, 48);
+    CHECK(!memcmp(buf, expected, 48));
+    
+    // Chunk that starts in A, contains B and ends in C: [18, 49)
+    fillBuffer(buf, 31);
+    fillBuffer(expected, 31);
+    memcpy(expected, patchA + 2, 2);
+    memcpy(expected + 14, patchB, sizeof(patchB));
+    memcpy(expected + 30, patchC, 1);
+    dataOverlayListApply(&list, 18, buf, 31);
+    CHECK(!memcmp(buf, expected, 31));
+    
+    // Nothing happens with an empty list
+    dataOverlayListClear(&list);
+    fillBuffer(buf, BUF_SIZE);
+    fillBuffer(expected, BUF_SIZE);
+    dataOverlayListApply(&list, 0, buf, BUF_SIZE);
+    CHECK(!memcmp(buf, expected, BUF_SIZE));
+    
+    dataOverlayListFree(&list);
+}
+
+int main(void)
+{
+    testAdd();
+    testApply();
+    
+    if (failedChecks)
+    {
+        fprintf(stderr, "overlay_test: %u check(s) failed\n", failedChecks);
+        return 1;
+    }
+    
+    printf("overlay_test: all checks passed\n");
+    return 0;
+}
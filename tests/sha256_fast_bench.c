@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <openssl/sha.h>
+
+#include "sha256_fast.h"
+
+// Compares sha256MultiCalculateHash() against OpenSSL's SHA256() on batches of same-sized messages
+// Usage: make -C tests bench
+
+#define HASH_SIZE       0x20
+#define BATCH_COUNT     256
+#define TOTAL_SIZE      (u64)0x8000000  // Bytes hashed per measurement
+
+static const u64 sizes[] = { 0x10, 0x40, 0x200, 0x1000, 0x4000 };
+
+static double getTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec + ((double)ts.tv_nsec / 1e9));
+}
+
+int main(void)
+{
+    u32 i, j;
+    u64 k, rounds;
+    double start, refTime, singleTime, batchTime;
+    
+    u8 *data = malloc(BATCH_COUNT * sizes[(sizeof(sizes) / sizeof(sizes[0])) - 1]);
+    u8 *ref = malloc(BATCH_COUNT * HASH_SIZE);
+    u8 *out = malloc(BATCH_COUNT * HASH_SIZE);
+    const void *inputs[BATCH_COUNT];
+    
+    if (!data || !ref || !out)
+    {
+        fprintf(stderr, "sha256_fast_bench: out of memory\n");
+        return 1;
+    }
+    
+    printf("%8s %14s %14s %14s\n", "size", "openssl MiB/s", "single MiB/s", "batch MiB/s");
+    
+    for(i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        u64 size = sizes[i];
+        rounds = (TOTAL_SIZE / (size * BATCH_COUNT));
+        
+        for(k = 0; k < (BATCH_COUNT * size); k++) data[k] = (u8)(k * 31);
+        for(j = 0; j < BATCH_COUNT; j++) inputs[j] = (data + (j * size));
+        
+        start = getTime();
+        for(k = 0; k < rounds; k++)
+        {
+            for(j = 0; j < BATCH_COUNT; j++) SHA256(inputs[j], size, ref + (j * HASH_SIZE));
+        }
+        refTime = (getTime() - start);
+        
+        start = getTime();
+        for(k = 0; k < rounds; k++)
+        {
+            for(j = 0; j < BATCH_COUNT; j++) sha256MultiCalculateHash(out + (j * HASH_SIZE), &(inputs[j]), size, 1);
+        }
+        singleTime = (getTime() - start);
+        
+        if (memcmp(ref, out, BATCH_COUNT * HASH_SIZE) != 0)
+        {
+            fprintf(stderr, "sha256_fast_bench: single-lane hashes differ from the reference for size 0x%lX\n", (unsigned long)size);
+            return 1;
+        }
+        
+        start = getTime();
+        for(k = 0; k < rounds; k++) sha256MultiCalculateHash(out, inputs, size, BATCH_COUNT);
+        batchTime = (getTime() - start);
+        
+        if (memcmp(ref, out, BATCH_COUNT * HASH_SIZE) != 0)
+        {
+            fprintf(stderr, "sha256_fast_bench: batched hashes differ from the reference for size 0x%lX\n", (unsigned long)size);
+            return 1;
+        }
+        
+        double mib = ((double)(rounds * BATCH_COUNT * size) / (1024.0 * 1024.0));
+        printf("%8lu %14.1f %14.1f %14.1f\n", (unsigned long)size, mib / refTime, mib / singleTime, mib / batchTime);
+    }
+    
+    free(data);
+    free(ref);
+    free(out);
+    
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sha256_fast.h"
+
+#define HASH_SIZE   0x20
+#define MAX_SIZE    1000
+#define LANE_COUNT  6                   // Not a multiple of SHA256_FAST_MAX_LANES on purpose
+
+static u32 failedChecks = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failedChecks++; \
+        } \
+    } while(0)
+
+typedef struct {
+    u64 size;
+    const char *hash;
+} sha256Vector;
+
+// Messages are (i & 0xFF) for i in [0, size). Sizes sit around the padding boundaries:
+// up to 55 bytes fit the length in the last block, 56-63 bytes need an extra padding block
+static const sha256Vector vectors[] = {
+    { 0,    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { 1,    "6e340b9cffb37a989ca544e6bb780a2c78901d3fb33738768511a30617afa01d" },
+    { 55,   "463eb28e72f82e0a96c0a4cc53690c571281131f672aa229e0d45ae59b598b59" },
+    { 56,   "da2ae4d6b36748f2a318f23e7ab1dfdf45acdc9d049bd80e59de82a60895f562" },
+    { 57,   "2fe741af801cc238602ac0ec6a7b0c3a8a87c7fc7d7f02a3fe03d1c12eac4d8f" },
+    { 63,   "29af2686fd53374a36b0846694cc342177e428d1647515f078784d69cdb9e488" },
+    { 64,   "fdeab9acf3710362bd2658cdc9a29e8f9c757fcf9811603a8c447cd1d9151108" },
+    { 65,   "4bfd2c8b6f1eec7a2afeb48b934ee4b2694182027e6d0fc075074f2fabb31781" },
+    { 119,  "da18797ed7c3a777f0847f429724a2d8cd5138e6ed2895c3fa1a6d39d18f7ec6" },
+    { 120,  "f52b23db1fbb6ded89ef42a23ce0c8922c45f25c50b568a93bf1c075420bbb7c" },
+    { 127,  "92ca0fa6651ee2f97b884b7246a562fa71250fedefe5ebf270d31c546bfea976" },
+    { 128,  "471fb943aa23c511f6f72f8d1652d9c880cfa392ad80503120547703e56a2be5" },
+    { 1000, "a8af099bf2e878609558dbf69d8f88f4a31040a8cf84b549a0cfa912f12ffc3f" }
+};
+
+static u8 messages[LANE_COUNT][MAX_SIZE];
+
+static void parseHash(u8 *out, const char *str)
+{
+    u32 i;
+    unsigned int val;
+    
+    for(i = 0; i < HASH_SIZE; i++)
+    {
+        sscanf(str + (i * 2), "%2x", &val);
+        out[i] = (u8)val;
+    }
+}
+
+static void testKnownAnswers(void)
+{
+    u32 i;
+    u64 j;
+    u8 expected[HASH_SIZE], hash[HASH_SIZE];
+    
+    for(j = 0; j < MAX_SIZE; j++) messages[0][j] = (u8)j;
+    
+    for(i = 0; i < (sizeof(vectors) / sizeof(vectors[0])); i++)
+    {
+        const void *input = messages[0];
+        
+        parseHash(expected, vectors[i].hash);
+        sha256MultiCalculateHash(hash, &input, vectors[i].size, 1);
+        
+        if (memcmp(hash, expected, HASH_SIZE) != 0)
+        {
+            fprintf(stderr, "%s:%d: hash mismatch for a %lu-byte message\n", __FILE__, __LINE__, (unsigned long)vectors[i].size);
+            failedChecks++;
+        }
+    }
+    
+    // Short ASCII vector from FIPS 180-2
+    const char *abc = "abc";
+    const void *input = abc;
+    
+    parseHash(expected, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    sha256MultiCalculateHash(hash, &input, 3, 1);
+    CHECK(memcmp(hash, expected, HASH_SIZE) == 0);
+}
+
+static void testAllLanes(void)
+{
+    u32 i, j;
+    u64 k;
+    u8 expected[HASH_SIZE], hashes[LANE_COUNT * HASH_SIZE];
+    const void *inputs[LANE_COUNT];
+    
+    for(j = 0; j < LANE_COUNT; j++)
+    {
+        for(k = 0; k < MAX_SIZE; k++) messages[j][k] = (u8)k;
+        inputs[j] = messages[j];
+    }
+    
+    // The same message in every lane must produce the known answer in every lane
+    for(i = 0; i < (sizeof(vectors) / sizeof(vectors[0])); i++)
+    {
+        parseHash(expected, vectors[i].hash);
+        memset(hashes, 0, sizeof(hashes));
+        
+        sha256MultiCalculateHash(hashes, inputs, vectors[i].size, LANE_COUNT);
+        
+        for(j = 0; j < LANE_COUNT; j++) CHECK(memcmp(hashes + (j * HASH_SIZE), expected, HASH_SIZE) == 0);
+    }
+}
+
+static void testDistinctLanes(void)
+{
+    u32 i, j;
+    u64 k;
+    u8 single[HASH_SIZE], hashes[LANE_COUNT * HASH_SIZE];
+    const void *inputs[LANE_COUNT];
+    
+    for(j = 0; j < LANE_COUNT; j++)
+    {
+        for(k = 0; k < MAX_SIZE; k++) messages[j][k] = (u8)((k * (j + 3)) ^ (j << 4));
+        inputs[j] = messages[j];
+    }
+    
+    // Every lane must match the result of hashing that message on its own
+    for(i = 0; i < (sizeof(vectors) / sizeof(vectors[0])); i++)
+    {
+        sha256MultiCalculateHash(hashes, inputs, vectors[i].size, LANE_COUNT);
+        
+        for(j = 0; j < LANE_COUNT; j++)
+        {
+            sha256MultiCalculateHash(single, &(inputs[j]), vectors[i].size, 1);
+            CHECK(memcmp(hashes + (j * HASH_SIZE), single, HASH_SIZE) == 0);
+        }
+    }
+    
+    // Different messages must not collide
+    sha256MultiCalculateHash(hashes, inputs, 64, LANE_COUNT);
+    CHECK(memcmp(hashes, hashes + HASH_SIZE, HASH_SIZE) != 0);
+}
+
+int main(void)
+{
+#if defined(__SHA__) && defined(__x86_64__)
+    if (!__builtin_cpu_supports("sha"))
+    {
+        printf("sha256_fast_test: SHA extensions not supported by this CPU, skipped\n");
+        return 0;
+    }
+#endif
+    
+    testKnownAnswers();
+    testAllLanes();
+    testDistinctLanes();
+    
+    if (failedChecks)
+    {
+        fprintf(stderr, "sha256_fast_test: %u check(s) failed\n", failedChecks);
+        return 1;
+    }
+    
+    printf("sha256_fast_test: all checks passed\n");
+    return 0;
+}
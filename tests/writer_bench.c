@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "writer.h"
+
+// Compares the output writer backends by writing the same output with each one, including the final fsync()
+// Usage: make -C tests bench. WRITER_BENCH_DIR selects the output directory (defaults to /tmp, which may be a tmpfs without O_DIRECT support)
+
+#define TOTAL_SIZE      (u64)0x20000000     // 512 MiB
+#define PART_SIZE       (u64)0xFFFF0000     // Same part size used by FAT32 split dumps
+
+static const char *backendNames[OUTPUT_WRITER_BACKEND_CNT] = { "stdio", "async", "io_uring" };
+
+static double getTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec + ((double)ts.tv_nsec / 1e9));
+}
+
+int main(void)
+{
+    const char *dir = getenv("WRITER_BENCH_DIR");
+    char path[NAME_BUF_LEN];
+    
+    u8 *buf = malloc(DUMP_BUFFER_SIZE);
+    if (!buf)
+    {
+        fprintf(stderr, "writer_bench: out of memory\n");
+        return 1;
+    }
+    
+    for(u64 i = 0; i < DUMP_BUFFER_SIZE; i++) buf[i] = (u8)(i * 13);
+    
+    snprintf(path, sizeof(path), "%s/writer_bench.bin", (dir ? dir : "/tmp"));
+    
+    printf("%-10s %12s\n", "backend", "MiB/s");
+    
+    for(u32 backend = 0; backend < OUTPUT_WRITER_BACKEND_CNT; backend++)
+    {
+        outputWriter writer;
+        bool success = true;
+        
+        outputWriterSetDefaultBackend((outputWriterBackend)backend);
+        
+        double start = getTime();
+        
+        if (!outputWriterOpen(&writer, path, OUTPUT_SPLIT_NONE, TOTAL_SIZE, PART_SIZE, 0, 0, NULL))
+        {
+            fprintf(stderr, "writer_bench: unable to open \"%s\"\n", path);
+            free(buf);
+            return 1;
+        }
+        
+        // The writer silently falls back to stdio if the backend can't be started
+        outputWriterBackend used = writer.backend;
+        
+        for(u64 offset = 0; success && offset < TOTAL_SIZE; offset += DUMP_BUFFER_SIZE) success = outputWriterWrite(&writer, buf, DUMP_BUFFER_SIZE);
+        
+        if (!success) fprintf(stderr, "writer_bench: %s: %s\n", backendNames[backend], writer.errorStr);
+        
+        outputWriterClose(&writer);
+        
+        // Buffered backends would only measure page cache copies otherwise. O_DIRECT writes have already reached the disk by now
+        int fd = open(path, O_WRONLY);
+        if (fd >= 0)
+        {
+            fsync(fd);
+            close(fd);
+        }
+        
+        double elapsed = (getTime() - start);
+        
+        remove(path);
+        
+        if (!success)
+        {
+            free(buf);
+            return 1;
+        }
+        
+        if (used != (outputWriterBackend)backend)
+        {
+            printf("%-10s %12s\n", backendNames[backend], "unavailable");
+        } else {
+            printf("%-10s %12.1f\n", backendNames[backend], ((double)TOTAL_SIZE / (1024.0 * 1024.0)) / elapsed);
+        }
+    }
+    
+    free(buf);
+    
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+#include "writer.h"
+
+#define OUTPUT_SIZE     (OUTPUT_WRITER_BACKEND_MIN_SIZE + (u64)0x123456)    // Big enough for every backend, not aligned to anything
+#define PART_SIZE       (u64)0x1800321                                      // Unaligned part boundaries
+#define CHUNK_SIZE      (u64)0x100043                                       // Unaligned write chunks
+#define PATCH_SIZE      (u64)0x200
+
+static u32 failedChecks = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failedChecks++; \
+        } \
+    } while(0)
+
+static const char *backendNames[OUTPUT_WRITER_BACKEND_CNT] = { "stdio", "async", "io_uring" };
+
+static char dirPath[64];
+
+static u8 outputByte(u64 offset)
+{
+    return (u8)((offset * 13) ^ (offset >> 11));
+}
+
+static u8 patchByte(u64 offset)
+{
+    return (u8)~outputByte(offset);
+}
+
+static bool isPatched(u64 offset, const u64 *patchOffsets, u32 patchCnt)
+{
+    for(u32 i = 0; i < patchCnt; i++)
+    {
+        if (offset >= patchOffsets[i] && offset < (patchOffsets[i] + PATCH_SIZE)) return true;
+    }
+    
+    return false;
+}
+
+static bool patchOutput(outputWriter *writer, u64 offset)
+{
+    u8 data[PATCH_SIZE];
+    
+    for(u64 i = 0; i < PATCH_SIZE; i++) data[i] = patchByte(offset + i);
+    
+    return outputWriterPatch(writer, offset, data, PATCH_SIZE);
+}
+
+// Reads every part file back and compares it against the expected output
+static bool verifyOutput(const char *basePath, outputSplitMode splitMode, const u64 *patchOffsets, u32 patchCnt)
+{
+    char partPath[NAME_BUF_LEN + 4];
+    u64 offset = 0, partSize = (splitMode == OUTPUT_SPLIT_NONE ? OUTPUT_SIZE : PART_SIZE);
+    u32 partIndex = 0;
+    bool success = true;
+    
+    u8 *buf = malloc(partSize);
+    if (!buf) return false;
+    
+    while(success && offset < OUTPUT_SIZE)
+    {
+        u64 expectedSize = ((OUTPUT_SIZE - offset) < partSize ? (OUTPUT_SIZE - offset) : partSize);
+        
+        if (splitMode == OUTPUT_SPLIT_NONE)
+        {
+            snprintf(partPath, sizeof(partPath), "%s", basePath);
+        } else {
+            snprintf(partPath, sizeof(partPath), "%s.%02u", basePath, partIndex);
+        }
+        
+        FILE *fp = fopen(partPath, "rb");
+        if (!fp) return false;
+        
+        // Zero padding from aligned writes must not be left behind
+        fseek(fp, 0, SEEK_END);
+        success = ((u64)ftell(fp) == expectedSize);
+        rewind(fp);
+        
+        if (success) success = (fread(buf, 1, expectedSize, fp) == expectedSize);
+        
+        for(u64 i = 0; success && i < expectedSize; i++)
+        {
+            u64 pos = (offset + i);
+            if (buf[i] != (isPatched(pos, patchOffsets, patchCnt) ? patchByte(pos) : outputByte(pos)))
+            {
+                fprintf(stderr, "mismatch at output offset 0x%lX\n", pos);
+                success = false;
+            }
+        }
+        
+        fclose(fp);
+        remove(partPath);
+        
+        offset += expectedSize;
+        partIndex++;
+    }
+    
+    free(buf);
+    
+    return success;
+}
+
+static void testBackend(outputWriterBackend backend, outputSplitMode splitMode)
+{
+    outputWriter writer;
+    char basePath[NAME_BUF_LEN];
+    u64 offset, chunkSize;
+    
+    // The first patch lands in data that's long gone, the second one in the unaligned tail kept by the io_uring backend
+    u64 patchOffsets[3] = { 0x10, 0, 0 };
+    u32 patchCnt = 0;
+    
+    u8 *chunk = malloc(CHUNK_SIZE);
+    if (!chunk)
+    {
+        CHECK(chunk != NULL);
+        return;
+    }
+    
+    snprintf(basePath, sizeof(basePath), "%s/output_%u_%u", dirPath, backend, splitMode);
+    
+    outputWriterSetDefaultBackend(backend);
+    
+    CHECK(outputWriterOpen(&writer, basePath, splitMode, OUTPUT_SIZE, PART_SIZE, 0, 0, NULL));
+    CHECK(writer.backend == backend);
+    
+    for(offset = 0; offset < OUTPUT_SIZE; offset += chunkSize)
+    {
+        chunkSize = ((OUTPUT_SIZE - offset) < CHUNK_SIZE ? (OUTPUT_SIZE - offset) : CHUNK_SIZE);
+        
+        for(u64 i = 0; i < chunkSize; i++) chunk[i] = outputByte(offset + i);
+        
+        if (!outputWriterWrite(&writer, chunk, chunkSize))
+        {
+            fprintf(stderr, "%s: %s\n", backendNames[backend], writer.errorStr);
+            CHECK(false);
+            break;
+        }
+        
+        // Patching flushes the pending writes halfway through the output, just like a journal checkpoint
+        if (offset == (CHUNK_SIZE * 8))
+        {
+            patchOffsets[1] = (offset + chunkSize - PATCH_SIZE - 0x11);
+            CHECK(patchOutput(&writer, patchOffsets[0]));
+            CHECK(patchOutput(&writer, patchOffsets[1]));
+            patchCnt = 2;
+        }
+    }
+    
+    patchOffsets[2] = (OUTPUT_SIZE - PATCH_SIZE - 1);
+    CHECK(patchOutput(&writer, patchOffsets[2]));
+    patchCnt = 3;
+    
+    outputWriterClose(&writer);
+    
+    CHECK(verifyOutput(basePath, splitMode, patchOffsets, patchCnt));
+    
+    free(chunk);
+}
+
+static void testSmallOutput(void)
+{
+    outputWriter writer;
+    char basePath[NAME_BUF_LEN];
+    
+    snprintf(basePath, sizeof(basePath), "%s/small", dirPath);
+    
+    // Outputs below OUTPUT_WRITER_BACKEND_MIN_SIZE always use the stdio backend
+    outputWriterSetDefaultBackend(OUTPUT_WRITER_BACKEND_ASYNC);
+    CHECK(outputWriterOpen(&writer, basePath, OUTPUT_SPLIT_NONE, 0x1000, 0, 0, 0, NULL));
+    CHECK(writer.backend == OUTPUT_WRITER_BACKEND_STDIO);
+    outputWriterClose(&writer);
+    remove(basePath);
+    
+    outputWriterSetDefaultBackend(OUTPUT_WRITER_BACKEND_CNT);
+    CHECK(outputWriterGetDefaultBackend() == OUTPUT_WRITER_BACKEND_STDIO);
+}
+
+static bool isIoUringAvailable(void)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(struct io_uring_params));
+    
+    int fd = (int)syscall(__NR_io_uring_setup, 1, &params);
+    if (fd < 0) return false;
+    
+    close(fd);
+    return true;
+}
+
+int main(void)
+{
+    snprintf(dirPath, sizeof(dirPath), "/tmp/writer_testXXXXXX");
+    if (!mkdtemp(dirPath))
+    {
+        fprintf(stderr, "writer_test: unable to create temporary directory\n");
+        return 1;
+    }
+    
+    CHECK(outputWriterGetDefaultBackend() == OUTPUT_WRITER_BACKEND_STDIO);
+    
+    for(u32 backend = 0; backend < OUTPUT_WRITER_BACKEND_CNT; backend++)
+    {
+        // Sandboxes may block io_uring altogether
+        if (backend == OUTPUT_WRITER_BACKEND_IO_URING && !isIoUringAvailable())
+        {
+            printf("writer_test: io_uring not available, skipping its checks\n");
+            continue;
+        }
+        
+        testBackend((outputWriterBackend)backend, OUTPUT_SPLIT_NONE);
+        testBackend((outputWriterBackend)backend, OUTPUT_SPLIT_SUFFIX);
+    }
+    
+    testSmallOutput();
+    
+    rmdir(dirPath);
+    
+    if (failedChecks)
+    {
+        fprintf(stderr, "writer_test: %u check(s) failed\n", failedChecks);
+        return 1;
+    }
+    
+    printf("writer_test: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xci_image.h"
+
+#define NORMAL_AREA_SIZE    (u64)0x4000     // 32 media units
+#define SECURE_DATA_SIZE    (u64)0x3000     // Secure area bytes actually stored in the trimmed image
+
+static u32 failedChecks = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failedChecks++; \
+        } \
+    } while(0)
+
+static char imagePath[64];
+
+static u8 imageByte(u64 offset)
+{
+    return (u8)((offset * 7) ^ (offset >> 8));
+}
+
+// Writes a trimmed XCI image: gamecard header + normal area + the start of the secure area
+// If 'keyArea' is true, the image is prefixed with a zeroed key area, like some dumps are
+static bool writeImage(u32 magic, u8 sizeValue, bool keyArea)
+{
+    int fd;
+    FILE *fp;
+    u64 i, baseOffset = (keyArea ? GAMECARD_KEY_AREA_SIZE : 0);
+    u64 imageSize = (baseOffset + NORMAL_AREA_SIZE + SECURE_DATA_SIZE);
+    gamecard_header_t header;
+    
+    u8 *image = calloc(1, imageSize);
+    if (!image) return false;
+    
+    for(i = 0; i < (NORMAL_AREA_SIZE + SECURE_DATA_SIZE); i++) image[baseOffset + i] = imageByte(i);
+    
+    memset(&header, 0, sizeof(gamecard_header_t));
+    header.magic = __builtin_bswap32(magic);
+    header.secureAreaStartAddr = (u32)(NORMAL_AREA_SIZE / MEDIA_UNIT_SIZE);
+    header.size = sizeValue;
+    memcpy(image + baseOffset, &header, sizeof(gamecard_header_t));
+    
+    snprintf(imagePath, sizeof(imagePath), "/tmp/xci_image_testXXXXXX");
+    fd = mkstemp(imagePath);
+    fp = (fd >= 0 ? fdopen(fd, "wb") : NULL);
+    
+    bool success = (fp && fwrite(image, 1, imageSize, fp) == imageSize);
+    
+    if (fp) fclose(fp);
+    free(image);
+    
+    return success;
+}
+
+static void removeImage(void)
+{
+    unlink(imagePath);
+}
+
+static void testGeometry(bool keyArea)
+{
+    xci_image_storage_t normal, secure;
+    u64 baseOffset = (keyArea ? GAMECARD_KEY_AREA_SIZE : 0);
+    
+    CHECK(writeImage(GAMECARD_HEADER_MAGIC, 0xFA, keyArea));
+    
+    CHECK(xciImageStorageOpen(&normal, imagePath, XCI_IMAGE_STORAGE_NORMAL));
+    CHECK(normal.offset == baseOffset);
+    CHECK(normal.size == NORMAL_AREA_SIZE);
+    CHECK(normal.availableSize == NORMAL_AREA_SIZE);
+    
+    // 1 GiB capacity minus 0x24 bytes of ECC data per 0x200-byte block, minus the normal area
+    CHECK(xciImageStorageOpen(&secure, imagePath, XCI_IMAGE_STORAGE_SECURE));
+    CHECK(secure.offset == (baseOffset + NORMAL_AREA_SIZE));
+    CHECK(secure.size == ((GAMECARD_SIZE_1GiB - ((GAMECARD_SIZE_1GiB / 0x200) * 0x24)) - NORMAL_AREA_SIZE));
+    CHECK(secure.size == getGameCardSecureStorageSize(GAMECARD_SIZE_1GiB, NORMAL_AREA_SIZE));
+    CHECK(secure.availableSize == SECURE_DATA_SIZE);
+    
+    xciImageStorageClose(&normal);
+    xciImageStorageClose(&secure);
+    CHECK(normal.file == NULL && secure.file == NULL);
+    
+    removeImage();
+}
+
+static void testTrimmedReads(void)
+{
+    u64 i;
+    bool match;
+    u8 buf[0x2000];
+    xci_image_storage_t normal, secure;
+    
+    CHECK(writeImage(GAMECARD_HEADER_MAGIC, 0xF8, false));
+    CHECK(xciImageStorageOpen(&normal, imagePath, XCI_IMAGE_STORAGE_NORMAL));
+    CHECK(xciImageStorageOpen(&secure, imagePath, XCI_IMAGE_STORAGE_SECURE));
+    
+    // Normal area read, past the gamecard header
+    CHECK(xciImageStorageRead(&normal, 0x1000, buf, 0x1000));
+    for(i = 0, match = true; i < 0x1000; i++) match &= (buf[i] == imageByte(0x1000 + i));
+    CHECK(match);
+    
+    // Reads can't cross the end of the normal partition
+    CHECK(!xciImageStorageRead(&normal, NORMAL_AREA_SIZE - 0x200, buf, 0x400));
+    
+    // Secure area read straddling the end of the trimmed data: stored bytes first, then 0xFF padding
+    CHECK(xciImageStorageRead(&secure, SECURE_DATA_SIZE - 0x800, buf, 0x2000));
+    for(i = 0, match = true; i < 0x800; i++) match &= (buf[i] == imageByte(NORMAL_AREA_SIZE + SECURE_DATA_SIZE - 0x800 + i));
+    CHECK(match);
+    for(i = 0x800, match = true; i < 0x2000; i++) match &= (buf[i] == 0xFF);
+    CHECK(match);
+    
+    // Fully trimmed area, right at the end of the secure partition
+    memset(buf, 0, sizeof(buf));
+    CHECK(xciImageStorageRead(&secure, secure.size - 0x200, buf, 0x200));
+    for(i = 0, match = true; i < 0x200; i++) match &= (buf[i] == 0xFF);
+    CHECK(match);
+    
+    CHECK(!xciImageStorageRead(&secure, secure.size - 0x200, buf, 0x400));
+    
+    xciImageStorageClose(&normal);
+    xciImageStorageClose(&secure);
+    removeImage();
+}
+
+static void testInvalidImages(void)
+{
+    xci_image_storage_t storage;
+    
+    // Bad magic
+    CHECK(writeImage(0x12345678, 0xFA, false));
+    CHECK(!xciImageStorageOpen(&storage, imagePath, XCI_IMAGE_STORAGE_NORMAL));
+    CHECK(storage.file == NULL);
+    removeImage();
+    
+    // Unknown gamecard size
+    CHECK(writeImage(GAMECARD_HEADER_MAGIC, 0x00, false));
+    CHECK(!xciImageStorageOpen(&storage, imagePath, XCI_IMAGE_STORAGE_SECURE));
+    removeImage();
+    
+    // Invalid storage index
+    CHECK(writeImage(GAMECARD_HEADER_MAGIC, 0xFA, false));
+    CHECK(!xciImageStorageOpen(&storage, imagePath, 2));
+    removeImage();
+    
+    CHECK(!xciImageStorageOpen(&storage, "/nonexistent/image.xci", XCI_IMAGE_STORAGE_NORMAL));
+}
+
+int main(void)
+{
+    testGeometry(false);
+    testGeometry(true);
+    testTrimmedReads();
+    testInvalidImages();
+    
+    if (failedChecks)
+    {
+        fprintf(stderr, "xci_image_test: %u check(s) failed\n", failedChecks);
+        return 1;
+    }
+    
+    printf("xci_image_test: all checks passed\n");
+    return 0;
+}